@@ -2315,14 +2315,21 @@ bool CBotIndexExpr::ExecuteVar(CBotVar* &pVar, CBotStack* &pile, CBotToken* prev
 
     int n = p->GetValInt();     // position in the table
 
+    // an array of other programs too, only on the thread of the application
+    CBotVarClass* pArray = pVar->GetPointer();
+    bool bShared = (pArray != NULL && pArray->IsShared());
+    if ( bShared && pile->WaitApp() ) return false;
+
     pVar = (static_cast<CBotVarArray*>(pVar))->GetItem(n, bExtend);
     if (pVar == NULL)
     {
         pile->SetError(TX_OUTARRAY, prevToken);
         return pj->Return(pile);
     }
+    if ( bShared ) CBotVarClass::SetShared(pVar);
 
     pVar->Maj(pile->GetPUser(), true);
+    if ( pile->IsWaiting() ) return false;      // updated on the thread of the application
 
     if ( m_next3 != NULL &&
          !m_next3->ExecuteVar(pVar, pile, prevToken, bStep, bExtend) ) return false;
@@ -2414,6 +2421,9 @@ bool CBotFieldExpr::ExecuteVar(CBotVar* &pVar, CBotStack* &pile, CBotToken* prev
 
     if (bStep && pile->IfStep()) return false;
 
+    // an instance of other programs too, only on the thread of the application
+    if ( pItem->IsShared() && pile->WaitApp() ) return false;
+
     pVar = pVar->GetItemRef(m_nIdent);
     if (pVar == NULL)
     {
@@ -2423,13 +2433,24 @@ bool CBotFieldExpr::ExecuteVar(CBotVar* &pVar, CBotStack* &pile, CBotToken* prev
 
     if (pVar->IsStatic())
     {
+        // shared by all the programs, only on the thread of the application
+        if ( pile->WaitApp() ) return false;
+
         // for a static variable, takes it in the class itself
         CBotClass* pClass = pItem->GetClass();
         pVar = pClass->GetItem(m_token.GetString());
+        CBotVarClass::SetShared(pVar);
+    }
+    else
+    {
+        // reads the element from the application, if its class says how
+        pItem->MajItem(pVar, pile->GetPUser());
+        if ( pItem->IsShared() ) CBotVarClass::SetShared(pVar);
     }
 
     // request the update of the element, if applicable
     pVar->Maj(pile->GetPUser(), true);
+    if ( pile->IsWaiting() ) return false;      // updated on the thread of the application
 
     if ( m_next3 != NULL &&
          !m_next3->ExecuteVar(pVar, pile, &m_token, bStep, bExtend) ) return false;
@@ -2457,6 +2478,7 @@ CBotLeftExpr::CBotLeftExpr()
 {
     name    = "CBotLeftExpr";
     m_nIdent = 0;
+    m_nSlot = -1;
 }
 
 CBotLeftExpr::~CBotLeftExpr()
@@ -2513,6 +2535,7 @@ CBotLeftExpr* CBotLeftExpr::Compile(CBotToken* &p, CBotCStack* pStack)
                 var = var->GetItem(p->GetString());
                 i->SetUniqNum(var->GetUniqNum());
             }
+            if (inst->m_nIdent > 0) inst->m_nSlot = var->GetSlot();
             p = p->GetNext();   // next token
 
             while (true)
@@ -2647,7 +2670,7 @@ bool CBotLeftExpr::ExecuteVar(CBotVar* &pVar, CBotStack* &pile, CBotToken* prevT
 {
     pile = pile->AddStack(this);
 
-    pVar = pile->FindVar(m_nIdent);
+    pVar = pile->FindLocal(m_nIdent, m_nSlot);
     if (pVar == NULL)
     {
 #ifdef    _DEBUG
@@ -3044,6 +3067,7 @@ CBotExprVar::CBotExprVar()
 {
     name    = "CBotExprVar";
     m_nIdent = 0;
+    m_nSlot = -1;
 }
 
 CBotExprVar::~CBotExprVar()
@@ -3091,6 +3115,10 @@ CBotInstr* CBotExprVar::Compile(CBotToken* &p, CBotCStack* pStack, int privat)
                 i->SetUniqNum(ident);
                 inst->AddNext3(i);  // added after
             }
+            else if (ident > 0)
+            {
+                (static_cast<CBotExprVar*>(inst))->m_nSlot = var->GetSlot();
+            }
 
             p = p->GetNext();   // next token
 
@@ -3288,7 +3316,7 @@ bool CBotExprVar::ExecuteVar(CBotVar* &pVar, CBotStack* &pj, CBotToken* prevToke
 
     if (bStep && m_nIdent>0 && pj->IfStep()) return false;
 
-    pVar = pj->FindVar(m_nIdent, true);     // tries with the variable update if necessary
+    pVar = pj->FindLocal(m_nIdent, m_nSlot, true);  // tries with the variable update if necessary
     if (pVar == NULL)
     {
 #ifdef    _DEBUG
@@ -3297,6 +3325,7 @@ bool CBotExprVar::ExecuteVar(CBotVar* &pVar, CBotStack* &pj, CBotToken* prevToke
         pj->SetError(1, &m_token);
         return false;
     }
+    if ( pj->IsWaiting() ) return false;    // updated on the thread of the application
     if ( m_next3 != NULL &&
          !m_next3->ExecuteVar(pVar, pj, &m_token, bStep, false) )
             return false;   // field of an instance, table, methode
@@ -3415,8 +3444,10 @@ CBotInstr* CBotInstrMethode::Compile(CBotToken* &p, CBotCStack* pStack, CBotVar*
             {
                 CBotClass* pClass = var->GetClass();    // pointer to the class
                 inst->m_ClassName = pClass->GetName();  // name of the class
+                long ident;
                 CBotTypResult r = pClass->CompileMethode(inst->m_NomMethod, var, ppVars,
-                                                         pStack, inst->m_MethodeIdent);
+                                                         pStack, ident);
+                inst->m_MethodeIdent = ident;
                 delete pStack->TokenStack();    // release parameters on the stack
                 inst->m_typRes = r;
 
@@ -3675,7 +3706,9 @@ CBotInstr* CBotNew::Compile(CBotToken* &p, CBotCStack* pStack)
         if (!pStk->IsOk()) goto error;
 
         // constructor exist?
-        CBotTypResult r = pClass->CompileMethode(pClass->GetName(), pVar, ppVars, pStk, inst->m_nMethodeIdent);
+        long ident;
+        CBotTypResult r = pClass->CompileMethode(pClass->GetName(), pVar, ppVars, pStk, ident);
+        inst->m_nMethodeIdent = ident;
         delete pStk->TokenStack();  // release extra stack
         int typ = r.GetType();
 
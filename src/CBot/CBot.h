@@ -25,6 +25,10 @@
 #include "CBotDll.h"                    // public definitions
 #include "CBotToken.h"                  // token management
 
+#include <atomic>
+#include <map>
+#include <vector>
+
 #define    STACKRUN    true             /// \def return execution directly on a suspended routine
 #define    STACKMEM    true             /// \def preserve memory for the execution stack
 #define    MAXSTACK    990              /// \def stack size reserved
@@ -50,6 +54,8 @@ class CBotExprVar;  // a variable name as
 class CBotWhile;    // while (...) {...};
 class CBotIf;       // if (...) {...} else {...}
 class CBotDefParam; // paramerer list of a function
+class CBotByteCode; // bytecode of a function
+class CBotByteState;// execution state of a bytecode
 
 
 
@@ -182,6 +188,17 @@ public:
     CBotVar* FindVar(long ident, bool bUpdate = false,
                                         bool bModif  = false);
 
+    /**
+     * \brief Fetch a local variable by the slot given to it at compilation
+     * \brief The function running keeps the variables already found in
+     * \brief their slots, the stack is searched only the first time.
+     * \param [in] ident Identifier of the variable
+     * \param [in] slot Slot of the variable in its function, -1 if none
+     * \param [in] bUpdate Update the variable from the application
+     * \return Found variable
+     */
+    CBotVar* FindLocal(long ident, int slot, bool bUpdate = false);
+
     /**
      * \brief Find variable by its token and returns a copy of it.
      * \param Token Token upon which search is performed
@@ -232,14 +249,24 @@ public:
     bool            GetBlock();
 
 
-    bool            ExecuteCall(long& nIdent, CBotToken* token, CBotVar** ppVar, CBotTypResult& rettype);
-    void            RestoreCall(long& nIdent, CBotToken* token, CBotVar** ppVar);
+    bool            ExecuteCall(std::atomic<long>& nIdent, CBotToken* token, CBotVar** ppVar, CBotTypResult& rettype);
+    void            RestoreCall(std::atomic<long>& nIdent, CBotToken* token, CBotVar** ppVar);
 
     bool            SaveState(FILE* pf);
     bool            RestoreState(FILE* pf, CBotStack* &pStack);
 
     static
     void            SetTimer(int n);
+    static
+    bool            SetCompute(bool bCompute);
+    static
+    bool            WaitApp();
+    static
+    bool            IsWaiting();
+    static
+    int                GetWaitTimer();
+    static
+    void            ContinueWait(int timer);
 
     void            GetRunPos(const char* &FunctionName, int &start, int &end);
     CBotVar*        GetStackVars(const char* &FunctionName, int level);
@@ -247,20 +274,29 @@ public:
     int                m_temp;
 
 private:
+    void            SetSlot(int slot, CBotVar* var);            // keeps a variable of this function
+    void            ClearSlots();                                // forgets the variables of this level
+
     CBotStack*        m_next;
     CBotStack*        m_next2;
     CBotStack*        m_prev;
     friend class CBotInstArray;
 
+    CBotStack*        m_frame;                    // level of the function running
+    CBotVar**        m_slots;                    // variables of the function found by slot
+    int                m_nbSlots;
+
 #ifdef    _DEBUG
     int                m_index;
 #endif
     int                m_state;
     int                m_step;
-    static int        m_error;
-    static int        m_start;
-    static int        m_end;
-    static
+    // the state of the execution belongs to the thread running it
+    // (see CBotProgram::RunCompute), Run() initialises it again each time
+    static thread_local int        m_error;
+    static thread_local int        m_start;
+    static thread_local int        m_end;
+    static thread_local
     CBotVar*        m_retvar;                    // result of a return
 
     CBotVar*        m_var;                        // result of the operations
@@ -271,19 +307,27 @@ private:
 //    bool            m_bDontDelete;                // special, not to destroy the variable during delete
     CBotProgram*    m_prog;                        // user-defined functions
 
-    static
+    static thread_local
     int                m_initimer;
-    static
+    static thread_local
     int                m_timer;
-    static
+    static thread_local
     CBotString        m_labelBreak;
-    static
+    static thread_local
     void*            m_pUser;
+    static thread_local
+    bool            m_bCompute;                    // run by CBotProgram::RunCompute()?
+    static thread_local
+    bool            m_bWait;                    // stopped before the application?
+    static thread_local
+    int                m_waitTimer;                // steps left when stopped
 
     CBotInstr*        m_instr;                    // the corresponding instruction
     bool            m_bFunc;                    // an input of a function?
     CBotCall*        m_call;                        // recovery point in a extern call
+    CBotByteState*    m_vm;                        // state of a function run by CBotByteCode
     friend class    CBotTry;
+    friend class    CBotByteCode;
 };
 
 // inline routinees must be declared in file.h
@@ -322,6 +366,7 @@ private:
 
     bool            m_bBlock;                    // is part of a block (variables are local to this block)
     CBotVar*        m_listVar;
+    int                m_nbSlots;                    // slots given in the function, -1 if not its level
 
     static
     CBotProgram*    m_prog;                        // list of compiled functions
@@ -345,6 +390,7 @@ public:
     CBotClass*        GetClass();                    // gives the class of the value on the stack
 
     void            AddVar(CBotVar* p);            // adds a local variable
+    void            StartFunction();            // the local variables get slots from here
     CBotVar*        FindVar(CBotToken* &p);        // finds a variable
     CBotVar*        FindVar(CBotToken& Token);
     bool            CheckVarLocal(CBotToken* &pToken);
@@ -417,6 +463,7 @@ protected:
     friend class    CBotClassInst;
     friend class    CBotInt;
     friend class    CBotListArray;
+    friend class    CBotByteCode;
 
 public:
                 CBotInstr();
@@ -474,6 +521,7 @@ private:
     CBotInstr*    m_Condition;        // condition
     CBotInstr*    m_Block;            // instructions
     CBotString    m_label;            // a label if there is
+    friend class CBotByteCode;
 
 public:
                 CBotWhile();
@@ -490,6 +538,7 @@ private:
     CBotInstr*    m_Block;            // instruction
     CBotInstr*    m_Condition;        // conditions
     CBotString    m_label;            // a label if there is
+    friend class CBotByteCode;
 
 public:
                 CBotDo();
@@ -508,6 +557,7 @@ private:
     CBotInstr*    m_Incr;                // instruction for increment
     CBotInstr*    m_Block;            // instructions
     CBotString    m_label;            // a label if there is
+    friend class CBotByteCode;
 
 public:
                 CBotFor();
@@ -522,6 +572,7 @@ class CBotBreak : public CBotInstr
 {
 private:
     CBotString    m_label;            // a label if there is
+    friend class CBotByteCode;
 
 public:
                 CBotBreak();
@@ -536,6 +587,7 @@ class CBotReturn : public CBotInstr
 {
 private:
     CBotInstr*    m_Instr;            // paramter of return
+    friend class CBotByteCode;
 
 public:
                 CBotReturn();
@@ -647,6 +699,7 @@ private:
     CBotInstr*    m_Condition;        // condition
     CBotInstr*    m_Block;            // instructions
     CBotInstr*    m_BlockElse;        // instructions
+    friend class CBotByteCode;
 
 public:
                 CBotIf();
@@ -666,6 +719,7 @@ private:
     CBotInstr*    m_var;                // the variable to initialize
     CBotInstr*    m_expr;                // a value to put, if there is
 ///    CBotInstr*    m_next;                // several definitions chained
+    friend class CBotByteCode;
 
 public:
                 CBotInt();
@@ -728,6 +782,7 @@ class CBotBoolean : public CBotInstr
 private:
     CBotInstr*    m_var;                // variable to initialise
     CBotInstr*    m_expr;                // a value to put, if there is
+    friend class CBotByteCode;
 
 public:
                 CBotBoolean();
@@ -746,6 +801,7 @@ class CBotFloat : public CBotInstr
 private:
     CBotInstr*    m_var;                // variable to initialise
     CBotInstr*    m_expr;                // a value to put, if there is
+    friend class CBotByteCode;
 
 public:
                 CBotFloat();
@@ -763,6 +819,7 @@ class CBotIString : public CBotInstr
 private:
     CBotInstr*    m_var;                // variable to initialise
     CBotInstr*    m_expr;                // a value to put, if there is
+    friend class CBotByteCode;
 
 public:
                 CBotIString();
@@ -783,7 +840,8 @@ private:
     CBotInstr*    m_Parameters;        // parameters to be evaluated for the contructor
     CBotInstr*    m_expr;                // a value to put, if there is
     bool        m_hasParams;        // has it parameters?
-    long        m_nMethodeIdent;
+    std::atomic<long>
+                m_nMethodeIdent;    // run by the programs sharing the instruction
 
 public:
                 CBotClassInst();
@@ -812,6 +870,8 @@ class CBotLeftExpr : public CBotInstr
 {
 private:
     long        m_nIdent;
+    int         m_nSlot;            // slot of a local variable, -1 if none
+    friend class CBotByteCode;
 
 public:
                 CBotLeftExpr();
@@ -873,6 +933,7 @@ class CBotExpression : public CBotInstr
 private:
     CBotLeftExpr*    m_leftop;            // left operand
     CBotInstr*        m_rightop;            // right operant
+    friend class CBotByteCode;
 
 public:
                 CBotExpression();
@@ -887,6 +948,7 @@ class CBotListExpression : public CBotInstr
 {
 private:
     CBotInstr*    m_Expr;                // the first expression to be evaluated
+    friend class CBotByteCode;
 
 public:
                 CBotListExpression();
@@ -904,6 +966,7 @@ private:
     CBotInstr*    m_op1;                // left element
     CBotInstr*    m_op2;                // right element
     friend class CBotTwoOpExpr;
+    friend class CBotByteCode;
 
 public:
                 CBotLogicExpr();
@@ -944,6 +1007,7 @@ class CBotExprUnaire : public CBotInstr
 {
 private:
     CBotInstr*    m_Expr;                // expression to be evaluated
+    friend class CBotByteCode;
 public:
                 CBotExprUnaire();
                 ~CBotExprUnaire();
@@ -960,6 +1024,7 @@ class CBotTwoOpExpr : public CBotInstr
 private:
     CBotInstr*    m_leftop;            // left element
     CBotInstr*    m_rightop;            // right element
+    friend class CBotByteCode;
 public:
                 CBotTwoOpExpr();
                 ~CBotTwoOpExpr();
@@ -991,6 +1056,7 @@ class CBotListInstr : public CBotInstr
 {
 private:
     CBotInstr*    m_Instr;            // instructions to do
+    friend class CBotByteCode;
 
 public:
                 CBotListInstr();
@@ -1010,7 +1076,9 @@ private:
 //    CBotString    m_RetClassName;        // class of the result
     CBotTypResult
                 m_typRes;            // complete type of the result
-    long        m_nFuncIdent;        // id of a function
+    std::atomic<long>
+                m_nFuncIdent;        // id of a function, run by the programs sharing the instruction
+    friend class CBotByteCode;
 
 public:
                 CBotInstrCall();
@@ -1033,7 +1101,8 @@ private:
                 m_typRes;            // complete type of the result
 
     CBotString    m_NomMethod;        // name of the method
-    long        m_MethodeIdent;        // identifier of the method
+    std::atomic<long>
+                m_MethodeIdent;        // identifier of the method, run by the programs sharing the instruction
 //    long        m_nThisIdent;        // identifier for "this"
     CBotString    m_ClassName;        // name of the class
 
@@ -1053,8 +1122,10 @@ class CBotExprVar : public CBotInstr
 {
 private:
     long        m_nIdent;
+    int         m_nSlot;            // slot of a local variable, -1 if none
     friend class CBotPostIncExpr;
     friend class CBotPreIncExpr;
+    friend class CBotByteCode;
 
 public:
                 CBotExprVar();
@@ -1076,6 +1147,7 @@ class CBotPostIncExpr : public CBotInstr
 private:
     CBotInstr*    m_Instr;
     friend class CBotParExpr;
+    friend class CBotByteCode;
 
 public:
                 CBotPostIncExpr();
@@ -1091,6 +1163,7 @@ class CBotPreIncExpr : public CBotInstr
 private:
     CBotInstr*    m_Instr;
     friend class CBotParExpr;
+    friend class CBotByteCode;
 
 public:
                 CBotPreIncExpr();
@@ -1163,7 +1236,8 @@ class CBotNew : public CBotInstr
 {
 private:
     CBotInstr*    m_Parameters;        // the parameters to be evaluated
-    long        m_nMethodeIdent;
+    std::atomic<long>
+                m_nMethodeIdent;    // run by the programs sharing the instruction
 //    long        m_nThisIdent;
     CBotToken    m_vartoken;
 
@@ -1185,6 +1259,7 @@ private:
     int            m_numtype;                    // et the type of number
     long        m_valint;                    // value for an int
     float        m_valfloat;                    // value for a float
+    friend class CBotByteCode;
 
 public:
                 CBotExprNum();
@@ -1223,6 +1298,7 @@ private:
     int            m_val;            // the value
     CBotString    m_defnum;        // the name if given by DefineNum
     friend class CBotVar;
+    friend class CBotByteCode;
 
 public:
                 CBotVarInt( const CBotToken* name );
@@ -1379,11 +1455,15 @@ private:
     CBotClass*        m_pClass;        // the class definition
     CBotVarClass*    m_pParent;        // the instance of a parent class
     CBotVar*        m_pVar;            // contents
+    CBotVar**        m_pItems;        // elements of an array by index, the first m_nItems of m_pVar
+    int                m_nItems;
+    int                m_maxItems;        // size of m_pItems
     friend class    CBotVar;        // my daddy is a buddy WHAT? :D(\TODO mon papa est un copain )
     friend class    CBotVarPointer;    // and also the pointer
-    int                m_CptUse;        // counter usage
+    std::atomic<int>    m_CptUse;        // counter usage (the instances are shared by the programs)
     long            m_ItemIdent;    // identifier (unique) of an instance
     bool            m_bConstructor;    // set if a constructor has been called
+    bool            m_bShared;        // reached through a static field, so by several programs
 
 public:
                 CBotVarClass( const CBotToken* name, const CBotTypResult& type );
@@ -1399,11 +1479,14 @@ public:
 
     CBotVar*    GetItem(int n, bool bExtend);
     CBotVar*    GetItemList();
+    int            GetItemCount();                // number of elements of an array
 
     CBotString    GetValString();
 
     bool        Save1State(FILE* pf);
     void        Maj(void* pUser, bool bContinue);
+    void        MajItem(CBotVar* pItem, void* pUser);    // updates an element used by a program
+    void        MajItems(void* pUser);                    // updates all the elements
 
     void        IncrementUse();                // a reference to incrementation
     void        DecrementUse();                // a reference to decrementation
@@ -1423,6 +1506,14 @@ public:
     bool        Ne(CBotVar* left, CBotVar* right);
 
     void        ConstructorSet();
+
+    bool        IsShared();                    // may be used by other programs?
+    static
+    void        SetShared(CBotVar* pVar);    // the instance given by the variable may be used by other programs
+
+private:
+    void        IndexItems(int n, bool bExtend);    // indexes the elements up to n
+    void        ClearItems();                        // forgets the index, when m_pVar is replaced
 };
 
 
@@ -1535,17 +1626,20 @@ private:
     CBotTypResult
                 (*m_rComp) (CBotVar* &pVar, void* pUser)    ;
     CBotCall*    m_next;
+    bool        m_bCompute;            // can be called by CBotProgram::RunCompute()
 
 public:
                 CBotCall(const char* name,
                          bool rExec (CBotVar* pVar, CBotVar* pResult, int& Exception, void* pUser),
-                         CBotTypResult rCompile (CBotVar* &pVar, void* pUser));
+                         CBotTypResult rCompile (CBotVar* &pVar, void* pUser),
+                         bool bCompute = false);
                 ~CBotCall();
 
     static
     bool        AddFunction(const char* name,
                             bool rExec (CBotVar* pVar, CBotVar* pResult, int& Exception, void* pUser),
-                            CBotTypResult rCompile (CBotVar* &pVar, void* pUser));
+                            CBotTypResult rCompile (CBotVar* &pVar, void* pUser),
+                            bool bCompute = false);
 
     static
     CBotTypResult
@@ -1612,6 +1706,7 @@ private:
     CBotTypResult    m_type;            // type of paramteter
     CBotDefParam*    m_next;            // next parameter
     long            m_nIdent;
+    friend class CBotByteCode;
 
 public:
                     CBotDefParam();
@@ -1655,15 +1750,21 @@ private:
     bool            m_bPublic;        // public function
     bool            m_bExtern;        // extern function
     CBotString        m_MasterClass;    // name of the class we derive
-    CBotProgram*    m_pProg;
+    CBotProgram*    m_pProg;        // program which compiled the function
     friend class CBotProgram;
     friend class CBotClass;
+    friend class CBotByteCode;
+    friend class CBotSharedCode;
 
     CBotToken        m_extern;        // for the position of the word "extern"
     CBotToken        m_openpar;
     CBotToken        m_closepar;
     CBotToken        m_openblk;
     CBotToken        m_closeblk;
+
+    CBotByteCode*    m_code;            // bytecode of the block, NULL if not translatable
+    bool            ExecuteBlock(CBotStack* &pj);
+    CBotProgram*    GetProg(CBotProgram* pCurrent);    // program running the function called from pCurrent
 public:
                     CBotFunction();
                     ~CBotFunction();
@@ -1696,3 +1797,190 @@ public:
     bool            GetPosition(int& start, int& stop, CBotGet modestart, CBotGet modestop);
 };
 
+
+////////////////////////////////////////////////////////////////////////
+// Functions shared by the programs compiled from the same text
+////////////////////////////////////////////////////////////////////////
+
+// the instructions do not change once compiled, all the state of the
+// execution is on the stack of each program; so the programs given the
+// same text in the same context (see CBotProgram::CompileShared) keep a
+// single list of functions; the first program which uses them is the one
+// which compiled them for the others (CBotFunction::m_pProg)
+
+class CBotSharedCode
+{
+private:
+    static
+    std::multimap<unsigned long, CBotSharedCode*>
+                    m_codes;        // all the shared functions by hash of their text
+
+    CBotString      m_text;         // text compiled
+    long            m_context;
+    unsigned long   m_hash;
+    CBotFunction*   m_Prog;         // the functions
+    CBotStringArray m_extern;       // names of the functions declared as extern
+    std::vector<CBotProgram*>
+                    m_users;        // programs running the functions
+
+                    CBotSharedCode(const char* text, long context, unsigned long hash);
+                    ~CBotSharedCode();
+    void            SetOwner(CBotProgram* p);
+
+public:
+    static
+    unsigned long   Hash(const char* text, long context);
+    static
+    CBotSharedCode* Find(const char* text, long context);
+    static
+    CBotSharedCode* Add(const char* text, long context, CBotProgram* p, CBotStringArray& ListFonctions);
+    // takes the functions compiled by p
+    static
+    int             GetCount();
+
+    void            AddUser(CBotProgram* p);
+    void            RemoveUser(CBotProgram* p);     // deletes the functions with the last one
+    CBotFunction*   GetFunctions();
+    void            GetExtern(CBotStringArray& ListFonctions);
+};
+
+
+////////////////////////////////////////////////////////////////////////
+// Bytecode of the functions
+////////////////////////////////////////////////////////////////////////
+
+// the tree of instructions of a function can be translated into
+// a flat list of operations working on a stack of values;
+// it runs without allocating a CBotStack level and a CBotVar
+// for each instruction, but only knows the simple types
+
+// operations of the virtual machine
+
+enum CBotByteOpCode
+{
+    BC_CONST,           // pushes the constant m_arg
+    BC_LOAD,            // pushes the variable m_arg, error if not initialized
+    BC_LOADRAW,         // pushes the variable m_arg as it is
+    BC_STORE,           // assigns the value to the variable m_arg
+    BC_DECL,            // declares the variable m_arg, not initialized
+    BC_COMPOUND,        // operation m_op between the variable m_arg and the value
+    BC_PREINC,          // increments the variable m_arg (m_op) then pushes it
+    BC_POSTINC,         // pushes the variable m_arg then increments it (m_op)
+    BC_BINARY,          // operation m_op between the two last values
+    BC_UNARY,           // operation m_op on the last value
+    BC_ANDTEST,         // gives false and jumps to m_arg if the value is false
+    BC_ORTEST,          // gives true and jumps to m_arg if the value is true
+    BC_POP,             // removes the last value
+    BC_JUMP,            // continues at m_arg
+    BC_JUMPF,           // removes the condition, continues at m_arg if false
+    BC_CALL,            // calls the routine m_arg with m_op parameters
+    BC_RETURN,          // returns the last value
+    BC_END              // returns without value
+};
+
+// a value on the stack of the virtual machine
+
+class CBotByteValue
+{
+public:
+    int            m_type;            // CBotTypInt, CBotTypFloat, CBotTypBoolean or CBotTypString
+    int            m_binit;        // IS_UNDEF, IS_DEF or IS_NAN
+    int            m_val;            // value of an int or a boolean
+    float        m_fval;            // value of a float
+    CBotString    m_sval;            // value of a string, or name given by DefineNum to an int
+};
+
+// an operation
+
+class CBotByteOp
+{
+public:
+    int            m_code;            // CBotByteOpCode
+    int            m_arg;
+    int            m_op;
+    bool        m_bKeep;        // leaves the assigned variable on the stack
+    CBotInstr*    m_instr;        // instruction of origin, for the position when suspended
+    CBotToken*    m_token;        // where errors are reported
+};
+
+// execution state of a function, kept on its level of the stack
+
+class CBotByteState
+{
+public:
+    int            m_pc;            // next operation
+    int            m_sp;            // number of values on the stack
+    std::vector<CBotByteValue>
+                m_stack;
+    std::vector<CBotByteValue>
+                m_locals;        // parameters and variables
+
+    void        Save(CBotVar* &pStack, CBotVar* &pLocals);
+    void        Restore(int pc, CBotVar* pStack, CBotVar* pLocals);
+};
+
+class CBotByteCode
+{
+private:
+    static
+    bool        m_bEnable;        // CBotProgram::SetByteCode()
+
+    CBotFunction*
+                m_func;
+    std::vector<CBotByteOp>
+                m_ops;
+    std::vector<CBotByteValue>
+                m_consts;
+    std::vector<int>
+                m_types;        // type of each variable
+    int            m_nParams;        // the first variables are the parameters
+    int            m_maxStack;        // depth of the stack of values
+    std::vector<CBotInstrCall*>
+                m_calls;
+
+    // translation
+    std::map<long, int>
+                m_slots;        // variable number of each identifier
+    int            m_depth;
+    int            m_target;        // last destination of a jump
+    struct Loop
+    {
+        CBotString          label;
+        std::vector<int>    breaks;
+        std::vector<int>    continues;
+    };
+    std::vector<Loop>
+                m_loops;
+
+                CBotByteCode(CBotFunction* func);
+    int            Emit(int code, CBotInstr* instr, int arg = 0, int op = 0, CBotToken* token = NULL);
+    void        Push(int n);
+    int            AddConst(const CBotByteValue& value);
+    int            AddSlot(long ident, int type);
+    int            FindSlot(CBotInstr* instr, long ident);
+    bool        CompileList(CBotInstr* p);
+    bool        CompileInstr(CBotInstr* p);
+    bool        CompileDecl(CBotInstr* p, CBotInstr* var, CBotInstr* expr);
+    bool        CompileLoop(CBotInstr* p, const CBotString& label);
+    bool        CompileExpr(CBotInstr* p);
+    void        Patch(std::vector<int>& list, int target);
+
+    // execution
+    static
+    CBotVar*    MakeVar(const CBotByteValue& value);
+    static
+    void        MakeValue(CBotByteValue& value, CBotVar* var);
+    bool        DoCall(CBotStack* pile, CBotByteState* vm, const CBotByteOp& op);
+
+    friend class CBotByteState;
+    friend class CBotProgram;
+
+public:
+    static
+    CBotByteCode*    Compile(CBotFunction* func);
+    static
+    bool        IsRunning(CBotStack* pj);
+    bool        Accept(CBotStack* pj);
+    bool        Execute(CBotStack* &pj);
+    void        RestoreState(CBotStack* &pj);
+};
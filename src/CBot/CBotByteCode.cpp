@@ -0,0 +1,1255 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+///////////////////////////////////////////////////////////////////////
+// translation of the functions into bytecode and its execution
+//
+// a function is translated if it is not a method and only uses
+// variables of simple types (int, float, boolean, string), declared
+// locally, with instructions if, while, do, for, break, continue
+// and return; the others keep running through the tree
+//
+// the operations give exactly the same results as the instructions
+// (see CBotTwoOpExpr::Execute, CBotExpression::Execute, CBotVarInt...),
+// including their errors and oddities; only a recursion goes deeper
+// before TX_STACKOVER, as a function takes fewer levels of the stack
+
+#include "CBot.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+
+
+bool CBotByteCode::m_bEnable = false;
+
+
+// a value not initialized of the given type
+
+static void Clear(CBotByteValue& value, int type)
+{
+    value.m_type  = type;
+    value.m_binit = IS_UNDEF;
+    value.m_val   = 0;
+    value.m_fval  = 0.0f;
+    if ( !value.m_sval.IsEmpty() ) value.m_sval.Empty();
+}
+
+// reading of a value, as CBotVar::GetValInt() and others
+
+static int GetValInt(const CBotByteValue& value)
+{
+    if ( value.m_type == CBotTypFloat ) return static_cast<int>(value.m_fval);
+    if ( value.m_type == CBotTypString ) return 0;
+    return value.m_val;
+}
+
+static float GetValFloat(const CBotByteValue& value)
+{
+    if ( value.m_type == CBotTypFloat ) return value.m_fval;
+    if ( value.m_type == CBotTypString ) return 0.0f;
+    return static_cast<float>(value.m_val);
+}
+
+static CBotString GetValString(const CBotByteValue& value)
+{
+    CBotString  res;
+
+    if ( value.m_type == CBotTypInt && !value.m_sval.IsEmpty() ) return value.m_sval;
+
+    if ( !value.m_binit )
+    {
+        res.LoadString(TX_UNDEF);
+        return res;
+    }
+    if ( value.m_binit == IS_NAN )
+    {
+        res.LoadString(TX_NAN);
+        return res;
+    }
+
+    char        buffer[300];
+    switch ( value.m_type )
+    {
+    case CBotTypInt:
+        sprintf(buffer, "%d", value.m_val);
+        res = buffer;
+        break;
+    case CBotTypFloat:
+        sprintf(buffer, "%.2f", value.m_fval);
+        res = buffer;
+        break;
+    case CBotTypBoolean:
+        res.LoadString( value.m_val > 0 ? ID_TRUE : ID_FALSE );
+        break;
+    default:
+        res = value.m_sval;
+    }
+    return res;
+}
+
+// writing in a value of a given type, as CBotVar::SetValInt() and others
+
+static void SetValInt(CBotByteValue& value, int val)
+{
+    if ( value.m_type == CBotTypFloat ) value.m_fval = static_cast<float>(val);
+    else if ( value.m_type == CBotTypBoolean ) value.m_val = (val != 0);
+    else if ( value.m_type == CBotTypInt )
+    {
+        value.m_val = val;
+        if ( !value.m_sval.IsEmpty() ) value.m_sval.Empty();    // no more a named value
+    }
+    value.m_binit = IS_DEF;
+}
+
+static void SetValFloat(CBotByteValue& value, float val)
+{
+    if ( value.m_type == CBotTypFloat ) value.m_fval = val;
+    else if ( value.m_type == CBotTypBoolean ) value.m_val = (val != 0);
+    else if ( value.m_type == CBotTypInt ) value.m_val = static_cast<int>(val);
+    value.m_binit = IS_DEF;
+}
+
+// assignment with conversion, as CBotVar::SetVal()
+
+static void Assign(CBotByteValue& var, const CBotByteValue& src)
+{
+    switch ( src.m_type )
+    {
+    case CBotTypBoolean:
+        SetValInt(var, src.m_val);
+        break;
+    case CBotTypInt:
+        SetValInt(var, src.m_val);
+        if ( var.m_type == CBotTypInt && !src.m_sval.IsEmpty() ) var.m_sval = src.m_sval;
+        break;
+    case CBotTypFloat:
+        SetValFloat(var, src.m_fval);
+        break;
+    case CBotTypString:
+        if ( var.m_type == CBotTypString ) var.m_sval = GetValString(src);
+        break;
+    }
+    var.m_binit = src.m_binit;          // copies the nan state if any
+}
+
+// is one of the operands not a number?
+
+static bool IsNan(const CBotByteValue& left, const CBotByteValue& right)
+{
+    return left.m_binit > IS_DEF || right.m_binit > IS_DEF;
+}
+
+// puts in result (whose type is given) the operation between left and right,
+// as CBotVarInt::Add(), CBotVarFloat::Div() and others;
+// gives an error number, or 0
+
+static int Compute(CBotByteValue& result, int op, const CBotByteValue& left, const CBotByteValue& right)
+{
+    bool    bFloat = ( result.m_type == CBotTypFloat );
+    bool    bBool  = ( result.m_type == CBotTypBoolean );
+    int     val = 0;
+
+    switch ( op )
+    {
+    case ID_ADD:
+        if ( result.m_type == CBotTypString )
+        {
+            result.m_sval = GetValString(left) + GetValString(right);
+            result.m_binit = IS_DEF;
+            return 0;
+        }
+        if ( bFloat ) result.m_fval = GetValFloat(left) + GetValFloat(right);
+        else          val = GetValInt(left) + GetValInt(right);
+        break;
+    case ID_SUB:
+        if ( bFloat ) result.m_fval = GetValFloat(left) - GetValFloat(right);
+        else          val = GetValInt(left) - GetValInt(right);
+        break;
+    case ID_MUL:
+        if ( bFloat ) result.m_fval = GetValFloat(left) * GetValFloat(right);
+        else          val = GetValInt(left) * GetValInt(right);
+        break;
+    case ID_POWER:
+        if ( bFloat ) result.m_fval = static_cast<float>(pow( GetValFloat(left) , GetValFloat(right) ));
+        else          val = static_cast<int>( pow( static_cast<double>( GetValInt(left)) , static_cast<double>( GetValInt(left)) ));
+        break;
+    case ID_DIV:
+        if ( bFloat )
+        {
+            float   r = GetValFloat(right);
+            if ( r == 0 ) return TX_DIVZERO;
+            result.m_fval = GetValFloat(left) / r;
+        }
+        else
+        {
+            int     r = GetValInt(right);
+            if ( r == 0 ) return TX_DIVZERO;
+            val = GetValInt(left) / r;
+        }
+        break;
+    case ID_MODULO:
+        if ( bFloat )
+        {
+            float   r = GetValFloat(right);
+            if ( r == 0 ) return TX_DIVZERO;
+            result.m_fval = static_cast<float>(fmod( GetValFloat(left) , r ));
+        }
+        else
+        {
+            int     r = GetValInt(right);
+            if ( r == 0 ) return TX_DIVZERO;
+            val = GetValInt(left) % r;
+        }
+        break;
+    case ID_TXT_AND:
+    case ID_LOG_AND:
+    case ID_AND:
+        if ( bBool ) val = GetValInt(left) && GetValInt(right);
+        else         val = GetValInt(left) & GetValInt(right);
+        break;
+    case ID_TXT_OR:
+    case ID_LOG_OR:
+    case ID_OR:
+        if ( bBool ) val = GetValInt(left) || GetValInt(right);
+        else         val = GetValInt(left) | GetValInt(right);
+        break;
+    case ID_XOR:
+        val = GetValInt(left) ^ GetValInt(right);
+        break;
+    case ID_SL:
+        val = GetValInt(left) << GetValInt(right);
+        break;
+    case ID_ASR:
+        val = GetValInt(left) >> GetValInt(right);
+        break;
+    case ID_SR:
+        {
+            int     source = GetValInt(left);
+            int     shift  = GetValInt(right);
+            if (shift>=1) source &= 0x7fffffff;
+            val = source >> shift;
+        }
+        break;
+    default:
+        assert(0);
+    }
+
+    if ( !bFloat ) result.m_val = bBool ? (val != 0) : val;
+    result.m_binit = IS_DEF;
+    return 0;
+}
+
+// comparison in the given type, as CBotVarInt::Lo() and others
+
+static bool Compare(int op, int type, const CBotByteValue& left, const CBotByteValue& right)
+{
+    if ( type == CBotTypString )
+    {
+        if ( op == ID_NE ) return GetValString(left) != GetValString(right);
+        return GetValString(left) == GetValString(right);       // also for < > <= >=
+    }
+
+    if ( type == CBotTypFloat )
+    {
+        float   l = GetValFloat(left);
+        float   r = GetValFloat(right);
+        switch ( op )
+        {
+        case ID_LO: return l <  r;
+        case ID_HI: return l >  r;
+        case ID_LS: return l <= r;
+        case ID_HS: return l >= r;
+        case ID_EQ: return l == r;
+        default:    return l != r;
+        }
+    }
+
+    int     l = GetValInt(left);
+    int     r = GetValInt(right);
+    switch ( op )
+    {
+    case ID_LO: return l <  r;
+    case ID_HI: return l >  r;
+    case ID_LS: return l <= r;
+    case ID_HS: return l >= r;
+    case ID_EQ: return l == r;
+    default:    return l != r;
+    }
+}
+
+// operation with two operands, as CBotTwoOpExpr::Execute()
+// the result replaces left
+
+static int Operation(int op, CBotByteValue& left, const CBotByteValue& right)
+{
+    int     type1 = left.m_type;
+    int     type2 = right.m_type;
+
+    // what kind of result?
+    int     typeRes = MAX(type1, type2);
+    if ( op == ID_ADD && type1 == CBotTypString ) typeRes = CBotTypString;
+
+    // type to perform the calculation
+    int     typeTemp = typeRes;
+
+    switch ( op )
+    {
+    case ID_LOG_OR:
+    case ID_LOG_AND:
+    case ID_TXT_OR:
+    case ID_TXT_AND:
+    case ID_EQ:
+    case ID_NE:
+    case ID_HI:
+    case ID_LO:
+    case ID_HS:
+    case ID_LS:
+        typeRes = CBotTypBoolean;
+        break;
+    case ID_DIV:
+        typeRes = MAX(typeRes, CBotTypFloat);
+    }
+
+    CBotByteValue   result;
+    Clear(result, typeRes);
+    int     err = 0;
+
+    switch ( op )
+    {
+    case ID_EQ:
+    case ID_NE:
+        if ( IsNan(left, right) )
+            result.m_val = ( op == ID_EQ ) == ( left.m_binit == right.m_binit );
+        else
+            result.m_val = Compare(op, typeTemp, left, right);
+        result.m_binit = IS_DEF;
+        break;
+    case ID_LO:
+    case ID_HI:
+    case ID_LS:
+    case ID_HS:
+        if ( IsNan(left, right) ) err = TX_OPNAN;
+        else
+        {
+            result.m_val = Compare(op, typeTemp, left, right);
+            result.m_binit = IS_DEF;
+        }
+        break;
+    default:
+        if ( IsNan(left, right) ) err = TX_OPNAN;
+        else err = Compute(result, op, left, right);
+    }
+
+    left = result;
+    return err;
+}
+
+
+///////////////////////////////////////////////////////////////////////
+// translation
+
+CBotByteCode::CBotByteCode(CBotFunction* func)
+{
+    m_func     = func;
+    m_nParams  = 0;
+    m_maxStack = 1;
+    m_depth    = 0;
+    m_target   = -1;
+}
+
+// translates a function, gives NULL if it uses something unknown to the bytecode
+
+CBotByteCode* CBotByteCode::Compile(CBotFunction* func)
+{
+    if ( !func->m_MasterClass.IsEmpty() || func->m_bSynchro ) return NULL;
+    if ( func->m_Block == NULL ) return NULL;
+
+    CBotByteCode*   code = new CBotByteCode(func);
+
+    // the parameters are the first variables
+    for ( CBotDefParam* p = func->m_Param ; p != NULL ; p = p->m_next )
+    {
+        if ( code->AddSlot(p->m_nIdent, p->m_type.GetType()) < 0 )
+        {
+            delete code;
+            return NULL;
+        }
+        code->m_nParams++;
+    }
+
+    if ( !code->CompileInstr(func->m_Block) )
+    {
+        delete code;
+        return NULL;
+    }
+    code->Emit(BC_END, func->m_Block);
+
+    code->m_slots.clear();
+    code->m_loops.clear();
+    return code;
+}
+
+int CBotByteCode::Emit(int code, CBotInstr* instr, int arg, int op, CBotToken* token)
+{
+    CBotByteOp  o;
+    o.m_code  = code;
+    o.m_arg   = arg;
+    o.m_op    = op;
+    o.m_bKeep = true;
+    o.m_instr = instr;
+    o.m_token = ( token != NULL ) ? token : instr->GetToken();
+
+    // an assignment followed by a removal leaves nothing
+    if ( code == BC_POP && !m_ops.empty() && m_target < static_cast<int>(m_ops.size()) )
+    {
+        CBotByteOp& last = m_ops.back();
+        if ( last.m_code == BC_STORE || last.m_code == BC_COMPOUND ||
+             last.m_code == BC_PREINC || last.m_code == BC_POSTINC )
+        {
+            if ( last.m_bKeep )
+            {
+                last.m_bKeep = false;
+                return m_ops.size()-1;
+            }
+        }
+    }
+
+    m_ops.push_back(o);
+    return m_ops.size()-1;
+}
+
+// notes the change of the number of values on the stack
+
+void CBotByteCode::Push(int n)
+{
+    m_depth += n;
+    if ( m_depth > m_maxStack ) m_maxStack = m_depth;
+}
+
+int CBotByteCode::AddConst(const CBotByteValue& value)
+{
+    m_consts.push_back(value);
+    return m_consts.size()-1;
+}
+
+int CBotByteCode::AddSlot(long ident, int type)
+{
+    if ( type != CBotTypInt && type != CBotTypFloat &&
+         type != CBotTypBoolean && type != CBotTypString ) return -1;
+
+    int     slot = m_types.size();
+    m_types.push_back(type);
+    m_slots[ident] = slot;
+    return slot;
+}
+
+// variable of an instruction, -1 if not a simple local variable
+
+int CBotByteCode::FindSlot(CBotInstr* instr, long ident)
+{
+    if ( instr->m_next3 != NULL ) return -1;           // field or index
+
+    std::map<long, int>::iterator it = m_slots.find(ident);
+    if ( it == m_slots.end() ) return -1;
+    return it->second;
+}
+
+void CBotByteCode::Patch(std::vector<int>& list, int target)
+{
+    for ( unsigned int i = 0 ; i < list.size() ; i++ ) m_ops[list[i]].m_arg = target;
+    if ( target > m_target ) m_target = target;
+}
+
+// a list of instructions
+
+bool CBotByteCode::CompileList(CBotInstr* p)
+{
+    for ( ; p != NULL ; p = p->GetNext() )
+    {
+        if ( !CompileInstr(p) ) return false;
+    }
+    return true;
+}
+
+// an instruction, which leaves nothing on the stack
+
+bool CBotByteCode::CompileInstr(CBotInstr* p)
+{
+    if ( p->IsOfClass("CBotListInstr") )
+    {
+        return CompileList((static_cast<CBotListInstr*>(p))->m_Instr);
+    }
+
+    if ( p->IsOfClass("CBotListExpression") )
+    {
+        return CompileList((static_cast<CBotListExpression*>(p))->m_Expr);
+    }
+
+    if ( p->IsOfClass("CBotInt") )
+    {
+        CBotInt*    inst = static_cast<CBotInt*>(p);
+        return CompileDecl(p, inst->m_var, inst->m_expr);
+    }
+    if ( p->IsOfClass("CBotFloat") )
+    {
+        CBotFloat*  inst = static_cast<CBotFloat*>(p);
+        return CompileDecl(p, inst->m_var, inst->m_expr);
+    }
+    if ( p->IsOfClass("CBotBoolean") )
+    {
+        CBotBoolean*    inst = static_cast<CBotBoolean*>(p);
+        return CompileDecl(p, inst->m_var, inst->m_expr);
+    }
+    if ( p->IsOfClass("CBotIString") )
+    {
+        CBotIString*    inst = static_cast<CBotIString*>(p);
+        return CompileDecl(p, inst->m_var, inst->m_expr);
+    }
+
+    if ( p->IsOfClass("CBotIf") )
+    {
+        CBotIf*     inst = static_cast<CBotIf*>(p);
+
+        if ( !CompileExpr(inst->m_Condition) ) return false;
+        std::vector<int>    jumpElse(1, Emit(BC_JUMPF, p));
+        Push(-1);
+
+        if ( inst->m_Block != NULL && !CompileInstr(inst->m_Block) ) return false;
+
+        if ( inst->m_BlockElse != NULL )
+        {
+            std::vector<int>    jumpEnd(1, Emit(BC_JUMP, p));
+            Patch(jumpElse, m_ops.size());
+            if ( !CompileInstr(inst->m_BlockElse) ) return false;
+            Patch(jumpEnd, m_ops.size());
+        }
+        else
+        {
+            Patch(jumpElse, m_ops.size());
+        }
+        return true;
+    }
+
+    if ( p->IsOfClass("CBotWhile") )
+    {
+        return CompileLoop(p, (static_cast<CBotWhile*>(p))->m_label);
+    }
+    if ( p->IsOfClass("CBotDo") )
+    {
+        return CompileLoop(p, (static_cast<CBotDo*>(p))->m_label);
+    }
+    if ( p->IsOfClass("CBotFor") )
+    {
+        return CompileLoop(p, (static_cast<CBotFor*>(p))->m_label);
+    }
+
+    if ( p->IsOfClass("CBotBreak") )
+    {
+        CBotString  label = (static_cast<CBotBreak*>(p))->m_label;
+
+        // which loop? the last one, or the one with the label
+        for ( int i = m_loops.size()-1 ; i >= 0 ; i-- )
+        {
+            if ( !label.IsEmpty() && m_loops[i].label != label ) continue;
+
+            int     jump = Emit(BC_JUMP, p);
+            if ( p->GetTokenType() == ID_BREAK ) m_loops[i].breaks.push_back(jump);
+            else                                  m_loops[i].continues.push_back(jump);
+            return true;
+        }
+        return false;
+    }
+
+    if ( p->IsOfClass("CBotReturn") )
+    {
+        CBotInstr*  expr = (static_cast<CBotReturn*>(p))->m_Instr;
+        if ( expr == NULL )
+        {
+            Emit(BC_END, p);
+            return true;
+        }
+        if ( !CompileExpr(expr) ) return false;
+        Emit(BC_RETURN, p);
+        Push(-1);
+        return true;
+    }
+
+    // an expression whose result is not used
+    int     depth = m_depth;
+    if ( !CompileExpr(p) ) return false;
+    if ( m_depth > depth )
+    {
+        Emit(BC_POP, p);
+        Push(-1);
+    }
+    return m_depth == depth;
+}
+
+// declaration of a variable, and of the following ones
+
+bool CBotByteCode::CompileDecl(CBotInstr* p, CBotInstr* var, CBotInstr* expr)
+{
+    if ( !var->IsOfClass("CBotLeftExprVar") ) return false;
+    CBotLeftExprVar*    v = static_cast<CBotLeftExprVar*>(var);
+
+    int     slot = AddSlot(v->m_nIdent, v->m_typevar.GetType());
+    if ( slot < 0 ) return false;
+
+    Emit(BC_DECL, p, slot);
+    if ( expr != NULL )
+    {
+        if ( !CompileExpr(expr) ) return false;
+        Emit(BC_STORE, p, slot);
+        Emit(BC_POP, p);
+        Push(-1);
+    }
+
+    if ( p->m_next2b != NULL ) return CompileInstr(p->m_next2b);  // other(s) definition(s)
+    return true;
+}
+
+// loops while, do and for
+
+bool CBotByteCode::CompileLoop(CBotInstr* p, const CBotString& label)
+{
+    Loop    loop;
+    loop.label = label;
+    m_loops.push_back(loop);
+
+    std::vector<int>    exits;
+    int                 next;       // where a "continue" goes
+
+    if ( p->IsOfClass("CBotWhile") )
+    {
+        CBotWhile*  inst = static_cast<CBotWhile*>(p);
+
+        next = m_ops.size();
+        if ( !CompileExpr(inst->m_Condition) ) return false;
+        exits.push_back(Emit(BC_JUMPF, p));
+        Push(-1);
+        if ( inst->m_Block != NULL && !CompileInstr(inst->m_Block) ) return false;
+        Emit(BC_JUMP, p, next);
+    }
+    else if ( p->IsOfClass("CBotDo") )
+    {
+        CBotDo*     inst = static_cast<CBotDo*>(p);
+
+        int     start = m_ops.size();
+        if ( inst->m_Block != NULL && !CompileInstr(inst->m_Block) ) return false;
+        next = m_ops.size();
+        if ( !CompileExpr(inst->m_Condition) ) return false;
+        exits.push_back(Emit(BC_JUMPF, p));
+        Push(-1);
+        Emit(BC_JUMP, p, start);
+    }
+    else
+    {
+        CBotFor*    inst = static_cast<CBotFor*>(p);
+
+        if ( inst->m_Init != NULL && !CompileInstr(inst->m_Init) ) return false;
+        int     start = m_ops.size();
+        if ( inst->m_Test != NULL )                     // no test means true
+        {
+            if ( !CompileExpr(inst->m_Test) ) return false;
+            exits.push_back(Emit(BC_JUMPF, p));
+            Push(-1);
+        }
+        if ( inst->m_Block != NULL && !CompileInstr(inst->m_Block) ) return false;
+        next = m_ops.size();
+        if ( inst->m_Incr != NULL && !CompileInstr(inst->m_Incr) ) return false;
+        Emit(BC_JUMP, p, start);
+    }
+
+    // the jumps out of the loop have their destination now
+    Patch(m_loops.back().continues, next);
+    Patch(exits, m_ops.size());
+    Patch(m_loops.back().breaks, m_ops.size());
+
+    m_loops.pop_back();
+    return true;
+}
+
+// an expression, which leaves its value on the stack
+
+bool CBotByteCode::CompileExpr(CBotInstr* p)
+{
+    if ( p == NULL ) return false;
+
+    CBotByteValue   value;
+
+    if ( p->IsOfClass("CBotExprNum") )
+    {
+        CBotExprNum*    inst = static_cast<CBotExprNum*>(p);
+
+        if ( inst->m_numtype == CBotTypFloat )
+        {
+            Clear(value, CBotTypFloat);
+            value.m_fval = inst->m_valfloat;
+        }
+        else
+        {
+            Clear(value, CBotTypInt);
+            value.m_val = inst->m_valint;
+            if ( p->GetTokenType() == TokenTypDef ) value.m_sval = p->GetToken()->GetString();
+        }
+        value.m_binit = IS_DEF;
+        Emit(BC_CONST, p, AddConst(value));
+        Push(1);
+        return true;
+    }
+
+    if ( p->IsOfClass("CBotExprAlpha") )
+    {
+        CBotString  chaine = p->GetToken()->GetString();
+        Clear(value, CBotTypString);
+        value.m_sval  = chaine.Mid(1, chaine.GetLength()-2);    // removes the quotes
+        value.m_binit = IS_DEF;
+        Emit(BC_CONST, p, AddConst(value));
+        Push(1);
+        return true;
+    }
+
+    if ( p->IsOfClass("CBotExprBool") )
+    {
+        Clear(value, CBotTypBoolean);
+        value.m_val   = ( p->GetTokenType() == ID_TRUE );
+        value.m_binit = IS_DEF;
+        Emit(BC_CONST, p, AddConst(value));
+        Push(1);
+        return true;
+    }
+
+    if ( p->IsOfClass("CBotExprNan") )
+    {
+        Clear(value, CBotTypInt);
+        value.m_binit = IS_NAN;
+        Emit(BC_CONST, p, AddConst(value));
+        Push(1);
+        return true;
+    }
+
+    if ( p->IsOfClass("CBotExprVar") )
+    {
+        int     slot = FindSlot(p, (static_cast<CBotExprVar*>(p))->m_nIdent);
+        if ( slot < 0 ) return false;
+
+        CBotToken*  pt = p->GetToken();                 // error on the last token
+        while (pt->GetNext() != NULL) pt = pt->GetNext();
+        Emit(BC_LOAD, p, slot, 0, pt);
+        Push(1);
+        return true;
+    }
+
+    if ( p->IsOfClass("CBotExpression") )
+    {
+        CBotExpression* inst = static_cast<CBotExpression*>(p);
+        int     slot = FindSlot(inst->m_leftop, inst->m_leftop->m_nIdent);
+        if ( slot < 0 ) return false;
+
+        int     op;
+        switch ( p->GetTokenType() )
+        {
+        case ID_ASS:
+            if ( !CompileExpr(inst->m_rightop) ) return false;
+            Emit(BC_STORE, p, slot);
+            return true;
+        case ID_ASSADD:     op = ID_ADD;    break;
+        case ID_ASSSUB:     op = ID_SUB;    break;
+        case ID_ASSMUL:     op = ID_MUL;    break;
+        case ID_ASSDIV:     op = ID_DIV;    break;
+        case ID_ASSMODULO:  op = ID_MODULO; break;
+        case ID_ASSAND:     op = ID_AND;    break;
+        case ID_ASSXOR:     op = ID_XOR;    break;
+        case ID_ASSOR:      op = ID_OR;     break;
+        case ID_ASSSL:      op = ID_SL;     break;
+        case ID_ASSSR:      op = ID_SR;     break;
+        case ID_ASSASR:     op = ID_ASR;    break;
+        default:
+            return false;
+        }
+
+        // the variable is taken before the value on the right
+        Emit(BC_LOADRAW, p, slot);
+        Push(1);
+        if ( !CompileExpr(inst->m_rightop) ) return false;
+        Emit(BC_COMPOUND, p, slot, op, inst->m_leftop->GetToken());
+        Push(-1);
+        return true;
+    }
+
+    if ( p->IsOfClass("CBotTwoOpExpr") )
+    {
+        CBotTwoOpExpr*  inst = static_cast<CBotTwoOpExpr*>(p);
+        int     op = p->GetTokenType();
+
+        if ( !CompileExpr(inst->m_leftop) ) return false;
+
+        // for OR and AND logic does not evaluate the second expression if not necessary
+        std::vector<int>    jumpEnd;
+        if ( op == ID_LOG_AND || op == ID_TXT_AND ) jumpEnd.push_back(Emit(BC_ANDTEST, p));
+        if ( op == ID_LOG_OR  || op == ID_TXT_OR  ) jumpEnd.push_back(Emit(BC_ORTEST, p));
+
+        if ( !CompileExpr(inst->m_rightop) ) return false;
+        Emit(BC_BINARY, p, 0, op);
+        Push(-1);
+        Patch(jumpEnd, m_ops.size());
+        return true;
+    }
+
+    if ( p->IsOfClass("CBotLogicExpr") )
+    {
+        CBotLogicExpr*  inst = static_cast<CBotLogicExpr*>(p);
+
+        if ( !CompileExpr(inst->m_condition) ) return false;
+        std::vector<int>    jumpElse(1, Emit(BC_JUMPF, p));
+        Push(-1);
+        if ( !CompileExpr(inst->m_op1) ) return false;
+        std::vector<int>    jumpEnd(1, Emit(BC_JUMP, p));
+        Push(-1);
+        Patch(jumpElse, m_ops.size());
+        if ( !CompileExpr(inst->m_op2) ) return false;
+        Patch(jumpEnd, m_ops.size());
+        return true;
+    }
+
+    if ( p->IsOfClass("CBotExprUnaire") )
+    {
+        if ( !CompileExpr((static_cast<CBotExprUnaire*>(p))->m_Expr) ) return false;
+        Emit(BC_UNARY, p, 0, p->GetTokenType());
+        return true;
+    }
+
+    if ( p->IsOfClass("CBotPostIncExpr") || p->IsOfClass("CBotPreIncExpr") )
+    {
+        CBotInstr*  var = p->IsOfClass("CBotPostIncExpr") ?
+                          (static_cast<CBotPostIncExpr*>(p))->m_Instr :
+                          (static_cast<CBotPreIncExpr*>(p))->m_Instr;
+        if ( !var->IsOfClass("CBotExprVar") ) return false;
+
+        int     slot = FindSlot(var, (static_cast<CBotExprVar*>(var))->m_nIdent);
+        if ( slot < 0 ) return false;
+
+        Emit(p->IsOfClass("CBotPostIncExpr") ? BC_POSTINC : BC_PREINC, p, slot, p->GetTokenType());
+        Push(1);
+        return true;
+    }
+
+    if ( p->IsOfClass("CBotInstrCall") )
+    {
+        CBotInstrCall*  inst = static_cast<CBotInstrCall*>(p);
+
+        int     type = inst->m_typRes.GetType();
+        if ( type != CBotTypVoid && type != CBotTypInt && type != CBotTypFloat &&
+             type != CBotTypBoolean && type != CBotTypString ) return false;
+
+        int     n = 0;
+        for ( CBotInstr* param = inst->m_Parameters ; param != NULL ; param = param->GetNext() )
+        {
+            int     depth = m_depth;
+            if ( !CompileExpr(param) ) return false;
+            if ( m_depth != depth+1 ) return false;     // a parameter without value
+            n++;
+        }
+
+        m_calls.push_back(inst);
+        Emit(BC_CALL, p, m_calls.size()-1, n);
+        Push(-n);
+        if ( type != CBotTypVoid ) Push(1);
+        return true;
+    }
+
+    return false;
+}
+
+
+///////////////////////////////////////////////////////////////////////
+// execution
+
+// variable having a value, to give to a routine or to save
+
+CBotVar* CBotByteCode::MakeVar(const CBotByteValue& value)
+{
+    CBotVar*    var = CBotVar::Create("", CBotTypResult(value.m_type));
+
+    switch ( value.m_type )
+    {
+    case CBotTypInt:
+        var->SetValInt(value.m_val, value.m_sval);
+        break;
+    case CBotTypFloat:
+        var->SetValFloat(value.m_fval);
+        break;
+    case CBotTypBoolean:
+        var->SetValInt(value.m_val);
+        break;
+    case CBotTypString:
+        var->SetValString(value.m_sval);
+        break;
+    }
+    var->SetInit(value.m_binit);
+    return var;
+}
+
+void CBotByteCode::MakeValue(CBotByteValue& value, CBotVar* var)
+{
+    Clear(value, var->GetType());
+
+    switch ( value.m_type )
+    {
+    case CBotTypInt:
+        value.m_val  = var->GetValInt();
+        value.m_sval = (static_cast<CBotVarInt*>(var))->m_defnum;
+        break;
+    case CBotTypFloat:
+        value.m_fval = var->GetValFloat();
+        break;
+    case CBotTypBoolean:
+        value.m_val  = var->GetValInt();
+        break;
+    case CBotTypString:
+        if ( var->GetInit() == IS_DEF ) value.m_sval = var->GetValString();
+        break;
+    }
+    value.m_binit = var->GetInit();
+}
+
+void CBotByteState::Save(CBotVar* &pStack, CBotVar* &pLocals)
+{
+    pStack = NULL;
+    for ( int i = 0 ; i < m_sp ; i++ )
+    {
+        CBotVar*    var = CBotByteCode::MakeVar(m_stack[i]);
+        if ( pStack == NULL ) pStack = var;
+        else pStack->AddNext(var);
+    }
+
+    pLocals = NULL;
+    for ( unsigned int i = 0 ; i < m_locals.size() ; i++ )
+    {
+        CBotVar*    var = CBotByteCode::MakeVar(m_locals[i]);
+        if ( pLocals == NULL ) pLocals = var;
+        else pLocals->AddNext(var);
+    }
+}
+
+void CBotByteState::Restore(int pc, CBotVar* pStack, CBotVar* pLocals)
+{
+    m_pc = pc;
+
+    m_sp = 0;
+    for ( CBotVar* var = pStack ; var != NULL ; var = var->GetNext() ) m_sp++;
+    m_stack.resize(m_sp);
+    int     i = 0;
+    for ( CBotVar* var = pStack ; var != NULL ; var = var->GetNext() )
+        CBotByteCode::MakeValue(m_stack[i++], var);
+
+    m_locals.clear();
+    for ( CBotVar* var = pLocals ; var != NULL ; var = var->GetNext() )
+    {
+        m_locals.push_back(CBotByteValue());
+        CBotByteCode::MakeValue(m_locals.back(), var);
+    }
+}
+
+// is pj the level of a function whose block runs as bytecode?
+
+bool CBotByteCode::IsRunning(CBotStack* pj)
+{
+    return pj != NULL && pj->m_next != NULL && pj->m_next != EOX &&
+           pj->m_next->m_vm != NULL;
+}
+
+// should the block run as bytecode?
+// the one which started continues, but the step by step mode stays in the tree
+
+bool CBotByteCode::Accept(CBotStack* pj)
+{
+    if ( pj->m_next != NULL ) return IsRunning(pj);
+    return m_bEnable && CBotStack::m_initimer > 0;
+}
+
+// call of a routine, as CBotInstrCall::Execute()
+// false if interrupted or error
+
+bool CBotByteCode::DoCall(CBotStack* pile, CBotByteState* vm, const CBotByteOp& op)
+{
+    CBotInstrCall*  instr = m_calls[op.m_arg];
+
+    CBotStack*  pile2 = pile->AddStack(instr);
+    if ( pile2->StackOver() ) return false;
+
+    // the parameters are given by copies of the values
+    CBotVar*    ppVars[1000];
+    int         n = op.m_op;
+    for ( int i = 0 ; i < n ; i++ ) ppVars[i] = MakeVar(vm->m_stack[vm->m_sp-n+i]);
+    ppVars[n] = NULL;
+
+    bool    ok = pile2->ExecuteCall(instr->m_nFuncIdent, instr->GetToken(), ppVars, instr->m_typRes);
+
+    for ( int i = 0 ; i < n ; i++ ) delete ppVars[i];
+
+    if ( !ok || !pile2->IsOk() ) return false;
+
+    vm->m_sp -= n;
+    if ( instr->m_typRes.GetType() != CBotTypVoid )
+    {
+        CBotByteValue&  res = vm->m_stack[vm->m_sp++];
+        if ( pile2->GetVar() != NULL ) MakeValue(res, pile2->GetVar());
+        else                           Clear(res, CBotTypInt);
+    }
+    pile2->Delete();
+    return true;
+}
+
+bool CBotByteCode::Execute(CBotStack* &pj)
+{
+    CBotStack*  pile = pj->AddStack(m_func->m_Block, true);
+    if ( pile->StackOver() ) return pj->Return(pile);
+
+    CBotByteState*  vm = pile->m_vm;
+    if ( vm == NULL )
+    {
+        vm = pile->m_vm = new CBotByteState();
+        vm->m_pc = 0;
+        vm->m_sp = 0;
+        vm->m_locals.resize(m_types.size());
+        for ( unsigned int i = 0 ; i < m_types.size() ; i++ ) Clear(vm->m_locals[i], m_types[i]);
+
+        // the parameters were defined by CBotDefParam on this level
+        CBotVar*    var = pj->m_listVar;
+        for ( int i = 0 ; i < m_nParams && var != NULL ; i++, var = var->GetNext() )
+            MakeValue(vm->m_locals[i], var);
+    }
+    if ( static_cast<int>(vm->m_stack.size()) < m_maxStack ) vm->m_stack.resize(m_maxStack);
+
+    CBotByteValue*  stack  = &vm->m_stack[0];
+    CBotByteValue*  locals = vm->m_locals.empty() ? NULL : &vm->m_locals[0];
+    int             pc = vm->m_pc;
+    int             sp = vm->m_sp;
+    bool            bFirst = true;          // at least one operation each time
+    int&            timer  = CBotStack::m_timer;    // of this thread, looked up once
+    int             err;
+
+    while ( true )
+    {
+        const CBotByteOp&   op = m_ops[pc];
+
+        if ( timer <= 0 && !bFirst )
+        {
+            vm->m_pc = pc;                  // interrupted here
+            vm->m_sp = sp;
+            pile->m_instr = op.m_instr;
+            return false;
+        }
+        bFirst = false;
+        timer--;
+
+        switch ( op.m_code )
+        {
+        case BC_CONST:
+            stack[sp++] = m_consts[op.m_arg];
+            pc++;
+            break;
+
+        case BC_LOAD:
+            if ( locals[op.m_arg].m_binit == IS_UNDEF )
+            {
+                pile->SetError(TX_NOTINIT, op.m_token);
+                return pj->Return(pile);
+            }
+            stack[sp++] = locals[op.m_arg];
+            pc++;
+            break;
+
+        case BC_LOADRAW:
+            stack[sp++] = locals[op.m_arg];
+            pc++;
+            break;
+
+        case BC_STORE:
+            Assign(locals[op.m_arg], stack[sp-1]);
+            if ( op.m_bKeep ) stack[sp-1] = locals[op.m_arg];
+            else              sp--;
+            pc++;
+            break;
+
+        case BC_DECL:
+            Clear(locals[op.m_arg], m_types[op.m_arg]);
+            pc++;
+            break;
+
+        case BC_COMPOUND:
+            {
+                // as CBotExpression::Execute(), where a variable not a number
+                // counts as initialized, with the value 0
+                CBotByteValue&  left = stack[sp-2];
+                bool            bInit = ( left.m_binit != IS_UNDEF );
+
+                CBotByteValue   result;
+                Clear(result, m_types[op.m_arg]);
+                err = 0;
+                if ( bInit || (op.m_op != ID_DIV && op.m_op != ID_MODULO) )
+                    err = Compute(result, op.m_op, left, stack[sp-1]);
+                if ( err ) pile->SetError(err, op.m_instr->GetToken());
+                if ( !bInit ) pile->SetError(TX_NOTINIT, op.m_token);
+                if ( !pile->IsOk() ) return pj->Return(pile);
+
+                Assign(locals[op.m_arg], result);
+                sp -= 2;
+                if ( op.m_bKeep ) stack[sp++] = locals[op.m_arg];
+                pc++;
+            }
+            break;
+
+        case BC_PREINC:
+        case BC_POSTINC:
+            {
+                // as CBotPreIncExpr::Execute() and CBotPostIncExpr::Execute()
+                CBotByteValue&  var = locals[op.m_arg];
+                if ( op.m_code == BC_POSTINC && op.m_bKeep ) stack[sp++] = var;
+
+                if ( var.m_binit == IS_NAN ) pile->SetError(TX_OPNAN, op.m_token);
+                if ( var.m_binit != IS_DEF ) pile->SetError(TX_NOTINIT, op.m_token);
+                if ( !pile->IsOk() ) return pj->Return(pile);
+
+                int     delta = ( op.m_op == ID_INC ) ? 1 : -1;
+                if ( var.m_type == CBotTypFloat ) var.m_fval += delta;
+                else if ( var.m_type == CBotTypInt )
+                {
+                    var.m_val += delta;
+                    if ( !var.m_sval.IsEmpty() ) var.m_sval.Empty();
+                }
+
+                if ( op.m_code == BC_PREINC && op.m_bKeep ) stack[sp++] = var;
+                pc++;
+            }
+            break;
+
+        case BC_BINARY:
+            sp--;
+            err = Operation(op.m_op, stack[sp-1], stack[sp]);
+            if ( err )
+            {
+                pile->SetError(err, op.m_token);
+                return pj->Return(pile);
+            }
+            pc++;
+            break;
+
+        case BC_UNARY:
+            {
+                // as CBotExprUnaire::Execute(), no change of a name given by DefineNum
+                CBotByteValue&  value = stack[sp-1];
+                if ( op.m_op == ID_SUB )
+                {
+                    if ( value.m_type == CBotTypFloat ) value.m_fval = -value.m_fval;
+                    else if ( value.m_type == CBotTypInt ) value.m_val = -value.m_val;
+                }
+                else if ( op.m_op != ID_ADD )
+                {
+                    if ( value.m_type == CBotTypBoolean ) value.m_val = value.m_val ? false : true;
+                    else if ( value.m_type == CBotTypInt ) value.m_val = ~value.m_val;
+                }
+                pc++;
+            }
+            break;
+
+        case BC_ANDTEST:
+        case BC_ORTEST:
+            {
+                bool    bAnd = ( op.m_code == BC_ANDTEST );
+                if ( GetValInt(stack[sp-1]) == (bAnd ? false : true) )
+                {
+                    Clear(stack[sp-1], CBotTypBoolean);
+                    stack[sp-1].m_val   = !bAnd;
+                    stack[sp-1].m_binit = IS_DEF;
+                    pc = op.m_arg;
+                }
+                else pc++;
+            }
+            break;
+
+        case BC_POP:
+            sp--;
+            pc++;
+            break;
+
+        case BC_JUMP:
+            pc = op.m_arg;
+            break;
+
+        case BC_JUMPF:
+            sp--;
+            if ( GetValInt(stack[sp]) != true ) pc = op.m_arg;
+            else pc++;
+            break;
+
+        case BC_CALL:
+            vm->m_pc = pc;
+            vm->m_sp = sp;
+            if ( !DoCall(pile, vm, op) )
+            {
+                if ( !pile->IsOk() ) return pj->Return(pile);
+                pile->m_instr = op.m_instr;         // interrupted in the routine
+                return false;
+            }
+            stack = &vm->m_stack[0];
+            sp = vm->m_sp;
+            pc++;
+            break;
+
+        case BC_RETURN:
+            pile->SetVar(MakeVar(stack[sp-1]));
+            pile->SetBreak(3, CBotString());
+            return pj->Return(pile);
+
+        case BC_END:
+            return pj->Return(pile);
+
+        default:
+            assert(0);
+        }
+    }
+}
+
+void CBotByteCode::RestoreState(CBotStack* &pj)
+{
+    CBotStack*  pile = pj->RestoreStack(m_func->m_Block);
+    if ( pile == NULL || pile->m_vm == NULL ) return;
+
+    CBotByteState*  vm = pile->m_vm;
+    if ( vm->m_pc < 0 || vm->m_pc >= static_cast<int>(m_ops.size()) ) return;
+
+    const CBotByteOp&   op = m_ops[vm->m_pc];
+    pile->m_instr = op.m_instr;
+    if ( op.m_code != BC_CALL ) return;
+
+    // interrupted in a routine, which is restored too
+    CBotInstrCall*  instr = m_calls[op.m_arg];
+    CBotStack*      pile2 = pile->RestoreStack(instr);
+    if ( pile2 == NULL ) return;
+
+    CBotVar*    ppVars[1000];
+    int         n = op.m_op;
+    if ( n > vm->m_sp ) return;
+    for ( int i = 0 ; i < n ; i++ ) ppVars[i] = MakeVar(vm->m_stack[vm->m_sp-n+i]);
+    ppVars[n] = NULL;
+
+    pile2->RestoreCall(instr->m_nFuncIdent, instr->GetToken(), ppVars);
+
+    for ( int i = 0 ; i < n ; i++ ) delete ppVars[i];
+}
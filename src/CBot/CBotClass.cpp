@@ -32,6 +32,8 @@ CBotClass::CBotClass(const char* name, CBotClass* pPapa, bool bIntrinsic)
     m_pCalls    = NULL;
     m_pMethod   = NULL;
     m_rMaj      = NULL;
+    m_rMajItem  = NULL;
+    m_nbMajItem = 0;
     m_IsDef     = true;
     m_bIntrinsic= bIntrinsic;
     m_cptLock   = 0;
@@ -65,6 +67,7 @@ CBotClass::~CBotClass()
     delete  m_pVar;
     delete  m_pCalls;
     delete  m_pMethod;
+    delete[] m_rMajItem;
 
     delete  m_next;         // releases all of them on this level
 }
@@ -88,6 +91,9 @@ void CBotClass::Purge()
     m_pCalls    = NULL;
     delete      m_pMethod;
     m_pMethod   = NULL;
+    delete[]    m_rMajItem;
+    m_rMajItem  = NULL;
+    m_nbMajItem = 0;
     m_IsDef     = false;
 
     m_nbVar     = m_pParent == NULL ? 0 : m_pParent->m_nbVar;
@@ -98,6 +104,8 @@ void CBotClass::Purge()
 
 bool CBotClass::Lock(CBotProgram* p)
 {
+    if ( CBotStack::WaitApp() ) return false;      // in the order of the thread of the application
+
     int i = m_cptLock++;
 
     if ( i == 0 )
@@ -326,6 +334,30 @@ bool CBotClass::AddUpdateFunc( void rMaj ( CBotVar* pThis, void* pUser ) )
     return true;
 }
 
+bool CBotClass::AddUpdateFunc( const char* name, void rMaj ( CBotVar* pItem, void* pUser ) )
+{
+    CBotVar*    pVar = m_pVar;
+    while ( pVar != NULL && pVar->GetName() != name ) pVar = pVar->GetNext();
+    if ( pVar == NULL ) return false;
+
+    // the elements are numbered from 1 in the class, see AddItem
+    int n = pVar->GetUniqNum();
+    if ( n >= m_nbMajItem )
+    {
+        typedef void (*MajItem) ( CBotVar* pItem, void* pUser );
+        MajItem*    table = new MajItem[m_nbVar+1];
+        for ( int i = 0 ; i <= m_nbVar ; i++ )
+            table[i] = (i < m_nbMajItem) ? m_rMajItem[i] : NULL;
+
+        delete[] m_rMajItem;
+        m_rMajItem  = table;
+        m_nbMajItem = m_nbVar+1;
+    }
+
+    m_rMajItem[n] = rMaj;
+    return true;
+}
+
 // compiles a method associated with an instance of class
 // the method can be declared by the user or AddFunction
 
@@ -350,24 +382,30 @@ CBotTypResult CBotClass::CompileMethode(const char* name,
 
 // executes a method
 
-bool CBotClass::ExecuteMethode(long& nIdent, const char* name,
+bool CBotClass::ExecuteMethode(std::atomic<long>& nIdent, const char* name,
                                CBotVar* pThis, CBotVar** ppParams,
                                CBotVar* &pResult, CBotStack* &pStack,
                                CBotToken* pToken)
 {
-    int ret = m_pCalls->DoCall(nIdent, name, pThis, ppParams, pResult, pStack, pToken);
-    if (ret>=0) return ret;
+    // the method is looked for with a copy of the identifier, since other
+    // programs may run the same instruction (see CBotSharedCode)
+    long    ident = nIdent;
+
+    int ret = m_pCalls->DoCall(ident, name, pThis, ppParams, pResult, pStack, pToken);
+    if (ret<0) ret = m_pMethod->DoCall(ident, name, pThis, ppParams, pStack, pToken, this);
 
-    ret = m_pMethod->DoCall(nIdent, name, pThis, ppParams, pStack, pToken, this);
+    if ( ident != 0 && ident != nIdent ) nIdent = ident;
     return ret;
 }
 
 // restored the execution stack
 
-void CBotClass::RestoreMethode(long& nIdent, const char* name, CBotVar* pThis,
+void CBotClass::RestoreMethode(std::atomic<long>& nIdent, const char* name, CBotVar* pThis,
                                CBotVar** ppParams, CBotStack* &pStack)
 {
-    m_pMethod->RestoreCall(nIdent, name, pThis, ppParams, pStack, this);
+    long    ident = nIdent;
+    m_pMethod->RestoreCall(ident, name, pThis, ppParams, pStack, this);
+    if ( ident != 0 && ident != nIdent ) nIdent = ident;
 }
 
 
@@ -551,7 +589,9 @@ CBotInstr* CBotClassInst::Compile(CBotToken* &p, CBotCStack* pStack, CBotClass*
         {
             // the constructor is there?
 //          CBotString  noname;
-            CBotTypResult r = pClass->CompileMethode(pClass->GetName(), var, ppVars, pStk, inst->m_nMethodeIdent);
+            long ident;
+            CBotTypResult r = pClass->CompileMethode(pClass->GetName(), var, ppVars, pStk, ident);
+            inst->m_nMethodeIdent = ident;
             delete pStk->TokenStack();                          // releases the supplement stack
             int typ = r.GetType();
 
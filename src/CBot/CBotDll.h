@@ -24,8 +24,11 @@
 
 #include <stdio.h>
 #include "resource.h"
+#include <atomic>
 #include <map>
 #include <cstring>
+#include <string>
+#include <vector>
 
 
 #define    CBOTVERSION    104
@@ -45,6 +48,7 @@ class CBotCall;         // functions
 class CBotCallMethode;  // methods
 class CBotDefParam;     // parameter list
 class CBotCStack;       // stack
+class CBotSharedCode;   // functions shared by programs
 
 
 ////////////////////////////////////////////////////////////////////////
@@ -366,7 +370,9 @@ private:
     CBotClass*        m_pClass;        // classes defined in this part
     CBotStack*        m_pStack;        // execution stack
     CBotVar*        m_pInstance;    // instance of the parent class
+    CBotSharedCode* m_pCode;        // functions shared with other programs, NULL if only for this one
     friend class    CBotFunction;
+    friend class    CBotSharedCode;
 
     int                m_ErrorCode;
     int                m_ErrorStart;
@@ -374,6 +380,9 @@ private:
 
     long            m_Ident;        // associated identifier
 
+    bool            m_bWait;        // RunCompute() stopped before the application?
+    int                m_waitTimer;    // steps left then
+
 public:
     static CBotString        m_DebugVarStr;    // end of a debug
     bool m_bDebugDD;        // idem déclanchable par robot \TODO ???
@@ -403,6 +412,19 @@ public:
     //                ListFonctions returns the names of functions declared as extern
     //                pUser can pass a pointer to routines defined by AddFunction
 
+    bool            CompileShared( const char* program, CBotStringArray& ListFonctions, void* pUser = NULL, long context = 0);
+    //                same as Compile(), but the functions are compiled only once for all
+    //                the programs given the same text in the same context: they run
+    //                the same instructions, each program only has its own stack and instance
+    //                context tells what else than the text changes the compilation
+    //                (e.g. routines defined by AddFunction which depend on pUser)
+    //                a text which defines classes or public functions is compiled for this
+    //                program only, as they cannot be defined twice
+
+    static
+    int             GetSharedCount();
+    //                gives the number of texts compiled once for several programs
+
     void            SetIdent(long n);
     //                associates an identifier with the instance CBotProgram
 
@@ -430,6 +452,23 @@ public:
     //                returns false if the program was suspended
     //                returns true if the program ended with or without error
     //                timer = 0 allows to advance step by step
+    //                after a RunCompute() that stopped before the application,
+    //                continues with the steps that were left instead of timer
+
+    bool            RunCompute(void* pUser = NULL, int timer = -1);
+    //                same as Run(), with exactly timer steps (> 0), but may be called
+    //                on another thread than the one of the application
+    //                (several programs can run at the same time on several threads):
+    //                the application is not called, the execution stops before
+    //                the external functions (except those added with bCompute)
+    //                the update of the instances of its classes, the use of
+    //                the instances reached through a static field (which other
+    //                programs can use too) and the locking of a synchronized
+    //                class, then IsWaiting() and Run()
+    //                must be called on the thread of the application
+
+    bool            IsWaiting();
+    //                true if the last RunCompute() stopped before the application
 
     bool            GetRunPos(const char* &FunctionName, int &start, int &end);
     //                gives the position in the executing program
@@ -454,12 +493,23 @@ public:
     //                defines the number of steps (parts of instructions) to done
     //                in Run() before rendering hand "false" \TODO avant de rendre la main "false"
 
+    static
+    void            SetByteCode(bool bEnable);
+    static
+    bool            GetByteCode();
+    //                runs the functions as bytecode instead of through the tree of instructions
+    //                (only those using simple types, the others keep the tree)
+    //                for the calls starting after the change; false by default
+
     static
     bool            AddFunction(const char* name,
                                 bool rExec (CBotVar* pVar, CBotVar* pResult, int& Exception, void* pUser),
-                                CBotTypResult rCompile (CBotVar* &pVar, void* pUser));
+                                CBotTypResult rCompile (CBotVar* &pVar, void* pUser),
+                                bool bCompute = false);
     //                call this to add externally (**)
     //                a new function used by the program CBoT
+    //                bCompute = true if it only computes with its parameters,
+    //                so RunCompute() can call it from any thread
 
     static
     bool            DefineNum(const char* name, long val);
@@ -481,6 +531,10 @@ public:
 
 
     CBotFunction*    GetFunctions();
+
+private:
+    void            FreeFunctions();
+    //                forgets the functions, deletes them if no other program runs them
 };
 
 
@@ -583,6 +637,7 @@ protected:
 
     long            m_ident;                    // unique identifier
     static long        m_identcpt;                    // counter
+    int                m_slot;                        // place in the slots of its function (see CBotStack::FindVar)
 
 public:
                     CBotVar();
@@ -744,6 +799,8 @@ virtual                ~CBotVar( );                        // destructor
     void            SetUniqNum(long n);
     long            GetUniqNum();
     static long        NextUniqNum();
+
+    int             GetSlot();                    // slot given at compilation, -1 if none
 };
 
 /* NOTE (#)
@@ -786,6 +843,8 @@ private:
     CBotCallMethode* m_pCalls;        // list of methods defined in external
     CBotFunction*    m_pMethod;        // compiled list of methods
     void            (*m_rMaj) ( CBotVar* pThis, void* pUser );
+    void            (**m_rMajItem) ( CBotVar* pItem, void* pUser );    // by identifier of element
+    int                m_nbMajItem;    // size of m_rMajItem
     friend class    CBotVarClass;
     int                m_cptLock;        // for Lock / UnLock
     int                m_cptOne;        // Lock for reentrancy
@@ -811,6 +870,10 @@ public:
     bool            AddUpdateFunc( void rMaj ( CBotVar* pThis, void* pUser ) );
     //                defines routine to be called to update the elements of the class
 
+    bool            AddUpdateFunc( const char* name, void rMaj ( CBotVar* pItem, void* pUser ) );
+    //                defines routine to be called to update one element of the class,
+    //                only when a program uses this element
+
     bool            AddItem(CBotString name, CBotTypResult type, int mPrivate = PR_PUBLIC);
     //                adds an element to the class
 //    bool            AddItem(CBotString name, CBotClass* pClass);
@@ -844,8 +907,8 @@ public:
     CBotTypResult    CompileMethode(const char* name, CBotVar* pThis, CBotVar** ppParams,
                                    CBotCStack* pStack, long& nIdent);
 
-    bool            ExecuteMethode(long& nIdent, const char* name, CBotVar* pThis, CBotVar** ppParams, CBotVar* &pResult, CBotStack* &pStack, CBotToken* pToken);
-    void            RestoreMethode(long& nIdent, const char* name, CBotVar* pThis, CBotVar** ppParams, CBotStack* &pStack);
+    bool            ExecuteMethode(std::atomic<long>& nIdent, const char* name, CBotVar* pThis, CBotVar** ppParams, CBotVar* &pResult, CBotStack* &pStack, CBotToken* pToken);
+    void            RestoreMethode(std::atomic<long>& nIdent, const char* name, CBotVar* pThis, CBotVar** ppParams, CBotStack* &pStack);
 
     // compiles a class declared by the user
     static
@@ -891,19 +954,17 @@ public:
 #define TokenKeyVal            2200                // keywords representing the value (true, false, null, nan)
 #define TokenKeyOp            2300                // operators
 
+class CBotNameTable;    // names with their values, see CBotToken.h
+
 /** \class Responsible for token management */
 class CBotToken
 {
 private:
     static
-    CBotStringArray    m_ListKeyWords;                // list of keywords of language
-    static
-    int                m_ListIdKeyWords[200];        // the corresponding codes
+    CBotNameTable    m_ListKeyWords;                // keywords of language with their codes
 
     static
-    CBotStringArray    m_ListKeyDefine;            // names defined by a DefineNum
-    static
-    long            m_ListKeyNums[MAXDEFNUM];    // the ​​associated values
+    CBotNameTable    m_ListKeyDefine;            // names defined by a DefineNum with their values
 
 private:
     CBotToken*        m_next;                        // following in the list
@@ -1017,6 +1078,52 @@ public:
 };
 
 
+/** \brief Place of a token in a text */
+struct CBotTokenSpan
+{
+    int             start;                      // position of the word in the text
+    int             end;                        // end of the word
+    int             next;                       // end of the separators, start of the next token
+    int             type;                       // type of the token, as given by CBotToken::GetType()
+};
+
+/**
+ * \class CBotTokenList
+ * \brief Tokens of a text which is changed a little at a time, as in an editor
+ *
+ * Only the tokens around the changed part of the text are cut again:
+ * those before it are kept, and the ones after it are taken back
+ * (moved by the change of length) from the first one which starts
+ * at the same place in the rest of the text.
+ */
+class CBotTokenList
+{
+public:
+                    CBotTokenList();
+
+    /**
+     * \brief Cuts again the part of the text which changed since the last call
+     * \param text the whole text
+     * \param first,last returns the range [first, last) of the tokens which were cut again
+     */
+    void            Update(const char* text, int& first, int& last);
+
+    /**
+     * \brief Forgets the text and its tokens
+     */
+    void            Empty();
+
+    int             GetSize();
+    const CBotTokenSpan&
+                    GetSpan(int i);
+
+private:
+    std::string     m_text;                     // text of the last update
+    std::vector<CBotTokenSpan>
+                    m_spans;
+};
+
+
 
 #if 0
 ////////////////////////////////////////////////////////////////////////
@@ -39,6 +39,7 @@ CBotFunction::CBotFunction()
 //  m_nThisIdent = 0;
     m_nFuncIdent = 0;
     m_bSynchro    = false;
+    m_code       = NULL;            // no bytecode
 }
 
 CBotFunction* CBotFunction::m_listPublic = NULL;
@@ -47,6 +48,7 @@ CBotFunction::~CBotFunction()
 {
     delete  m_Param;                // empty parameter list
     delete  m_Block;                // the instruction block
+    delete  m_code;
     delete  m_next;
 
     // remove public list if there is
@@ -181,6 +183,7 @@ CBotFunction* CBotFunction::Compile(CBotToken* &p, CBotCStack* pStack, CBotFunct
     if ( func == NULL ) func = new CBotFunction();
 
     CBotCStack* pStk = pStack->TokenStack(p, bLocal);
+    pStk->StartFunction();                                  // numbers its variables
 
 //  func->m_nFuncIdent = CBotVar::NextUniqNum();
 
@@ -378,7 +381,7 @@ bool CBotFunction::Execute(CBotVar** ppVars, CBotStack* &pj, CBotVar* pInstance)
     CBotStack*  pile = pj->AddStack(this, 2);               // one end of stack local to this function
 //  if ( pile == EOX ) return true;
 
-    pile->SetBotCall(m_pProg);                              // bases for routines
+    pile->SetBotCall(GetProg(pj->GetBotCall()));            // bases for routines
 
     if ( pile->GetState() == 0 )
     {
@@ -411,7 +414,7 @@ bool CBotFunction::Execute(CBotVar** ppVars, CBotStack* &pj, CBotVar* pInstance)
 
     if ( pile->IfStep() ) return false;
 
-    if ( !m_Block->Execute(pile) )
+    if ( !ExecuteBlock(pile) )
     {
         if ( pile->GetError() < 0 )
             pile->SetError( 0 );
@@ -429,7 +432,14 @@ void CBotFunction::RestoreState(CBotVar** ppVars, CBotStack* &pj, CBotVar* pInst
     if ( pile == NULL ) return;
     CBotStack*  pile2 = pile;
 
-    pile->SetBotCall(m_pProg);                          // bases for routines
+    pile->SetBotCall(GetProg(pj->GetBotCall()));        // bases for routines
+
+    if ( m_code != NULL && CBotByteCode::IsRunning(pile) )
+    {
+        m_Param->RestoreState(pile, true);              // parameters
+        m_code->RestoreState(pile);                     // the block runs as bytecode
+        return;
+    }
 
     if ( pile->GetBlock() < 2 )
     {
@@ -451,6 +461,15 @@ void CBotFunction::RestoreState(CBotVar** ppVars, CBotStack* &pj, CBotVar* pInst
     m_Block->RestoreState(pile2, true);
 }
 
+// executes the instruction block, as bytecode when possible
+
+bool CBotFunction::ExecuteBlock(CBotStack* &pj)
+{
+    if ( m_code != NULL && m_code->Accept(pj) ) return m_code->Execute(pj);
+
+    return m_Block->Execute(pj);
+}
+
 void CBotFunction::AddNext(CBotFunction* p)
 {
     CBotFunction*   pp = this;
@@ -641,7 +660,7 @@ int CBotFunction::DoCall(long& nIdent, const char* name, CBotVar** ppVars, CBotS
         CBotStack*  pStk1 = pStack->AddStack(pt, 2);    // to put "this"
 //      if ( pStk1 == EOX ) return true;
 
-        pStk1->SetBotCall(pt->m_pProg);                 // it may have changed module
+        pStk1->SetBotCall(pt->GetProg(pStack->GetBotCall()));  // it may have changed module
 
         if ( pStk1->IfStep() ) return false;
 
@@ -653,7 +672,7 @@ int CBotFunction::DoCall(long& nIdent, const char* name, CBotVar** ppVars, CBotS
         {
             if ( !pt->m_MasterClass.IsEmpty() )
             {
-                CBotVar* pInstance = m_pProg->m_pInstance;
+                CBotVar* pInstance = pStack->GetBotCall()->m_pInstance;
                 // make "this" known
                 CBotVar* pThis ;
                 if ( pInstance == NULL )
@@ -682,9 +701,9 @@ int CBotFunction::DoCall(long& nIdent, const char* name, CBotVar** ppVars, CBotS
         // finally execution of the found function
 
         if ( !pStk3->GetRetVar(                     // puts the result on the stack
-            pt->m_Block->Execute(pStk3) ))          // GetRetVar said if it is interrupted
+            pt->ExecuteBlock(pStk3) ))              // GetRetVar said if it is interrupted
         {
-            if ( !pStk3->IsOk() && pt->m_pProg != m_pProg )
+            if ( !pStk3->IsOk() && pStk1->GetBotCall() != pStack->GetBotCall() )
             {
 #ifdef _DEBUG
                 if ( m_pProg->GetFunctions()->GetName() == "LaCommande" ) return false;
@@ -715,7 +734,15 @@ void CBotFunction::RestoreCall(long& nIdent, const char* name, CBotVar** ppVars,
         pStk1 = pStack->RestoreStack(pt);
         if ( pStk1 == NULL ) return;
 
-        pStk1->SetBotCall(pt->m_pProg);                 // it may have changed module
+        pStk1->SetBotCall(pt->GetProg(pStack->GetBotCall()));  // it may have changed module
+
+        pStk3 = pStk1->RestoreStack(NULL);
+        if ( pt->m_code != NULL && CBotByteCode::IsRunning(pStk3) )
+        {
+            pt->m_Param->RestoreState(pStk3, false);
+            pt->m_code->RestoreState(pStk3);            // the block runs as bytecode
+            return;
+        }
 
         if ( pStk1->GetBlock() < 2 )
         {
@@ -774,7 +801,7 @@ int CBotFunction::DoCall(long& nIdent, const char* name, CBotVar* pThis, CBotVar
         CBotStack*  pStk = pStack->AddStack(pt, 2);
 //      if ( pStk == EOX ) return true;
 
-        pStk->SetBotCall(pt->m_pProg);                  // it may have changed module
+        pStk->SetBotCall(pt->GetProg(pProgCurrent));    // it may have changed module
         CBotStack*  pStk3 = pStk->AddStack(NULL, true); // to set parameters passed
 
         // preparing parameters on the stack
@@ -822,7 +849,7 @@ int CBotFunction::DoCall(long& nIdent, const char* name, CBotVar* pThis, CBotVar
                     pClass->Unlock();                   // release function
                 }
 
-                if ( pt->m_pProg != pProgCurrent )
+                if ( pStk->GetBotCall() != pProgCurrent )
                 {
                     pStk3->SetPosError(pToken);         // indicates the error on the procedure call
                 }
@@ -849,7 +876,7 @@ void CBotFunction::RestoreCall(long& nIdent, const char* name, CBotVar* pThis, C
     {
         CBotStack*  pStk = pStack->RestoreStack(pt);
         if ( pStk == NULL ) return;
-        pStk->SetBotCall(pt->m_pProg);                  // it may have changed module
+        pStk->SetBotCall(pt->GetProg(pStack->GetBotCall()));   // it may have changed module
 
         CBotVar*    pthis = pStk->FindVar("this");
         pthis->SetUniqNum(-2);
@@ -887,6 +914,18 @@ bool CBotFunction::CheckParam(CBotDefParam* pParam)
     return ( pp == NULL && pParam == NULL );
 }
 
+// the program running the function when called from pCurrent:
+// pCurrent itself if it shares the functions of the program which compiled it
+
+CBotProgram* CBotFunction::GetProg(CBotProgram* pCurrent)
+{
+    if ( pCurrent != NULL && m_pProg != NULL &&
+         pCurrent->m_pCode != NULL && pCurrent->m_pCode == m_pProg->m_pCode )
+        return pCurrent;
+
+    return m_pProg;
+}
+
 CBotString CBotFunction::GetName()
 {
     return  m_token.GetString();
@@ -1260,7 +1299,9 @@ CBotInstr* CBotInstrCall::Compile(CBotToken* &p, CBotCStack* pStack)
 
         // the routine is known?
 //      CBotClass*  pClass = NULL;
-        inst->m_typRes = pStack->CompileCall(pp, ppVars, inst->m_nFuncIdent);
+        long    ident;
+        inst->m_typRes = pStack->CompileCall(pp, ppVars, ident);
+        inst->m_nFuncIdent = ident;
         if ( inst->m_typRes.GetType() >= 20 )
         {
 //          if (pVar2!=NULL) pp = pVar2->RetToken();
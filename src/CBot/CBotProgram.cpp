@@ -27,10 +27,13 @@ CBotProgram::CBotProgram()
     m_pClass    = NULL;
     m_pStack    = NULL;
     m_pInstance = NULL;
+    m_pCode     = NULL;
 
     m_ErrorCode = 0;
     m_Ident     = 0;
     m_bDebugDD  = 0;
+    m_bWait     = false;
+    m_waitTimer = 0;
 }
 
 CBotProgram::CBotProgram(CBotVar* pInstance)
@@ -40,10 +43,13 @@ CBotProgram::CBotProgram(CBotVar* pInstance)
     m_pClass    = NULL;
     m_pStack    = NULL;
     m_pInstance = pInstance;
+    m_pCode     = NULL;
 
     m_ErrorCode = 0;
     m_Ident     = 0;
     m_bDebugDD  = 0;
+    m_bWait     = false;
+    m_waitTimer = 0;
 }
 
 
@@ -55,7 +61,7 @@ CBotProgram::~CBotProgram()
 
     CBotClass::FreeLock(this);
 
-    delete  m_Prog;
+    FreeFunctions();
 #if STACKMEM
     m_pStack->Delete();
 #else
@@ -73,7 +79,7 @@ bool CBotProgram::Compile( const char* program, CBotStringArray& ListFonctions,
     m_pClass->Purge();      // purge the old definitions of classes
                             // but without destroying the object
     m_pClass    = NULL;
-    delete      m_Prog;     m_Prog= NULL;
+    FreeFunctions();
 
     ListFonctions.SetSize(0);
     m_ErrorCode = 0;
@@ -154,6 +160,12 @@ bool CBotProgram::Compile( const char* program, CBotStringArray& ListFonctions,
         delete m_Prog;
         m_Prog = NULL;
     }
+    else
+    {
+        // translates into bytecode the functions which allow it
+        for ( next = m_Prog; next != NULL; next = next->Next() )
+            next->m_code = CBotByteCode::Compile(next);
+    }
 
     delete pBaseToken;
     delete pStack;
@@ -161,6 +173,46 @@ bool CBotProgram::Compile( const char* program, CBotStringArray& ListFonctions,
     return (m_Prog != NULL);
 }
 
+bool CBotProgram::CompileShared( const char* program, CBotStringArray& ListFonctions, void* pUser, long context )
+{
+    CBotSharedCode* pCode = CBotSharedCode::Find(program, context);
+    if ( pCode == NULL )
+    {
+        if ( !Compile(program, ListFonctions, pUser) ) return false;
+
+        // the classes and the public functions can be defined only once, they stay with this program
+        bool bShared = ( m_pClass == NULL );
+        for ( CBotFunction* p = m_Prog; p != NULL; p = p->Next() )
+            if ( p->IsPublic() ) bShared = false;
+
+        if ( bShared ) m_pCode = CBotSharedCode::Add(program, context, this, ListFonctions);
+        return true;
+    }
+
+    Stop();
+
+    m_pClass->Purge();
+    m_pClass    = NULL;
+
+    pCode->AddUser(this);                                   // before, if they are the functions of this program
+    FreeFunctions();
+    m_pCode     = pCode;
+    m_Prog      = pCode->GetFunctions();
+
+    pCode->GetExtern(ListFonctions);
+    m_ErrorCode = 0;
+    return true;
+}
+
+void CBotProgram::FreeFunctions()
+{
+    if ( m_pCode != NULL ) m_pCode->RemoveUser(this);      // deleted by the last program
+    else                   delete m_Prog;
+
+    m_pCode = NULL;
+    m_Prog  = NULL;
+}
+
 
 bool CBotProgram::Start(const char* name)
 {
@@ -170,6 +222,7 @@ bool CBotProgram::Start(const char* name)
     delete m_pStack;
 #endif
     m_pStack = NULL;
+    m_bWait  = false;
 
     m_pRun = m_Prog;
     while (m_pRun != NULL)
@@ -222,6 +275,8 @@ bool CBotProgram::Run(void* pUser, int timer)
 
     m_pStack->Reset(pUser);                         // empty the possible previous error, and resets the timer
     if ( timer >= 0 ) m_pStack->SetTimer(timer);
+    if ( m_bWait ) m_pStack->ContinueWait(m_waitTimer); // goes on with the steps left by RunCompute()
+    m_bWait = false;
 
     m_pStack->SetBotCall(this);                     // bases for routines
 
@@ -266,6 +321,23 @@ error:
     return true;
 }
 
+bool CBotProgram::RunCompute(void* pUser, int timer)
+{
+    CBotStack::SetTimer(timer);                     // the steps for this time, not the previous ones
+    CBotStack::SetCompute(true);
+    bool ok = Run(pUser, timer);
+    CBotStack::SetCompute(false);
+
+    m_bWait = !ok && CBotStack::IsWaiting();
+    m_waitTimer = CBotStack::GetWaitTimer();
+    return ok;
+}
+
+bool CBotProgram::IsWaiting()
+{
+    return m_bWait;
+}
+
 void CBotProgram::Stop()
 {
 #if STACKMEM
@@ -275,6 +347,7 @@ void CBotProgram::Stop()
 #endif
     m_pStack = NULL;
     m_pRun = NULL;
+    m_bWait = false;
 }
 
 
@@ -302,6 +375,16 @@ void CBotProgram::SetTimer(int n)
     CBotStack::SetTimer( n );
 }
 
+void CBotProgram::SetByteCode(bool bEnable)
+{
+    CBotByteCode::m_bEnable = bEnable;
+}
+
+bool CBotProgram::GetByteCode()
+{
+    return CBotByteCode::m_bEnable;
+}
+
 int CBotProgram::GetError()
 {
     return m_ErrorCode;
@@ -356,10 +439,11 @@ CBotFunction* CBotProgram::GetFunctions()
 
 bool CBotProgram::AddFunction(const char* name,
                               bool rExec (CBotVar* pVar, CBotVar* pResult, int& Exception, void* pUser),
-                              CBotTypResult rCompile (CBotVar* &pVar, void* pUser))
+                              CBotTypResult rCompile (CBotVar* &pVar, void* pUser),
+                              bool bCompute)
 {
     // stores pointers to the two functions
-    return CBotCall::AddFunction(name, rExec, rCompile);
+    return CBotCall::AddFunction(name, rExec, rCompile, bCompute);
 }
 
 
@@ -556,6 +640,125 @@ int CBotProgram::GetVersion()
     return  CBOTVERSION;
 }
 
+int CBotProgram::GetSharedCount()
+{
+    return CBotSharedCode::GetCount();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::multimap<unsigned long, CBotSharedCode*> CBotSharedCode::m_codes;
+
+CBotSharedCode::CBotSharedCode(const char* text, long context, unsigned long hash)
+{
+    m_text      = text;
+    m_context   = context;
+    m_hash      = hash;
+    m_Prog      = NULL;
+}
+
+CBotSharedCode::~CBotSharedCode()
+{
+    delete m_Prog;
+}
+
+unsigned long CBotSharedCode::Hash(const char* text, long context)
+{
+    // FNV-1a of the text then of the context
+    unsigned long hash = 2166136261UL;
+    for ( const char* p = text; *p != 0; p++ )
+    {
+        hash ^= static_cast<unsigned char>(*p);
+        hash *= 16777619UL;
+    }
+    for ( int i = 0; i < static_cast<int>(sizeof(long)); i++ )
+    {
+        hash ^= (static_cast<unsigned long>(context) >> (i*8)) & 0xFF;
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+CBotSharedCode* CBotSharedCode::Find(const char* text, long context)
+{
+    unsigned long hash = Hash(text, context);
+
+    auto range = m_codes.equal_range(hash);
+    for ( auto it = range.first; it != range.second; ++it )
+    {
+        CBotSharedCode* pCode = it->second;
+        if ( pCode->m_context == context && pCode->m_text == text ) return pCode;
+    }
+    return NULL;
+}
+
+CBotSharedCode* CBotSharedCode::Add(const char* text, long context, CBotProgram* p, CBotStringArray& ListFonctions)
+{
+    unsigned long hash = Hash(text, context);
+
+    CBotSharedCode* pCode = new CBotSharedCode(text, context, hash);
+    pCode->m_Prog = p->m_Prog;                              // the functions already know p
+    pCode->m_users.push_back(p);
+    for ( int i = 0; i < ListFonctions.GetSize(); i++ )
+        pCode->m_extern.Add(ListFonctions[i]);
+
+    m_codes.insert(std::make_pair(hash, pCode));
+    return pCode;
+}
+
+int CBotSharedCode::GetCount()
+{
+    return static_cast<int>(m_codes.size());
+}
+
+void CBotSharedCode::AddUser(CBotProgram* p)
+{
+    m_users.push_back(p);
+}
+
+void CBotSharedCode::RemoveUser(CBotProgram* p)
+{
+    for ( unsigned int i = 0; i < m_users.size(); i++ )
+    {
+        if ( m_users[i] != p ) continue;
+
+        m_users.erase(m_users.begin() + i);
+        if ( i == 0 && !m_users.empty() ) SetOwner(m_users[0]);
+        break;
+    }
+
+    if ( !m_users.empty() ) return;
+
+    auto range = m_codes.equal_range(m_hash);
+    for ( auto it = range.first; it != range.second; ++it )
+    {
+        if ( it->second != this ) continue;
+        m_codes.erase(it);
+        break;
+    }
+    delete this;
+}
+
+void CBotSharedCode::SetOwner(CBotProgram* p)
+{
+    // p compiled the functions for the other programs, see CBotFunction::GetProg()
+    for ( CBotFunction* pf = m_Prog; pf != NULL; pf = pf->Next() )
+        pf->m_pProg = p;
+}
+
+CBotFunction* CBotSharedCode::GetFunctions()
+{
+    return m_Prog;
+}
+
+void CBotSharedCode::GetExtern(CBotStringArray& ListFonctions)
+{
+    ListFonctions.SetSize(0);
+    for ( int i = 0; i < m_extern.GetSize(); i++ )
+        ListFonctions.Add(m_extern[i]);
+}
+
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -563,13 +766,15 @@ CBotCall* CBotCall::m_ListCalls = NULL;
 
 CBotCall::CBotCall(const char* name,
                    bool rExec (CBotVar* pVar, CBotVar* pResult, int& Exception, void* pUser),
-                   CBotTypResult rCompile (CBotVar* &pVar, void* pUser))
+                   CBotTypResult rCompile (CBotVar* &pVar, void* pUser),
+                   bool bCompute)
 {
     m_name       = name;
     m_rExec      = rExec;
     m_rComp      = rCompile;
     m_next       = NULL;
     m_nFuncIdent = CBotVar::NextUniqNum();
+    m_bCompute   = bCompute;
 }
 
 CBotCall::~CBotCall()
@@ -581,11 +786,13 @@ CBotCall::~CBotCall()
 void CBotCall::Free()
 {
     delete CBotCall::m_ListCalls;
+    CBotCall::m_ListCalls = NULL;
 }
 
 bool CBotCall::AddFunction(const char* name,
                            bool rExec (CBotVar* pVar, CBotVar* pResult, int& Exception, void* pUser),
-                           CBotTypResult rCompile (CBotVar* &pVar, void* pUser))
+                           CBotTypResult rCompile (CBotVar* &pVar, void* pUser),
+                           bool bCompute)
 {
     CBotCall*   p = m_ListCalls;
     CBotCall*   pp = NULL;
@@ -607,7 +814,7 @@ bool CBotCall::AddFunction(const char* name,
         p = p->m_next;
     }
 
-    pp = new CBotCall(name, rExec, rCompile);
+    pp = new CBotCall(name, rExec, rCompile, bCompute);
 
     if (p) p->m_next = pp;
     else m_ListCalls = pp;
@@ -641,6 +848,25 @@ CBotVar* MakeListVars(CBotVar** ppVars, bool bSetVal=false)
     return pVar;
 }
 
+// updates the elements of the instances given as parameters, since the
+// routine may read any of them; returns false if the execution must stop
+// and go on on the thread of the application
+
+static bool MajParams(CBotVar* pVar, CBotStack* pStack)
+{
+    for ( ; pVar != NULL ; pVar = pVar->GetNext() )
+    {
+        if ( pVar->GetType() != CBotTypPointer ) continue;
+
+        CBotVarClass*   pInstance = pVar->GetPointer();
+        if ( pInstance == NULL ) continue;
+
+        if ( pStack->WaitApp() ) return false;
+        pInstance->MajItems(pStack->GetPUser());
+    }
+    return true;
+}
+
 // is acceptable by a call procedure name
 // and given parameters
 
@@ -740,11 +966,19 @@ int CBotCall::DoCall(long& nIdent, CBotToken* token, CBotVar** ppVar, CBotStack*
 
 fund:
 #if !STACKRUN
+    if ( !pt->m_bCompute && pStack->WaitApp() ) return false;   // called on the thread of the application
+
     // lists the parameters depending on the contents of the stack (pStackVar)
 
     CBotVar*    pVar = MakeListVars(ppVar, true);
     CBotVar*    pVarToDelete = pVar;
 
+    if ( !MajParams(pVar, pStack) )
+    {
+        delete pVarToDelete;
+        return false;
+    }
+
     // creates a variable to the result
     CBotVar*    pResult = rettype.Eq(0) ? NULL : CBotVar::Create("", rettype);
 
@@ -836,6 +1070,9 @@ bool CBotCall::Run(CBotStack* pStack)
     CBotVar*    pResult = pile2->GetVar();
     CBotVar*    pRes = pResult;
 
+    if ( !m_bCompute && pStack->WaitApp() ) return false;   // called on the thread of the application
+    if ( !MajParams(pVar, pStack) ) return false;
+
     int         Exception = 0;
     int res = m_rExec(pVar, pResult, Exception, pStack->GetPUser());
 
@@ -937,6 +1174,12 @@ int CBotCallMethode::DoCall(long& nIdent, const char* name, CBotVar* pThis, CBot
     {
         if ( pt->m_nFuncIdent == nIdent )
         {
+            if ( pStack->WaitApp() ) return false;      // called on the thread of the application
+
+            // the routine may read any element of the instance
+            CBotVarClass*   pInstance = pThis->GetPointer();
+            if ( pInstance != NULL ) pInstance->MajItems(pStack->GetPUser());
+
             // lists the parameters depending on the contents of the stack (pStackVar)
 
             CBotVar*    pVar = MakeListVars(ppVars, true);
@@ -970,6 +1213,12 @@ int CBotCallMethode::DoCall(long& nIdent, const char* name, CBotVar* pThis, CBot
     {
         if ( pt->m_name == name )
         {
+            if ( pStack->WaitApp() ) return false;      // called on the thread of the application
+
+            // the routine may read any element of the instance
+            CBotVarClass*   pInstance = pThis->GetPointer();
+            if ( pInstance != NULL ) pInstance->MajItems(pStack->GetPUser());
+
             // lists the parameters depending on the contents of the stack (pStackVar)
 
             CBotVar*    pVar = MakeListVars(ppVars, true);
@@ -1003,16 +1252,9 @@ bool rSizeOf( CBotVar* pVar, CBotVar* pResult, int& ex, void* pUser )
 {
     if ( pVar == NULL ) return TX_LOWPARAM;
 
-    int i = 0;
-    pVar = pVar->GetItemList();
-
-    while ( pVar != NULL )
-    {
-        i++;
-        pVar = pVar->GetNext();
-    }
+    CBotVarClass*    pArray = pVar->GetPointer();
 
-    pResult->SetValInt(i);
+    pResult->SetValInt( pArray == NULL ? 0 : pArray->GetItemCount() );
     return true;
 }
 
@@ -1094,7 +1336,7 @@ void CBotProgram::Init()
     CBotToken::DefineNum( "CBotErrNoRun", 6004) ;       // active Run () without a function
     CBotToken::DefineNum( "CBotErrUndefFunc", 6005) ;   // Calling a function that no longer exists
 
-    CBotProgram::AddFunction("sizeof", rSizeOf, cSizeOf );
+    CBotProgram::AddFunction("sizeof", rSizeOf, cSizeOf, true );
 
     InitStringFunctions();
 
@@ -30,14 +30,17 @@
 // management of a execution of a stack
 ////////////////////////////////////////////////////////////////////////////
 
-int         CBotStack::m_initimer = ITIMER;
-int         CBotStack::m_timer = 0;
-CBotVar*    CBotStack::m_retvar = NULL;
-int         CBotStack::m_error = 0;
-int         CBotStack::m_start = 0;
-int         CBotStack::m_end   = 0;
-CBotString  CBotStack::m_labelBreak="";
-void*       CBotStack::m_pUser = NULL;
+thread_local int         CBotStack::m_initimer = ITIMER;
+thread_local int         CBotStack::m_timer = 0;
+thread_local CBotVar*    CBotStack::m_retvar = NULL;
+thread_local int         CBotStack::m_error = 0;
+thread_local int         CBotStack::m_start = 0;
+thread_local int         CBotStack::m_end   = 0;
+thread_local CBotString  CBotStack::m_labelBreak="";
+thread_local void*       CBotStack::m_pUser = NULL;
+thread_local bool        CBotStack::m_bCompute = false;
+thread_local bool        CBotStack::m_bWait = false;
+thread_local int         CBotStack::m_waitTimer = 0;
 
 #if    STACKMEM
 
@@ -106,8 +109,12 @@ void CBotStack::Delete()
             m_prev->m_next2 = NULL;        // removes chain
     }
 
+    ClearSlots();
+
     delete m_var;
     delete m_listVar;
+    delete m_vm;
+    delete[] m_slots;
 
     CBotStack*    p = m_prev;
     bool        bOver = m_bOver;
@@ -157,6 +164,7 @@ CBotStack* CBotStack::AddStack(CBotInstr* instr, bool bBlock)
     p->m_state         = 0;
     p->m_call         = NULL;
     p->m_bFunc         = false;
+    p->m_frame         = m_frame;
     return    p;
 }
 
@@ -197,6 +205,7 @@ CBotStack* CBotStack::AddStack2(bool bBlock)
     p->m_bBlock = bBlock;
     p->m_prog = m_prog;
     p->m_step = 0;
+    p->m_frame = m_frame;
     return    p;
 }
 
@@ -255,10 +264,15 @@ CBotStack::CBotStack(CBotStack* ppapa)
     m_listVar = NULL;
     m_bDontDelete = false;
 
+    m_frame   = (ppapa == NULL) ? NULL : ppapa->m_frame;
+    m_slots   = NULL;
+    m_nbSlots = 0;
+
     m_var      = NULL;
     m_prog      = NULL;
     m_instr      = NULL;
     m_call      = NULL;
+    m_vm      = NULL;
     m_bFunc      = false;
 }
 
@@ -270,8 +284,12 @@ CBotStack::~CBotStack()
     if (m_prev != NULL && m_prev->m_next == this )
             m_prev->m_next = NULL;        // removes chain
 
+    ClearSlots();
+
     delete m_var;
     if ( !m_bDontDelete ) delete m_listVar;
+    delete m_vm;
+    delete[] m_slots;
 }
 
 // \TODO routine has/to optimize
@@ -357,6 +375,7 @@ void CBotStack::Reset(void* pUser)
 //    m_end    = 0;
     m_labelBreak.Empty();
     m_pUser = pUser;
+    m_bWait = false;
 }
 
 
@@ -473,14 +492,14 @@ void CBotStack::SetType(CBotTypResult& type)
 CBotVar* CBotStack::FindVar(CBotToken* &pToken, bool bUpdate, bool bModif)
 {
     CBotStack*    p = this;
-    CBotString    name = pToken->GetString();
+    CBotString&   name = pToken->GetString();
 
     while (p != NULL)
     {
         CBotVar*    pp = p->m_listVar;
         while ( pp != NULL)
         {
-            if (pp->GetName() == name)
+            if (pp->m_token->GetString() == name)
             {
                 if ( bUpdate )
                     pp->Maj(m_pUser, false);
@@ -502,7 +521,7 @@ CBotVar* CBotStack::FindVar(const char* name)
         CBotVar*    pp = p->m_listVar;
         while ( pp != NULL)
         {
-            if (pp->GetName() == name)
+            if (pp->m_token->GetString() == name)
             {
                 return pp;
             }
@@ -536,6 +555,78 @@ CBotVar* CBotStack::FindVar(long ident, bool bUpdate, bool bModif)
 }
 
 
+// the slots of a function are given by CBotCStack::AddVar while compiling;
+// the identifier is checked, so that a variable of another function or of
+// an ended block is never taken for the good one
+
+CBotVar* CBotStack::FindLocal(long ident, int slot, bool bUpdate)
+{
+    if ( slot >= 0 && m_frame != NULL && slot < m_frame->m_nbSlots )
+    {
+        CBotVar*    pp = m_frame->m_slots[slot];
+        if ( pp != NULL && pp->m_ident == ident )
+        {
+            if ( bUpdate )
+                pp->Maj(m_pUser, false);
+
+            return pp;
+        }
+    }
+
+    CBotStack*    p = this;
+    while (p != NULL)
+    {
+        CBotVar*    pp = p->m_listVar;
+        while ( pp != NULL)
+        {
+            if (pp->m_ident == ident)
+            {
+                if ( slot >= 0 && p->m_frame != NULL )
+                    p->m_frame->SetSlot(slot, pp);    // found directly next time
+
+                if ( bUpdate )
+                    pp->Maj(m_pUser, false);
+
+                return pp;
+            }
+            pp = pp->m_next;
+        }
+        p = p->m_prev;
+    }
+    return NULL;
+}
+
+void CBotStack::SetSlot(int slot, CBotVar* var)
+{
+    if ( slot >= m_nbSlots )
+    {
+        int         n = slot + 8;
+        CBotVar**   slots = new CBotVar*[n];
+        for ( int i = 0 ; i < n ; i++ )
+            slots[i] = (i < m_nbSlots) ? m_slots[i] : NULL;
+
+        delete[] m_slots;
+        m_slots   = slots;
+        m_nbSlots = n;
+    }
+
+    m_slots[slot] = var;
+    var->m_slot = slot;
+}
+
+void CBotStack::ClearSlots()
+{
+    if ( m_frame == NULL || m_frame->m_slots == NULL ) return;
+
+    for ( CBotVar* pp = m_listVar ; pp != NULL ; pp = pp->m_next )
+    {
+        int slot = pp->m_slot;
+        if ( slot >= 0 && slot < m_frame->m_nbSlots && m_frame->m_slots[slot] == pp )
+            m_frame->m_slots[slot] = NULL;
+    }
+}
+
+
 CBotVar* CBotStack::FindVar(CBotToken& Token, bool bUpdate, bool bModif)
 {
     CBotToken*    pt = &Token;
@@ -601,6 +692,49 @@ void CBotStack::SetTimer(int n)
     m_initimer = n;
 }
 
+// the thread runs the programs without calling the application
+// returns the previous mode
+
+bool CBotStack::SetCompute(bool bCompute)
+{
+    bool    bOld = m_bCompute;
+    m_bCompute = bCompute;
+    return bOld;
+}
+
+// to be called before calling the application (external function, update
+// of an instance): returns true if the execution must stop here and go on
+// in Run() on the thread of the application, with the steps still left
+
+bool CBotStack::WaitApp()
+{
+    if ( !m_bCompute ) return false;
+
+    if ( !m_bWait )
+    {
+        m_bWait     = true;
+        m_waitTimer = m_timer;
+    }
+    return true;
+}
+
+bool CBotStack::IsWaiting()
+{
+    return m_bWait;
+}
+
+int CBotStack::GetWaitTimer()
+{
+    return m_waitTimer;
+}
+
+// continues an execution stopped by WaitApp(), after Reset()
+
+void CBotStack::ContinueWait(int timer)
+{
+    m_timer = timer;
+}
+
 bool CBotStack::Execute()
 {
     CBotCall*        instr = NULL;                        // the most highest instruction
@@ -710,6 +844,12 @@ void CBotStack::SetBotCall(CBotProgram* p)
 {
     m_prog  = p;
     m_bFunc = true;
+
+    if ( m_frame != this )
+    {
+        ClearSlots();           // were kept by the calling function
+        m_frame = this;
+    }
 }
 
 CBotProgram*  CBotStack::GetBotCall(bool bFirst)
@@ -726,37 +866,46 @@ void* CBotStack::GetPUser()
 }
 
 
-bool CBotStack::ExecuteCall(long& nIdent, CBotToken* token, CBotVar** ppVar, CBotTypResult& rettype)
+bool CBotStack::ExecuteCall(std::atomic<long>& nIdent, CBotToken* token, CBotVar** ppVar, CBotTypResult& rettype)
 {
     CBotTypResult        res;
 
+    // the function is looked for with a copy of the identifier, since other
+    // programs may run the same instruction (see CBotSharedCode); the
+    // identifier is only written when it was found again by name
+
+    long    ident = nIdent;
+
     // first looks by the identifier
 
-    res = CBotCall::DoCall(nIdent, NULL, ppVar, this, rettype );
+    res = CBotCall::DoCall(ident, NULL, ppVar, this, rettype );
     if (res.GetType() >= 0) return res.GetType();
 
-    res = m_prog->GetFunctions()->DoCall(nIdent, NULL, ppVar, this, token );
+    res = m_prog->GetFunctions()->DoCall(ident, NULL, ppVar, this, token );
     if (res.GetType() >= 0) return res.GetType();
 
     // if not found (recompile?) seeks by name
 
-    nIdent = 0;
-    res = CBotCall::DoCall(nIdent, token, ppVar, this, rettype );
-    if (res.GetType() >= 0) return res.GetType();
+    ident = 0;
+    res = CBotCall::DoCall(ident, token, ppVar, this, rettype );
+    if (res.GetType() < 0)
+        res = m_prog->GetFunctions()->DoCall(ident, token->GetString(), ppVar, this, token );
 
-    res = m_prog->GetFunctions()->DoCall(nIdent, token->GetString(), ppVar, this, token );
+    if ( ident != 0 ) nIdent = ident;
     if (res.GetType() >= 0) return res.GetType();
 
     SetError(TX_NOCALL, token);
     return true;
 }
 
-void CBotStack::RestoreCall(long& nIdent, CBotToken* token, CBotVar** ppVar)
+void CBotStack::RestoreCall(std::atomic<long>& nIdent, CBotToken* token, CBotVar** ppVar)
 {
     if ( m_next == NULL ) return;
 
-    if ( !CBotCall::RestoreCall(nIdent, token, ppVar, this) )
-        m_prog->GetFunctions()->RestoreCall(nIdent, token->GetString(), ppVar, this );
+    long    ident = nIdent;
+    if ( !CBotCall::RestoreCall(ident, token, ppVar, this) )
+        m_prog->GetFunctions()->RestoreCall(ident, token->GetString(), ppVar, this );
+    if ( ident != 0 && ident != nIdent ) nIdent = ident;
 }
 
 
@@ -871,10 +1020,30 @@ bool CBotStack::SaveState(FILE* pf)
         if (!WriteWord(pf, 1)) return false;                // a mark of pursuit
     }
     if (!WriteWord(pf, m_bBlock)) return false;            // is a local block
-    if (!WriteWord(pf, m_state)) return false;            // in what state?
-    if (!WriteWord(pf, 0)) return false;                // by compatibility m_bDontDelete
+    if ( m_vm != NULL )
+    {
+        if (!WriteWord(pf, m_vm->m_pc)) return false;    // at what operation?
+        if (!WriteWord(pf, 1)) return false;            // replaces m_bDontDelete: runs a bytecode
+    }
+    else
+    {
+        if (!WriteWord(pf, m_state)) return false;        // in what state?
+        if (!WriteWord(pf, 0)) return false;            // by compatibility m_bDontDelete
+    }
     if (!WriteWord(pf, m_step)) return false;            // in what state?
 
+    if ( m_vm != NULL )
+    {
+        // the values of the bytecode are saved as the variables of a level
+        CBotVar*    pStack;
+        CBotVar*    pLocals;
+        m_vm->Save(pStack, pLocals);
+        bool ok = SaveVar(pf, pStack) && SaveVar(pf, pLocals);
+        delete pStack;
+        delete pLocals;
+        if (!ok) return false;
+        return m_next->SaveState(pf);
+    }
 
     if (!SaveVar(pf, m_var)) return false;            // current result
     if (!SaveVar(pf, m_listVar)) return false;        // local variables
@@ -885,7 +1054,7 @@ bool CBotStack::SaveState(FILE* pf)
 
 bool CBotStack::RestoreState(FILE* pf, CBotStack* &pStack)
 {
-    unsigned short    w;
+    unsigned short    w, vm;
 
     pStack = NULL;
     if (!ReadWord(pf, w)) return false;
@@ -909,8 +1078,8 @@ bool CBotStack::RestoreState(FILE* pf, CBotStack* &pStack)
     if (!ReadWord(pf, w)) return false;            // in what state ?
     pStack->SetState(static_cast<short>(w));                    // in a good state
 
-    if (!ReadWord(pf, w)) return false;            // dont delete?
-                                                // uses more
+    if (!ReadWord(pf, vm)) return false;            // dont delete? uses more
+                                                // but says if a bytecode runs
 
     if (!ReadWord(pf, w)) return false;            // step by step
     pStack->m_step = w;
@@ -918,6 +1087,15 @@ bool CBotStack::RestoreState(FILE* pf, CBotStack* &pStack)
     if (!CBotVar::RestoreState(pf, pStack->m_var)) return false;    // temp variable
     if (!CBotVar::RestoreState(pf, pStack->m_listVar)) return false;// local variables
 
+    if ( vm == 1 )
+    {
+        pStack->m_vm = new CBotByteState();
+        pStack->m_vm->Restore(pStack->m_state, pStack->m_var, pStack->m_listVar);
+        delete pStack->m_var;        pStack->m_var = NULL;
+        pStack->ClearSlots();
+        delete pStack->m_listVar;    pStack->m_listVar = NULL;
+    }
+
     return pStack->RestoreState(pf, pStack->m_next);
 }
 
@@ -1141,6 +1319,7 @@ CBotCStack::CBotCStack(CBotCStack* ppapa)
 
     m_listVar = NULL;
     m_var      = NULL;
+    m_nbSlots  = -1;
 }
 
 // destructor
@@ -1254,14 +1433,14 @@ void CBotCStack::SetType(CBotTypResult& type)
 CBotVar* CBotCStack::FindVar(CBotToken* &pToken)
 {
     CBotCStack*    p = this;
-    CBotString    name = pToken->GetString();
+    CBotString&    name = pToken->GetString();
 
     while (p != NULL)
     {
         CBotVar*    pp = p->m_listVar;
         while ( pp != NULL)
         {
-            if (name == pp->GetName())
+            if (name == pp->m_token->GetString())
             {
                 return pp;
             }
@@ -1389,11 +1568,20 @@ void CBotCStack::AddVar(CBotVar* pVar)
 
     *pp = pVar;                    // added after
 
+    // gives it the next slot of its function
+    while (p != NULL && p->m_nbSlots < 0) p = p->m_prev;
+    if ( p != NULL ) pVar->m_slot = p->m_nbSlots++;
+
 #ifdef    _DEBUG
     if ( pVar->GetUniqNum() == 0 ) assert(0);
 #endif
 }
 
+void CBotCStack::StartFunction()
+{
+    m_nbSlots = 0;
+}
+
 // test whether a variable is already defined locally
 
 bool CBotCStack::CheckVarLocal(CBotToken* &pToken)
@@ -26,10 +26,8 @@
 #include "CBot.h"
 #include <cstdarg>
 
-CBotStringArray CBotToken::m_ListKeyWords;
-int CBotToken::m_ListIdKeyWords[200];
-CBotStringArray CBotToken::m_ListKeyDefine;
-long CBotToken::m_ListKeyNums[MAXDEFNUM];
+CBotNameTable CBotToken::m_ListKeyWords;
+CBotNameTable CBotToken::m_ListKeyDefine;
 
 //! contructors
 CBotToken::CBotToken()
@@ -100,7 +98,7 @@ CBotToken::~CBotToken()
 
 void CBotToken::Free()
 {
-    m_ListKeyDefine.SetSize(0);
+    m_ListKeyDefine.Empty();
 }
 
 const CBotToken& CBotToken::operator=(const CBotToken& src)
@@ -427,39 +425,25 @@ void CBotToken::Delete(CBotToken* pToken)
 
 int CBotToken::GetKeyWords(const char* w)
 {
-    int     i;
-    int     l = m_ListKeyWords.GetSize();
-
-    if (l == 0)
+    if (m_ListKeyWords.GetSize() == 0)
     {
         LoadKeyWords();                         // takes the list for the first time
-        l = m_ListKeyWords.GetSize();
     }
 
-    for (i = 0; i < l; i++)
-    {
-        if (m_ListKeyWords[i] == w) return m_ListIdKeyWords[ i ];
-    }
+    long    id;
+    if (m_ListKeyWords.Find(w, id)) return id;
 
     return -1;
 }
 
 bool CBotToken::GetKeyDefNum(const char* w, CBotToken* &token)
 {
-    int     i;
-    int     l = m_ListKeyDefine.GetSize();
+    long    val;
+    if (!m_ListKeyDefine.Find(w, val)) return false;
 
-    for (i = 0; i < l; i++)
-    {
-        if (m_ListKeyDefine[i] == w)
-        {
-            token->m_IdKeyWord = m_ListKeyNums[i];
-            token->m_type      = TokenTypDef;
-            return true;
-        }
-    }
-
-    return false;
+    token->m_IdKeyWord = val;
+    token->m_type      = TokenTypDef;
+    return true;
 }
 
 
@@ -471,52 +455,39 @@ bool CBotToken::GetKeyDefNum(const char* w, CBotToken* &token)
 void CBotToken::LoadKeyWords()
 {
     CBotString      s;
-    int             i, n = 0;
+    int             i;
 
     i = TokenKeyWord; //start with keywords of the language
     while (s.LoadString(i))
     {
-        m_ListKeyWords.Add(s);
-        m_ListIdKeyWords[n++] = i++;
+        m_ListKeyWords.Add(s, i++);
     }
 
     i = TokenKeyDeclare; //keywords of declarations
     while (s.LoadString(i))
     {
-        m_ListKeyWords.Add(s);
-        m_ListIdKeyWords[n++] = i++;
+        m_ListKeyWords.Add(s, i++);
     }
 
 
     i = TokenKeyVal;  //keywords of values
     while (s.LoadString(i))
     {
-        m_ListKeyWords.Add(s);
-        m_ListIdKeyWords[n++] = i++;
+        m_ListKeyWords.Add(s, i++);
     }
 
     i = TokenKeyOp; //operators
     while (s.LoadString(i))
     {
-        m_ListKeyWords.Add(s);
-        m_ListIdKeyWords[n++] = i++;
+        m_ListKeyWords.Add(s, i++);
     }
 }
 
 bool CBotToken::DefineNum(const char* name, long val)
 {
-    int     i;
-    int     l = m_ListKeyDefine.GetSize();
+    if ( m_ListKeyDefine.GetSize() == MAXDEFNUM ) return false;
 
-    for (i = 0; i < l; i++)
-    {
-        if (m_ListKeyDefine[i] == name) return false;
-    }
-    if ( i == MAXDEFNUM ) return false;
-
-    m_ListKeyDefine.Add( name );
-    m_ListKeyNums[i] = val;
-    return true;
+    return m_ListKeyDefine.Add( name, val );
 }
 
 bool IsOfType(CBotToken* &p, int type1, int type2)
@@ -556,3 +527,201 @@ bool IsOfTypeList(CBotToken* &p, int type1, ...)
     }
 }
 
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////
+// tokens of a text which is changed a little at a time
+
+CBotTokenList::CBotTokenList()
+{
+}
+
+void CBotTokenList::Update(const char* text, int& first, int& last)
+{
+    int     len    = strlen(text);
+    int     oldLen = m_text.size();
+
+    // the characters which changed: [begin, oldLen-same) before, [begin, len-same) now
+    int     begin = 0;
+    while ( begin < len && begin < oldLen && text[begin] == m_text[begin] ) begin++;
+    int     same = 0;
+    while ( same < len-begin && same < oldLen-begin &&
+            text[len-1-same] == m_text[oldLen-1-same] ) same++;
+
+    if ( begin == len && len == oldLen )                    // no change?
+    {
+        first = last = 0;
+        return;
+    }
+
+    // a token reads its word, its separators and at most the following character:
+    // the ones which end before the change are kept
+    int     size = m_spans.size();
+    int     i = 0;
+    while ( i < size && m_spans[i].next+1 < begin ) i++;
+
+    std::vector<CBotTokenSpan>  spans;                      // the tokens cut again
+    int     delta = len - oldLen;
+    int     end   = len - same;                             // end of the change in the new text
+    int     pos   = ( i == 0 ) ? 0 : m_spans[i].start;
+    int     j     = i;
+    int     error = 0;
+    char*   p     = const_cast<char*>(text) + pos;
+
+    while ( true )
+    {
+        // after the change, a token which starts where one started before is followed by the same ones
+        if ( pos >= end && i+spans.size() > 0 )
+        {
+            while ( j < size && m_spans[j].start < pos-delta ) j++;
+            if ( j > 0 && j < size && m_spans[j].start == pos-delta ) break;
+        }
+
+        char*       pp = p;
+        CBotToken*  token = CBotToken::NextToken(p, error, i+spans.size() == 0);
+        if ( token == NULL )
+        {
+            j = size;
+            break;
+        }
+
+        // as in CompileTokens()
+        CBotTokenSpan span;
+        span.start = pos;
+        pos += (p - pp);
+        span.end   = ( i+spans.size() == 0 ) ? token->GetString().GetLength() : pos - token->GetSep().GetLength();
+        span.next  = pos;
+        span.type  = token->GetType();
+        spans.push_back(span);
+
+        delete token;
+    }
+
+    // replaces the tokens [i, j) by the new ones, and moves the following ones
+    for ( int k = j; k < size; k++ )
+    {
+        m_spans[k].start += delta;
+        m_spans[k].end   += delta;
+        m_spans[k].next  += delta;
+    }
+    m_spans.erase(m_spans.begin()+i, m_spans.begin()+j);
+    m_spans.insert(m_spans.begin()+i, spans.begin(), spans.end());
+
+    first  = i;
+    last   = i+spans.size();
+    m_text = text;
+}
+
+void CBotTokenList::Empty()
+{
+    m_text.clear();
+    m_spans.clear();
+}
+
+int CBotTokenList::GetSize()
+{
+    return m_spans.size();
+}
+
+const CBotTokenSpan& CBotTokenList::GetSpan(int i)
+{
+    return m_spans[i];
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////
+// table of names
+
+CBotNameTable::CBotNameTable()
+{
+    m_entries = NULL;
+    m_size    = 0;
+    m_count   = 0;
+}
+
+CBotNameTable::~CBotNameTable()
+{
+    delete[] m_entries;
+}
+
+unsigned int CBotNameTable::Hash(const char* name)
+{
+    // FNV-1a
+    unsigned int hash = 2166136261u;
+    for ( const char* p = name; *p != 0; p++ )
+    {
+        hash ^= static_cast<unsigned char>(*p);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool CBotNameTable::Add(const char* name, long val)
+{
+    if ( (m_count+1)*2 > m_size ) Grow();
+
+    unsigned int hash = Hash(name);
+    int i = hash & (m_size-1);
+    while ( !m_entries[i].name.IsEmpty() )
+    {
+        if ( m_entries[i].hash == hash && m_entries[i].name == name ) return false;
+        i = (i+1) & (m_size-1);
+    }
+
+    m_entries[i].name = name;
+    m_entries[i].hash = hash;
+    m_entries[i].val  = val;
+    m_count++;
+    return true;
+}
+
+bool CBotNameTable::Find(const char* name, long& val) const
+{
+    if ( m_count == 0 ) return false;
+
+    unsigned int hash = Hash(name);
+    int i = hash & (m_size-1);
+    while ( !m_entries[i].name.IsEmpty() )          // the table is never full
+    {
+        if ( m_entries[i].hash == hash && m_entries[i].name == name )
+        {
+            val = m_entries[i].val;
+            return true;
+        }
+        i = (i+1) & (m_size-1);
+    }
+    return false;
+}
+
+int CBotNameTable::GetSize() const
+{
+    return m_count;
+}
+
+void CBotNameTable::Empty()
+{
+    delete[] m_entries;
+    m_entries = NULL;
+    m_size    = 0;
+    m_count   = 0;
+}
+
+void CBotNameTable::Grow()
+{
+    Entry*  old  = m_entries;
+    int     size = m_size;
+
+    m_size    = ( size == 0 ) ? 64 : size*2;
+    m_entries = new Entry[m_size];
+    m_count   = 0;
+
+    for ( int i = 0; i < size; i++ )
+    {
+        if ( old[i].name.IsEmpty() ) continue;
+
+        int j = old[i].hash & (m_size-1);
+        while ( !m_entries[j].name.IsEmpty() ) j = (j+1) & (m_size-1);
+        m_entries[j] = old[i];
+        m_count++;
+    }
+    delete[] old;
+}
@@ -34,6 +34,37 @@
 
 #pragma once
 
+// table of the keywords or of the names given by DefineNum, with their values
+// the names are hashed, so a word of the program is found without comparing it
+// to all the names (open addressing, the table is kept at most half full)
+class CBotNameTable
+{
+public:
+                CBotNameTable();
+                ~CBotNameTable();
+
+    bool        Add(const char* name, long val);    // false if the name is already there
+    bool        Find(const char* name, long& val) const;
+    int         GetSize() const;
+    void        Empty();
+
+private:
+    static
+    unsigned int Hash(const char* name);
+    void        Grow();
+
+    struct Entry
+    {
+        CBotString      name;                       // empty if the entry is free
+        unsigned int    hash;
+        long            val;
+    };
+
+    Entry*      m_entries;
+    int         m_size;                             // a power of 2, or 0
+    int         m_count;
+};
+
 extern bool IsOfType(CBotToken* &p, int type1, int type2 = -1);
 extern bool IsOfTypeList(CBotToken* &p, int type1, ...);
 
@@ -25,6 +25,16 @@
 #include <cassert>
 #include <cmath>
 #include <cstdio>
+#include <mutex>
+
+
+namespace {
+
+// the unique numbers and the list of the instances are shared
+// by the programs, which may run on several threads at the same time
+std::mutex g_sharedMutex;
+
+} // anonymous namespace
 
 long CBotVar::m_identcpt = 0;
 
@@ -38,6 +48,7 @@ CBotVar::CBotVar( )
     m_type  = -1;
     m_binit = false;
     m_ident = 0;
+    m_slot = -1;
     m_bStatic = false;
     m_mPrivate = 0;
 }
@@ -135,6 +146,9 @@ void CBotVarClass::InitCBotVarClass( const CBotToken* name, CBotTypResult& type
     m_InitExpr = NULL;
     m_LimExpr = NULL;
     m_pVar        = NULL;
+    m_pItems    = NULL;
+    m_nItems    = 0;
+    m_maxItems    = 0;
     m_type        = type;
     if ( type.Eq(CBotTypArrayPointer) )    m_type.SetType( CBotTypArrayBody );
     else if ( !type.Eq(CBotTypArrayBody) ) m_type.SetType( CBotTypClass );
@@ -146,15 +160,19 @@ void CBotVarClass::InitCBotVarClass( const CBotToken* name, CBotTypResult& type
     m_bStatic    = false;
     m_mPrivate    = 0;
     m_bConstructor = false;
+    m_bShared = false;
     m_CptUse    = 0;
     m_ItemIdent = type.Eq(CBotTypIntrinsic) ? 0 : CBotVar::NextUniqNum();
 
     // se place tout seul dans la liste
     // TODO stands alone in the list (stands only in a list)
-    if (m_ExClass) m_ExClass->m_ExPrev = this;
-    m_ExNext  = m_ExClass;
-    m_ExPrev  = NULL;
-    m_ExClass = this;
+    {
+        std::lock_guard<std::mutex> lock(g_sharedMutex);
+        if (m_ExClass) m_ExClass->m_ExPrev = this;
+        m_ExNext  = m_ExClass;
+        m_ExPrev  = NULL;
+        m_ExClass = this;
+    }
 
     CBotClass* pClass = type.GetClass();
     CBotClass* pClass2 = pClass->GetParent();
@@ -181,14 +199,18 @@ CBotVarClass::~CBotVarClass( )
 //        m_Indirect->DecrementUse();
 
     // removes the class list
-    if ( m_ExPrev ) m_ExPrev->m_ExNext = m_ExNext;
-    else m_ExClass = m_ExNext;
+    {
+        std::lock_guard<std::mutex> lock(g_sharedMutex);
+        if ( m_ExPrev ) m_ExPrev->m_ExNext = m_ExNext;
+        else m_ExClass = m_ExNext;
 
-    if ( m_ExNext ) m_ExNext->m_ExPrev = m_ExPrev;
-    m_ExPrev = NULL;
-    m_ExNext = NULL;
+        if ( m_ExNext ) m_ExNext->m_ExPrev = m_ExPrev;
+        m_ExPrev = NULL;
+        m_ExNext = NULL;
+    }
 
     delete    m_pVar;
+    delete[]  m_pItems;
 }
 
 void CBotVarClass::ConstructorSet()
@@ -249,6 +271,7 @@ void CBotVar::SetUniqNum(long n)
 
 long CBotVar::NextUniqNum()
 {
+    std::lock_guard<std::mutex> lock(g_sharedMutex);
     if (++m_identcpt < 10000) m_identcpt = 10000;
     return m_identcpt;
 }
@@ -258,6 +281,11 @@ long CBotVar::GetUniqNum()
     return m_ident;
 }
 
+int CBotVar::GetSlot()
+{
+    return m_slot;
+}
+
 
 void* CBotVar::GetUserPtr()
 {
@@ -615,6 +643,7 @@ void CBotVar::SetVal(CBotVar* var)
         {
             delete (static_cast<CBotVarClass*>(this))->m_pVar;
             (static_cast<CBotVarClass*>(this))->m_pVar = NULL;
+            (static_cast<CBotVarClass*>(this))->ClearItems();
             Copy(var, false);
         }
         break;
@@ -1425,6 +1454,7 @@ void CBotVarClass::Copy(CBotVar* pSrc, bool bName)
 
     delete        m_pVar;
     m_pVar        = NULL;
+    ClearItems();
 
     CBotVar*    pv = p->m_pVar;
     while( pv != NULL )
@@ -1442,6 +1472,7 @@ void CBotVarClass::SetItemList(CBotVar* pVar)
 {
     delete    m_pVar;
     m_pVar    = pVar;    // replaces the existing pointer
+    ClearItems();
 }
 
 void CBotVarClass::SetIdent(long n)
@@ -1460,6 +1491,7 @@ void CBotVarClass::SetClass(CBotClass* pClass)//, int &nIdent)
     // initializes the variables associated with this class
     delete m_pVar;
     m_pVar = NULL;
+    ClearItems();
 
     if (pClass == NULL) return;
 
@@ -1529,6 +1561,9 @@ void CBotVarClass::Maj(void* pUser, bool bContinu)
 /*    if (!bContinu && m_pMyThis != NULL)
         m_pMyThis->Maj(pUser, true);*/
 
+    // an instance of another program is only used on the thread of the application
+    if ( m_bShared && CBotStack::WaitApp() ) return;    // the caller stops, see CBotProgram::RunCompute()
+
     // an update routine exist?
 
     if ( m_pClass->m_rMaj == NULL ) return;
@@ -1539,9 +1574,41 @@ void CBotVarClass::Maj(void* pUser, bool bContinu)
     if ( m_pUserPtr != NULL) pUser = m_pUserPtr;
     if ( pUser == OBJECTDELETED ||
          pUser == OBJECTCREATED ) return;
+    if ( CBotStack::WaitApp() ) return;        // the caller stops, see CBotProgram::RunCompute()
     m_pClass->m_rMaj( this, pUser );
 }
 
+// the routines given by CBotClass::AddUpdateFunc(name, ...) update one
+// element only, when it is read, instead of all the elements of the instance
+
+void CBotVarClass::MajItem(CBotVar* pItem, void* pUser)
+{
+    long        n = pItem->GetUniqNum();
+    CBotClass*  pClass = m_pClass;
+
+    while ( pClass != NULL &&
+            (n <= 0 || n >= pClass->m_nbMajItem || pClass->m_rMajItem[n] == NULL) )
+        pClass = pClass->GetParent();
+    if ( pClass == NULL ) return;
+
+    if ( m_pUserPtr != NULL) pUser = m_pUserPtr;
+    if ( pUser == OBJECTDELETED ||
+         pUser == OBJECTCREATED ) return;
+    if ( CBotStack::WaitApp() ) return;        // the caller stops, see CBotProgram::RunCompute()
+    pClass->m_rMajItem[n]( pItem, pUser );
+}
+
+void CBotVarClass::MajItems(void* pUser)
+{
+    if ( m_pClass == NULL ) return;            // an array
+
+    for ( CBotVar* pv = m_pVar ; pv != NULL ; pv = pv->GetNext() )
+    {
+        if ( !pv->IsStatic() ) MajItem(pv, pUser);
+    }
+    if ( m_pParent != NULL ) m_pParent->MajItems(pUser);
+}
+
 CBotVar* CBotVarClass::GetItem(const char* name)
 {
     CBotVar*    p = m_pVar;
@@ -1575,37 +1642,67 @@ CBotVar* CBotVarClass::GetItemRef(int nIdent)
 
 CBotVar* CBotVarClass::GetItem(int n, bool bExtend)
 {
-    CBotVar*    p = m_pVar;
-
     if ( n < 0 ) return NULL;
     if ( n > MAXARRAYSIZE ) return NULL;
 
     if ( m_type.GetLimite() >= 0 && n >= m_type.GetLimite() ) return NULL;
 
-    if ( p == NULL && bExtend )
-    {
-        p = CBotVar::Create("", m_type.GetTypElem());
-        m_pVar = p;
-    }
+    if ( n >= m_nItems ) IndexItems(n, bExtend);
+    if ( n >= m_nItems ) return NULL;
 
-    if ( n == 0 ) return p;
+    return m_pItems[n];
+}
 
-    while ( n-- > 0 )
+CBotVar* CBotVarClass::GetItemList()
+{
+    return m_pVar;
+}
+
+int CBotVarClass::GetItemCount()
+{
+    IndexItems(-1, false);
+    return m_nItems;
+}
+
+// the elements stay chained in m_pVar, for GetItemList() and the saved state;
+// m_pItems gives the first m_nItems of them directly, the others are
+// indexed when reached, from the last one indexed
+// n < 0 indexes all the elements of the list
+
+void CBotVarClass::IndexItems(int n, bool bExtend)
+{
+    CBotVar*    p = (m_nItems == 0) ? m_pVar : m_pItems[m_nItems-1]->m_next;
+
+    while ( n < 0 || m_nItems <= n )
     {
-        if ( p->m_next == NULL )
+        if ( p == NULL )
+        {
+            if ( n < 0 || !bExtend ) return;
+
+            p = CBotVar::Create("", m_type.GetTypElem());
+            if ( m_nItems == 0 ) m_pVar = p;
+            else m_pItems[m_nItems-1]->m_next = p;
+        }
+
+        if ( m_nItems == m_maxItems )
         {
-            if ( bExtend ) p->m_next = CBotVar::Create("", m_type.GetTypElem());
-            if ( p->m_next == NULL ) return NULL;
+            int         max = (m_maxItems == 0) ? 16 : m_maxItems * 2;
+            CBotVar**   items = new CBotVar*[max];
+            for ( int i = 0 ; i < m_nItems ; i++ ) items[i] = m_pItems[i];
+
+            delete[] m_pItems;
+            m_pItems   = items;
+            m_maxItems = max;
         }
+
+        m_pItems[m_nItems++] = p;
         p = p->m_next;
     }
-
-    return p;
 }
 
-CBotVar* CBotVarClass::GetItemList()
+void CBotVarClass::ClearItems()
 {
-    return m_pVar;
+    m_nItems = 0;
 }
 
 
@@ -1617,6 +1714,8 @@ CBotString CBotVarClass::GetValString()
 
     if ( m_pClass != NULL )                        // not used for an array
     {
+        MajItems(NULL);
+
         res = m_pClass->GetName() + CBotString("( ");
 
         CBotVarClass*    my = this;
@@ -1672,8 +1771,7 @@ void CBotVarClass::IncrementUse()
 
 void CBotVarClass::DecrementUse()
 {
-    m_CptUse--;
-    if ( m_CptUse == 0 )
+    if ( --m_CptUse == 0 )
     {
         // if there is one, call the destructor
         // but only if a constructor had been called.
@@ -1687,6 +1785,9 @@ void CBotVarClass::DecrementUse()
             CBotStack*    pile = NULL;
             err = pile->GetError(start,end);    // stack == NULL it does not bother!
 
+            // the destructor runs to its end here, even from CBotProgram::RunCompute()
+            bool    bCompute = CBotStack::SetCompute(false);
+
             pile = CBotStack::FirstStack();        // clears the error
             CBotVar*    ppVars[1];
             ppVars[0] = NULL;
@@ -1696,11 +1797,12 @@ void CBotVarClass::DecrementUse()
             CBotVar*    pResult = NULL;
 
             CBotString    nom = "~" + m_pClass->GetName();
-            long        ident = 0;
+            std::atomic<long>   ident(0);
 
             while ( pile->IsOk() && !m_pClass->ExecuteMethode(ident, nom, pThis, ppVars, pResult, pile, NULL)) ;    // waits for the end
 
             pile->ResetError(err, start,end);
+            CBotStack::SetCompute(bCompute);
 
             pile->Delete();
             delete pThis;
@@ -1716,11 +1818,29 @@ CBotVarClass* CBotVarClass::GetPointer()
     return this;
 }
 
+bool CBotVarClass::IsShared()
+{
+    return m_bShared;
+}
+
+// an instance read from a static field, or from another shared instance,
+// may be used by several programs; they can only use it on the thread
+// of the application from now on (see CBotProgram::RunCompute)
+
+void CBotVarClass::SetShared(CBotVar* pVar)
+{
+    if ( pVar->GetType() < CBotTypArrayPointer ) return;    // not an instance
+
+    CBotVarClass*    pInstance = pVar->GetPointer();
+    if ( pInstance != NULL ) pInstance->m_bShared = true;
+}
+
 
 // makes an instance according to its unique number
 
 CBotVarClass* CBotVarClass::Find(long id)
 {
+    std::lock_guard<std::mutex> lock(g_sharedMutex);
     CBotVarClass*    p = m_ExClass;
 
     while ( p != NULL )
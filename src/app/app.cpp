@@ -26,8 +26,10 @@
 #include "common/iman.h"
 #include "common/image.h"
 #include "common/key.h"
+#include "common/profiler.h"
 #include "common/stringutils.h"
 
+#include "graphics/core/nulldevice.h"
 #include "graphics/engine/modelmanager.h"
 #include "graphics/opengl/gldevice.h"
 
@@ -52,6 +54,23 @@
 
 template<> CApplication* CSingleton<CApplication>::m_instance = nullptr;
 
+//! Names of performance counters in the profiler trace
+const char* PERFORMANCE_COUNTER_NAMES[PCNT_MAX] =
+{
+    "Event processing",
+    "Update",
+    "Engine update",
+    "Particle update",
+    "Game update",
+    "Render",
+    "Particle render",
+    "Water render",
+    "Terrain render",
+    "Objects render",
+    "Interface render",
+    "Frame"
+};
+
 //! Static buffer for putenv locale
 static char S_LANGUAGE[50] = { 0 };
 
@@ -59,6 +78,9 @@ static char S_LANGUAGE[50] = { 0 };
 //! Interval of timer called to update joystick state
 const int JOYSTICK_TIMER_INTERVAL = 1000/30;
 
+//! Default duration of one update in headless mode [seconds]
+const float HEADLESS_DEFAULT_STEP = 1.0f/30.0f;
+
 //! Function called by the timer
 Uint32 JoystickTimerCallback(Uint32 interval, void *);
 
@@ -102,6 +124,7 @@ CApplication::CApplication()
     m_eventQueue    = new CEventQueue();
     m_profile       = new CProfile();
     m_gameData      = new CGameData();
+    m_profiler      = new CProfiler();
 
     m_engine    = nullptr;
     m_device    = nullptr;
@@ -120,6 +143,8 @@ CApplication::CApplication()
 
     m_simulationSpeed = 1.0f;
 
+    m_fixedStep = 0LL;
+
     m_realAbsTimeBase = 0LL;
     m_realAbsTime = 0LL;
     m_realRelTime = 0LL;
@@ -157,6 +182,9 @@ CApplication::CApplication()
     
     m_sceneTest = false;
 
+    m_headless = false;
+    m_headlessTime = 0.0f;
+
     m_language = LANGUAGE_ENV;
 
     m_lowCPU = true;
@@ -184,6 +212,9 @@ CApplication::~CApplication()
     delete m_gameData;
     m_gameData = nullptr;
 
+    delete m_profiler;
+    m_profiler = nullptr;
+
     GetSystemUtils()->DestroyTimeStamp(m_baseTimeStamp);
     GetSystemUtils()->DestroyTimeStamp(m_curTimeStamp);
     GetSystemUtils()->DestroyTimeStamp(m_lastTimeStamp);
@@ -213,6 +244,10 @@ ParseArgsStatus CApplication::ParseArguments(int argc, char *argv[])
         OPT_DEBUG,
         OPT_RUNSCENE,
         OPT_SCENETEST,
+        OPT_HEADLESS,
+        OPT_SIMTIME,
+        OPT_TIMESTEP,
+        OPT_PROFILE,
         OPT_LOGLEVEL,
         OPT_LANGUAGE,
         OPT_DATADIR,
@@ -227,6 +262,10 @@ ParseArgsStatus CApplication::ParseArguments(int argc, char *argv[])
         { "debug", required_argument, nullptr, OPT_DEBUG },
         { "runscene", required_argument, nullptr, OPT_RUNSCENE },
         { "scenetest", no_argument, nullptr, OPT_SCENETEST },
+        { "headless", no_argument, nullptr, OPT_HEADLESS },
+        { "simtime", required_argument, nullptr, OPT_SIMTIME },
+        { "timestep", required_argument, nullptr, OPT_TIMESTEP },
+        { "profile", required_argument, nullptr, OPT_PROFILE },
         { "loglevel", required_argument, nullptr, OPT_LOGLEVEL },
         { "language", required_argument, nullptr, OPT_LANGUAGE },
         { "datadir", required_argument, nullptr, OPT_DATADIR },
@@ -267,6 +306,10 @@ ParseArgsStatus CApplication::ParseArguments(int argc, char *argv[])
                 GetLogger()->Message("  -debug modes        enable debug modes (more info printed in logs; see code for reference of modes)\n");
                 GetLogger()->Message("  -runscene sceneNNN  run given scene on start\n");
                 GetLogger()->Message("  -scenetest          win every mission right after it's loaded\n");
+                GetLogger()->Message("  -headless           run the scene given by -runscene without window, sound and rendering\n");
+                GetLogger()->Message("  -simtime seconds    in headless mode, stop after given simulated time\n");
+                GetLogger()->Message("  -timestep seconds   advance the simulation by fixed steps of given duration\n");
+                GetLogger()->Message("  -profile file       time each frame and save a Chrome trace to file at exit\n");
                 GetLogger()->Message("  -loglevel level     set log level to level (one of: trace, debug, info, warn, error, none)\n");
                 GetLogger()->Message("  -language lang      set language (one of: en, de, fr, pl, ru)\n");
                 GetLogger()->Message("  -datadir path       set custom data directory path\n");
@@ -308,6 +351,41 @@ ParseArgsStatus CApplication::ParseArguments(int argc, char *argv[])
                 m_sceneTest = true;
                 break;
             }
+            case OPT_HEADLESS:
+            {
+                m_headless = true;
+                break;
+            }
+            case OPT_SIMTIME:
+            {
+                m_headlessTime = StrUtils::FromString<float>(optarg);
+                if (m_headlessTime <= 0.0f)
+                {
+                    GetLogger()->Error("Invalid simulated time: '%s'\n", optarg);
+                    return PARSE_ARGS_FAIL;
+                }
+                break;
+            }
+            case OPT_TIMESTEP:
+            {
+                float step = StrUtils::FromString<float>(optarg);
+                if (step <= 0.0f)
+                {
+                    GetLogger()->Error("Invalid time step: '%s'\n", optarg);
+                    return PARSE_ARGS_FAIL;
+                }
+                m_fixedStep = static_cast<long long>(step * 1e9f);
+                GetLogger()->Info("Using fixed time step of %f s\n", step);
+                break;
+            }
+            case OPT_PROFILE:
+            {
+                m_profilerFile = optarg;
+                m_profiler->SetEnabled(true);
+                m_profiler->SetThreadName("Main");
+                GetLogger()->Info("Profiling to '%s'\n", optarg);
+                break;
+            }
             case OPT_LOGLEVEL:
             {
                 LogLevel logLevel;
@@ -376,6 +454,21 @@ ParseArgsStatus CApplication::ParseArguments(int argc, char *argv[])
         }
     }
 
+    if (m_headless)
+    {
+        if (m_runSceneName.empty())
+        {
+            GetLogger()->Error("Headless mode needs a scene given by -runscene\n");
+            m_exitCode = 1;
+            return PARSE_ARGS_FAIL;
+        }
+
+        if (m_fixedStep == 0LL)
+            m_fixedStep = static_cast<long long>(HEADLESS_DEFAULT_STEP * 1e9f);
+
+        GetLogger()->Info("Running headless\n");
+    }
+
     return PARSE_ARGS_OK;
 }
 
@@ -424,12 +517,20 @@ bool CApplication::Create()
     SetLanguage(m_language);
 
     //Create the sound instance.
-    #ifdef OPENAL_SOUND
-    m_sound = static_cast<CSoundInterface *>(new ALSound());
-    #else
-    GetLogger()->Info("No sound support.\n");
-    m_sound = new CSoundInterface();
-    #endif
+    if (m_headless)
+    {
+        // The base interface plays nothing
+        m_sound = new CSoundInterface();
+    }
+    else
+    {
+        #ifdef OPENAL_SOUND
+        m_sound = static_cast<CSoundInterface *>(new ALSound());
+        #else
+        GetLogger()->Info("No sound support.\n");
+        m_sound = new CSoundInterface();
+        #endif
+    }
 
     m_sound->Create();
     m_sound->CacheAll();
@@ -444,7 +545,9 @@ bool CApplication::Create()
     /* SDL initialization sequence */
 
 
-    Uint32 initFlags = SDL_INIT_VIDEO | SDL_INIT_TIMER;
+    Uint32 initFlags = SDL_INIT_TIMER;
+    if (! m_headless)
+        initFlags |= SDL_INIT_VIDEO;
 
     if (SDL_Init(initFlags) < 0)
     {
@@ -456,7 +559,7 @@ bool CApplication::Create()
     }
 
     // This is non-fatal and besides seems to fix some memory leaks
-    if (SDL_InitSubSystem(SDL_INIT_JOYSTICK) < 0)
+    if (!m_headless && SDL_InitSubSystem(SDL_INIT_JOYSTICK) < 0)
     {
         GetLogger()->Warn("Joystick subsystem init failed\nJoystick(s) will not be available\n");
     }
@@ -470,44 +573,53 @@ bool CApplication::Create()
         return false;
     }
 
-    // load settings from profile
-    int iValue;
-    if ( GetProfile().GetLocalProfileInt("Setup", "Resolution", iValue) )
+    if (m_headless)
     {
-        std::vector<Math::IntPoint> modes;
-        GetVideoResolutionList(modes, true, true);
-        if (static_cast<unsigned int>(iValue) < modes.size())
-            m_deviceConfig.size = modes.at(iValue);
+        // No window; nothing is drawn
+        m_device = new Gfx::CNullDevice();
     }
-
-    if ( GetProfile().GetLocalProfileInt("Setup", "Fullscreen", iValue) )
+    else
     {
-        m_deviceConfig.fullScreen = (iValue == 1);
-    }
+        // load settings from profile
+        int iValue;
+        if ( GetProfile().GetLocalProfileInt("Setup", "Resolution", iValue) )
+        {
+            std::vector<Math::IntPoint> modes;
+            GetVideoResolutionList(modes, true, true);
+            if (static_cast<unsigned int>(iValue) < modes.size())
+                m_deviceConfig.size = modes.at(iValue);
+        }
 
-    if (! CreateVideoSurface())
-        return false; // dialog is in function
+        if ( GetProfile().GetLocalProfileInt("Setup", "Fullscreen", iValue) )
+        {
+            m_deviceConfig.fullScreen = (iValue == 1);
+        }
 
-    if (m_private->surface == nullptr)
-    {
-        m_errorMessage = std::string("SDL error while setting video mode:\n") +
-                         std::string(SDL_GetError());
-        GetLogger()->Error(m_errorMessage.c_str());
-        m_exitCode = 4;
-        return false;
-    }
+        if (! CreateVideoSurface())
+            return false; // dialog is in function
 
-    SDL_WM_SetCaption(m_windowTitle.c_str(), m_windowTitle.c_str());
+        if (m_private->surface == nullptr)
+        {
+            m_errorMessage = std::string("SDL error while setting video mode:\n") +
+                             std::string(SDL_GetError());
+            GetLogger()->Error(m_errorMessage.c_str());
+            m_exitCode = 4;
+            return false;
+        }
 
-    // Enable translating key codes of key press events to unicode chars
-    SDL_EnableUNICODE(1);
-    SDL_EnableKeyRepeat(SDL_DEFAULT_REPEAT_DELAY, SDL_DEFAULT_REPEAT_INTERVAL);
+        SDL_WM_SetCaption(m_windowTitle.c_str(), m_windowTitle.c_str());
 
-    // Don't generate joystick events
-    SDL_JoystickEventState(SDL_IGNORE);
+        // Enable translating key codes of key press events to unicode chars
+        SDL_EnableUNICODE(1);
+        SDL_EnableKeyRepeat(SDL_DEFAULT_REPEAT_DELAY, SDL_DEFAULT_REPEAT_INTERVAL);
+
+        // Don't generate joystick events
+        SDL_JoystickEventState(SDL_IGNORE);
+
+        // The video is ready, we can create and initalize the graphics device
+        m_device = new Gfx::CGLDevice(m_deviceConfig);
+    }
 
-    // The video is ready, we can create and initalize the graphics device
-    m_device = new Gfx::CGLDevice(m_deviceConfig);
     if (! m_device->Create() )
     {
         m_errorMessage = std::string("Error in CDevice::Create()\n") + standardInfoMessage;
@@ -598,6 +710,12 @@ void CApplication::Destroy()
 {
     m_joystickEnabled = false;
 
+    if (!m_profilerFile.empty())
+    {
+        m_profiler->SetEnabled(false);
+        m_profiler->ExportTrace(m_profilerFile);
+    }
+
     if (m_robotMain != nullptr)
     {
         delete m_robotMain;
@@ -820,6 +938,9 @@ void CApplication::UpdateMouse()
 
 int CApplication::Run()
 {
+    if (m_headless)
+        return RunHeadless();
+
     m_active = true;
 
     GetSystemUtils()->GetCurrentTimeStamp(m_baseTimeStamp);
@@ -830,6 +951,7 @@ int CApplication::Run()
 
     while (true)
     {
+        m_profiler->BeginFrame();
         ResetPerformanceCounters();
 
         if (m_active)
@@ -968,6 +1090,85 @@ end:
     return m_exitCode;
 }
 
+/** There are no system events and nothing is rendered; the simulation is
+    advanced by m_fixedStep at each update, regardless of the time it takes. */
+int CApplication::RunHeadless()
+{
+    m_active = true;
+    m_exitCode = HEADLESS_EXIT_TIMEOUT;
+
+    float simulatedTime = 0.0f;
+
+    while (m_headlessTime == 0.0f || simulatedTime < m_headlessTime)
+    {
+        m_profiler->BeginFrame();
+        ResetPerformanceCounters();
+
+        StartPerformanceCounter(PCNT_ALL);
+        StartPerformanceCounter(PCNT_EVENT_PROCESSING);
+
+        Event event;
+        while (m_eventQueue->GetEvent(event))
+        {
+            if (event.type == EVENT_SYS_QUIT || event.type == EVENT_QUIT)
+                goto end; // exit both loops
+
+            if (event.type == EVENT_WIN || event.type == EVENT_LOST)
+            {
+                m_exitCode = (event.type == EVENT_WIN) ? HEADLESS_EXIT_WIN : HEADLESS_EXIT_LOST;
+                GetLogger()->Info("Mission %s after %.2f s of simulated time\n",
+                                  event.type == EVENT_WIN ? "won" : "lost", simulatedTime);
+                goto end;
+            }
+
+            LogEvent(event);
+
+            bool passOn = true;
+            if (m_engine != nullptr)
+                passOn = m_engine->ProcessEvent(event);
+
+            if (passOn && m_robotMain != nullptr)
+                m_robotMain->ProcessEvent(event);
+        }
+
+        StopPerformanceCounter(PCNT_EVENT_PROCESSING);
+
+        StartPerformanceCounter(PCNT_UPDATE_ALL);
+
+        event = CreateUpdateEvent();
+        if (event.type != EVENT_NULL && m_robotMain != nullptr)
+        {
+            LogEvent(event);
+
+            m_sound->FrameMove(m_relTime);
+
+            StartPerformanceCounter(PCNT_UPDATE_GAME);
+            m_robotMain->ProcessEvent(event);
+            StopPerformanceCounter(PCNT_UPDATE_GAME);
+
+            StartPerformanceCounter(PCNT_UPDATE_ENGINE);
+            m_engine->FrameUpdate();
+            StopPerformanceCounter(PCNT_UPDATE_ENGINE);
+
+            if (m_robotMain->GetPhase() == PHASE_SIMUL)
+                simulatedTime += m_relTime;
+        }
+
+        StopPerformanceCounter(PCNT_UPDATE_ALL);
+
+        StopPerformanceCounter(PCNT_ALL);
+
+        UpdatePerformanceCountersData();
+    }
+
+    GetLogger()->Info("Mission not finished after %.2f s of simulated time\n", simulatedTime);
+
+end:
+    Destroy();
+
+    return m_exitCode;
+}
+
 int CApplication::GetExitCode() const
 {
     return m_exitCode;
@@ -1296,6 +1497,28 @@ Event CApplication::CreateUpdateEvent()
     if (m_simulationSuspended)
         return Event(EVENT_NULL);
 
+    if (m_fixedStep != 0LL)
+    {
+        // Every update lasts the same, whatever the real time taken
+        m_realRelTime = m_fixedStep;
+        m_realAbsTime += m_realRelTime;
+
+        m_exactRelTime = m_simulationSpeed * m_realRelTime;
+        m_exactAbsTime += m_exactRelTime;
+
+        m_absTime = m_exactAbsTime / 1e9f;
+        m_relTime = m_exactRelTime / 1e9f;
+
+        Event frameEvent(EVENT_FRAME);
+        frameEvent.trackedKeysState = m_trackedKeys;
+        frameEvent.kmodState = m_kmodState;
+        frameEvent.mousePos = m_mousePos;
+        frameEvent.mouseButtonsState = m_mouseButtonsState;
+        frameEvent.rTime = m_relTime;
+
+        return frameEvent;
+    }
+
     GetSystemUtils()->CopyTimeStamp(m_lastTimeStamp, m_curTimeStamp);
     GetSystemUtils()->GetCurrentTimeStamp(m_curTimeStamp);
 
@@ -1496,11 +1719,17 @@ void CApplication::ResetKeyStates()
 
 void CApplication::SetGrabInput(bool grab)
 {
+    if (m_headless)
+        return;
+
     SDL_WM_GrabInput(grab ? SDL_GRAB_ON : SDL_GRAB_OFF);
 }
 
 bool CApplication::GetGrabInput() const
 {
+    if (m_headless)
+        return false;
+
     int result = SDL_WM_GrabInput(SDL_GRAB_QUERY);
     return result == SDL_GRAB_ON;
 }
@@ -1508,6 +1737,9 @@ bool CApplication::GetGrabInput() const
 void CApplication::SetMouseMode(MouseMode mode)
 {
     m_mouseMode = mode;
+    if (m_headless)
+        return;
+
     if ((m_mouseMode == MOUSE_SYSTEM) || (m_mouseMode == MOUSE_BOTH))
         SDL_ShowCursor(SDL_ENABLE);
     else
@@ -1527,6 +1759,8 @@ Math::Point CApplication::GetMousePos() const
 void CApplication::MoveMouse(Math::Point pos)
 {
     m_mousePos = pos;
+    if (m_headless)
+        return;
 
     Math::IntPoint windowPos = m_engine->InterfaceToWindowCoords(pos);
     SDL_WarpMouse(windowPos.x, windowPos.y);
@@ -1747,10 +1981,16 @@ bool CApplication::GetLowCPU() const
 void CApplication::StartPerformanceCounter(PerformanceCounter counter)
 {
     GetSystemUtils()->GetCurrentTimeStamp(m_performanceCounters[counter][0]);
+
+    if (CProfiler::IsEnabled())
+        m_profiler->Begin(PERFORMANCE_COUNTER_NAMES[counter]);
 }
 
 void CApplication::StopPerformanceCounter(PerformanceCounter counter)
 {
+    if (CProfiler::IsEnabled())
+        m_profiler->End();
+
     GetSystemUtils()->GetCurrentTimeStamp(m_performanceCounters[counter][1]);
 }
 
@@ -1763,8 +2003,8 @@ void CApplication::ResetPerformanceCounters()
 {
     for (int i = 0; i < PCNT_MAX; ++i)
     {
-        StartPerformanceCounter(static_cast<PerformanceCounter>(i));
-        StopPerformanceCounter(static_cast<PerformanceCounter>(i));
+        GetSystemUtils()->GetCurrentTimeStamp(m_performanceCounters[i][0]);
+        GetSystemUtils()->GetCurrentTimeStamp(m_performanceCounters[i][1]);
     }
 }
 
@@ -1787,3 +2027,8 @@ bool CApplication::GetSceneTestMode()
 {
     return m_sceneTest;
 }
+
+bool CApplication::GetHeadless() const
+{
+    return m_headless;
+}
@@ -43,6 +43,7 @@ class CEventQueue;
 class CRobotMain;
 class CSoundInterface;
 class CGameData;
+class CProfiler;
 
 namespace Gfx {
 class CModelManager;
@@ -153,6 +154,19 @@ enum DebugMode
     DEBUG_ALL        = DEBUG_SYS_EVENTS | DEBUG_APP_EVENTS | DEBUG_MODELS
 };
 
+/**
+ * \enum HeadlessExitCode
+ * \brief Code returned by the application at the end of a headless run
+ *
+ * Codes from 1 to 7 are used for initialization errors.
+ */
+enum HeadlessExitCode
+{
+    HEADLESS_EXIT_WIN     = 0, //! < mission won
+    HEADLESS_EXIT_LOST    = 8, //! < mission lost
+    HEADLESS_EXIT_TIMEOUT = 9  //! < mission still running at the end of the given time
+};
+
 struct ApplicationPrivate;
 
 /**
@@ -192,6 +206,14 @@ struct ApplicationPrivate;
  * means whether to pass the event on, or stop the chain. This is to enable handling some
  * events which are internal to CApplication or CEngine.
  *
+ * \section Headless Headless mode
+ *
+ * With -headless option, no window is opened: the scene given by -runscene is
+ * simulated with CNullDevice and the sound interface which plays nothing,
+ * by fixed steps of time and as fast as possible. The application exits
+ * when the mission ends or after the given simulated time, with one of
+ * HeadlessExitCode values.
+ *
  * \section Portability Portability
  *
  * Currently, the class only handles OpenGL devices. SDL can be used with DirectX, but
@@ -352,6 +374,9 @@ public:
     
     bool        GetSceneTestMode();
 
+    //! Returns whether the application runs without window, sound and rendering
+    bool        GetHeadless() const;
+
 protected:
     //! Creates the window's SDL_Surface
     bool CreateVideoSurface();
@@ -366,6 +391,8 @@ protected:
     void        LogEvent(const Event& event);
     //! Renders the image in window
     void        Render();
+    //! Main loop of headless mode
+    int         RunHeadless();
 
     //! Opens the joystick device
     bool OpenJoystick();
@@ -404,6 +431,8 @@ protected:
     CProfile*               m_profile;
     //! Game data
     CGameData*              m_gameData;
+    //! Zones timed for the trace
+    CProfiler*              m_profiler;
 
     //! Code to return at exit
     int             m_exitCode;
@@ -445,6 +474,9 @@ protected:
 
     float           m_simulationSpeed;
     bool            m_simulationSuspended;
+
+    //! Fixed duration of one update [nanoseconds]; 0 = real time elapsed
+    long long       m_fixedStep;
     //@}
 
     //! Current state of key modifiers (bitmask of SDLMod)
@@ -486,6 +518,15 @@ protected:
     //! Scene test mode
     bool            m_sceneTest;
 
+    //@{
+    //! Headless mode and simulated time to run in it [seconds]; 0 = until end of mission
+    bool            m_headless;
+    float           m_headlessTime;
+    //@}
+
+    //! File to save the profiler trace to at exit; empty = profiler disabled
+    std::string     m_profilerFile;
+
     //! Application language
     Language        m_language;
 
@@ -19,13 +19,18 @@
 
 #include "app/app.h"
 
+#include "common/config.h"
+
 #include <boost/filesystem.hpp>
 
+#include <cctype>
+
 template<> CGameData* CSingleton<CGameData>::m_instance = nullptr;
 
 CGameData::CGameData()
 {
     m_dataDirSet = false;
+    m_indexBuilt = false;
     
     for (int i = 0; i < DIR_MAX; ++i)
         m_standardDataDirs[i] = nullptr;
@@ -51,11 +56,13 @@ void CGameData::SetDataDir(std::string path)
     m_dataDirSet = true;
     
     m_dataDirs.insert(m_dataDirs.begin(), path);
+    Invalidate();
 }
 
 void CGameData::AddMod(std::string path)
 {
     m_dataDirs.push_back(path);
+    Invalidate();
 }
 
 void CGameData::Init()
@@ -69,67 +76,159 @@ void CGameData::Init()
     }
     out += "\n";
     CLogger::GetInstancePointer()->Info(out.c_str());
+
+    BuildIndex();
 }
 
-std::string CGameData::GetFilePath(DataDir dir, const std::string& subpath)
+void CGameData::Invalidate()
 {
-    int index = static_cast<int>(dir);
-    assert(index >= 0 && index < DIR_MAX);
-    
-    for(std::vector<std::string>::reverse_iterator rit = m_dataDirs.rbegin(); rit != m_dataDirs.rend(); ++rit) {
-        std::stringstream str;
-        
-        if ( subpath.find("save") == std::string::npos ){ // if its NOT a path to a savefile screenshot
-            str << *rit;
-            str << "/";
-            str << m_standardDataDirs[index];
-
-            if (dir == DIR_HELP)
-            {
-                str << "/";
-                str << CApplication::GetInstancePointer()->GetLanguageChar();
-            }
-            str << "/";
-        }
+    m_index.clear();
+    m_indexBuilt = false;
+}
 
-        str << subpath;
+int CGameData::GetIndexedFileCount()
+{
+    if (!m_indexBuilt)
+        BuildIndex();
 
-        boost::filesystem::path path(str.str());
-        if(boost::filesystem::exists(path))
-        {
-            return str.str();
-        }
+    return m_index.size();
+}
+
+void CGameData::BuildIndex()
+{
+    m_index.clear();
+
+    // The mods added last replace the files of the data directories before them
+    for (const std::string& dataDir : m_dataDirs)
+    {
+        for (int i = 0; i < DIR_MAX; ++i)
+            IndexDirectory(dataDir + "/" + m_standardDataDirs[i], m_standardDataDirs[i]);
     }
-    
-    if(m_dataDirs.size() > 0) {
-        std::stringstream str;
-        if ( subpath.find("save") == std::string::npos ){ // if its NOT a path to a savefile screenshot
-            str << m_dataDirs[0];
-            str << "/";
-            str << m_standardDataDirs[index];
-            
-            if (dir == DIR_HELP)
+
+    m_indexBuilt = true;
+    CLogger::GetInstancePointer()->Debug("Indexed %d data files\n", static_cast<int>(m_index.size()));
+}
+
+void CGameData::IndexDirectory(const std::string& path, const std::string& key)
+{
+    boost::system::error_code error;
+    boost::filesystem::directory_iterator it(path, error), end;
+    for (; !error && it != end; it.increment(error))
+    {
+        std::string name = it->path().filename().string();
+        std::string fullPath = path + "/" + name;
+
+        boost::system::error_code statError;
+        if (boost::filesystem::is_directory(it->path(), statError))
+            IndexDirectory(fullPath, key + "/" + name);
+        else
+            m_index[GetKey(key + "/" + name)] = fullPath;
+    }
+}
+
+std::string CGameData::GetKey(const std::string& path)
+{
+    std::string key;
+    key.reserve(path.size());
+
+    for (std::size_t i = 0; i < path.size(); ++i)
+    {
+        char c = path[i] == '\\' ? '/' : path[i];
+
+        if (c == '/')
+        {
+            // "a//b" and "a/./b" are "a/b"
+            if (key.empty() || key[key.size() - 1] == '/')
+                continue;
+            if (key == "." || (key.size() >= 2 && key[key.size() - 1] == '.' && key[key.size() - 2] == '/'))
             {
-                str << "/";
-                str << CApplication::GetInstancePointer()->GetLanguageChar();
+                key.resize(key.size() - 1);
+                continue;
             }
-            str << "/";
         }
-        str << subpath;
-        return str.str();
+
+        #if defined(PLATFORM_WINDOWS)
+        c = tolower(c);  // the file names are not case sensitive
+        #endif
+
+        key += c;
     }
-    
-    return subpath;
+
+    return key;
+}
+
+std::string CGameData::GetRelativePath(DataDir dir, const std::string& subpath)
+{
+    int index = static_cast<int>(dir);
+    assert(index >= 0 && index < DIR_MAX);
+
+    std::string path = m_standardDataDirs[index];
+    if (dir == DIR_HELP)
+    {
+        path += "/";
+        path += CApplication::GetInstancePointer()->GetLanguageChar();
+    }
+    path += "/";
+    path += subpath;
+    return path;
+}
+
+std::string CGameData::GetFilePath(DataDir dir, const std::string& subpath)
+{
+    if ( subpath.find("save") != std::string::npos ) // if its a path to a savefile screenshot
+        return subpath;
+
+    if(m_dataDirs.size() == 0)
+        return subpath;
+
+    std::string path = GetRelativePath(dir, subpath);
+
+    // The paths going up cannot be resolved with the index
+    if (path.find("..") != std::string::npos)
+        return GetDataPath(path);
+
+    if (!m_indexBuilt)
+        BuildIndex();
+
+    auto it = m_index.find(GetKey(path));
+    if (it != m_index.end())
+        return it->second;
+
+    return m_dataDirs[0] + "/" + path;
 }
 
 std::string CGameData::GetDataPath(const std::string &subpath)
 {
-    for(std::vector<std::string>::reverse_iterator rit = m_dataDirs.rbegin(); rit != m_dataDirs.rend(); ++rit) {
-        std::string path = *rit + "/" + subpath;
-        boost::filesystem::path boostPath(path);
-        if(boost::filesystem::exists(boostPath))
+    std::string key = GetKey(subpath);
+    bool indexed = false;
+    if (key.find("..") == std::string::npos)
+    {
+        for (int i = 0; i < DIR_MAX; ++i)
         {
-            return path;
+            std::string dirKey = GetKey(m_standardDataDirs[i]) + "/";
+            if (key.compare(0, dirKey.size(), dirKey) == 0)
+                indexed = true;
+        }
+    }
+
+    if (indexed)
+    {
+        if (!m_indexBuilt)
+            BuildIndex();
+
+        auto it = m_index.find(key);
+        if (it != m_index.end())
+            return it->second;
+    }
+    else
+    {
+        for(std::vector<std::string>::reverse_iterator rit = m_dataDirs.rbegin(); rit != m_dataDirs.rend(); ++rit) {
+            std::string path = *rit + "/" + subpath;
+            boost::filesystem::path boostPath(path);
+            if(boost::filesystem::exists(boostPath))
+            {
+                return path;
+            }
         }
     }
     return m_dataDirs[0] + "/" + subpath;
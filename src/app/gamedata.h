@@ -24,6 +24,7 @@
 #include "common/singleton.h"
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 /**
@@ -45,6 +46,16 @@ enum DataDir
     DIR_MAX       //! < number of dirs
 };
 
+/**
+ * \class CGameData
+ * \brief Resolution of the paths of data files in the data directory and the mods
+ *
+ * The files of the standard directories of all the data directories are
+ * indexed once, by Init(), so that resolving a path is a lookup in the
+ * index instead of a check of the file in each data directory. The files
+ * added or removed in the data directories afterwards are only seen once
+ * the index is invalidated.
+ */
 class CGameData : public CSingleton<CGameData>
 {
 public:
@@ -57,10 +68,28 @@ public:
     
     std::string GetFilePath(DataDir dir, const std::string &subpath);
     std::string GetDataPath(const std::string &subpath);
-    
+
+    //! Forgets the indexed files, the index is built again at the next lookup
+    void Invalidate();
+    //! Returns the number of files indexed
+    int GetIndexedFileCount();
+
+private:
+    //! Indexes the files of the standard directories of all the data directories
+    void BuildIndex();
+    //! Adds the files of \a path and its subdirectories, as \a key/name
+    void IndexDirectory(const std::string& path, const std::string& key);
+    //! Returns the key of a path relative to the data directories
+    std::string GetKey(const std::string& path);
+    //! Returns the path relative to the data directories of \a subpath in \a dir
+    std::string GetRelativePath(DataDir dir, const std::string& subpath);
+
 private:
     bool m_dataDirSet;
     std::vector<std::string> m_dataDirs;
     const char* m_standardDataDirs[DIR_MAX];
+    //! Paths of the files by their path relative to the data directories
+    std::unordered_map<std::string, std::string> m_index;
+    bool m_indexBuilt;
 };
 
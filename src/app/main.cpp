@@ -108,7 +108,10 @@ int SDL_MAIN_FUNC(int argc, char *argv[])
         code = app->GetExitCode();
         if ( code != 0 && !app->GetErrorMessage().empty() )
         {
-            systemUtils->SystemDialog(SDT_ERROR, "COLOBOT - Fatal Error", app->GetErrorMessage());
+            if (app->GetHeadless())
+                logger.Error("%s\n", app->GetErrorMessage().c_str());
+            else
+                systemUtils->SystemDialog(SDT_ERROR, "COLOBOT - Fatal Error", app->GetErrorMessage());
         }
         logger.Info("Didn't run main loop. Exiting with code %d\n", code);
         return code;
@@ -0,0 +1,264 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+
+#include "common/profiler.h"
+
+#include "common/logger.h"
+#include "common/stringutils.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+
+template<> CProfiler* CSingleton<CProfiler>::m_instance = nullptr;
+
+std::atomic<bool> CProfiler::m_enabled(false);
+
+
+struct ProfilerSample
+{
+    const char*     name;
+    int             arg;
+    unsigned int    frame;
+    int             depth;
+    //! Start and end in nanoseconds
+    long long       start, end;
+};
+
+struct ProfilerThread
+{
+    int                         id;
+    std::string                 name;
+    //! Zones opened and not closed yet
+    std::vector<ProfilerSample> open;
+
+    //! Protects the samples, read by ExportTrace() from another thread
+    std::mutex                  mutex;
+    //! Ring buffer of the last closed zones, growing until it is full
+    std::vector<ProfilerSample> samples;
+    //! Oldest sample, once the buffer is full
+    int                         next;
+};
+
+
+//! Incremented for each profiler created or destroyed, so that threads register again in a new one
+static std::atomic<unsigned int> g_generation(0);
+
+//! Data of the calling thread, given back to the profiler when the thread exits
+struct ProfilerThreadOwner
+{
+    ProfilerThread* thread = nullptr;
+    unsigned int    generation = 0;
+
+    ~ProfilerThreadOwner()
+    {
+        // The profiler must outlive the threads it records
+        if (thread != nullptr && generation == g_generation && CProfiler::IsCreated())
+            CProfiler::GetInstancePointer()->ReleaseThread(thread);
+    }
+};
+
+static thread_local ProfilerThreadOwner t_owner;
+
+
+CProfiler::CProfiler(int samples)
+{
+    m_samples = samples;
+    m_frame = 0;
+    m_startTime = 0;
+    m_startTime = GetTime();
+
+    g_generation++;
+}
+
+CProfiler::~CProfiler()
+{
+    m_enabled = false;
+    g_generation++;
+
+    for (ProfilerThread* thread : m_threads)
+        delete thread;
+}
+
+void CProfiler::SetEnabled(bool enabled)
+{
+    m_enabled = enabled;
+}
+
+void CProfiler::BeginFrame()
+{
+    m_frame++;
+}
+
+unsigned int CProfiler::GetFrame()
+{
+    return m_frame;
+}
+
+void CProfiler::SetThreadName(const std::string &name)
+{
+    ProfilerThread* thread = GetThread();
+
+    std::lock_guard<std::mutex> lock(thread->mutex);
+    thread->name = name;
+}
+
+void CProfiler::Begin(const char* name, int arg)
+{
+    ProfilerThread* thread = GetThread();
+
+    ProfilerSample sample;
+    sample.name = name;
+    sample.arg = arg;
+    sample.frame = m_frame;
+    sample.depth = thread->open.size();
+    sample.start = GetTime();
+    sample.end = 0;
+    thread->open.push_back(sample);
+}
+
+void CProfiler::End()
+{
+    ProfilerThread* thread = GetThread();
+    if (thread->open.empty())  // opened before recording started
+        return;
+
+    ProfilerSample sample = thread->open.back();
+    thread->open.pop_back();
+    sample.end = GetTime();
+
+    std::lock_guard<std::mutex> lock(thread->mutex);
+    if (static_cast<int>(thread->samples.size()) < m_samples)
+    {
+        thread->samples.push_back(sample);
+    }
+    else
+    {
+        thread->samples[thread->next] = sample;
+        thread->next = (thread->next + 1) % m_samples;
+    }
+}
+
+int CProfiler::GetSampleCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    int count = 0;
+    for (ProfilerThread* thread : m_threads)
+    {
+        std::lock_guard<std::mutex> threadLock(thread->mutex);
+        count += thread->samples.size();
+    }
+    return count;
+}
+
+bool CProfiler::ExportTrace(const std::string &filename)
+{
+    std::ofstream file(filename.c_str());
+    if (!file.good())
+    {
+        GetLogger()->Error("Could not write profiler trace '%s'\n", filename.c_str());
+        return false;
+    }
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\"traceEvents\":[\n";
+
+    bool first = true;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (ProfilerThread* thread : m_threads)
+    {
+        std::lock_guard<std::mutex> threadLock(thread->mutex);
+
+        if (!first) file << ",\n";
+        first = false;
+
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->id
+             << ",\"args\":{\"name\":\"" << thread->name << "\"}}";
+
+        int count = thread->samples.size();
+        for (int i = 0; i < count; i++)
+        {
+            const ProfilerSample &sample = thread->samples[(thread->next + i) % count];
+
+            // Times in microseconds
+            file << ",\n{\"name\":\"" << sample.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->id
+                 << ",\"ts\":" << sample.start / 1000.0
+                 << ",\"dur\":" << (sample.end - sample.start) / 1000.0
+                 << ",\"args\":{\"frame\":" << sample.frame << ",\"depth\":" << sample.depth;
+            if (sample.arg != -1)
+                file << ",\"arg\":" << sample.arg;
+            file << "}}";
+        }
+    }
+
+    file << "\n]}\n";
+
+    if (!file.good())
+    {
+        GetLogger()->Error("Could not write profiler trace '%s'\n", filename.c_str());
+        return false;
+    }
+
+    GetLogger()->Info("Profiler trace saved to '%s'\n", filename.c_str());
+    return true;
+}
+
+ProfilerThread* CProfiler::GetThread()
+{
+    if (t_owner.thread != nullptr && t_owner.generation == g_generation)
+        return t_owner.thread;
+
+    ProfilerThread* thread = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_freeThreads.empty())
+        {
+            // Keeps the samples of the thread which exited, in the same row of the trace
+            thread = m_freeThreads.back();
+            m_freeThreads.pop_back();
+        }
+        else
+        {
+            thread = new ProfilerThread();
+            thread->next = 0;
+            thread->id = m_threads.size() + 1;
+            m_threads.push_back(thread);
+        }
+
+        std::lock_guard<std::mutex> threadLock(thread->mutex);
+        thread->name = "Thread " + StrUtils::ToString<int>(thread->id);
+    }
+
+    t_owner.thread = thread;
+    t_owner.generation = g_generation;
+    return thread;
+}
+
+void CProfiler::ReleaseThread(ProfilerThread* thread)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    thread->open.clear();
+    m_freeThreads.push_back(thread);
+}
+
+long long CProfiler::GetTime()
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count() - m_startTime;
+}
@@ -0,0 +1,142 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file common/profiler.h
+ * \brief Timing of nested code zones - CProfiler and CProfileZone classes
+ */
+
+#pragma once
+
+
+#include "common/singleton.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+struct ProfilerThread;
+struct ProfilerThreadOwner;
+
+/**
+ * \class CProfiler
+ * \brief Records when code zones start and end, on every thread
+ *
+ * Each thread keeps its last samples in a ring buffer of its own; a sample
+ * is one zone of one frame, with its nesting depth. The buffer grows with
+ * the samples, up to the given size. When a thread exits, its buffer is
+ * kept and given to the next thread which records, so the worker threads
+ * started for each scene do not add buffers. The samples can be saved in
+ * the Chrome trace event format, to see single frames in chrome://tracing
+ * or similar viewers.
+ *
+ * When disabled, a zone only costs the test of IsEnabled().
+ */
+class CProfiler : public CSingleton<CProfiler>
+{
+public:
+    //! Creates a profiler keeping \a samples samples per thread
+    CProfiler(int samples = 262144);
+    ~CProfiler();
+
+    //! Returns true if zones are recorded
+    static bool IsEnabled()
+    {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    //! Starts or stops recording
+    void            SetEnabled(bool enabled);
+
+    //! Starts a new frame, the following samples are marked with its number
+    void            BeginFrame();
+    //! Returns the number of the current frame
+    unsigned int    GetFrame();
+
+    //! Names the calling thread in the trace
+    void            SetThreadName(const std::string &name);
+
+    //! Opens a zone on the calling thread; \a name must stay valid
+    void            Begin(const char* name, int arg = -1);
+    //! Closes the last zone opened on the calling thread
+    void            End();
+
+    //! Returns the number of samples kept for all threads
+    int             GetSampleCount();
+
+    //! Saves all kept samples as Chrome trace events, returns false on error
+    bool            ExportTrace(const std::string &filename);
+
+protected:
+    friend struct ProfilerThreadOwner;
+
+    //! Returns the data of the calling thread, registering it on first use
+    ProfilerThread* GetThread();
+    //! Keeps the data of an exiting thread for the next new thread
+    void            ReleaseThread(ProfilerThread* thread);
+    //! Returns the time since the creation of the profiler, in nanoseconds
+    long long       GetTime();
+
+protected:
+    static std::atomic<bool>        m_enabled;
+
+    int                             m_samples;
+    std::atomic<unsigned int>       m_frame;
+    long long                       m_startTime;
+
+    //! Protects the lists of threads
+    std::mutex                      m_mutex;
+    std::vector<ProfilerThread*>    m_threads;
+    //! Threads which exited, in m_threads too
+    std::vector<ProfilerThread*>    m_freeThreads;
+};
+
+
+/**
+ * \class CProfileZone
+ * \brief Zone lasting as long as the object
+ *
+ * \code
+ * void CPhysics::Update()
+ * {
+ *     CProfileZone zone("CPhysics::Update");
+ *     ...
+ * }
+ * \endcode
+ */
+class CProfileZone
+{
+public:
+    //! Opens a zone with an optional number shown in the trace, like an object id
+    CProfileZone(const char* name, int arg = -1)
+    {
+        m_active = CProfiler::IsEnabled();
+        if (m_active)
+            CProfiler::GetInstancePointer()->Begin(name, arg);
+    }
+
+    ~CProfileZone()
+    {
+        if (m_active)
+            CProfiler::GetInstancePointer()->End();
+    }
+
+private:
+    bool    m_active;
+};
+
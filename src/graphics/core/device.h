@@ -283,6 +283,8 @@ public:
     virtual Texture CreateTexture(CImage *image, const TextureCreateParams &params) = 0;
     //! Creates a texture from raw image data; image data can be freed after that
     virtual Texture CreateTexture(ImageData *data, const TextureCreateParams &params) = 0;
+    //! Replaces the pixels of a texture from \a offset with the pixels of the image data
+    virtual void UpdateTexture(const Texture &texture, Math::IntPoint offset, ImageData *data, TexImgFormat format) = 0;
     //! Deletes a given texture, freeing it from video memory
     virtual void DestroyTexture(const Texture &texture) = 0;
     //! Deletes all textures created so far
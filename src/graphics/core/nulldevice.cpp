@@ -0,0 +1,429 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+
+#include "graphics/core/nulldevice.h"
+
+#include "common/image.h"
+
+#include <SDL.h>
+
+
+// Graphics module namespace
+namespace Gfx {
+
+
+namespace {
+
+const int NULL_LIGHT_COUNT   = 8;
+const int NULL_TEXTURE_COUNT = 2;
+
+} // anonymous namespace
+
+
+CNullDevice::CNullDevice()
+{
+    m_lastTextureId = 0;
+    m_lastBufferId = 0;
+
+    for (int i = 0; i <= RENDER_STATE_CULLING; ++i)
+        m_renderStates[i] = false;
+
+    m_depthTestFunc = COMP_FUNC_LESS;
+    m_depthBias = 0.0f;
+    m_alphaTestFunc = COMP_FUNC_ALWAYS;
+    m_alphaTestRef = 0.0f;
+    m_srcBlend = BLEND_ONE;
+    m_dstBlend = BLEND_ZERO;
+    m_fogMode = FOG_LINEAR;
+    m_fogStart = 0.0f;
+    m_fogEnd = 1.0f;
+    m_fogDensity = 1.0f;
+    m_cullMode = CULL_CW;
+    m_shadeModel = SHADE_SMOOTH;
+    m_fillMode = FILL_POLY;
+}
+
+CNullDevice::~CNullDevice()
+{
+}
+
+void CNullDevice::DebugHook()
+{
+}
+
+void CNullDevice::DebugLights()
+{
+}
+
+bool CNullDevice::Create()
+{
+    m_lights        = std::vector<Light>(NULL_LIGHT_COUNT, Light());
+    m_lightsEnabled = std::vector<bool> (NULL_LIGHT_COUNT, false);
+
+    m_currentTextures    = std::vector<Texture>           (NULL_TEXTURE_COUNT, Texture());
+    m_texturesEnabled    = std::vector<bool>              (NULL_TEXTURE_COUNT, false);
+    m_textureStageParams = std::vector<TextureStageParams>(NULL_TEXTURE_COUNT, TextureStageParams());
+
+    return true;
+}
+
+void CNullDevice::Destroy()
+{
+    m_lights.clear();
+    m_lightsEnabled.clear();
+
+    m_currentTextures.clear();
+    m_texturesEnabled.clear();
+    m_textureStageParams.clear();
+}
+
+void CNullDevice::BeginScene()
+{
+}
+
+void CNullDevice::EndScene()
+{
+}
+
+void CNullDevice::Clear()
+{
+}
+
+void CNullDevice::SetTransform(TransformType type, const Math::Matrix &matrix)
+{
+    m_matrices[type] = matrix;
+}
+
+const Math::Matrix& CNullDevice::GetTransform(TransformType type)
+{
+    return m_matrices[type];
+}
+
+void CNullDevice::MultiplyTransform(TransformType type, const Math::Matrix &matrix)
+{
+    m_matrices[type] = Math::MultiplyMatrices(m_matrices[type], matrix);
+}
+
+void CNullDevice::SetMaterial(const Material &material)
+{
+    m_material = material;
+}
+
+const Material& CNullDevice::GetMaterial()
+{
+    return m_material;
+}
+
+int CNullDevice::GetMaxLightCount()
+{
+    return m_lights.size();
+}
+
+void CNullDevice::SetLight(int index, const Light &light)
+{
+    m_lights[index] = light;
+}
+
+const Light& CNullDevice::GetLight(int index)
+{
+    return m_lights[index];
+}
+
+void CNullDevice::SetLightEnabled(int index, bool enabled)
+{
+    m_lightsEnabled[index] = enabled;
+}
+
+bool CNullDevice::GetLightEnabled(int index)
+{
+    return m_lightsEnabled[index];
+}
+
+Texture CNullDevice::CreateTexture(CImage *image, const TextureCreateParams &params)
+{
+    ImageData *data = image->GetData();
+    if (data == nullptr)
+        return Texture(); // invalid texture
+
+    Texture tex = CreateTexture(data, params);
+    tex.originalSize = image->GetSize();
+    return tex;
+}
+
+Texture CNullDevice::CreateTexture(ImageData *data, const TextureCreateParams &params)
+{
+    Texture result;
+    if (data == nullptr || data->surface == nullptr)
+        return result;
+
+    result.id = ++m_lastTextureId;
+    result.size.x = data->surface->w;
+    result.size.y = data->surface->h;
+    result.originalSize = result.size;
+    result.alpha = data->surface->format->BytesPerPixel == 4;
+    return result;
+}
+
+void CNullDevice::UpdateTexture(const Texture &texture, Math::IntPoint offset, ImageData *data, TexImgFormat format)
+{
+}
+
+void CNullDevice::DestroyTexture(const Texture &texture)
+{
+    for (int index = 0; index < static_cast<int>( m_currentTextures.size() ); ++index)
+    {
+        if (m_currentTextures[index] == texture)
+            m_currentTextures[index] = Texture(); // set to invalid texture
+    }
+}
+
+void CNullDevice::DestroyAllTextures()
+{
+    for (int index = 0; index < static_cast<int>( m_currentTextures.size() ); ++index)
+        m_currentTextures[index] = Texture();
+}
+
+int CNullDevice::GetMaxTextureStageCount()
+{
+    return m_currentTextures.size();
+}
+
+void CNullDevice::SetTexture(int index, const Texture &texture)
+{
+    m_currentTextures[index] = texture;
+}
+
+void CNullDevice::SetTexture(int index, unsigned int textureId)
+{
+    m_currentTextures[index].id = textureId;
+}
+
+Texture CNullDevice::GetTexture(int index)
+{
+    return m_currentTextures[index];
+}
+
+void CNullDevice::SetTextureEnabled(int index, bool enabled)
+{
+    m_texturesEnabled[index] = enabled;
+}
+
+bool CNullDevice::GetTextureEnabled(int index)
+{
+    return m_texturesEnabled[index];
+}
+
+void CNullDevice::SetTextureStageParams(int index, const TextureStageParams &params)
+{
+    m_textureStageParams[index] = params;
+}
+
+TextureStageParams CNullDevice::GetTextureStageParams(int index)
+{
+    return m_textureStageParams[index];
+}
+
+void CNullDevice::SetTextureStageWrap(int index, TexWrapMode wrapS, TexWrapMode wrapT)
+{
+    m_textureStageParams[index].wrapS = wrapS;
+    m_textureStageParams[index].wrapT = wrapT;
+}
+
+void CNullDevice::DrawPrimitive(PrimitiveType type, const Vertex *vertices, int vertexCount,
+                                Color color)
+{
+}
+
+void CNullDevice::DrawPrimitive(PrimitiveType type, const VertexTex2 *vertices, int vertexCount,
+                                Color color)
+{
+}
+
+void CNullDevice::DrawPrimitive(PrimitiveType type, const VertexCol *vertices, int vertexCount)
+{
+}
+
+unsigned int CNullDevice::CreateStaticBuffer(PrimitiveType primitiveType, const Vertex* vertices, int vertexCount)
+{
+    return ++m_lastBufferId;
+}
+
+unsigned int CNullDevice::CreateStaticBuffer(PrimitiveType primitiveType, const VertexTex2* vertices, int vertexCount)
+{
+    return ++m_lastBufferId;
+}
+
+unsigned int CNullDevice::CreateStaticBuffer(PrimitiveType primitiveType, const VertexCol* vertices, int vertexCount)
+{
+    return ++m_lastBufferId;
+}
+
+void CNullDevice::UpdateStaticBuffer(unsigned int bufferId, PrimitiveType primitiveType, const Vertex* vertices, int vertexCount)
+{
+}
+
+void CNullDevice::UpdateStaticBuffer(unsigned int bufferId, PrimitiveType primitiveType, const VertexTex2* vertices, int vertexCount)
+{
+}
+
+void CNullDevice::UpdateStaticBuffer(unsigned int bufferId, PrimitiveType primitiveType, const VertexCol* vertices, int vertexCount)
+{
+}
+
+void CNullDevice::DrawStaticBuffer(unsigned int bufferId)
+{
+}
+
+void CNullDevice::DestroyStaticBuffer(unsigned int bufferId)
+{
+}
+
+int CNullDevice::ComputeSphereVisibility(const Math::Vector &center, float radius)
+{
+    return FRUSTUM_PLANE_ALL;
+}
+
+void CNullDevice::SetRenderState(RenderState state, bool enabled)
+{
+    m_renderStates[state] = enabled;
+}
+
+bool CNullDevice::GetRenderState(RenderState state)
+{
+    return m_renderStates[state];
+}
+
+void CNullDevice::SetDepthTestFunc(CompFunc func)
+{
+    m_depthTestFunc = func;
+}
+
+CompFunc CNullDevice::GetDepthTestFunc()
+{
+    return m_depthTestFunc;
+}
+
+void CNullDevice::SetDepthBias(float factor)
+{
+    m_depthBias = factor;
+}
+
+float CNullDevice::GetDepthBias()
+{
+    return m_depthBias;
+}
+
+void CNullDevice::SetAlphaTestFunc(CompFunc func, float refValue)
+{
+    m_alphaTestFunc = func;
+    m_alphaTestRef = refValue;
+}
+
+void CNullDevice::GetAlphaTestFunc(CompFunc &func, float &refValue)
+{
+    func = m_alphaTestFunc;
+    refValue = m_alphaTestRef;
+}
+
+void CNullDevice::SetBlendFunc(BlendFunc srcBlend, BlendFunc dstBlend)
+{
+    m_srcBlend = srcBlend;
+    m_dstBlend = dstBlend;
+}
+
+void CNullDevice::GetBlendFunc(BlendFunc &srcBlend, BlendFunc &dstBlend)
+{
+    srcBlend = m_srcBlend;
+    dstBlend = m_dstBlend;
+}
+
+void CNullDevice::SetClearColor(const Color &color)
+{
+    m_clearColor = color;
+}
+
+Color CNullDevice::GetClearColor()
+{
+    return m_clearColor;
+}
+
+void CNullDevice::SetGlobalAmbient(const Color &color)
+{
+    m_globalAmbient = color;
+}
+
+Color CNullDevice::GetGlobalAmbient()
+{
+    return m_globalAmbient;
+}
+
+void CNullDevice::SetFogParams(FogMode mode, const Color &color, float start, float end, float density)
+{
+    m_fogMode = mode;
+    m_fogColor = color;
+    m_fogStart = start;
+    m_fogEnd = end;
+    m_fogDensity = density;
+}
+
+void CNullDevice::GetFogParams(FogMode &mode, Color &color, float &start, float &end, float &density)
+{
+    mode = m_fogMode;
+    color = m_fogColor;
+    start = m_fogStart;
+    end = m_fogEnd;
+    density = m_fogDensity;
+}
+
+void CNullDevice::SetCullMode(CullMode mode)
+{
+    m_cullMode = mode;
+}
+
+CullMode CNullDevice::GetCullMode()
+{
+    return m_cullMode;
+}
+
+void CNullDevice::SetShadeModel(ShadeModel model)
+{
+    m_shadeModel = model;
+}
+
+ShadeModel CNullDevice::GetShadeModel()
+{
+    return m_shadeModel;
+}
+
+void CNullDevice::SetFillMode(FillMode mode)
+{
+    m_fillMode = mode;
+}
+
+FillMode CNullDevice::GetFillMode()
+{
+    return m_fillMode;
+}
+
+void* CNullDevice::GetFrameBufferPixels()const
+{
+    return nullptr;
+}
+
+
+} // namespace Gfx
+
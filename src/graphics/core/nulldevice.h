@@ -0,0 +1,181 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file graphics/core/nulldevice.h
+ * \brief Device which draws nothing - CNullDevice class
+ */
+
+#pragma once
+
+
+#include "graphics/core/device.h"
+
+#include <vector>
+
+
+// Graphics module namespace
+namespace Gfx {
+
+/**
+  \class CNullDevice
+  \brief Implementation of CDevice interface which does not draw anything
+
+  Used by CApplication in headless mode, when there is no window nor OpenGL
+  context. The state set by CEngine is kept so that it reads back the same
+  values, textures and static buffers only get identifiers, draw calls are
+  ignored and every sphere is reported as visible.
+*/
+class CNullDevice : public CDevice
+{
+public:
+    CNullDevice();
+    virtual ~CNullDevice();
+
+    virtual void DebugHook();
+    virtual void DebugLights();
+
+    virtual bool Create();
+    virtual void Destroy();
+
+    virtual void BeginScene();
+    virtual void EndScene();
+
+    virtual void Clear();
+
+    virtual void SetTransform(TransformType type, const Math::Matrix &matrix);
+    virtual const Math::Matrix& GetTransform(TransformType type);
+    virtual void MultiplyTransform(TransformType type, const Math::Matrix &matrix);
+
+    virtual void SetMaterial(const Material &material);
+    virtual const Material& GetMaterial();
+
+    virtual int GetMaxLightCount();
+    virtual void SetLight(int index, const Light &light);
+    virtual const Light& GetLight(int index);
+    virtual void SetLightEnabled(int index, bool enabled);
+    virtual bool GetLightEnabled(int index);
+
+    virtual Texture CreateTexture(CImage *image, const TextureCreateParams &params);
+    virtual Texture CreateTexture(ImageData *data, const TextureCreateParams &params);
+    virtual void UpdateTexture(const Texture &texture, Math::IntPoint offset, ImageData *data, TexImgFormat format);
+    virtual void DestroyTexture(const Texture &texture);
+    virtual void DestroyAllTextures();
+
+    virtual int GetMaxTextureStageCount();
+    virtual void SetTexture(int index, const Texture &texture);
+    virtual void SetTexture(int index, unsigned int textureId);
+    virtual Texture GetTexture(int index);
+    virtual void SetTextureEnabled(int index, bool enabled);
+    virtual bool GetTextureEnabled(int index);
+
+    virtual void SetTextureStageParams(int index, const TextureStageParams &params);
+    virtual TextureStageParams GetTextureStageParams(int index);
+
+    virtual void SetTextureStageWrap(int index, TexWrapMode wrapS, TexWrapMode wrapT);
+
+    virtual void DrawPrimitive(PrimitiveType type, const Vertex *vertices    , int vertexCount,
+                               Color color = Color(1.0f, 1.0f, 1.0f, 1.0f));
+    virtual void DrawPrimitive(PrimitiveType type, const VertexTex2 *vertices, int vertexCount,
+                               Color color = Color(1.0f, 1.0f, 1.0f, 1.0f));
+    virtual void DrawPrimitive(PrimitiveType type, const VertexCol *vertices , int vertexCount);
+
+    virtual unsigned int CreateStaticBuffer(PrimitiveType primitiveType, const Vertex* vertices, int vertexCount);
+    virtual unsigned int CreateStaticBuffer(PrimitiveType primitiveType, const VertexTex2* vertices, int vertexCount);
+    virtual unsigned int CreateStaticBuffer(PrimitiveType primitiveType, const VertexCol* vertices, int vertexCount);
+    virtual void UpdateStaticBuffer(unsigned int bufferId, PrimitiveType primitiveType, const Vertex* vertices, int vertexCount);
+    virtual void UpdateStaticBuffer(unsigned int bufferId, PrimitiveType primitiveType, const VertexTex2* vertices, int vertexCount);
+    virtual void UpdateStaticBuffer(unsigned int bufferId, PrimitiveType primitiveType, const VertexCol* vertices, int vertexCount);
+    virtual void DrawStaticBuffer(unsigned int bufferId);
+    virtual void DestroyStaticBuffer(unsigned int bufferId);
+
+    virtual int ComputeSphereVisibility(const Math::Vector &center, float radius);
+
+    virtual void SetRenderState(RenderState state, bool enabled);
+    virtual bool GetRenderState(RenderState state);
+
+    virtual void SetDepthTestFunc(CompFunc func);
+    virtual CompFunc GetDepthTestFunc();
+
+    virtual void SetDepthBias(float factor);
+    virtual float GetDepthBias();
+
+    virtual void SetAlphaTestFunc(CompFunc func, float refValue);
+    virtual void GetAlphaTestFunc(CompFunc &func, float &refValue);
+
+    virtual void SetBlendFunc(BlendFunc srcBlend, BlendFunc dstBlend);
+    virtual void GetBlendFunc(BlendFunc &srcBlend, BlendFunc &dstBlend);
+
+    virtual void SetClearColor(const Color &color);
+    virtual Color GetClearColor();
+
+    virtual void SetGlobalAmbient(const Color &color);
+    virtual Color GetGlobalAmbient();
+
+    virtual void SetFogParams(FogMode mode, const Color &color, float start, float end, float density);
+    virtual void GetFogParams(FogMode &mode, Color &color, float &start, float &end, float &density);
+
+    virtual void SetCullMode(CullMode mode);
+    virtual CullMode GetCullMode();
+
+    virtual void SetShadeModel(ShadeModel model);
+    virtual ShadeModel GetShadeModel();
+
+    virtual void SetFillMode(FillMode mode);
+    virtual FillMode GetFillMode();
+
+    virtual void* GetFrameBufferPixels()const;
+
+private:
+    //! Current world, view and projection matrices
+    Math::Matrix m_matrices[3];
+    //! The current material
+    Material m_material;
+    //! Current lights and their enable status
+    std::vector<Light> m_lights;
+    std::vector<bool> m_lightsEnabled;
+    //! Current textures, their enable status and params
+    std::vector<Texture> m_currentTextures;
+    std::vector<bool> m_texturesEnabled;
+    std::vector<TextureStageParams> m_textureStageParams;
+    //! Last ID given to a texture
+    unsigned int m_lastTextureId;
+    //! Last ID given to a static buffer
+    unsigned int m_lastBufferId;
+
+    //! Render states, indexed by RenderState
+    bool m_renderStates[RENDER_STATE_CULLING+1];
+    CompFunc m_depthTestFunc;
+    float m_depthBias;
+    CompFunc m_alphaTestFunc;
+    float m_alphaTestRef;
+    BlendFunc m_srcBlend;
+    BlendFunc m_dstBlend;
+    Color m_clearColor;
+    Color m_globalAmbient;
+    FogMode m_fogMode;
+    Color m_fogColor;
+    float m_fogStart;
+    float m_fogEnd;
+    float m_fogDensity;
+    CullMode m_cullMode;
+    ShadeModel m_shadeModel;
+    FillMode m_fillMode;
+};
+
+
+} // namespace Gfx
+
@@ -43,6 +43,7 @@
 
 #include "ui/interface.h"
 
+#include <algorithm>
 #include <iomanip>
 
 template<> Gfx::CEngine* CSingleton<Gfx::CEngine>::m_instance = nullptr;
@@ -153,6 +154,9 @@ CEngine::CEngine(CApplication *app)
     m_mouseType    = ENG_MOUSE_NORM;
 
     m_fpsCounter = 0;
+    m_textureLoadDeferred = false;
+    m_textureLoadPending = false;
+
     m_lastFrameTime = GetSystemUtils()->CreateTimeStamp();
     m_currentFrameTime = GetSystemUtils()->CreateTimeStamp();
 
@@ -425,6 +429,12 @@ void CEngine::FrameUpdate()
 bool CEngine::WriteScreenShot(const std::string& fileName, int width, int height)
 {
     void *pixels = m_device->GetFrameBufferPixels();
+    if (pixels == nullptr)
+    {
+        GetLogger()->Error("Screenshot not available\n");
+        return false;
+    }
+
     CImage img({width,height});
 
     img.SetDataPixels(pixels);
@@ -502,6 +512,7 @@ Math::IntPoint CEngine::InterfaceToWindowSize(Math::Point size)
 void CEngine::AddStatisticTriangle(int count)
 {
     m_statisticTriangle += count;
+    m_statisticDrawCall++;
 }
 
 int CEngine::GetStatisticTriangle()
@@ -509,6 +520,11 @@ int CEngine::GetStatisticTriangle()
     return m_statisticTriangle;
 }
 
+int CEngine::GetStatisticDrawCall()
+{
+    return m_statisticDrawCall;
+}
+
 
 
 /*******************************************************
@@ -671,6 +687,16 @@ void CEngine::AddBaseObjTriangles(int baseObjRank, const std::vector<VertexTex2>
                                   const Material& material, int state,
                                   std::string tex1Name, std::string tex2Name,
                                   LODLevel lodLevel, bool globalUpdate)
+{
+    AddBaseObjTriangles(baseObjRank, vertices.data(), vertices.size(), triangleType,
+                        material, state, tex1Name, tex2Name, lodLevel, globalUpdate);
+}
+
+void CEngine::AddBaseObjTriangles(int baseObjRank, const VertexTex2* vertices, int vertexCount,
+                                  EngineTriangleType triangleType,
+                                  const Material& material, int state,
+                                  std::string tex1Name, std::string tex2Name,
+                                  LODLevel lodLevel, bool globalUpdate)
 {
     assert(baseObjRank >= 0 && baseObjRank < static_cast<int>( m_baseObjects.size() ));
 
@@ -679,7 +705,7 @@ void CEngine::AddBaseObjTriangles(int baseObjRank, const std::vector<VertexTex2>
     EngineBaseObjLODTier&  p3 = AddLevel3(p2, lodLevel);
     EngineBaseObjDataTier& p4 = AddLevel4(p3, triangleType, material, state);
 
-    p4.vertices.insert(p4.vertices.end(), vertices.begin(), vertices.end());
+    p4.vertices.insert(p4.vertices.end(), vertices, vertices + vertexCount);
 
     p4.updateStaticBuffer = true;
     m_updateStaticBuffers = true;
@@ -690,7 +716,7 @@ void CEngine::AddBaseObjTriangles(int baseObjRank, const std::vector<VertexTex2>
     }
     else
     {
-        for (int i = 0; i < static_cast<int>( vertices.size() ); i++)
+        for (int i = 0; i < vertexCount; i++)
         {
             p1.bboxMin.x = Math::Min(vertices[i].coord.x, p1.bboxMin.x);
             p1.bboxMin.y = Math::Min(vertices[i].coord.y, p1.bboxMin.y);
@@ -704,9 +730,9 @@ void CEngine::AddBaseObjTriangles(int baseObjRank, const std::vector<VertexTex2>
     }
 
     if (triangleType == ENG_TRIANGLE_TYPE_TRIANGLES)
-        p1.totalTriangles += vertices.size() / 3;
+        p1.totalTriangles += vertexCount / 3;
     else
-        p1.totalTriangles += vertices.size() - 2;
+        p1.totalTriangles += vertexCount - 2;
 }
 
 void CEngine::AddBaseObjQuick(int baseObjRank, const EngineBaseObjDataTier& buffer,
@@ -750,6 +776,57 @@ void CEngine::AddBaseObjQuick(int baseObjRank, const EngineBaseObjDataTier& buff
         p1.totalTriangles += p4.vertices.size() - 2;
 }
 
+bool CEngine::UpdateBaseObjQuick(int baseObjRank, int index, const std::vector<VertexTex2>& vertices,
+                                 const std::string& tex1Name, const std::string& tex2Name,
+                                 LODLevel lodLevel)
+{
+    assert(baseObjRank >= 0 && baseObjRank < static_cast<int>( m_baseObjects.size() ));
+
+    EngineBaseObject& p1 = m_baseObjects[baseObjRank];
+    if (! p1.used)
+        return false;
+
+    for (int l2 = 0; l2 < static_cast<int>( p1.next.size() ); l2++)
+    {
+        EngineBaseObjTexTier& p2 = p1.next[l2];
+        if (p2.tex1Name != tex1Name || p2.tex2Name != tex2Name)
+            continue;
+
+        for (int l3 = 0; l3 < static_cast<int>( p2.next.size() ); l3++)
+        {
+            EngineBaseObjLODTier& p3 = p2.next[l3];
+            if (p3.lodLevel != lodLevel)
+                continue;
+
+            if (index >= static_cast<int>( p3.next.size() ))
+                return false;
+
+            EngineBaseObjDataTier& p4 = p3.next[index];
+            if (p4.vertices.size() != vertices.size())
+                return false;
+
+            p4.vertices = vertices;
+            UpdateStaticBuffer(p4);
+
+            // The box only grows, it is recalculated by UpdateGeometry()
+            for (int i = 0; i < static_cast<int>( vertices.size() ); i++)
+            {
+                p1.bboxMin.x = Math::Min(vertices[i].coord.x, p1.bboxMin.x);
+                p1.bboxMin.y = Math::Min(vertices[i].coord.y, p1.bboxMin.y);
+                p1.bboxMin.z = Math::Min(vertices[i].coord.z, p1.bboxMin.z);
+                p1.bboxMax.x = Math::Max(vertices[i].coord.x, p1.bboxMax.x);
+                p1.bboxMax.y = Math::Max(vertices[i].coord.y, p1.bboxMax.y);
+                p1.bboxMax.z = Math::Max(vertices[i].coord.z, p1.bboxMax.z);
+            }
+
+            p1.radius = Math::Max(p1.bboxMin.Length(), p1.bboxMax.Length());
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void CEngine::DebugObject(int objRank)
 {
     assert(objRank >= 0 && objRank < static_cast<int>( m_objects.size() ));
@@ -2256,6 +2333,9 @@ Texture CEngine::CreateTexture(const std::string& texName, const TextureCreatePa
     Texture tex;
     CImage img;
 
+    if (image == nullptr)
+        image = m_textureLoader.GetImage(texName);  // decoded by DecodeAllTextures()
+
     if (image == nullptr)
     {
         if (! img.Load(CGameData::GetInstancePointer()->GetFilePath(DIR_TEXTURE, texName)))
@@ -2307,17 +2387,27 @@ Texture CEngine::LoadTexture(const std::string& name, const TextureCreateParams&
     return CreateTexture(name, params);
 }
 
+//! Textures of the interface and effects, loaded by LoadAllTextures()
+const char* const COMMON_TEXTURES[] =
+{
+    "text.png", "mouse.png", "button1.png", "button2.png", "button3.png",
+    "effect00.png", "effect01.png", "effect02.png", "map.png"
+};
+
 bool CEngine::LoadAllTextures()
 {
-    LoadTexture("text.png");
+    if (m_textureLoadDeferred)
+    {
+        m_textureLoadPending = true;
+        return true;
+    }
+
+    DecodeAllTextures();
+
+    for (const char* name : COMMON_TEXTURES)
+        LoadTexture(name);
+
     m_miceTexture = LoadTexture("mouse.png");
-    LoadTexture("button1.png");
-    LoadTexture("button2.png");
-    LoadTexture("button3.png");
-    LoadTexture("effect00.png");
-    LoadTexture("effect01.png");
-    LoadTexture("effect02.png");
-    LoadTexture("map.png");
 
     if (! m_backgroundName.empty())
     {
@@ -2384,9 +2474,82 @@ bool CEngine::LoadAllTextures()
         }
     }
 
+    m_textureLoader.Clear();
+
     return ok;
 }
 
+void CEngine::SetTextureLoadDeferred(bool deferred)
+{
+    m_textureLoadDeferred = deferred;
+
+    if (!deferred && m_textureLoadPending)
+    {
+        m_textureLoadPending = false;
+        LoadAllTextures();
+    }
+}
+
+void CEngine::DecodeAllTextures()
+{
+    CGameData* gameData = CGameData::GetInstancePointer();
+
+    auto add = [this, gameData](const std::string& name)
+    {
+        if (name.empty() || m_texNameMap.count(name) > 0 || m_texBlacklist.count(name) > 0)
+            return;
+
+        m_textureLoader.Add(name, gameData->GetFilePath(DIR_TEXTURE, name));
+    };
+
+    for (const char* name : COMMON_TEXTURES)
+        add(name);
+
+    add(m_backgroundName);
+    add(m_foregroundName);
+
+    for (int objRank = 0; objRank < static_cast<int>( m_objects.size() ); objRank++)
+    {
+        if (! m_objects[objRank].used)
+            continue;
+
+        int baseObjRank = m_objects[objRank].baseObjRank;
+        if (baseObjRank == -1)
+            continue;
+
+        EngineBaseObject& p1 = m_baseObjects[baseObjRank];
+        if (! p1.used)
+            continue;
+
+        for (int l2 = 0; l2 < static_cast<int>( p1.next.size() ); l2++)
+        {
+            add(p1.next[l2].tex1Name);
+            add(p1.next[l2].tex2Name);
+        }
+    }
+
+    int count = m_textureLoader.GetCount();
+    if (count == 0)
+        return;
+
+    SystemTimeStamp* start = GetSystemUtils()->CreateTimeStamp();
+    SystemTimeStamp* end = GetSystemUtils()->CreateTimeStamp();
+    GetSystemUtils()->GetCurrentTimeStamp(start);
+
+    m_textureLoader.Decode([](int done, int total)
+    {
+        GetLogger()->Trace("Decoding textures: %d/%d\n", done, total);
+    });
+
+    GetSystemUtils()->GetCurrentTimeStamp(end);
+    float time = GetSystemUtils()->TimeStampDiff(start, end, STU_MSEC);
+    GetLogger()->Debug("Decoded %d textures in %.1f ms on %d threads\n", count, time,
+                       std::min(count, m_textureLoader.GetThreadCount()));
+
+    GetSystemUtils()->DestroyTimeStamp(start);
+    GetSystemUtils()->DestroyTimeStamp(end);
+}
+
 bool IsExcludeColor(Math::Point *exclude, int x, int y)
 {
     int i = 0;
@@ -2406,6 +2569,16 @@ bool IsExcludeColor(Math::Point *exclude, int x, int y)
 }
 
 
+bool CEngine::UpdateTexture(const std::string& name, Math::IntPoint offset, CImage* image)
+{
+    auto it = m_texNameMap.find(name);
+    if (it == m_texNameMap.end())
+        return false;
+
+    m_device->UpdateTexture((*it).second, offset, image->GetData(), m_defaultTexParams.format);
+    return true;
+}
+
 bool CEngine::ChangeTextureColor(const std::string& texName,
                                  Color colorRef1, Color colorNew1,
                                  Color colorRef2, Color colorNew2,
@@ -3069,6 +3242,7 @@ void CEngine::Render()
         return;
 
     m_statisticTriangle = 0;
+    m_statisticDrawCall = 0;
     m_lastState = -1;
     m_lastColor = Color(-1.0f);
     m_lastMaterial = Material();
@@ -3120,6 +3294,9 @@ void CEngine::Draw3DScene()
     m_device->SetTransform(TRANSFORM_PROJECTION, m_matProj);
     m_device->SetTransform(TRANSFORM_VIEW, m_matView);
 
+    m_frustum.Load(m_matView, m_matProj);
+    CullObjects();
+
     if (m_waterMode) m_water->DrawBack();  // draws water background
 
     m_app->StartPerformanceCounter(PCNT_RENDER_TERRAIN);
@@ -3127,89 +3304,101 @@ void CEngine::Draw3DScene()
     // Draw terrain with shadows, if shadows enabled
     if (m_shadowVisible)
     {
-        m_lightMan->UpdateDeviceLights(ENG_OBJTYPE_TERRAIN);
+        m_renderQueue.Clear();
+        QueueObjects(true);
+        DrawQueue();
 
-        for (int objRank = 0; objRank < static_cast<int>(m_objects.size()); objRank++)
-        {
-            if (! m_objects[objRank].used)
-                continue;
+        // Draws the shadows
+        DrawShadow();
+    }
 
-            if (m_objects[objRank].type != ENG_OBJTYPE_TERRAIN)
-                continue;
+    m_app->StopPerformanceCounter(PCNT_RENDER_TERRAIN);
 
-            if (! m_objects[objRank].drawWorld)
-                continue;
+    // Draw other objects, transparent objects last
 
-            m_device->SetTransform(TRANSFORM_WORLD, m_objects[objRank].transform);
+    m_app->StartPerformanceCounter(PCNT_RENDER_OBJECTS);
 
-            if (! IsVisible(objRank))
-                continue;
+    m_renderQueue.Clear();
+    QueueObjects(false);
+    DrawQueue();
 
-            int baseObjRank = m_objects[objRank].baseObjRank;
-            if (baseObjRank == -1)
-                continue;
+    m_app->StopPerformanceCounter(PCNT_RENDER_OBJECTS);
 
-            assert(baseObjRank >= 0 && baseObjRank < static_cast<int>( m_baseObjects.size() ));
+    m_lightMan->UpdateDeviceLights(ENG_OBJTYPE_TERRAIN);
 
-            EngineBaseObject& p1 = m_baseObjects[baseObjRank];
-            if (! p1.used)
-                continue;
+    if (m_debugLights)
+        m_device->DebugLights();
 
-            for (int l2 = 0; l2 < static_cast<int>( p1.next.size() ); l2++)
-            {
-                EngineBaseObjTexTier& p2 = p1.next[l2];
+    if (m_debugDumpLights)
+    {
+        m_debugDumpLights = false;
+        m_lightMan->DebugDumpLights();
+    }
 
-                SetTexture(p2.tex1, 0);
-                SetTexture(p2.tex2, 1);
+    if (m_waterMode)
+    {
+        m_app->StartPerformanceCounter(PCNT_RENDER_WATER);
+        m_water->DrawSurf(); // draws water surface
+        m_app->StopPerformanceCounter(PCNT_RENDER_WATER);
+    }
 
-                for (int l3 = 0; l3 < static_cast<int>( p2.next.size() ); l3++)
-                {
-                    EngineBaseObjLODTier& p3 = p2.next[l3];
+    m_app->StartPerformanceCounter(PCNT_RENDER_PARTICLE);
+    m_particle->DrawParticle(SH_WORLD); // draws the particles of the 3D world
+    m_app->StopPerformanceCounter(PCNT_RENDER_PARTICLE);
 
-                    if (! IsWithinLODLimit(m_objects[objRank].distance, p3.lodLevel))
-                        continue;
+    m_lightning->Draw();                     // draws lightning
 
-                    for (int l4 = 0; l4 < static_cast<int>( p3.next.size() ); l4++)
-                    {
-                        EngineBaseObjDataTier& p4 = p3.next[l4];
+    if (m_lensMode) DrawForegroundImage();   // draws the foreground
 
-                        SetMaterial(p4.material);
-                        SetState(p4.state);
+    if (! m_overFront) DrawOverColor();      // draws the foreground color
+}
 
-                        DrawObject(p4);
-                    }
-                }
-            }
-        }
+void CEngine::DrawObject(const EngineBaseObjDataTier& p4)
+{
+    if (p4.staticBufferId != 0)
+    {
+        m_device->DrawStaticBuffer(p4.staticBufferId);
 
-        // Draws the shadows
-        DrawShadow();
+        if (p4.type == ENG_TRIANGLE_TYPE_TRIANGLES)
+            m_statisticTriangle += p4.vertices.size() / 3;
+        else
+            m_statisticTriangle += p4.vertices.size() - 2;
+        m_statisticDrawCall++;
     }
+    else
+    {
+        if (p4.type == ENG_TRIANGLE_TYPE_TRIANGLES)
+        {
+            m_device->DrawPrimitive(PRIMITIVE_TRIANGLES, &p4.vertices[0], p4.vertices.size());
+            m_statisticTriangle += p4.vertices.size() / 3;
+        }
+        else
+        {
+            m_device->DrawPrimitive(PRIMITIVE_TRIANGLE_STRIP, &p4.vertices[0], p4.vertices.size() );
+            m_statisticTriangle += p4.vertices.size() - 2;
+        }
+        m_statisticDrawCall++;
+    }
+}
 
-    m_app->StopPerformanceCounter(PCNT_RENDER_TERRAIN);
-
-    // Draw other objects (and if shadows disabled, also terrain)
-
-    m_app->StartPerformanceCounter(PCNT_RENDER_OBJECTS);
-
-    bool transparent = false;
+void CEngine::CullObjects()
+{
+    m_cullRanks.clear();
+    m_cullX.clear();
+    m_cullY.clear();
+    m_cullZ.clear();
+    m_cullRadius.clear();
 
     for (int objRank = 0; objRank < static_cast<int>(m_objects.size()); objRank++)
     {
-        if (! m_objects[objRank].used)
-            continue;
+        m_objects[objRank].visible = false;
 
-        if (m_objects[objRank].type == ENG_OBJTYPE_TERRAIN)
+        if (! m_objects[objRank].used)
             continue;
 
         if (! m_objects[objRank].drawWorld)
             continue;
 
-        m_device->SetTransform(TRANSFORM_WORLD, m_objects[objRank].transform);
-
-        if (! IsVisible(objRank))
-            continue;
-
         int baseObjRank = m_objects[objRank].baseObjRank;
         if (baseObjRank == -1)
             continue;
@@ -3220,161 +3409,107 @@ void CEngine::Draw3DScene()
         if (! p1.used)
             continue;
 
-        m_lightMan->UpdateDeviceLights(m_objects[objRank].type);
-
-        for (int l2 = 0; l2 < static_cast<int>( p1.next.size() ); l2++)
+        // The sphere around the origin of the object, scaled as much as the transform does at most
+        Math::Matrix& transform = m_objects[objRank].transform;
+        float scale = 0.0f;
+        for (int c = 1; c <= 3; c++)
         {
-            EngineBaseObjTexTier& p2 = p1.next[l2];
-
-            SetTexture(p2.tex1, 0);
-            SetTexture(p2.tex2, 1);
-
-            for (int l3 = 0; l3 < static_cast<int>( p2.next.size() ); l3++)
-            {
-                EngineBaseObjLODTier& p3 = p2.next[l3];
-
-                if (! IsWithinLODLimit(m_objects[objRank].distance, p3.lodLevel))
-                    continue;
-
-                for (int l4 = 0; l4 < static_cast<int>( p3.next.size() ); l4++)
-                {
-                    EngineBaseObjDataTier& p4 = p3.next[l4];
-
-                    if (m_objects[objRank].transparency != 0.0f)  // transparent ?
-                    {
-                        transparent = true;
-                        continue;
-                    }
-
-                    SetMaterial(p4.material);
-                    SetState(p4.state);
-
-                    DrawObject(p4);
-                }
-            }
+            Math::Vector column(transform.Get(1, c), transform.Get(2, c), transform.Get(3, c));
+            scale = Math::Max(scale, column.Length());
         }
-    }
 
-    // Draw transparent objects
+        m_cullRanks.push_back(objRank);
+        m_cullX.push_back(transform.Get(1, 4));
+        m_cullY.push_back(transform.Get(2, 4));
+        m_cullZ.push_back(transform.Get(3, 4));
+        m_cullRadius.push_back(p1.radius * scale);
+    }
 
-    if (transparent)
-    {
-        int tState = ENG_RSTATE_TTEXTURE_BLACK | ENG_RSTATE_2FACE;
-        Color tColor = Color(68.0f / 255.0f, 68.0f / 255.0f, 68.0f / 255.0f, 68.0f / 255.0f);
+    int count = m_cullRanks.size();
+    m_cullVisible.resize(count);
+    if (count == 0)
+        return;
 
-        for (int objRank = 0; objRank < static_cast<int>(m_objects.size()); objRank++)
-        {
-            if (! m_objects[objRank].used)
-                continue;
+    m_frustum.CullSpheres(&m_cullX[0], &m_cullY[0], &m_cullZ[0], &m_cullRadius[0],
+                          count, &m_cullVisible[0]);
 
-            if (m_objects[objRank].type == ENG_OBJTYPE_TERRAIN)
-                continue;
-
-            if (! m_objects[objRank].drawWorld)
-                continue;
+    for (int i = 0; i < count; i++)
+        m_objects[m_cullRanks[i]].visible = m_cullVisible[i] != 0;
+}
 
-            m_device->SetTransform(TRANSFORM_WORLD, m_objects[objRank].transform);
+void CEngine::QueueObjects(bool terrain)
+{
+    for (int objRank = 0; objRank < static_cast<int>(m_objects.size()); objRank++)
+    {
+        EngineObject& obj = m_objects[objRank];
 
-            if (! IsVisible(objRank))
-                continue;
+        // Set by CullObjects() for used objects drawn in the world
+        if (! obj.visible)
+            continue;
 
-            int baseObjRank = m_objects[objRank].baseObjRank;
-            if (baseObjRank == -1)
-                continue;
+        if ((obj.type == ENG_OBJTYPE_TERRAIN) != terrain)
+            continue;
 
-            assert(baseObjRank >= 0 && baseObjRank < static_cast<int>( m_baseObjects.size() ));
+        EngineBaseObject& p1 = m_baseObjects[obj.baseObjRank];
+        bool transparent = !terrain && obj.transparency != 0.0f;
 
-            EngineBaseObject& p1 = m_baseObjects[baseObjRank];
-            if (! p1.used)
-                continue;
+        Math::Vector pos(obj.transform.Get(1, 4), obj.transform.Get(2, 4), obj.transform.Get(3, 4));
+        unsigned int lightSet = m_lightMan->GetLightSet(obj.type, pos, objRank);
 
-            m_lightMan->UpdateDeviceLights(m_objects[objRank].type);
+        for (int l2 = 0; l2 < static_cast<int>( p1.next.size() ); l2++)
+        {
+            EngineBaseObjTexTier& p2 = p1.next[l2];
 
-            for (int l2 = 0; l2 < static_cast<int>( p1.next.size() ); l2++)
+            for (int l3 = 0; l3 < static_cast<int>( p2.next.size() ); l3++)
             {
-                EngineBaseObjTexTier& p2 = p1.next[l2];
-
-                SetTexture(p2.tex1, 0);
-                SetTexture(p2.tex2, 1);
-
-                for (int l3 = 0; l3 < static_cast<int>( p2.next.size() ); l3++)
-                {
-                    EngineBaseObjLODTier& p3 = p2.next[l3];
-
-                    if (! IsWithinLODLimit(m_objects[objRank].distance, p3.lodLevel))
-                        continue;
-
-                    for (int l4 = 0; l4 < static_cast<int>( p3.next.size() ); l4++)
-                    {
-                        EngineBaseObjDataTier& p4 = p3.next[l4];
-
-                        if (m_objects[objRank].transparency == 0.0f)
-                            continue;
+                EngineBaseObjLODTier& p3 = p2.next[l3];
 
-                        SetMaterial(p4.material);
-                        SetState(tState, tColor);
+                if (! IsWithinLODLimit(obj.distance, p3.lodLevel))
+                    continue;
 
-                        DrawObject(p4);
-                    }
-                }
+                for (int l4 = 0; l4 < static_cast<int>( p3.next.size() ); l4++)
+                    m_renderQueue.Add(objRank, obj.type, lightSet, &p2, &p3.next[l4], transparent);
             }
         }
     }
+}
 
-    m_app->StopPerformanceCounter(PCNT_RENDER_OBJECTS);
-
-    m_lightMan->UpdateDeviceLights(ENG_OBJTYPE_TERRAIN);
+void CEngine::DrawQueue()
+{
+    m_renderQueue.Sort();
 
-    if (m_debugLights)
-        m_device->DebugLights();
+    int tState = ENG_RSTATE_TTEXTURE_BLACK | ENG_RSTATE_2FACE;
+    Color tColor = Color(68.0f / 255.0f, 68.0f / 255.0f, 68.0f / 255.0f, 68.0f / 255.0f);
 
-    if (m_debugDumpLights)
-    {
-        m_debugDumpLights = false;
-        m_lightMan->DebugDumpLights();
-    }
+    int lastObjRank = -1;
+    bool first = true;
 
-    if (m_waterMode)
+    for (const RenderItem& item : m_renderQueue.GetItems())
     {
-        m_app->StartPerformanceCounter(PCNT_RENDER_WATER);
-        m_water->DrawSurf(); // draws water surface
-        m_app->StopPerformanceCounter(PCNT_RENDER_WATER);
-    }
-
-    m_app->StartPerformanceCounter(PCNT_RENDER_PARTICLE);
-    m_particle->DrawParticle(SH_WORLD); // draws the particles of the 3D world
-    m_app->StopPerformanceCounter(PCNT_RENDER_PARTICLE);
+        if (item.objRank != lastObjRank)
+        {
+            Math::Matrix& transform = m_objects[item.objRank].transform;
+            m_device->SetTransform(TRANSFORM_WORLD, transform);
 
-    m_lightning->Draw();                     // draws lightning
+            // Lights nearest to the object, selected by QueueObjects(); the device changes only if they differ
+            Math::Vector pos(transform.Get(1, 4), transform.Get(2, 4), transform.Get(3, 4));
+            m_lightMan->UpdateDeviceLights(static_cast<EngineObjectType>(item.objType), pos, item.objRank);
+            lastObjRank = item.objRank;
+        }
 
-    if (m_lensMode) DrawForegroundImage();   // draws the foreground
+        SetTexture(item.tex->tex1, 0);
+        SetTexture(item.tex->tex2, 1);
 
-    if (! m_overFront) DrawOverColor();      // draws the foreground color
-}
+        if (first || item.data->material != m_lastMaterial)
+            SetMaterial(item.data->material);
 
-void CEngine::DrawObject(const EngineBaseObjDataTier& p4)
-{
-    if (p4.staticBufferId != 0)
-    {
-        m_device->DrawStaticBuffer(p4.staticBufferId);
-
-        if (p4.type == ENG_TRIANGLE_TYPE_TRIANGLES)
-            m_statisticTriangle += p4.vertices.size() / 3;
-        else
-            m_statisticTriangle += p4.vertices.size() - 2;
-    }
-    else
-    {
-        if (p4.type == ENG_TRIANGLE_TYPE_TRIANGLES)
-        {
-            m_device->DrawPrimitive(PRIMITIVE_TRIANGLES, &p4.vertices[0], p4.vertices.size());
-            m_statisticTriangle += p4.vertices.size() / 3;
-        }
+        if (item.transparent)
+            SetState(tState, tColor);
         else
-        {
-            m_device->DrawPrimitive(PRIMITIVE_TRIANGLE_STRIP, &p4.vertices[0], p4.vertices.size() );
-            m_statisticTriangle += p4.vertices.size() - 2;
-        }
+            SetState(item.data->state);
+
+        DrawObject(*item.data);
+        first = false;
     }
 }
 
@@ -3451,7 +3586,9 @@ void CEngine::DrawInterface()
             if (! p1.used)
                 continue;
 
-            m_lightMan->UpdateDeviceLights(m_objects[objRank].type);
+            Math::Matrix& transform = m_objects[objRank].transform;
+            Math::Vector pos(transform.Get(1, 4), transform.Get(2, 4), transform.Get(3, 4));
+            m_lightMan->UpdateDeviceLights(m_objects[objRank].type, pos, objRank);
 
             for (int l2 = 0; l2 < static_cast<int>( p1.next.size() ); l2++)
             {
@@ -3510,235 +3647,41 @@ void CEngine::UpdateGroundSpotTextures()
         m_groundMark.drawIntensity == m_groundMark.intensity)
         return;
 
-    for (int s = 0; s < 16; s++)
-    {
-        Math::Point min, max;
-        min.x = (s%4) * 254.0f - 1.0f;  // 1 pixel cover
-        min.y = (s/4) * 254.0f - 1.0f;
-        max.x = min.x + 254.0f + 2.0f;
-        max.y = min.y + 254.0f + 2.0f;
+    // The spots are drawn once, then only the mark is drawn again over them
+    if (m_firstGroundSpot)
+        m_groundSpotRenderer.DrawSpots(m_groundSpots, m_terrain);
 
-        bool clear = false;
-        bool set   = false;
-
-        // Calculate the area to be erased.
-        int dot = static_cast<int>(m_groundMark.drawRadius/2.0f);
-
-        float tu, tv;
-        float cx, cy;
-
-        tu = (m_groundMark.drawPos.x+1600.0f)/3200.0f;
-        tv = (m_groundMark.drawPos.z+1600.0f)/3200.0f;  // 0..1
+    for (int s = 0; s < CGroundSpotRenderer::TEXTURE_COUNT; s++)
+    {
+        std::stringstream str;
+        str << "shadow" << std::setfill('0') << std::setw(2) << s << ".png";
+        std::string texName = str.str();
 
-        cx = (tu*254.0f*4.0f)-0.5f;
-        cy = (tv*254.0f*4.0f)-0.5f;
+        bool create = m_firstGroundSpot || m_texNameMap.count(texName) == 0;
 
-        if (dot == 0)
+        // Only the pixels of the previous and the new mark change
+        GroundSpotRect rect;
+        if (create)
         {
-            cx += 0.5f;
-            cy += 0.5f;
+            rect = GroundSpotRect(0, 0, CGroundSpotRenderer::TEXTURE_SIZE, CGroundSpotRenderer::TEXTURE_SIZE);
         }
-
-        float px = cx-Math::Mod(cx, 1.0f);
-        float py = cy-Math::Mod(cy, 1.0f);  // multiple of 1
-
-        if (m_firstGroundSpot ||
-            (m_groundMark.drawRadius != 0.0f    &&
-             px+dot >= min.x && py+dot >= min.y &&
-             px-dot <= max.x && py-dot <= max.y))
+        else
         {
-            clear = true;
-        }
-
-        // Calculate the area to draw.
-        dot = static_cast<int>(m_groundMark.radius/2.0f);
-
-        tu = (m_groundMark.pos.x+1600.0f)/3200.0f;
-        tv = (m_groundMark.pos.z+1600.0f)/3200.0f;  // 0..1
+            if (m_groundMark.drawRadius != 0.0f)
+                rect.Add(CGroundSpotRenderer::GetRect(s, m_groundMark.drawPos, m_groundMark.drawRadius));
 
-        cx = (tu*254.0f*4.0f)-0.5f;
-        cy = (tv*254.0f*4.0f)-0.5f;
-
-        if ( dot == 0 )
-        {
-            cx += 0.5f;
-            cy += 0.5f;
+            if (m_groundMark.draw)
+                rect.Add(CGroundSpotRenderer::GetRect(s, m_groundMark.pos, m_groundMark.radius));
         }
 
-        px = cx - Math::Mod(cx, 1.0f);
-        py = cy - Math::Mod(cy, 1.0f);  // multiple of 1
+        if (rect.IsEmpty())
+            continue;
 
-        if (m_groundMark.draw &&
-            px+dot >= min.x && py+dot >= min.y &&
-            px-dot <= max.x && py-dot <= max.y)
-        {
-            set = true;
-        }
+        CImage shadowImg(Math::IntPoint(rect.x2 - rect.x1, rect.y2 - rect.y1));
+        m_groundSpotRenderer.Render(s, rect, m_groundMark, m_groundMark.draw, &shadowImg);
 
-        if (clear || set)
+        if (create)
         {
-            CImage shadowImg(Math::IntPoint(256, 256));
-            shadowImg.Fill(Gfx::IntColor(255, 255, 255, 255));
-
-            // Draw the new shadows.
-            for (int i = 0; i < static_cast<int>( m_groundSpots.size() ); i++)
-            {
-                if (m_groundSpots[i].used == false ||
-                    m_groundSpots[i].radius == 0.0f)
-                    continue;
-
-                if (m_groundSpots[i].min == 0.0f &&
-                    m_groundSpots[i].max == 0.0f)
-                {
-                    dot = static_cast<int>(m_groundSpots[i].radius/2.0f);
-
-                    tu = (m_groundSpots[i].pos.x+1600.0f)/3200.0f;
-                    tv = (m_groundSpots[i].pos.z+1600.0f)/3200.0f;  // 0..1
-
-                    cx = (tu*254.0f*4.0f) - 0.5f;
-                    cy = (tv*254.0f*4.0f) - 0.5f;
-
-                    if (dot == 0)
-                    {
-                        cx += 0.5f;
-                        cy += 0.5f;
-                    }
-
-                    px = cx-Math::Mod(cx, 1.0f);
-                    py = cy-Math::Mod(cy, 1.0f);  // multiple of 1
-
-                    if (px+dot < min.x || py+dot < min.y ||
-                        px-dot > max.x || py-dot > max.y)
-                        continue;
-
-                    for (int iy = -dot; iy <= dot; iy++)
-                    {
-                        for (int ix =- dot; ix <= dot; ix++)
-                        {
-                            float ppx = px+ix;
-                            float ppy = py+iy;
-
-                            if (ppx <  min.x || ppy <  min.y ||
-                                ppx >= max.x || ppy >= max.y)
-                                continue;
-
-                            float intensity;
-                            if (dot == 0)
-                                intensity = 0.0f;
-                            else
-                                intensity = Math::Point(ppx-cx, ppy-cy).Length()/dot;
-
-                            Gfx::Color color;
-                            color.r = Math::Norm(m_groundSpots[i].color.r+intensity);
-                            color.g = Math::Norm(m_groundSpots[i].color.g+intensity);
-                            color.b = Math::Norm(m_groundSpots[i].color.b+intensity);
-
-                            ppx -= min.x;  // on the texture
-                            ppy -= min.y;
-
-                            shadowImg.SetPixel(Math::IntPoint(ppx, ppy), color);
-                        }
-                    }
-                }
-                else
-                {
-                    for (int iy = 0; iy < 256; iy++)
-                    {
-                        for (int ix = 0; ix < 256; ix++)
-                        {
-                            Math::Vector pos;
-                            pos.x = (256.0f * (s%4) + ix) * 3200.0f/1024.0f - 1600.0f;
-                            pos.z = (256.0f * (s/4) + iy) * 3200.0f/1024.0f - 1600.0f;
-                            pos.y = 0.0f;
-
-                            float level = m_terrain->GetFloorLevel(pos, true);
-                            if (level < m_groundSpots[i].min ||
-                                level > m_groundSpots[i].max)
-                                continue;
-
-                            float intensity;
-                            if (level > (m_groundSpots[i].max+m_groundSpots[i].min)/2.0f)
-                                intensity = 1.0f - (m_groundSpots[i].max-level) / m_groundSpots[i].smooth;
-                            else
-                                intensity = 1.0f - (level-m_groundSpots[i].min) / m_groundSpots[i].smooth;
-
-                            if (intensity < 0.0f) intensity = 0.0f;
-
-                            Gfx::Color color;
-                            color.r = Math::Norm(m_groundSpots[i].color.r+intensity);
-                            color.g = Math::Norm(m_groundSpots[i].color.g+intensity);
-                            color.b = Math::Norm(m_groundSpots[i].color.b+intensity);
-
-                            shadowImg.SetPixel(Math::IntPoint(ix, iy), color);
-                        }
-                    }
-                }
-            }
-
-            if (set)
-            {
-                dot = static_cast<int>(m_groundMark.radius/2.0f);
-
-                tu = (m_groundMark.pos.x + 1600.0f) / 3200.0f;
-                tv = (m_groundMark.pos.z + 1600.0f) / 3200.0f;  // 0..1
-
-                cx = (tu*254.0f*4.0f)-0.5f;
-                cy = (tv*254.0f*4.0f)-0.5f;
-
-                if (dot == 0)
-                {
-                    cx += 0.5f;
-                    cy += 0.5f;
-                }
-
-                px = cx-Math::Mod(cx, 1.0f);
-                py = cy-Math::Mod(cy, 1.0f);  // multiple of 1
-
-                for (int iy = -dot; iy <= dot; iy++)
-                {
-                    for (int ix = -dot; ix <= dot; ix++)
-                    {
-                        float ppx = px+ix;
-                        float ppy = py+iy;
-
-                        if (ppx <  min.x || ppy <  min.y ||
-                            ppx >= max.x || ppy >= max.y)
-                            continue;
-
-                        ppx -= min.x;  // on the texture
-                        ppy -= min.y;
-
-                        float intensity = 1.0f - Math::Point(ix, iy).Length() / dot;
-                        if (intensity <= 0.0f)
-                            continue;
-
-                        intensity *= m_groundMark.intensity;
-
-                        int j = (ix+dot) + (iy+dot) * m_groundMark.dx;
-                        if (m_groundMark.table[j] == 1)  // green ?
-                        {
-                            Gfx::Color color;
-                            color.r = Math::Norm(1.0f-intensity);
-                            color.g = 1.0f;
-                            color.b = Math::Norm(1.0f-intensity);
-                            shadowImg.SetPixel(Math::IntPoint(ppx, ppy), color);
-                        }
-                        if (m_groundMark.table[j] == 2)  // red ?
-                        {
-                            Gfx::Color color;
-                            color.r = 1.0f;
-                            color.g = Math::Norm(1.0f-intensity);
-                            color.b = Math::Norm(1.0f-intensity);
-                            shadowImg.SetPixel(Math::IntPoint(ppx, ppy), color);
-                        }
-                    }
-                }
-            }
-
-            std::stringstream str;
-            str << "shadow" << std::setfill('0') << std::setw(2) << s << ".png";
-            std::string texName = str.str();
-
             DeleteTexture(texName);
 
             Gfx::Texture tex = m_device->CreateTexture(&shadowImg, m_defaultTexParams);
@@ -3746,6 +3689,10 @@ void CEngine::UpdateGroundSpotTextures()
             m_texNameMap[texName] = tex;
             m_revTexNameMap[tex] = texName;
         }
+        else
+        {
+            UpdateTexture(texName, Math::IntPoint(rect.x1, rect.y1), &shadowImg);
+        }
     }
 
     for (int i = 0; i < static_cast<int>( m_groundSpots.size() ); i++)
@@ -4329,7 +4276,7 @@ void CEngine::DrawStats()
     float height = m_text->GetAscent(FONT_COLOBOT, 12.0f);
     float width = 0.2f;
 
-    Math::Point pos(0.04f, 0.04f + 17 * height);
+    Math::Point pos(0.04f, 0.04f + 18 * height);
 
     SetState(ENG_RSTATE_OPAQUE_COLOR);
 
@@ -4337,9 +4284,9 @@ void CEngine::DrawStats()
 
     VertexCol vertex[4] =
     {
-        VertexCol(Math::Vector(pos.x        , pos.y - 17 * height, 0.0f), black),
+        VertexCol(Math::Vector(pos.x        , pos.y - 18 * height, 0.0f), black),
         VertexCol(Math::Vector(pos.x        , pos.y + height, 0.0f), black),
-        VertexCol(Math::Vector(pos.x + width, pos.y - 17 * height, 0.0f), black),
+        VertexCol(Math::Vector(pos.x + width, pos.y - 18 * height, 0.0f), black),
         VertexCol(Math::Vector(pos.x + width, pos.y + height, 0.0f), black)
     };
 
@@ -4451,6 +4398,12 @@ void CEngine::DrawStats()
 
     pos.y -= height;
 
+    str.str("");
+    str << "Draw calls: " << m_statisticDrawCall;
+    m_text->DrawText(str.str(), FONT_COLOBOT, 12.0f, pos, 1.0f, TEXT_ALIGN_LEFT, 0, Color(1.0f, 1.0f, 1.0f, 1.0f));
+
+    pos.y -= height;
+
     m_text->DrawText(m_fpsText, FONT_COLOBOT, 12.0f, pos, 1.0f, TEXT_ALIGN_LEFT, 0, Color(1.0f, 1.0f, 1.0f, 1.0f));
 }
 
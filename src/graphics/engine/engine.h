@@ -34,7 +34,10 @@
 #include "graphics/core/texture.h"
 #include "graphics/core/vertex.h"
 
+#include "graphics/engine/groundspot.h"
 #include "graphics/engine/modelfile.h"
+#include "graphics/engine/renderqueue.h"
+#include "graphics/engine/textureloader.h"
 
 #include "math/intpoint.h"
 #include "math/matrix.h"
@@ -771,10 +774,12 @@ public:
     Math::IntPoint   InterfaceToWindowSize(Math::Point size);
     //@}
 
-    //! Increments the triangle counter for the current frame
+    //! Counts a draw call of \a nb triangles in the current frame
     void            AddStatisticTriangle(int nb);
     //! Returns the number of triangles in current frame
     int             GetStatisticTriangle();
+    //! Returns the number of draw calls in current frame
+    int             GetStatisticDrawCall();
 
 
     /* *************** Object management *************** */
@@ -797,11 +802,23 @@ public:
                                         const Material& material, int state,
                                         std::string tex1Name, std::string tex2Name,
                                         LODLevel lodLevel, bool globalUpdate);
+    //! Adds triangles to given object with the specified params, from an array of vertices
+    void            AddBaseObjTriangles(int baseObjRank, const VertexTex2* vertices, int vertexCount,
+                                        EngineTriangleType triangleType,
+                                        const Material& material, int state,
+                                        std::string tex1Name, std::string tex2Name,
+                                        LODLevel lodLevel, bool globalUpdate);
 
     //! Adds a tier 4 engine object directly
     void            AddBaseObjQuick(int baseObjRank, const EngineBaseObjDataTier& buffer,
                                     std::string tex1Name, std::string tex2Name,
                                     LODLevel lodLevel, bool globalUpdate);
+    //! Replaces the vertices of the n-th tier 4 object added by AddBaseObjQuick() with the given textures
+    /** The number of vertices must not change; the static buffer is updated in place.
+        Returns false if there is no such tier 4 object. */
+    bool            UpdateBaseObjQuick(int baseObjRank, int index, const std::vector<VertexTex2>& vertices,
+                                       const std::string& tex1Name, const std::string& tex2Name,
+                                       LODLevel lodLevel);
 
     // Objects
 
@@ -945,6 +962,12 @@ public:
     Texture         LoadTexture(const std::string& name, const TextureCreateParams& params);
     //! Loads all necessary textures
     bool            LoadAllTextures();
+    //! Defers LoadAllTextures() until loading is no longer deferred, while a scene is created
+    void            SetTextureLoadDeferred(bool deferred);
+
+    //! Replaces the part of a loaded texture from \a offset with the image
+    /** If the texture is not loaded, returns false. */
+    bool            UpdateTexture(const std::string& name, Math::IntPoint offset, CImage* image);
 
     //! Changes colors in a texture
     bool            ChangeTextureColor(const std::string& texName,
@@ -1203,6 +1226,12 @@ protected:
     void        Draw3DScene();
     //! Draw 3D object
     void        DrawObject(const EngineBaseObjDataTier& p4);
+    //! Marks the objects inside the frustum as visible, all at once
+    void        CullObjects();
+    //! Adds the visible terrain objects, or the other visible objects, to the render queue
+    void        QueueObjects(bool terrain);
+    //! Sorts and draws the render queue
+    void        DrawQueue();
     //! Draws the user interface over the scene
     void        DrawInterface();
 
@@ -1242,6 +1271,8 @@ protected:
 
     //! Create texture and add it to cache
     Texture CreateTexture(const std::string &texName, const TextureCreateParams &params, CImage* image = nullptr);
+    //! Decodes the images of the textures LoadAllTextures() will create, on several threads
+    void        DecodeAllTextures();
 
     //! Tests whether the given object is visible
     bool        IsVisible(int objRank);
@@ -1325,12 +1356,22 @@ protected:
     std::vector<EngineBaseObject> m_baseObjects;
     //! Object parameters
     std::vector<EngineObject>     m_objects;
+    //! Planes of the view frustum of the frame
+    Frustum                       m_frustum;
+    //! Bounding spheres of the objects culled by CullObjects(), in world coordinates
+    std::vector<int>              m_cullRanks;
+    std::vector<float>            m_cullX, m_cullY, m_cullZ, m_cullRadius;
+    std::vector<unsigned char>    m_cullVisible;
+    //! Tier 4 objects drawn by DrawQueue()
+    CRenderQueue                  m_renderQueue;
     //! Shadow list
     std::vector<EngineShadow>     m_shadows;
     //! Ground spot list
     std::vector<EngineGroundSpot> m_groundSpots;
     //! Ground mark
     EngineGroundMark              m_groundMark;
+    //! Pixels of the textures of the ground spots
+    CGroundSpotRenderer           m_groundSpotRenderer;
 
     //! Location of camera
     Math::Vector    m_eyePt;
@@ -1346,6 +1387,7 @@ protected:
     float           m_fogStart[2];
     Color           m_waterAddColor;
     int             m_statisticTriangle;
+    int             m_statisticDrawCall;
     bool            m_updateGeometry;
     bool            m_updateStaticBuffers;
     int             m_alphaMode;
@@ -1412,6 +1454,12 @@ protected:
     /** Textures on this list were not successful in first loading,
      *  so are disabled for subsequent load calls. */
     std::set<std::string> m_texBlacklist;
+    //! Images decoded for LoadAllTextures()
+    CTextureLoader m_textureLoader;
+    //! If true, LoadAllTextures() waits for the end of the creation of the scene
+    bool            m_textureLoadDeferred;
+    //! If true, LoadAllTextures() was called while deferred
+    bool            m_textureLoadPending;
 
     //! Mouse cursor definitions
     EngineMouse     m_mice[ENG_MOUSE_COUNT];
@@ -0,0 +1,171 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+
+#include "graphics/engine/glyphatlas.h"
+
+#include "common/image.h"
+
+#include "graphics/core/device.h"
+
+#include "math/func.h"
+
+#include <SDL.h>
+
+
+// Graphics module namespace
+namespace Gfx {
+
+
+//! Empty pixels around each glyph, so that neighbours never bleed into it
+const int GLYPH_MARGIN = 1;
+
+
+CGlyphAtlas::CGlyphAtlas(CDevice* device, int pageSize)
+{
+    m_device = device;
+    m_pageSize = pageSize;
+}
+
+CGlyphAtlas::~CGlyphAtlas()
+{
+    Flush();
+}
+
+bool CGlyphAtlas::AddGlyph(SDL_Surface* surface, Glyph &glyph)
+{
+    int index = FindPlace(surface->w + GLYPH_MARGIN, surface->h + GLYPH_MARGIN);
+    if (index == -1)
+        return false;
+
+    Page &page = m_pages[index];
+
+    // Copies the pixels as they are, alpha included
+    surface->flags = surface->flags & (~SDL_SRCALPHA);
+    SDL_Rect dest;
+    dest.x = page.x;
+    dest.y = page.y;
+    SDL_BlitSurface(surface, NULL, page.surface, &dest);
+
+    float size = page.surface->w;
+    glyph.page = index;
+    glyph.size = Math::IntPoint(surface->w, surface->h);
+    glyph.texCoord1 = Math::Point(page.x / size, page.y / size);
+    glyph.texCoord2 = Math::Point((page.x + surface->w) / size, (page.y + surface->h) / size);
+
+    page.x += surface->w + GLYPH_MARGIN;
+    page.dirty = true;
+
+    return true;
+}
+
+int CGlyphAtlas::FindPlace(int width, int height)
+{
+    if (! m_pages.empty())
+    {
+        Page &page = m_pages.back();
+        int size = page.surface->w;
+
+        if (page.x + width > size)  // next row
+        {
+            page.x = 0;
+            page.y += page.rowHeight;
+            page.rowHeight = 0;
+        }
+
+        if (page.x + width <= size && page.y + height <= size)
+        {
+            page.rowHeight = Math::Max(page.rowHeight, height);
+            return m_pages.size() - 1;
+        }
+    }
+
+    // Only the last page is filled, the rows of the others are full
+    int size = Math::Max(m_pageSize, Math::NextPowerOfTwo(Math::Max(width, height)));
+
+    Page page;
+    page.surface = SDL_CreateRGBSurface(0, size, size, 32, 0x00ff0000, 0x0000ff00,
+                                        0x000000ff, 0xff000000);
+    if (page.surface == nullptr)
+        return -1;
+
+    SDL_FillRect(page.surface, NULL, 0);
+    page.texture = 0;
+    page.dirty = true;
+    page.x = 0;
+    page.y = 0;
+    page.rowHeight = height;
+    m_pages.push_back(page);
+
+    return m_pages.size() - 1;
+}
+
+unsigned int CGlyphAtlas::GetTexture(int page)
+{
+    Page &p = m_pages[page];
+    if (! p.dirty)
+        return p.texture;
+
+    DestroyTexture(p);
+
+    ImageData data;
+    data.surface = p.surface;
+
+    TextureCreateParams createParams;
+    createParams.format = TEX_IMG_RGBA;
+    createParams.minFilter = TEX_MIN_FILTER_NEAREST;
+    createParams.magFilter = TEX_MAG_FILTER_NEAREST;
+    createParams.mipmap = false;
+
+    Texture tex = m_device->CreateTexture(&data, createParams);
+
+    data.surface = nullptr;
+
+    p.texture = tex.id;
+    p.dirty = false;
+
+    return p.texture;
+}
+
+int CGlyphAtlas::GetPageCount()
+{
+    return m_pages.size();
+}
+
+void CGlyphAtlas::Flush()
+{
+    for (Page &page : m_pages)
+    {
+        DestroyTexture(page);
+        SDL_FreeSurface(page.surface);
+    }
+
+    m_pages.clear();
+}
+
+void CGlyphAtlas::DestroyTexture(Page &page)
+{
+    if (page.texture == 0)
+        return;
+
+    Texture tex;
+    tex.id = page.texture;
+    m_device->DestroyTexture(tex);
+    page.texture = 0;
+}
+
+
+} // namespace Gfx
@@ -0,0 +1,108 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file graphics/engine/glyphatlas.h
+ * \brief Glyphs packed in shared textures - CGlyphAtlas class
+ */
+
+#pragma once
+
+
+#include "math/intpoint.h"
+#include "math/point.h"
+
+#include <vector>
+
+
+struct SDL_Surface;
+
+
+// Graphics module namespace
+namespace Gfx {
+
+class CDevice;
+
+/**
+ * \struct Glyph
+ * \brief Place of a glyph in a CGlyphAtlas
+ */
+struct Glyph
+{
+    //! Page holding the glyph
+    int page;
+    //! Texture coordinates of the top left and bottom right corners
+    Math::Point texCoord1, texCoord2;
+    //! Size in pixels
+    Math::IntPoint size;
+
+    Glyph() : page(-1) {}
+};
+
+/**
+ * \class CGlyphAtlas
+ * \brief Glyphs of one font packed in a few textures
+ *
+ * Rendered glyphs are copied side by side, in rows, to pages kept in
+ * memory. A page becomes a texture when it is first used for drawing and
+ * is uploaded again only when glyphs were added to it since, so the text
+ * using these glyphs can be drawn with one texture.
+ */
+class CGlyphAtlas
+{
+public:
+    //! Creates an atlas with pages of \a pageSize pixels
+    CGlyphAtlas(CDevice* device, int pageSize = 512);
+    //! Destroys the textures, so the device must still exist
+    ~CGlyphAtlas();
+
+    //! Copies a glyph rendered with SDL_ttf, returns false on error
+    bool            AddGlyph(SDL_Surface* surface, Glyph &glyph);
+
+    //! Returns the texture of a page, updated with the last glyphs
+    unsigned int    GetTexture(int page);
+
+    //! Returns the number of pages
+    int             GetPageCount();
+
+    //! Destroys the textures and removes all glyphs
+    void            Flush();
+
+protected:
+    struct Page
+    {
+        SDL_Surface*    surface;
+        unsigned int    texture;
+        //! Glyphs were added since the texture was created
+        bool            dirty;
+        //! Place of the next glyph in the current row
+        int             x, y;
+        //! Height of the current row
+        int             rowHeight;
+    };
+
+    //! Finds a place for a glyph of \a width x \a height pixels, adding a page if needed
+    int             FindPlace(int width, int height);
+    void            DestroyTexture(Page &page);
+
+protected:
+    CDevice*            m_device;
+    int                 m_pageSize;
+    std::vector<Page>   m_pages;
+};
+
+
+} // namespace Gfx
@@ -0,0 +1,320 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+
+#include "graphics/engine/groundspot.h"
+
+#include "common/image.h"
+#include "common/profiler.h"
+
+#include "graphics/engine/engine.h"
+#include "graphics/engine/terrain.h"
+
+#include "math/func.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <thread>
+
+
+// Graphics module namespace
+namespace Gfx {
+
+
+namespace {
+
+const unsigned int WHITE_PIXEL = 0xFFFFFFFF;
+
+//! Returns the pixel of a color with alpha 0, as given by CImage::SetPixel()
+inline unsigned int GetPixel(float r, float g, float b)
+{
+    return (static_cast<unsigned int>(static_cast<unsigned char>(r * 255.0f)) << 16) |
+           (static_cast<unsigned int>(static_cast<unsigned char>(g * 255.0f)) <<  8) |
+           (static_cast<unsigned int>(static_cast<unsigned char>(b * 255.0f))      );
+}
+
+//! Computes the center of a spot in pixels of all the textures, and the pixel (px, py) at its center
+void GetCenter(const Math::Vector& pos, int dot, float& cx, float& cy, float& px, float& py)
+{
+    float tu = (pos.x+1600.0f)/3200.0f;
+    float tv = (pos.z+1600.0f)/3200.0f;  // 0..1
+
+    cx = (tu*254.0f*4.0f)-0.5f;
+    cy = (tv*254.0f*4.0f)-0.5f;
+
+    if (dot == 0)
+    {
+        cx += 0.5f;
+        cy += 0.5f;
+    }
+
+    px = cx-Math::Mod(cx, 1.0f);
+    py = cy-Math::Mod(cy, 1.0f);  // multiple of 1
+}
+
+//! Returns the first pixel of texture \a tex in pixels of all the textures (1 pixel cover)
+inline float GetTextureMinX(int tex)
+{
+    return (tex%4) * 254.0f - 1.0f;
+}
+
+inline float GetTextureMinY(int tex)
+{
+    return (tex/4) * 254.0f - 1.0f;
+}
+
+} // anonymous namespace
+
+
+void GroundSpotRect::Add(const GroundSpotRect& other)
+{
+    if (other.IsEmpty())
+        return;
+
+    if (IsEmpty())
+    {
+        *this = other;
+        return;
+    }
+
+    x1 = std::min(x1, other.x1);
+    y1 = std::min(y1, other.y1);
+    x2 = std::max(x2, other.x2);
+    y2 = std::max(y2, other.y2);
+}
+
+
+const int CGroundSpotRenderer::TEXTURE_COUNT;
+const int CGroundSpotRenderer::TEXTURE_SIZE;
+
+CGroundSpotRenderer::CGroundSpotRenderer(int threads)
+{
+    if (threads < 0)
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+
+    m_threadCount = threads > 0 ? threads : 1;
+}
+
+CGroundSpotRenderer::~CGroundSpotRenderer()
+{
+}
+
+GroundSpotRect CGroundSpotRenderer::GetRect(int tex, const Math::Vector& pos, float radius)
+{
+    int dot = static_cast<int>(radius/2.0f);
+
+    float cx, cy, px, py;
+    GetCenter(pos, dot, cx, cy, px, py);
+
+    float minX = GetTextureMinX(tex);
+    float minY = GetTextureMinY(tex);
+
+    GroundSpotRect rect;
+    rect.x1 = std::max(static_cast<int>(px - dot - minX), 0);
+    rect.y1 = std::max(static_cast<int>(py - dot - minY), 0);
+    rect.x2 = std::min(static_cast<int>(px + dot - minX) + 1, TEXTURE_SIZE);
+    rect.y2 = std::min(static_cast<int>(py + dot - minY) + 1, TEXTURE_SIZE);
+
+    if (rect.IsEmpty())
+        return GroundSpotRect();
+
+    return rect;
+}
+
+void CGroundSpotRenderer::DrawSpots(const std::vector<EngineGroundSpot>& spots, CTerrain* terrain)
+{
+    int threads = std::min(m_threadCount, TEXTURE_COUNT);
+    if (threads <= 1)
+    {
+        for (int tex = 0; tex < TEXTURE_COUNT; tex++)
+            DrawTextureSpots(tex, spots, terrain);
+
+        return;
+    }
+
+    // The textures are independent, each thread takes the next one
+    std::atomic<int> next(0);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++)
+    {
+        workers.push_back(std::thread([this, &next, &spots, terrain]
+        {
+            if (CProfiler::IsEnabled())
+                CProfiler::GetInstancePointer()->SetThreadName("Ground spots");
+
+            for (int tex = next++; tex < TEXTURE_COUNT; tex = next++)
+                DrawTextureSpots(tex, spots, terrain);
+        }));
+    }
+
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void CGroundSpotRenderer::DrawTextureSpots(int tex, const std::vector<EngineGroundSpot>& spots, CTerrain* terrain)
+{
+    std::vector<unsigned int>& pixels = m_spotPixels[tex];
+    pixels.assign(TEXTURE_SIZE * TEXTURE_SIZE, WHITE_PIXEL);
+
+    float minX = GetTextureMinX(tex);
+    float minY = GetTextureMinY(tex);
+
+    // Level of the terrain at each pixel, computed for the first spot between two altitudes
+    std::vector<float> levels;
+
+    for (int i = 0; i < static_cast<int>( spots.size() ); i++)
+    {
+        const EngineGroundSpot& spot = spots[i];
+        if (spot.used == false || spot.radius == 0.0f)
+            continue;
+
+        if (spot.min == 0.0f && spot.max == 0.0f)
+        {
+            GroundSpotRect rect = GetRect(tex, spot.pos, spot.radius);
+            if (rect.IsEmpty())
+                continue;
+
+            int dot = static_cast<int>(spot.radius/2.0f);
+
+            float cx, cy, px, py;
+            GetCenter(spot.pos, dot, cx, cy, px, py);
+
+            for (int y = rect.y1; y < rect.y2; y++)
+            {
+                float dy = (minY + y) - cy;
+                unsigned int* row = &pixels[y * TEXTURE_SIZE];
+
+                for (int x = rect.x1; x < rect.x2; x++)
+                {
+                    float dx = (minX + x) - cx;
+                    float intensity = dot == 0 ? 0.0f : sqrtf(dx*dx + dy*dy)/dot;
+
+                    row[x] = GetPixel(Math::Norm(spot.color.r+intensity),
+                                      Math::Norm(spot.color.g+intensity),
+                                      Math::Norm(spot.color.b+intensity));
+                }
+            }
+        }
+        else
+        {
+            if (terrain == nullptr)
+                continue;
+
+            if (levels.empty())
+            {
+                levels.resize(TEXTURE_SIZE * TEXTURE_SIZE);
+                for (int iy = 0; iy < TEXTURE_SIZE; iy++)
+                {
+                    for (int ix = 0; ix < TEXTURE_SIZE; ix++)
+                    {
+                        Math::Vector pos;
+                        pos.x = (256.0f * (tex%4) + ix) * 3200.0f/1024.0f - 1600.0f;
+                        pos.z = (256.0f * (tex/4) + iy) * 3200.0f/1024.0f - 1600.0f;
+                        pos.y = 0.0f;
+
+                        levels[ix + iy * TEXTURE_SIZE] = terrain->GetFloorLevel(pos, true);
+                    }
+                }
+            }
+
+            for (int j = 0; j < TEXTURE_SIZE * TEXTURE_SIZE; j++)
+            {
+                float level = levels[j];
+                if (level < spot.min ||
+                    level > spot.max)
+                    continue;
+
+                float intensity;
+                if (level > (spot.max+spot.min)/2.0f)
+                    intensity = 1.0f - (spot.max-level) / spot.smooth;
+                else
+                    intensity = 1.0f - (level-spot.min) / spot.smooth;
+
+                if (intensity < 0.0f) intensity = 0.0f;
+
+                pixels[j] = GetPixel(Math::Norm(spot.color.r+intensity),
+                                     Math::Norm(spot.color.g+intensity),
+                                     Math::Norm(spot.color.b+intensity));
+            }
+        }
+    }
+}
+
+void CGroundSpotRenderer::Render(int tex, const GroundSpotRect& rect, const EngineGroundMark& mark,
+                                 bool drawMark, CImage* image)
+{
+    int width  = rect.x2 - rect.x1;
+    int height = rect.y2 - rect.y1;
+    assert(image->GetSize().x == width && image->GetSize().y == height);
+
+    m_pixels.resize(width * height);
+
+    const std::vector<unsigned int>& spotPixels = m_spotPixels[tex];
+    for (int y = 0; y < height; y++)
+    {
+        unsigned int* row = &m_pixels[y * width];
+        if (spotPixels.empty())
+            std::fill(row, row + width, WHITE_PIXEL);
+        else
+            std::copy(&spotPixels[(rect.y1 + y) * TEXTURE_SIZE + rect.x1],
+                      &spotPixels[(rect.y1 + y) * TEXTURE_SIZE + rect.x2], row);
+    }
+
+    if (drawMark)
+    {
+        int dot = static_cast<int>(mark.radius/2.0f);
+
+        float cx, cy, px, py;
+        GetCenter(mark.pos, dot, cx, cy, px, py);
+
+        // The pixel (px, py) on the texture
+        int tx = static_cast<int>(px - GetTextureMinX(tex));
+        int ty = static_cast<int>(py - GetTextureMinY(tex));
+
+        int iy1 = std::max(-dot, rect.y1 - ty);
+        int iy2 = std::min( dot, rect.y2 - ty - 1);
+        int ix1 = std::max(-dot, rect.x1 - tx);
+        int ix2 = std::min( dot, rect.x2 - tx - 1);
+
+        for (int iy = iy1; iy <= iy2; iy++)
+        {
+            unsigned int* row = &m_pixels[(ty + iy - rect.y1) * width];
+
+            for (int ix = ix1; ix <= ix2; ix++)
+            {
+                float intensity = 1.0f - Math::Point(ix, iy).Length() / dot;
+                if (intensity <= 0.0f)
+                    continue;
+
+                intensity *= mark.intensity;
+
+                int j = (ix+dot) + (iy+dot) * mark.dx;
+                int x = tx + ix - rect.x1;
+                if (mark.table[j] == 1)  // green ?
+                    row[x] = GetPixel(Math::Norm(1.0f-intensity), 1.0f, Math::Norm(1.0f-intensity));
+
+                if (mark.table[j] == 2)  // red ?
+                    row[x] = GetPixel(1.0f, Math::Norm(1.0f-intensity), Math::Norm(1.0f-intensity));
+            }
+        }
+    }
+
+    image->SetDataPixels(&m_pixels[0]);
+}
+
+
+} // namespace Gfx
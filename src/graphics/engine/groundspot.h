@@ -0,0 +1,111 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file graphics/engine/groundspot.h
+ * \brief Pixels of the textures of ground spots - CGroundSpotRenderer class
+ */
+
+#pragma once
+
+
+#include "math/vector.h"
+
+#include <vector>
+
+
+class CImage;
+
+
+// Graphics module namespace
+namespace Gfx {
+
+class CTerrain;
+struct EngineGroundSpot;
+struct EngineGroundMark;
+
+/**
+ * \struct GroundSpotRect
+ * \brief Rectangle of pixels of a ground spot texture, from (x1, y1) to (x2, y2) excluded
+ */
+struct GroundSpotRect
+{
+    int x1, y1, x2, y2;
+
+    GroundSpotRect()
+        : x1(0), y1(0), x2(0), y2(0) {}
+
+    GroundSpotRect(int aX1, int aY1, int aX2, int aY2)
+        : x1(aX1), y1(aY1), x2(aX2), y2(aY2) {}
+
+    //! Returns true if the rectangle has no pixel
+    bool IsEmpty() const
+    {
+        return x1 >= x2 || y1 >= y2;
+    }
+
+    //! Extends the rectangle to cover \a other
+    void Add(const GroundSpotRect& other);
+};
+
+/**
+ * \class CGroundSpotRenderer
+ * \brief Computes the pixels of the 16 textures "shadowNN.png" of the ground spots and the ground mark
+ *
+ * The textures cover the terrain in 4x4 tiles of 254 pixels, with 1 pixel
+ * shared with each neighbour. The spots are fixed once the scene is
+ * created, so they are drawn once by DrawSpots() and kept for each
+ * texture; the ground mark, which grows and moves, is then drawn over
+ * a copy of these pixels by Render(), only in the rectangles it covers.
+ */
+class CGroundSpotRenderer
+{
+public:
+    //! Number of textures
+    static const int TEXTURE_COUNT = 16;
+    //! Width and height of the textures in pixels
+    static const int TEXTURE_SIZE = 256;
+
+    //! Creates a renderer drawing the spots on \a threads threads; -1 for the number of cores
+    CGroundSpotRenderer(int threads = -1);
+    ~CGroundSpotRenderer();
+
+    //! Returns the rectangle of texture \a tex covered by a round spot or mark, empty if none
+    static GroundSpotRect GetRect(int tex, const Math::Vector& pos, float radius);
+
+    //! Draws the spots on all the textures
+    /** The terrain is only used for the spots between two altitudes. */
+    void        DrawSpots(const std::vector<EngineGroundSpot>& spots, CTerrain* terrain);
+
+    //! Gives the pixels of a rectangle of texture \a tex, with the mark if \a drawMark
+    /** \a image has the size of the rectangle. */
+    void        Render(int tex, const GroundSpotRect& rect, const EngineGroundMark& mark,
+                       bool drawMark, CImage* image);
+
+protected:
+    //! Draws the spots on texture \a tex
+    void        DrawTextureSpots(int tex, const std::vector<EngineGroundSpot>& spots, CTerrain* terrain);
+
+protected:
+    int         m_threadCount;
+    //! Pixels of each texture with the spots only, as in CImage
+    std::vector<unsigned int> m_spotPixels[TEXTURE_COUNT];
+    //! Pixels of the rectangle rendered
+    std::vector<unsigned int> m_pixels;
+};
+
+
+} // namespace Gfx
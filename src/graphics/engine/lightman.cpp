@@ -26,6 +26,7 @@
 
 
 #include <cmath>
+#include <cstdlib>
 #include <algorithm>
 
 
@@ -75,6 +76,10 @@ CLightManager::CLightManager(CEngine* engine)
     m_engine = engine;
 
     m_time = 0.0f;
+
+    m_lightsChanged = true;
+    m_gridVersion = 0;
+    m_gridPriority = LIGHT_PRI_LOW;
 }
 
 CLightManager::~CLightManager()
@@ -86,7 +91,11 @@ CLightManager::~CLightManager()
 void CLightManager::SetDevice(CDevice* device)
 {
     m_device = device;
-    m_lightMap = std::vector<int>(m_device->GetMaxLightCount(), -1);
+    m_lightMap = std::vector<int>(m_device->GetMaxLightCount(), LIGHT_SLOT_UNKNOWN);
+    m_lightEnabled = std::vector<bool>(m_lightMap.size(), false);
+    m_objectLights.clear();
+    m_objectSelections.clear();
+    m_lightsChanged = true;
 }
 
 void CLightManager::DebugDumpLights()
@@ -104,7 +113,7 @@ void CLightManager::DebugDumpLights()
         int deviceLight = -1;
         for (int j = 0; j < static_cast<int>( m_lightMap.size() ); ++j)
         {
-            if (m_lightMap[j] == i)
+            if (m_lightMap[j] == i && m_lightEnabled[j])
             {
                 deviceLight = j;
                 break;
@@ -147,6 +156,12 @@ void CLightManager::DebugDumpLights()
 void CLightManager::FlushLights()
 {
     m_dynLights.clear();
+
+    // The ranks will be given to other lights
+    for (int i = 0; i < static_cast<int>( m_lightMap.size() ); ++i)
+        m_lightMap[i] = LIGHT_SLOT_UNKNOWN;
+
+    m_lightsChanged = true;
 }
 
 /** Returns the index of light created. */
@@ -182,6 +197,8 @@ int CLightManager::CreateLight(LightPriority priority)
     m_dynLights[index].colorGreen.Init(0.5f);
     m_dynLights[index].colorBlue.Init(0.5f);  // gray
 
+    ChangeDeviceLight(index);
+    m_lightsChanged = true;
     return index;
 }
 
@@ -191,6 +208,7 @@ bool CLightManager::DeleteLight(int lightRank)
         return false;
 
     m_dynLights[lightRank].used = false;
+    m_lightsChanged = true;
     return true;
 }
 
@@ -205,6 +223,8 @@ bool CLightManager::SetLight(int lightRank, const Light &light)
     m_dynLights[lightRank].colorGreen.Init(m_dynLights[lightRank].light.diffuse.g);
     m_dynLights[lightRank].colorBlue.Init(m_dynLights[lightRank].light.diffuse.b);
 
+    ChangeDeviceLight(lightRank);
+    m_lightsChanged = true;
     return true;
 }
 
@@ -222,7 +242,11 @@ bool CLightManager::SetLightEnabled(int lightRank, bool enabled)
     if ( (lightRank < 0) || (lightRank >= static_cast<int>( m_dynLights.size() )) )
         return false;
 
+    if (m_dynLights[lightRank].enabled == enabled)
+        return true;
+
     m_dynLights[lightRank].enabled = enabled;
+    m_lightsChanged = true;
     return true;
 }
 
@@ -231,7 +255,11 @@ bool CLightManager::SetLightPriority(int lightRank, LightPriority priority)
     if ( (lightRank < 0) || (lightRank >= static_cast<int>( m_dynLights.size() )) )
         return false;
 
+    if (m_dynLights[lightRank].priority == priority)
+        return true;
+
     m_dynLights[lightRank].priority = priority;
+    m_lightsChanged = true;
     return true;
 }
 
@@ -240,7 +268,11 @@ bool CLightManager::SetLightIncludeType(int lightRank, EngineObjectType type)
     if ( (lightRank < 0) || (lightRank >= static_cast<int>( m_dynLights.size() )) )
         return false;
 
+    if (m_dynLights[lightRank].includeType == type)
+        return true;
+
     m_dynLights[lightRank].includeType = type;
+    m_lightsChanged = true;
     return true;
 }
 
@@ -249,7 +281,11 @@ bool CLightManager::SetLightExcludeType(int lightRank, EngineObjectType type)
     if ( (lightRank < 0) || (lightRank >= static_cast<int>( m_dynLights.size() )) )
         return false;
 
+    if (m_dynLights[lightRank].excludeType == type)
+        return true;
+
     m_dynLights[lightRank].excludeType = type;
+    m_lightsChanged = true;
     return true;
 }
 
@@ -258,7 +294,12 @@ bool CLightManager::SetLightPos(int lightRank, const Math::Vector &pos)
     if ( (lightRank < 0) || (lightRank >= static_cast<int>( m_dynLights.size() )) )
         return false;
 
+    if (Math::VectorsEqual(m_dynLights[lightRank].light.position, pos))
+        return true;
+
     m_dynLights[lightRank].light.position = pos;
+    ChangeDeviceLight(lightRank);
+    m_lightsChanged = true;
     return true;
 }
 
@@ -276,6 +317,7 @@ bool CLightManager::SetLightDir(int lightRank, const Math::Vector &dir)
         return false;
 
     m_dynLights[lightRank].light.direction = dir;
+    ChangeDeviceLight(lightRank);
     return true;
 }
 
@@ -394,6 +436,7 @@ void CLightManager::UpdateProgression(float rTime)
             m_dynLights[i].light.direction.x = sinf(1.0f * (m_time + i*Math::PI*0.5f));
             m_dynLights[i].light.direction.z = cosf(1.1f * (m_time + i*Math::PI*0.5f));
             m_dynLights[i].light.direction.y = -1.0f + 0.5f * cosf((m_time + i*Math::PI*0.5f)*2.7f);
+            ChangeDeviceLight(i);
         }
 
         if (m_dynLights[i].includeType == ENG_OBJTYPE_METAL)
@@ -403,10 +446,15 @@ void CLightManager::UpdateProgression(float rTime)
             angle += Math::PI * 0.5f * i;
             m_dynLights[i].light.direction.x = sinf(2.0f * angle);
             m_dynLights[i].light.direction.z = cosf(2.0f * angle);
+            ChangeDeviceLight(i);
         }
     }
 }
 
+/**
+ * Only the lights turned on or off by their intensity change the selection;
+ * a new color is set again in the device slots holding the light.
+ */
 void CLightManager::UpdateLights()
 {
     for (int i = 0; i < static_cast<int>( m_dynLights.size() ); i++)
@@ -414,10 +462,12 @@ void CLightManager::UpdateLights()
         if (! m_dynLights[i].used)
             continue;
 
-        bool enabled = m_dynLights[i].enabled;
+        bool enabled = IsLightSelectable(m_dynLights[i]);
+
+        if (i >= static_cast<int>( m_selectable.size() ) || m_selectable[i] != enabled)
+            m_lightsChanged = true;
 
-        if (Math::IsZero(m_dynLights[i].intensity.current))
-            enabled = false;
+        Color diffuse = m_dynLights[i].light.diffuse;
 
         if (enabled)
         {
@@ -436,93 +486,312 @@ void CLightManager::UpdateLights()
             m_dynLights[i].light.diffuse.g = 0.0f;
             m_dynLights[i].light.diffuse.b = 0.0f;
         }
+
+        if (m_dynLights[i].light.diffuse != diffuse)
+            ChangeDeviceLight(i);
     }
 }
 
 void CLightManager::UpdateDeviceLights(EngineObjectType type)
 {
-    for (int i = 0; i < static_cast<int>( m_lightMap.size() ); ++i)
-        m_lightMap[i] = -1;
+    UpdateDeviceLights(type, m_engine->GetEyePt());
+}
 
-    std::vector<DynamicLight> sortedLights = m_dynLights;
-    LightsComparator lightsComparator(m_engine->GetEyePt(), type);
-    std::sort(sortedLights.begin(), sortedLights.end(), lightsComparator);
+/**
+ * The lights of an object with rank are kept while neither the object nor
+ * the lights move, the following calls only check the device lights.
+ */
+void CLightManager::UpdateDeviceLights(EngineObjectType type, const Math::Vector& pos, int objRank)
+{
+    if (objRank < 0)
+    {
+        if (m_lightsChanged)
+            UpdateGrid();
 
-    int lightMapIndex = 0;
-    for (int i = 0; i < static_cast<int>( sortedLights.size() ); i++)
+        m_selection.resize(m_lightMap.size());
+        SelectLights(type, pos, m_selection.data());
+        SetDeviceLights(m_selection.data());
+        return;
+    }
+
+    SetDeviceLights(GetObjectLights(type, pos, objRank));
+}
+
+/**
+ * Objects near each other share most of their lights: the key orders them by
+ * their block of 4x4 cells along a Z-order curve, then by a hash of the ranks
+ * of their lights. Objects with the same key are drawn one after the other
+ * without changing the device lights.
+ */
+unsigned int CLightManager::GetLightSet(EngineObjectType type, const Math::Vector& pos, int objRank)
+{
+    GetObjectLights(type, pos, objRank);
+    return m_objectSelections[objRank].lightSet;
+}
+
+const int* CLightManager::GetObjectLights(EngineObjectType type, const Math::Vector& pos, int objRank)
+{
+    if (m_lightsChanged)
+        UpdateGrid();
+
+    int count = m_lightMap.size();
+
+    if (objRank >= static_cast<int>( m_objectSelections.size() ))
     {
-        if (! sortedLights[i].used)
-            continue;
-        if (! sortedLights[i].enabled)
+        m_objectSelections.resize(objRank+1);
+        m_objectLights.resize((objRank+1)*count, -1);
+    }
+
+    ObjectLightSelection& objSelection = m_objectSelections[objRank];
+    int* selection = &m_objectLights[objRank*count];
+
+    if (objSelection.gridVersion == m_gridVersion && objSelection.type == type &&
+        Math::VectorsEqual(objSelection.pos, pos))
+        return selection;
+
+    SelectLights(type, pos, selection);
+    objSelection.gridVersion = m_gridVersion;
+    objSelection.type = type;
+    objSelection.pos = pos;
+
+    unsigned int bx = static_cast<unsigned int>(GetCell(pos.x)) >> 2;
+    unsigned int bz = static_cast<unsigned int>(GetCell(pos.z)) >> 2;
+    unsigned int block = 0;
+    for (int bit = 0; bit < 8; bit++)
+        block |= ((bx >> bit) & 1) << (2*bit) | ((bz >> bit) & 1) << (2*bit+1);
+
+    // FNV-1a of the sorted ranks
+    m_selection.assign(selection, selection + count);
+    std::sort(m_selection.begin(), m_selection.end());
+    unsigned int hash = 2166136261u;
+    for (int rank : m_selection)
+    {
+        hash ^= static_cast<unsigned int>(rank);
+        hash *= 16777619u;
+    }
+    objSelection.lightSet = (block << 16) | (hash & 0xffff);
+
+    return selection;
+}
+
+void CLightManager::UpdateGrid()
+{
+    m_lightsChanged = false;
+    m_gridVersion++;
+
+    for (int i = 0; i < LIGHT_GRID_SIZE*LIGHT_GRID_SIZE; i++)
+        m_gridBuckets[i].clear();
+
+    m_gridLights.clear();
+    m_highestLights.clear();
+    m_gridPriority = LIGHT_PRI_LOW;
+    m_selectable.assign(m_dynLights.size(), false);
+
+    for (int i = 0; i < static_cast<int>( m_dynLights.size() ); i++)
+    {
+        const DynamicLight& dynLight = m_dynLights[i];
+        if (! dynLight.used)
             continue;
-        if (sortedLights[i].intensity.current == 0.0f)
+        if (! IsLightSelectable(dynLight))
             continue;
 
-        bool enabled = true;
-        if (sortedLights[i].includeType != ENG_OBJTYPE_NULL)
-            enabled = (sortedLights[i].includeType == type);
+        m_selectable[i] = true;
 
-        if (sortedLights[i].excludeType != ENG_OBJTYPE_NULL)
-            enabled = (sortedLights[i].excludeType != type);
-
-        if (enabled)
+        if (dynLight.priority == LIGHT_PRI_HIGHEST)
         {
-            m_lightMap[lightMapIndex] = sortedLights[i].rank;
-            ++lightMapIndex;
+            m_highestLights.push_back(i);
+            continue;
         }
 
-        if (lightMapIndex >= static_cast<int>( m_lightMap.size() ))
-            break;
+        m_gridPriority = std::min(m_gridPriority, static_cast<int>(dynLight.priority));
+
+        LightGridEntry entry;
+        entry.rank = i;
+        entry.x = GetCell(dynLight.light.position.x);
+        entry.z = GetCell(dynLight.light.position.z);
+        m_gridLights.push_back(entry);
+
+        int bucket = (entry.x & (LIGHT_GRID_SIZE-1)) + (entry.z & (LIGHT_GRID_SIZE-1)) * LIGHT_GRID_SIZE;
+        m_gridBuckets[bucket].push_back(entry);
     }
+}
+
+int CLightManager::GetCell(float coord)
+{
+    return static_cast<int>( floorf(coord / LIGHT_GRID_CELL) );
+}
 
+bool CLightManager::IsLightSelectable(const DynamicLight& dynLight)
+{
+    return dynLight.enabled && !Math::IsZero(dynLight.intensity.current);
+}
+
+void CLightManager::ChangeDeviceLight(int rank)
+{
     for (int i = 0; i < static_cast<int>( m_lightMap.size() ); ++i)
     {
-        int rank = m_lightMap[i];
-        if (rank != -1)
-        {
-            Light light = m_dynLights[rank].light;
-            light.ambient = Gfx::Color(0.2f, 0.2f, 0.2f);
-            m_device->SetLight(i, light);
-            m_device->SetLightEnabled(i, true);
-        }
-        else
-        {
-            m_device->SetLightEnabled(i, false);
-        }
+        if (m_lightMap[i] == rank)
+            m_lightMap[i] = LIGHT_SLOT_UNKNOWN;
     }
 }
 
-// -----------
+bool CLightManager::IsLightIncluded(const DynamicLight& dynLight, EngineObjectType type)
+{
+    bool enabled = true;
+    if (dynLight.includeType != ENG_OBJTYPE_NULL)
+        enabled = (dynLight.includeType == type);
+
+    if (dynLight.excludeType != ENG_OBJTYPE_NULL)
+        enabled = (dynLight.excludeType != type);
+
+    return enabled;
+}
 
-CLightManager::LightsComparator::LightsComparator(Math::Vector eyePos, EngineObjectType objectType)
+void CLightManager::AddCandidate(int rank, EngineObjectType type, const Math::Vector& pos)
 {
-    m_eyePos = eyePos;
-    m_objectType = objectType;
+    const DynamicLight& dynLight = m_dynLights[rank];
+    if (! IsLightIncluded(dynLight, type))
+        return;
+
+    // Squared weight, the order is the same
+    Math::Vector dist = dynLight.light.position - pos;
+    LightCandidate candidate;
+    candidate.weight = (dist.x*dist.x + dist.y*dist.y + dist.z*dist.z) * (dynLight.priority*dynLight.priority);
+    candidate.rank = rank;
+    m_candidates.push_back(candidate);
 }
 
-float CLightManager::LightsComparator::GetLightWeight(const DynamicLight& dynLight)
+void CLightManager::SelectLights(EngineObjectType type, const Math::Vector& pos, int* selection)
 {
-    if (dynLight.priority == LIGHT_PRI_HIGHEST)
-        return -1.0f;
+    int count = m_lightMap.size();
 
-    bool enabled = true;
-    if (!dynLight.used || !dynLight.enabled || dynLight.intensity.current == 0.0f)
-        enabled = false;
-    else if (dynLight.includeType != ENG_OBJTYPE_NULL)
-        enabled = dynLight.includeType == m_objectType;
-    else if (dynLight.excludeType != ENG_OBJTYPE_NULL)
-        enabled = dynLight.excludeType != m_objectType;
+    m_candidates.clear();
+
+    for (int rank : m_highestLights)
+    {
+        if (IsLightIncluded(m_dynLights[rank], type))
+        {
+            LightCandidate candidate;
+            candidate.weight = -1.0f;
+            candidate.rank = rank;
+            m_candidates.push_back(candidate);
+        }
+    }
+
+    // Rings of cells around the object, until no light outside them can be lighter
+    // than the ones found: its weight is at least its distance in the XZ plane
+    // multiplied by the lowest priority
+    int cx = GetCell(pos.x);
+    int cz = GetCell(pos.z);
+    int remaining = (count > 0) ? m_gridLights.size() : 0;
+
+    for (int r = 0; remaining > 0; r++)
+    {
+        int cells = (2*r+1)*(2*r+1);
+        if (cells > remaining)
+        {
+            // Fewer lights left than cells up to this ring: check them instead
+            for (const LightGridEntry& entry : m_gridLights)
+            {
+                if (std::max(abs(entry.x-cx), abs(entry.z-cz)) >= r)
+                    AddCandidate(entry.rank, type, pos);
+            }
+            break;
+        }
+
+        for (int x = cx-r; x <= cx+r; x++)
+        {
+            int step = (x == cx-r || x == cx+r) ? 1 : 2*r;
+            for (int z = cz-r; z <= cz+r; z += step)
+            {
+                int bucket = (x & (LIGHT_GRID_SIZE-1)) + (z & (LIGHT_GRID_SIZE-1)) * LIGHT_GRID_SIZE;
+                for (const LightGridEntry& entry : m_gridBuckets[bucket])
+                {
+                    if (entry.x != x || entry.z != z)
+                        continue;  // other cell in the same bucket
+
+                    AddCandidate(entry.rank, type, pos);
+                    remaining--;
+                }
+            }
+        }
+
+        if (static_cast<int>( m_candidates.size() ) >= count && count > 0)
+        {
+            float dist = std::min(std::min(pos.x - (cx-r)*LIGHT_GRID_CELL, (cx+r+1)*LIGHT_GRID_CELL - pos.x),
+                                  std::min(pos.z - (cz-r)*LIGHT_GRID_CELL, (cz+r+1)*LIGHT_GRID_CELL - pos.z));
+
+            dist *= m_gridPriority;
 
-    return enabled ? ( (dynLight.light.position - m_eyePos).Length() * dynLight.priority ) : 10000.0f;
+            std::nth_element(m_candidates.begin(), m_candidates.begin() + count-1, m_candidates.end());
+            if (m_candidates[count-1].weight <= dist*dist)
+                break;
+        }
+    }
+
+    int selected = std::min(count, static_cast<int>( m_candidates.size() ));
+    std::partial_sort(m_candidates.begin(), m_candidates.begin() + selected, m_candidates.end());
+
+    for (int i = 0; i < count; i++)
+        selection[i] = (i < selected) ? m_candidates[i].rank : -1;
 }
 
-bool CLightManager::LightsComparator::operator()(const DynamicLight& left, const DynamicLight& right)
+void CLightManager::SetDeviceLights(const int* selection)
 {
-    float leftWeight = GetLightWeight(left);
-    float rightWeight = GetLightWeight(right);
+    int count = m_lightMap.size();
+
+    // Lights already in a device slot stay there, the others take the free slots in order
+    m_newLightMap.assign(count, -1);
+    m_addedLights.clear();
+    for (int i = 0; i < count && selection[i] != -1; i++)
+    {
+        int slot = std::find(m_lightMap.begin(), m_lightMap.end(), selection[i]) - m_lightMap.begin();
+        if (slot < count)
+            m_newLightMap[slot] = selection[i];
+        else
+            m_addedLights.push_back(selection[i]);
+    }
+
+    int slot = 0;
+    for (int rank : m_addedLights)
+    {
+        while (m_newLightMap[slot] != -1)
+            slot++;
+        m_newLightMap[slot] = rank;
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        int rank = m_newLightMap[i];
+        bool unknown = (m_lightMap[i] == LIGHT_SLOT_UNKNOWN);
+
+        if (rank == -1)
+        {
+            // The light stays in the disabled slot, to be enabled again without setting it
+            if (m_lightEnabled[i] || unknown)
+                m_device->SetLightEnabled(i, false);
 
-    return leftWeight < rightWeight;
+            if (unknown)
+                m_lightMap[i] = -1;
+
+            m_lightEnabled[i] = false;
+            continue;
+        }
+
+        if (rank != m_lightMap[i])
+        {
+            Light light = m_dynLights[rank].light;
+            light.ambient = Gfx::Color(0.2f, 0.2f, 0.2f);
+            m_device->SetLight(i, light);
+            m_lightMap[i] = rank;
+        }
+
+        if (! m_lightEnabled[i] || unknown)
+        {
+            m_device->SetLightEnabled(i, true);
+            m_lightEnabled[i] = true;
+        }
+    }
 }
 
 } // namespace Gfx
-
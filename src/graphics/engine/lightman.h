@@ -29,10 +29,21 @@
 
 #include "math/vector.h"
 
+#include <vector>
+
 
 // Graphics module namespace
 namespace Gfx {
 
+//! Size of one cell of the grid of dynamic lights (in world units)
+const float LIGHT_GRID_CELL = 80.0f;
+
+//! Number of hash buckets of the grid of dynamic lights along one axis (must be a power of 2)
+const int LIGHT_GRID_SIZE = 64;
+
+//! Device light slot whose state is not known, after its dynamic light changed
+const int LIGHT_SLOT_UNKNOWN = -2;
+
 /**
  * \struct LightProgression
  * \brief Describes the progression of light parameters change
@@ -126,6 +137,60 @@ struct DynamicLight
     {}
 };
 
+/**
+ * \struct LightGridEntry
+ * \brief Dynamic light in a cell of the grid of CLightManager
+ */
+struct LightGridEntry
+{
+    //! Rank of the dynamic light
+    int     rank;
+    //! Cell of the light
+    int     x, z;
+};
+
+/**
+ * \struct LightCandidate
+ * \brief Dynamic light which may be selected for an object
+ */
+struct LightCandidate
+{
+    //! Squared weight of the light for the object; the lightest are selected
+    float   weight;
+    //! Rank of the dynamic light
+    int     rank;
+
+    //! Orders by weight, then by rank
+    inline bool operator<(const LightCandidate& other) const
+    {
+        if (weight != other.weight)
+            return weight < other.weight;
+        return rank < other.rank;
+    }
+};
+
+/**
+ * \struct ObjectLightSelection
+ * \brief Selection of the dynamic lights of an engine object, kept by CLightManager
+ */
+struct ObjectLightSelection
+{
+    //! Version of the grid the lights were selected with (0 if never selected)
+    unsigned int        gridVersion;
+    //! Type of the object when selected
+    EngineObjectType    type;
+    //! Position of the object when selected
+    Math::Vector        pos;
+    //! Key of the set of lights, see CLightManager::GetLightSet()
+    unsigned int        lightSet;
+
+    ObjectLightSelection()
+     : gridVersion(0)
+     , type(ENG_OBJTYPE_NULL)
+     , lightSet(0)
+    {}
+};
+
 /**
  * \class CLightManager
  * \brief Manager for dynamic lights in 3D scene
@@ -138,6 +203,14 @@ struct DynamicLight
  * updating the models with new values, while only one function, UpdateDeviceLights(), performs the actual
  * synchronization to the device. It allocates device's light slots as necessary, with two priority levels
  * for lights.
+ *
+ * Each object is lit by the lights nearest to it. The lights which may be selected are put in a uniform grid
+ * on the XZ plane, hashed into LIGHT_GRID_SIZE^2 buckets; the cells around an object are then searched until
+ * no light outside them can be nearer than the ones found. The grid is only filled again when a light is
+ * added, moved, turned on or off or otherwise changes what it may light. The selection of each engine object
+ * is kept until the grid changes or the object moves, and CEngine sorts the drawn objects by their set of
+ * lights (GetLightSet()). Device light slots are only changed for the lights which are not already set in
+ * the device, or whose color, direction or position changed.
  */
 class CLightManager
 {
@@ -202,25 +275,34 @@ public:
 
     //! Updates progression of dynamic lights
     void            UpdateProgression(float rTime);
-    //! Updates (recalculates) all dynamic lights
+    //! Updates (recalculates) all dynamic lights, marking the ones that changed
     void            UpdateLights();
-    //! Enables or disables dynamic lights affecting the given object type
+    //! Enables or disables dynamic lights affecting the given object type, nearest to the eye
     void            UpdateDeviceLights(EngineObjectType type);
+    //! Enables the dynamic lights nearest to an object of given type and position
+    void            UpdateDeviceLights(EngineObjectType type, const Math::Vector& pos, int objRank = -1);
+    //! Returns the key sorting the objects by their lights, equal for near objects lit by the same lights
+    unsigned int    GetLightSet(EngineObjectType type, const Math::Vector& pos, int objRank);
 
 protected:
-    class LightsComparator
-    {
-        public:
-            LightsComparator(Math::Vector eyePos, EngineObjectType objectType);
-
-            bool operator()(const DynamicLight& left, const DynamicLight& right);
-
-        private:
-            float GetLightWeight(const DynamicLight& dynLight);
-
-            Math::Vector m_eyePos;
-            EngineObjectType m_objectType;
-    };
+    //! Puts the lights which may be selected in the grid
+    void            UpdateGrid();
+    //! Returns the cell containing given coordinate
+    int             GetCell(float coord);
+    //! Returns whether the light may be selected at all
+    bool            IsLightSelectable(const DynamicLight& dynLight);
+    //! Marks the device slots holding the light as unknown, so that it is set again
+    void            ChangeDeviceLight(int rank);
+    //! Returns the lights selected for the object, selecting them again if it or the lights moved
+    const int*      GetObjectLights(EngineObjectType type, const Math::Vector& pos, int objRank);
+    //! Returns whether the light lights objects of given type
+    bool            IsLightIncluded(const DynamicLight& dynLight, EngineObjectType type);
+    //! Adds the light to m_candidates if it lights objects of given type
+    void            AddCandidate(int rank, EngineObjectType type, const Math::Vector& pos);
+    //! Selects the lights of an object, sorted by weight, into \a selection (-1 for unused slots)
+    void            SelectLights(EngineObjectType type, const Math::Vector& pos, int* selection);
+    //! Sets the device lights to the given selection, changing only the slots which differ
+    void            SetDeviceLights(const int* selection);
 
 protected:
     CEngine*          m_engine;
@@ -230,8 +312,35 @@ protected:
     float             m_time;
     //! List of dynamic lights
     std::vector<DynamicLight> m_dynLights;
-    //! Map of current light allocation: graphics light -> dynamic light
+    //! Map of current light allocation: graphics light -> dynamic light (-1 if none)
     std::vector<int>  m_lightMap;
+    //! Whether each graphics light is enabled; a disabled one keeps its dynamic light in m_lightMap
+    std::vector<bool> m_lightEnabled;
+
+    //! Whether the lights changed since the grid was filled
+    bool              m_lightsChanged;
+    //! Version of the grid, increased each time it is filled
+    unsigned int      m_gridVersion;
+    //! Whether each dynamic light could be selected when the grid was filled
+    std::vector<bool> m_selectable;
+    //! Lights which may be selected, except those of highest priority
+    std::vector<LightGridEntry> m_gridLights;
+    //! Lights of m_gridLights, by cell
+    std::vector<LightGridEntry> m_gridBuckets[LIGHT_GRID_SIZE*LIGHT_GRID_SIZE];
+    //! Smallest weight factor (priority value) of m_gridLights
+    int               m_gridPriority;
+    //! Ranks of the lights of highest priority which may be selected
+    std::vector<int>  m_highestLights;
+    //! Lights found by current selection
+    std::vector<LightCandidate> m_candidates;
+    //! Lights selected for each engine object, m_lightMap.size() ranks per object
+    std::vector<int>  m_objectLights;
+    //! Selection of each engine object
+    std::vector<ObjectLightSelection> m_objectSelections;
+    //! Lights selected for an object drawn without rank, or sorted for the key of a set
+    std::vector<int>  m_selection;
+    //! New light allocation, and the lights it adds to the device
+    std::vector<int>  m_newLightMap, m_addedLights;
 };
 
 }; // namespace Gfx
@@ -0,0 +1,368 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// * Copyright (C) 2012-2014, Polish Portal of Colobot (PPC)
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+
+#include "graphics/engine/modelcache.h"
+
+#include "common/config.h"
+#include "common/logger.h"
+
+#include <cstring>
+#include <fstream>
+
+#if defined(PLATFORM_WINDOWS)
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+
+// Graphics module namespace
+namespace Gfx {
+
+
+/**
+ * \struct ModelCacheHeader
+ * \brief Header of a precompiled model
+ *
+ * The sizes and the byte order tell whether the file has the memory layout
+ * of this build.
+ */
+struct ModelCacheHeader
+{
+    //! "CMOD"
+    char    magic[4];
+    //! Version of the format
+    int     version;
+    //! 0x01020304 written in the byte order of the file
+    int     byteOrder;
+    //! Size of VertexTex2
+    int     vertexSize;
+    //! Size of ModelCacheGroup
+    int     groupSize;
+    //! Number of groups
+    int     groupCount;
+    //! Number of vertices of all the groups
+    int     vertexCount;
+    //! Model file the triangles were read from
+    ModelCacheSource source;
+};
+
+const char MODEL_CACHE_MAGIC[4] = { 'C', 'M', 'O', 'D' };
+const int  MODEL_CACHE_VERSION = 2;
+const int  MODEL_CACHE_BYTE_ORDER = 0x01020304;
+
+
+CModelCache::CModelCache()
+{
+    m_data = nullptr;
+    m_size = 0;
+    m_file = nullptr;
+    m_mapping = nullptr;
+    m_groups = nullptr;
+    m_groupCount = 0;
+    m_vertices = nullptr;
+    m_outOfDate = false;
+}
+
+CModelCache::~CModelCache()
+{
+    Close();
+}
+
+std::string CModelCache::GetFileName(const std::string& modelFileName)
+{
+    std::string name = modelFileName;
+    if (name.size() > 4 && name.compare(name.size() - 4, 4, ".mod") == 0)
+        name.erase(name.size() - 4);
+
+    return name + ".cmod";
+}
+
+bool CModelCache::GetSource(const std::string& modelFileName, ModelCacheSource& source)
+{
+    std::ifstream stream;
+    stream.open(modelFileName.c_str(), std::ios_base::in | std::ios_base::binary);
+    if (!stream.good())
+        return false;
+
+    source.size = 0;
+    source.hash = 14695981039346656037ULL;
+
+    char buffer[16384];
+    while (stream.good())
+    {
+        stream.read(buffer, sizeof(buffer));
+        std::streamsize count = stream.gcount();
+        for (std::streamsize i = 0; i < count; i++)
+        {
+            source.hash ^= static_cast<unsigned char>(buffer[i]);
+            source.hash *= 1099511628211ULL;
+        }
+        source.size += count;
+    }
+
+    return !stream.bad();
+}
+
+bool CModelCache::Write(const std::vector<ModelTriangle>& triangles, const ModelCacheSource& source,
+                        const std::string& fileName)
+{
+    // Groups in the order of their first triangle, as the engine adds them
+    std::vector<ModelCacheGroup> groups;
+    std::vector<std::vector<VertexTex2>> groupVertices;
+
+    for (const ModelTriangle& t : triangles)
+    {
+        if (t.tex1Name.size() >= sizeof(ModelCacheGroup().tex1Name) ||
+            t.tex2Name.size() >= sizeof(ModelCacheGroup().tex2Name))
+        {
+            GetLogger()->Error("Texture name too long for model cache: '%s' '%s'\n",
+                               t.tex1Name.c_str(), t.tex2Name.c_str());
+            return false;
+        }
+
+        int index = 0;
+        for ( ; index < static_cast<int>( groups.size() ); index++)
+        {
+            const ModelCacheGroup& group = groups[index];
+            if (t.tex1Name == group.tex1Name && t.tex2Name == group.tex2Name &&
+                t.variableTex2 == (group.variableTex2 != 0) && t.lodLevel == group.lodLevel &&
+                t.material == group.material && t.state == group.state)
+                break;
+        }
+
+        if (index == static_cast<int>( groups.size() ))
+        {
+            ModelCacheGroup group = ModelCacheGroup();
+            strcpy(group.tex1Name, t.tex1Name.c_str());
+            strcpy(group.tex2Name, t.tex2Name.c_str());
+            group.material = t.material;
+            group.lodLevel = t.lodLevel;
+            group.state = t.state;
+            group.variableTex2 = t.variableTex2 ? 1 : 0;
+
+            groups.push_back(group);
+            groupVertices.push_back(std::vector<VertexTex2>());
+        }
+
+        groupVertices[index].push_back(t.p1);
+        groupVertices[index].push_back(t.p2);
+        groupVertices[index].push_back(t.p3);
+    }
+
+    ModelCacheHeader header = ModelCacheHeader();
+    memcpy(header.magic, MODEL_CACHE_MAGIC, sizeof(header.magic));
+    header.version = MODEL_CACHE_VERSION;
+    header.byteOrder = MODEL_CACHE_BYTE_ORDER;
+    header.vertexSize = sizeof(VertexTex2);
+    header.groupSize = sizeof(ModelCacheGroup);
+    header.groupCount = groups.size();
+    header.vertexCount = 0;
+    header.source = source;
+
+    for (int i = 0; i < static_cast<int>( groups.size() ); i++)
+    {
+        groups[i].firstVertex = header.vertexCount;
+        groups[i].vertexCount = groupVertices[i].size();
+        header.vertexCount += groups[i].vertexCount;
+    }
+
+    std::ofstream stream;
+    stream.open(fileName.c_str(), std::ios_base::out | std::ios_base::binary);
+    if (!stream.good())
+    {
+        GetLogger()->Error("Could not open file '%s'\n", fileName.c_str());
+        return false;
+    }
+
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (! groups.empty())
+        stream.write(reinterpret_cast<const char*>(&groups[0]), groups.size() * sizeof(ModelCacheGroup));
+    for (const std::vector<VertexTex2>& vertices : groupVertices)
+        stream.write(reinterpret_cast<const char*>(&vertices[0]), vertices.size() * sizeof(VertexTex2));
+
+    if (stream.fail())
+    {
+        GetLogger()->Error("Error writing model cache file\n");
+        return false;
+    }
+
+    return true;
+}
+
+bool CModelCache::Open(const std::string& fileName, const ModelCacheSource& source)
+{
+    Close();
+    m_outOfDate = false;
+
+#if defined(PLATFORM_WINDOWS)
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    // The file exists, it is written again if refused
+    m_outOfDate = true;
+
+    LARGE_INTEGER size;
+    HANDLE mapping = nullptr;
+    const void* data = nullptr;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping != nullptr)
+        data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (data == nullptr)
+    {
+        if (mapping != nullptr)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    m_file = file;
+    m_mapping = mapping;
+    m_size = static_cast<long>(size.QuadPart);
+#else
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    // The file exists, it is written again if refused
+    m_outOfDate = true;
+
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // the mapping stays
+
+    if (data == MAP_FAILED)
+        return false;
+
+    m_size = st.st_size;
+#endif
+
+    m_data = static_cast<const char*>(data);
+
+    const ModelCacheHeader* header = reinterpret_cast<const ModelCacheHeader*>(m_data);
+    if (m_size < static_cast<long>( sizeof(ModelCacheHeader) ) ||
+        memcmp(header->magic, MODEL_CACHE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != MODEL_CACHE_VERSION)
+    {
+        GetLogger()->Error("Invalid model cache file '%s'\n", fileName.c_str());
+        Close();
+        return false;
+    }
+
+    if (header->byteOrder != MODEL_CACHE_BYTE_ORDER ||
+        header->vertexSize != sizeof(VertexTex2) ||
+        header->groupSize != sizeof(ModelCacheGroup))
+    {
+        GetLogger()->Warn("Model cache file '%s' was written by another build, ignored\n", fileName.c_str());
+        Close();
+        return false;
+    }
+
+    if (header->source.size != source.size || header->source.hash != source.hash)
+    {
+        GetLogger()->Debug("Model cache file '%s' was written from another model file, ignored\n", fileName.c_str());
+        Close();
+        return false;
+    }
+
+    long expected = sizeof(ModelCacheHeader) +
+                    static_cast<long>(header->groupCount) * sizeof(ModelCacheGroup) +
+                    static_cast<long>(header->vertexCount) * sizeof(VertexTex2);
+    if (header->groupCount < 0 || header->vertexCount < 0 || m_size < expected)
+    {
+        GetLogger()->Error("Truncated model cache file '%s'\n", fileName.c_str());
+        Close();
+        return false;
+    }
+
+    m_groups = reinterpret_cast<const ModelCacheGroup*>(m_data + sizeof(ModelCacheHeader));
+    m_groupCount = header->groupCount;
+    m_vertices = reinterpret_cast<const VertexTex2*>(m_data + sizeof(ModelCacheHeader) +
+                                                     m_groupCount * sizeof(ModelCacheGroup));
+
+    for (int i = 0; i < m_groupCount; i++)
+    {
+        const ModelCacheGroup& group = m_groups[i];
+        if (group.firstVertex < 0 || group.vertexCount < 0 ||
+            group.firstVertex > header->vertexCount - group.vertexCount ||
+            memchr(group.tex1Name, 0, sizeof(group.tex1Name)) == nullptr ||
+            memchr(group.tex2Name, 0, sizeof(group.tex2Name)) == nullptr)
+        {
+            GetLogger()->Error("Invalid model cache file '%s'\n", fileName.c_str());
+            Close();
+            return false;
+        }
+    }
+
+    m_outOfDate = false;
+    return true;
+}
+
+void CModelCache::Close()
+{
+    if (m_data == nullptr)
+        return;
+
+#if defined(PLATFORM_WINDOWS)
+    UnmapViewOfFile(m_data);
+    CloseHandle(static_cast<HANDLE>(m_mapping));
+    CloseHandle(static_cast<HANDLE>(m_file));
+#else
+    munmap(const_cast<char*>(m_data), m_size);
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+    m_file = nullptr;
+    m_mapping = nullptr;
+    m_groups = nullptr;
+    m_groupCount = 0;
+    m_vertices = nullptr;
+}
+
+bool CModelCache::IsOutOfDate() const
+{
+    return m_outOfDate;
+}
+
+int CModelCache::GetGroupCount() const
+{
+    return m_groupCount;
+}
+
+const ModelCacheGroup& CModelCache::GetGroup(int index) const
+{
+    return m_groups[index];
+}
+
+const VertexTex2* CModelCache::GetVertices(const ModelCacheGroup& group) const
+{
+    return m_vertices + group.firstVertex;
+}
+
+
+} // namespace Gfx
@@ -0,0 +1,137 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// * Copyright (C) 2012-2014, Polish Portal of Colobot (PPC)
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file graphics/engine/modelcache.h
+ * \brief Precompiled models - CModelCache class
+ */
+
+#pragma once
+
+
+#include "graphics/core/material.h"
+#include "graphics/core/vertex.h"
+
+#include "graphics/engine/modelfile.h"
+
+#include <string>
+#include <vector>
+
+
+// Graphics module namespace
+namespace Gfx {
+
+
+/**
+ * \struct ModelCacheGroup
+ * \brief Triangles of a precompiled model sharing their textures, LOD level, material and state
+ *
+ * Stored as is in the file, followed by the vertices of all the groups.
+ */
+struct ModelCacheGroup
+{
+    //! Name of 1st texture, null-terminated
+    char        tex1Name[64];
+    //! Name of 2nd texture, null-terminated
+    char        tex2Name[64];
+    //! Material
+    Material    material;
+    //! LOD level
+    int         lodLevel;
+    //! Rendering state to be set
+    int         state;
+    //! If not 0, 2nd texture will be taken from current engine setting
+    int         variableTex2;
+    //! Index of the first vertex of the group
+    int         firstVertex;
+    //! Number of vertices, 3 per triangle
+    int         vertexCount;
+};
+
+/**
+ * \struct ModelCacheSource
+ * \brief Model file from which a precompiled model was written
+ */
+struct ModelCacheSource
+{
+    //! Size of the file
+    long long           size;
+    //! FNV-1a hash of its contents
+    unsigned long long  hash;
+};
+
+/**
+ * \class CModelCache
+ * \brief Reader/writer of precompiled models
+ *
+ * A precompiled model (.cmod file next to the .mod file) keeps the
+ * triangles of a model grouped as the engine stores them, in the memory
+ * layout of this build. It is mapped in memory when read, so that each group
+ * is added to a base object with one call, without parsing the vertices.
+ *
+ * The file is refused if it was written by a build with another layout or
+ * from another version of the .mod file (see ModelCacheSource); the .mod file
+ * is then read instead, and the precompiled model can be written again.
+ */
+class CModelCache
+{
+public:
+    CModelCache();
+    ~CModelCache();
+
+    //! Returns the name of the precompiled model of a model file
+    static std::string GetFileName(const std::string& modelFileName);
+
+    //! Reads the size and hash of a model file
+    static bool         GetSource(const std::string& modelFileName, ModelCacheSource& source);
+
+    //! Writes the given triangles, read from \a source, as a precompiled model
+    static bool         Write(const std::vector<ModelTriangle>& triangles, const ModelCacheSource& source,
+                              const std::string& fileName);
+
+    //! Maps a precompiled model in memory, if it was written from \a source
+    bool                Open(const std::string& fileName, const ModelCacheSource& source);
+    //! Unmaps the model
+    void                Close();
+
+    //! Returns true if the last Open() refused an existing file, which should be written again
+    bool                IsOutOfDate() const;
+
+    //! Returns the number of groups of triangles
+    int                 GetGroupCount() const;
+    //! Returns the given group
+    const ModelCacheGroup& GetGroup(int index) const;
+    //! Returns the vertices of the given group
+    const VertexTex2*   GetVertices(const ModelCacheGroup& group) const;
+
+private:
+    //! Mapped file
+    const char*     m_data;
+    long            m_size;
+    //! Handles of the mapping
+    void*           m_file;
+    void*           m_mapping;
+
+    const ModelCacheGroup* m_groups;
+    int                    m_groupCount;
+    const VertexTex2*      m_vertices;
+
+    bool            m_outOfDate;
+};
+
+
+} // namespace Gfx
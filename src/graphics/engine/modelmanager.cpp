@@ -23,7 +23,9 @@
 #include "common/logger.h"
 
 #include "graphics/engine/engine.h"
+#include "graphics/engine/modelcache.h"
 
+#include <algorithm>
 #include <cstdio>
 
 template<> Gfx::CModelManager* CSingleton<Gfx::CModelManager>::m_instance = nullptr;
@@ -43,62 +45,141 @@ bool CModelManager::LoadModel(const std::string& fileName, bool mirrored)
 {
     GetLogger()->Debug("Loading model '%s'\n", fileName.c_str());
 
+    std::string filePath = CGameData::GetInstancePointer()->GetFilePath(DIR_MODEL, fileName);
+
+    int baseObjRank = -1;
+    bool writeCache = false;
+
+    // The model file is read in debug mode to print its triangles
+    if (! CApplication::GetInstance().IsDebugModeActive(DEBUG_MODELS))
+        baseObjRank = LoadCachedModel(fileName, filePath, mirrored, writeCache);
+
+    if (baseObjRank == -1)
+        baseObjRank = LoadModelFile(filePath, mirrored, writeCache);
+
+    if (baseObjRank == -1)
+        return false;
+
+    ModelInfo modelInfo;
+    modelInfo.baseObjRank = baseObjRank;
+
+    FileInfo fileInfo(fileName, mirrored);
+    m_models[fileInfo] = modelInfo;
+
+    return true;
+}
+
+int CModelManager::LoadModelFile(const std::string& filePath, bool mirrored, bool writeCache)
+{
     CModelFile modelFile;
 
     if (CApplication::GetInstance().IsDebugModeActive(DEBUG_MODELS))
         modelFile.SetPrintDebugInfo(true);
 
-    std::string filePath = CGameData::GetInstancePointer()->GetFilePath(DIR_MODEL, fileName);
-
     if (!modelFile.ReadModel(filePath))
     {
         GetLogger()->Error("Loading model '%s' failed\n", filePath.c_str());
-        return false;
+        return -1;
     }
 
-    ModelInfo modelInfo;
-    modelInfo.baseObjRank = m_engine->CreateBaseObject();
-    modelInfo.triangles = modelFile.GetTriangles();
+    ModelCacheSource source;
+    if (writeCache && CModelCache::GetSource(filePath, source))
+    {
+        GetLogger()->Debug("Writing model cache of '%s'\n", filePath.c_str());
+        CModelCache::Write(modelFile.GetTriangles(), source, CModelCache::GetFileName(filePath));
+    }
 
-    if (mirrored)
-        Mirror(modelInfo.triangles);
+    int baseObjRank = m_engine->CreateBaseObject();
+    std::vector<ModelTriangle> triangles = modelFile.GetTriangles();
 
-    FileInfo fileInfo(fileName, mirrored);
-    m_models[fileInfo] = modelInfo;
+    if (mirrored)
+        Mirror(triangles);
 
     std::vector<VertexTex2> vs(3, VertexTex2());
 
-    for (int i = 0; i < static_cast<int>( modelInfo.triangles.size() ); i++)
+    for (int i = 0; i < static_cast<int>( triangles.size() ); i++)
     {
-        int state = modelInfo.triangles[i].state;
-        std::string tex2Name = modelInfo.triangles[i].tex2Name;
+        int state = triangles[i].state;
+        std::string tex2Name = triangles[i].tex2Name;
 
-        if (modelInfo.triangles[i].variableTex2)
-        {
-            int texNum = m_engine->GetSecondTexture();
+        if (triangles[i].variableTex2)
+            GetVariableTex2(tex2Name, state);
 
-            if (texNum >= 1 && texNum <= 10)
-                state |= ENG_RSTATE_DUAL_BLACK;
+        vs[0] = triangles[i].p1;
+        vs[1] = triangles[i].p2;
+        vs[2] = triangles[i].p3;
 
-            if (texNum >= 11 && texNum <= 20)
-                state |= ENG_RSTATE_DUAL_WHITE;
+        m_engine->AddBaseObjTriangles(baseObjRank, vs, ENG_TRIANGLE_TYPE_TRIANGLES,
+                                      triangles[i].material, state,
+                                      triangles[i].tex1Name, tex2Name,
+                                      triangles[i].lodLevel, false);
+    }
 
-            char name[20] = { 0 };
-            sprintf(name, "dirty%.2d.png", texNum);
-            tex2Name = name;
+    return baseObjRank;
+}
+
+int CModelManager::LoadCachedModel(const std::string& fileName, const std::string& filePath, bool mirrored,
+                                   bool& outOfDate)
+{
+    // A precompiled model is valid next to its model file only (not for a model replaced by a mod)
+    std::string cachePath = CGameData::GetInstancePointer()->GetFilePath(DIR_MODEL, CModelCache::GetFileName(fileName));
+    if (cachePath != CModelCache::GetFileName(filePath))
+        return -1;
+
+    // and if it was written from the current model file
+    ModelCacheSource source;
+    if (!CModelCache::GetSource(filePath, source))
+        return -1;
+
+    CModelCache cache;
+    if (!cache.Open(cachePath, source))
+    {
+        outOfDate = cache.IsOutOfDate();
+        return -1;
+    }
+
+    int baseObjRank = m_engine->CreateBaseObject();
+    std::vector<VertexTex2> mirroredVertices;
+
+    for (int i = 0; i < cache.GetGroupCount(); i++)
+    {
+        const ModelCacheGroup& group = cache.GetGroup(i);
+        const VertexTex2* vertices = cache.GetVertices(group);
+
+        if (mirrored)
+        {
+            mirroredVertices.assign(vertices, vertices + group.vertexCount);
+            Mirror(mirroredVertices);
+            vertices = mirroredVertices.data();
         }
 
-        vs[0] = modelInfo.triangles[i].p1;
-        vs[1] = modelInfo.triangles[i].p2;
-        vs[2] = modelInfo.triangles[i].p3;
+        int state = group.state;
+        std::string tex2Name = group.tex2Name;
+
+        if (group.variableTex2)
+            GetVariableTex2(tex2Name, state);
 
-        m_engine->AddBaseObjTriangles(modelInfo.baseObjRank, vs, ENG_TRIANGLE_TYPE_TRIANGLES,
-                                      modelInfo.triangles[i].material, state,
-                                      modelInfo.triangles[i].tex1Name, tex2Name,
-                                      modelInfo.triangles[i].lodLevel, false);
+        m_engine->AddBaseObjTriangles(baseObjRank, vertices, group.vertexCount, ENG_TRIANGLE_TYPE_TRIANGLES,
+                                      group.material, state, group.tex1Name, tex2Name,
+                                      static_cast<LODLevel>(group.lodLevel), false);
     }
 
-    return true;
+    return baseObjRank;
+}
+
+void CModelManager::GetVariableTex2(std::string& tex2Name, int& state)
+{
+    int texNum = m_engine->GetSecondTexture();
+
+    if (texNum >= 1 && texNum <= 10)
+        state |= ENG_RSTATE_DUAL_BLACK;
+
+    if (texNum >= 11 && texNum <= 20)
+        state |= ENG_RSTATE_DUAL_WHITE;
+
+    char name[20] = { 0 };
+    sprintf(name, "dirty%.2d.png", texNum);
+    tex2Name = name;
 }
 
 bool CModelManager::AddModelReference(const std::string& fileName, bool mirrored, int objRank)
@@ -198,6 +279,20 @@ void CModelManager::Mirror(std::vector<ModelTriangle>& triangles)
     }
 }
 
+void CModelManager::Mirror(std::vector<VertexTex2>& vertices)
+{
+    for (int i = 0; i + 2 < static_cast<int>( vertices.size() ); i += 3)
+    {
+        std::swap(vertices[i], vertices[i+1]);
+
+        for (int j = i; j < i + 3; j++)
+        {
+            vertices[j].coord.z = -vertices[j].coord.z;
+            vertices[j].normal.z = -vertices[j].normal.z;
+        }
+    }
+}
+
 float CModelManager::GetHeight(std::vector<ModelTriangle>& triangles, Math::Vector pos)
 {
     const float limit = 5.0f;
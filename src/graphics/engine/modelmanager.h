@@ -84,11 +84,20 @@ protected:
 
     //! Mirrors the model along the Z axis
     void Mirror(std::vector<ModelTriangle>& triangles);
+    //! Mirrors the triangles given by their vertices along the Z axis
+    void Mirror(std::vector<VertexTex2>& vertices);
+
+    //! Reads a model file and creates its base object, writing its precompiled model if \a writeCache; returns -1 on error
+    int LoadModelFile(const std::string& filePath, bool mirrored, bool writeCache);
+    //! Maps the precompiled model next to the model file and creates its base object; returns -1 if there is none
+    //! or if it is \a outOfDate (written from another model file or by another build)
+    int LoadCachedModel(const std::string& fileName, const std::string& filePath, bool mirrored, bool& outOfDate);
+    //! Sets the 2nd texture and state of triangles taking it from current engine setting
+    void GetVariableTex2(std::string& tex2Name, int& state);
 
 private:
     struct ModelInfo
     {
-        std::vector<ModelTriangle> triangles;
         int baseObjRank;
     };
     struct FileInfo
@@ -22,6 +22,7 @@
 
 #include "common/iman.h"
 #include "common/logger.h"
+#include "common/profiler.h"
 
 #include "graphics/core/device.h"
 #include "graphics/engine/engine.h"
@@ -31,6 +32,7 @@
 #include "math/geometry.h"
 
 #include "object/object.h"
+#include "object/objman.h"
 #include "object/robotmain.h"
 
 #include <cstring>
@@ -132,6 +134,7 @@ CParticle::CParticle(CEngine* engine)
     m_exploGunCounter = 0;
     m_lastTimeGunDel = 0.0f;
     m_absTime = 0.0f;
+    m_batchState = 0;
 
     FlushParticle();
 }
@@ -806,6 +809,8 @@ void CParticle::SetFrameUpdate(int sheet, bool update)
 
 void CParticle::FrameParticle(float rTime)
 {
+    CProfileZone zone("CParticle::FrameParticle");
+
     if (m_main == nullptr)
         m_main = CRobotMain::GetInstancePointer();
 
@@ -2593,10 +2598,6 @@ void CParticle::TrackDraw(int i, ParticleType type)
         if (h < 0) h = MAXTRACKLEN-1;
     }
 
-    Math::Matrix mat;
-    mat.LoadIdentity();
-    m_device->SetTransform(TRANSFORM_WORLD, mat);
-
     Math::Point texInf, texSup;
 
     if (type == PARTITRACK1)  // explosion technique?
@@ -2746,8 +2747,8 @@ void CParticle::TrackDraw(int i, ParticleType type)
             vertex[3] = Vertex(corner[3], n, Math::Point(texInf.x, texInf.y));
         }
 
-        m_device->DrawPrimitive(PRIMITIVE_TRIANGLE_STRIP, vertex, 4);
-        m_engine->AddStatisticTriangle(2);
+        // The drag is drawn at full intensity, with the batch of the particles
+        AddBatchStrip(MAXBATCHLEVEL, vertex);
 
         if (f2 < 0.0f) break;
         f1 = f2;
@@ -2789,43 +2790,17 @@ void CParticle::DrawParticleNorm(int i)
     if (zoom == 0.0f) return;
     if (m_particle[i].intensity == 0.0f) return;
 
+    Math::Point dim;
+    dim.x = m_particle[i].dim.x * zoom;
+    dim.y = m_particle[i].dim.y * zoom;
 
-    Math::Vector corner[4];
-    Vertex vertex[4];
+    Math::Matrix mat;
 
     if (m_particle[i].sheet == SH_INTERFACE)
     {
-        Math::Vector pos = m_particle[i].pos;
-
-        Math::Vector n(0.0f, 0.0f, -1.0f);
-
-        Math::Point dim;
-        dim.x = m_particle[i].dim.x * zoom;
-        dim.y = m_particle[i].dim.y * zoom;
-
-        corner[0].x = pos.x+dim.x;
-        corner[0].y = pos.y+dim.y;
-        corner[0].z = 0.0f;
-
-        corner[1].x = pos.x-dim.x;
-        corner[1].y = pos.y+dim.y;
-        corner[1].z = 0.0f;
-
-        corner[2].x = pos.x+dim.x;
-        corner[2].y = pos.y-dim.y;
-        corner[2].z = 0.0f;
-
-        corner[3].x = pos.x-dim.x;
-        corner[3].y = pos.y-dim.y;
-        corner[3].z = 0.0f;
-
-        vertex[0] = Vertex(corner[1], n, Math::Point(m_particle[i].texSup.x, m_particle[i].texSup.y));
-        vertex[1] = Vertex(corner[0], n, Math::Point(m_particle[i].texInf.x, m_particle[i].texSup.y));
-        vertex[2] = Vertex(corner[3], n, Math::Point(m_particle[i].texSup.x, m_particle[i].texInf.y));
-        vertex[3] = Vertex(corner[2], n, Math::Point(m_particle[i].texInf.x, m_particle[i].texInf.y));
-
-        m_device->DrawPrimitive(PRIMITIVE_TRIANGLE_STRIP, vertex, 4);
-        m_engine->AddStatisticTriangle(2);
+        mat.LoadIdentity();
+        mat.Set(1, 4, m_particle[i].pos.x);
+        mat.Set(2, 4, m_particle[i].pos.y);
     }
     else
     {
@@ -2841,43 +2816,13 @@ void CParticle::DrawParticleNorm(int i)
         angle.y = Math::RotateAngle(pos.z-eye.z, pos.x-eye.x);
         angle.z = m_particle[i].angle;
 
-        Math::Matrix mat;
         Math::LoadRotationXZYMatrix(mat, angle);
         mat.Set(1, 4, pos.x);
         mat.Set(2, 4, pos.y);
         mat.Set(3, 4, pos.z);
-        m_device->SetTransform(TRANSFORM_WORLD, mat);
-
-        Math::Vector n(0.0f, 0.0f, -1.0f);
-
-        Math::Point dim;
-        dim.x = m_particle[i].dim.x * zoom;
-        dim.y = m_particle[i].dim.y * zoom;
-
-        corner[0].x =  dim.x;
-        corner[0].y =  dim.y;
-        corner[0].z =  0.0f;
-
-        corner[1].x = -dim.x;
-        corner[1].y =  dim.y;
-        corner[1].z =  0.0f;
-
-        corner[2].x =  dim.x;
-        corner[2].y = -dim.y;
-        corner[2].z =  0.0f;
-
-        corner[3].x = -dim.x;
-        corner[3].y = -dim.y;
-        corner[3].z =  0.0f;
-
-        vertex[0] = Vertex(corner[1], n, Math::Point(m_particle[i].texSup.x, m_particle[i].texSup.y));
-        vertex[1] = Vertex(corner[0], n, Math::Point(m_particle[i].texInf.x, m_particle[i].texSup.y));
-        vertex[2] = Vertex(corner[3], n, Math::Point(m_particle[i].texSup.x, m_particle[i].texInf.y));
-        vertex[3] = Vertex(corner[2], n, Math::Point(m_particle[i].texInf.x, m_particle[i].texInf.y));
-
-        m_device->DrawPrimitive(PRIMITIVE_TRIANGLE_STRIP, vertex, 4);
-        m_engine->AddStatisticTriangle(2);
     }
+
+    AddBatchQuad(i, mat, dim);
 }
 
 void CParticle::DrawParticleFlat(int i)
@@ -2908,39 +2853,12 @@ void CParticle::DrawParticleFlat(int i)
     mat.Set(1, 4, pos.x);
     mat.Set(2, 4, pos.y);
     mat.Set(3, 4, pos.z);
-    m_device->SetTransform(TRANSFORM_WORLD, mat);
-
-    Math::Vector n(0.0f, 0.0f, -1.0f);
 
     Math::Point dim;
     dim.x = m_particle[i].dim.x * m_particle[i].zoom;
     dim.y = m_particle[i].dim.y * m_particle[i].zoom;
 
-    Math::Vector corner[4];
-    corner[0].x =  dim.x;
-    corner[0].y =  dim.y;
-    corner[0].z =  0.0f;
-
-    corner[1].x = -dim.x;
-    corner[1].y =  dim.y;
-    corner[1].z =  0.0f;
-
-    corner[2].x =  dim.x;
-    corner[2].y = -dim.y;
-    corner[2].z =  0.0f;
-
-    corner[3].x = -dim.x;
-    corner[3].y = -dim.y;
-    corner[3].z =  0.0f;
-
-    Vertex vertex[4];
-    vertex[0] = Vertex(corner[1], n, Math::Point(m_particle[i].texSup.x, m_particle[i].texSup.y));
-    vertex[1] = Vertex(corner[0], n, Math::Point(m_particle[i].texInf.x, m_particle[i].texSup.y));
-    vertex[2] = Vertex(corner[3], n, Math::Point(m_particle[i].texSup.x, m_particle[i].texInf.y));
-    vertex[3] = Vertex(corner[2], n, Math::Point(m_particle[i].texInf.x, m_particle[i].texInf.y));
-
-    m_device->DrawPrimitive(PRIMITIVE_TRIANGLE_STRIP, vertex, 4);
-    m_engine->AddStatisticTriangle(2);
+    AddBatchQuad(i, mat, dim);
 }
 
 void CParticle::DrawParticleFog(int i)
@@ -2997,37 +2915,71 @@ void CParticle::DrawParticleFog(int i)
     mat.Set(1, 4, pos.x);
     mat.Set(2, 4, pos.y);
     mat.Set(3, 4, pos.z);
-    m_device->SetTransform(TRANSFORM_WORLD, mat);
 
-    Math::Vector n(0.0f, 0.0f, -1.0f);
+    AddBatchQuad(i, mat, dim);
+}
 
+void CParticle::AddBatchQuad(int i, const Math::Matrix& mat, const Math::Point& dim)
+{
     Math::Vector corner[4];
+    corner[0] = Math::Transform(mat, Math::Vector( dim.x,  dim.y, 0.0f));
+    corner[1] = Math::Transform(mat, Math::Vector(-dim.x,  dim.y, 0.0f));
+    corner[2] = Math::Transform(mat, Math::Vector( dim.x, -dim.y, 0.0f));
+    corner[3] = Math::Transform(mat, Math::Vector(-dim.x, -dim.y, 0.0f));
 
-    corner[0].x =  dim.x;
-    corner[0].y =  dim.y;
-    corner[0].z =  0.0f;
-
-    corner[1].x = -dim.x;
-    corner[1].y =  dim.y;
-    corner[1].z =  0.0f;
-
-    corner[2].x =  dim.x;
-    corner[2].y = -dim.y;
-    corner[2].z =  0.0f;
-
-    corner[3].x = -dim.x;
-    corner[3].y = -dim.y;
-    corner[3].z =  0.0f;
+    Math::Vector n = Math::Transform(mat, Math::Vector(0.0f, 0.0f, -1.0f)) -
+                     Math::Transform(mat, Math::Vector(0.0f, 0.0f,  0.0f));
 
     Vertex vertex[4];
-
     vertex[0] = Vertex(corner[1], n, Math::Point(m_particle[i].texSup.x, m_particle[i].texSup.y));
     vertex[1] = Vertex(corner[0], n, Math::Point(m_particle[i].texInf.x, m_particle[i].texSup.y));
     vertex[2] = Vertex(corner[3], n, Math::Point(m_particle[i].texSup.x, m_particle[i].texInf.y));
     vertex[3] = Vertex(corner[2], n, Math::Point(m_particle[i].texInf.x, m_particle[i].texInf.y));
 
-    m_device->DrawPrimitive(PRIMITIVE_TRIANGLE_STRIP, vertex, 4);
-    m_engine->AddStatisticTriangle(2);
+    // The intensity is the color of the state, rounded so that particles
+    // with close intensities are drawn together
+    int level = static_cast<int>(m_particle[i].intensity*MAXBATCHLEVEL + 0.5f);
+    if (level < 0)  level = 0;
+    if (level > MAXBATCHLEVEL)  level = MAXBATCHLEVEL;
+
+    AddBatchStrip(level, vertex);
+}
+
+void CParticle::AddBatchStrip(int level, const Vertex vertex[4])
+{
+    // The two triangles of the strip 0-1-2-3, with the same winding
+    std::vector<Vertex>& batch = m_batch[level];
+    batch.push_back(vertex[0]);
+    batch.push_back(vertex[1]);
+    batch.push_back(vertex[2]);
+    batch.push_back(vertex[2]);
+    batch.push_back(vertex[1]);
+    batch.push_back(vertex[3]);
+}
+
+void CParticle::FlushBatch()
+{
+    bool transform = false;
+
+    for (int level = 0; level <= MAXBATCHLEVEL; level++)
+    {
+        std::vector<Vertex>& batch = m_batch[level];
+        if (batch.empty()) continue;
+
+        if (!transform)
+        {
+            Math::Matrix mat;
+            mat.LoadIdentity();
+            m_device->SetTransform(TRANSFORM_WORLD, mat);
+            transform = true;
+        }
+
+        m_engine->SetState(m_batchState, IntensityToColor(static_cast<float>(level) / MAXBATCHLEVEL));
+        m_device->DrawPrimitive(PRIMITIVE_TRIANGLES, &batch[0], batch.size());
+        m_engine->AddStatisticTriangle(batch.size() / 3);
+
+        batch.clear();
+    }
 }
 
 void CParticle::DrawParticleRay(int i)
@@ -3571,6 +3523,7 @@ void CParticle::DrawParticle(int sheet)
         if (t == 4) state = ENG_RSTATE_TTEXTURE_WHITE;  // text.png
         else        state = ENG_RSTATE_TTEXTURE_BLACK;  // effect[00..02].png
         m_engine->SetState(state);
+        m_batchState = state;
 
         for (int j = 0; j < MAXPARTICULE; j++)
         {
@@ -3586,18 +3539,19 @@ void CParticle::DrawParticle(int sheet)
                 loadTexture = true;
             }
 
+            // Both states blend without depth writes in a way which does
+            // not depend on the order (screen for black, multiply for white),
+            // so the batches are drawn after the other particles of the texture
             int r = m_particle[i].trackRank;
             if (r != -1)
             {
-                m_engine->SetState(state);
                 TrackDraw(r, m_particle[i].type);  // draws the drag
                 if (!m_track[r].drawParticle)  continue;
             }
 
-            m_engine->SetState(state, IntensityToColor(m_particle[i].intensity));
-
             if (m_particle[i].ray)  // ray?
             {
+                m_engine->SetState(state, IntensityToColor(m_particle[i].intensity));
                 DrawParticleRay(i);
             }
             else if ( m_particle[i].type == PARTIFLIC  ||  // circle in the water?
@@ -3627,6 +3581,8 @@ void CParticle::DrawParticle(int sheet)
                 DrawParticleNorm(i);
             }
         }
+
+        FlushBatch();
     }
 }
 
@@ -3653,14 +3609,16 @@ CObject* CParticle::SearchObjectGun(Math::Vector old, Math::Vector pos,
     box2.y += min;
     box2.z += min;
 
-    CInstanceManager* iMan = CInstanceManager::GetInstancePointer();
+    // Only the objects around the path of the shot can be hit
+    Math::Vector center = (old+pos)*0.5f;
+    float radius = Math::DistanceProjected(old, pos)*0.5f + min*1.5f + 4.0f;
+    CObjectManager::GetInstancePointer()->SearchRadius(m_nearObjects, center, radius);
 
     CObject* best = 0;
     bool shield = false;
-    for (int i = 0; i < 1000000; i++)
+    for (int i = 0; i < static_cast<int>(m_nearObjects.size()); i++)
     {
-        CObject* obj = static_cast<CObject*>(iMan->SearchInstance(CLASS_OBJECT, i));
-        if (obj == 0)  break;
+        CObject* obj = m_nearObjects[i];
 
         if (!obj->GetActif()) continue;  // inactive?
         if (obj == father) continue;
@@ -27,6 +27,8 @@
 
 #include "sound/sound.h"
 
+#include <vector>
+
 
 class CRobotMain;
 class CObject;
@@ -42,6 +44,8 @@ const short MAXTRACK = 100;
 const short MAXTRACKLEN = 10;
 const short MAXPARTIFOG = 100;
 const short MAXWHEELTRACE = 1000;
+//! Levels of intensity of the particles drawn in batches
+const short MAXBATCHLEVEL = 16;
 
 const short SH_WORLD = 0;       // particle in the world in the interface
 const short SH_FRONT = 1;       // particle in the world on the interface
@@ -358,6 +362,12 @@ protected:
     void        DrawParticleCylinder(int i);
     //! Draws a tire mark
     void        DrawParticleWheel(int i);
+    //! Adds the quad of a particle, placed by \a mat, to the batch of its intensity
+    void        AddBatchQuad(int i, const Math::Matrix& mat, const Math::Point& dim);
+    //! Adds the triangle strip of a quad to the batch of intensity \a level
+    void        AddBatchStrip(int level, const Vertex vertex[4]);
+    //! Draws the quads of the batches, one draw call per intensity
+    void        FlushBatch();
     //! Seeks if an object collided with a bullet
     CObject*    SearchObjectGun(Math::Vector old, Math::Vector pos, ParticleType type, CObject *father);
     //! Seeks if an object collided with a ray
@@ -391,6 +401,12 @@ protected:
     int           m_exploGunCounter;
     float         m_lastTimeGunDel;
     float         m_absTime;
+    //! Objects near the shot tested by SearchObjectGun()
+    std::vector<CObject*> m_nearObjects;
+    //! Quads of the particles drawn with the same texture, in world coordinates, by level of intensity
+    std::vector<Vertex>   m_batch[MAXBATCHLEVEL+1];
+    //! State of the batches
+    int                   m_batchState;
 };
 
 
@@ -0,0 +1,144 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+
+#include "graphics/engine/renderqueue.h"
+
+#include "graphics/engine/engine.h"
+
+#include "math/geometry.h"
+
+#include <algorithm>
+
+
+// Graphics module namespace
+namespace Gfx {
+
+
+//! Render states drawn blended with what is behind
+const int BLENDED_STATES = ENG_RSTATE_TTEXTURE_BLACK | ENG_RSTATE_TTEXTURE_WHITE |
+                           ENG_RSTATE_TDIFFUSE |
+                           ENG_RSTATE_TCOLOR_BLACK | ENG_RSTATE_TCOLOR_WHITE;
+
+//! Groups of items, in drawing order
+enum RenderGroup
+{
+    RENDER_GROUP_OPAQUE      = 0,
+    RENDER_GROUP_BLENDED     = 1,
+    RENDER_GROUP_TRANSPARENT = 2
+};
+
+
+void Frustum::Load(const Math::Matrix& view, const Math::Matrix& projection)
+{
+    // Same matrix as CGLDevice::ComputeSphereVisibility(), without the world
+    Math::Matrix sc;
+    Math::LoadScaleMatrix(sc, Math::Vector(1.0f, 1.0f, -1.0f));
+    Math::Matrix m = Math::MultiplyMatrices(projection, Math::MultiplyMatrices(sc, view));
+
+    // Left, right, bottom, top, front and back: row 4 plus or minus rows 1, 2 and 3
+    for (int i = 0; i < 6; i++)
+    {
+        int row = i/2 + 1;
+        float sign = (i % 2 == 0) ? 1.0f : -1.0f;
+
+        Math::Vector normal(m.Get(4, 1) + sign*m.Get(row, 1),
+                            m.Get(4, 2) + sign*m.Get(row, 2),
+                            m.Get(4, 3) + sign*m.Get(row, 3));
+        float length = normal.Length();
+
+        nx[i] = normal.x / length;
+        ny[i] = normal.y / length;
+        nz[i] = normal.z / length;
+        d[i]  = (m.Get(4, 4) + sign*m.Get(row, 4)) / length;
+    }
+}
+
+void Frustum::CullSpheres(const float* x, const float* y, const float* z, const float* radius,
+                          int count, unsigned char* visible) const
+{
+    for (int i = 0; i < count; i++)
+        visible[i] = 1;
+
+    // One plane at a time, the inner loop has no branch
+    for (int p = 0; p < 6; p++)
+    {
+        float a = nx[p], b = ny[p], c = nz[p], o = d[p];
+        for (int i = 0; i < count; i++)
+            visible[i] &= (o + a*x[i] + b*y[i] + c*z[i] >= -radius[i]);
+    }
+}
+
+
+void CRenderQueue::Clear()
+{
+    m_items.clear();
+}
+
+void CRenderQueue::Add(int objRank, int objType, unsigned int lightSet, const EngineBaseObjTexTier* tex,
+                       const EngineBaseObjDataTier* data, bool transparent)
+{
+    RenderItem item;
+    item.objRank = objRank;
+    item.objType = objType;
+    item.tex = tex;
+    item.data = data;
+    item.transparent = transparent;
+
+    if (transparent)
+        item.group = RENDER_GROUP_TRANSPARENT;
+    else if (data->state & BLENDED_STATES)
+        item.group = RENDER_GROUP_BLENDED;
+    else
+        item.group = RENDER_GROUP_OPAQUE;
+
+    item.lightSet = lightSet;
+    item.tex1 = tex->tex1.id;
+    item.tex2 = tex->tex2.id;
+    item.state = data->state;
+    item.order = m_items.size();
+
+    m_items.push_back(item);
+}
+
+void CRenderQueue::Sort()
+{
+    std::sort(m_items.begin(), m_items.end(), [](const RenderItem& a, const RenderItem& b)
+    {
+        if (a.group != b.group)
+            return a.group < b.group;
+
+        // Blended and transparent items are drawn in the order of the objects
+        if (a.group == RENDER_GROUP_OPAQUE)
+        {
+            if (a.lightSet != b.lightSet) return a.lightSet < b.lightSet;
+            if (a.tex1 != b.tex1)         return a.tex1 < b.tex1;
+            if (a.tex2 != b.tex2)         return a.tex2 < b.tex2;
+            if (a.state != b.state)       return a.state < b.state;
+        }
+
+        return a.order < b.order;
+    });
+}
+
+const std::vector<RenderItem>& CRenderQueue::GetItems() const
+{
+    return m_items;
+}
+
+
+} // namespace Gfx
+
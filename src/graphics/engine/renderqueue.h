@@ -0,0 +1,110 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file graphics/engine/renderqueue.h
+ * \brief Frustum culling and sorting of drawn objects - Frustum and CRenderQueue classes
+ */
+
+#pragma once
+
+
+#include "math/matrix.h"
+
+#include <vector>
+
+
+// Graphics module namespace
+namespace Gfx {
+
+struct EngineBaseObjTexTier;
+struct EngineBaseObjDataTier;
+
+/**
+ * \struct Frustum
+ * \brief Planes of the view frustum in world coordinates
+ *
+ * The planes are extracted once per frame from the view and projection
+ * matrices, as CDevice::ComputeSphereVisibility() does for one object, and
+ * kept as arrays so that many spheres are tested in one loop per plane.
+ */
+struct Frustum
+{
+    //! Plane i: nx[i]*x + ny[i]*y + nz[i]*z + d[i] = 0, normal pointing inside
+    float nx[6], ny[6], nz[6], d[6];
+
+    //! Extracts the planes from the matrices given to the device
+    void Load(const Math::Matrix& view, const Math::Matrix& projection);
+
+    //! Sets \a visible[i] to 1 if sphere i is at least partly inside the frustum
+    /** The spheres are given in world coordinates, one array per component. */
+    void CullSpheres(const float* x, const float* y, const float* z, const float* radius,
+                     int count, unsigned char* visible) const;
+};
+
+/**
+ * \struct RenderItem
+ * \brief Tier 4 object of a visible engine object, waiting to be drawn
+ */
+struct RenderItem
+{
+    int                             objRank;
+    //! Type of the object, for the lights
+    int                             objType;
+    const EngineBaseObjTexTier*     tex;
+    const EngineBaseObjDataTier*    data;
+    //! If true, drawn as a transparent object
+    bool                            transparent;
+
+    // Sort key
+    int                             group;
+    //! Set of lights of the object, see CLightManager::GetLightSet()
+    unsigned int                    lightSet;
+    unsigned int                    tex1, tex2;
+    int                             state;
+    int                             order;
+};
+
+/**
+ * \class CRenderQueue
+ * \brief Tier 4 objects of one frame, sorted to change the state of the device less
+ *
+ * Opaque items are sorted by the set of dynamic lights of their object (the
+ * device lights only change between sets), by textures and by render state.
+ * Items blended with the scene, then items of transparent objects, come
+ * after and keep the order they were added in.
+ */
+class CRenderQueue
+{
+public:
+    //! Removes all items
+    void        Clear();
+    //! Adds a tier 4 object of an engine object
+    void        Add(int objRank, int objType, unsigned int lightSet, const EngineBaseObjTexTier* tex,
+                    const EngineBaseObjDataTier* data, bool transparent);
+    //! Sorts the items in drawing order
+    void        Sort();
+
+    //! Returns the items, in drawing order after Sort()
+    const std::vector<RenderItem>& GetItems() const;
+
+private:
+    std::vector<RenderItem> m_items;
+};
+
+
+} // namespace Gfx
+
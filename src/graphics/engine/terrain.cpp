@@ -23,12 +23,15 @@
 
 #include "common/image.h"
 #include "common/logger.h"
+#include "common/profiler.h"
 
 #include "graphics/engine/engine.h"
 #include "graphics/engine/water.h"
 
 #include "math/geometry.h"
 
+#include <algorithm>
+#include <limits>
 #include <sstream>
 
 #include <SDL.h>
@@ -56,6 +59,7 @@ CTerrain::CTerrain()
     m_defaultHardness = 0.5f;
     m_useMaterials    = false;
 
+    ClearChangedRelief();
     FlushBuildingLevel();
     FlushFlyingLimit();
     FlushMaterials();
@@ -93,6 +97,8 @@ bool CTerrain::Generate(int mosaicCount, int brickCountPow2, float brickSize,
     dim = m_mosaicCount*m_mosaicCount;
     std::vector<int>(dim, -1).swap(m_objRanks);
 
+    ClearChangedRelief();
+
     return true;
 }
 
@@ -276,6 +282,9 @@ void CTerrain::FlushRelief()
     }
 
     m_objRanks.clear();
+    ClearChangedRelief();
+
+    NotifyChange();
 }
 
 /**
@@ -413,15 +422,24 @@ bool CTerrain::AddReliefPoint(Math::Vector pos, float scaleRelief)
 }
 
 void CTerrain::AdjustRelief()
+{
+    AdjustRelief(0, 0, m_mosaicCount*m_brickCount, m_mosaicCount*m_brickCount);
+}
+
+void CTerrain::AdjustRelief(int x1, int y1, int x2, int y2)
 {
     if (m_depth == 1) return;
 
     int ii = m_mosaicCount*m_brickCount+1;
     int b = 1 << (m_depth-1);
 
-    for (int y = 0; y < m_mosaicCount*m_brickCount; y += b)
+    // First cells of b*b bricks touching the area
+    int cx1 = x1 > 0 ? ((x1-1)/b)*b : 0;
+    int cy1 = y1 > 0 ? ((y1-1)/b)*b : 0;
+
+    for (int y = cy1; y <= y2 && y < m_mosaicCount*m_brickCount; y += b)
     {
-        for (int x = 0; x < m_mosaicCount*m_brickCount; x += b)
+        for (int x = cx1; x <= x2 && x < m_mosaicCount*m_brickCount; x += b)
         {
             int xx = 0;
             int yy = 0;
@@ -575,7 +593,95 @@ bool CTerrain::CreateMosaic(int ox, int oy, int step, int objRank,
 
     std::string texName1;
     std::string texName2;
+    Math::Point uv;
+
+    int brick = m_brickCount/m_textureSubdivCount;
+
+    VertexTex2 o = GetVertex(ox*m_brickCount+m_brickCount/2, oy*m_brickCount+m_brickCount/2, step);
+    int total = ((brick/step)+1)*2;
+
+    for (int my = 0; my < m_textureSubdivCount; my++)
+    {
+        for (int mx = 0; mx < m_textureSubdivCount; mx++)
+        {
+            GetMosaicTexture(ox, oy, mx, my, step, texName1, texName2, uv);
+
+            for (int y = 0; y < brick; y += step)
+            {
+                EngineBaseObjDataTier buffer;
+                buffer.vertices.reserve(total);
+
+                buffer.type = ENG_TRIANGLE_TYPE_SURFACE;
+                buffer.material = mat;
+
+                buffer.state = ENG_RSTATE_WRAP;
+
+                buffer.state |= ENG_RSTATE_SECOND;
+                if (step == 1)
+                    buffer.state |= ENG_RSTATE_DUAL_BLACK;
+
+                GetMosaicStrip(ox, oy, mx, my, y, step, o, uv, buffer.vertices);
+
+                m_engine->AddBaseObjQuick(baseObjRank, buffer, texName1, texName2, LOD_Constant, true);
+            }
+        }
+    }
+
+    Math::Matrix transform;
+    transform.LoadIdentity();
+    transform.Set(1, 4, o.coord.x);
+    transform.Set(3, 4, o.coord.z);
+    m_engine->SetObjectTransform(objRank, transform);
+
+    return true;
+}
 
+bool CTerrain::UpdateMosaic(int ox, int oy, int step, int objRank,
+                            std::map<std::pair<std::string, std::string>, int>& indexes)
+{
+    int baseObjRank = m_engine->GetObjectBaseRank(objRank);
+    if (baseObjRank == -1)
+        return false;
+
+    std::string texName1;
+    std::string texName2;
+    Math::Point uv;
+
+    int brick = m_brickCount/m_textureSubdivCount;
+
+    VertexTex2 o = GetVertex(ox*m_brickCount+m_brickCount/2, oy*m_brickCount+m_brickCount/2, step);
+
+    std::vector<VertexTex2> vertices;
+    vertices.reserve(((brick/step)+1)*2);
+
+    // Same buffers in the same order as CreateMosaic()
+    for (int my = 0; my < m_textureSubdivCount; my++)
+    {
+        for (int mx = 0; mx < m_textureSubdivCount; mx++)
+        {
+            GetMosaicTexture(ox, oy, mx, my, step, texName1, texName2, uv);
+            int& index = indexes[std::make_pair(texName1, texName2)];
+
+            for (int y = 0; y < brick; y += step)
+            {
+                vertices.clear();
+                GetMosaicStrip(ox, oy, mx, my, y, step, o, uv, vertices);
+
+                if (! m_engine->UpdateBaseObjQuick(baseObjRank, index, vertices, texName1, texName2, LOD_Constant))
+                    return false;
+
+                index++;
+            }
+        }
+    }
+
+    return true;
+}
+
+void CTerrain::GetMosaicTexture(int ox, int oy, int mx, int my, int step,
+                                std::string& texName1, std::string& texName2, Math::Point& uv)
+{
+    texName2.clear();
     if ( step == 1 && m_engine->GetGroundSpot() )
     {
         int i = (ox/5) + (oy/5)*(m_mosaicCount/5);
@@ -588,110 +694,92 @@ bool CTerrain::CreateMosaic(int ox, int oy, int step, int objRank,
         texName2 = s.str();
     }
 
-    int brick = m_brickCount/m_textureSubdivCount;
+    if (m_useMaterials)
+    {
+        int xx = ox*m_brickCount + mx*(m_brickCount/m_textureSubdivCount);
+        int yy = oy*m_brickCount + my*(m_brickCount/m_textureSubdivCount);
+        GetTexture(xx, yy, texName1, uv);
+    }
+    else
+    {
+        int i = (ox*m_textureSubdivCount+mx)+(oy*m_textureSubdivCount+my)*m_mosaicCount;
+        std::stringstream s;
+        s << m_texBaseName;
+        s.width(3);
+        s.fill('0');
+        s << m_textures[i];
+        s << m_texBaseExt;
+        texName1 = s.str();
+    }
+}
 
-    VertexTex2 o = GetVertex(ox*m_brickCount+m_brickCount/2, oy*m_brickCount+m_brickCount/2, step);
-    int total = ((brick/step)+1)*2;
+void CTerrain::GetMosaicStrip(int ox, int oy, int mx, int my, int y, int step,
+                              const VertexTex2& o, const Math::Point& uv,
+                              std::vector<VertexTex2>& vertices)
+{
+    int brick = m_brickCount/m_textureSubdivCount;
 
     float pixel = 1.0f/256.0f;  // 1 pixel cover (*)
     float dp = 1.0f/512.0f;
 
-    Math::Point uv;
-
-    for (int my = 0; my < m_textureSubdivCount; my++)
+    for (int x = 0; x <= brick; x += step)
     {
-        for (int mx = 0; mx < m_textureSubdivCount; mx++)
+        VertexTex2 p1 = GetVertex(ox*m_brickCount+mx*brick+x, oy*m_brickCount+my*brick+y+0   , step);
+        VertexTex2 p2 = GetVertex(ox*m_brickCount+mx*brick+x, oy*m_brickCount+my*brick+y+step, step);
+        p1.coord.x -= o.coord.x;  p1.coord.z -= o.coord.z;
+        p2.coord.x -= o.coord.x;  p2.coord.z -= o.coord.z;
+
+        if (x == 0)
+        {
+            p1.texCoord.x = 0.0f+(0.5f/256.0f);
+            p2.texCoord.x = 0.0f+(0.5f/256.0f);
+        }
+        if (x == brick)
         {
-            if (m_useMaterials)
+            p1.texCoord.x = 1.0f-(0.5f/256.0f);
+            p2.texCoord.x = 1.0f-(0.5f/256.0f);
+        }
+        if (y == 0)
+            p1.texCoord.y = 1.0f-(0.5f/256.0f);
+
+        if (y == brick - step)
+            p2.texCoord.y = 0.0f+(0.5f/256.0f);
+
+        if (m_useMaterials)
+        {
+            p1.texCoord.x /= m_textureSubdivCount;  // 0..1 -> 0..0.25
+            p1.texCoord.y /= m_textureSubdivCount;
+            p2.texCoord.x /= m_textureSubdivCount;
+            p2.texCoord.y /= m_textureSubdivCount;
+
+            if (x == 0)
             {
-                int xx = ox*m_brickCount + mx*(m_brickCount/m_textureSubdivCount);
-                int yy = oy*m_brickCount + my*(m_brickCount/m_textureSubdivCount);
-                GetTexture(xx, yy, texName1, uv);
+                p1.texCoord.x = 0.0f+dp;
+                p2.texCoord.x = 0.0f+dp;
             }
-            else
+            if (x == brick)
             {
-                int i = (ox*m_textureSubdivCount+mx)+(oy*m_textureSubdivCount+my)*m_mosaicCount;
-                std::stringstream s;
-                s << m_texBaseName;
-                s.width(3);
-                s.fill('0');
-                s << m_textures[i];
-                s << m_texBaseExt;
-                texName1 = s.str();
+                p1.texCoord.x = (1.0f/m_textureSubdivCount)-dp;
+                p2.texCoord.x = (1.0f/m_textureSubdivCount)-dp;
             }
+            if (y == 0)
+                p1.texCoord.y = (1.0f/m_textureSubdivCount)-dp;
 
-            for (int y = 0; y < brick; y += step)
-            {
-                EngineBaseObjDataTier buffer;
-                buffer.vertices.reserve(total);
+            if (y == brick - step)
+                p2.texCoord.y = 0.0f+dp;
 
-                buffer.type = ENG_TRIANGLE_TYPE_SURFACE;
-                buffer.material = mat;
-
-                buffer.state = ENG_RSTATE_WRAP;
-
-                buffer.state |= ENG_RSTATE_SECOND;
-                if (step == 1)
-                    buffer.state |= ENG_RSTATE_DUAL_BLACK;
+            p1.texCoord.x += uv.x;
+            p1.texCoord.y += uv.y;
+            p2.texCoord.x += uv.x;
+            p2.texCoord.y += uv.y;
+        }
 
-                for (int x = 0; x <= brick; x += step)
-                {
-                    VertexTex2 p1 = GetVertex(ox*m_brickCount+mx*brick+x, oy*m_brickCount+my*brick+y+0   , step);
-                    VertexTex2 p2 = GetVertex(ox*m_brickCount+mx*brick+x, oy*m_brickCount+my*brick+y+step, step);
-                    p1.coord.x -= o.coord.x;  p1.coord.z -= o.coord.z;
-                    p2.coord.x -= o.coord.x;  p2.coord.z -= o.coord.z;
-
-                    if (x == 0)
-                    {
-                        p1.texCoord.x = 0.0f+(0.5f/256.0f);
-                        p2.texCoord.x = 0.0f+(0.5f/256.0f);
-                    }
-                    if (x == brick)
-                    {
-                        p1.texCoord.x = 1.0f-(0.5f/256.0f);
-                        p2.texCoord.x = 1.0f-(0.5f/256.0f);
-                    }
-                    if (y == 0)
-                        p1.texCoord.y = 1.0f-(0.5f/256.0f);
-
-                    if (y == brick - step)
-                        p2.texCoord.y = 0.0f+(0.5f/256.0f);
-
-                    if (m_useMaterials)
-                    {
-                        p1.texCoord.x /= m_textureSubdivCount;  // 0..1 -> 0..0.25
-                        p1.texCoord.y /= m_textureSubdivCount;
-                        p2.texCoord.x /= m_textureSubdivCount;
-                        p2.texCoord.y /= m_textureSubdivCount;
-
-                        if (x == 0)
-                        {
-                            p1.texCoord.x = 0.0f+dp;
-                            p2.texCoord.x = 0.0f+dp;
-                        }
-                        if (x == brick)
-                        {
-                            p1.texCoord.x = (1.0f/m_textureSubdivCount)-dp;
-                            p2.texCoord.x = (1.0f/m_textureSubdivCount)-dp;
-                        }
-                        if (y == 0)
-                            p1.texCoord.y = (1.0f/m_textureSubdivCount)-dp;
-
-                        if (y == brick - step)
-                            p2.texCoord.y = 0.0f+dp;
-
-                        p1.texCoord.x += uv.x;
-                        p1.texCoord.y += uv.y;
-                        p2.texCoord.x += uv.x;
-                        p2.texCoord.y += uv.y;
-                    }
-
-                    int xx = mx*(m_brickCount/m_textureSubdivCount) + x;
-                    int yy = my*(m_brickCount/m_textureSubdivCount) + y;
-                    p1.texCoord2.x = (static_cast<float>(ox%5)*m_brickCount+xx+0.0f)/(m_brickCount*5);
-                    p1.texCoord2.y = (static_cast<float>(oy%5)*m_brickCount+yy+0.0f)/(m_brickCount*5);
-                    p2.texCoord2.x = (static_cast<float>(ox%5)*m_brickCount+xx+0.0f)/(m_brickCount*5);
-                    p2.texCoord2.y = (static_cast<float>(oy%5)*m_brickCount+yy+1.0f)/(m_brickCount*5);
+        int xx = mx*(m_brickCount/m_textureSubdivCount) + x;
+        int yy = my*(m_brickCount/m_textureSubdivCount) + y;
+        p1.texCoord2.x = (static_cast<float>(ox%5)*m_brickCount+xx+0.0f)/(m_brickCount*5);
+        p1.texCoord2.y = (static_cast<float>(oy%5)*m_brickCount+yy+0.0f)/(m_brickCount*5);
+        p2.texCoord2.x = (static_cast<float>(ox%5)*m_brickCount+xx+0.0f)/(m_brickCount*5);
+        p2.texCoord2.y = (static_cast<float>(oy%5)*m_brickCount+yy+1.0f)/(m_brickCount*5);
 
 // Correction for 1 pixel cover
 // There is 1 pixel cover around each of the 16 surfaces:
@@ -706,28 +794,15 @@ bool CTerrain::CreateMosaic(int ox, int oy, int step, int objRank,
 // The uv coordinates used for texturing are between min and max (instead of 0 and 1)
 // This allows to exclude the pixels situated in a margin of a pixel around the surface
 
-                    p1.texCoord2.x = (p1.texCoord2.x+pixel)*(1.0f-pixel)/(1.0f+pixel);
-                    p1.texCoord2.y = (p1.texCoord2.y+pixel)*(1.0f-pixel)/(1.0f+pixel);
-                    p2.texCoord2.x = (p2.texCoord2.x+pixel)*(1.0f-pixel)/(1.0f+pixel);
-                    p2.texCoord2.y = (p2.texCoord2.y+pixel)*(1.0f-pixel)/(1.0f+pixel);
+        p1.texCoord2.x = (p1.texCoord2.x+pixel)*(1.0f-pixel)/(1.0f+pixel);
+        p1.texCoord2.y = (p1.texCoord2.y+pixel)*(1.0f-pixel)/(1.0f+pixel);
+        p2.texCoord2.x = (p2.texCoord2.x+pixel)*(1.0f-pixel)/(1.0f+pixel);
+        p2.texCoord2.y = (p2.texCoord2.y+pixel)*(1.0f-pixel)/(1.0f+pixel);
 
 
-                    buffer.vertices.push_back(p1);
-                    buffer.vertices.push_back(p2);
-                }
-
-                m_engine->AddBaseObjQuick(baseObjRank, buffer, texName1, texName2, LOD_Constant, true);
-            }
-        }
+        vertices.push_back(p1);
+        vertices.push_back(p2);
     }
-
-    Math::Matrix transform;
-    transform.LoadIdentity();
-    transform.Set(1, 4, o.coord.x);
-    transform.Set(3, 4, o.coord.z);
-    m_engine->SetObjectTransform(objRank, transform);
-
-    return true;
 }
 
 TerrainMaterial* CTerrain::FindMaterial(int id)
@@ -1237,6 +1312,8 @@ void CTerrain::FlushMaterialPoints()
 
 bool CTerrain::CreateSquare(int x, int y)
 {
+    CProfileZone zone("CTerrain::CreateSquare");
+
     Material mat;
     mat.diffuse = Color(1.0f, 1.0f, 1.0f);
     mat.ambient = Color(0.0f, 0.0f, 0.0f);
@@ -1254,9 +1331,36 @@ bool CTerrain::CreateSquare(int x, int y)
     return true;
 }
 
+bool CTerrain::UpdateSquare(int x, int y)
+{
+    int objRank = m_objRanks[x+y*m_mosaicCount];
+    if (objRank == -1)
+        return false;  // not created yet
+
+    std::map<std::pair<std::string, std::string>, int> indexes;
+    bool updated = true;
+    for (int step = 0; step < m_depth && updated; step++)
+    {
+        updated = UpdateMosaic(x, y, 1 << step, objRank, indexes);
+    }
+
+    if (updated)
+        return true;
+
+    // The buffers are not the ones created by CreateSquare(), recreates the square
+    int baseObjRank = m_engine->GetObjectBaseRank(objRank);
+    if (baseObjRank != -1)
+        m_engine->DeleteBaseObject(baseObjRank);
+    m_engine->DeleteObject(objRank);
+    return CreateSquare(x, y);
+}
+
 bool CTerrain::CreateObjects()
 {
+    CProfileZone zone("CTerrain::CreateObjects");
+
     AdjustRelief();
+    ClearChangedRelief();
 
     for (int y = 0; y < m_mosaicCount; y++)
     {
@@ -1264,6 +1368,8 @@ bool CTerrain::CreateObjects()
             CreateSquare(x, y);
     }
 
+    NotifyChange();
+
     return true;
 }
 
@@ -1327,33 +1433,89 @@ bool CTerrain::Terraform(const Math::Vector &p1, const Math::Vector &p2, float h
             }
         }
     }
-    AdjustRelief();
+    SetChangedRelief(tp1.x-1, tp1.y-1, tp2.x+1, tp2.y+1);
+    UpdateChangedRelief();
 
-    Math::IntPoint pp1, pp2;
-    pp1.x = (tp1.x-2)/m_brickCount;
-    pp1.y = (tp1.y-2)/m_brickCount;
-    pp2.x = (tp2.x+1)/m_brickCount;
-    pp2.y = (tp2.y+1)/m_brickCount;
+    return true;
+}
+
+void CTerrain::SetChangedRelief(int x1, int y1, int x2, int y2)
+{
+    int size = m_mosaicCount*m_brickCount;
 
-    if (pp1.x <  0            ) pp1.x = 0;
-    if (pp1.x >= m_mosaicCount) pp1.x = m_mosaicCount-1;
-    if (pp1.y <  0            ) pp1.y = 0;
-    if (pp1.y >= m_mosaicCount) pp1.y = m_mosaicCount-1;
+    m_changedMin.x = std::min(m_changedMin.x, std::max(x1, 0));
+    m_changedMin.y = std::min(m_changedMin.y, std::max(y1, 0));
+    m_changedMax.x = std::max(m_changedMax.x, std::min(x2, size));
+    m_changedMax.y = std::max(m_changedMax.y, std::min(y2, size));
+}
+
+void CTerrain::ClearChangedRelief()
+{
+    m_changedMin = Math::IntPoint(std::numeric_limits<int>::max(), std::numeric_limits<int>::max());
+    m_changedMax = Math::IntPoint(std::numeric_limits<int>::min(), std::numeric_limits<int>::min());
+}
+
+void CTerrain::UpdateChangedRelief()
+{
+    CProfileZone zone("CTerrain::UpdateChangedRelief");
+
+    if (m_changedMin.x > m_changedMax.x || m_changedMin.y > m_changedMax.y)
+        return;
+
+    AdjustRelief(m_changedMin.x, m_changedMin.y, m_changedMax.x, m_changedMax.y);
+
+    // Points interpolated by AdjustRelief() are at most one cell away,
+    // and the normals of the vertices use the points one cell around
+    int b = 1 << (m_depth-1);
+    Math::IntPoint min(m_changedMin.x-2*b, m_changedMin.y-2*b);
+    Math::IntPoint max(m_changedMax.x+2*b, m_changedMax.y+2*b);
+    ClearChangedRelief();
+
+    Math::IntPoint pp1, pp2;
+    pp1.x = std::max(0, (min.x-1)/m_brickCount);
+    pp1.y = std::max(0, (min.y-1)/m_brickCount);
+    pp2.x = std::min(m_mosaicCount-1, max.x/m_brickCount);
+    pp2.y = std::min(m_mosaicCount-1, max.y/m_brickCount);
 
     for (int y = pp1.y; y <= pp2.y; y++)
     {
         for (int x = pp1.x; x <= pp2.x; x++)
-        {
-            int objRank = m_objRanks[x+y*m_mosaicCount];
-            int baseObjRank = m_engine->GetObjectBaseRank(objRank);
-            m_engine->DeleteBaseObject(baseObjRank);
-            m_engine->DeleteObject(objRank);
-            CreateSquare(x, y);  // recreates the square
-        }
+            UpdateSquare(x, y);
     }
     m_engine->Update();
 
-    return true;
+    float dim = (m_mosaicCount*m_brickCount*m_brickSize)/2.0f;
+    NotifyChange(Math::Vector(min.x*m_brickSize-dim, 0.0f, min.y*m_brickSize-dim),
+                 Math::Vector(max.x*m_brickSize-dim, 0.0f, max.y*m_brickSize-dim));
+}
+
+void CTerrain::AddChangeListener(TerrainChangeFunc func, void* user)
+{
+    TerrainListener listener;
+    listener.func = func;
+    listener.user = user;
+    m_listeners.push_back(listener);
+}
+
+void CTerrain::RemoveChangeListener(TerrainChangeFunc func, void* user)
+{
+    for (int i = static_cast<int>( m_listeners.size() )-1; i >= 0; i--)
+    {
+        if (m_listeners[i].func == func && m_listeners[i].user == user)
+            m_listeners.erase(m_listeners.begin()+i);
+    }
+}
+
+void CTerrain::NotifyChange(const Math::Vector &min, const Math::Vector &max)
+{
+    for (int i = 0; i < static_cast<int>( m_listeners.size() ); i++)
+        m_listeners[i].func(min, max, m_listeners[i].user);
+}
+
+void CTerrain::NotifyChange()
+{
+    float dim = (m_mosaicCount*m_brickCount*m_brickSize)/2.0f;
+    NotifyChange(Math::Vector(-dim, 0.0f, -dim), Math::Vector(dim, 0.0f, dim));
 }
 
 void CTerrain::SetWind(Math::Vector speed)
@@ -145,6 +145,23 @@ struct FlyingLimit
 };
 
 
+/**
+ * \typedef TerrainChangeFunc
+ * \brief Callback notified after the relief changed in given area (XZ plane)
+ */
+typedef void (*TerrainChangeFunc)(const Math::Vector &min, const Math::Vector &max, void* user);
+
+/**
+ * \struct TerrainListener
+ * \brief Registered TerrainChangeFunc
+ */
+struct TerrainListener
+{
+    TerrainChangeFunc func;
+    void*             user;
+};
+
+
 /**
  * \class CTerrain
  * \brief Terrain loader/generator and manager
@@ -255,6 +272,11 @@ public:
     //! Modifies the terrain's relief
     bool        Terraform(const Math::Vector& p1, const Math::Vector& p2, float height);
 
+    //! Registers a function called after each change of the relief
+    void        AddChangeListener(TerrainChangeFunc func, void* user);
+    //! Unregisters a function added by AddChangeListener()
+    void        RemoveChangeListener(TerrainChangeFunc func, void* user);
+
     //@{
     //! Management of the wind
     void         SetWind(Math::Vector speed);
@@ -320,18 +342,42 @@ public:
     float       GetFlyingLimit(Math::Vector pos, bool noLimit);
 
 protected:
+    //! Calls the change listeners for given area
+    void        NotifyChange(const Math::Vector &min, const Math::Vector &max);
+    //! Calls the change listeners for the whole terrain
+    void        NotifyChange();
     //! Adds a point of elevation in the buffer of relief
     bool        AddReliefPoint(Math::Vector pos, float scaleRelief);
     //! Adjust the edges of each mosaic to be compatible with all lower resolutions
     void        AdjustRelief();
+    //! Adjusts the edges of the mosaics only around the given relief points
+    void        AdjustRelief(int x1, int y1, int x2, int y2);
+    //! Adds relief points to the area changed since the last UpdateChangedRelief()
+    void        SetChangedRelief(int x1, int y1, int x2, int y2);
+    //! Empties the changed area of the relief
+    void        ClearChangedRelief();
+    //! Adjusts the changed area of the relief and updates the mosaics showing it
+    void        UpdateChangedRelief();
     //! Calculates a vector of the terrain
     Math::Vector GetVector(int x, int y);
     //! Calculates a vertex of the terrain
     VertexTex2  GetVertex(int x, int y, int step);
     //! Creates all objects of a mosaic
     bool        CreateMosaic(int ox, int oy, int step, int objRank, const Material& mat);
+    //! Updates the vertices of the objects of a mosaic, counting the buffers of each texture in \a indexes
+    bool        UpdateMosaic(int ox, int oy, int step, int objRank,
+                             std::map<std::pair<std::string, std::string>, int>& indexes);
+    //! Returns the textures of a subdivision of a mosaic
+    void        GetMosaicTexture(int ox, int oy, int mx, int my, int step,
+                                 std::string& texName1, std::string& texName2, Math::Point& uv);
+    //! Calculates the vertices of a strip of bricks of a mosaic, relative to its center \a o
+    void        GetMosaicStrip(int ox, int oy, int mx, int my, int y, int step,
+                               const VertexTex2& o, const Math::Point& uv,
+                               std::vector<VertexTex2>& vertices);
     //! Creates all objects in a mesh square ground
     bool        CreateSquare(int x, int y);
+    //! Updates the vertices of a square after a change of the relief
+    bool        UpdateSquare(int x, int y);
 
     //! Seeks a material based on its ID
     TerrainMaterial* FindMaterial(int id);
@@ -363,6 +409,9 @@ protected:
 
     //! Relief data points
     std::vector<float> m_relief;
+    //! Area of relief points changed and not shown yet (empty if min > max)
+    Math::IntPoint  m_changedMin;
+    Math::IntPoint  m_changedMax;
     //! Resources data
     std::vector<unsigned char> m_resources;
     //! Texture indices
@@ -416,6 +465,9 @@ protected:
     float           m_flyingMaxHeight;
     //! List of local flight limits
     std::vector<FlyingLimit> m_flyingLimits;
+
+    //! Functions notified of changes of the relief
+    std::vector<TerrainListener> m_listeners;
 };
 
 
@@ -18,6 +18,8 @@
 
 #include "graphics/engine/text.h"
 
+#include "graphics/engine/glyphatlas.h"
+
 #include "app/app.h"
 #include "app/gamedata.h"
 
@@ -42,14 +44,62 @@ namespace Gfx {
 struct CachedFont
 {
     TTF_Font* font;
+    //! Glyphs of the characters of several bytes
     std::map<UTF8Char, CharTexture> cache;
+    //! Glyphs of the characters of one byte, found without a search
+    CharTexture asciiCache[128];
+    //! Textures of the glyphs
+    CGlyphAtlas* atlas;
+
+    CachedFont() : font(nullptr), atlas(nullptr) {}
+};
+
+/**
+ * \struct TextRun
+ * \brief Quads of a layout drawn with the same texture
+ */
+struct TextRun
+{
+    CGlyphAtlas* atlas;
+    int          page;
+    //! Drawn in red instead of the color of the text (skip and end of line marks)
+    bool         special;
+    //! Two triangles for each glyph
+    std::vector<Vertex> quads;
+};
 
-    CachedFont() : font(nullptr) {}
+/**
+ * \struct TextLayout
+ * \brief Placed glyphs of a string, relative to its position
+ */
+struct TextLayout
+{
+    //! Runs and highlights are filled
+    bool built;
+    //! Width of the string with one font, negative until measured
+    float width;
+    std::vector<TextRun> runs;
+    //! Two triangles for each highlighted character
+    std::vector<VertexCol> highlights;
+    //! Place of the layout in CText::m_layoutOrder
+    std::list<std::map<std::string, TextLayout*>::iterator>::iterator order;
+
+    TextLayout() : built(false), width(-1.0f) {}
 };
 
 
 const Math::IntPoint REFERENCE_SIZE(800, 600);
 
+//! Number of layouts kept, the least recently used is removed to add another
+const unsigned int MAX_LAYOUTS = 1000;
+
+//! Appends the bytes of a value to a key of the layout cache
+template<typename T>
+void AppendKey(std::string &key, const T &value)
+{
+    key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
 
 CText::CText(CEngine* engine)
 {
@@ -66,6 +116,8 @@ CText::CText(CEngine* engine)
 
 CText::~CText()
 {
+    ClearLayouts();
+
     m_device = nullptr;
     m_engine = nullptr;
 }
@@ -109,6 +161,7 @@ void CText::Destroy()
             TTF_CloseFont(cf->font);
 
             cf->font = nullptr;
+            delete cf->atlas;
             delete cf;
         }
 
@@ -120,6 +173,8 @@ void CText::Destroy()
 
     m_lastCachedFont = nullptr;
 
+    ClearLayouts();
+
     TTF_Quit();
 }
 
@@ -141,16 +196,15 @@ void CText::FlushCache()
         for (auto jt = mf->fonts.begin(); jt != mf->fonts.end(); ++jt)
         {
             CachedFont *f = (*jt).second;
-            for (auto ct = f->cache.begin(); ct != f->cache.end(); ++ct)
-            {
-                Texture tex;
-                tex.id = (*ct).second.id;
-                m_device->DestroyTexture(tex);
-            }
+            f->atlas->Flush();
             f->cache.clear();
+            for (CharTexture &tex : f->asciiCache)
+                tex = CharTexture();
         }
     }
 
+    ClearLayouts();
+
     m_lastFontType = FONT_COLOBOT;
     m_lastFontSize = 0;
     m_lastCachedFont = nullptr;
@@ -331,6 +385,15 @@ float CText::GetStringWidth(std::string text, FontType font, float size)
 {
     assert(font != FONT_BUTTON);
 
+    std::string key = "S";
+    AppendKey(key, font);
+    AppendKey(key, size);
+    key += text;
+
+    TextLayout* layout = GetLayout(key);
+    if (layout->width >= 0.0f)
+        return layout->width;
+
     // Skip special chars
     for (char& c : text)
     {
@@ -343,6 +406,7 @@ float CText::GetStringWidth(std::string text, FontType font, float size)
     Math::IntPoint wndSize;
     TTF_SizeUTF8(cf->font, text.c_str(), &wndSize.x, &wndSize.y);
     Math::Point ifSize = m_engine->WindowToInterfaceSize(wndSize);
+    layout->width = ifSize.x;
     return ifSize.x;
 }
 
@@ -366,10 +430,10 @@ float CText::GetCharWidth(UTF8Char ch, FontType font, float size, float offset)
     assert(cf != nullptr);
 
     Math::Point charSize;
-    auto it = cf->cache.find(ch);
-    if (it != cf->cache.end())
+    CharTexture* tex = GetCharTexture(ch, cf);
+    if (tex != nullptr)
     {
-        charSize = (*it).second.charSize;
+        charSize = tex->charSize;
     }
     else
     {
@@ -605,9 +669,34 @@ void CText::DrawString(const std::string &text, std::vector<FontMetaChar>::itera
                        std::vector<FontMetaChar>::iterator end,
                        float size, Math::Point pos, float width, int eol, Color color)
 {
-    m_engine->SetState(ENG_RSTATE_TEXT);
+    int formatCount = end - format;
+    if (formatCount > static_cast<int>(text.length()))
+        formatCount = text.length();
+
+    std::string key = "M";
+    AppendKey(key, size);
+    AppendKey(key, width);
+    AppendKey(key, eol);
+    AppendKey(key, formatCount);
+    if (formatCount > 0)
+        key.append(reinterpret_cast<const char*>(&(*format)), formatCount * sizeof(FontMetaChar));
+    key += text;
+
+    TextLayout* layout = GetLayout(key);
+    if (!layout->built)
+        LayoutString(layout, text, format, end, size, width, eol);
+
+    DrawLayout(layout, pos, color);
+}
+
+void CText::LayoutString(TextLayout* layout, const std::string &text,
+                         std::vector<FontMetaChar>::iterator format,
+                         std::vector<FontMetaChar>::iterator end,
+                         float size, float width, int eol)
+{
+    layout->built = true;
 
-    float start = pos.x;
+    Math::Point pos(0.0f, 0.0f);
 
     unsigned int fmtIndex = 0;
 
@@ -624,28 +713,29 @@ void CText::DrawString(const std::string &text, std::vector<FontMetaChar>::itera
 
         UTF8Char ch = *it;
 
-        float offset = pos.x - start;
+        float offset = pos.x;
         float cw = GetCharWidth(ch, font, size, offset);
         if (offset + cw > width)  // exceeds the maximum width?
         {
             ch = TranslateSpecialChar(CHAR_SKIP_RIGHT);
             cw = GetCharWidth(ch, font, size, offset);
-            pos.x = start + width - cw;
-            color = Color(1.0f, 0.0f, 0.0f);
-            DrawCharAndAdjustPos(ch, font, size, pos, color);
+            pos.x = width - cw;
+            AddCharAndAdjustPos(layout, ch, font, size, pos, true);
             break;
         }
 
-        FontHighlight hl = static_cast<FontHighlight>(format[fmtIndex] & FONT_MASK_HIGHLIGHT);
+        FontHighlight hl = FONT_HIGHLIGHT_NONE;
+        if (format + fmtIndex != end)
+            hl = static_cast<FontHighlight>(format[fmtIndex] & FONT_MASK_HIGHLIGHT);
         if (hl != FONT_HIGHLIGHT_NONE)
         {
             Math::Point charSize;
             charSize.x = GetCharWidth(ch, font, size, offset);
             charSize.y = GetHeight(font, size);
-            DrawHighlight(hl, pos, charSize);
+            AddHighlight(layout, hl, pos, charSize);
         }
 
-        DrawCharAndAdjustPos(ch, font, size, pos, color);
+        AddCharAndAdjustPos(layout, ch, font, size, pos, false);
 
         // increment fmtIndex for each byte in multibyte character
         if ( ch.c1 != 0 )
@@ -660,8 +750,7 @@ void CText::DrawString(const std::string &text, std::vector<FontMetaChar>::itera
     {
         FontType font = FONT_COLOBOT;
         UTF8Char ch = TranslateSpecialChar(eol);
-        color = Color(1.0f, 0.0f, 0.0f);
-        DrawCharAndAdjustPos(ch, font, size, pos, color);
+        AddCharAndAdjustPos(layout, ch, font, size, pos, true);
     }
 }
 
@@ -692,17 +781,66 @@ void CText::DrawString(const std::string &text, FontType font,
 {
     assert(font != FONT_BUTTON);
 
-    m_engine->SetState(ENG_RSTATE_TEXT);
+    std::string key = "S";
+    AppendKey(key, font);
+    AppendKey(key, size);
+    key += text;
+
+    TextLayout* layout = GetLayout(key);
+    if (!layout->built)
+        LayoutString(layout, text, font, size);
+
+    DrawLayout(layout, pos, color);
+}
+
+void CText::LayoutString(TextLayout* layout, const std::string &text, FontType font, float size)
+{
+    layout->built = true;
+
+    Math::Point pos(0.0f, 0.0f);
 
     std::vector<UTF8Char> chars;
     StringToUTFCharList(text, chars);
     for (auto it = chars.begin(); it != chars.end(); ++it)
     {
-        DrawCharAndAdjustPos(*it, font, size, pos, color);
+        AddCharAndAdjustPos(layout, *it, font, size, pos, false);
     }
 }
 
-void CText::DrawHighlight(FontHighlight hl, Math::Point pos, Math::Point size)
+TextLayout* CText::GetLayout(const std::string &key)
+{
+    auto it = m_layouts.find(key);
+    if (it != m_layouts.end())
+    {
+        TextLayout* layout = (*it).second;
+        m_layoutOrder.splice(m_layoutOrder.begin(), m_layoutOrder, layout->order);
+        return layout;
+    }
+
+    if (m_layouts.size() >= MAX_LAYOUTS)
+    {
+        auto last = m_layoutOrder.back();
+        delete (*last).second;
+        m_layouts.erase(last);
+        m_layoutOrder.pop_back();
+    }
+
+    TextLayout* layout = new TextLayout();
+    m_layoutOrder.push_front(m_layouts.insert(std::make_pair(key, layout)).first);
+    layout->order = m_layoutOrder.begin();
+    return layout;
+}
+
+void CText::ClearLayouts()
+{
+    for (auto it = m_layouts.begin(); it != m_layouts.end(); ++it)
+        delete (*it).second;
+
+    m_layouts.clear();
+    m_layoutOrder.clear();
+}
+
+void CText::AddHighlight(TextLayout* layout, FontHighlight hl, Math::Point pos, Math::Point size)
 {
     // Gradient colors
     Color grad[4];
@@ -766,8 +904,6 @@ void CText::DrawHighlight(FontHighlight hl, Math::Point pos, Math::Point size)
         p2.y = pos.y + size.y;
     }
 
-    m_device->SetTextureEnabled(0, false);
-
     VertexCol quad[] =
     {
         VertexCol(Math::Vector(p1.x, p1.y, 0.0f), grad[3]),
@@ -776,13 +912,13 @@ void CText::DrawHighlight(FontHighlight hl, Math::Point pos, Math::Point size)
         VertexCol(Math::Vector(p2.x, p2.y, 0.0f), grad[1])
     };
 
-    m_device->DrawPrimitive(PRIMITIVE_TRIANGLE_STRIP, quad, 4);
-    m_engine->AddStatisticTriangle(2);
-
-    m_device->SetTextureEnabled(0, true);
+    // The two triangles of the strip 0-1-2-3
+    for (int i : {0, 1, 2, 2, 1, 3})
+        layout->highlights.push_back(quad[i]);
 }
 
-void CText::DrawCharAndAdjustPos(UTF8Char ch, FontType font, float size, Math::Point &pos, Color color)
+void CText::AddCharAndAdjustPos(TextLayout* layout, UTF8Char ch, FontType font, float size,
+                                Math::Point &pos, bool special)
 {
     // TODO: if (font == FONT_BUTTON)
     if (font == FONT_BUTTON) return;
@@ -801,40 +937,83 @@ void CText::DrawCharAndAdjustPos(UTF8Char ch, FontType font, float size, Math::P
         ch = TranslateSpecialChar(ch.c1);
     }
 
-    auto it = cf->cache.find(ch);
-    CharTexture tex;
-    if (it != cf->cache.end())
+    CharTexture* tex = GetCharTexture(ch, cf);
+    if (tex == nullptr)  // invalid
+        return;
+
+    Math::Point p1(pos.x, pos.y);
+    Math::Point p2(pos.x + tex->charSize.x, pos.y + tex->charSize.y);
+
+    Math::Vector n(0.0f, 0.0f, -1.0f);  // normal
+
+    Vertex quad[4] =
+    {
+        Vertex(Math::Vector(p1.x, p1.y, 0.0f), n, Math::Point(tex->texCoord1.x, tex->texCoord2.y)),
+        Vertex(Math::Vector(p1.x, p2.y, 0.0f), n, Math::Point(tex->texCoord1.x, tex->texCoord1.y)),
+        Vertex(Math::Vector(p2.x, p1.y, 0.0f), n, Math::Point(tex->texCoord2.x, tex->texCoord2.y)),
+        Vertex(Math::Vector(p2.x, p2.y, 0.0f), n, Math::Point(tex->texCoord2.x, tex->texCoord1.y))
+    };
+
+    TextRun* run = nullptr;
+    for (TextRun &r : layout->runs)
     {
-        tex = (*it).second;
+        if (r.atlas == cf->atlas && r.page == tex->page && r.special == special)
+        {
+            run = &r;
+            break;
+        }
     }
-    else
+
+    if (run == nullptr)
     {
-        tex = CreateCharTexture(ch, cf);
+        layout->runs.push_back(TextRun());
+        run = &layout->runs.back();
+        run->atlas = cf->atlas;
+        run->page = tex->page;
+        run->special = special;
+    }
 
-        if (tex.id == 0) // invalid
-            return;
+    // The two triangles of the strip 0-1-2-3
+    for (int i : {0, 1, 2, 2, 1, 3})
+        run->quads.push_back(quad[i]);
 
-        cf->cache[ch] = tex;
-    }
+    pos.x += tex->charSize.x * width;
+}
 
-    Math::Point p1(pos.x, pos.y + tex.charSize.y - tex.texSize.y);
-    Math::Point p2(pos.x + tex.texSize.x, pos.y + tex.charSize.y);
+void CText::DrawLayout(TextLayout* layout, Math::Point pos, Color color)
+{
+    m_engine->SetState(ENG_RSTATE_TEXT);
 
-    Math::Vector n(0.0f, 0.0f, -1.0f);  // normal
+    if (!layout->highlights.empty())
+    {
+        m_highlightQuads = layout->highlights;
+        for (VertexCol &v : m_highlightQuads)
+        {
+            v.coord.x += pos.x;
+            v.coord.y += pos.y;
+        }
 
-    Vertex quad[4] =
+        m_device->SetTextureEnabled(0, false);
+        m_device->DrawPrimitive(PRIMITIVE_TRIANGLES, &m_highlightQuads[0], m_highlightQuads.size());
+        m_engine->AddStatisticTriangle(m_highlightQuads.size() / 3);
+        m_device->SetTextureEnabled(0, true);
+    }
+
+    for (TextRun &run : layout->runs)
     {
-        Vertex(Math::Vector(p1.x, p1.y, 0.0f), n, Math::Point(0.0f, 1.0f)),
-        Vertex(Math::Vector(p1.x, p2.y, 0.0f), n, Math::Point(0.0f, 0.0f)),
-        Vertex(Math::Vector(p2.x, p1.y, 0.0f), n, Math::Point(1.0f, 1.0f)),
-        Vertex(Math::Vector(p2.x, p2.y, 0.0f), n, Math::Point(1.0f, 0.0f))
-    };
+        m_quads = run.quads;
+        for (Vertex &v : m_quads)
+        {
+            v.coord.x += pos.x;
+            v.coord.y += pos.y;
+        }
 
-    m_device->SetTexture(0, tex.id);
-    m_device->DrawPrimitive(PRIMITIVE_TRIANGLE_STRIP, quad, 4, color);
-    m_engine->AddStatisticTriangle(2);
+        Color runColor = run.special ? Color(1.0f, 0.0f, 0.0f) : color;
 
-    pos.x += tex.charSize.x * width;
+        m_device->SetTexture(0, run.atlas->GetTexture(run.page));
+        m_device->DrawPrimitive(PRIMITIVE_TRIANGLES, &m_quads[0], m_quads.size(), runColor);
+        m_engine->AddStatisticTriangle(m_quads.size() / 3);
+    }
 }
 
 CachedFont* CText::GetOrOpenFont(FontType font, float size)
@@ -870,6 +1049,7 @@ CachedFont* CText::GetOrOpenFont(FontType font, float size)
 
     m_lastCachedFont = new CachedFont();
     m_lastCachedFont->font = TTF_OpenFont(path.c_str(), pointSize);
+    m_lastCachedFont->atlas = new CGlyphAtlas(m_device);
     if (m_lastCachedFont->font == nullptr)
         m_error = std::string("TTF_OpenFont error ") + std::string(TTF_GetError());
 
@@ -878,6 +1058,23 @@ CachedFont* CText::GetOrOpenFont(FontType font, float size)
     return m_lastCachedFont;
 }
 
+CharTexture* CText::GetCharTexture(UTF8Char ch, CachedFont* font)
+{
+    CharTexture* tex = nullptr;
+    if (ch.c2 == 0 && ch.c3 == 0 && static_cast<unsigned char>(ch.c1) < 128)
+        tex = &font->asciiCache[static_cast<unsigned char>(ch.c1)];
+    else
+        tex = &font->cache[ch];
+
+    if (tex->page == -1)
+        *tex = CreateCharTexture(ch, font);
+
+    if (tex->page == -1)
+        return nullptr;
+
+    return tex;
+}
+
 CharTexture CText::CreateCharTexture(UTF8Char ch, CachedFont* font)
 {
     CharTexture texture;
@@ -893,40 +1090,20 @@ CharTexture CText::CreateCharTexture(UTF8Char ch, CachedFont* font)
         return texture;
     }
 
-    int w = Math::NextPowerOfTwo(textSurface->w);
-    int h = Math::NextPowerOfTwo(textSurface->h);
-
-    textSurface->flags = textSurface->flags & (~SDL_SRCALPHA);
-    SDL_Surface* textureSurface = SDL_CreateRGBSurface(0, w, h, 32, 0x00ff0000, 0x0000ff00,
-                                                       0x000000ff, 0xff000000);
-    SDL_BlitSurface(textSurface, NULL, textureSurface, NULL);
-
-    ImageData data;
-    data.surface = textureSurface;
-
-    TextureCreateParams createParams;
-    createParams.format = TEX_IMG_RGBA;
-    createParams.minFilter = TEX_MIN_FILTER_NEAREST;
-    createParams.magFilter = TEX_MAG_FILTER_NEAREST;
-    createParams.mipmap = false;
-
-    Texture tex = m_device->CreateTexture(&data, createParams);
-
-    data.surface = nullptr;
-
-    if (! tex.Valid())
+    Glyph glyph;
+    if (! font->atlas->AddGlyph(textSurface, glyph))
     {
-        m_error = "Texture create error";
+        m_error = "Glyph atlas error";
     }
     else
     {
-        texture.id = tex.id;
-        texture.texSize =  m_engine->WindowToInterfaceSize(Math::IntPoint(textureSurface->w, textureSurface->h));
-        texture.charSize = m_engine->WindowToInterfaceSize(Math::IntPoint(textSurface->w, textSurface->h));
+        texture.page = glyph.page;
+        texture.texCoord1 = glyph.texCoord1;
+        texture.texCoord2 = glyph.texCoord2;
+        texture.charSize = m_engine->WindowToInterfaceSize(glyph.size);
     }
 
     SDL_FreeSurface(textSurface);
-    SDL_FreeSurface(textureSurface);
 
     return texture;
 }
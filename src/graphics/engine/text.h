@@ -24,10 +24,12 @@
 
 
 #include "graphics/core/color.h"
+#include "graphics/core/vertex.h"
 
 #include "math/point.h"
 
 #include <vector>
+#include <list>
 #include <map>
 
 
@@ -182,15 +184,18 @@ struct UTF8Char
  */
 struct CharTexture
 {
-    unsigned int id;
-    Math::Point texSize;
+    //! Page of the glyph in the atlas of the font; -1 if the glyph is not created
+    int page;
+    //! Texture coordinates of the top left and bottom right corners
+    Math::Point texCoord1, texCoord2;
     Math::Point charSize;
 
-    CharTexture() : id(0) {}
+    CharTexture() : page(-1) {}
 };
 
-// Definition is private - in text.cpp
+// Definitions are private - in text.cpp
 struct CachedFont;
+struct TextLayout;
 
 /**
  * \struct MultisizeFont
@@ -224,7 +229,9 @@ enum SpecialChar
  * \brief Text rendering engine
  *
  * CText is responsible for drawing text in 2D interface. Font rendering is done using
- * textures generated by SDL_ttf from TTF font files.
+ * textures generated by SDL_ttf from TTF font files. The glyphs of each font and size
+ * are packed in a CGlyphAtlas, and the quads of a drawn string are kept in a cache,
+ * so that drawing the same string again takes one draw call per texture.
  *
  * All functions rendering text are divided into two types:
  * - single font - function takes a single FontType argument that (along with size)
@@ -315,14 +322,31 @@ public:
 protected:
     CachedFont* GetOrOpenFont(FontType type, float size);
     CharTexture CreateCharTexture(UTF8Char ch, CachedFont* font);
+    //! Returns the glyph of a character, created at the first call; nullptr on error
+    CharTexture* GetCharTexture(UTF8Char ch, CachedFont* font);
 
     void        DrawString(const std::string &text, std::vector<FontMetaChar>::iterator format,
                            std::vector<FontMetaChar>::iterator end,
                            float size, Math::Point pos, float width, int eol, Color color);
     void        DrawString(const std::string &text, FontType font,
                            float size, Math::Point pos, float width, int eol, Color color);
-    void        DrawHighlight(FontHighlight hl, Math::Point pos, Math::Point size);
-    void        DrawCharAndAdjustPos(UTF8Char ch, FontType font, float size, Math::Point &pos, Color color);
+
+    //! Returns the cached layout with the given key, empty if it is new
+    TextLayout* GetLayout(const std::string &key);
+    //! Removes all the cached layouts
+    void        ClearLayouts();
+    //! Places the characters of a string (multi-format), relative to its position
+    void        LayoutString(TextLayout* layout, const std::string &text,
+                             std::vector<FontMetaChar>::iterator format,
+                             std::vector<FontMetaChar>::iterator end,
+                             float size, float width, int eol);
+    //! Places the characters of a string (one font), relative to its position
+    void        LayoutString(TextLayout* layout, const std::string &text, FontType font, float size);
+    void        AddHighlight(TextLayout* layout, FontHighlight hl, Math::Point pos, Math::Point size);
+    void        AddCharAndAdjustPos(TextLayout* layout, UTF8Char ch, FontType font, float size,
+                                    Math::Point &pos, bool special);
+    //! Draws a layout at the given position
+    void        DrawLayout(TextLayout* layout, Math::Point pos, Color color);
     void        StringToUTFCharList(const std::string &text, std::vector<UTF8Char> &chars);
 
 protected:
@@ -338,6 +362,14 @@ protected:
     FontType     m_lastFontType;
     int          m_lastFontSize;
     CachedFont*  m_lastCachedFont;
+
+    //! Layouts of the last drawn or measured strings
+    std::map<std::string, TextLayout*> m_layouts;
+    //! Layouts from the most to the least recently used
+    std::list<std::map<std::string, TextLayout*>::iterator> m_layoutOrder;
+    //! Vertices of a layout moved to the position of the text
+    std::vector<Vertex>    m_quads;
+    std::vector<VertexCol> m_highlightQuads;
 };
 
 
@@ -0,0 +1,166 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+
+#include "graphics/engine/textureloader.h"
+
+#include "common/image.h"
+#include "common/profiler.h"
+
+#include <algorithm>
+#include <thread>
+
+
+// Graphics module namespace
+namespace Gfx {
+
+
+CTextureLoader::CTextureLoader(int threads)
+{
+    if (threads < 0)
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+
+    m_threadCount = threads > 0 ? threads : 1;
+    m_next = 0;
+    m_done = 0;
+}
+
+CTextureLoader::~CTextureLoader()
+{
+    Clear();
+}
+
+int CTextureLoader::GetThreadCount()
+{
+    return m_threadCount;
+}
+
+void CTextureLoader::Add(const std::string& texName, const std::string& fileName)
+{
+    if (m_index.count(texName) > 0)
+        return;
+
+    m_index[texName] = m_texNames.size();
+    m_texNames.push_back(texName);
+    m_fileNames.push_back(fileName);
+    m_images.push_back(nullptr);
+}
+
+int CTextureLoader::GetCount()
+{
+    return m_texNames.size();
+}
+
+void CTextureLoader::Decode(ProgressFunc progress)
+{
+    int total = m_texNames.size();
+    m_next = 0;
+    m_done = 0;
+
+    int threads = std::min(m_threadCount, total);
+    if (threads <= 1)
+    {
+        DecodeNext();
+        if (progress) progress(m_done, total);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++)
+    {
+        workers.push_back(std::thread([this]
+        {
+            if (CProfiler::IsEnabled())
+                CProfiler::GetInstancePointer()->SetThreadName("Texture decoder");
+
+            DecodeNext();
+        }));
+    }
+
+    // The calling thread only reports the progress, the device is not used meanwhile
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        int reported = 0;
+        while (reported < total)
+        {
+            m_decoded.wait(lock, [this, reported] { return m_done != reported; });
+            reported = m_done;
+
+            if (progress)
+            {
+                lock.unlock();
+                progress(reported, total);
+                lock.lock();
+            }
+        }
+    }
+
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void CTextureLoader::DecodeNext()
+{
+    int count = m_texNames.size();
+    while (true)
+    {
+        int i = m_next++;
+        if (i >= count) break;
+
+        if (m_images[i] == nullptr)
+        {
+            CImage* image = new CImage();
+            if (image->Load(m_fileNames[i]))
+            {
+                m_images[i] = image;
+            }
+            else
+            {
+                // Loaded again when the texture is created, to report the error
+                delete image;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_done++;
+        }
+        m_decoded.notify_one();
+    }
+}
+
+CImage* CTextureLoader::GetImage(const std::string& texName)
+{
+    auto it = m_index.find(texName);
+    if (it == m_index.end())
+        return nullptr;
+
+    return m_images[(*it).second];
+}
+
+void CTextureLoader::Clear()
+{
+    for (CImage* image : m_images)
+        delete image;
+
+    m_texNames.clear();
+    m_fileNames.clear();
+    m_images.clear();
+    m_index.clear();
+}
+
+
+} // namespace Gfx
@@ -0,0 +1,100 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file graphics/engine/textureloader.h
+ * \brief Decoding of texture files on several threads - CTextureLoader class
+ */
+
+#pragma once
+
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+class CImage;
+
+
+// Graphics module namespace
+namespace Gfx {
+
+
+/**
+ * \class CTextureLoader
+ * \brief Decodes the images of many textures at once, on several threads
+ *
+ * The textures are added by name with the path of their file, then
+ * Decode() loads all the images on threads started for the call, while the
+ * calling thread reports the progress. The textures are then created on the
+ * device by the calling thread, from the images given by GetImage().
+ */
+class CTextureLoader
+{
+public:
+    //! Function called with the number of images decoded and the number of images to decode
+    typedef std::function<void(int done, int total)> ProgressFunc;
+
+    //! Creates a loader decoding on \a threads threads; -1 for the number of cores
+    CTextureLoader(int threads = -1);
+    ~CTextureLoader();
+
+    //! Returns the number of threads decoding the images
+    int         GetThreadCount();
+
+    //! Adds a texture to decode, once
+    void        Add(const std::string& texName, const std::string& fileName);
+    //! Returns the number of textures added
+    int         GetCount();
+
+    //! Decodes the images of the textures added, returns when all are done
+    void        Decode(ProgressFunc progress = nullptr);
+
+    //! Returns the decoded image of a texture, nullptr if it was not added or could not be loaded
+    CImage*     GetImage(const std::string& texName);
+
+    //! Frees the images and forgets the textures
+    void        Clear();
+
+protected:
+    //! Decodes images until none is left
+    void        DecodeNext();
+
+protected:
+    int                         m_threadCount;
+    //! Textures added, in order
+    std::vector<std::string>    m_texNames;
+    std::vector<std::string>    m_fileNames;
+    //! Images decoded, nullptr if not loaded
+    std::vector<CImage*>        m_images;
+    //! Index of textures by name
+    std::map<std::string, int>  m_index;
+    //! Index of the next image to decode
+    std::atomic<int>            m_next;
+    std::mutex                  m_mutex;
+    //! Notified each time an image is decoded
+    std::condition_variable     m_decoded;
+    //! Number of images decoded
+    int                         m_done;
+};
+
+
+} // namespace Gfx
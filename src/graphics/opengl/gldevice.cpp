@@ -534,77 +534,40 @@ Texture CGLDevice::CreateTexture(CImage *image, const TextureCreateParams &param
     return tex;
 }
 
-Texture CGLDevice::CreateTexture(ImageData *data, const TextureCreateParams &params)
-{
-    Texture result;
-
-    result.size.x = data->surface->w;
-    result.size.y = data->surface->h;
-
-    if (!Math::IsPowerOfTwo(result.size.x) || !Math::IsPowerOfTwo(result.size.y))
-        GetLogger()->Warn("Creating non-power-of-2 texture (%dx%d)!\n", result.size.x, result.size.y);
-
-    result.originalSize = result.size;
-
-    // Use & enable 1st texture stage
-    if (m_multitextureAvailable)
-        glActiveTexture(GL_TEXTURE0);
-
-    glEnable(GL_TEXTURE_2D);
-
-    glGenTextures(1, &result.id);
-    glBindTexture(GL_TEXTURE_2D, result.id);
-
-    // Set params
-
-    GLint minF = 0;
-    if      (params.minFilter == TEX_MIN_FILTER_NEAREST)                minF = GL_NEAREST;
-    else if (params.minFilter == TEX_MIN_FILTER_LINEAR)                 minF = GL_LINEAR;
-    else if (params.minFilter == TEX_MIN_FILTER_NEAREST_MIPMAP_NEAREST) minF = GL_NEAREST_MIPMAP_NEAREST;
-    else if (params.minFilter == TEX_MIN_FILTER_LINEAR_MIPMAP_NEAREST)  minF = GL_LINEAR_MIPMAP_NEAREST;
-    else if (params.minFilter == TEX_MIN_FILTER_NEAREST_MIPMAP_LINEAR)  minF = GL_NEAREST_MIPMAP_LINEAR;
-    else if (params.minFilter == TEX_MIN_FILTER_LINEAR_MIPMAP_LINEAR)   minF = GL_LINEAR_MIPMAP_LINEAR;
-    else  assert(false);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minF);
-
-    GLint magF = 0;
-    if      (params.magFilter == TEX_MAG_FILTER_NEAREST) magF = GL_NEAREST;
-    else if (params.magFilter == TEX_MAG_FILTER_LINEAR)  magF = GL_LINEAR;
-    else  assert(false);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magF);
-
-    if (params.mipmap)
-        glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
-    else
-        glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_FALSE);
-
+namespace {
 
+/**
+ * Returns the OpenGL format of the pixels of \a data given as \a format
+ * and sets \a alpha if it is known. If the pixels must be converted,
+ * \a convertedSurface is set to the converted copy of the surface, which
+ * must be freed by the caller.
+ */
+GLenum GetSourceFormat(ImageData *data, TexImgFormat format, bool &alpha, SDL_Surface *&convertedSurface)
+{
     bool convert = false;
     GLenum sourceFormat = 0;
 
-    if (params.format == TEX_IMG_RGB)
+    if (format == TEX_IMG_RGB)
     {
         sourceFormat = GL_RGB;
-        result.alpha = false;
+        alpha = false;
     }
-    else if (params.format == TEX_IMG_BGR)
+    else if (format == TEX_IMG_BGR)
     {
         sourceFormat = GL_BGR;
-        result.alpha = false;
+        alpha = false;
     }
-    else if (params.format == TEX_IMG_RGBA)
+    else if (format == TEX_IMG_RGBA)
     {
         sourceFormat = GL_RGBA;
-        result.alpha = true;
+        alpha = true;
     }
-    else if (params.format == TEX_IMG_BGRA)
+    else if (format == TEX_IMG_BGRA)
     {
         sourceFormat = GL_BGRA;
-        result.alpha = true;
+        alpha = true;
     }
-    else if (params.format == TEX_IMG_AUTO)
+    else if (format == TEX_IMG_AUTO)
     {
         if (data->surface->format->BytesPerPixel == 4)
         {
@@ -614,7 +577,7 @@ Texture CGLDevice::CreateTexture(ImageData *data, const TextureCreateParams &par
                 (data->surface->format->Bmask == 0x000000FF))
             {
                 sourceFormat = GL_BGRA;
-                result.alpha = true;
+                alpha = true;
             }
             else if ((data->surface->format->Amask == 0xFF000000) &&
                      (data->surface->format->Bmask == 0x00FF0000) &&
@@ -622,7 +585,7 @@ Texture CGLDevice::CreateTexture(ImageData *data, const TextureCreateParams &par
                      (data->surface->format->Rmask == 0x000000FF))
             {
                 sourceFormat = GL_RGBA;
-                result.alpha = true;
+                alpha = true;
             }
             else
             {
@@ -637,14 +600,14 @@ Texture CGLDevice::CreateTexture(ImageData *data, const TextureCreateParams &par
                 (data->surface->format->Bmask == 0x0000FF))
             {
                 sourceFormat = GL_BGR;
-                result.alpha = false;
+                alpha = false;
             }
             else if ((data->surface->format->Bmask == 0xFF0000) &&
                      (data->surface->format->Gmask == 0x00FF00) &&
                      (data->surface->format->Rmask == 0x0000FF))
             {
                 sourceFormat = GL_RGB;
-                result.alpha = false;
+                alpha = false;
             }
             else
             {
@@ -660,31 +623,84 @@ Texture CGLDevice::CreateTexture(ImageData *data, const TextureCreateParams &par
     else
         assert(false);
 
-    SDL_Surface* actualSurface = data->surface;
-    SDL_Surface* convertedSurface = nullptr;
+    convertedSurface = nullptr;
 
     if (convert)
     {
-        SDL_PixelFormat format;
-        format.BytesPerPixel = 4;
-        format.BitsPerPixel = 32;
-        format.alpha = 0;
-        format.colorkey = 0;
-        format.Aloss = format.Bloss = format.Gloss = format.Rloss = 0;
-        format.Amask = 0xFF000000;
-        format.Ashift = 24;
-        format.Bmask = 0x00FF0000;
-        format.Bshift = 16;
-        format.Gmask = 0x0000FF00;
-        format.Gshift = 8;
-        format.Rmask = 0x000000FF;
-        format.Rshift = 0;
-        format.palette = nullptr;
-        convertedSurface = SDL_ConvertSurface(data->surface, &format, SDL_SWSURFACE);
-        if (convertedSurface != nullptr)
-            actualSurface = convertedSurface;
+        SDL_PixelFormat rgbaFormat;
+        rgbaFormat.BytesPerPixel = 4;
+        rgbaFormat.BitsPerPixel = 32;
+        rgbaFormat.alpha = 0;
+        rgbaFormat.colorkey = 0;
+        rgbaFormat.Aloss = rgbaFormat.Bloss = rgbaFormat.Gloss = rgbaFormat.Rloss = 0;
+        rgbaFormat.Amask = 0xFF000000;
+        rgbaFormat.Ashift = 24;
+        rgbaFormat.Bmask = 0x00FF0000;
+        rgbaFormat.Bshift = 16;
+        rgbaFormat.Gmask = 0x0000FF00;
+        rgbaFormat.Gshift = 8;
+        rgbaFormat.Rmask = 0x000000FF;
+        rgbaFormat.Rshift = 0;
+        rgbaFormat.palette = nullptr;
+        convertedSurface = SDL_ConvertSurface(data->surface, &rgbaFormat, SDL_SWSURFACE);
     }
 
+    return sourceFormat;
+}
+
+} // anonymous namespace
+
+Texture CGLDevice::CreateTexture(ImageData *data, const TextureCreateParams &params)
+{
+    Texture result;
+
+    result.size.x = data->surface->w;
+    result.size.y = data->surface->h;
+
+    if (!Math::IsPowerOfTwo(result.size.x) || !Math::IsPowerOfTwo(result.size.y))
+        GetLogger()->Warn("Creating non-power-of-2 texture (%dx%d)!\n", result.size.x, result.size.y);
+
+    result.originalSize = result.size;
+
+    // Use & enable 1st texture stage
+    if (m_multitextureAvailable)
+        glActiveTexture(GL_TEXTURE0);
+
+    glEnable(GL_TEXTURE_2D);
+
+    glGenTextures(1, &result.id);
+    glBindTexture(GL_TEXTURE_2D, result.id);
+
+    // Set params
+
+    GLint minF = 0;
+    if      (params.minFilter == TEX_MIN_FILTER_NEAREST)                minF = GL_NEAREST;
+    else if (params.minFilter == TEX_MIN_FILTER_LINEAR)                 minF = GL_LINEAR;
+    else if (params.minFilter == TEX_MIN_FILTER_NEAREST_MIPMAP_NEAREST) minF = GL_NEAREST_MIPMAP_NEAREST;
+    else if (params.minFilter == TEX_MIN_FILTER_LINEAR_MIPMAP_NEAREST)  minF = GL_LINEAR_MIPMAP_NEAREST;
+    else if (params.minFilter == TEX_MIN_FILTER_NEAREST_MIPMAP_LINEAR)  minF = GL_NEAREST_MIPMAP_LINEAR;
+    else if (params.minFilter == TEX_MIN_FILTER_LINEAR_MIPMAP_LINEAR)   minF = GL_LINEAR_MIPMAP_LINEAR;
+    else  assert(false);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minF);
+
+    GLint magF = 0;
+    if      (params.magFilter == TEX_MAG_FILTER_NEAREST) magF = GL_NEAREST;
+    else if (params.magFilter == TEX_MAG_FILTER_LINEAR)  magF = GL_LINEAR;
+    else  assert(false);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magF);
+
+    if (params.mipmap)
+        glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
+    else
+        glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_FALSE);
+
+
+    SDL_Surface* convertedSurface = nullptr;
+    GLenum sourceFormat = GetSourceFormat(data, params.format, result.alpha, convertedSurface);
+    SDL_Surface* actualSurface = convertedSurface != nullptr ? convertedSurface : data->surface;
+
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, actualSurface->w, actualSurface->h,
                  0, sourceFormat, GL_UNSIGNED_BYTE, actualSurface->pixels);
 
@@ -700,6 +716,33 @@ Texture CGLDevice::CreateTexture(ImageData *data, const TextureCreateParams &par
     return result;
 }
 
+void CGLDevice::UpdateTexture(const Texture &texture, Math::IntPoint offset, ImageData *data, TexImgFormat format)
+{
+    if (! texture.Valid() || data == nullptr || data->surface == nullptr)
+        return;
+
+    bool alpha = texture.alpha;
+    SDL_Surface* convertedSurface = nullptr;
+    GLenum sourceFormat = GetSourceFormat(data, format, alpha, convertedSurface);
+    SDL_Surface* actualSurface = convertedSurface != nullptr ? convertedSurface : data->surface;
+
+    if (m_multitextureAvailable)
+        glActiveTexture(GL_TEXTURE0);
+
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+
+    // The rows of the surface may be padded
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, actualSurface->pitch / actualSurface->format->BytesPerPixel);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, offset.x, offset.y, actualSurface->w, actualSurface->h,
+                    sourceFormat, GL_UNSIGNED_BYTE, actualSurface->pixels);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    SDL_FreeSurface(convertedSurface);
+
+    // Restore the previous state of 1st stage
+    glBindTexture(GL_TEXTURE_2D, m_currentTextures[0].id);
+}
+
 void CGLDevice::DestroyTexture(const Texture &texture)
 {
     // Unbind the texture if in use anywhere
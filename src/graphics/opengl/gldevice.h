@@ -123,6 +123,7 @@ public:
 
     virtual Texture CreateTexture(CImage *image, const TextureCreateParams &params);
     virtual Texture CreateTexture(ImageData *data, const TextureCreateParams &params);
+    virtual void UpdateTexture(const Texture &texture, Math::IntPoint offset, ImageData *data, TexImgFormat format);
     virtual void DestroyTexture(const Texture &texture);
     virtual void DestroyAllTextures();
 
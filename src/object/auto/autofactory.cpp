@@ -25,6 +25,7 @@
 
 #include "object/robotmain.h"
 #include "object/brain.h"
+#include "object/objman.h"
 
 #include "physics/physics.h"
 
@@ -388,7 +389,8 @@ bool CAutoFactory::EventProcess(const Event &event)
                 delete fret;
             }
 
-            m_vehicle = vehicle = SearchVehicle();
+            vehicle = SearchVehicle();
+            m_vehicle = CObjectManager::GetInstancePointer()->GetHandle(vehicle);
             if ( vehicle != 0 )
             {
                 physics = vehicle->GetPhysics();
@@ -487,9 +489,11 @@ bool CAutoFactory::EventProcess(const Event &event)
                 m_object->SetZoomZ(10+i, 0.30f);
             }
 
-            if ( m_program != nullptr )
+            // The vehicle may have been destroyed while the doors opened
+            vehicle = CObjectManager::GetInstancePointer()->SearchHandle(m_vehicle);
+            if ( m_program != nullptr && vehicle != nullptr )
             {
-                CBrain* brain = m_vehicle->GetBrain();
+                CBrain* brain = vehicle->GetBrain();
                 if ( brain != nullptr )
                 {
                     brain->SendProgram(0, const_cast<const char*>(m_program));
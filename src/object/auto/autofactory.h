@@ -21,6 +21,7 @@
 
 
 #include "object/auto/auto.h"
+#include "object/objregistry.h"
 
 
 
@@ -75,7 +76,7 @@ protected:
     Math::Vector        m_fretPos;
     int                 m_channelSound;
 
-    CObject*            m_vehicle;
+    ObjectHandle        m_vehicle;      // vehicle built, until its program is started
     char*               m_program;
 };
 
@@ -712,6 +712,7 @@ bool CBrain::EventProcess(const Event &event)
             p2.x += 20.0f;
             p2.z += 20.0f;
             m_terrain->Terraform(p1, p2, h+1.0f);
+            m_main->UpdateMap(p1, p2);
         }
         if ( event.param == 'R' )
         {
@@ -725,6 +726,7 @@ bool CBrain::EventProcess(const Event &event)
             p2.x += 20.0f;
             p2.z += 20.0f;
             m_terrain->Terraform(p1, p2, h-1.0f);
+            m_main->UpdateMap(p1, p2);
         }
 #endif
     }
@@ -2640,6 +2642,18 @@ int CBrain::GetProgram()
     return m_program;
 }
 
+// Returns the script that EventFrame() will continue in this frame,
+// so that CScriptPool can compute it before; nullptr if none.
+
+CScript* CBrain::GetComputeScript()
+{
+    if ( m_physics == 0 || !m_object->GetEnable() )  return nullptr;
+    if ( !m_bActivity )  return nullptr;
+    if ( m_primaryTask != 0 )  return nullptr;  // EndedTask() may continue it
+    if ( m_program == -1 )  return nullptr;
+    return m_script[m_program];
+}
+
 
 // Name management scripts to load.
 
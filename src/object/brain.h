@@ -100,6 +100,7 @@ public:
     void        RunProgram(int rank);
     int         FreeProgram();
     int         GetProgram();
+    CScript*    GetComputeScript();
     void        StopProgram();
     void        StopTask();
 
@@ -0,0 +1,137 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+
+#include "object/navgrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+const int CHUNK_COUNT = (NAV_SIZE+NAV_CHUNK-1)/NAV_CHUNK;
+
+} // anonymous namespace
+
+
+CNavGrid::CNavGrid()
+{
+    m_sampler = nullptr;
+    m_samplerUser = nullptr;
+    m_computedCount = 0;
+}
+
+CNavGrid::~CNavGrid()
+{
+}
+
+void CNavGrid::SetSampler(NavSampler sampler, void* user)
+{
+    m_sampler = sampler;
+    m_samplerUser = user;
+    Flush();
+}
+
+void CNavGrid::Flush()
+{
+    for (int i = 0; i < NAV_MAX; i++)
+    {
+        m_cells[i].clear();
+        m_valid[i].clear();
+    }
+}
+
+void CNavGrid::Invalidate(const Math::Vector &min, const Math::Vector &max)
+{
+    // One more cell around, since the sampler may look at the neighbours
+    int x0 = std::max(GetCell(std::min(min.x, max.x))-1, 0)/NAV_CHUNK;
+    int y0 = std::max(GetCell(std::min(min.z, max.z))-1, 0)/NAV_CHUNK;
+    int x1 = std::min(GetCell(std::max(min.x, max.x))+1, NAV_SIZE-1)/NAV_CHUNK;
+    int y1 = std::min(GetCell(std::max(min.z, max.z))+1, NAV_SIZE-1)/NAV_CHUNK;
+
+    for (int i = 0; i < NAV_MAX; i++)
+    {
+        if (m_valid[i].empty()) continue;
+
+        for (int y = y0; y <= y1; y++)
+        {
+            for (int x = x0; x <= x1; x++)
+                m_valid[i][x+y*CHUNK_COUNT] = false;
+        }
+    }
+}
+
+void CNavGrid::TerrainChanged(const Math::Vector &min, const Math::Vector &max, void* user)
+{
+    static_cast<CNavGrid*>(user)->Invalidate(min, max);
+}
+
+bool CNavGrid::IsBlocked(NavClass cls, int x, int y)
+{
+    if (x < 0 || x >= NAV_SIZE ||
+        y < 0 || y >= NAV_SIZE)  return false;
+
+    if (m_valid[cls].empty())
+    {
+        m_cells[cls].assign(NAV_SIZE*NAV_SIZE, false);
+        m_valid[cls].assign(CHUNK_COUNT*CHUNK_COUNT, false);
+    }
+
+    int cx = x/NAV_CHUNK;
+    int cy = y/NAV_CHUNK;
+    if (! m_valid[cls][cx+cy*CHUNK_COUNT])
+        ComputeChunk(cls, cx, cy);
+
+    return m_cells[cls][x+y*NAV_SIZE];
+}
+
+int CNavGrid::GetComputedCount()
+{
+    return m_computedCount;
+}
+
+int CNavGrid::GetCell(float coord)
+{
+    return static_cast<int>(floorf((coord+1600.0f)/NAV_CELL));
+}
+
+void CNavGrid::ComputeChunk(NavClass cls, int cx, int cy)
+{
+    int x1 = std::min((cx+1)*NAV_CHUNK, NAV_SIZE);
+    int y1 = std::min((cy+1)*NAV_CHUNK, NAV_SIZE);
+
+    for (int y = cy*NAV_CHUNK; y < y1; y++)
+    {
+        for (int x = cx*NAV_CHUNK; x < x1; x++)
+        {
+            Math::Vector p;
+            p.x = x*NAV_CELL-1600.0f;
+            p.y = 0.0f;
+            p.z = y*NAV_CELL-1600.0f;
+
+            bool blocked = false;
+            if (m_sampler != nullptr)
+                blocked = ! m_sampler(cls, p, m_samplerUser);
+
+            m_cells[cls][x+y*NAV_SIZE] = blocked;
+        }
+    }
+
+    m_valid[cls][cx+cy*CHUNK_COUNT] = true;
+    m_computedCount++;
+}
+
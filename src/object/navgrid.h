@@ -0,0 +1,105 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file object/navgrid.h
+ * \brief Navigation grid shared by all robots - CNavGrid class
+ */
+
+#pragma once
+
+
+#include "math/vector.h"
+
+#include <vector>
+
+
+//! Size of one navigation cell (in world units)
+const float NAV_CELL = 5.0f;
+
+//! Number of cells along one axis, covering the whole terrain
+const int NAV_SIZE = static_cast<int>(3200.0f/NAV_CELL);
+
+//! Number of cells along one axis of a chunk, the unit of lazy evaluation
+const int NAV_CHUNK = 16;
+
+/**
+ * \enum NavClass
+ * \brief Mobility class, deciding on which terrain a robot can go
+ */
+enum NavClass
+{
+    NAV_WHEELS      = 0,    //! < wheels and everything else moving on the ground
+    NAV_TRACKS      = 1,    //! < caterpillars
+    NAV_LEGS        = 2,    //! < insect legs
+    NAV_AMPHIBIOUS  = 3,    //! < caterpillars going under water
+    NAV_FLYING      = 4,    //! < flying robots
+    NAV_MAX         = 5
+};
+
+/**
+ * \typedef NavSampler
+ * \brief Callback deciding whether a robot of given class can stand at given position
+ */
+typedef bool (*NavSampler)(NavClass cls, const Math::Vector &pos, void* user);
+
+/**
+ * \class CNavGrid
+ * \brief Terrain obstacles for each mobility class, cached between searches
+ *
+ * The cell (x, y) covers the square starting at (x*NAV_CELL-1600, y*NAV_CELL-1600)
+ * and is sampled at this corner, as the bitmap of CTaskGoto always was.
+ * Cells are computed by chunks on first use and kept until the terrain
+ * changes there, so robots looking for a path do not sample the relief again.
+ */
+class CNavGrid
+{
+public:
+    CNavGrid();
+    ~CNavGrid();
+
+    //! Sets the function which samples the terrain
+    void        SetSampler(NavSampler sampler, void* user);
+
+    //! Forgets all computed cells
+    void        Flush();
+    //! Forgets the cells in given area
+    void        Invalidate(const Math::Vector &min, const Math::Vector &max);
+    //! Callback for CTerrain, \a user is the grid
+    static void TerrainChanged(const Math::Vector &min, const Math::Vector &max, void* user);
+
+    //! Tests whether the cell is blocked for given class; cells outside are free
+    bool        IsBlocked(NavClass cls, int x, int y);
+    //! Returns the number of chunks computed since the creation of the grid
+    int         GetComputedCount();
+
+    //! Returns the cell containing given coordinate
+    static int  GetCell(float coord);
+
+protected:
+    //! Samples all cells of one chunk
+    void        ComputeChunk(NavClass cls, int cx, int cy);
+
+protected:
+    NavSampler  m_sampler;
+    void*       m_samplerUser;
+    //! Blocked cells of each class, allocated on first use
+    std::vector<bool> m_cells[NAV_MAX];
+    //! Whether the chunks of each class are up to date
+    std::vector<bool> m_valid[NAV_MAX];
+    int         m_computedCount;
+};
+
@@ -0,0 +1,237 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+
+#include "object/navplanner.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+const float DIAGONAL = 1.41421356f;
+
+//! Order of the open list: smallest total first, then nearest to the goal
+bool CompareOpen(const NavOpen &a, const NavOpen &b)
+{
+    if (a.total != b.total) return a.total > b.total;
+    return a.remain > b.remain;
+}
+
+} // anonymous namespace
+
+
+CNavPlanner::CNavPlanner()
+{
+    m_size = 0;
+    m_goalRadius = 0.0f;
+    m_blocked = nullptr;
+    m_user = nullptr;
+    m_state = ERR_GOTO_IMPOSSIBLE;
+    m_expanded = 0;
+    m_pageCount = 0;
+}
+
+CNavPlanner::~CNavPlanner()
+{
+    FreePages();
+}
+
+void CNavPlanner::Start(int size, Math::IntPoint start, Math::IntPoint goal, float goalRadius,
+                        NavBlockedFunc blocked, void* user)
+{
+    m_size       = size;
+    m_goal       = goal;
+    m_goalRadius = goalRadius;
+    m_blocked    = blocked;
+    m_user       = user;
+    m_expanded   = 0;
+    m_open.clear();
+    m_path.clear();
+
+    if (start.x < 0 || start.x >= size ||
+        start.y < 0 || start.y >= size)
+    {
+        m_state = ERR_GOTO_IMPOSSIBLE;
+        return;
+    }
+
+    int pageCount = (size+NAV_PAGE-1)/NAV_PAGE;
+    if (pageCount != m_pageCount)
+    {
+        FreePages();
+        m_pageCount = pageCount;
+        m_pages.assign(pageCount*pageCount, nullptr);
+    }
+    for (unsigned int i = 0; i < m_pages.size(); i++)
+    {
+        if (m_pages[i] == nullptr) continue;
+        for (int j = 0; j < NAV_PAGE*NAV_PAGE; j++)
+            m_pages[i]->nodes[j].cost = -1.0f;
+    }
+
+    m_state = ERR_CONTINUE;
+    Open(start.x+start.y*size, -1, 0.0f);
+}
+
+Error CNavPlanner::Step(int budget)
+{
+    if (m_state != ERR_CONTINUE) return m_state;
+
+    for (int n = 0; n < budget; n++)
+    {
+        if (m_open.empty())
+        {
+            m_state = ERR_GOTO_IMPOSSIBLE;
+            return m_state;
+        }
+
+        std::pop_heap(m_open.begin(), m_open.end(), CompareOpen);
+        NavOpen best = m_open.back();
+        m_open.pop_back();
+
+        NavNode& node = GetNode(best.cell);
+        if (node.closed) continue;  // already reached by a shorter path?
+        node.closed = true;
+        float cost = node.cost;
+
+        int x = best.cell%m_size;
+        int y = best.cell/m_size;
+
+        if (Math::IntPoint(x-m_goal.x, y-m_goal.y).Length() <= m_goalRadius)  // goal reached?
+        {
+            MakePath(best.cell);
+            m_state = ERR_OK;
+            return m_state;
+        }
+
+        if (++m_expanded >= NAV_MAX_NODES)
+        {
+            m_state = ERR_GOTO_ITER;
+            return m_state;
+        }
+
+        bool free[3][3];
+        for (int dy = -1; dy <= 1; dy++)
+        {
+            for (int dx = -1; dx <= 1; dx++)
+            {
+                if (dx == 0 && dy == 0) continue;
+                int nx = x+dx;
+                int ny = y+dy;
+                free[dx+1][dy+1] = nx >= 0 && nx < m_size &&
+                                   ny >= 0 && ny < m_size &&
+                                   ! m_blocked(nx, ny, m_user);
+            }
+        }
+
+        for (int dy = -1; dy <= 1; dy++)
+        {
+            for (int dx = -1; dx <= 1; dx++)
+            {
+                if (dx == 0 && dy == 0) continue;
+                if (! free[dx+1][dy+1]) continue;
+
+                float step = 1.0f;
+                if (dx != 0 && dy != 0)  // diagonal?
+                {
+                    if (! free[dx+1][1] || ! free[1][dy+1]) continue;  // cuts a corner?
+                    step = DIAGONAL;
+                }
+
+                Open((x+dx)+(y+dy)*m_size, best.cell, cost+step);
+            }
+        }
+    }
+
+    return m_state;
+}
+
+const std::vector<Math::IntPoint>& CNavPlanner::GetPath()
+{
+    return m_path;
+}
+
+int CNavPlanner::GetExpandedCount()
+{
+    return m_expanded;
+}
+
+float CNavPlanner::Estimate(int x, int y)
+{
+    // Octile distance, never more than the real length of the path;
+    // it exceeds the straight distance by 8.24% at most, hence the margin
+    // around the goal radius
+    float dx = fabs(static_cast<float>(x-m_goal.x));
+    float dy = fabs(static_cast<float>(y-m_goal.y));
+    float dist = std::max(dx, dy) + (DIAGONAL-1.0f)*std::min(dx, dy);
+    return std::max(dist-m_goalRadius*1.0824f, 0.0f);
+}
+
+void CNavPlanner::Open(int cell, int parent, float cost)
+{
+    NavNode& node = GetNode(cell);
+    if (node.cost >= 0.0f)  // already visited?
+    {
+        if (node.closed || node.cost <= cost) return;
+    }
+
+    node.parent = parent;
+    node.cost   = cost;
+    node.closed = false;
+
+    NavOpen entry;
+    entry.remain = Estimate(cell%m_size, cell/m_size);
+    entry.total  = cost+entry.remain;
+    entry.cell   = cell;
+    m_open.push_back(entry);
+    std::push_heap(m_open.begin(), m_open.end(), CompareOpen);
+}
+
+void CNavPlanner::MakePath(int cell)
+{
+    m_path.clear();
+    while (cell != -1)
+    {
+        m_path.push_back(Math::IntPoint(cell%m_size, cell/m_size));
+        cell = GetNode(cell).parent;
+    }
+    std::reverse(m_path.begin(), m_path.end());
+}
+
+NavNode& CNavPlanner::GetNode(int cell)
+{
+    int x = cell%m_size;
+    int y = cell/m_size;
+    NavPage*& page = m_pages[x/NAV_PAGE + (y/NAV_PAGE)*m_pageCount];
+    if (page == nullptr)
+    {
+        page = new NavPage();
+        for (int i = 0; i < NAV_PAGE*NAV_PAGE; i++)
+            page->nodes[i].cost = -1.0f;
+    }
+    return page->nodes[x%NAV_PAGE + (y%NAV_PAGE)*NAV_PAGE];
+}
+
+void CNavPlanner::FreePages()
+{
+    for (unsigned int i = 0; i < m_pages.size(); i++)
+        delete m_pages[i];
+    m_pages.clear();
+    m_pageCount = 0;
+}
+
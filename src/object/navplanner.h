@@ -0,0 +1,132 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file object/navplanner.h
+ * \brief Time-sliced A* path search - CNavPlanner class
+ */
+
+#pragma once
+
+
+#include "common/global.h"
+
+#include "math/intpoint.h"
+
+#include <vector>
+
+
+//! Maximum number of cells visited by one search
+const int NAV_MAX_NODES = 200000;
+
+/**
+ * \typedef NavBlockedFunc
+ * \brief Callback telling whether a cell can not be crossed
+ */
+typedef bool (*NavBlockedFunc)(int x, int y, void* user);
+
+//! Number of cells along one axis of a page of CNavPlanner
+const int NAV_PAGE = 32;
+
+/**
+ * \struct NavNode
+ * \brief Cell visited by CNavPlanner
+ */
+struct NavNode
+{
+    //! Cell from which the cell was reached, -1 for the start
+    int     parent;
+    //! Length of the best known path from the start, negative if not visited
+    float   cost;
+    //! Whether the cell was already expanded
+    bool    closed;
+};
+
+/**
+ * \struct NavPage
+ * \brief Square of NAV_PAGE*NAV_PAGE nodes, allocated when the search comes there
+ */
+struct NavPage
+{
+    NavNode nodes[NAV_PAGE*NAV_PAGE];
+};
+
+/**
+ * \struct NavOpen
+ * \brief Entry of the open list of CNavPlanner
+ */
+struct NavOpen
+{
+    //! Estimated length of the path through the cell
+    float   total;
+    //! Estimated distance to the goal, used to break ties
+    float   remain;
+    //! Index of the cell
+    int     cell;
+};
+
+/**
+ * \class CNavPlanner
+ * \brief A* search on a square grid of cells, in slices of limited work
+ *
+ * Cells are connected to their 8 neighbours; diagonal moves must not cut
+ * the corner of a blocked cell. The search can be spread over several
+ * frames by calling Step() with a budget of expanded cells each frame.
+ * Memory is only taken for the regions of the grid the search visits.
+ */
+class CNavPlanner
+{
+public:
+    CNavPlanner();
+    ~CNavPlanner();
+
+    //! Begins a new search; the goal is reached at \a goalRadius cells from \a goal
+    void        Start(int size, Math::IntPoint start, Math::IntPoint goal, float goalRadius,
+                      NavBlockedFunc blocked, void* user);
+    //! Continues the search, expanding at most \a budget cells
+    Error       Step(int budget);
+
+    //! Returns the cells of the found path, from the start to the goal
+    const std::vector<Math::IntPoint>& GetPath();
+    //! Returns the number of cells expanded since Start()
+    int         GetExpandedCount();
+
+protected:
+    //! Estimates the distance from the cell to the goal
+    float       Estimate(int x, int y);
+    //! Records a better path to the cell
+    void        Open(int cell, int parent, float cost);
+    //! Builds m_path back from the cell
+    void        MakePath(int cell);
+    //! Returns the node of the cell, allocating its page if needed
+    NavNode&    GetNode(int cell);
+    //! Frees all pages
+    void        FreePages();
+
+protected:
+    int             m_size;
+    Math::IntPoint  m_goal;
+    float           m_goalRadius;
+    NavBlockedFunc  m_blocked;
+    void*           m_user;
+    Error           m_state;
+    int             m_expanded;
+    int             m_pageCount;    // pages along one axis
+    std::vector<NavPage*> m_pages;
+    std::vector<NavOpen> m_open;
+    std::vector<Math::IntPoint> m_path;
+};
+
@@ -103,36 +103,26 @@ static float debug_arm3 = 0.0f;
 
 
 
-// Updates the class Object.
+// Updates the elements of the class Object, each one when a program reads it.
 
-void uObject(CBotVar* botThis, void* user)
+static void uCategory(CBotVar* pVar, void* user)
 {
-    CObject*    object = static_cast<CObject*>(user);
-    CObject*    power;
-    CObject*    fret;
-    CPhysics*   physics;
-    CBotVar     *pVar, *pSub;
-    ObjectType  type;
-    Math::Vector    pos;
-    float       value;
-    int         iValue;
-
+    CObject* object = static_cast<CObject*>(user);
     if ( object == 0 )  return;
 
-    physics = object->GetPhysics();
+    pVar->SetValInt(object->GetType(), object->GetName());
+}
 
-    // Updates the object's type.
-    pVar = botThis->GetItemList();  // "category"
-    type = object->GetType();
-    pVar->SetValInt(type, object->GetName());
+static void uPosition(CBotVar* pVar, void* user)
+{
+    CObject* object = static_cast<CObject*>(user);
+    if ( object == 0 )  return;
 
-    // Updates the position of the object.
-    pVar = pVar->GetNext();  // "position"
+    CBotVar* pSub = pVar->GetItemList();  // "x"
     if ( object->GetTruck() == 0 )
     {
-        pos = object->GetPosition(0);
+        Math::Vector pos = object->GetPosition(0);
         pos.y -= object->GetWaterLevel();  // relative to sea level!
-        pSub = pVar->GetItemList();  // "x"
         pSub->SetValFloat(pos.x/g_unit);
         pSub = pSub->GetNext();  // "y"
         pSub->SetValFloat(pos.z/g_unit);
@@ -141,71 +131,127 @@ void uObject(CBotVar* botThis, void* user)
     }
     else    // object transported?
     {
-        pSub = pVar->GetItemList();  // "x"
         pSub->SetInit(IS_NAN);
         pSub = pSub->GetNext();  // "y"
         pSub->SetInit(IS_NAN);
         pSub = pSub->GetNext();  // "z"
         pSub->SetInit(IS_NAN);
     }
+}
+
+static void uOrientation(CBotVar* pVar, void* user)
+{
+    CObject* object = static_cast<CObject*>(user);
+    if ( object == 0 )  return;
+
+    Math::Vector angle = object->GetAngle(0) + object->GetInclinaison();
+    pVar->SetValFloat(360.0f-Math::Mod(angle.y*180.0f/Math::PI, 360.0f));
+}
+
+static void uPitch(CBotVar* pVar, void* user)
+{
+    CObject* object = static_cast<CObject*>(user);
+    if ( object == 0 )  return;
+
+    Math::Vector angle = object->GetAngle(0) + object->GetInclinaison();
+    pVar->SetValFloat(angle.z*180.0f/Math::PI);
+}
+
+static void uRoll(CBotVar* pVar, void* user)
+{
+    CObject* object = static_cast<CObject*>(user);
+    if ( object == 0 )  return;
+
+    Math::Vector angle = object->GetAngle(0) + object->GetInclinaison();
+    pVar->SetValFloat(angle.x*180.0f/Math::PI);
+}
+
+static void uEnergyLevel(CBotVar* pVar, void* user)
+{
+    CObject* object = static_cast<CObject*>(user);
+    if ( object == 0 )  return;
 
-    // Updates the angle.
-    pos = object->GetAngle(0);
-    pos += object->GetInclinaison();
-    pVar = pVar->GetNext();  // "orientation"
-    pVar->SetValFloat(360.0f-Math::Mod(pos.y*180.0f/Math::PI, 360.0f));
-    pVar = pVar->GetNext();  // "pitch"
-    pVar->SetValFloat(pos.z*180.0f/Math::PI);
-    pVar = pVar->GetNext();  // "roll"
-    pVar->SetValFloat(pos.x*180.0f/Math::PI);
-
-    // Updates the energy level of the object.
-    pVar = pVar->GetNext();  // "energyLevel"
-    value = object->GetEnergy();
-    pVar->SetValFloat(value);
-
-    // Updates the shield level of the object.
-    pVar = pVar->GetNext();  // "shieldLevel"
-    value = object->GetShield();
-    pVar->SetValFloat(value);
-
-    // Updates the temperature of the reactor.
-    pVar = pVar->GetNext();  // "temperature"
-    if ( physics == 0 )  value = 0.0f;
-    else                 value = 1.0f-physics->GetReactorRange();
-    pVar->SetValFloat(value);
-
-    // Updates the height above the ground.
-    pVar = pVar->GetNext();  // "altitude"
-    if ( physics == 0 )  value = 0.0f;
-    else                 value = physics->GetFloorHeight();
-    pVar->SetValFloat(value/g_unit);
-
-    // Updates the lifetime of the object.
-    pVar = pVar->GetNext();  // "lifeTime"
-    value = object->GetAbsTime();
-    pVar->SetValFloat(value);
-
-    // Updates the material of the object.
-    pVar = pVar->GetNext();  // "material"
-    iValue = object->GetMaterial();
-    pVar->SetValInt(iValue);
-
-    // Updates the type of battery.
-    pVar = pVar->GetNext();  // "energyCell"
-    power = object->GetPower();
+    pVar->SetValFloat(object->GetEnergy());
+}
+
+static void uShieldLevel(CBotVar* pVar, void* user)
+{
+    CObject* object = static_cast<CObject*>(user);
+    if ( object == 0 )  return;
+
+    pVar->SetValFloat(object->GetShield());
+}
+
+// Temperature of the reactor.
+
+static void uTemperature(CBotVar* pVar, void* user)
+{
+    CObject* object = static_cast<CObject*>(user);
+    if ( object == 0 )  return;
+
+    CPhysics* physics = object->GetPhysics();
+    if ( physics == 0 )  pVar->SetValFloat(0.0f);
+    else                 pVar->SetValFloat(1.0f-physics->GetReactorRange());
+}
+
+// Height above the ground.
+
+static void uAltitude(CBotVar* pVar, void* user)
+{
+    CObject* object = static_cast<CObject*>(user);
+    if ( object == 0 )  return;
+
+    CPhysics* physics = object->GetPhysics();
+    if ( physics == 0 )  pVar->SetValFloat(0.0f);
+    else                 pVar->SetValFloat(physics->GetFloorHeight()/g_unit);
+}
+
+static void uLifeTime(CBotVar* pVar, void* user)
+{
+    CObject* object = static_cast<CObject*>(user);
+    if ( object == 0 )  return;
+
+    pVar->SetValFloat(object->GetAbsTime());
+}
+
+static void uMaterial(CBotVar* pVar, void* user)
+{
+    CObject* object = static_cast<CObject*>(user);
+    if ( object == 0 )  return;
+
+    pVar->SetValInt(object->GetMaterial());
+}
+
+// Battery, whose elements are updated when read in their turn.
+
+static void uEnergyCell(CBotVar* pVar, void* user)
+{
+    CObject* object = static_cast<CObject*>(user);
+    if ( object == 0 )  return;
+
+    CObject* power = object->GetPower();
     if ( power == 0 )  pVar->SetPointer(0);
     else               pVar->SetPointer(power->GetBotVar());
+}
+
+// Transported object.
+
+static void uLoad(CBotVar* pVar, void* user)
+{
+    CObject* object = static_cast<CObject*>(user);
+    if ( object == 0 )  return;
 
-    // Updates the transported object's type.
-    pVar = pVar->GetNext();  // "load"
-    fret = object->GetFret();
+    CObject* fret = object->GetFret();
     if ( fret == 0 )  pVar->SetPointer(0);
     else              pVar->SetPointer(fret->GetBotVar());
+}
+
+static void uId(CBotVar* pVar, void* user)
+{
+    CObject* object = static_cast<CObject*>(user);
+    if ( object == 0 )  return;
 
-    pVar = pVar->GetNext();  // "id"
-    value = object->GetID();
-    pVar->SetValInt(value);
+    pVar->SetValInt(object->GetID());
 }
 
 
@@ -335,7 +381,20 @@ CObject::CObject()
     CBotClass* bc = CBotClass::Find("object");
     if ( bc != 0 )
     {
-        bc->AddUpdateFunc(uObject);
+        bc->AddUpdateFunc("category",    uCategory);
+        bc->AddUpdateFunc("position",    uPosition);
+        bc->AddUpdateFunc("orientation", uOrientation);
+        bc->AddUpdateFunc("pitch",       uPitch);
+        bc->AddUpdateFunc("roll",        uRoll);
+        bc->AddUpdateFunc("energyLevel", uEnergyLevel);
+        bc->AddUpdateFunc("shieldLevel", uShieldLevel);
+        bc->AddUpdateFunc("temperature", uTemperature);
+        bc->AddUpdateFunc("altitude",    uAltitude);
+        bc->AddUpdateFunc("lifeTime",    uLifeTime);
+        bc->AddUpdateFunc("material",    uMaterial);
+        bc->AddUpdateFunc("energyCell",  uEnergyCell);
+        bc->AddUpdateFunc("load",        uLoad);
+        bc->AddUpdateFunc("id",          uId);
     }
 
     m_botVar = CBotVar::Create("", CBotTypResult(CBotTypClass, "object"));
@@ -462,6 +521,7 @@ void CObject::DeleteObject(bool bAll)
     }
 
     m_type = OBJECT_NULL;  // invalid object until complete destruction
+    CObjectManager::GetInstancePointer()->UpdateInstanceType(this);
 
     if ( m_partiReactor != -1 )
     {
@@ -918,6 +978,7 @@ void CObject::SetObjectParent(int part, int parent)
 void CObject::SetType(ObjectType type)
 {
     m_type = type;
+    CObjectManager::GetInstancePointer()->UpdateInstanceType(this);
     strcpy(m_name, GetObjectName(m_type));
 
     if ( m_type == OBJECT_MOBILErs )
@@ -977,6 +1038,7 @@ int CObject::GetOption()
 void CObject::SetID(int id)
 {
     m_id = id;
+    CObjectManager::GetInstancePointer()->UpdateInstanceId(this);
 
     if ( m_botVar != 0 )
     {
@@ -1284,6 +1346,7 @@ int CObject::SearchDescendant(int parent, int n)
 void CObject::FlushCrashShere()
 {
     m_crashSphereUsed = 0;
+    UpdateGridPosition();
 }
 
 // Adds a new sphere.
@@ -1300,7 +1363,9 @@ int CObject::CreateCrashSphere(Math::Vector pos, float radius, Sound sound,
     m_crashSphereRadius[m_crashSphereUsed] = radius*zoom;
     m_crashSphereHardness[m_crashSphereUsed] = hardness;
     m_crashSphereSound[m_crashSphereUsed] = sound;
-    return m_crashSphereUsed++;
+    m_crashSphereUsed++;
+    UpdateGridPosition();
+    return m_crashSphereUsed-1;
 }
 
 // Returns the number of spheres.
@@ -1374,6 +1439,7 @@ void CObject::DeleteCrashSphere(int rank)
         m_crashSphereRadius[i-1] = m_crashSphereRadius[i];
     }
     m_crashSphereUsed --;
+    UpdateGridPosition();
 }
 
 // Specifies the global sphere, relative to the object.
@@ -1385,6 +1451,7 @@ void CObject::SetGlobalSphere(Math::Vector pos, float radius)
     zoom = GetZoomX(0);
     m_globalSpherePos    = pos;
     m_globalSphereRadius = radius*zoom;
+    UpdateGridPosition();
 }
 
 // Returns the global sphere, in the world.
@@ -1402,6 +1469,7 @@ void CObject::SetJotlerSphere(Math::Vector pos, float radius)
 {
     m_jotlerSpherePos    = pos;
     m_jotlerSphereRadius = radius;
+    UpdateGridPosition();
 }
 
 // Specifies the sphere of jostling, in the world.
@@ -1418,6 +1486,7 @@ void CObject::GetJotlerSphere(Math::Vector &pos, float &radius)
 void CObject::SetShieldRadius(float radius)
 {
     m_shieldRadius = radius;
+    UpdateGridPosition();
 }
 
 // Returns the radius of the shield.
@@ -1427,6 +1496,34 @@ float CObject::GetShieldRadius()
     return m_shieldRadius;
 }
 
+// Returns the radius around the center, which encloses all the spheres
+// of the object. Used by the spatial index of CObjectManager.
+
+float CObject::GetBoundingRadius()
+{
+    Math::Vector zoom = m_objectPart[0].zoom;
+    float scale = Math::Max(fabs(zoom.x), fabs(zoom.y), fabs(zoom.z));
+
+    float radius = Math::Max(m_shieldRadius,
+                             m_globalSpherePos.Length()*scale+m_globalSphereRadius,
+                             m_jotlerSpherePos.Length()*scale+m_jotlerSphereRadius);
+
+    for (int i = 0; i < m_crashSphereUsed; i++)
+    {
+        radius = Math::Max(radius, m_crashSpherePos[i].Length()*scale+m_crashSphereRadius[i]);
+    }
+    return radius;
+}
+
+// Updates the position of the object in the spatial index.
+
+void CObject::UpdateGridPosition()
+{
+    if ( !m_objectPart[0].bUsed )  return;
+
+    CObjectManager::GetInstancePointer()->MoveInstance(this);
+}
+
 
 // Positioning an object on a certain height, above the ground.
 
@@ -1538,6 +1635,11 @@ void CObject::SetPosition(int part, const Math::Vector &pos)
     m_objectPart[part].position = pos;
     m_objectPart[part].bTranslate = true;  // it will recalculate the matrices
 
+    if ( part == 0 )
+    {
+        UpdateGridPosition();
+    }
+
     if ( part == 0 && !m_bFlat )  // main part?
     {
         rank = m_objectPart[0].object;
@@ -1728,6 +1830,11 @@ void CObject::SetZoom(int part, float zoom)
     m_objectPart[part].bZoom = ( m_objectPart[part].zoom.x != 1.0f ||
                                  m_objectPart[part].zoom.y != 1.0f ||
                                  m_objectPart[part].zoom.z != 1.0f );
+
+    if ( part == 0 )
+    {
+        UpdateGridPosition();
+    }
 }
 
 void CObject::SetZoom(int part, Math::Vector zoom)
@@ -1738,6 +1845,11 @@ void CObject::SetZoom(int part, Math::Vector zoom)
     m_objectPart[part].bZoom = ( m_objectPart[part].zoom.x != 1.0f ||
                                  m_objectPart[part].zoom.y != 1.0f ||
                                  m_objectPart[part].zoom.z != 1.0f );
+
+    if ( part == 0 )
+    {
+        UpdateGridPosition();
+    }
 }
 
 Math::Vector CObject::GetZoom(int part)
@@ -1753,6 +1865,11 @@ void CObject::SetZoomX(int part, float zoom)
     m_objectPart[part].bZoom = ( m_objectPart[part].zoom.x != 1.0f ||
                                  m_objectPart[part].zoom.y != 1.0f ||
                                  m_objectPart[part].zoom.z != 1.0f );
+
+    if ( part == 0 )
+    {
+        UpdateGridPosition();
+    }
 }
 
 void CObject::SetZoomY(int part, float zoom)
@@ -1763,6 +1880,11 @@ void CObject::SetZoomY(int part, float zoom)
     m_objectPart[part].bZoom = ( m_objectPart[part].zoom.x != 1.0f ||
                                  m_objectPart[part].zoom.y != 1.0f ||
                                  m_objectPart[part].zoom.z != 1.0f );
+
+    if ( part == 0 )
+    {
+        UpdateGridPosition();
+    }
 }
 
 void CObject::SetZoomZ(int part, float zoom)
@@ -1773,6 +1895,11 @@ void CObject::SetZoomZ(int part, float zoom)
     m_objectPart[part].bZoom = ( m_objectPart[part].zoom.x != 1.0f ||
                                  m_objectPart[part].zoom.y != 1.0f ||
                                  m_objectPart[part].zoom.z != 1.0f );
+
+    if ( part == 0 )
+    {
+        UpdateGridPosition();
+    }
 }
 
 float CObject::GetZoomX(int part)
@@ -1930,6 +2057,9 @@ void CObject::SetTruck(CObject* truck)
 
     // Invisible shadow if the object is transported.
     m_engine->SetObjectShadowHide(m_objectPart[0].object, (m_truck != 0));
+
+    // Not found by the searches while transported.
+    UpdateGridPosition();
 }
 
 CObject* CObject::GetTruck()
@@ -2093,6 +2223,7 @@ bool CObject::CreateVehicle(Math::Vector pos, float angle, ObjectType type,
                             float power, bool bTrainer, bool bToy)
 {
     m_type = type;
+    CObjectManager::GetInstancePointer()->UpdateInstanceType(this);
 
     if ( type == OBJECT_TOTO )
     {
@@ -2189,6 +2320,7 @@ bool CObject::CreateVehicle(Math::Vector pos, float angle, ObjectType type,
 bool CObject::CreateInsect(Math::Vector pos, float angle, ObjectType type)
 {
     m_type = type;
+    CObjectManager::GetInstancePointer()->UpdateInstanceType(this);
 
     m_physics = new CPhysics(this);
     m_brain   = new CBrain(this);
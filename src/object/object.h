@@ -417,6 +417,7 @@ public:
     void        GetJotlerSphere(Math::Vector &pos, float &radius);
     void        SetShieldRadius(float radius);
     float       GetShieldRadius();
+    float       GetBoundingRadius();
 
     void        SetFloorHeight(float height);
     void        FloorAdjust();
@@ -658,6 +659,7 @@ protected:
     bool        UpdateTransformObject(int part, bool bForceUpdate);
     bool        UpdateTransformObject();
     void        UpdateSelectParticle();
+    void        UpdateGridPosition();
 
 protected:
     CApplication*       m_app;
@@ -0,0 +1,304 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+
+#include "object/objgrid.h"
+
+#include "math/const.h"
+#include "math/func.h"
+#include "math/geometry.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+bool CompareRank(const ObjectGridEntry* a, const ObjectGridEntry* b)
+{
+    return a->rank < b->rank;
+}
+
+} // anonymous namespace
+
+
+CObjectGrid::CObjectGrid()
+{
+    m_nextRank = 0;
+    m_mark = 0;
+}
+
+CObjectGrid::~CObjectGrid()
+{
+}
+
+void CObjectGrid::Add(CObject* obj)
+{
+    if (m_entries.find(obj) != m_entries.end()) return;
+
+    ObjectGridEntry& entry = m_entries[obj];
+    entry.object = obj;
+    entry.rank   = m_nextRank++;
+    entry.placed = false;
+    entry.pos    = Math::Vector(0.0f, 0.0f, 0.0f);
+    entry.radius = 0.0f;
+    entry.x0 = entry.z0 = entry.x1 = entry.z1 = 0;
+    entry.mark   = 0;
+}
+
+void CObjectGrid::Remove(CObject* obj)
+{
+    auto it = m_entries.find(obj);
+    if (it == m_entries.end()) return;
+
+    if (it->second.placed)
+        Unlink(&it->second);
+
+    m_entries.erase(it);
+}
+
+void CObjectGrid::Move(CObject* obj, const Math::Vector &pos, float radius)
+{
+    auto it = m_entries.find(obj);
+    if (it == m_entries.end())
+    {
+        Add(obj);
+        it = m_entries.find(obj);
+    }
+    ObjectGridEntry* entry = &it->second;
+
+    int x0 = GetCell(pos.x-radius);
+    int z0 = GetCell(pos.z-radius);
+    int x1 = std::min(GetCell(pos.x+radius), x0+OBJECT_GRID_SIZE-1);
+    int z1 = std::min(GetCell(pos.z+radius), z0+OBJECT_GRID_SIZE-1);
+
+    entry->pos    = pos;
+    entry->radius = radius;
+
+    if ( entry->placed &&
+         entry->x0 == x0 && entry->z0 == z0 &&
+         entry->x1 == x1 && entry->z1 == z1 )  return;  // same cells?
+
+    if (entry->placed)
+        Unlink(entry);
+
+    entry->x0 = x0;
+    entry->z0 = z0;
+    entry->x1 = x1;
+    entry->z1 = z1;
+    entry->placed = true;
+
+    for (int x = x0; x <= x1; x++)
+    {
+        for (int z = z0; z <= z1; z++)
+            GetBucket(x, z).push_back(entry);
+    }
+}
+
+void CObjectGrid::Hide(CObject* obj)
+{
+    auto it = m_entries.find(obj);
+    if (it == m_entries.end()) return;
+
+    if (it->second.placed)
+        Unlink(&it->second);
+}
+
+void CObjectGrid::Flush()
+{
+    for (int i = 0; i < OBJECT_GRID_SIZE*OBJECT_GRID_SIZE; i++)
+        m_buckets[i].clear();
+
+    m_entries.clear();
+    m_found.clear();
+    m_nextRank = 0;
+    m_mark = 0;
+}
+
+int CObjectGrid::GetCount()
+{
+    return m_entries.size();
+}
+
+void CObjectGrid::SearchRadius(std::vector<CObject*> &list, const Math::Vector &center, float radius)
+{
+    Collect(GetCell(center.x-radius), GetCell(center.z-radius),
+            GetCell(center.x+radius), GetCell(center.z+radius));
+
+    unsigned int j = 0;
+    for (unsigned int i = 0; i < m_found.size(); i++)
+    {
+        ObjectGridEntry* entry = m_found[i];
+        if (Math::DistanceProjected(center, entry->pos) > radius+entry->radius) continue;
+        m_found[j++] = entry;
+    }
+    m_found.resize(j);
+
+    Output(list);
+}
+
+void CObjectGrid::SearchCone(std::vector<CObject*> &list, const Math::Vector &center, float angle, float focus,
+                             float minDist, float maxDist)
+{
+    Collect(GetCell(center.x-maxDist), GetCell(center.z-maxDist),
+            GetCell(center.x+maxDist), GetCell(center.z+maxDist));
+
+    unsigned int j = 0;
+    for (unsigned int i = 0; i < m_found.size(); i++)
+    {
+        ObjectGridEntry* entry = m_found[i];
+
+        float d = Math::DistanceProjected(center, entry->pos);
+        if (d < minDist || d > maxDist) continue;  // too close or too far?
+
+        if (focus < Math::PI*2.0f)
+        {
+            float a = Math::RotateAngle(entry->pos.x-center.x, center.z-entry->pos.z);  // CW !
+            if (! Math::TestAngle(a, angle-focus/2.0f, angle+focus/2.0f)) continue;
+        }
+
+        m_found[j++] = entry;
+    }
+    m_found.resize(j);
+
+    Output(list);
+}
+
+CObject* CObjectGrid::SearchNearest(const Math::Vector &center, float maxDist, ObjectGridFilter filter, void* user)
+{
+    if (++m_mark == 0)
+    {
+        for (auto& it : m_entries)
+            it.second.mark = 0;
+        m_mark = 1;
+    }
+
+    int cx = GetCell(center.x);
+    int cz = GetCell(center.z);
+
+    ObjectGridEntry* best = nullptr;
+    float bestDist = maxDist;
+
+    // Scans rings of cells around the center; after ring k, every object
+    // not seen yet lies at least k cells away
+    for (int k = 0; 2*k+1 <= OBJECT_GRID_SIZE+1; k++)
+    {
+        if (k > 0 && (k-1)*OBJECT_GRID_CELL > bestDist) break;
+
+        for (int x = cx-k; x <= cx+k; x++)
+        {
+            for (int z = cz-k; z <= cz+k; z++)
+            {
+                if (x != cx-k && x != cx+k && z != cz-k && z != cz+k) continue;  // inside the ring?
+
+                std::vector<ObjectGridEntry*>& bucket = GetBucket(x, z);
+                for (unsigned int i = 0; i < bucket.size(); i++)
+                {
+                    ObjectGridEntry* entry = bucket[i];
+                    if (entry->mark == m_mark) continue;
+                    entry->mark = m_mark;
+
+                    float dist = Math::DistanceProjected(center, entry->pos);
+                    if (dist > bestDist) continue;
+                    if (dist == bestDist && (best == nullptr || entry->rank > best->rank)) continue;
+                    if (filter != nullptr && !filter(entry->object, user)) continue;
+
+                    best = entry;
+                    bestDist = dist;
+                }
+            }
+        }
+    }
+
+    if (best == nullptr) return nullptr;
+    return best->object;
+}
+
+std::vector<ObjectGridEntry*>& CObjectGrid::GetBucket(int x, int z)
+{
+    return m_buckets[(x & (OBJECT_GRID_SIZE-1)) + (z & (OBJECT_GRID_SIZE-1))*OBJECT_GRID_SIZE];
+}
+
+int CObjectGrid::GetCell(float coord)
+{
+    return static_cast<int>(floorf(coord/OBJECT_GRID_CELL));
+}
+
+void CObjectGrid::Unlink(ObjectGridEntry* entry)
+{
+    for (int x = entry->x0; x <= entry->x1; x++)
+    {
+        for (int z = entry->z0; z <= entry->z1; z++)
+        {
+            std::vector<ObjectGridEntry*>& bucket = GetBucket(x, z);
+            auto it = std::find(bucket.begin(), bucket.end(), entry);
+            if (it == bucket.end()) continue;
+            *it = bucket.back();
+            bucket.pop_back();
+        }
+    }
+    entry->placed = false;
+}
+
+void CObjectGrid::Collect(int x0, int z0, int x1, int z1)
+{
+    if (++m_mark == 0)
+    {
+        for (auto& it : m_entries)
+            it.second.mark = 0;
+        m_mark = 1;
+    }
+
+    // Buckets repeat every OBJECT_GRID_SIZE cells
+    x1 = std::min(x1, x0+OBJECT_GRID_SIZE-1);
+    z1 = std::min(z1, z0+OBJECT_GRID_SIZE-1);
+
+    m_found.clear();
+
+    if (x1-x0+1 == OBJECT_GRID_SIZE && z1-z0+1 == OBJECT_GRID_SIZE)  // whole table?
+    {
+        for (auto& it : m_entries)
+        {
+            if (it.second.placed)
+                m_found.push_back(&it.second);
+        }
+        return;
+    }
+
+    for (int x = x0; x <= x1; x++)
+    {
+        for (int z = z0; z <= z1; z++)
+        {
+            std::vector<ObjectGridEntry*>& bucket = GetBucket(x, z);
+            for (unsigned int i = 0; i < bucket.size(); i++)
+            {
+                ObjectGridEntry* entry = bucket[i];
+                if (entry->mark == m_mark) continue;
+                entry->mark = m_mark;
+                m_found.push_back(entry);
+            }
+        }
+    }
+}
+
+void CObjectGrid::Output(std::vector<CObject*> &list)
+{
+    std::sort(m_found.begin(), m_found.end(), CompareRank);
+
+    list.clear();
+    for (unsigned int i = 0; i < m_found.size(); i++)
+        list.push_back(m_found[i]->object);
+}
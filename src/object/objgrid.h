@@ -0,0 +1,127 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file object/objgrid.h
+ * \brief Spatial index of objects - CObjectGrid class
+ */
+
+#pragma once
+
+
+#include "math/vector.h"
+
+#include <unordered_map>
+#include <vector>
+
+
+class CObject;
+
+//! Size of one grid cell (in world units)
+const float OBJECT_GRID_CELL = 16.0f;
+
+//! Number of hash buckets along one axis (must be a power of 2)
+const int OBJECT_GRID_SIZE = 64;
+
+/**
+ * \typedef ObjectGridFilter
+ * \brief Callback deciding whether an object is accepted by a nearest search
+ */
+typedef bool (*ObjectGridFilter)(CObject* obj, void* user);
+
+/**
+ * \struct ObjectGridEntry
+ * \brief Position of one object in CObjectGrid
+ */
+struct ObjectGridEntry
+{
+    //! Indexed object
+    CObject*        object;
+    //! Registration order; results are always returned in this order
+    int             rank;
+    //! Whether the object was given a position yet
+    bool            placed;
+    //! Center of the object
+    Math::Vector    pos;
+    //! Radius in XZ plane enclosing everything the object may collide with
+    float           radius;
+    //! Range of occupied cells
+    int             x0, z0, x1, z1;
+    //! Stamp of the last query which visited the entry
+    unsigned int    mark;
+};
+
+/**
+ * \class CObjectGrid
+ * \brief Uniform grid of objects on the XZ plane
+ *
+ * Each object is stored in every cell covered by its bounding circle, so
+ * queries only need to look at the cells covered by the searched region.
+ * The cells are hashed into a fixed table of OBJECT_GRID_SIZE^2 buckets,
+ * therefore the grid does not depend on the size of the terrain; buckets
+ * shared by distant cells only yield some more candidates.
+ *
+ * All queries are conservative (they work on bounding circles) and return
+ * objects in registration order, which is the order in which the previous
+ * linear scans over all objects visited them.
+ */
+class CObjectGrid
+{
+public:
+    CObjectGrid();
+    ~CObjectGrid();
+
+    //! Registers an object, without placing it in the grid
+    void        Add(CObject* obj);
+    //! Removes an object
+    void        Remove(CObject* obj);
+    //! Places the object at a new position, with given bounding radius
+    void        Move(CObject* obj, const Math::Vector &pos, float radius);
+    //! Takes the object out of the cells, until it is moved again
+    void        Hide(CObject* obj);
+    //! Removes all objects
+    void        Flush();
+
+    //! Returns the number of registered objects
+    int         GetCount();
+
+    //! Finds objects whose bounding circles intersect given circle
+    void        SearchRadius(std::vector<CObject*> &list, const Math::Vector &center, float radius);
+    //! Finds objects whose centers lie in given sector of a ring
+    void        SearchCone(std::vector<CObject*> &list, const Math::Vector &center, float angle, float focus,
+                           float minDist, float maxDist);
+    //! Finds the object with the nearest center accepted by \a filter
+    CObject*    SearchNearest(const Math::Vector &center, float maxDist, ObjectGridFilter filter, void* user);
+
+protected:
+    //! Returns the bucket for given cell
+    std::vector<ObjectGridEntry*>& GetBucket(int x, int z);
+    //! Returns the cell containing given coordinate
+    int         GetCell(float coord);
+    //! Removes the entry from all its cells
+    void        Unlink(ObjectGridEntry* entry);
+    //! Collects entries from given range of cells into m_found
+    void        Collect(int x0, int z0, int x1, int z1);
+    //! Copies m_found sorted by registration order to the list
+    void        Output(std::vector<CObject*> &list);
+
+protected:
+    std::unordered_map<CObject*, ObjectGridEntry> m_entries;
+    std::vector<ObjectGridEntry*> m_buckets[OBJECT_GRID_SIZE*OBJECT_GRID_SIZE];
+    std::vector<ObjectGridEntry*> m_found;
+    int             m_nextRank;
+    unsigned int    m_mark;
+};
@@ -26,11 +26,6 @@ template<> CObjectManager* CSingleton<CObjectManager>::m_instance = nullptr;
 
 CObjectManager::CObjectManager()
 {
-    for (int i = 0; i < MAX_OBJECTS; i++)
-    {
-        m_table[i] = nullptr;
-    }
-    m_usedCount = 0;
 }
 
 CObjectManager::~CObjectManager()
@@ -39,28 +34,41 @@ CObjectManager::~CObjectManager()
 
 bool CObjectManager::AddInstance(CObject* instance)
 {
-    if (m_usedCount >= MAX_OBJECTS) return false;
+    if (! m_registry.Add(instance, instance->GetID(), instance->GetType())) return false;
 
-    m_table[instance->GetID()] = instance;
-    m_usedCount++;
+    m_grid.Add(instance);
     return true;
 }
 
 bool CObjectManager::DeleteInstance(CObject* instance)
 {
-    for (int i = 0; i < m_usedCount; i++)
-    {
-        if (m_table[i] == instance)
-            m_table[i] = nullptr;
-    }
-
-    return true;
+    m_grid.Remove(instance);
+    return m_registry.Remove(instance);
 }
 
 CObject* CObjectManager::SearchInstance(int id)
 {
-    if (id >= MAX_OBJECTS) return nullptr;
-    return m_table[id];
+    return m_registry.Find(id);
+}
+
+ObjectHandle CObjectManager::GetHandle(CObject* instance)
+{
+    return m_registry.GetHandle(instance);
+}
+
+CObject* CObjectManager::SearchHandle(const ObjectHandle &handle)
+{
+    return m_registry.Resolve(handle);
+}
+
+void CObjectManager::UpdateInstanceId(CObject* instance)
+{
+    m_registry.SetID(instance, instance->GetID());
+}
+
+void CObjectManager::UpdateInstanceType(CObject* instance)
+{
+    m_registry.SetType(instance, instance->GetType());
 }
 
 CObject* CObjectManager::CreateObject(Math::Vector pos, float angle, ObjectType type,
@@ -360,9 +368,58 @@ CObject* CObjectManager::CreateObject(Math::Vector pos, float angle, ObjectType
 
 void CObjectManager::Flush()
 {
-    for (int i = 0; i < MAX_OBJECTS; i++)
+    m_registry.Flush();
+    m_grid.Flush();
+}
+
+void CObjectManager::MoveInstance(CObject* instance)
+{
+    // The position of a transported object is relative to its truck
+    if (instance->GetTruck() != nullptr)
     {
-        m_table[i] = nullptr;
+        m_grid.Hide(instance);
+        return;
     }
-    m_usedCount = 0;
+
+    m_grid.Move(instance, instance->GetPosition(0), instance->GetBoundingRadius());
+}
+
+void CObjectManager::SearchRadius(std::vector<CObject*> &list, const Math::Vector &center, float radius)
+{
+    m_grid.SearchRadius(list, center, radius);
+}
+
+void CObjectManager::SearchRadius(std::vector<ObjectHandle> &list, const Math::Vector &center, float radius)
+{
+    m_grid.SearchRadius(m_found, center, radius);
+
+    list.clear();
+    for (CObject* obj : m_found)
+        list.push_back(m_registry.GetHandle(obj));
+}
+
+void CObjectManager::SearchCone(std::vector<CObject*> &list, const Math::Vector &center, float angle, float focus,
+                                float minDist, float maxDist)
+{
+    m_grid.SearchCone(list, center, angle, focus, minDist, maxDist);
+}
+
+CObject* CObjectManager::SearchNearest(const Math::Vector &center, float maxDist, ObjectGridFilter filter, void* user)
+{
+    return m_grid.SearchNearest(center, maxDist, filter, user);
+}
+
+CObject* CObjectManager::SearchType(ObjectType type)
+{
+    return m_registry.GetFirst(type);
+}
+
+void CObjectManager::SearchType(std::vector<CObject*> &list, ObjectType type)
+{
+    m_registry.List(list, type);
+}
+
+void CObjectManager::SearchType(std::vector<CObject*> &list, const std::vector<ObjectType> &types)
+{
+    m_registry.List(list, types);
 }
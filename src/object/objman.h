@@ -22,10 +22,12 @@
 #pragma once
 
 #include "object/object.h"
+#include "object/objgrid.h"
+#include "object/objregistry.h"
 
 #include "common/singleton.h"
 
-const int MAX_OBJECTS = 500;
+#include <vector>
 
 /**
  * \class ObjectManager
@@ -43,13 +45,41 @@ public:
     bool      DeleteInstance(CObject* instance);
     //! Seeks for an object
     CObject*  SearchInstance(int id);
+    //! Returns a handle which stays safe to resolve after the object is deleted
+    ObjectHandle GetHandle(CObject* instance);
+    //! Returns the object referenced by the handle, or nullptr if it was deleted
+    CObject*  SearchHandle(const ObjectHandle &handle);
+    //! Updates the identifier of the object in the registry
+    void      UpdateInstanceId(CObject* instance);
+    //! Updates the type of the object in the registry
+    void      UpdateInstanceType(CObject* instance);
     //! Creates an object
     CObject*  CreateObject(Math::Vector pos, float angle, ObjectType type, float power = -1.f, float zoom = 1.f, float height = 0.f, bool trainer = false, bool toy = false, int option = 0);
     //! Removes all objects
     void      Flush();
 
+    //! Updates the position of the object in the spatial index, transported objects are left out
+    void      MoveInstance(CObject* instance);
+    //! Finds objects whose bounding circles intersect given circle (XZ plane)
+    void      SearchRadius(std::vector<CObject*> &list, const Math::Vector &center, float radius);
+    //! Same as above, for lists used while objects may be deleted
+    void      SearchRadius(std::vector<ObjectHandle> &list, const Math::Vector &center, float radius);
+    //! Finds objects whose centers lie in given sector (XZ plane), see radar()
+    void      SearchCone(std::vector<CObject*> &list, const Math::Vector &center, float angle, float focus,
+                         float minDist, float maxDist);
+    //! Finds the object nearest to the center (XZ plane) accepted by \a filter
+    CObject*  SearchNearest(const Math::Vector &center, float maxDist, ObjectGridFilter filter = nullptr, void* user = nullptr);
+
+    //! Returns the oldest object of given type
+    CObject*  SearchType(ObjectType type);
+    //! Appends all objects of given type to the list, oldest first
+    void      SearchType(std::vector<CObject*> &list, ObjectType type);
+    //! Appends all objects of any of given types to the list, oldest first
+    void      SearchType(std::vector<CObject*> &list, const std::vector<ObjectType> &types);
+
 protected:
-    CObject* m_table[MAX_OBJECTS];
-    int m_usedCount;
+    CObjectRegistry m_registry;
+    CObjectGrid m_grid;
+    std::vector<CObject*> m_found;
 };
 
@@ -0,0 +1,271 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+
+#include "object/objregistry.h"
+
+#include <algorithm>
+
+
+namespace {
+
+ObjectType CheckType(ObjectType type)
+{
+    if (type < 0 || type >= OBJECT_MAX) return OBJECT_NULL;
+    return type;
+}
+
+} // anonymous namespace
+
+
+CObjectRegistry::CObjectRegistry()
+{
+    m_nextOrder = 0;
+    Flush();
+}
+
+CObjectRegistry::~CObjectRegistry()
+{
+}
+
+bool CObjectRegistry::Add(CObject* obj, int id, ObjectType type)
+{
+    if (obj == nullptr) return false;
+    if (GetSlot(obj) != -1) return false;
+
+    int slot = m_freeSlot;
+    if (slot == -1)
+    {
+        ObjectSlot empty;
+        empty.object     = nullptr;
+        empty.generation = 0;
+        empty.id         = 0;
+        empty.type       = OBJECT_NULL;
+        empty.order      = 0;
+        empty.prev       = -1;
+        empty.next       = -1;
+        m_slots.push_back(empty);
+        slot = m_slots.size()-1;
+    }
+    else
+    {
+        m_freeSlot = m_slots[slot].next;
+    }
+
+    m_slots[slot].object = obj;
+    m_slots[slot].id     = id;
+    m_slots[slot].type   = CheckType(type);
+    m_slots[slot].order  = m_nextOrder++;
+    Link(slot);
+
+    m_slotByObject[obj] = slot;
+    m_slotById[id] = slot;
+    return true;
+}
+
+bool CObjectRegistry::Remove(CObject* obj)
+{
+    int slot = GetSlot(obj);
+    if (slot == -1) return false;
+
+    Unlink(slot);
+    m_slotByObject.erase(obj);
+
+    auto it = m_slotById.find(m_slots[slot].id);
+    if (it != m_slotById.end() && it->second == slot)
+        m_slotById.erase(it);
+
+    m_slots[slot].object = nullptr;
+    m_slots[slot].generation++;
+    m_slots[slot].next = m_freeSlot;
+    m_freeSlot = slot;
+    return true;
+}
+
+void CObjectRegistry::SetID(CObject* obj, int id)
+{
+    int slot = GetSlot(obj);
+    if (slot == -1) return;
+
+    auto it = m_slotById.find(m_slots[slot].id);
+    if (it != m_slotById.end() && it->second == slot)
+        m_slotById.erase(it);
+
+    m_slots[slot].id = id;
+    m_slotById[id] = slot;
+}
+
+void CObjectRegistry::SetType(CObject* obj, ObjectType type)
+{
+    int slot = GetSlot(obj);
+    if (slot == -1) return;
+
+    type = CheckType(type);
+    if (m_slots[slot].type == type) return;
+
+    Unlink(slot);
+    m_slots[slot].type = type;
+    Link(slot);
+}
+
+void CObjectRegistry::Flush()
+{
+    // Slots are kept, so that handles taken before stay invalid
+    m_freeSlot = -1;
+    for (int i = m_slots.size()-1; i >= 0; i--)
+    {
+        if (m_slots[i].object != nullptr)
+        {
+            m_slots[i].object = nullptr;
+            m_slots[i].generation++;
+        }
+        m_slots[i].prev = -1;
+        m_slots[i].next = m_freeSlot;
+        m_freeSlot = i;
+    }
+
+    m_slotByObject.clear();
+    m_slotById.clear();
+    for (int i = 0; i < OBJECT_MAX; i++)
+    {
+        m_typeFirst[i] = -1;
+        m_typeLast[i]  = -1;
+    }
+}
+
+int CObjectRegistry::GetCount()
+{
+    return m_slotByObject.size();
+}
+
+CObject* CObjectRegistry::Find(int id)
+{
+    auto it = m_slotById.find(id);
+    if (it == m_slotById.end()) return nullptr;
+    return m_slots[it->second].object;
+}
+
+bool CObjectRegistry::Exists(CObject* obj)
+{
+    return GetSlot(obj) != -1;
+}
+
+ObjectHandle CObjectRegistry::GetHandle(CObject* obj)
+{
+    ObjectHandle handle;
+    int slot = GetSlot(obj);
+    if (slot == -1) return handle;
+
+    handle.slot       = slot;
+    handle.generation = m_slots[slot].generation;
+    return handle;
+}
+
+CObject* CObjectRegistry::Resolve(const ObjectHandle &handle)
+{
+    if (handle.slot < 0 || handle.slot >= static_cast<int>(m_slots.size())) return nullptr;
+
+    const ObjectSlot& slot = m_slots[handle.slot];
+    if (slot.generation != handle.generation) return nullptr;  // deleted?
+    return slot.object;
+}
+
+CObject* CObjectRegistry::GetFirst(ObjectType type)
+{
+    type = CheckType(type);
+    if (m_typeFirst[type] == -1) return nullptr;
+    return m_slots[m_typeFirst[type]].object;
+}
+
+void CObjectRegistry::List(std::vector<CObject*> &list, ObjectType type)
+{
+    type = CheckType(type);
+    for (int slot = m_typeFirst[type]; slot != -1; slot = m_slots[slot].next)
+        list.push_back(m_slots[slot].object);
+}
+
+void CObjectRegistry::List(std::vector<CObject*> &list, const std::vector<ObjectType> &types)
+{
+    m_mergedSlots.clear();
+    for (ObjectType type : types)
+    {
+        type = CheckType(type);
+        for (int slot = m_typeFirst[type]; slot != -1; slot = m_slots[slot].next)
+            m_mergedSlots.push_back(slot);
+    }
+
+    std::sort(m_mergedSlots.begin(), m_mergedSlots.end(), [this](int a, int b)
+    {
+        return m_slots[a].order < m_slots[b].order;
+    });
+    m_mergedSlots.erase(std::unique(m_mergedSlots.begin(), m_mergedSlots.end()), m_mergedSlots.end());
+
+    for (int slot : m_mergedSlots)
+        list.push_back(m_slots[slot].object);
+}
+
+int CObjectRegistry::GetSlot(CObject* obj)
+{
+    auto it = m_slotByObject.find(obj);
+    if (it == m_slotByObject.end()) return -1;
+    return it->second;
+}
+
+void CObjectRegistry::Link(int slot)
+{
+    ObjectType type = m_slots[slot].type;
+
+    // New objects go to the end, only the ones changing type are inserted in the middle
+    int prev = m_typeLast[type];
+    while (prev != -1 && m_slots[prev].order > m_slots[slot].order)
+        prev = m_slots[prev].prev;
+
+    int next = (prev == -1) ? m_typeFirst[type] : m_slots[prev].next;
+
+    m_slots[slot].prev = prev;
+    m_slots[slot].next = next;
+
+    if (prev == -1)
+        m_typeFirst[type] = slot;
+    else
+        m_slots[prev].next = slot;
+
+    if (next == -1)
+        m_typeLast[type] = slot;
+    else
+        m_slots[next].prev = slot;
+}
+
+void CObjectRegistry::Unlink(int slot)
+{
+    ObjectType type = m_slots[slot].type;
+    int prev = m_slots[slot].prev;
+    int next = m_slots[slot].next;
+
+    if (prev == -1)
+        m_typeFirst[type] = next;
+    else
+        m_slots[prev].next = next;
+
+    if (next == -1)
+        m_typeLast[type] = prev;
+    else
+        m_slots[next].prev = prev;
+
+    m_slots[slot].prev = -1;
+    m_slots[slot].next = -1;
+}
+
@@ -0,0 +1,152 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file object/objregistry.h
+ * \brief Registry of objects - CObjectRegistry class
+ */
+
+#pragma once
+
+
+#include "object/object.h"
+
+#include <unordered_map>
+#include <vector>
+
+
+/**
+ * \struct ObjectHandle
+ * \brief Weak reference to a registered object
+ *
+ * The handle remembers the slot of the object together with the generation
+ * of the slot. The generation changes each time the slot is released, so
+ * a handle to a deleted object never resolves again, even if the slot (or
+ * the memory of the object) was reused in the meantime.
+ */
+struct ObjectHandle
+{
+    //! Slot in the registry, -1 for null handle
+    int             slot;
+    //! Generation of the slot at the time the handle was taken
+    unsigned int    generation;
+
+    ObjectHandle()
+    {
+        slot = -1;
+        generation = 0;
+    }
+
+    bool operator==(const ObjectHandle &other) const
+    {
+        return slot == other.slot && generation == other.generation;
+    }
+
+    bool operator!=(const ObjectHandle &other) const
+    {
+        return !(*this == other);
+    }
+};
+
+/**
+ * \struct ObjectSlot
+ * \brief Slot of one object in CObjectRegistry
+ */
+struct ObjectSlot
+{
+    //! Registered object, nullptr if the slot is free
+    CObject*        object;
+    //! Incremented each time the slot is released
+    unsigned int    generation;
+    //! Unique identifier of the object
+    int             id;
+    //! Type under which the object is listed
+    ObjectType      type;
+    //! Rank of the registration, the objects registered later have higher ones
+    unsigned int    order;
+    //! Neighbours in the list of the type, by order (next is also used by the free list)
+    int             prev, next;
+};
+
+/**
+ * \class CObjectRegistry
+ * \brief Table of registered objects with lookup by pointer, id and type
+ *
+ * Objects are kept in slots which are reused after deletion. Each type has
+ * its own doubly linked list of slots, so the objects of one type can be
+ * listed without looking at the others, and the removal takes constant time.
+ * The lists are kept in the order the objects were registered, whatever
+ * the slots they reuse, as the scripts and the game see them in that order.
+ *
+ * The registry never dereferences objects; their id and type are passed
+ * explicitly and must be updated whenever they change.
+ */
+class CObjectRegistry
+{
+public:
+    CObjectRegistry();
+    ~CObjectRegistry();
+
+    //! Registers an object
+    bool            Add(CObject* obj, int id, ObjectType type);
+    //! Removes an object
+    bool            Remove(CObject* obj);
+    //! Changes the identifier of an object
+    void            SetID(CObject* obj, int id);
+    //! Moves an object to the list of another type
+    void            SetType(CObject* obj, ObjectType type);
+    //! Removes all objects
+    void            Flush();
+
+    //! Returns the number of registered objects
+    int             GetCount();
+
+    //! Returns the object with given identifier
+    CObject*        Find(int id);
+    //! Checks whether the object is registered
+    bool            Exists(CObject* obj);
+
+    //! Returns a handle to the object, or a null handle if it is not registered
+    ObjectHandle    GetHandle(CObject* obj);
+    //! Returns the object referenced by the handle, or nullptr if it was deleted
+    CObject*        Resolve(const ObjectHandle &handle);
+
+    //! Returns the first registered object of given type
+    CObject*        GetFirst(ObjectType type);
+    //! Appends the objects of given type to the list, in the order they were registered
+    void            List(std::vector<CObject*> &list, ObjectType type);
+    //! Appends the objects of any of given types to the list, in the order they were registered
+    void            List(std::vector<CObject*> &list, const std::vector<ObjectType> &types);
+
+protected:
+    //! Returns the slot of the object, or -1
+    int             GetSlot(CObject* obj);
+    //! Inserts the slot in the list of its type, after the ones registered before
+    void            Link(int slot);
+    //! Removes the slot from the list of its type
+    void            Unlink(int slot);
+
+protected:
+    std::vector<ObjectSlot> m_slots;
+    std::unordered_map<CObject*, int> m_slotByObject;
+    std::unordered_map<int, int> m_slotById;
+    int             m_typeFirst[OBJECT_MAX];
+    int             m_typeLast[OBJECT_MAX];
+    int             m_freeSlot;
+    unsigned int    m_nextOrder;
+    std::vector<int> m_mergedSlots;
+};
+
@@ -53,9 +53,12 @@
 #include "object/motion/motion.h"
 #include "object/motion/motionhuman.h"
 #include "object/motion/motiontoto.h"
+#include "object/navgrid.h"
 #include "object/object.h"
+#include "object/objman.h"
 #include "object/task/task.h"
 #include "object/task/taskbuild.h"
+#include "object/task/taskgoto.h"
 #include "object/task/taskmanip.h"
 
 #include "physics/physics.h"
@@ -63,6 +66,7 @@
 #include "script/cbottoken.h"
 #include "script/cmdtoken.h"
 #include "script/script.h"
+#include "script/scriptpool.h"
 
 #include "sound/sound.h"
 
@@ -635,6 +639,13 @@ CRobotMain::CRobotMain(CApplication* app, bool loadProfile)
     m_displayInfo = nullptr;
 
     m_engine->SetTerrain(m_terrain);
+
+    m_navGrid = new CNavGrid();
+    m_navGrid->SetSampler(CTaskGoto::NavSampler, m_terrain);
+    m_terrain->AddChangeListener(CNavGrid::TerrainChanged, m_navGrid);
+
+    m_scriptPool = new CScriptPool();
+
     m_filesDir = m_dialog->GetFilesDir();
 
     m_time = 0.0f;
@@ -909,6 +920,13 @@ CRobotMain::~CRobotMain()
     delete m_interface;
     m_interface = nullptr;
 
+    m_terrain->RemoveChangeListener(CNavGrid::TerrainChanged, m_navGrid);
+    delete m_navGrid;
+    m_navGrid = nullptr;
+
+    delete m_scriptPool;
+    m_scriptPool = nullptr;
+
     delete m_terrain;
     m_terrain = nullptr;
 
@@ -943,6 +961,11 @@ Gfx::CTerrain* CRobotMain::GetTerrain()
     return m_terrain;
 }
 
+CNavGrid* CRobotMain::GetNavGrid()
+{
+    return m_navGrid;
+}
+
 Ui::CInterface* CRobotMain::GetInterface()
 {
     return m_interface;
@@ -1074,6 +1097,12 @@ void CRobotMain::ResetKeyStates()
     m_joyMotion = Math::Vector(0.0f, 0.0f, 0.0f);
 }
 
+//! Returns the current phase
+Phase CRobotMain::GetPhase()
+{
+    return m_phase;
+}
+
 //! Changes phase
 void CRobotMain::ChangePhase(Phase phase)
 {
@@ -2721,32 +2750,34 @@ CObject* CRobotMain::SearchToto()
     return nullptr;
 }
 
+//! Parameters of NearestFilter()
+struct NearestParam
+{
+    CRobotMain* main;
+    CObject*    exclu;
+};
+
 //! Returns the nearest selectable object from a given position
 CObject* CRobotMain::SearchNearest(Math::Vector pos, CObject* exclu)
 {
-    CInstanceManager* iMan = CInstanceManager::GetInstancePointer();
-    float min = 100000.0f;
-    CObject* best = 0;
-    for (int i = 0; i < 1000000; i++)
-    {
-        CObject* obj = static_cast<CObject*>(iMan->SearchInstance(CLASS_OBJECT, i));
-        if (obj == nullptr) break;
+    NearestParam param;
+    param.main  = this;
+    param.exclu = exclu;
+    return CObjectManager::GetInstancePointer()->SearchNearest(pos, 100000.0f, NearestFilter, &param);
+}
 
-        if (obj == exclu) continue;
-        if (!IsSelectable(obj)) continue;
+//! Filter for SearchNearest(): accepts selectable objects other than the excluded one
+bool CRobotMain::NearestFilter(CObject* obj, void* user)
+{
+    NearestParam* param = static_cast<NearestParam*>(user);
 
-        ObjectType type = obj->GetType();
-        if (type == OBJECT_TOTO) continue;
+    if (obj == param->exclu) return false;
+    if (!param->main->IsSelectable(obj)) return false;
 
-        Math::Vector oPos = obj->GetPosition(0);
-        float dist = Math::DistanceProjected(oPos, pos);
-        if (dist < min)
-        {
-            min = dist;
-            best = obj;
-        }
-    }
-    return best;
+    ObjectType type = obj->GetType();
+    if (type == OBJECT_TOTO) return false;
+
+    return true;
 }
 
 //! Returns the selected object
@@ -2766,16 +2797,7 @@ CObject* CRobotMain::GetSelect()
 
 CObject* CRobotMain::SearchObject(ObjectType type)
 {
-    CInstanceManager* iMan = CInstanceManager::GetInstancePointer();
-    for (int i = 0; i < 1000000; i++)
-    {
-        CObject* obj = static_cast<CObject*>(iMan->SearchInstance(CLASS_OBJECT, i));
-        if (obj == nullptr) break;
-
-        if (obj->GetType() == type)
-            return obj;
-    }
-    return nullptr;
+    return CObjectManager::GetInstancePointer()->SearchType(type);
 }
 
 //! Detects the object aimed by the mouse
@@ -3428,6 +3450,23 @@ bool CRobotMain::EventFrame(const Event &event)
     CObject* toto = nullptr;
     if (!m_freePhoto)
     {
+        // Computes the scripts of the robots on all the threads,
+        // each robot continues its own below when it needs the game.
+        if (m_scriptPool->GetThreadCount() > 0 && !m_engine->GetPause())
+        {
+            std::vector<CScript*> scripts;
+            for (int i = 0; i < 1000000; i++)
+            {
+                CObject* obj = static_cast<CObject*>(iMan->SearchInstance(CLASS_OBJECT, i));
+                if (obj == nullptr) break;
+                CBrain* brain = obj->GetBrain();
+                if (brain == nullptr) continue;
+                CScript* script = brain->GetComputeScript();
+                if (script != nullptr) scripts.push_back(script);
+            }
+            m_scriptPool->Compute(scripts);
+        }
+
         // Advances all the robots, but not toto.
         for (int i = 0; i < 1000000; i++)
         {
@@ -3987,6 +4026,9 @@ void CRobotMain::CreateScene(bool soluce, bool fixScene, bool resetObject)
     FILE* file = fopen(filename, "r");
     if (file == NULL) return;
 
+    // The textures of all the objects are decoded together at the end
+    m_engine->SetTextureLoadDeferred(true);
+
     int rankObj = 0;
     int rankGadget = 0;
     CObject* sel = 0;
@@ -4061,7 +4103,7 @@ void CRobotMain::CreateScene(bool soluce, bool fixScene, bool resetObject)
 
             m_immediatSatCom = OpInt(line, "immediat", 0);
             if (m_version >= 2) m_beginSatCom = m_lockedSatCom = OpInt(line, "lock", 0);
-            if (m_app->GetSceneTestMode()) m_immediatSatCom = false;
+            if (m_app->GetSceneTestMode() || m_app->GetHeadless()) m_immediatSatCom = false;
             continue;
         }
 
@@ -5041,6 +5083,8 @@ void CRobotMain::CreateScene(bool soluce, bool fixScene, bool resetObject)
 
     fclose(file);
 
+    m_engine->SetTextureLoadDeferred(false);
+
     if (read[0] == 0)
         CompileScript(soluce);  // compiles all scripts
 
@@ -7105,6 +7149,12 @@ void CRobotMain::UpdateMap()
     m_map->UpdateMap();
 }
 
+//! Updates the map after a change of the terrain between p1 and p2
+void CRobotMain::UpdateMap(const Math::Vector& p1, const Math::Vector& p2)
+{
+    m_map->UpdateMap(p1, p2);
+}
+
 //! Indicates whether the mini-map is visible
 bool CRobotMain::GetShowMap()
 {
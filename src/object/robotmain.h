@@ -74,6 +74,8 @@ enum Phase
 
 class CEventQueue;
 class CSoundInterface;
+class CNavGrid;
+class CScriptPool;
 
 namespace Gfx {
 class CEngine;
@@ -201,6 +203,7 @@ public:
 
     Gfx::CCamera* GetCamera();
     Gfx::CTerrain* GetTerrain();
+    CNavGrid* GetNavGrid();
     Ui::CInterface* GetInterface();
     Ui::CDisplayText* GetDisplayText();
 
@@ -234,6 +237,7 @@ public:
     void        ResetKeyStates();
 
     void        ChangePhase(Phase phase);
+    Phase       GetPhase();
     bool        ProcessEvent(Event &event);
 
     bool        CreateShortcuts();
@@ -281,6 +285,7 @@ public:
     int         IsObligatoryToken(const char* token);
     bool        IsProhibitedToken(const char* token);
     void        UpdateMap();
+    void        UpdateMap(const Math::Vector& p1, const Math::Vector& p2);
     bool        GetShowMap();
 
     MainMovieType GetMainMovie();
@@ -409,6 +414,7 @@ protected:
     void        KeyCamera(EventType event, unsigned int key);
     void        AbortMovie();
     bool        IsSelectable(CObject* pObj);
+    static bool NearestFilter(CObject* obj, void* user);
     void        SelectOneObject(CObject* pObj, bool displayError=true);
     void        HelpObject();
     bool        DeselectObject();
@@ -435,6 +441,8 @@ protected:
     Gfx::CPlanet*       m_planet;
     Gfx::CLightManager* m_lightMan;
     Gfx::CTerrain*      m_terrain;
+    CNavGrid*           m_navGrid;
+    CScriptPool*        m_scriptPool;
     Gfx::CCamera*       m_camera;
     Ui::CMainDialog*    m_dialog;
     Ui::CMainShort*     m_short;
@@ -21,12 +21,16 @@
 
 #include "common/event.h"
 #include "common/iman.h"
+#include "common/profiler.h"
 
 #include "graphics/engine/terrain.h"
 #include "graphics/engine/water.h"
 
 #include "math/geometry.h"
 
+#include "object/objman.h"
+#include "object/robotmain.h"
+
 #include "physics/physics.h"
 
 #include <string.h>
@@ -34,7 +38,8 @@
 
 const float FLY_DIST_GROUND = 80.0f;    // minimum distance to remain on the ground
 const float FLY_DEF_HEIGHT  = 50.0f;    // default flying height
-const float BM_DIM_STEP     = 5.0f;
+const float BM_DIM_STEP     = NAV_CELL;
+const int   BM_BUDGET       = 2000;     // cells explored per frame
 
 
 
@@ -44,6 +49,8 @@ const float BM_DIM_STEP     = 5.0f;
 CTaskGoto::CTaskGoto(CObject* object) : CTask(object)
 {
     m_bmArray = 0;
+    m_bmGrid = m_main->GetNavGrid();
+    m_bmClass = NAV_WHEELS;
 }
 
 // Object's destructor.
@@ -135,7 +142,8 @@ bool CTaskGoto::EventProcess(const Event &event)
 
         pos = m_object->GetPosition(0);
 
-        if ( m_bmFretObject == 0 )
+        CObject* fret = CObjectManager::GetInstancePointer()->SearchHandle(m_bmFretObject);
+        if ( fret == 0 )
         {
             goal = m_goal;
             dist = 0.0f;
@@ -144,7 +152,7 @@ bool CTaskGoto::EventProcess(const Event &event)
         {
             goal = m_goalObject;
             dist = TAKE_DIST+2.0f;
-            if ( m_bmFretObject->GetType() == OBJECT_BASE )  dist = 12.0f;
+            if ( fret->GetType() == OBJECT_BASE )  dist = 12.0f;
         }
 
         ret = BeamSearch(pos, goal, dist);
@@ -647,7 +655,7 @@ Error CTaskGoto::Start(Math::Vector goal, float altitude,
     m_phase = TGP_ADVANCE;
     m_error = ERR_OK;
     m_try = 0;
-    m_bmFretObject = 0;
+    m_bmFretObject = ObjectHandle();
     m_bmFinalMove = 0.0f;
 
     pos = m_object->GetPosition(0);
@@ -715,7 +723,7 @@ Error CTaskGoto::Start(Math::Vector goal, float altitude,
                 dist = 4.0f;
                 if ( AdjustTarget(target, m_goal, dist) )
                 {
-                    m_bmFretObject = target;  // cargo on the ground
+                    m_bmFretObject = CObjectManager::GetInstancePointer()->GetHandle(target);  // cargo on the ground
                 }
                 else
                 {
@@ -737,7 +745,7 @@ Error CTaskGoto::Start(Math::Vector goal, float altitude,
 
         BeamStart();
 
-        if ( m_bmFretObject == 0 )
+        if ( m_bmFretObject == ObjectHandle() )
         {
             x = static_cast<int>((m_goal.x+1600.0f)/BM_DIM_STEP);
             y = static_cast<int>((m_goal.z+1600.0f)/BM_DIM_STEP);
@@ -1679,6 +1687,9 @@ void CTaskGoto::BeamStart()
 {
     Math::Vector    min, max;
 
+    CProfileZone zone("CTaskGoto::BeamStart", m_object->GetID());
+
+    m_bmClass = GetNavClass();
     BitmapOpen();
     BitmapObject();
 
@@ -1710,12 +1721,6 @@ void CTaskGoto::BeamStart()
 
 void CTaskGoto::BeamInit()
 {
-    int     i;
-
-    for ( i=0 ; i<MAXPOINTS ; i++ )
-    {
-        m_bmIter[i] = -1;
-    }
     m_bmStep = 0;
 }
 
@@ -1723,122 +1728,99 @@ void CTaskGoto::BeamInit()
 // Returns:
 // ERR_OK if it's good
 // ERR_GOTO_IMPOSSIBLE if impossible
-// ERR_GOTO_ITER if aborts because too many recursions
+// ERR_GOTO_ITER if aborts because too many cells were explored
 // ERR_CONTINUE if not done yet
 // goalRadius: distance at which we must approach the goal
 
 Error CTaskGoto::BeamSearch(const Math::Vector &start, const Math::Vector &goal,
                             float goalRadius)
 {
-    float     step, len;
-    int       nbIter;
+    Math::IntPoint  s, g;
+    Error       ret;
+
+    CProfileZone zone("CTaskGoto::BeamSearch", m_object->GetID());
 
     m_bmStep ++;
 
-    len = Math::DistanceProjected(start, goal);
-    step = len/5.0f;
-    if ( step < BM_DIM_STEP*2.1f )  step = BM_DIM_STEP*2.1f;
-    if ( step > 20.0f            )  step = 20.0f;
-    nbIter = 200;  // in order not to lower the framerate
-    m_bmIterCounter = 0;
-    return BeamExplore(start, start, goal, goalRadius, 165.0f*Math::PI/180.0f, 22, step, 0, nbIter);
+    if ( m_bmStep == 1 )  // first call?
+    {
+        s.x = static_cast<int>((start.x+1600.0f)/BM_DIM_STEP);
+        s.y = static_cast<int>((start.z+1600.0f)/BM_DIM_STEP);
+        g.x = static_cast<int>((goal.x+1600.0f)/BM_DIM_STEP);
+        g.y = static_cast<int>((goal.z+1600.0f)/BM_DIM_STEP);
+        m_bmPlanner.Start(m_bmSize, s, g, goalRadius/BM_DIM_STEP, BeamBlocked, this);
+    }
+
+    ret = m_bmPlanner.Step(BM_BUDGET);  // in order not to lower the framerate
+    if ( ret != ERR_OK )  return ret;
+
+    return BeamPath(start, goal, goalRadius);
 }
 
-// prevPos: previous position
-// curPos:  current position
-// goalPos: position that seeks to achieve
-// angle:   angle to the goal we explores
-// nbDiv:   number of subdivisions being done with angle
-// step     length of a step
-// i        number of recursions made
-// nbIter   maximum number of iterations you have the right to make before temporarily interrupt
-
-Error CTaskGoto::BeamExplore(const Math::Vector &prevPos, const Math::Vector &curPos,
-                             const Math::Vector &goalPos, float goalRadius,
-                             float angle, int nbDiv, float step,
-                             int i, int nbIter)
-{
-    Math::Vector    newPos;
-    Error       ret;
-    int         iDiv, iClear, iLar;
+// Converts the cells found by the planner into points,
+// skipping the cells which can be reached in a straight line.
 
-    iLar = 0;
-    if ( i >= MAXPOINTS )  return ERR_GOTO_ITER;  // too many recursions
+Error CTaskGoto::BeamPath(const Math::Vector &start, const Math::Vector &goal,
+                          float goalRadius)
+{
+    const std::vector<Math::IntPoint>& path = m_bmPlanner.GetPath();
+    Math::Vector    last, next, final;
+    float       dist;
+    int         i, total;
 
-    if ( m_bmIter[i] == -1 )
+    total = 0;
+    m_bmPoints[0] = start;
+    last = start;
+    for ( i=1 ; i<static_cast<int>(path.size()) ; i++ )
     {
-        m_bmIter[i] = 0;
-
-        if ( i == 0 )
+        if ( i < static_cast<int>(path.size())-1 )
         {
-            m_bmPoints[i] = curPos;
+            next.x = (path[i+1].x+0.5f)*BM_DIM_STEP-1600.0f;
+            next.z = (path[i+1].y+0.5f)*BM_DIM_STEP-1600.0f;
+            next.y = 0.0f;
+            if ( BitmapTestLine(last, next, 0.0f, false) )  continue;
         }
-        else
-        {
-            if ( !BitmapTestLine(prevPos, curPos, angle/nbDiv, true) )  return ERR_GOTO_IMPOSSIBLE;
-
-            m_bmPoints[i] = curPos;
 
-            if ( Math::DistanceProjected(curPos, goalPos)-goalRadius <= step )
-            {
-                if ( goalRadius == 0.0f )
-                {
-                    newPos = goalPos;
-                }
-                else
-                {
-                    newPos = BeamPoint(curPos, goalPos, 0, Math::DistanceProjected(curPos, goalPos)-goalRadius);
-                }
-                if ( BitmapTestLine(curPos, newPos, angle/nbDiv, false) )
-                {
-                    m_bmPoints[i+1] = newPos;
-                    m_bmTotal = i+1;
-                    return ERR_OK;
-                }
-            }
-        }
+        if ( total >= MAXPOINTS )  return ERR_GOTO_ITER;
+        last.x = (path[i].x+0.5f)*BM_DIM_STEP-1600.0f;
+        last.z = (path[i].y+0.5f)*BM_DIM_STEP-1600.0f;
+        last.y = 0.0f;
+        m_bmPoints[++total] = last;
     }
 
-    if ( iLar >= m_bmIter[i] )
+    final = goal;
+    if ( goalRadius > 0.0f )
     {
-        newPos = BeamPoint(curPos, goalPos, 0, step);
-        ret = BeamExplore(curPos, newPos, goalPos, goalRadius, angle, nbDiv, step, i+1, nbIter);
-        if ( ret != ERR_GOTO_IMPOSSIBLE )  return ret;
-        m_bmIter[i] = iLar+1;
-        for ( iClear=i+1 ; iClear<=MAXPOINTS ; iClear++ )  m_bmIter[iClear] = -1;
-        m_bmIterCounter ++;
-        if ( m_bmIterCounter >= nbIter )  return ERR_CONTINUE;
+        dist = Math::DistanceProjected(last, goal);
+        final = last;
+        if ( dist > goalRadius )  final = BeamPoint(last, goal, 0.0f, dist-goalRadius);
     }
-    iLar ++;
 
-    for ( iDiv=1 ; iDiv<=nbDiv ; iDiv++ )
+    if ( total == 0 )
+    {
+        m_bmPoints[++total] = final;
+    }
+    else if ( BitmapTestLine(last, final, 0.0f, false) )
     {
-        if ( iLar >= m_bmIter[i] )
+        if ( BitmapTestLine(m_bmPoints[total-1], final, 0.0f, false) )
         {
-            newPos = BeamPoint(curPos, goalPos, angle*iDiv/nbDiv, step);
-            ret = BeamExplore(curPos, newPos, goalPos, goalRadius, angle, nbDiv, step, i+1, nbIter);
-            if ( ret != ERR_GOTO_IMPOSSIBLE )  return ret;
-            m_bmIter[i] = iLar+1;
-            for ( iClear=i+1 ; iClear<=MAXPOINTS ; iClear++ )  m_bmIter[iClear] = -1;
-            m_bmIterCounter ++;
-            if ( m_bmIterCounter >= nbIter )  return ERR_CONTINUE;
+            m_bmPoints[total] = final;  // replaces the center of the last cell
         }
-        iLar ++;
-
-        if ( iLar >= m_bmIter[i] )
+        else if ( total < MAXPOINTS )
         {
-            newPos = BeamPoint(curPos, goalPos, -angle*iDiv/nbDiv, step);
-            ret = BeamExplore(curPos, newPos, goalPos, goalRadius, angle, nbDiv, step, i+1, nbIter);
-            if ( ret != ERR_GOTO_IMPOSSIBLE )  return ret;
-            m_bmIter[i] = iLar+1;
-            for ( iClear=i+1 ; iClear<=MAXPOINTS ; iClear++ )  m_bmIter[iClear] = -1;
-            m_bmIterCounter ++;
-            if ( m_bmIterCounter >= nbIter )  return ERR_CONTINUE;
+            m_bmPoints[++total] = final;
         }
-        iLar ++;
     }
 
-    return ERR_GOTO_IMPOSSIBLE;
+    m_bmTotal = total;
+    return ERR_OK;
+}
+
+// Tests a cell for the planner.
+
+bool CTaskGoto::BeamBlocked(int x, int y, void* user)
+{
+    return static_cast<CTaskGoto*>(user)->BitmapTestDot(0, x, y);
 }
 
 // Is a right "start-goal". Calculates the point located at the distance "step"
@@ -1932,6 +1914,7 @@ void CTaskGoto::BitmapObject()
     int         i, j;
 
     m_object->GetCrashSphere(0, iPos, iRadius);
+    CObject* fret = CObjectManager::GetInstancePointer()->SearchHandle(m_bmFretObject);
 
     CInstanceManager* iMan = CInstanceManager::GetInstancePointer();
 
@@ -1943,7 +1926,7 @@ void CTaskGoto::BitmapObject()
         type = pObj->GetType();
 
         if ( pObj == m_object )  continue;
-        if ( pObj == m_bmFretObject )  continue;
+        if ( pObj == fret )  continue;
         if ( pObj->GetTruck() != 0 )  continue;
 
         h = m_terrain->GetFloorLevel(pObj->GetPosition(0), false);
@@ -1989,11 +1972,7 @@ void CTaskGoto::BitmapTerrain(const Math::Vector &min, const Math::Vector &max)
 
 void CTaskGoto::BitmapTerrain(int minx, int miny, int maxx, int maxy)
 {
-    ObjectType  type;
-    Math::Vector    p;
-    float       aLimit, angle, h;
-    int         x, y;
-    bool        bAcceptWater, bFly;
+    int     x, y;
 
     if ( minx > maxx )  Math::Swap(minx, maxx);
     if ( miny > maxy )  Math::Swap(miny, maxy);
@@ -2011,47 +1990,50 @@ void CTaskGoto::BitmapTerrain(int minx, int miny, int maxx, int maxy)
     if ( minx >= m_bmMinX && maxx <= m_bmMaxX &&
          miny >= m_bmMinY && maxy <= m_bmMaxY )  return;
 
-    aLimit = 20.0f*Math::PI/180.0f;
-    bAcceptWater = false;
-    bFly = false;
-
-    type = m_object->GetType();
-
-    if ( type == OBJECT_MOBILEwa ||
-         type == OBJECT_MOBILEwc ||
-         type == OBJECT_MOBILEws ||
-         type == OBJECT_MOBILEwi ||
-         type == OBJECT_MOBILEwt ||
-         type == OBJECT_MOBILEtg )  // wheels?
+    for ( y=miny ; y<=maxy ; y++ )
     {
-        aLimit = 20.0f*Math::PI/180.0f;
+        for ( x=minx ; x<=maxx ; x++ )
+        {
+            if ( x >= m_bmMinX && x <= m_bmMaxX &&
+                 y >= m_bmMinY && y <= m_bmMaxY )  continue;
+
+            if ( m_bmGrid->IsBlocked(m_bmClass, x, y) )
+            {
+                BitmapSetDot(0, x, y);
+            }
+        }
     }
 
+    m_bmMinX = minx;
+    m_bmMinY = miny;
+    m_bmMaxX = maxx;
+    m_bmMaxY = maxy;  // expanded rectangular area
+}
+
+// Gives the mobility class of the robot.
+
+NavClass CTaskGoto::GetNavClass()
+{
+    ObjectType  type;
+
+    type = m_object->GetType();
+
     if ( type == OBJECT_MOBILEta ||
          type == OBJECT_MOBILEtc ||
          type == OBJECT_MOBILEti ||
-         type == OBJECT_MOBILEts )  // caterpillars?
-    {
-        aLimit = 35.0f*Math::PI/180.0f;
-    }
-
-    if ( type == OBJECT_MOBILErt ||
+         type == OBJECT_MOBILEts ||
+         type == OBJECT_MOBILErt ||
          type == OBJECT_MOBILErc ||
          type == OBJECT_MOBILErr ||
-         type == OBJECT_MOBILErs )  // large caterpillars?
+         type == OBJECT_MOBILErs ||
+         type == OBJECT_MOBILEdr )  // caterpillars?
     {
-        aLimit = 35.0f*Math::PI/180.0f;
+        return NAV_TRACKS;
     }
 
     if ( type == OBJECT_MOBILEsa )  // submarine caterpillars?
     {
-        aLimit = 35.0f*Math::PI/180.0f;
-        bAcceptWater = true;
-    }
-
-    if ( type == OBJECT_MOBILEdr )  // designer caterpillars?
-    {
-        aLimit = 35.0f*Math::PI/180.0f;
+        return NAV_AMPHIBIOUS;
     }
 
     if ( type == OBJECT_MOBILEfa ||
@@ -2060,8 +2042,7 @@ void CTaskGoto::BitmapTerrain(int minx, int miny, int maxx, int maxy)
          type == OBJECT_MOBILEfi ||
          type == OBJECT_MOBILEft )  // flying?
     {
-        aLimit = 15.0f*Math::PI/180.0f;
-        bFly = true;
+        return NAV_FLYING;
     }
 
     if ( type == OBJECT_MOBILEia ||
@@ -2069,52 +2050,51 @@ void CTaskGoto::BitmapTerrain(int minx, int miny, int maxx, int maxy)
          type == OBJECT_MOBILEis ||
          type == OBJECT_MOBILEii )  // insect legs?
     {
-        aLimit = 60.0f*Math::PI/180.0f;
+        return NAV_LEGS;
     }
 
-    for ( y=miny ; y<=maxy ; y++ )
-    {
-        for ( x=minx ; x<=maxx ; x++ )
-        {
-            if ( x >= m_bmMinX && x <= m_bmMaxX &&
-                 y >= m_bmMinY && y <= m_bmMaxY )  continue;
+    return NAV_WHEELS;  // wheels and everything else
+}
 
-            p.x = x*BM_DIM_STEP-1600.0f;
-            p.z = y*BM_DIM_STEP-1600.0f;
+// Tests whether a robot of given class can stand on the terrain.
+// user: the terrain
 
-            if ( bFly )  // flying robot?
-            {
-                h = m_terrain->GetFloorLevel(p, true);
-                if ( h >= m_terrain->GetFlyingMaxHeight()-5.0f )
-                {
-                    BitmapSetDot(0, x, y);
-                }
-                continue;
-            }
+bool CTaskGoto::NavSampler(NavClass cls, const Math::Vector &pos, void* user)
+{
+    Gfx::CTerrain*  terrain = static_cast<Gfx::CTerrain*>(user);
+    Gfx::CWater*    water = Gfx::CEngine::GetInstancePointer()->GetWater();
+    Math::Vector    p;
+    float       aLimit, h;
+    int         i;
 
-            if ( !bAcceptWater )  // not going underwater?
-            {
-                h = m_terrain->GetFloorLevel(p, true);
-                if ( h < m_water->GetLevel()-2.0f )  // under water (*)?
-                {
-//?                 BitmapSetDot(0, x, y);
-                    BitmapSetCircle(p, BM_DIM_STEP*1.0f);
-                    continue;
-                }
-            }
+    if ( cls == NAV_FLYING )  // flying robot?
+    {
+        h = terrain->GetFloorLevel(pos, true);
+        return ( h < terrain->GetFlyingMaxHeight()-5.0f );
+    }
 
-            angle = m_terrain->GetFineSlope(p);
-            if ( angle > aLimit )
-            {
-                BitmapSetDot(0, x, y);
-            }
+    if ( cls != NAV_AMPHIBIOUS )  // not going underwater?
+    {
+        // the cell and its four neighbours must be above water (*)
+        for ( i=0 ; i<5 ; i++ )
+        {
+            p = pos;
+            if ( i == 1 )  p.x -= BM_DIM_STEP;
+            if ( i == 2 )  p.x += BM_DIM_STEP;
+            if ( i == 3 )  p.z -= BM_DIM_STEP;
+            if ( i == 4 )  p.z += BM_DIM_STEP;
+
+            h = terrain->GetFloorLevel(p, true);
+            if ( h < water->GetLevel()-2.0f )  return false;  // under water?
         }
     }
 
-    m_bmMinX = minx;
-    m_bmMinY = miny;
-    m_bmMaxX = maxx;
-    m_bmMaxY = maxy;  // expanded rectangular area
+    aLimit = 20.0f*Math::PI/180.0f;  // wheels
+    if ( cls == NAV_TRACKS     )  aLimit = 35.0f*Math::PI/180.0f;
+    if ( cls == NAV_AMPHIBIOUS )  aLimit = 35.0f*Math::PI/180.0f;
+    if ( cls == NAV_LEGS       )  aLimit = 60.0f*Math::PI/180.0f;
+
+    return ( terrain->GetFineSlope(pos) <= aLimit );
 }
 
 // (*)  Accepts that a robot is 50cm under water, for example Tropica 3!
@@ -19,6 +19,9 @@
 #pragma once
 
 
+#include "object/navgrid.h"
+#include "object/navplanner.h"
+#include "object/objregistry.h"
 #include "object/task/task.h"
 
 #include "math/vector.h"
@@ -81,6 +84,9 @@ public:
     Error       Start(Math::Vector goal, float altitude, TaskGotoGoal goalMode, TaskGotoCrash crashMode);
     Error       IsEnded();
 
+    //! Tests whether a robot of given class can stand on the terrain, see CNavGrid
+    static bool     NavSampler(NavClass cls, const Math::Vector &pos, void* user);
+
 protected:
     CObject*    WormSearch(Math::Vector &impact);
     void        WormFrame(float rTime);
@@ -92,11 +98,14 @@ protected:
     void        ComputeRepulse(Math::Point &dir);
     void        ComputeFlyingRepulse(float &dir);
 
+    NavClass    GetNavClass();
+
     int         BeamShortcut();
     void        BeamStart();
     void        BeamInit();
     Error       BeamSearch(const Math::Vector &start, const Math::Vector &goal, float goalRadius);
-    Error       BeamExplore(const Math::Vector &prevPos, const Math::Vector &curPos, const Math::Vector &goalPos, float goalRadius, float angle, int nbDiv, float step, int i, int nbIter);
+    Error       BeamPath(const Math::Vector &start, const Math::Vector &goal, float goalRadius);
+    static bool BeamBlocked(int x, int y, void* user);
     Math::Vector    BeamPoint(const Math::Vector &startPoint, const Math::Vector &goalPoint, float angle, float step);
 
     void        BitmapDebug(const Math::Vector &min, const Math::Vector &max, const Math::Vector &start, const Math::Vector &goal);
@@ -140,9 +149,10 @@ protected:
     int             m_bmTotal;      // number of points in m_bmPoints
     int             m_bmIndex;      // index in m_bmPoints
     Math::Vector        m_bmPoints[MAXPOINTS+2];
-    char            m_bmIter[MAXPOINTS+2];
-    int             m_bmIterCounter;
-    CObject*        m_bmFretObject;
+    CNavGrid*       m_bmGrid;       // terrain shared by all robots
+    NavClass        m_bmClass;
+    CNavPlanner     m_bmPlanner;
+    ObjectHandle    m_bmFretObject; // cargo on the ground, kept during the search
     float           m_bmFinalMove;  // final advance distance
     float           m_bmFinalDist;  // effective distance to advance
     Math::Vector        m_bmFinalPos;   // initial position before advance
@@ -21,7 +21,7 @@
 
 #include "common/event.h"
 #include "common/global.h"
-#include "common/iman.h"
+#include "common/profiler.h"
 
 #include "graphics/engine/camera.h"
 #include "graphics/engine/engine.h"
@@ -33,6 +33,7 @@
 #include "math/geometry.h"
 
 #include "object/brain.h"
+#include "object/objman.h"
 #include "object/robotmain.h"
 #include "object/motion/motion.h"
 #include "object/motion/motionhuman.h"
@@ -1478,6 +1479,8 @@ bool CPhysics::EventFrame(const Event &event)
     float       h, w;
     int         i;
 
+    CProfileZone zone("CPhysics::EventFrame", m_object->GetID());
+
     if ( m_engine->GetPause() )  return true;
 
     m_time += event.rTime;
@@ -2527,13 +2530,17 @@ int CPhysics::ObjectAdapt(const Math::Vector &pos, const Math::Vector &angle)
     iPos = iiPos + (pos - m_object->GetPosition(0));
     iType = m_object->GetType();
 
-    CInstanceManager* iMan = CInstanceManager::GetInstancePointer();
+    // Only the objects close enough to collide, to be jostled
+    // or to be passed through (waypoints and targets) are tested.
+    CObjectManager* objMan = CObjectManager::GetInstancePointer();
+    objMan->SearchRadius(m_nearObjects, iPos, Math::Max(iRad, 10.0f*1.5f));
 
-    for ( i=0 ; i<1000000 ; i++ )
+    for ( i=0 ; i<static_cast<int>(m_nearObjects.size()) ; i++ )
     {
-        pObj = static_cast<CObject*>(iMan->SearchInstance(CLASS_OBJECT, i));
-        if ( pObj == 0 )  break;
-
+        // An explosion caused by a previous object of the list
+        // may have deleted the next ones (its power cell, its cargo).
+        pObj = objMan->SearchHandle(m_nearObjects[i]);
+        if ( pObj == 0 )  continue;  // deleted?
         if ( pObj == m_object )  continue;  // yourself?
         if ( pObj->GetTruck() != 0 )  continue;  // object transported?
         if ( !pObj->GetEnable() )  continue;  // inactive?
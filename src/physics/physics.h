@@ -26,9 +26,12 @@
 #include "common/global.h"
 
 #include "object/object.h"
+#include "object/objregistry.h"
 
 #include "math/vector.h"
 
+#include <vector>
+
 
 class CObject;
 class CBrain;
@@ -226,6 +229,7 @@ protected:
     bool        m_bObstacle;
     bool        m_bFreeze;
     int         m_repeatCollision;
+    std::vector<ObjectHandle> m_nearObjects;  // candidates for collisions
     float       m_linVibrationFactor;
     float       m_cirVibrationFactor;
     float       m_inclinaisonFactor;
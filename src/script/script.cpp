@@ -22,6 +22,7 @@
 
 #include "common/global.h"
 #include "common/iman.h"
+#include "common/profiler.h"
 #include "common/restext.h"
 #include "common/stringutils.h"
 
@@ -1058,27 +1059,115 @@ CBotTypResult CScript::cSearch(CBotVar* &var, void* user)
     return CBotTypResult(CBotTypPointer, "object");
 }
 
+// Parameters of instruction "search", used by SearchFilter.
+
+struct SearchParam
+{
+    CBotVar*    array;
+    bool        bArray;
+    int         type;
+};
+
+// Checks whether an object is one of those sought by "search".
+
+bool SearchFilter(CObject* pObj, void* user)
+{
+    SearchParam* param = static_cast<SearchParam*>(user);
+    int         oType;
+
+    if ( pObj->GetTruck() != 0 )  return false;  // object transported?
+    if ( !pObj->GetActif() )  return false;
+
+    oType = pObj->GetType();
+    if ( oType == OBJECT_TOTO )  return false;
+
+    if ( oType == OBJECT_RUINmobilew2 ||
+         oType == OBJECT_RUINmobilet1 ||
+         oType == OBJECT_RUINmobilet2 ||
+         oType == OBJECT_RUINmobiler1 ||
+         oType == OBJECT_RUINmobiler2 )
+    {
+        oType = OBJECT_RUINmobilew1;  // any ruin
+    }
+
+    if ( oType == OBJECT_SCRAP2 ||
+         oType == OBJECT_SCRAP3 ||
+         oType == OBJECT_SCRAP4 ||
+         oType == OBJECT_SCRAP5 )  // wastes?
+    {
+        oType = OBJECT_SCRAP1;  // any waste
+    }
+
+    if ( oType == OBJECT_BARRIER2 ||
+         oType == OBJECT_BARRIER3 )  // barriers?
+    {
+        oType = OBJECT_BARRIER1;  // any barrier
+    }
+
+    if ( param->bArray )
+    {
+        return FindList(param->array, oType);
+    }
+    return ( param->type == oType || param->type == OBJECT_NULL );
+}
+
+// Lists the candidates of "search" or "radar" looking for one type,
+// without looking at objects of other types. The objects come in the
+// order they were created, as when all the objects are looked at.
+
+void SearchTypes(std::vector<CObject*> &list, int type)
+{
+    static const std::vector<ObjectType> ruins = { OBJECT_RUINmobilew1, OBJECT_RUINmobilew2,
+                                                   OBJECT_RUINmobilet1, OBJECT_RUINmobilet2,
+                                                   OBJECT_RUINmobiler1, OBJECT_RUINmobiler2 };
+    static const std::vector<ObjectType> scraps = { OBJECT_SCRAP1, OBJECT_SCRAP2, OBJECT_SCRAP3,
+                                                    OBJECT_SCRAP4, OBJECT_SCRAP5 };
+    static const std::vector<ObjectType> barriers = { OBJECT_BARRIER1, OBJECT_BARRIER2, OBJECT_BARRIER3 };
+
+    CObjectManager* objMan = CObjectManager::GetInstancePointer();
+
+    list.clear();
+    if ( type == OBJECT_RUINmobilew1 )  // any ruin?
+    {
+        objMan->SearchType(list, ruins);
+    }
+    else if ( type == OBJECT_SCRAP1 )  // any waste?
+    {
+        objMan->SearchType(list, scraps);
+    }
+    else if ( type == OBJECT_BARRIER1 )  // any barrier?
+    {
+        objMan->SearchType(list, barriers);
+    }
+    else if ( type > OBJECT_NULL && type < OBJECT_MAX )
+    {
+        objMan->SearchType(list, static_cast<ObjectType>(type));
+    }
+}
+
 // Instruction "search(type, pos)".
 
 bool CScript::rSearch(CBotVar* var, CBotVar* result, int& exception, void* user)
 {
     CObject     *pObj, *pBest;
-    CBotVar*    array;
-    Math::Vector    pos, oPos;
-    bool        bNearest = false;
-    bool        bArray;
+    SearchParam param;
+    Math::Vector    pos;
     float       min, dist;
-    int         type, oType, i;
+    bool        bNearest = false;
+    int         i;
+
+    param.array  = 0;
+    param.type   = OBJECT_NULL;
+    param.bArray = false;
 
     if ( var->GetType() == CBotTypArrayPointer )
     {
-        array = var->GetItemList();
-        bArray = true;
+        param.array = var->GetItemList();
+        param.bArray = true;
     }
     else
     {
-        type = var->GetValInt();
-        bArray = false;
+        param.type = var->GetValInt();
     }
     var = var->GetNext();
     if ( var != 0 )
@@ -1087,67 +1176,50 @@ bool CScript::rSearch(CBotVar* var, CBotVar* result, int& exception, void* user)
         bNearest = true;
     }
 
-    CInstanceManager* iMan = CInstanceManager::GetInstancePointer();
-
-    min = 100000.0f;
     pBest = 0;
-    for ( i=0 ; i<1000000 ; i++ )
+    if ( !param.bArray && param.type != OBJECT_NULL )  // only one type?
     {
-        pObj = static_cast<CObject*>(iMan->SearchInstance(CLASS_OBJECT, i));
-        if ( pObj == 0 )  break;
-
-        if ( pObj->GetTruck() != 0 )  continue;  // object transported?
-        if ( !pObj->GetActif() )  continue;
-
-        oType = pObj->GetType();
-        if ( oType == OBJECT_TOTO )  continue;
+        std::vector<CObject*> list;
+        SearchTypes(list, param.type);
 
-        if ( oType == OBJECT_RUINmobilew2 ||
-             oType == OBJECT_RUINmobilet1 ||
-             oType == OBJECT_RUINmobilet2 ||
-             oType == OBJECT_RUINmobiler1 ||
-             oType == OBJECT_RUINmobiler2 )
+        min = 100000.0f;
+        for ( i=0 ; i<static_cast<int>(list.size()) ; i++ )
         {
-            oType = OBJECT_RUINmobilew1;  // any ruin
-        }
-
-        if ( oType == OBJECT_SCRAP2 ||
-             oType == OBJECT_SCRAP3 ||
-             oType == OBJECT_SCRAP4 ||
-             oType == OBJECT_SCRAP5 )  // wastes?
-        {
-            oType = OBJECT_SCRAP1;  // any waste
-        }
-
-        if ( oType == OBJECT_BARRIER2 ||
-             oType == OBJECT_BARRIER3 )  // barriers?
-        {
-            oType = OBJECT_BARRIER1;  // any barrier
-        }
+            pObj = list[i];
+            if ( !SearchFilter(pObj, &param) )  continue;
 
-        if ( bArray )
-        {
-            if ( !FindList(array, oType) )  continue;
-        }
-        else
-        {
-            if ( type != oType && type != OBJECT_NULL )  continue;
-        }
+            if ( !bNearest )
+            {
+                pBest = pObj;
+                break;
+            }
 
-        if ( bNearest )
-        {
-            oPos = pObj->GetPosition(0);
-            dist = Math::DistanceProjected(pos, oPos);
+            dist = Math::DistanceProjected(pos, pObj->GetPosition(0));
             if ( dist < min )
             {
                 min = dist;
                 pBest = pObj;
             }
         }
-        else
+    }
+    else if ( bNearest )
+    {
+        pBest = CObjectManager::GetInstancePointer()->SearchNearest(pos, 100000.0f, SearchFilter, &param);
+    }
+    else
+    {
+        CInstanceManager* iMan = CInstanceManager::GetInstancePointer();
+
+        for ( i=0 ; i<1000000 ; i++ )
         {
-            pBest = pObj;
-            break;
+            pObj = static_cast<CObject*>(iMan->SearchInstance(CLASS_OBJECT, i));
+            if ( pObj == 0 )  break;
+
+            if ( SearchFilter(pObj, &param) )
+            {
+                pBest = pObj;
+                break;
+            }
         }
     }
 
@@ -1277,15 +1349,22 @@ bool CScript::rRadar(CBotVar* var, CBotVar* result, int& exception, void* user)
     iAngle = pThis->GetAngleY(0)+angle;
     iAngle = Math::NormAngle(iAngle);  // 0..2*Math::PI
 
-    CInstanceManager* iMan = CInstanceManager::GetInstancePointer();
+    std::vector<CObject*> list;
+    if ( !bArray && type != OBJECT_NULL )  // only one type?
+    {
+        SearchTypes(list, type);
+    }
+    else
+    {
+        CObjectManager::GetInstancePointer()->SearchCone(list, iPos, iAngle, focus, minDist, maxDist);
+    }
 
     if ( sens >= 0.0f )  best = 100000.0f;
     else                 best = 0.0f;
     pBest = 0;
-    for ( i=0 ; i<1000000 ; i++ )
+    for ( i=0 ; i<static_cast<int>(list.size()) ; i++ )
     {
-        pObj = static_cast<CObject*>(iMan->SearchInstance(CLASS_OBJECT, i));
-        if ( pObj == 0 )  break;
+        pObj = list[i];
         if ( pObj == pThis )  continue;
 
         if ( pObj->GetTruck() != 0 )  continue;  // object transported?
@@ -1342,27 +1421,17 @@ bool CScript::rRadar(CBotVar* var, CBotVar* result, int& exception, void* user)
         d = Math::DistanceProjected(iPos, oPos);
         if ( d < minDist || d > maxDist )  continue;  // too close or too far?
 
-        if ( focus >= Math::PI*2.0f )
+        if ( focus < Math::PI*2.0f )
         {
-            if ( (sens >= 0.0f && d < best) ||
-                 (sens <  0.0f && d > best) )
-            {
-                best = d;
-                pBest = pObj;
-            }
-            continue;
+            a = Math::RotateAngle(oPos.x-iPos.x, iPos.z-oPos.z);  // CW !
+            if ( !Math::TestAngle(a, iAngle-focus/2.0f, iAngle+focus/2.0f) )  continue;
         }
 
-        a = Math::RotateAngle(oPos.x-iPos.x, iPos.z-oPos.z);  // CW !
-        //TODO uninitialized variable
-        if ( Math::TestAngle(a, iAngle-focus/2.0f, iAngle+focus/2.0f) )
+        if ( (sens >= 0.0f && d < best) ||
+             (sens <  0.0f && d > best) )
         {
-            if ( (sens >= 0.0f && d < best) ||
-                 (sens <  0.0f && d > best) )
-            {
-                best = d;
-                pBest = pObj;
-            }
+            best = d;
+            pBest = pObj;
         }
     }
 
@@ -3498,6 +3567,8 @@ CScript::CScript(CObject* object, CTaskManager** secondaryTask)
     m_script = nullptr;
     m_bRun = false;
     m_bStepMode = false;
+    m_bComputed = false;
+    m_bComputeEnd = false;
     m_bCompile = false;
     m_title[0] = 0;
     m_cursor1 = 0;
@@ -3509,16 +3580,16 @@ CScript::CScript(CObject* object, CTaskManager** secondaryTask)
 
 void CScript::InitFonctions()
 {
-    CBotProgram::AddFunction("sin",       rSin,       CScript::cOneFloat);
-    CBotProgram::AddFunction("cos",       rCos,       CScript::cOneFloat);
-    CBotProgram::AddFunction("tan",       rTan,       CScript::cOneFloat);
-    CBotProgram::AddFunction("asin",      raSin,      CScript::cOneFloat);
-    CBotProgram::AddFunction("acos",      raCos,      CScript::cOneFloat);
-    CBotProgram::AddFunction("atan",      raTan,      CScript::cOneFloat);
-    CBotProgram::AddFunction("sqrt",      rSqrt,      CScript::cOneFloat);
-    CBotProgram::AddFunction("pow",       rPow,       CScript::cTwoFloat);
+    CBotProgram::AddFunction("sin",       rSin,       CScript::cOneFloat, true);
+    CBotProgram::AddFunction("cos",       rCos,       CScript::cOneFloat, true);
+    CBotProgram::AddFunction("tan",       rTan,       CScript::cOneFloat, true);
+    CBotProgram::AddFunction("asin",      raSin,      CScript::cOneFloat, true);
+    CBotProgram::AddFunction("acos",      raCos,      CScript::cOneFloat, true);
+    CBotProgram::AddFunction("atan",      raTan,      CScript::cOneFloat, true);
+    CBotProgram::AddFunction("sqrt",      rSqrt,      CScript::cOneFloat, true);
+    CBotProgram::AddFunction("pow",       rPow,       CScript::cTwoFloat, true);
     CBotProgram::AddFunction("rand",      rRand,      CScript::cNull);
-    CBotProgram::AddFunction("abs",       rAbs,       CScript::cOneFloat);
+    CBotProgram::AddFunction("abs",       rAbs,       CScript::cOneFloat, true);
 
     CBotProgram::AddFunction("endmission",rEndMission,CScript::cEndMission);
     CBotProgram::AddFunction("playmusic", rPlayMusic ,CScript::cPlayMusic);
@@ -3768,7 +3839,9 @@ bool CScript::Compile()
         m_botProg = new CBotProgram(m_object->GetBotVar());
     }
 
-    if ( m_botProg->Compile(m_script, liste, this) )
+    // The robots running the same program share its instructions;
+    // the compilation of some functions depends on the type of robot
+    if ( m_botProg->CompileShared(m_script, liste, this, m_object->GetType()) )
     {
         if ( liste.GetSize() == 0 )
         {
@@ -3843,6 +3916,7 @@ bool CScript::Run()
     m_object->SetRunScript(this);
     m_bRun = true;
     m_bContinue = false;
+    m_bComputed = false;
     m_ipf = CBOT_IPF;
     m_errMode = ERM_STOP;
 
@@ -3856,6 +3930,22 @@ bool CScript::Run()
     return true;
 }
 
+// Runs the slice of instructions of this frame, possibly on another
+// thread (see CScriptPool), until the program needs the game.
+// Continue() goes on from there.
+
+void CScript::Compute()
+{
+    if ( m_botProg == 0 )  return;
+    if ( !m_bRun || m_bStepMode )  return;
+    if ( m_bComputed )  return;  // not continued since
+
+    CProfileZone zone("CScript::Compute", m_object->GetID());
+
+    m_bComputeEnd = m_botProg->RunCompute(m_object, m_ipf);
+    m_bComputed = true;
+}
+
 // Continues the execution of current program.
 // Returns true when execution is finished.
 
@@ -3864,6 +3954,8 @@ bool CScript::Continue(const Event &event)
     if( m_botProg == 0 )  return true;
     if ( !m_bRun )  return true;
 
+    CProfileZone zone("CScript::Continue", m_object->GetID());
+
     m_event = event;
 
     if ( m_bStepMode )  // step by step mode?
@@ -3903,7 +3995,22 @@ bool CScript::Continue(const Event &event)
         return false;
     }
 
-    if ( m_botProg->Run(m_object, m_ipf) )
+    bool    bEnd;
+    if ( m_bComputed )  // slice already run by Compute()?
+    {
+        m_bComputed = false;
+        bEnd = m_bComputeEnd;
+        if ( !bEnd && m_botProg->IsWaiting() )  // stopped before the game?
+        {
+            bEnd = m_botProg->Run(m_object, m_ipf);
+        }
+    }
+    else
+    {
+        bEnd = m_botProg->Run(m_object, m_ipf);
+    }
+
+    if ( bEnd )
     {
         m_botProg->GetError(m_error, m_cursor1, m_cursor2);
         if ( m_cursor1 < 0 || m_cursor1 > m_len ||
@@ -3986,6 +4093,7 @@ void CScript::Stop()
     {
         m_botProg->Stop();
     }
+    m_bComputed = false;
 
     if ( m_primaryTask != 0 )
     {
@@ -4163,23 +4271,37 @@ void CScript::UpdateList(Ui::CList* list)
 
 void CScript::ColorizeScript(Ui::CEdit* edit)
 {
-    CBotToken*  bt;
-    CBotString  bs;
-    const char* token;
-    int         error, type, cursor1, cursor2;
+    std::string word;
+    const char* text;
+    int         first, last, i, type, cursor1, cursor2;
     Gfx::FontHighlight color;
 
-    edit->ClearFormat();
+    // only the tokens around the last changes are cut again,
+    // all are colored if the text was replaced
+    text = edit->GetText();
+    m_tokens.Update(text, first, last);
 
-    bt = CBotToken::CompileTokens(edit->GetText(), error);
-    while ( bt != 0 )
+    if ( edit->GetFormatLost() )
     {
-        bs = bt->GetString();
-        token = bs;
-        type = bt->GetType();
+        edit->ClearFormat();
+        first = 0;
+        last  = m_tokens.GetSize();
+    }
+    else
+    {
+        if ( first == last )  return;
+        cursor1 = m_tokens.GetSpan(first).start;
+        cursor2 = ( last < m_tokens.GetSize() ) ? m_tokens.GetSpan(last).start : edit->GetTextLength();
+        edit->ClearFormat(cursor1, cursor2);
+    }
 
-        cursor1 = bt->GetStart();
-        cursor2 = bt->GetEnd();
+    for ( i=first ; i<last ; i++ )
+    {
+        const CBotTokenSpan& span = m_tokens.GetSpan(i);
+        type = span.type;
+
+        cursor1 = span.start;
+        cursor2 = span.end;
         color = Gfx::FONT_HIGHLIGHT_NONE;
         if ( type >= TokenKeyWord && type < TokenKeyWord+100 )
         {
@@ -4195,11 +4317,12 @@ void CScript::ColorizeScript(Ui::CEdit* edit)
         }
         if ( type == TokenTypVar )
         {
-            if ( IsType(token) )
+            word.assign(text+cursor1, cursor2-cursor1);
+            if ( IsType(word.c_str()) )
             {
                 color = Gfx::FONT_HIGHLIGHT_TYPE;
             }
-            else if ( IsFunction(token) )
+            else if ( IsFunction(word.c_str()) )
             {
                 color = Gfx::FONT_HIGHLIGHT_TOKEN;
             }
@@ -4213,11 +4336,7 @@ void CScript::ColorizeScript(Ui::CEdit* edit)
         {
             edit->SetFormat(cursor1, cursor2, color);
         }
-
-        bt = bt->GetNext();
     }
-
-    CBotToken::Delete(bt);
 }
 
 
@@ -4576,6 +4695,7 @@ bool CScript::ReadStack(FILE *file)
     m_object->SetRunScript(this);
     m_bRun = true;
     m_bContinue = false;
+    m_bComputed = false;
     return true;
 }
 
@@ -67,6 +67,7 @@ public:
 
     void        SetStepMode(bool bStep);
     bool        Run();
+    void        Compute();
     bool        Continue(const Event &event);
     bool        Step(const Event &event);
     void        Stop();
@@ -233,6 +234,8 @@ protected:
     bool    m_bRun;         // program during execution?
     bool    m_bStepMode;        // step by step
     bool    m_bContinue;        // external function to continue
+    bool    m_bComputed;        // slice of this frame run by Compute()?
+    bool    m_bComputeEnd;      // program ended in Compute()?
     bool    m_bCompile;     // compilation ok?
     char    m_title[50];        // script title
     char    m_filename[50];     // file name
@@ -242,5 +245,6 @@ protected:
     int     m_cursor2;
     Event   m_event;
     float   m_returnValue;
+    CBotTokenList m_tokens;     // tokens of the text being edited, for its colors
 };
 
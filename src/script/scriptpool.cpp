@@ -0,0 +1,116 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+
+#include "script/scriptpool.h"
+
+#include "common/profiler.h"
+
+#include "script/script.h"
+
+
+CScriptPool::CScriptPool(int threads)
+{
+    m_scripts = nullptr;
+    m_next = 0;
+    m_busy = 0;
+    m_frame = 0;
+    m_quit = false;
+
+    if (threads < 0)
+        threads = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+
+    for (int i = 0; i < threads; i++)
+        m_threads.push_back(std::thread(&CScriptPool::Work, this));
+}
+
+CScriptPool::~CScriptPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_start.notify_all();
+
+    for (auto &thread : m_threads)
+        thread.join();
+}
+
+int CScriptPool::GetThreadCount()
+{
+    return m_threads.size();
+}
+
+void CScriptPool::Compute(const std::vector<CScript*> &scripts)
+{
+    if (m_threads.empty() || scripts.size() < 2)
+    {
+        for (CScript* script : scripts)
+            script->Compute();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_scripts = &scripts;
+        m_next = 0;
+        m_busy = m_threads.size();
+        m_frame++;
+    }
+    m_start.notify_all();
+
+    ComputeNext();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busy == 0; });
+    m_scripts = nullptr;
+}
+
+void CScriptPool::Work()
+{
+    if (CProfiler::IsEnabled())
+        CProfiler::GetInstancePointer()->SetThreadName("Script worker");
+
+    unsigned int frame = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start.wait(lock, [this, frame] { return m_quit || m_frame != frame; });
+            if (m_quit) return;
+            frame = m_frame;
+        }
+
+        ComputeNext();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busy--;
+        }
+        m_done.notify_one();
+    }
+}
+
+void CScriptPool::ComputeNext()
+{
+    int count = m_scripts->size();
+    while (true)
+    {
+        int i = m_next++;
+        if (i >= count) break;
+        (*m_scripts)[i]->Compute();
+    }
+}
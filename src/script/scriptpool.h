@@ -0,0 +1,78 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file script/scriptpool.h
+ * \brief Threads computing the scripts of the robots - CScriptPool class
+ */
+
+#pragma once
+
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+class CScript;
+
+/**
+ * \class CScriptPool
+ * \brief Runs the slices of the scripts of one frame on several threads
+ *
+ * Before the objects process the frame, Compute() gives every running
+ * script to CScript::Compute() on the threads of the pool and on the main
+ * thread. The programs compute until they need the game (external
+ * function, field of an object, ...); CScript::Continue(), called by the
+ * robot as before, then goes on from there on the main thread, in the
+ * same order and with the same number of instructions as without the pool.
+ */
+class CScriptPool
+{
+public:
+    //! Creates \a threads threads besides the main one; -1 for one less than the number of cores
+    CScriptPool(int threads = -1);
+    ~CScriptPool();
+
+    //! Returns the number of threads besides the main one, 0 if the pool does nothing
+    int         GetThreadCount();
+
+    //! Computes the scripts on all threads, returns when all are done
+    void        Compute(const std::vector<CScript*> &scripts);
+
+protected:
+    //! Loop of the threads of the pool
+    void        Work();
+    //! Computes scripts until none is left
+    void        ComputeNext();
+
+protected:
+    std::vector<std::thread>    m_threads;
+    std::mutex                  m_mutex;
+    std::condition_variable     m_start;
+    std::condition_variable     m_done;
+    //! Scripts of the current frame
+    const std::vector<CScript*>* m_scripts;
+    //! Index of the next script to compute
+    std::atomic<int>            m_next;
+    //! Number of threads of the pool still computing
+    int                         m_busy;
+    //! Incremented for each frame, wakes the threads
+    unsigned int                m_frame;
+    bool                        m_quit;
+};
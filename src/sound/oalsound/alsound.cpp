@@ -25,6 +25,11 @@
 
 #include <boost/filesystem.hpp>
 
+
+//! Memory for decoded sounds, the least recently played are unloaded past it
+const size_t SOUND_CACHE_SIZE = 16 * 1024 * 1024;
+
+
 ALSound::ALSound()
 {
     m_enabled = false;
@@ -36,6 +41,7 @@ ALSound::ALSound()
     m_previousMusic.fadeTime = 0.0f;
     m_previousMusic.music = nullptr;
     m_channels_limit = 2048;
+    m_soundMemory = 0;
 }
 
 
@@ -78,10 +84,9 @@ void ALSound::CleanUp()
             delete item.second;
         }
 
-        for (auto item : m_music)
-        {
-            delete item.second;
-        }
+        m_sounds.clear();
+        m_soundUse.clear();
+        m_soundMemory = 0;
 
         m_enabled = false;
 
@@ -164,27 +169,97 @@ int ALSound::GetMusicVolume()
 
 bool ALSound::Cache(Sound sound, const std::string &filename)
 {
-    Buffer *buffer = new Buffer();
-    if (buffer->LoadFromFile(CGameData::GetInstancePointer()->GetFilePath(DIR_SOUND, filename), sound))
+    std::string file = CGameData::GetInstancePointer()->GetFilePath(DIR_SOUND, filename);
+    m_soundFiles[sound] = file;
+
+    // Past the limit, sounds are only loaded when played
+    if (m_soundMemory >= SOUND_CACHE_SIZE)
     {
-        m_sounds[sound] = buffer;
-        return true;
+        return boost::filesystem::exists(file);
     }
-    return false;
+
+    return GetSound(sound) != nullptr;
 }
 
 bool ALSound::CacheMusic(const std::string &filename)
 {
-    if (m_music.find(filename) == m_music.end())
+    // Music is streamed when played, nothing is decoded in advance
+    return boost::filesystem::exists(CGameData::GetInstancePointer()->GetFilePath(DIR_MUSIC, filename));
+}
+
+
+Buffer* ALSound::GetSound(Sound sound)
+{
+    auto it = m_sounds.find(sound);
+    if (it != m_sounds.end())
     {
-        Buffer *buffer = new Buffer();
-        if (buffer->LoadFromFile(CGameData::GetInstancePointer()->GetFilePath(DIR_MUSIC, filename), static_cast<Sound>(-1)))
+        m_soundUse.remove(sound);
+        m_soundUse.push_front(sound);
+        return it->second;
+    }
+
+    auto file = m_soundFiles.find(sound);
+    if (file == m_soundFiles.end())
+    {
+        return nullptr;
+    }
+
+    Buffer *buffer = new Buffer();
+    if (!buffer->LoadFromFile(file->second, sound))
+    {
+        delete buffer;
+        return nullptr;
+    }
+
+    m_sounds[sound] = buffer;
+    m_soundUse.push_front(sound);
+    m_soundMemory += buffer->GetSize();
+    EvictSounds(sound);
+    return buffer;
+}
+
+
+void ALSound::EvictSounds(Sound keep)
+{
+    auto it = m_soundUse.end();
+    while (m_soundMemory > SOUND_CACHE_SIZE && it != m_soundUse.begin())
+    {
+        --it;
+        Sound sound = *it;
+        if (sound == keep)
         {
-            m_music[filename] = buffer;
-            return true;
+            continue;
         }
+
+        bool playing = false;
+        for (auto channel : m_channels)
+        {
+            if (channel.second->GetSoundType() == sound && channel.second->IsPlaying())
+            {
+                playing = true;
+                break;
+            }
+        }
+        if (playing)
+        {
+            continue;
+        }
+
+        for (auto channel : m_channels)
+        {
+            if (channel.second->GetSoundType() == sound)
+            {
+                channel.second->SetBuffer(nullptr);
+            }
+        }
+
+        GetLogger()->Trace("Unloading sound %d\n", sound);
+        Buffer *buffer = m_sounds[sound];
+        m_soundMemory -= buffer->GetSize();
+        m_sounds.erase(sound);
+        delete buffer;
+        it = m_soundUse.erase(it);
     }
-    return false;
 }
 
 int ALSound::GetPriority(Sound sound)
@@ -344,7 +419,8 @@ int ALSound::Play(Sound sound, const Math::Vector &pos, float amplitude, float f
     {
         return -1;
     }
-    if (m_sounds.find(sound) == m_sounds.end())
+    Buffer *buffer = GetSound(sound);
+    if (buffer == nullptr)
     {
         GetLogger()->Debug("Sound %d was not loaded!\n", sound);
         return -1;
@@ -359,7 +435,7 @@ int ALSound::Play(Sound sound, const Math::Vector &pos, float amplitude, float f
 
     if (!bAlreadyLoaded)
     {
-        if (!m_channels[channel]->SetBuffer(m_sounds[sound]))
+        if (!m_channels[channel]->SetBuffer(buffer))
         {
             m_channels[channel]->SetBuffer(nullptr);
             return -1;
@@ -562,6 +638,11 @@ void ALSound::FrameMove(float delta)
         }
     }
     
+    if (m_currentMusic)
+    {
+        m_currentMusic->Update();
+    }
+
     std::list<OldMusic> toRemove;
     
     for (auto& it : m_oldMusic)
@@ -575,6 +656,7 @@ void ALSound::FrameMove(float delta)
         {
             it.currentTime += delta;
             it.music->SetVolume(((it.fadeTime-it.currentTime) / it.fadeTime) * m_musicVolume);
+            it.music->Update();
         }
     }
     
@@ -587,6 +669,7 @@ void ALSound::FrameMove(float delta)
         {
             m_previousMusic.currentTime += delta;
             m_previousMusic.music->SetVolume(((m_previousMusic.fadeTime-m_previousMusic.currentTime) / m_previousMusic.fadeTime) * m_musicVolume);
+            m_previousMusic.music->Update();
         }
     }
     
@@ -636,29 +719,17 @@ bool ALSound::PlayMusic(const std::string &filename, bool bRepeat, float fadeTim
     }
 
     std::string file = CGameData::GetInstancePointer()->GetFilePath(DIR_MUSIC, filename);
-    Buffer *buffer;
-
-    // check if we have music in cache
-    if (m_music.find(filename) == m_music.end())
+    if (!boost::filesystem::exists(file))
     {
-        GetLogger()->Debug("Music %s was not cached!\n", filename.c_str());
-        if (!boost::filesystem::exists(file))
-        {
-            GetLogger()->Debug("Requested music %s was not found.\n", filename.c_str());
-            return false;
-        }
-
-        buffer = new Buffer();
-        if (!buffer->LoadFromFile(file, static_cast<Sound>(-1)))
-        {
-            return false;
-        }
-        m_music[filename] = buffer;
+        GetLogger()->Debug("Requested music %s was not found.\n", filename.c_str());
+        return false;
     }
-    else
+
+    StreamChannel *music = new StreamChannel();
+    if (!music->Open(file))
     {
-        GetLogger()->Debug("Music loaded from cache\n");
-        buffer = m_music[filename];
+        delete music;
+        return false;
     }
 
     if (m_currentMusic)
@@ -670,8 +741,7 @@ bool ALSound::PlayMusic(const std::string &filename, bool bRepeat, float fadeTim
         m_oldMusic.push_back(old);
     }
 
-    m_currentMusic = new Channel();
-    m_currentMusic->SetBuffer(buffer);
+    m_currentMusic = music;
     m_currentMusic->SetVolume(m_musicVolume);
     m_currentMusic->SetLoop(bRepeat);
     m_currentMusic->Play();
@@ -28,6 +28,7 @@
 #include "sound/oalsound/buffer.h"
 #include "sound/oalsound/channel.h"
 #include "sound/oalsound/check.h"
+#include "sound/oalsound/streamchannel.h"
 
 #include <map>
 #include <string>
@@ -37,7 +38,7 @@
 
 
 struct OldMusic {
-    Channel* music;
+    StreamChannel* music;
     float fadeTime;
     float currentTime;
 };
@@ -87,6 +88,10 @@ private:
     void CleanUp();
     int GetPriority(Sound);
     bool SearchFreeBuffer(Sound sound, int &channel, bool &bAlreadyLoaded);
+    //! Returns the buffer of a sound, loading it if it was evicted
+    Buffer* GetSound(Sound sound);
+    //! Unloads the least recently played sounds over the memory limit, except \a keep
+    void EvictSounds(Sound keep);
 
     bool m_enabled;
     float m_audioVolume;
@@ -95,9 +100,14 @@ private:
     ALCdevice* m_device;
     ALCcontext* m_context;
     std::map<Sound, Buffer*> m_sounds;
-    std::map<std::string, Buffer*> m_music;
+    //! Files of all known sounds, loaded or not
+    std::map<Sound, std::string> m_soundFiles;
+    //! Loaded sounds, most recently played first
+    std::list<Sound> m_soundUse;
+    //! Memory taken by loaded sounds, in bytes
+    size_t m_soundMemory;
     std::map<int, Channel*> m_channels;
-    Channel *m_currentMusic;
+    StreamChannel *m_currentMusic;
     std::list<OldMusic> m_oldMusic;
     OldMusic m_previousMusic;
     Math::Vector m_eye;
@@ -23,6 +23,7 @@ Buffer::Buffer()
 {
     m_loaded = false;
     m_duration = 0.0f;
+    m_size = 0;
 }
 
 
@@ -81,6 +82,7 @@ bool Buffer::LoadFromFile(std::string filename, Sound sound)
 
     alBufferData(m_buffer, fileInfo.channels == 1 ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16, &data.front(), data.size() * sizeof(uint16_t), fileInfo.samplerate);
     m_duration = static_cast<float>(fileInfo.frames) / fileInfo.samplerate;
+    m_size = data.size() * sizeof(uint16_t);
     m_loaded = true;
     return true;
 }
@@ -109,3 +111,8 @@ float Buffer::GetDuration()
     return m_duration;
 }
 
+
+size_t Buffer::GetSize()
+{
+    return m_size;
+}
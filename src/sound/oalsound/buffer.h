@@ -45,11 +45,14 @@ public:
     Sound GetSoundType();
     ALuint GetBuffer();
     float GetDuration();
+    //! Memory taken by the decoded samples, in bytes
+    size_t GetSize();
 
 private:
     ALuint m_buffer;
     Sound m_sound;
     bool m_loaded;
     float m_duration;
+    size_t m_size;
 };
 
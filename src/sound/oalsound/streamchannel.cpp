@@ -0,0 +1,354 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2012, Polish Portal of Colobot (PPC)
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+
+#include "sound/oalsound/streamchannel.h"
+
+#include <cstring>
+
+
+//! Frames decoded at once, about 0.4 s at 44.1 kHz
+const int STREAM_CHUNK_FRAMES = 16384;
+//! OpenAL buffers queued on the source
+const int STREAM_BUFFERS = 4;
+//! Chunks decoded ahead of the queued buffers
+const size_t STREAM_DECODED = 4;
+
+
+StreamChannel::StreamChannel()
+{
+    m_playing = false;
+    m_file = nullptr;
+    m_format = AL_FORMAT_STEREO16;
+    m_channels = 0;
+    m_sampleRate = 0;
+    m_loop = false;
+    m_end = false;
+    m_rewind = false;
+    m_quit = false;
+
+    alGenSources(1, &m_source);
+    if (alCheck())
+    {
+        GetLogger()->Debug("Failed to create sound source. Code: %d\n", alGetCode());
+        m_ready = false;
+        return;
+    }
+
+    m_buffers.resize(STREAM_BUFFERS);
+    alGenBuffers(STREAM_BUFFERS, m_buffers.data());
+    if (alCheck())
+    {
+        GetLogger()->Debug("Failed to create stream buffers. Code: %d\n", alGetCode());
+        alDeleteSources(1, &m_source);
+        m_buffers.clear();
+        m_ready = false;
+        return;
+    }
+
+    m_freeBuffers = m_buffers;
+
+    // Music is heard the same wherever the camera is
+    alSourcei(m_source, AL_SOURCE_RELATIVE, AL_TRUE);
+    alSource3f(m_source, AL_POSITION, 0.0f, 0.0f, 0.0f);
+    m_ready = true;
+}
+
+
+StreamChannel::~StreamChannel()
+{
+    if (m_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+    }
+
+    if (m_file != nullptr)
+        sf_close(m_file);
+
+    if (m_ready)
+    {
+        alSourceStop(m_source);
+        alSourcei(m_source, AL_BUFFER, 0);
+        alDeleteSources(1, &m_source);
+        alDeleteBuffers(m_buffers.size(), m_buffers.data());
+        if (alCheck())
+            GetLogger()->Debug("Failed to delete stream source. Code: %d\n", alGetCode());
+    }
+}
+
+
+bool StreamChannel::Open(const std::string &filename)
+{
+    if (!m_ready || m_file != nullptr)
+    {
+        return false;
+    }
+
+    GetLogger()->Debug("Streaming audio file: %s\n", filename.c_str());
+
+    SF_INFO fileInfo;
+    memset(&fileInfo, 0, sizeof(SF_INFO));
+    m_file = sf_open(filename.c_str(), SFM_READ, &fileInfo);
+    if (m_file == nullptr)
+    {
+        GetLogger()->Warn("Could not load file. Reason: %s\n", sf_strerror(m_file));
+        return false;
+    }
+
+    m_channels = fileInfo.channels;
+    m_sampleRate = fileInfo.samplerate;
+    m_format = m_channels == 1 ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
+
+    m_thread = std::thread(&StreamChannel::Decode, this);
+    return true;
+}
+
+
+bool StreamChannel::Play()
+{
+    if (!m_ready || m_file == nullptr)
+    {
+        return false;
+    }
+
+    ALint status;
+    alGetSourcei(m_source, AL_SOURCE_STATE, &status);
+    if (status == AL_PAUSED)
+    {
+        alSourcePlay(m_source);
+    }
+
+    m_playing = true;
+    Update();
+
+    if (alCheck())
+    {
+        GetLogger()->Debug("Could not play audio stream. Code: %d\n", alGetCode());
+    }
+    return true;
+}
+
+
+bool StreamChannel::Pause()
+{
+    if (!m_ready || !m_playing)
+    {
+        return false;
+    }
+
+    m_playing = false;
+    alSourcePause(m_source);
+    if (alCheck())
+    {
+        GetLogger()->Debug("Could not pause audio stream. Code: %d\n", alGetCode());
+    }
+    return true;
+}
+
+
+bool StreamChannel::Stop()
+{
+    if (!m_ready || m_file == nullptr)
+    {
+        return false;
+    }
+
+    m_playing = false;
+
+    // Stopped sources release all their buffers
+    alSourceStop(m_source);
+    alSourcei(m_source, AL_BUFFER, 0);
+    m_freeBuffers = m_buffers;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_decoded.clear();
+        m_end = false;
+        m_rewind = true;
+    }
+    m_wake.notify_one();
+
+    if (alCheck())
+    {
+        GetLogger()->Warn("Could not stop audio stream. Code: %d\n", alGetCode());
+        return false;
+    }
+    return true;
+}
+
+
+bool StreamChannel::SetVolume(float vol)
+{
+    if (!m_ready || vol < 0)
+    {
+        return false;
+    }
+
+    alSourcef(m_source, AL_GAIN, vol);
+    if (alCheck())
+    {
+        GetLogger()->Debug("Could not set stream volume to '%f'. Code: %d\n", vol, alGetCode());
+        return false;
+    }
+    return true;
+}
+
+
+void StreamChannel::SetLoop(bool loop)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_loop = loop;
+}
+
+
+bool StreamChannel::IsPlaying()
+{
+    return m_ready && m_playing;
+}
+
+
+bool StreamChannel::IsReady()
+{
+    return m_ready;
+}
+
+
+void StreamChannel::Update()
+{
+    if (!m_ready || !m_playing)
+    {
+        return;
+    }
+
+    ALint processed = 0;
+    alGetSourcei(m_source, AL_BUFFERS_PROCESSED, &processed);
+    while (processed-- > 0)
+    {
+        ALuint buffer;
+        alSourceUnqueueBuffers(m_source, 1, &buffer);
+        m_freeBuffers.push_back(buffer);
+    }
+
+    std::vector<std::vector<int16_t>> chunks;
+    bool end;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        while (chunks.size() < m_freeBuffers.size() && !m_decoded.empty())
+        {
+            chunks.push_back(std::move(m_decoded.front()));
+            m_decoded.pop_front();
+        }
+        end = m_end && m_decoded.empty();
+    }
+    if (!chunks.empty())
+        m_wake.notify_one();
+
+    for (auto &chunk : chunks)
+    {
+        ALuint buffer = m_freeBuffers.back();
+        m_freeBuffers.pop_back();
+        alBufferData(buffer, m_format, chunk.data(), chunk.size() * sizeof(int16_t), m_sampleRate);
+        alSourceQueueBuffers(m_source, 1, &buffer);
+    }
+
+    if (alCheck())
+    {
+        GetLogger()->Debug("Could not queue audio stream. Code: %d\n", alGetCode());
+    }
+
+    ALint queued = 0;
+    ALint status;
+    alGetSourcei(m_source, AL_BUFFERS_QUEUED, &queued);
+    alGetSourcei(m_source, AL_SOURCE_STATE, &status);
+
+    if (status != AL_PLAYING)
+    {
+        // Starts, or goes on after the decoding fell behind
+        if (queued > 0)
+            alSourcePlay(m_source);
+        else if (end)
+            m_playing = false;
+    }
+}
+
+
+void StreamChannel::Decode()
+{
+    std::vector<int16_t> chunk;
+    while (true)
+    {
+        bool loop;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] {
+                return m_quit || m_rewind || (!m_end && m_decoded.size() < STREAM_DECODED);
+            });
+            if (m_quit) return;
+
+            if (m_rewind)
+            {
+                sf_seek(m_file, 0, SEEK_SET);
+                m_rewind = false;
+            }
+            loop = m_loop;
+        }
+
+        size_t read = Read(chunk, loop);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_rewind)  // Stop() was called while reading
+            continue;
+
+        if (read > 0)
+            m_decoded.push_back(std::vector<int16_t>(chunk.begin(), chunk.begin() + read));
+
+        if (read < chunk.size())
+            m_end = true;
+    }
+}
+
+
+size_t StreamChannel::Read(std::vector<int16_t> &chunk, bool loop)
+{
+    chunk.resize(STREAM_CHUNK_FRAMES * m_channels);
+
+    size_t read = 0;
+    bool rewound = false;
+    while (read < chunk.size())
+    {
+        sf_count_t count = sf_read_short(m_file, chunk.data() + read, chunk.size() - read);
+        if (count > 0)
+        {
+            read += count;
+            rewound = false;
+            continue;
+        }
+
+        // An empty file would loop forever
+        if (!loop || rewound)
+            break;
+
+        sf_seek(m_file, 0, SEEK_SET);
+        rewound = true;
+    }
+
+    return read;
+}
@@ -0,0 +1,103 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2012, Polish Portal of Colobot (PPC)
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file streamchannel.h
+ * \brief OpenAL channel streaming a file
+ */
+
+#pragma once
+
+#include "common/logger.h"
+
+#include "sound/oalsound/check.h"
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <al.h>
+#include <sndfile.h>
+
+
+/**
+ * \class StreamChannel
+ * \brief Channel playing a long file, like music, without loading it whole
+ *
+ * A background thread decodes the file in chunks of fixed size and keeps
+ * a few of them ahead. Update() hands the decoded chunks to a small queue
+ * of OpenAL buffers, reusing the buffers already played, so only a few
+ * seconds of audio are in memory at any time.
+ */
+class StreamChannel
+{
+public:
+    StreamChannel();
+    ~StreamChannel();
+
+    //! Opens the file and starts decoding it
+    bool Open(const std::string &filename);
+
+    bool Play();
+    bool Pause();
+    //! Stops and goes back to the beginning of the file
+    bool Stop();
+
+    bool SetVolume(float);
+    void SetLoop(bool);
+
+    bool IsPlaying();
+    bool IsReady();
+
+    //! Queues the decoded chunks, to be called every frame
+    void Update();
+
+private:
+    //! Decoding thread
+    void Decode();
+    //! Reads one chunk, starting again at the end of the file when looping
+    size_t Read(std::vector<int16_t> &chunk, bool loop);
+
+private:
+    ALuint m_source;
+    std::vector<ALuint> m_buffers;
+    //! Buffers not queued on the source
+    std::vector<ALuint> m_freeBuffers;
+    bool m_ready;
+    //! Play() was called and the end was not reached yet
+    bool m_playing;
+
+    SNDFILE *m_file;
+    ALenum m_format;
+    int m_channels;
+    int m_sampleRate;
+
+    std::thread m_thread;
+    //! Protects the members below, shared with the decoding thread
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<std::vector<int16_t>> m_decoded;
+    bool m_loop;
+    //! The decoding thread reached the end of the file
+    bool m_end;
+    //! The decoding thread has to go back to the beginning
+    bool m_rewind;
+    bool m_quit;
+};
+
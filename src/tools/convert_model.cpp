@@ -1,4 +1,5 @@
 #include "common/logger.h"
+#include "graphics/engine/modelcache.h"
 #include "graphics/engine/modelfile.h"
 
 #include <iostream>
@@ -52,6 +53,7 @@ void PrintUsage(const std::string& program)
     std::cerr << " old       => old binary format" << std::endl;
     std::cerr << " new_bin   => new binary format" << std::endl;
     std::cerr << " new_txt   => new text format" << std::endl;
+    std::cerr << " cache     => precompiled model, for this build only (output only)" << std::endl;
 }
 
 bool ParseArgs(int argc, char *argv[])
@@ -265,6 +267,12 @@ int main(int argc, char *argv[])
     {
         ok = model.WriteTextModel(ARGS.outputFile);
     }
+    else if (ARGS.outputFormat == "cache")
+    {
+        Gfx::ModelCacheSource source;
+        ok = Gfx::CModelCache::GetSource(ARGS.inputFile, source) &&
+             Gfx::CModelCache::Write(model.GetTriangles(), source, ARGS.outputFile);
+    }
     else
     {
         std::cerr << "Invalid output format" << std::endl;
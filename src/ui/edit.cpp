@@ -23,6 +23,8 @@
 
 #include "clipboard/clipboard.h"
 
+#include <algorithm>
+#include <climits>
 #include <string.h>
 
 namespace Ui {
@@ -77,14 +79,19 @@ bool IsSep(int character)
 CEdit::CEdit () : CControl ()
 {
     Math::Point pos;
-    int     i;
 
     m_maxChar = 100;
-    m_text = new char[m_maxChar+1];
-    memset(m_text, 0, m_maxChar+1);
+    m_textSize = 100;
+    m_text = new char[m_textSize+1];
+    memset(m_text, 0, m_textSize+1);
     m_len = 0;
 
-    memset(m_lineOffset, 0, sizeof(int) * EDITLINEMAX);
+    m_lineTotal = 0;
+    m_lineOffset.push_back(0);
+    m_lineIndent.push_back(0);
+    m_changeFrom = -1;
+    m_changeTo = 0;
+    m_changeDelta = 0;
 
     m_fontType = Gfx::FONT_COURIER;
     m_scroll        = 0;
@@ -96,6 +103,7 @@ CEdit::CEdit () : CControl ()
     m_bSoluce       = false;
     m_bGeneric      = false;
     m_bAutoIndent   = false;
+    m_bFormatLost   = true;
     m_cursor1       = 0;
     m_cursor2       = 0;
     m_column        = 0;
@@ -103,10 +111,6 @@ CEdit::CEdit () : CControl ()
 
     HyperFlush();
 
-    for ( i=0 ; i<EDITUNDOMAX ; i++ )
-    {
-        m_undo[i].text = nullptr;
-    }
     m_bUndoForce = true;
     m_undoOper = OPERUNDO_SPEC;
 }
@@ -115,16 +119,8 @@ CEdit::CEdit () : CControl ()
 
 CEdit::~CEdit()
 {
-    int     i;
-
     FreeImage();
 
-    for ( i=0 ; i<EDITUNDOMAX ; i++ )
-    {
-        delete m_undo[i].text;
-        m_undo[i].text = nullptr;
-    }
-
     if (m_text != nullptr)
     {
         delete[] m_text;
@@ -147,6 +143,7 @@ bool CEdit::Create(Math::Point pos, Math::Point dim, int icon, EventType eventTy
     CControl::Create(pos, dim, icon, eventType);
 
     m_len = 0;
+    m_text[m_len] = 0;
     m_lineFirst = 0;
     m_time = 0.0f;
     m_timeBlink = 0.0f;
@@ -217,6 +214,7 @@ void CEdit::MoveAdjust()
         m_scroll->SetDim(dim);
     }
 
+    m_changeFrom = -1;  // the width of the lines may have changed
     Justif();
 
     if ( m_lineFirst > m_lineTotal-m_lineVisible )
@@ -724,7 +722,7 @@ int CEdit::MouseDetect(Math::Point mouse)
 //                c = m_engine->GetText()->Detect(m_text+m_lineOffset[i],
 //                                                len, offset, m_fontSize,
 //                                                m_fontStretch, m_fontType);
-                c = m_engine->GetText()->Detect(std::string(m_text+m_lineOffset[i]).substr(0, len), m_fontType, m_fontSize, offset); // TODO check if good
+                c = m_engine->GetText()->Detect(std::string(m_text+m_lineOffset[i], len), m_fontType, m_fontSize, offset); // TODO check if good
             }
             else
             {
@@ -735,7 +733,7 @@ int CEdit::MouseDetect(Math::Point mouse)
 //                                                m_format+m_lineOffset[i],
 //                                                len, offset, size,
 //                                                m_fontStretch);
-                c = m_engine->GetText()->Detect(std::string(m_text+m_lineOffset[i]).substr(0, len),
+                c = m_engine->GetText()->Detect(std::string(m_text+m_lineOffset[i], len),
                                                 m_format.begin() + m_lineOffset[i],
                                                 m_format.end(),
                                                 size,
@@ -1031,16 +1029,16 @@ void CEdit::Draw()
 
             if ( m_format.size() == 0 )
             {
-                start.x = ppos.x+m_engine->GetText()->GetStringWidth(std::string(m_text+beg).substr(0, o1-beg), m_fontType, size);
-                end.x   = m_engine->GetText()->GetStringWidth(std::string(m_text+o1).substr(0, o2-o1), m_fontType, size);
+                start.x = ppos.x+m_engine->GetText()->GetStringWidth(std::string(m_text+beg, o1-beg), m_fontType, size);
+                end.x   = m_engine->GetText()->GetStringWidth(std::string(m_text+o1, o2-o1), m_fontType, size);
             }
             else
             {
-                start.x = ppos.x+m_engine->GetText()->GetStringWidth(std::string(m_text+beg).substr(0, o1-beg),
+                start.x = ppos.x+m_engine->GetText()->GetStringWidth(std::string(m_text+beg, o1-beg),
                                                                      m_format.begin() + beg,
                                                                      m_format.end(),
                                                                      size);
-                end.x   = m_engine->GetText()->GetStringWidth(std::string(m_text+o1).substr(0, o2-o1),
+                end.x   = m_engine->GetText()->GetStringWidth(std::string(m_text+o1, o2-o1),
                                                               m_format.begin() + o1,
                                                               m_format.end(),
                                                               size);
@@ -1065,11 +1063,11 @@ void CEdit::Draw()
         if ( !m_bMulti || !m_bDisplaySpec )  eol = 0;
         if ( m_format.size() == 0 )
         {
-            m_engine->GetText()->DrawText(std::string(m_text+beg).substr(0, len), m_fontType, size, ppos, m_dim.x, Gfx::TEXT_ALIGN_LEFT, eol);
+            m_engine->GetText()->DrawText(std::string(m_text+beg, len), m_fontType, size, ppos, m_dim.x, Gfx::TEXT_ALIGN_LEFT, eol);
         }
         else
         {
-            m_engine->GetText()->DrawText(std::string(m_text+beg).substr(0, len),
+            m_engine->GetText()->DrawText(std::string(m_text+beg, len),
                                           m_format.begin() + beg,
                                           m_format.end(),
                                           size,
@@ -1106,13 +1104,13 @@ void CEdit::Draw()
 
                 if ( m_format.size() == 0 )
                 {
-                    m_engine->GetText()->SizeText(std::string(m_text+m_lineOffset[i]).substr(0, len), m_fontType,
+                    m_engine->GetText()->SizeText(std::string(m_text+m_lineOffset[i], len), m_fontType,
                                                   size, pos, Gfx::TEXT_ALIGN_LEFT,
                                                   start, end);
                 }
                 else
                 {
-                    m_engine->GetText()->SizeText(std::string(m_text+m_lineOffset[i]).substr(0, len),
+                    m_engine->GetText()->SizeText(std::string(m_text+m_lineOffset[i], len),
                                                   m_format.begin() + m_lineOffset[i],
                                                   m_format.end(),
                                                   size, pos, Gfx::TEXT_ALIGN_LEFT,
@@ -1250,10 +1248,15 @@ void CEdit::SetText(const char *text, bool bNew)
     int     i, j, font;
     bool    bBOL;
 
-    if ( !bNew )  UndoMemorize(OPERUNDO_SPEC);
+    if ( !bNew )
+    {
+        UndoMemorize(OPERUNDO_SPEC);
+        UndoChange(0, m_len, 0);  // the whole text is replaced
+    }
 
     m_len = strlen(text);
     if ( m_len > m_maxChar )  m_len = m_maxChar;
+    ReserveText(m_len);
 
     if ( m_format.size() == 0 )
     {
@@ -1345,8 +1348,12 @@ void CEdit::SetText(const char *text, bool bNew)
         }
         m_len = j;
     }
+    m_text[m_len] = 0;
+    m_bFormatLost = true;
 
     if ( bNew )  UndoFlush();
+    else         UndoChange(0, 0, m_len);
+    m_changeFrom = -1;
 
     m_cursor1 = 0;
     m_cursor2 = 0;  // cursor to the beginning
@@ -1472,7 +1479,7 @@ bool CEdit::ReadText(std::string filename, int addSize)
     len = ftell(file);
     fseek(file, 0, SEEK_SET);
 
-    m_maxChar = len+addSize+100;
+    if ( m_maxChar < len+addSize+100 )  m_maxChar = len+addSize+100;
     m_len = len;
     m_cursor1 = 0;
     m_cursor2 = 0;
@@ -1482,20 +1489,17 @@ bool CEdit::ReadText(std::string filename, int addSize)
     if (m_text != nullptr)
         delete[] m_text;
 
-    m_text = new char[m_maxChar+1];
-    memset(m_text, 0, m_maxChar+1);
+    m_textSize = len+addSize+100;
+    m_text = new char[m_textSize+1];
+    memset(m_text, 0, m_textSize+1);
 
-    buffer = new char[m_maxChar+1];
-    memset(buffer, 0, m_maxChar+1);
+    buffer = new char[m_textSize+1];
+    memset(buffer, 0, m_textSize+1);
 
     fread(buffer, 1, len, file);
 
     m_format.clear();
-    m_format.reserve(m_maxChar+1);
-    for (i = 0; i <= m_maxChar+1; i++)
-    {
-        m_format.push_back(0);
-    }
+    m_format.resize(m_textSize+2, 0);
 
     fclose(file);
 
@@ -1879,9 +1883,12 @@ bool CEdit::ReadText(std::string filename, int addSize)
     }
     m_len = j;
     m_imageTotal = iIndex;
+    m_bFormatLost = true;
 
     delete[] buffer;
 
+    UndoFlush();
+    m_changeFrom = -1;
     Justif();
     ColumnFix();
     return true;
@@ -1904,6 +1911,7 @@ bool CEdit::WriteText(std::string filename)
     {
         iDim = m_dim.x;
         m_dim.x = 1000.0f;  // puts an infinite width!
+        m_changeFrom = -1;
         Justif();
     }
 
@@ -1945,6 +1953,7 @@ bool CEdit::WriteText(std::string filename)
     if ( m_bAutoIndent )
     {
         m_dim.x = iDim;  // presents the initial width
+        m_changeFrom = -1;
         Justif();
     }
 
@@ -1963,19 +1972,18 @@ void CEdit::SetMaxChar(int max)
 
     m_maxChar = max;
 
-    m_text = new char[m_maxChar+1];
-    memset(m_text, 0, m_maxChar+1);
+    m_textSize = 100;  // grows with the text, see ReserveText
+    m_text = new char[m_textSize+1];
+    memset(m_text, 0, m_textSize+1);
 
     m_format.clear();
-    m_format.reserve(m_maxChar+1);
-    for (int i = 0; i <= m_maxChar+1; i++)
-    {
-        m_format.push_back(0);
-    }
+    m_format.resize(m_textSize+2, 0);
 
     m_len = 0;
     m_cursor1 = 0;
     m_cursor2 = 0;
+    m_bFormatLost = true;
+    m_changeFrom = -1;
     Justif();
     UndoFlush();
 }
@@ -2052,6 +2060,7 @@ bool CEdit::GetGenericMode()
 void CEdit::SetAutoIndent(bool bMode)
 {
     m_bAutoIndent = bMode;
+    m_changeFrom = -1;
 }
 
 bool CEdit::GetAutoIndent()
@@ -2160,14 +2169,12 @@ bool CEdit::GetDisplaySpec()
 void CEdit::SetMultiFont(bool bMulti)
 {
     m_format.clear();
+    m_bFormatLost = true;
+    m_changeFrom = -1;
 
     if (bMulti)
     {
-        m_format.reserve(m_maxChar+1);
-        for (int i = 0; i <= m_maxChar+1; i++)
-        {
-            m_format.push_back(0);
-        }
+        m_format.resize(m_textSize+2, 0);
     }
 }
 
@@ -2418,7 +2425,7 @@ void CEdit::MoveChar(int move, bool bWord, bool bSelect)
 void CEdit::MoveLine(int move, bool bWord, bool bSelect)
 {
     float   column, indentLength = 0.0f;
-    int     i, line, c;
+    int     i, line, c, len;
 
     if ( move == 0 )  return;
 
@@ -2463,20 +2470,22 @@ void CEdit::MoveLine(int move, bool bWord, bool bSelect)
         column -= indentLength*m_lineIndent[line];
     }
 
+    len = m_lineOffset[line+1]-m_lineOffset[line];
     if ( m_format.size() == 0 )
     {
-        c = m_engine->GetText()->Detect(std::string(m_text+m_lineOffset[line]),
+        c = m_engine->GetText()->Detect(std::string(m_text+m_lineOffset[line], len),
                                         m_fontType, m_fontSize,
-                                        m_lineOffset[line+1]-m_lineOffset[line]);
+                                        column);
     }
     else
     {
-        c = m_engine->GetText()->Detect(std::string(m_text+m_lineOffset[line]),
+        c = m_engine->GetText()->Detect(std::string(m_text+m_lineOffset[line], len),
                                         m_format.begin() + m_lineOffset[line],
                                         m_format.end(),
                                         m_fontSize,
-                                        m_lineOffset[line+1]-m_lineOffset[line]);
+                                        column);
     }
+    if ( c > 0 && m_text[m_lineOffset[line]+c-1] == '\n' )  c --;  // stays on the line
 
     m_cursor1 = m_lineOffset[line]+c;
     if ( !bSelect )  m_cursor2 = m_cursor1;
@@ -2497,13 +2506,13 @@ void CEdit::ColumnFix()
     if ( m_format.size() == 0 )
     {
         m_column = m_engine->GetText()->GetStringWidth(
-                                std::string(m_text+m_lineOffset[line]),
+                                std::string(m_text+m_lineOffset[line], m_cursor1-m_lineOffset[line]),
                                 m_fontType, m_fontSize);
     }
     else
     {
         m_column = m_engine->GetText()->GetStringWidth(
-                                std::string(m_text+m_lineOffset[line]),
+                                std::string(m_text+m_lineOffset[line], m_cursor1-m_lineOffset[line]),
                                 m_format.begin() + m_lineOffset[line],
                                 m_format.end(),
                                 m_fontSize
@@ -2594,8 +2603,10 @@ bool CEdit::Copy(bool memorize_cursor)
 
 bool CEdit::Paste()
 {
+    std::string buffer;
     char    c;
     char*   text;
+    int     len;
 
     if ( !m_bEdit )
     {
@@ -2609,8 +2620,7 @@ bool CEdit::Paste()
         return false;
     }
 
-    UndoMemorize(OPERUNDO_SPEC);
-    for ( unsigned int i = 0; i < strlen(text); i++ )
+    for ( unsigned int i = 0; text[i] != 0; i++ )
     {
         c = text[i];
         if ( c == '\r' )
@@ -2621,10 +2631,28 @@ bool CEdit::Paste()
         {
             continue;
         }
-        InsertOne(c);
+        if ( c == '\n' && !m_bMulti )
+        {
+            continue;
+        }
+        buffer += c;
     }
-
     free(text);
+
+    UndoMemorize(OPERUNDO_SPEC);
+    if ( !buffer.empty() )
+    {
+        if ( m_cursor1 != m_cursor2 )
+        {
+            DeleteOne(0);  // deletes the selected characters
+        }
+
+        len = std::min(static_cast<int>(buffer.size()), std::max(m_maxChar-m_len, 0));
+        InsertText(m_cursor1, buffer.c_str(), len);  // in one block
+        m_cursor1 += len;
+        m_cursor2 = m_cursor1;
+    }
+
     Justif();
     ColumnFix();
     SendModifEvent();
@@ -2750,8 +2778,6 @@ void CEdit::Insert(char character)
 
 void CEdit::InsertOne(char character)
 {
-    int     i;
-
     if ( !m_bEdit )  return;
     if ( !m_bMulti && character == '\n' )  return;
 
@@ -2762,24 +2788,7 @@ void CEdit::InsertOne(char character)
 
     if ( m_len >= m_maxChar )  return;
 
-    for ( i=m_len ; i>=m_cursor1 ; i-- )
-    {
-        m_text[i] = m_text[i-1];  // shoot
-
-        if ( m_format.size() > static_cast<unsigned int>(i) )
-        {
-            m_format[i] = m_format[i-1];  // shoot
-        }
-    }
-
-    m_len ++;
-
-    m_text[m_cursor1] = character;
-
-    if ( m_format.size() > static_cast<unsigned int>(m_cursor1) )
-    {
-        m_format[m_cursor1] = 0;
-    }
+    InsertText(m_cursor1, &character, 1);
 
     m_cursor1++;
     m_cursor2 = m_cursor1;
@@ -2802,7 +2811,6 @@ void CEdit::Delete(int dir)
 
 void CEdit::DeleteOne(int dir)
 {
-    int     i, end, hole;
 
     if ( !m_bEdit )  return;
 
@@ -2821,18 +2829,7 @@ void CEdit::DeleteOne(int dir)
     }
 
     if ( m_cursor1 > m_cursor2 )  Math::Swap(m_cursor1, m_cursor2);
-    hole = m_cursor2-m_cursor1;
-    end = m_len-hole;
-    for ( i=m_cursor1 ; i<end ; i++ )
-    {
-        m_text[i] = m_text[i+hole];
-
-        if ( m_format.size() > static_cast<unsigned int>(i + hole) )
-        {
-            m_format[i] = m_format[i+hole];
-        }
-    }
-    m_len -= hole;
+    RemoveText(m_cursor1, m_cursor2-m_cursor1);
     m_cursor2 = m_cursor1;
 }
 
@@ -2972,6 +2969,7 @@ bool CEdit::MinMaj(bool bMaj)
     c2 = m_cursor2;
     if ( c1 > c2 )  Math::Swap(c1, c2);  // alwyas c1 <= c2
 
+    UndoChange(c1, c2-c1, c2-c1);
     for ( i=c1 ; i<c2 ; i++ )
     {
         character = static_cast<unsigned char>(m_text[i]);
@@ -2979,6 +2977,7 @@ bool CEdit::MinMaj(bool bMaj)
         else         character = GetToLower(character);
         m_text[i] = character;
     }
+    TextChanged(c1, c2-c1, c2-c1);
 
     Justif();
     ColumnFix();
@@ -2988,18 +2987,17 @@ bool CEdit::MinMaj(bool bMaj)
 
 
 // Cut all text lines.
+// Only the lines from the beginning of the paragraph where the text
+// changed (see TextChanged) are cut again, until a paragraph which
+// begins like before the change; the following lines are moved.
 
 void CEdit::Justif()
 {
     float   width, size, indentLength = 0.0f;
-    int     i, j, line, indent;
+    int     i, j, k, end, first, last, line, indent;
     bool    bDual, bString, bRem;
-
-    indent = 0;
-    m_lineTotal = 0;
-    m_lineOffset[m_lineTotal] = 0;
-    m_lineIndent[m_lineTotal] = indent;
-    m_lineTotal ++;
+    std::vector<int>  oldOffset;
+    std::vector<char> oldIndent;
 
     if ( m_bAutoIndent )
     {
@@ -3007,99 +3005,173 @@ void CEdit::Justif()
                         * m_engine->GetEditIndentValue();
     }
 
-    bString = bRem = false;
-    i = 0;
-    while ( true )
+    if ( m_changeFrom < 0 )  // all the lines?
     {
-        bDual = false;
-
-        width = m_dim.x-(10.0f/640.0f)*2.0f-(m_bMulti?MARGX*2.0f+SCROLL_WIDTH:0.0f);
-        if ( m_bAutoIndent )
+        first = 0;
+    }
+    else if ( m_changeFrom > m_changeTo )  // nothing changed?
+    {
+        first = -1;
+    }
+    else
+    {
+        // Goes back to a paragraph before the change, on a single line
+        // whose indentation does not depend on a '}'.
+        first = GetCursorLine(m_changeFrom);
+        while ( first > 0 &&
+                ( m_lineOffset[first] >= m_changeFrom               ||
+                  m_text[m_lineOffset[first]-1] != '\n'             ||
+                  m_text[m_lineOffset[first]] == '}'                ||
+                  m_lineOffset[first-1] == m_lineOffset[first]      ||
+                  m_lineOffset[first+1] == m_lineOffset[first]      ) )
         {
-            width -= indentLength*m_lineIndent[m_lineTotal-1];
+            first --;
         }
+    }
 
-        if ( m_format.size() == 0 )
-        {
-            // TODO check if good
+    if ( first >= 0 )
+    {
+        oldOffset.swap(m_lineOffset);
+        oldIndent.swap(m_lineIndent);
+        m_lineOffset.assign(oldOffset.begin(), oldOffset.begin()+first);
+        m_lineIndent.assign(oldIndent.begin(), oldIndent.begin()+first);
 
-            i += m_engine->GetText()->Justify(m_text+i, m_fontType,
-                                              m_fontSize, width);
-        }
-        else
+        i = (first == 0) ? 0 : oldOffset[first];
+        indent = (first == 0) ? 0 : oldIndent[first];
+        m_lineTotal = first;
+        m_lineOffset.push_back(i);
+        m_lineIndent.push_back(indent);
+        m_lineTotal ++;
+
+        last = -1;
+        bString = bRem = false;
+        while ( true )
         {
-            size = m_fontSize;
+            bDual = false;
+
+            width = m_dim.x-(10.0f/640.0f)*2.0f-(m_bMulti?MARGX*2.0f+SCROLL_WIDTH:0.0f);
+            if ( m_bAutoIndent )
+            {
+                width -= indentLength*m_lineIndent[m_lineTotal-1];
+            }
 
-            if ( m_format.size() > static_cast<unsigned int>(i) && (m_format[i]&Gfx::FONT_MASK_TITLE) == Gfx::FONT_TITLE_BIG )  // headline?
+            end = i;  // end of the paragraph
+            while ( end < m_len )
             {
-                size *= BIG_FONT;
-                bDual = true;
+                if ( m_text[end++] == '\n' &&
+                     (m_format.size() == 0 || (m_format[end-1]&Gfx::FONT_MASK_FONT) != Gfx::FONT_BUTTON) )  break;
             }
 
-            if ( m_format.size() > static_cast<unsigned int>(i) && (m_format[i]&Gfx::FONT_MASK_IMAGE) != 0 )  // image part?
+            if ( m_format.size() == 0 )
             {
-                i ++;  // jumps just a character (index in m_image)
+                j = m_engine->GetText()->Justify(std::string(m_text+i, end-i), m_fontType,
+                                                 m_fontSize, width);
             }
             else
             {
-                // TODO check if good
-                i += m_engine->GetText()->Justify(std::string(m_text+i),
-                                                  m_format.begin() + i,
-                                                  m_format.end(),
-                                                  size,
-                                                  width);
+                size = m_fontSize;
+
+                if ( m_format.size() > static_cast<unsigned int>(i) && (m_format[i]&Gfx::FONT_MASK_TITLE) == Gfx::FONT_TITLE_BIG )  // headline?
+                {
+                    size *= BIG_FONT;
+                    bDual = true;
+                }
+
+                if ( m_format.size() > static_cast<unsigned int>(i) && (m_format[i]&Gfx::FONT_MASK_IMAGE) != 0 )  // image part?
+                {
+                    j = 1;  // jumps just a character (index in m_image)
+                }
+                else
+                {
+                    j = m_engine->GetText()->Justify(std::string(m_text+i, end-i),
+                                                     m_format.begin() + i,
+                                                     m_format.end(),
+                                                     size,
+                                                     width);
+                }
             }
-        }
+            if ( j == 0 )  j = 1;  // at least one character by line
+            i += j;
 
-        if ( i >= m_len )  break;
+            if ( i >= m_len )  break;
 
-        if ( m_bAutoIndent )
-        {
-            for ( j=m_lineOffset[m_lineTotal-1] ; j<i ; j++ )
+            if ( m_bAutoIndent )
             {
-                if ( !bRem && m_text[j] == '\"' )  bString = !bString;
-                if ( !bString &&
-                     m_text[j] == '/' &&
-                     m_text[j+1] == '/' )  bRem = true;
-                if ( m_text[j] == '\n' )  bString = bRem = false;
-                if ( m_text[j] == '{' && !bString && !bRem )  indent ++;
-                if ( m_text[j] == '}' && !bString && !bRem )  indent --;
+                for ( j=m_lineOffset[m_lineTotal-1] ; j<i ; j++ )
+                {
+                    if ( !bRem && m_text[j] == '\"' )  bString = !bString;
+                    if ( !bString &&
+                         m_text[j] == '/' &&
+                         m_text[j+1] == '/' )  bRem = true;
+                    if ( m_text[j] == '\n' )  bString = bRem = false;
+                    if ( m_text[j] == '{' && !bString && !bRem )  indent ++;
+                    if ( m_text[j] == '}' && !bString && !bRem )  indent --;
+                }
+                if ( indent < 0 )  indent = 0;
             }
-            if ( indent < 0 )  indent = 0;
-        }
 
-        m_lineOffset[m_lineTotal] = i;
-        m_lineIndent[m_lineTotal] = indent;
-        m_lineTotal ++;
-        if ( bDual )
-        {
-            m_lineOffset[m_lineTotal] = i;
-            m_lineIndent[m_lineTotal] = indent;
+            // A paragraph after the change which was on the same
+            // lines before: moves the following lines.
+            if ( m_changeFrom >= 0 && i >= m_changeTo && !bDual &&
+                 m_text[i-1] == '\n' && m_text[i] != '}' )
+            {
+                k = std::lower_bound(oldOffset.begin()+first, oldOffset.end(), i-m_changeDelta) - oldOffset.begin();
+                if ( k+1 < static_cast<int>(oldOffset.size()) &&
+                     oldOffset[k] == i-m_changeDelta          &&
+                     oldOffset[k+1] != oldOffset[k]           &&
+                     oldIndent[k] == indent                   )
+                {
+                    last = m_lineTotal;
+                    for ( ; k<static_cast<int>(oldOffset.size()) ; k++ )
+                    {
+                        m_lineOffset.push_back(oldOffset[k]+m_changeDelta);
+                        m_lineIndent.push_back(oldIndent[k]);
+                    }
+                    m_lineTotal = m_lineOffset.size()-1;
+                    break;
+                }
+            }
+
+            m_lineOffset.push_back(i);
+            m_lineIndent.push_back(indent);
             m_lineTotal ++;
+            if ( bDual )
+            {
+                m_lineOffset.push_back(i);
+                m_lineIndent.push_back(indent);
+                m_lineTotal ++;
+            }
         }
-        if ( m_lineTotal >= EDITLINEMAX-2 )  break;
-    }
 
-    if ( m_len > 0 && m_text[m_len-1] == '\n' )
-    {
-        m_lineOffset[m_lineTotal] = m_len;
-        m_lineIndent[m_lineTotal] = 0;
-        m_lineTotal ++;
-    }
-    m_lineOffset[m_lineTotal] = m_len;
-    m_lineIndent[m_lineTotal] = 0;
+        if ( last < 0 )  // cut until the end?
+        {
+            if ( m_len > 0 && m_text[m_len-1] == '\n' )
+            {
+                m_lineOffset.push_back(m_len);
+                m_lineIndent.push_back(0);
+                m_lineTotal ++;
+            }
+            m_lineOffset.push_back(m_len);
+            m_lineIndent.push_back(0);
+            last = m_lineTotal+1;
+        }
 
-    if ( m_bAutoIndent )
-    {
-        for ( i=0 ; i<=m_lineTotal ; i++ )
+        if ( m_bAutoIndent )
         {
-            if ( m_text[m_lineOffset[i]] == '}' )
+            for ( i=first ; i<last ; i++ )
             {
-                if ( m_lineIndent[i] > 0 )  m_lineIndent[i] --;
+                if ( m_text[m_lineOffset[i]] == '}' )
+                {
+                    if ( m_lineIndent[i] > 0 )  m_lineIndent[i] --;
+                }
             }
         }
     }
 
+    m_changeFrom = INT_MAX;  // nothing changed since
+    m_changeTo = 0;
+    m_changeDelta = 0;
+
     if ( m_bMulti )
     {
         if ( m_bEdit )
@@ -3129,32 +3201,99 @@ void CEdit::Justif()
 
 int CEdit::GetCursorLine(int cursor)
 {
-    int     line, i;
+    int     line;
+
+    line = std::upper_bound(m_lineOffset.begin(), m_lineOffset.begin()+m_lineTotal, cursor) - m_lineOffset.begin();
+    if ( line > 0 )  line --;
+    return line;
+}
+
+
+// Makes the buffer m_text big enough for len characters.
+
+void CEdit::ReserveText(int len)
+{
+    char*   text;
+    int     size;
 
-    line = 0;
-    for ( i=0 ; i<m_lineTotal ; i++ )
+    if ( len <= m_textSize )  return;
+
+    size = m_textSize*2;
+    if ( size < len )  size = len;
+
+    text = new char[size+1];
+    memcpy(text, m_text, m_textSize+1);
+    memset(text+m_textSize+1, 0, size-m_textSize);
+    delete[] m_text;
+    m_text = text;
+    m_textSize = size;
+
+    if ( m_format.size() > 0 )
     {
-        if ( cursor >= m_lineOffset[i] )
-        {
-            line = i;
-        }
+        m_format.resize(m_textSize+2, 0);
     }
-    return line;
 }
 
+// Inserts characters in the text, without format.
 
-// Flush the buffer undo.
+void CEdit::InsertText(int pos, const char* text, int len)
+{
+    if ( len <= 0 )  return;
 
-void CEdit::UndoFlush()
+    UndoChange(pos, 0, len);
+    ReserveText(m_len+len);
+
+    memmove(m_text+pos+len, m_text+pos, m_len-pos+1);  // with the zero terminator
+    memcpy(m_text+pos, text, len);
+
+    if ( m_format.size() > 0 )
+    {
+        std::copy_backward(m_format.begin()+pos, m_format.begin()+m_len, m_format.begin()+m_len+len);
+        std::fill(m_format.begin()+pos, m_format.begin()+pos+len, 0);
+    }
+
+    m_len += len;
+    TextChanged(pos, 0, len);
+}
+
+// Removes characters from the text.
+
+void CEdit::RemoveText(int pos, int len)
 {
-    int     i;
+    if ( len <= 0 )  return;
+
+    UndoChange(pos, len, 0);
 
-    for ( i=0 ; i<EDITUNDOMAX ; i++ )
+    memmove(m_text+pos, m_text+pos+len, m_len-pos-len+1);  // with the zero terminator
+
+    if ( m_format.size() > 0 )
     {
-        delete m_undo[i].text;
-        m_undo[i].text = nullptr;
+        std::copy(m_format.begin()+pos+len, m_format.begin()+m_len, m_format.begin()+pos);
     }
 
+    m_len -= len;
+    TextChanged(pos, len, 0);
+}
+
+// Notes that removed characters were replaced by inserted ones at pos,
+// for the next Justif.
+
+void CEdit::TextChanged(int pos, int removed, int inserted)
+{
+    if ( m_changeFrom < 0 )  return;  // all the lines will be cut
+
+    m_changeTo = std::max(m_changeTo, pos+removed) - removed + inserted;
+    m_changeFrom = std::min(m_changeFrom, pos);
+    m_changeDelta += inserted - removed;
+}
+
+
+// Flush the buffer undo.
+
+void CEdit::UndoFlush()
+{
+    m_undo.clear();
+
     m_bUndoForce = true;
     m_undoOper = OPERUNDO_SPEC;
 }
@@ -3163,8 +3302,6 @@ void CEdit::UndoFlush()
 
 void CEdit::UndoMemorize(OperUndo oper)
 {
-    int     i, len;
-
     if ( !m_bUndoForce               &&
          oper       != OPERUNDO_SPEC &&
          m_undoOper != OPERUNDO_SPEC &&
@@ -3173,45 +3310,80 @@ void CEdit::UndoMemorize(OperUndo oper)
     m_bUndoForce = false;
     m_undoOper = oper;
 
-    delete m_undo[EDITUNDOMAX-1].text;
-    m_undo[EDITUNDOMAX-1].text = nullptr;
-
-    for ( i=EDITUNDOMAX-1 ; i>=1 ; i-- )
-    {
-        m_undo[i] = m_undo[i-1];
-    }
-
-    len = m_len;
-    if ( len == 0 )  len ++;
-    m_undo[0].text = new char[len+1];
-    memcpy(m_undo[0].text, m_text, m_len);
-    m_undo[0].len = m_len;
+    if ( m_undo.size() >= EDITUNDOMAX )  m_undo.pop_back();
+    m_undo.push_front(EditUndo());
 
     m_undo[0].cursor1 = m_cursor1;
     m_undo[0].cursor2 = m_cursor2;
     m_undo[0].lineFirst = m_lineFirst;
 }
 
+// Memorize a change of the text since the last state,
+// before it is made: removed characters replaced by inserted ones at pos.
+
+void CEdit::UndoChange(int pos, int removed, int inserted)
+{
+    EditChange  change;
+
+    if ( m_undo.empty() )  return;
+
+    std::vector<EditChange>& changes = m_undo[0].changes;
+    if ( !changes.empty() )
+    {
+        EditChange& previous = changes.back();
+
+        if ( removed == 0 && pos == previous.pos+previous.inserted )  // continues to insert?
+        {
+            previous.inserted += inserted;
+            return;
+        }
+        if ( inserted == 0 && previous.inserted == 0 )
+        {
+            if ( pos+removed == previous.pos )  // deletes before?
+            {
+                previous.removed.insert(0, m_text+pos, removed);
+                previous.pos = pos;
+                return;
+            }
+            if ( pos == previous.pos )  // deletes after?
+            {
+                previous.removed.append(m_text+pos, removed);
+                return;
+            }
+        }
+    }
+
+    change.pos = pos;
+    change.removed.assign(m_text+pos, removed);
+    change.inserted = inserted;
+    changes.push_back(change);
+}
+
 // Back to previous state.
 
 bool CEdit::UndoRecall()
 {
+    EditUndo    undo;
+    std::deque<EditUndo> history;
     int     i;
 
-    if ( m_undo[0].text == nullptr )  return false;
+    if ( m_undo.empty() )  return false;
 
-    m_len = m_undo[0].len;
-    memcpy(m_text, m_undo[0].text, m_len);
+    undo = m_undo[0];
+    m_undo.pop_front();
 
-    m_cursor1 = m_undo[0].cursor1;
-    m_cursor2 = m_undo[0].cursor2;
-    m_lineFirst = m_undo[0].lineFirst;
-
-    for ( i=0 ; i<EDITUNDOMAX-1 ; i++ )
+    history.swap(m_undo);  // the changes undone are not memorized
+    for ( i=static_cast<int>(undo.changes.size())-1 ; i>=0 ; i-- )
     {
-        m_undo[i] = m_undo[i+1];
+        const EditChange& change = undo.changes[i];
+        RemoveText(change.pos, change.inserted);
+        InsertText(change.pos, change.removed.c_str(), change.removed.size());
     }
-    m_undo[EDITUNDOMAX-1].text = nullptr;
+    m_undo.swap(history);
+
+    m_cursor1 = undo.cursor1;
+    m_cursor2 = undo.cursor2;
+    m_lineFirst = undo.lineFirst;
 
     m_bUndoForce = true;
     Justif();
@@ -3230,23 +3402,54 @@ bool CEdit::ClearFormat()
         SetMultiFont(true);
     }
     m_format.clear();
+    m_bFormatLost = false;
+    m_changeFrom = -1;
 
     return true;
 }
 
+// Clears the format of a sequence of characters.
+
+bool CEdit::ClearFormat(int cursor1, int cursor2)
+{
+    int     i;
+
+    for ( i=cursor1 ; i<cursor2 && i<static_cast<int>(m_format.size()) ; i++ )
+    {
+        m_format[i] = 0;
+    }
+    TextChanged(cursor1, cursor2-cursor1, cursor2-cursor1);  // the width of the characters may change
+
+    return true;
+}
+
+// Indicates whether the formats no longer follow the text,
+// since it was replaced rather than typed (see ClearFormat).
+
+bool CEdit::GetFormatLost()
+{
+    return m_bFormatLost;
+}
+
 // Changes the format of a sequence of characters.
 
 bool CEdit::SetFormat(int cursor1, int cursor2, int format)
 {
     int     i;
+    bool    bLost;
 
     if ( m_format.size() < static_cast<unsigned int>(cursor2) )
+    {
+        bLost = m_bFormatLost;
         SetMultiFont(true);
+        m_bFormatLost = bLost;  // there was no format
+    }
 
     for ( i=cursor1 ; i<cursor2 ; i++ )
     {
         m_format.at(i) |= format;
     }
+    TextChanged(cursor1, cursor2-cursor1, cursor2-cursor1);
 
     return true;
 }
@@ -36,6 +36,8 @@
 
 #include <set>
 #include <string>
+#include <vector>
+#include <deque>
 #include <cstdlib>
 
 #include <boost/filesystem.hpp>
@@ -49,9 +51,7 @@ namespace Ui {
 
 
 //! maximum number of characters in CBOT edit
-const int EDITSTUDIOMAX     = 20000;
-//! maximum total number of lines
-const int EDITLINEMAX       = 1000;
+const int EDITSTUDIOMAX     = 500000;
 //! maximum total number of lines with images
 const int EDITIMAGEMAX      = 50;
 //! maximum number of links
@@ -62,12 +62,20 @@ const int EDITHISTORYMAX    = 50;
 //! max number of successive undo
 const int EDITUNDOMAX = 20;
 
+struct EditChange
+{
+    //! offset of the change
+    int         pos;
+    //! characters removed at this offset
+    std::string removed;
+    //! number of characters inserted in their place
+    int         inserted;
+};
+
 struct EditUndo
 {
-    //! original text
-    char*       text;
-    //! length of the text
-    int     len;
+    //! changes made since this state, in order
+    std::vector<EditChange> changes;
     //! offset cursor
     int     cursor1;
     //! offset cursor
@@ -196,7 +204,9 @@ public:
     void        SetFontSize(float size);
 
     bool        ClearFormat();
+    bool        ClearFormat(int cursor1, int cursor2);
     bool        SetFormat(int cursor1, int cursor2, int format);
+    bool        GetFormatLost();
 
 protected:
     void        SendModifEvent();
@@ -236,8 +246,14 @@ protected:
     void        Justif();
     int         GetCursorLine(int cursor);
 
+    void        ReserveText(int len);
+    void        InsertText(int pos, const char* text, int len);
+    void        RemoveText(int pos, int len);
+    void        TextChanged(int pos, int removed, int inserted);
+
     void        UndoFlush();
     void        UndoMemorize(OperUndo oper);
+    void        UndoChange(int pos, int removed, int inserted);
     bool        UndoRecall();
 
     void        UpdateScroll();
@@ -245,8 +261,9 @@ protected:
 protected:
     CScroll*    m_scroll;           // vertical scrollbar on the right
 
-    int     m_maxChar;          // max length of the buffer m_text
-    char*       m_text;             // text (without zero terminator)
+    int     m_maxChar;          // max length of the text
+    int     m_textSize;         // length of the buffer m_text
+    char*       m_text;             // text (with zero terminator)
     std::vector<Gfx::FontMetaChar> m_format;           // format characters
     int     m_len;              // length used in m_text
     int     m_cursor1;          // offset cursor
@@ -261,14 +278,18 @@ protected:
     bool        m_bSoluce;          // true -> shows the links-solution
     bool        m_bGeneric;         // true -> generic that defile
     bool        m_bAutoIndent;          // true -> automatic indentation
+    bool        m_bFormatLost;          // true -> the formats do not follow the text
     float       m_lineHeight;           // height of a row
     float       m_lineAscent;           // height above the baseline
     float       m_lineDescent;          // height below the baseline
     int     m_lineVisible;          // total number of viewable lines
     int     m_lineFirst;            // the first line displayed
     int     m_lineTotal;            // number lines used (in m_lineOffset)
-    int     m_lineOffset[EDITLINEMAX];
-    char        m_lineIndent[EDITLINEMAX];
+    std::vector<int>  m_lineOffset;     // m_lineTotal+1 offsets, the last one is m_len
+    std::vector<char> m_lineIndent;
+    int     m_changeFrom;           // text changed since Justif, -1 -> lay out all
+    int     m_changeTo;             // end of the change, in the current text
+    int     m_changeDelta;          // number of characters added
     int     m_imageTotal;
     ImageLine   m_image[EDITIMAGEMAX];
     HyperLink   m_link[EDITLINKMAX];
@@ -289,7 +310,7 @@ protected:
 
     bool        m_bUndoForce;
     OperUndo    m_undoOper;
-    EditUndo    m_undo[EDITUNDOMAX];
+    std::deque<EditUndo> m_undo;
 };
 
 
@@ -346,6 +346,22 @@ void CMainMap::UpdateMap()
         pm->UpdateTerrain();
 }
 
+// Updates the mini-map following to a change of the terrain between p1 and p2.
+
+void CMainMap::UpdateMap(const Math::Vector& p1, const Math::Vector& p2)
+{
+    CWindow*    pw;
+    CMap*       pm;
+
+    pw = static_cast<CWindow*>(m_interface->SearchControl(EVENT_WINDOW1));
+    if (pw == nullptr)
+        return;
+
+    pm = static_cast<CMap*>(pw->SearchControl(EVENT_OBJECT_MAP));
+    if (pm != nullptr)
+        pm->UpdateTerrain(p1, p2);
+}
+
 // Indicates if the mini-map is visible.
 
 bool CMainMap::GetShowMap()
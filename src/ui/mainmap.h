@@ -39,6 +39,7 @@ public:
     ~CMainMap();
 
     void        UpdateMap();
+    void        UpdateMap(const Math::Vector& p1, const Math::Vector& p2);
     void        CreateMap();
     void        SetFixImage(const char *filename);
     void        FloorColorMap(Gfx::Color floor, Gfx::Color water);
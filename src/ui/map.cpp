@@ -57,6 +57,7 @@ CMap::CMap() : CControl()
     m_mode = 0;
     m_bToy = false;
     m_bDebug = false;
+    m_batch = -1;
 }
 
 // Object's destructor.
@@ -343,6 +344,9 @@ void CMap::Draw()
     i = MAPMAXOBJECT-1;
     if ( m_map[i].bUsed )  // selection:
         DrawFocus(m_map[i].pos, m_map[i].dir, m_map[i].type, m_map[i].color);
+    DrawBatches();
+
+    // The icons are drawn by batches, the selection and the highlight above the others
 
     for ( i=0 ; i<m_totalFix ; i++ ) // fixed objects:
     {
@@ -357,16 +361,19 @@ void CMap::Draw()
             continue;
         DrawObject(m_map[i].pos, m_map[i].dir, m_map[i].type, m_map[i].color, false, false);
     }
+    DrawBatches();
 
     i = MAPMAXOBJECT-1;
     if ( m_map[i].bUsed && i != m_highlightRank )  // selection:
         DrawObject(m_map[i].pos, m_map[i].dir, m_map[i].type, m_map[i].color, true, false);
+    DrawBatches();
 
     if ( m_highlightRank != -1 && m_map[m_highlightRank].bUsed )
     {
         i = m_highlightRank;
         DrawObject(m_map[i].pos, m_map[i].dir, m_map[i].type, m_map[i].color, false, true);
         DrawHighlight(m_map[i].pos);
+        DrawBatches();
     }
 }
 
@@ -469,8 +476,7 @@ void CMap::DrawFocus(Math::Point pos, float dir, ObjectType type, MapColor color
     uv2.x = 126.0f/256.0f;
     uv2.y = 255.0f/256.0f;
 
-    m_engine->SetTexture("button2.png");
-    m_engine->SetState(Gfx::ENG_RSTATE_TTEXTURE_WHITE);
+    SetBatch("button2.png", Gfx::ENG_RSTATE_TTEXTURE_WHITE);
 
     bEnding = false;
     do
@@ -529,8 +535,7 @@ void CMap::DrawObject(Math::Point pos, float dir, ObjectType type, MapColor colo
             return;  // flashes
         }
 
-        m_engine->SetTexture("button2.png");
-        m_engine->SetState(Gfx::ENG_RSTATE_TTEXTURE_BLACK);
+        SetBatch("button2.png", Gfx::ENG_RSTATE_TTEXTURE_BLACK);
         if ( bUp )
         {
             uv1.x = 160.5f/256.0f;  // yellow triangle ^
@@ -561,7 +566,7 @@ void CMap::DrawObject(Math::Point pos, float dir, ObjectType type, MapColor colo
         }
         pos.x -= dim.x/2.0f;
         pos.y -= dim.y/2.0f;
-        DrawIcon(pos, dim, uv1, uv2);
+        AddIcon(pos, dim, uv1, uv2);
         return;
     }
 
@@ -672,8 +677,7 @@ void CMap::DrawObject(Math::Point pos, float dir, ObjectType type, MapColor colo
     {
         if ( bSelect )
         {
-            m_engine->SetTexture("button2.png");
-            m_engine->SetState(Gfx::ENG_RSTATE_NORMAL);
+            SetBatch("button2.png", Gfx::ENG_RSTATE_NORMAL);
             if ( m_bToy )
             {
                 uv1.x = 164.5f/256.0f;  // black pentagon
@@ -698,13 +702,12 @@ void CMap::DrawObject(Math::Point pos, float dir, ObjectType type, MapColor colo
     {
         if ( m_bRadar )
         {
-            m_engine->SetTexture("button2.png");
-            m_engine->SetState(Gfx::ENG_RSTATE_TTEXTURE_WHITE);
+            SetBatch("button2.png", Gfx::ENG_RSTATE_TTEXTURE_WHITE);
             uv1.x =  64.5f/256.0f;  // blue triangle
             uv1.y = 240.5f/256.0f;
             uv2.x =  79.0f/256.0f;
             uv2.y = 255.0f/256.0f;
-            DrawIcon(pos, dim, uv1, uv2);
+            AddIcon(pos, dim, uv1, uv2);
         }
     }
 
@@ -718,53 +721,48 @@ void CMap::DrawObject(Math::Point pos, float dir, ObjectType type, MapColor colo
 
     if ( color == MAPCOLOR_WAYPOINTb )
     {
-        m_engine->SetTexture("button2.png");
-        m_engine->SetState(Gfx::ENG_RSTATE_TTEXTURE_BLACK);
+        SetBatch("button2.png", Gfx::ENG_RSTATE_TTEXTURE_BLACK);
         uv1.x = 192.5f/256.0f;  // blue cross
         uv1.y = 240.5f/256.0f;
         uv2.x = 207.0f/256.0f;
         uv2.y = 255.0f/256.0f;
-        DrawIcon(pos, dim, uv1, uv2);
+        AddIcon(pos, dim, uv1, uv2);
     }
     if ( color == MAPCOLOR_WAYPOINTr )
     {
-        m_engine->SetTexture("button2.png");
-        m_engine->SetState(Gfx::ENG_RSTATE_TTEXTURE_BLACK);
+        SetBatch("button2.png", Gfx::ENG_RSTATE_TTEXTURE_BLACK);
         uv1.x = 208.5f/256.0f;  // red cross
         uv1.y = 240.5f/256.0f;
         uv2.x = 223.0f/256.0f;
         uv2.y = 255.0f/256.0f;
-        DrawIcon(pos, dim, uv1, uv2);
+        AddIcon(pos, dim, uv1, uv2);
     }
     if ( color == MAPCOLOR_WAYPOINTg )
     {
-        m_engine->SetTexture("button2.png");
-        m_engine->SetState(Gfx::ENG_RSTATE_TTEXTURE_BLACK);
+        SetBatch("button2.png", Gfx::ENG_RSTATE_TTEXTURE_BLACK);
         uv1.x = 224.5f/256.0f;  // green cross
         uv1.y = 240.5f/256.0f;
         uv2.x = 239.0f/256.0f;
         uv2.y = 255.0f/256.0f;
-        DrawIcon(pos, dim, uv1, uv2);
+        AddIcon(pos, dim, uv1, uv2);
     }
     if ( color == MAPCOLOR_WAYPOINTy )
     {
-        m_engine->SetTexture("button2.png");
-        m_engine->SetState(Gfx::ENG_RSTATE_TTEXTURE_BLACK);
+        SetBatch("button2.png", Gfx::ENG_RSTATE_TTEXTURE_BLACK);
         uv1.x = 240.5f/256.0f;  // yellow cross
         uv1.y = 240.5f/256.0f;
         uv2.x = 255.0f/256.0f;
         uv2.y = 255.0f/256.0f;
-        DrawIcon(pos, dim, uv1, uv2);
+        AddIcon(pos, dim, uv1, uv2);
     }
     if ( color == MAPCOLOR_WAYPOINTv )
     {
-        m_engine->SetTexture("button2.png");
-        m_engine->SetState(Gfx::ENG_RSTATE_TTEXTURE_BLACK);
+        SetBatch("button2.png", Gfx::ENG_RSTATE_TTEXTURE_BLACK);
         uv1.x = 192.5f/256.0f;  // violet cross
         uv1.y = 224.5f/256.0f;
         uv2.x = 207.0f/256.0f;
         uv2.y = 239.0f/256.0f;
-        DrawIcon(pos, dim, uv1, uv2);
+        AddIcon(pos, dim, uv1, uv2);
     }
 }
 
@@ -779,8 +777,7 @@ void CMap::DrawObjectIcon(Math::Point pos, Math::Point dim, MapColor color,
 
     dp = 0.5f/256.0f;
 
-    m_engine->SetTexture("button3.png");
-    m_engine->SetState(Gfx::ENG_RSTATE_NORMAL);
+    SetBatch("button3.png", Gfx::ENG_RSTATE_NORMAL);
     if ( color == MAPCOLOR_MOVE )
     {
         uv1.x = 160.0f/256.0f;  // blue
@@ -802,7 +799,7 @@ void CMap::DrawObjectIcon(Math::Point pos, Math::Point dim, MapColor color,
     uv1.y += dp;
     uv2.x -= dp;
     uv2.y -= dp;
-    DrawIcon(pos, dim, uv1, uv2);  // background colors
+    AddIcon(pos, dim, uv1, uv2);  // background colors
 
     if ( bHilite )
     {
@@ -863,7 +860,7 @@ void CMap::DrawObjectIcon(Math::Point pos, Math::Point dim, MapColor color,
         if ( type == OBJECT_TEEN34    )  icon = 48;  // stone
         if ( icon == -1 )  return;
 
-        m_engine->SetState(Gfx::ENG_RSTATE_TTEXTURE_WHITE);
+        SetBatch("button3.png", Gfx::ENG_RSTATE_TTEXTURE_WHITE);
         uv1.x = (32.0f/256.0f)*(icon%8);
         uv1.y = (32.0f/256.0f)*(icon/8);
         uv2.x = uv1.x+32.0f/256.0f;
@@ -872,7 +869,7 @@ void CMap::DrawObjectIcon(Math::Point pos, Math::Point dim, MapColor color,
         uv1.y += dp;
         uv2.x -= dp;
         uv2.y -= dp;
-        DrawIcon(pos, dim, uv1, uv2);  // icon
+        AddIcon(pos, dim, uv1, uv2);  // icon
     }
 }
 
@@ -894,65 +891,110 @@ void CMap::DrawHighlight(Math::Point pos)
     dim.x *= 2.0f+cosf(m_time*8.0f)*0.5f;
     dim.y *= 2.0f+cosf(m_time*8.0f)*0.5f;
 
-    m_engine->SetTexture("button2.png");
-    m_engine->SetState(Gfx::ENG_RSTATE_TTEXTURE_BLACK);
+    SetBatch("button2.png", Gfx::ENG_RSTATE_TTEXTURE_BLACK);
     uv1.x = 160.5f/256.0f;  // hilite
     uv1.y = 224.5f/256.0f;
     uv2.x = 175.0f/256.0f;
     uv2.y = 239.0f/256.0f;
     pos.x -= dim.x/2.0f;
     pos.y -= dim.y/2.0f;
-    DrawIcon(pos, dim, uv1, uv2);
+    AddIcon(pos, dim, uv1, uv2);
 }
 
-// Draws a triangular icon.
+// Selects the batch of the icons drawn with a texture and a state.
 
-void CMap::DrawTriangle(Math::Point p1, Math::Point p2, Math::Point p3, Math::Point uv1, Math::Point uv2)
+void CMap::SetBatch(const std::string& texture, int state)
 {
-    Gfx::CDevice* device;
-    Gfx::VertexTex2  vertex[3];  // 1 triangle
+    for (m_batch = 0; m_batch < static_cast<int>( m_batches.size() ); m_batch++)
+    {
+        if (m_batches[m_batch].texture == texture && m_batches[m_batch].state == state)
+            return;
+    }
+
+    MapBatch batch;
+    batch.texture = texture;
+    batch.state = state;
+    m_batches.push_back(batch);
+}
+
+// Draws the icons added to the batches, one batch after the other.
+
+void CMap::DrawBatches()
+{
+    Gfx::CDevice* device = m_engine->GetDevice();
+
+    for (MapBatch& batch : m_batches)
+    {
+        if (batch.vertices.empty())
+            continue;
+
+        m_engine->SetTexture(batch.texture);
+        m_engine->SetState(batch.state);
+        device->DrawPrimitive(Gfx::PRIMITIVE_TRIANGLES, &batch.vertices[0], batch.vertices.size());
+        m_engine->AddStatisticTriangle(batch.vertices.size() / 3);
+
+        batch.vertices.clear();  // keeps the memory for the next frame
+    }
+}
+
+// Adds a rectangular icon to the current batch.
+
+void CMap::AddIcon(Math::Point pos, Math::Point dim, Math::Point uv1, Math::Point uv2)
+{
+    std::vector<Gfx::Vertex>& vertices = m_batches[m_batch].vertices;
+    Math::Point     p1, p2;
     Math::Vector    n;
 
-    device = m_engine->GetDevice();
+    p1.x = pos.x;
+    p1.y = pos.y;
+    p2.x = pos.x + dim.x;
+    p2.y = pos.y + dim.y;
 
     n = Math::Vector(0.0f, 0.0f, -1.0f);  // normal
 
-    vertex[0] = Gfx::VertexTex2(Math::Vector(p1.x, p1.y, 0.0f), n, Math::Point(uv1.x,uv1.y));
-    vertex[1] = Gfx::VertexTex2(Math::Vector(p2.x, p2.y, 0.0f), n, Math::Point(uv1.x,uv2.y));
-    vertex[2] = Gfx::VertexTex2(Math::Vector(p3.x, p3.y, 0.0f), n, Math::Point(uv2.x,uv2.y));
+    // The 2 triangles of CControl::DrawIcon()
+    vertices.push_back(Gfx::Vertex(Math::Vector(p1.x, p1.y, 0.0f), n, Math::Point(uv1.x,uv2.y)));
+    vertices.push_back(Gfx::Vertex(Math::Vector(p1.x, p2.y, 0.0f), n, Math::Point(uv1.x,uv1.y)));
+    vertices.push_back(Gfx::Vertex(Math::Vector(p2.x, p1.y, 0.0f), n, Math::Point(uv2.x,uv2.y)));
+    vertices.push_back(Gfx::Vertex(Math::Vector(p2.x, p1.y, 0.0f), n, Math::Point(uv2.x,uv2.y)));
+    vertices.push_back(Gfx::Vertex(Math::Vector(p1.x, p2.y, 0.0f), n, Math::Point(uv1.x,uv1.y)));
+    vertices.push_back(Gfx::Vertex(Math::Vector(p2.x, p2.y, 0.0f), n, Math::Point(uv2.x,uv1.y)));
+}
+
+// Adds a triangular icon to the current batch.
 
-    device->DrawPrimitive(Gfx::PRIMITIVE_TRIANGLES, vertex, 3);
-    m_engine->AddStatisticTriangle(1);
+void CMap::DrawTriangle(Math::Point p1, Math::Point p2, Math::Point p3, Math::Point uv1, Math::Point uv2)
+{
+    std::vector<Gfx::Vertex>& vertices = m_batches[m_batch].vertices;
+    Math::Vector    n;
+
+    n = Math::Vector(0.0f, 0.0f, -1.0f);  // normal
+
+    vertices.push_back(Gfx::Vertex(Math::Vector(p1.x, p1.y, 0.0f), n, Math::Point(uv1.x,uv1.y)));
+    vertices.push_back(Gfx::Vertex(Math::Vector(p2.x, p2.y, 0.0f), n, Math::Point(uv1.x,uv2.y)));
+    vertices.push_back(Gfx::Vertex(Math::Vector(p3.x, p3.y, 0.0f), n, Math::Point(uv2.x,uv2.y)));
 }
 
-// Draw a pentagon icon (a 5 rating, what!).
+// Adds a pentagon icon (a 5 rating, what!) to the current batch.
 
 void CMap::DrawPenta(Math::Point p1, Math::Point p2, Math::Point p3, Math::Point p4, Math::Point p5, Math::Point uv1, Math::Point uv2)
 {
-    Gfx::CDevice* device;
-    Gfx::VertexTex2  vertex[5];  // 1 pentagon
+    std::vector<Gfx::Vertex>& vertices = m_batches[m_batch].vertices;
+    Gfx::Vertex     vertex[5];
     Math::Vector    n;
 
-    device = m_engine->GetDevice();
-
     n = Math::Vector(0.0f, 0.0f, -1.0f);  // normal
 
-#if 1
-    vertex[0] = Gfx::VertexTex2(Math::Vector(p1.x, p1.y, 0.0f), n, Math::Point(uv1.x,uv1.y));
-    vertex[1] = Gfx::VertexTex2(Math::Vector(p2.x, p2.y, 0.0f), n, Math::Point(uv1.x,uv2.y));
-    vertex[2] = Gfx::VertexTex2(Math::Vector(p5.x, p5.y, 0.0f), n, Math::Point(uv2.x,uv2.y));
-    vertex[3] = Gfx::VertexTex2(Math::Vector(p3.x, p3.y, 0.0f), n, Math::Point(uv2.x,uv2.y));
-    vertex[4] = Gfx::VertexTex2(Math::Vector(p4.x, p4.y, 0.0f), n, Math::Point(uv2.x,uv2.y));
-
-    device->DrawPrimitive(Gfx::PRIMITIVE_TRIANGLE_STRIP, vertex, 5);
-#else
-    vertex[0] = Gfx::VertexTex2(Math::Vector(p2.x, p2.y, 0.0f), n, Math::Point(uv1.x,uv1.y));
-    vertex[1] = Gfx::VertexTex2(Math::Vector(p3.x, p3.y, 0.0f), n, Math::Point(uv1.x,uv2.y));
-    vertex[2] = Gfx::VertexTex2(Math::Vector(p4.x, p4.y, 0.0f), n, Math::Point(uv2.x,uv2.y));
-
-    device->DrawPrimitive(Gfx::PRIMITIVE_TRIANGLES, vertex, 3);
-#endif
-    m_engine->AddStatisticTriangle(3);
+    vertex[0] = Gfx::Vertex(Math::Vector(p1.x, p1.y, 0.0f), n, Math::Point(uv1.x,uv1.y));
+    vertex[1] = Gfx::Vertex(Math::Vector(p2.x, p2.y, 0.0f), n, Math::Point(uv1.x,uv2.y));
+    vertex[2] = Gfx::Vertex(Math::Vector(p5.x, p5.y, 0.0f), n, Math::Point(uv2.x,uv2.y));
+    vertex[3] = Gfx::Vertex(Math::Vector(p3.x, p3.y, 0.0f), n, Math::Point(uv2.x,uv2.y));
+    vertex[4] = Gfx::Vertex(Math::Vector(p4.x, p4.y, 0.0f), n, Math::Point(uv2.x,uv2.y));
+
+    // The 3 triangles of the strip 0 1 2 3 4
+    const int index[9] = { 0, 1, 2,  2, 1, 3,  2, 3, 4 };
+    for (int i = 0; i < 9; i++)
+        vertices.push_back(vertex[index[i]]);
 }
 
 // Draw the vertex array.
@@ -996,13 +1038,11 @@ void CMap::DrawVertex(Math::Point uv1, Math::Point uv2, float zoom)
 }
 
 
-// Updates the field in the map.
+// Computes the relief of the map from the point (bx, by), for all the pixels of the image.
 
-void CMap::UpdateTerrain()
+void CMap::RenderTerrain(CImage* image, int bx, int by)
 {
-    if (m_fixImage[0] != 0) return;  // still image?
-
-    CImage img(Math::IntPoint(256, 256));
+    Math::IntPoint size = image->GetSize();
 
     float scale = m_terrain->GetReliefScale();
     float water = m_water->GetLevel();
@@ -1010,13 +1050,13 @@ void CMap::UpdateTerrain()
     Gfx::Color color;
     color.a = 0.0f;
 
-    for (int y = 0; y < 256; y++)
+    for (int y = 0; y < size.y; y++)
     {
-        for (int x = 0; x < 256; x++)
+        for (int x = 0; x < size.x; x++)
         {
             Math::Vector pos;
-            pos.x =  (static_cast<float>(x) - 128.0f) * m_half / 128.0f;
-            pos.z = -(static_cast<float>(y) - 128.0f) * m_half / 128.0f;
+            pos.x =  (static_cast<float>(bx + x) - 128.0f) * m_half / 128.0f;
+            pos.z = -(static_cast<float>(by + y) - 128.0f) * m_half / 128.0f;
             pos.y = 0.0f;
 
             float level;
@@ -1048,76 +1088,55 @@ void CMap::UpdateTerrain()
                 color.b = Math::Norm(m_waterColor.b + (intensity - 0.5f));
             }
 
-            img.SetPixel(Math::IntPoint(x, y), color);
+            image->SetPixel(Math::IntPoint(x, y), color);
         }
     }
+}
+
+// Updates the field in the map.
+
+void CMap::UpdateTerrain()
+{
+    if (m_fixImage[0] != 0) return;  // still image?
+
+    CImage img(Math::IntPoint(256, 256));
+    RenderTerrain(&img, 0, 0);
 
     m_engine->DeleteTexture("map.png");
     m_engine->LoadTexture("map.png", &img);
 }
 
-// Updates the field in the map.
+// Updates the field in the map, for the pixels from (bx, by) to (ex, ey) excluded.
 
 void CMap::UpdateTerrain(int bx, int by, int ex, int ey)
 {
-    Gfx::Color   color;
-    Math::Vector        pos;
-    float           scale, water, level, intensity;
-    int             x, y;
-
     if ( m_fixImage[0] != 0  )  return;  // still image?
 
-    // TODO: map texture manipulation
-    return;
+    if ( bx < 0   )  bx = 0;
+    if ( by < 0   )  by = 0;
+    if ( ex > 256 )  ex = 256;
+    if ( ey > 256 )  ey = 256;
+    if ( bx >= ex || by >= ey )  return;
 
-    //if ( !m_engine->OpenImage("map.png") )  return;
-    //m_engine->LoadImage();
-
-    scale = m_terrain->GetReliefScale();
-    water = m_water->GetLevel();
-    color.a = 0.0f;
-
-    for ( y=by ; y<ey ; y++ )
-    {
-        for ( x=bx ; x<ex ; x++ )
-        {
-            pos.x =  (static_cast<float>(x)-128.0f)*m_half/128.0f;
-            pos.z = -(static_cast<float>(y)-128.0f)*m_half/128.0f;
-            pos.y = 0.0f;
+    CImage img(Math::IntPoint(ex-bx, ey-by));
+    RenderTerrain(&img, bx, by);
 
-            if ( pos.x >= -m_half && pos.x <= m_half &&
-                 pos.z >= -m_half && pos.z <= m_half )
-            {
-                level = m_terrain->GetFloorLevel(pos, true)/scale;
-            }
-            else
-            {
-                level = 1000.0f;
-            }
-
-            intensity = level/256.0f;
-            if ( intensity < 0.0f )  intensity = 0.0f;
-            if ( intensity > 1.0f )  intensity = 1.0f;
+    // Only the pixels changed are sent to the texture
+    if ( !m_engine->UpdateTexture("map.png", Math::IntPoint(bx, by), &img) )
+        UpdateTerrain();
+}
 
-            if ( level > water )  // on water?
-            {
-                color.r = m_floorColor.r + (intensity-0.5f);
-                color.g = m_floorColor.g + (intensity-0.5f);
-                color.b = m_floorColor.b + (intensity-0.5f);
-            }
-            else    // underwater?
-            {
-                color.r = m_waterColor.r + (intensity-0.5f);
-                color.g = m_waterColor.g + (intensity-0.5f);
-                color.b = m_waterColor.b + (intensity-0.5f);
-            }
+// Updates the field in the map, for the terrain between p1 and p2.
 
-            //m_engine->SetDot(x, y, color);
-        }
-    }
+void CMap::UpdateTerrain(const Math::Vector& p1, const Math::Vector& p2)
+{
+    float bx = Math::Min(p1.x, p2.x) * 128.0f / m_half + 128.0f;
+    float ex = Math::Max(p1.x, p2.x) * 128.0f / m_half + 128.0f;
+    float by = 128.0f - Math::Max(p1.z, p2.z) * 128.0f / m_half;
+    float ey = 128.0f - Math::Min(p1.z, p2.z) * 128.0f / m_half;
 
-    //m_engine->CopyImage();  // copy the ground drawing
-    //m_engine->CloseImage();
+    UpdateTerrain(static_cast<int>(floorf(bx)), static_cast<int>(floorf(by)),
+                  static_cast<int>(ceilf(ex)) + 1, static_cast<int>(ceilf(ey)) + 1);
 }
 
 
@@ -35,6 +35,9 @@
 #include "object/object.h"
 #include "object/robotmain.h"
 
+#include <string>
+#include <vector>
+
 
 namespace Ui {
 
@@ -55,6 +58,14 @@ enum MapColor
     MAPCOLOR_BBOX,
 };
 
+//! Vertices of the icons drawn with the same texture and state
+struct MapBatch
+{
+    std::string         texture;
+    int                 state;
+    std::vector<Gfx::Vertex> vertices;
+};
+
 struct MapObject
 {
     char        bUsed;
@@ -79,6 +90,7 @@ public:
 
     void        UpdateTerrain();
     void        UpdateTerrain(int bx, int by, int ex, int ey);
+    void        UpdateTerrain(const Math::Vector& p1, const Math::Vector& p2);
 
     void        SetFixImage(const char *filename);
     bool        GetFixImage();
@@ -112,9 +124,13 @@ protected:
     void        DrawObject(Math::Point pos, float dir, ObjectType type, MapColor color, bool bSelect, bool bHilite);
     void        DrawObjectIcon(Math::Point pos, Math::Point dim, MapColor color, ObjectType type, bool bHilite);
     void        DrawHighlight(Math::Point pos);
+    void        SetBatch(const std::string& texture, int state);
+    void        DrawBatches();
+    void        AddIcon(Math::Point pos, Math::Point dim, Math::Point uv1, Math::Point uv2);
     void        DrawTriangle(Math::Point p1, Math::Point p2, Math::Point p3, Math::Point uv1, Math::Point uv2);
     void        DrawPenta(Math::Point p1, Math::Point p2, Math::Point p3, Math::Point p4, Math::Point p5, Math::Point uv1, Math::Point uv2);
     void        DrawVertex(Math::Point uv1, Math::Point uv2, float zoom);
+    void        RenderTerrain(CImage* image, int bx, int by);
 
 protected:
     Gfx::CTerrain*  m_terrain;
@@ -140,6 +156,8 @@ protected:
     int             m_mode;
     bool            m_bToy;
     bool            m_bDebug;
+    std::vector<MapBatch> m_batches;
+    int             m_batch;
 };
 
 
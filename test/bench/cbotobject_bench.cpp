@@ -0,0 +1,338 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file cbotobject_bench.cpp
+ * \brief Benchmark of the update of the CBot class "object": all elements vs. one element
+ *
+ * Usage: cbotobject_bench [scans]
+ *
+ * The class "object" is defined with the elements given by CRobotMain, for
+ * objects simulated here (most of them carrying a power cell). A program
+ * scans them with radar() as bots often do, reading a few elements of each
+ * object found:
+ * - "all elements" updates the whole instance each time a variable
+ *   pointing to an object is read, as the single update routine of
+ *   CBotClass::AddUpdateFunc() does;
+ * - "used elements" gives a routine for each element, called only when
+ *   the element is read.
+ * The text given to print() must be the same for both. The time and the
+ * number of elements written by the routines are printed.
+ */
+
+#include "CBot/CBotDll.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+const char* PROGRAM =
+"extern public void t()\n"
+"{\n"
+"    float near = 0, energy = 0;\n"
+"    int   cells = 0;\n"
+"    for ( int k = 0 ; k < SCANS ; k++ )\n"
+"    {\n"
+"        object item = radar(k);\n"
+"        if ( item == null ) continue;\n"
+"        if ( item.category == 2 ) continue;\n"
+"        if ( item.position.x < 50 ) near += item.position.y;\n"
+"        energy += item.energyLevel;\n"
+"        if ( item.energyCell != null && item.energyCell.energyLevel > 0.5 ) cells++;\n"
+"    }\n"
+"    print(near, energy, cells);\n"
+"}\n";
+
+//! Object of the game, as much as the elements of "object" need
+struct Object
+{
+    int         id;
+    int         category;
+    const char* name;           //!< name of the category, given with it
+    float       position[3];
+    float       angle[3];
+    float       energy;
+    float       shield;
+    float       temperature;
+    float       altitude;
+    float       lifeTime;
+    int         material;
+    Object*     power;
+    Object*     load;
+    CBotVar*    botVar;
+};
+
+//! Number of elements of the class "object"
+const int ELEMENTS = 14;
+
+std::vector<Object*> g_objects;
+std::string g_output;
+//! Elements written by the update routines
+long g_updates = 0;
+
+bool rPrint(CBotVar* pVar, CBotVar* pResult, int& Exception, void* pUser)
+{
+    for (; pVar != nullptr; pVar = pVar->GetNext())
+    {
+        g_output += pVar->GetValString();
+        g_output += " ";
+    }
+    return true;
+}
+
+CBotTypResult cPrint(CBotVar* &pVar, void* pUser)
+{
+    return CBotTypResult(0);
+}
+
+bool rRadar(CBotVar* pVar, CBotVar* pResult, int& Exception, void* pUser)
+{
+    Object* object = g_objects[pVar->GetValInt() % g_objects.size()];
+    pResult->SetPointer(object->botVar);
+    return true;
+}
+
+CBotTypResult cRadar(CBotVar* &pVar, void* pUser)
+{
+    return CBotTypResult(CBotTypPointer, "object");
+}
+
+void SetPointer(CBotVar* pVar, Object* object)
+{
+    if ( object == nullptr )  pVar->SetPointer(nullptr);
+    else                      pVar->SetPointer(object->botVar);
+}
+
+//! Updates all the elements, as uObject() did
+void uAll(CBotVar* botThis, void* user)
+{
+    Object* object = static_cast<Object*>(user);
+    g_updates += ELEMENTS;
+
+    CBotVar* pVar = botThis->GetItemList();  // "category"
+    pVar->SetValInt(object->category, object->name);
+    pVar = pVar->GetNext();  // "position"
+    CBotVar* pSub = pVar->GetItemList();
+    for (int i = 0; i < 3; i++, pSub = pSub->GetNext())
+        pSub->SetValFloat(object->position[i]);
+    pVar = pVar->GetNext();  // "orientation"
+    pVar->SetValFloat(object->angle[0]);
+    pVar = pVar->GetNext();  // "pitch"
+    pVar->SetValFloat(object->angle[1]);
+    pVar = pVar->GetNext();  // "roll"
+    pVar->SetValFloat(object->angle[2]);
+    pVar = pVar->GetNext();  // "energyLevel"
+    pVar->SetValFloat(object->energy);
+    pVar = pVar->GetNext();  // "shieldLevel"
+    pVar->SetValFloat(object->shield);
+    pVar = pVar->GetNext();  // "temperature"
+    pVar->SetValFloat(object->temperature);
+    pVar = pVar->GetNext();  // "altitude"
+    pVar->SetValFloat(object->altitude);
+    pVar = pVar->GetNext();  // "lifeTime"
+    pVar->SetValFloat(object->lifeTime);
+    pVar = pVar->GetNext();  // "material"
+    pVar->SetValInt(object->material);
+    pVar = pVar->GetNext();  // "energyCell"
+    SetPointer(pVar, object->power);
+    pVar = pVar->GetNext();  // "load"
+    SetPointer(pVar, object->load);
+    pVar = pVar->GetNext();  // "id"
+    pVar->SetValInt(object->id);
+}
+
+// Updates of one element
+
+void uCategory(CBotVar* pVar, void* user)
+{
+    g_updates++;
+    pVar->SetValInt(static_cast<Object*>(user)->category, static_cast<Object*>(user)->name);
+}
+
+void uPosition(CBotVar* pVar, void* user)
+{
+    g_updates++;
+    CBotVar* pSub = pVar->GetItemList();
+    for (int i = 0; i < 3; i++, pSub = pSub->GetNext())
+        pSub->SetValFloat(static_cast<Object*>(user)->position[i]);
+}
+
+void uEnergyLevel(CBotVar* pVar, void* user)
+{
+    g_updates++;
+    pVar->SetValFloat(static_cast<Object*>(user)->energy);
+}
+
+void uEnergyCell(CBotVar* pVar, void* user)
+{
+    g_updates++;
+    SetPointer(pVar, static_cast<Object*>(user)->power);
+}
+
+void DefineClasses()
+{
+    CBotClass* bc = new CBotClass("point", nullptr, true);
+    bc->AddItem("x", CBotTypFloat);
+    bc->AddItem("y", CBotTypFloat);
+    bc->AddItem("z", CBotTypFloat);
+
+    bc = new CBotClass("object", nullptr);
+    bc->AddItem("category",    CBotTypResult(CBotTypInt), PR_READ);
+    bc->AddItem("position",    CBotTypResult(CBotTypClass, "point"), PR_READ);
+    bc->AddItem("orientation", CBotTypResult(CBotTypFloat), PR_READ);
+    bc->AddItem("pitch",       CBotTypResult(CBotTypFloat), PR_READ);
+    bc->AddItem("roll",        CBotTypResult(CBotTypFloat), PR_READ);
+    bc->AddItem("energyLevel", CBotTypResult(CBotTypFloat), PR_READ);
+    bc->AddItem("shieldLevel", CBotTypResult(CBotTypFloat), PR_READ);
+    bc->AddItem("temperature", CBotTypResult(CBotTypFloat), PR_READ);
+    bc->AddItem("altitude",    CBotTypResult(CBotTypFloat), PR_READ);
+    bc->AddItem("lifeTime",    CBotTypResult(CBotTypFloat), PR_READ);
+    bc->AddItem("material",    CBotTypResult(CBotTypInt), PR_READ);
+    bc->AddItem("energyCell",  CBotTypResult(CBotTypPointer, "object"), PR_READ);
+    bc->AddItem("load",        CBotTypResult(CBotTypPointer, "object"), PR_READ);
+    bc->AddItem("id",          CBotTypResult(CBotTypInt), PR_READ);
+}
+
+//! Chooses how the class "object" is updated
+void SetUpdate(bool byElement)
+{
+    CBotClass* bc = CBotClass::Find("object");
+    bc->AddUpdateFunc(byElement ? nullptr : uAll);
+    bc->AddUpdateFunc("category",    byElement ? uCategory    : nullptr);
+    bc->AddUpdateFunc("position",    byElement ? uPosition    : nullptr);
+    bc->AddUpdateFunc("energyLevel", byElement ? uEnergyLevel : nullptr);
+    bc->AddUpdateFunc("energyCell",  byElement ? uEnergyCell  : nullptr);
+}
+
+Object* CreateObject(int id, int category)
+{
+    Object* object = new Object();
+    object->id = id;
+    object->category = category;
+    object->name = category == 3 ? "PowerCell" : "WheeledGrabber";
+    for (int i = 0; i < 3; i++)
+    {
+        object->position[i] = (id * 37 + i * 11) % 100;
+        object->angle[i] = (id * 13 + i * 7) % 360;
+    }
+    object->energy = (id % 10) / 10.0f;
+    object->shield = 1.0f;
+    object->temperature = 0.0f;
+    object->altitude = 0.0f;
+    object->lifeTime = id;
+    object->material = 0;
+    object->power = nullptr;
+    object->load = nullptr;
+    object->botVar = CBotVar::Create("", CBotTypResult(CBotTypClass, "object"));
+    object->botVar->SetUserPtr(object);
+    object->botVar->SetIdent(id);
+    return object;
+}
+
+struct Result
+{
+    std::string output;
+    int         error;
+    long        updates;
+    double      time;
+};
+
+Result RunProgram(CBotProgram &program, bool byElement)
+{
+    SetUpdate(byElement);
+    g_output.clear();
+    g_updates = 0;
+
+    Result result;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    program.Start("t");
+    while (!program.Run()) ;
+
+    auto end = std::chrono::high_resolution_clock::now();
+    result.time = std::chrono::duration<double, std::milli>(end-start).count();
+    result.error = program.GetError();
+    result.output = g_output;
+    result.updates = g_updates;
+    return result;
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char* argv[])
+{
+    int scans = 100000;
+    if (argc > 1) scans = atoi(argv[1]);
+
+    CBotProgram::Init();
+    CBotProgram::AddFunction("print", rPrint, cPrint);
+    CBotProgram::AddFunction("radar", rRadar, cRadar);
+    CBotProgram::DefineNum("SCANS", scans);
+    DefineClasses();
+
+    for (int i = 0; i < 200; i++)
+    {
+        Object* bot = CreateObject(2*i+1, i % 7 == 0 ? 2 : 1);
+        bot->power = CreateObject(2*i+2, 3);
+        g_objects.push_back(bot);
+    }
+
+    int status = 0;
+    {
+        CBotProgram program;
+        CBotStringArray functions;
+        if (!program.Compile(PROGRAM, functions))
+        {
+            int code, start, end;
+            program.GetError(code, start, end);
+            printf("compilation error %d at %d-%d\n", code, start, end);
+            CBotProgram::Free();
+            return 1;
+        }
+
+        Result all  = RunProgram(program, false);
+        Result used = RunProgram(program, true);
+
+        printf("%-16s %10s %10s %6s\n", "update", "time (ms)", "elements", "error");
+        printf("%-16s %10.1f %10ld %6d\n", "all elements",  all.time,  all.updates,  all.error);
+        printf("%-16s %10.1f %10ld %6d\n", "used elements", used.time, used.updates, used.error);
+        printf("speedup: %.2fx\n", all.time / used.time);
+
+        if (used.output != all.output || used.error != all.error)
+        {
+            printf("results differ\n");
+            status = 1;
+        }
+    }
+
+    for (Object* object : g_objects)
+    {
+        delete object->power->botVar;
+        delete object->power;
+        delete object->botVar;
+        delete object;
+    }
+
+    CBotProgram::Free();
+    return status;
+}
@@ -0,0 +1,266 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file cbotshared_bench.cpp
+ * \brief Benchmark of the compilation of the programs of many robots: each one vs. shared
+ *
+ * Usage: cbotshared_bench [robots [programs]]
+ *
+ * A scene of robots (50 by default) runs a few different programs (4 by
+ * default), each robot with its own instance of the class "object", as
+ * when a level starts or a game is loaded:
+ * - "each" compiles the program of each robot with CBotProgram::Compile();
+ * - "shared" uses CBotProgram::CompileShared(), which compiles each text once.
+ * The time to compile all the programs and the memory they keep are
+ * printed; the programs are then run and the text given to print() by each
+ * robot must be the same in both cases.
+ */
+
+#include "CBot/CBotDll.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+long g_allocated = 0;           //!< bytes allocated and not freed
+
+std::string Program(int n)
+{
+    std::string k = std::to_string(n + 2);
+    return
+        "float Average(float a, float b, float c)\n"
+        "{\n"
+        "    return (a + b + c) / 3;\n"
+        "}\n"
+        "\n"
+        "int Score(int i, int level)\n"
+        "{\n"
+        "    int score = 0;\n"
+        "    if ( i % " + k + " == 0 ) score += level;\n"
+        "    else if ( i % 3 == 1 ) score -= 1;\n"
+        "    else score += i % 5;\n"
+        "    switch ( i % 4 )\n"
+        "    {\n"
+        "        case 0: score *= 2; break;\n"
+        "        case 1: score += 3; break;\n"
+        "        default: score -= 2;\n"
+        "    }\n"
+        "    return score;\n"
+        "}\n"
+        "\n"
+        "string Name(int i)\n"
+        "{\n"
+        "    string name = \"ore\";\n"
+        "    if ( i % 4 == 0 ) name = \"titanium\";\n"
+        "    if ( i % 4 == 1 ) name = \"power cell\";\n"
+        "    if ( i % 4 == 2 ) name = \"uranium\";\n"
+        "    return name + \" \" + i;\n"
+        "}\n"
+        "\n"
+        "boolean Near(float x, float y, float range)\n"
+        "{\n"
+        "    float d = sqrt(x*x + y*y);\n"
+        "    return d < range;\n"
+        "}\n"
+        "\n"
+        "extern void object::Work()\n"
+        "{\n"
+        "    int total = 0;\n"
+        "    float sum = 0;\n"
+        "    int found = 0;\n"
+        "    for ( int i = 0 ; i < 40 ; i++ )\n"
+        "    {\n"
+        "        total += Score(i, id);\n"
+        "        sum = Average(sum, i, total);\n"
+        "        if ( Near(i - 20, id % 7, " + k + ") ) found++;\n"
+        "        int j = i;\n"
+        "        while ( j > " + k + " ) j = j / 2;\n"
+        "        do { j++; } while ( j < 3 );\n"
+        "        if ( i % 10 == 0 ) print(Name(i + id), total, found);\n"
+        "    }\n"
+        "    print(id, total, sum, found);\n"
+        "}\n";
+}
+
+std::string g_output;
+
+bool rPrint(CBotVar* pVar, CBotVar* pResult, int& Exception, void* pUser)
+{
+    for (; pVar != nullptr; pVar = pVar->GetNext())
+    {
+        g_output += pVar->GetValString();
+        g_output += " ";
+    }
+    g_output += "\n";
+    return true;
+}
+
+CBotTypResult cPrint(CBotVar* &pVar, void* pUser)
+{
+    return CBotTypResult(0);
+}
+
+bool rSqrt(CBotVar* pVar, CBotVar* pResult, int& Exception, void* pUser)
+{
+    pResult->SetValFloat(sqrtf(pVar->GetValFloat()));
+    return true;
+}
+
+CBotTypResult cSqrt(CBotVar* &pVar, void* pUser)
+{
+    return CBotTypResult(CBotTypFloat);
+}
+
+struct Result
+{
+    double          time;           //!< compilation of all the programs, ms
+    long            memory;         //!< bytes kept by the programs
+    int             errors;
+    std::string     output;
+};
+
+Result Run(bool shared, const std::vector<std::string>& programs, const std::vector<CBotVar*>& robots)
+{
+    Result result;
+    result.errors = 0;
+
+    std::vector<CBotProgram*> botProgs;
+    long before = g_allocated;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (int i = 0; i < static_cast<int>( robots.size() ); i++)
+    {
+        CBotProgram* botProg = new CBotProgram(robots[i]);
+        const std::string& text = programs[i % programs.size()];
+
+        CBotStringArray functions;
+        bool ok = shared ? botProg->CompileShared(text.c_str(), functions, nullptr, 1)
+                         : botProg->Compile(text.c_str(), functions, nullptr);
+        if (!ok) result.errors++;
+
+        botProgs.push_back(botProg);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    result.time = std::chrono::duration<double, std::milli>(end-start).count();
+    result.memory = g_allocated - before;
+
+    g_output.clear();
+    for (CBotProgram* botProg : botProgs)
+    {
+        botProg->Start("Work");
+        while (!botProg->Run()) ;
+        if (botProg->GetError() != 0) result.errors++;
+    }
+    result.output = g_output;
+
+    for (CBotProgram* botProg : botProgs)
+        delete botProg;
+
+    return result;
+}
+
+} // anonymous namespace
+
+
+// Counts the memory allocated, with the size before each block
+
+void* operator new(size_t size)
+{
+    size_t* p = static_cast<size_t*>(malloc(size + sizeof(max_align_t)));
+    if (p == nullptr) throw std::bad_alloc();
+    *p = size;
+    g_allocated += size;
+    return reinterpret_cast<char*>(p) + sizeof(max_align_t);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (ptr == nullptr) return;
+    size_t* p = reinterpret_cast<size_t*>(static_cast<char*>(ptr) - sizeof(max_align_t));
+    g_allocated -= *p;
+    free(p);
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    operator delete(ptr);
+}
+
+
+int main(int argc, char* argv[])
+{
+    int robotCount = 50;
+    int programCount = 4;
+    if (argc > 1) robotCount = atoi(argv[1]);
+    if (argc > 2) programCount = atoi(argv[2]);
+
+    CBotProgram::Init();
+    CBotProgram::AddFunction("print", rPrint, cPrint);
+    CBotProgram::AddFunction("sqrt", rSqrt, cSqrt);
+
+    CBotClass* bc = new CBotClass("object", nullptr);
+    bc->AddItem("id", CBotTypResult(CBotTypInt), PR_READ);
+
+    std::vector<std::string> programs;
+    for (int i = 0; i < programCount; i++)
+        programs.push_back(Program(i));
+
+    std::vector<CBotVar*> robots;
+    for (int i = 0; i < robotCount; i++)
+    {
+        CBotVar* robot = CBotVar::Create("", CBotTypResult(CBotTypClass, "object"));
+        robot->GetItem("id")->SetValInt(i + 1);
+        robots.push_back(robot);
+    }
+
+    Result each   = Run(false, programs, robots);
+    Result shared = Run(true,  programs, robots);
+
+    printf("%d robots, %d programs\n", robotCount, programCount);
+    printf("%-8s %16s %14s %7s\n", "compile", "time (ms)", "memory (KB)", "errors");
+    printf("%-8s %16.2f %14.1f %7d\n", "each",   each.time,   each.memory / 1024.0,   each.errors);
+    printf("%-8s %16.2f %14.1f %7d\n", "shared", shared.time, shared.memory / 1024.0, shared.errors);
+    printf("speedup: %.2fx, memory: %.2fx less\n", each.time / shared.time,
+           static_cast<double>(each.memory) / shared.memory);
+
+    int status = 0;
+    if (each.output != shared.output || each.errors != 0 || shared.errors != 0)
+    {
+        printf("results differ\n");
+        status = 1;
+    }
+
+    for (CBotVar* robot : robots)
+        delete robot;
+
+    CBotProgram::Free();
+    return status;
+}
@@ -0,0 +1,137 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file cbottoken_bench.cpp
+ * \brief Benchmark of the CBot tokenizer
+ *
+ * Usage: cbottoken_bench [directory [defines [repeat]]]
+ *
+ * All the files of the directory (by default test/cbot/scenarios) are cut
+ * in tokens by CBotToken::CompileTokens(), repeat times (100 by default),
+ * with as many names given by DefineNum as the game defines (400 by
+ * default: the object types, the colors, the research and the error codes);
+ * each word of a program which is not a keyword is looked for in them.
+ * The throughput is printed, with the number of tokens of each kind, which
+ * must not depend on the way the keywords and the names are looked for.
+ */
+
+#include "CBot/CBotDll.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+
+
+namespace {
+
+std::string DefaultDirectory()
+{
+    std::string file = __FILE__;
+    std::string::size_type slash = file.find_last_of("/\\");
+    std::string dir = (slash == std::string::npos) ? "." : file.substr(0, slash);
+    return dir + "/../cbot/scenarios";
+}
+
+std::vector<std::string> ReadFiles(const std::string& directory)
+{
+    std::vector<std::string> texts;
+
+    DIR* dir = opendir(directory.c_str());
+    if (dir == nullptr) return texts;
+
+    while (dirent* entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if (name.size() < 4 || name.substr(name.size() - 4) != ".txt") continue;
+
+        std::ifstream file(directory + "/" + name, std::ios::binary);
+        std::stringstream text;
+        text << file.rdbuf();
+        texts.push_back(text.str());
+    }
+    closedir(dir);
+    return texts;
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char* argv[])
+{
+    std::string directory = (argc > 1) ? argv[1] : DefaultDirectory();
+    int defineCount = (argc > 2) ? atoi(argv[2]) : 400;
+    int repeat      = (argc > 3) ? atoi(argv[3]) : 100;
+
+    std::vector<std::string> texts = ReadFiles(directory);
+    if (texts.empty())
+    {
+        printf("no program in %s\n", directory.c_str());
+        return 1;
+    }
+
+    CBotProgram::Init();                    // defines the error codes
+    for (int i = 0; i < defineCount; i++)
+    {
+        char name[32];
+        sprintf(name, "BenchDefine%d", i);
+        CBotProgram::DefineNum(name, i);
+    }
+
+    long bytes = 0;
+    for (const std::string& text : texts)
+        bytes += text.size();
+
+    long counts[6] = { 0 };                 // by type of token, see TokenTypKeyWord..TokenTypDef
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (int r = 0; r < repeat; r++)
+    {
+        for (const std::string& text : texts)
+        {
+            int error = 0;
+            CBotToken* tokens = CBotToken::CompileTokens(text.c_str(), error);
+            for (CBotToken* p = tokens; p != nullptr; p = p->GetNext())
+            {
+                int type = p->GetType();
+                if (type >= TokenKeyWord) type = TokenTypKeyWord;
+                if (type >= 0 && type < 6) counts[type]++;
+            }
+            CBotToken::Delete(tokens);
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    double time = std::chrono::duration<double>(end-start).count();
+
+    long tokens = counts[0] + counts[1] + counts[2] + counts[3] + counts[4] + counts[5];
+    printf("%d files, %ld bytes, %d names defined, %d times\n",
+           static_cast<int>(texts.size()), bytes, defineCount, repeat);
+    printf("tokens: %ld keywords, %ld numbers, %ld strings, %ld names, %ld defined\n",
+           counts[TokenTypKeyWord] / repeat, counts[TokenTypNum] / repeat, counts[TokenTypString] / repeat,
+           counts[TokenTypVar] / repeat, counts[TokenTypDef] / repeat);
+    printf("%.1f ms, %.2f MB/s, %.2f Mtokens/s\n", time * 1000.0,
+           bytes * repeat / time / 1e6, tokens / time / 1e6);
+
+    CBotProgram::Free();
+    return 0;
+}
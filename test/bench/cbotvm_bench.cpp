@@ -0,0 +1,206 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file cbotvm_bench.cpp
+ * \brief Benchmark of CBot execution: tree of instructions vs. bytecode
+ *
+ * Usage: cbotvm_bench [program.txt [function]]
+ *
+ * The program (by default a copy of test/cbot/scenarios/fibo.txt and a loop
+ * doing arithmetic) is compiled once, then its function (by default "t") is
+ * run to the end three times, in slices of the default number of steps per
+ * Run(), as CScriptFunctions does each frame:
+ * - "tree" runs the instructions through CBotInstr::Execute();
+ * - "bytecode" enables CBotProgram::SetByteCode();
+ * - "bytecode+save" also saves and restores the state of the program
+ *   every 64 slices, as when a game is saved and loaded.
+ * The text given to print() and the errors must be the same for the three
+ * (the state of a program keeps only 16 bits of its integers, which is why
+ * the default program keeps them small).
+ */
+
+#include "CBot/CBotDll.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+
+namespace {
+
+const char* DEFAULT_PROGRAM =
+"extern public int Fibo( int n, boolean b )\n"
+"{\n"
+"    if ( n < 2 ) return n;\n"
+"    int a = Fibo(n-1, b) + Fibo(n-2, false);\n"
+"    if ( b ) print (n + \"=\" + a);\n"
+"    return a;\n"
+"}\n"
+"\n"
+"extern public float Loop( int n )\n"
+"{\n"
+"    float sum = 0;\n"
+"    int   bits = 0;\n"
+"    for ( int k = 0 ; k < n ; k++ )\n"
+"    {\n"
+"        for ( int i = 0 ; i < 1000 ; i++ )\n"
+"        {\n"
+"            if ( i % 3 == 0 && i % 5 != 0 ) continue;\n"
+"            sum += i / 7.0;\n"
+"            bits = (bits ^ (i << (k % 4))) & 0x7fff;\n"
+"            int j = i;\n"
+"            while ( j > 100 ) j = j >> 1;\n"
+"            sum -= j > 50 ? 1 : 0;\n"
+"        }\n"
+"    }\n"
+"    print(\"loop \" + sum + \" \" + bits);\n"
+"    return sum;\n"
+"}\n"
+"\n"
+"extern public void t()\n"
+"{\n"
+"    Fibo( 23, true);\n"
+"    Loop( 200 );\n"
+"}\n";
+
+std::string g_output;
+
+bool rPrint(CBotVar* pVar, CBotVar* pResult, int& Exception, void* pUser)
+{
+    for (; pVar != nullptr; pVar = pVar->GetNext())
+    {
+        g_output += pVar->GetValString();
+        g_output += "\n";
+    }
+    return true;
+}
+
+CBotTypResult cPrint(CBotVar* &pVar, void* pUser)
+{
+    return CBotTypResult(0);
+}
+
+struct Result
+{
+    std::string output;
+    int         error;
+    int         runs;
+    double      time;
+};
+
+Result RunProgram(CBotProgram &program, const char* function, bool byteCode, bool save)
+{
+    CBotProgram::SetByteCode(byteCode);
+    g_output.clear();
+
+    Result result;
+    result.runs = 0;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    program.Start(function);
+    while (true)
+    {
+        result.runs++;
+        if (program.Run()) break;
+
+        if (save && result.runs % 64 == 0)
+        {
+            FILE* file = tmpfile();
+            program.SaveState(file);
+            rewind(file);
+            program.RestoreState(file);
+            fclose(file);
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    result.time = std::chrono::duration<double, std::milli>(end-start).count();
+    result.error = program.GetError();
+    result.output = g_output;
+    return result;
+}
+
+std::string ReadFile(const char* path)
+{
+    std::string text;
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) return text;
+
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        text.append(buffer, n);
+    fclose(file);
+    return text;
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char* argv[])
+{
+    std::string source = DEFAULT_PROGRAM;
+    const char* function = "t";
+    if (argc > 1)
+    {
+        source = ReadFile(argv[1]);
+        if (source.empty())
+        {
+            printf("cannot read %s\n", argv[1]);
+            return 1;
+        }
+    }
+    if (argc > 2) function = argv[2];
+
+    CBotProgram::Init();
+    CBotProgram::AddFunction("print", rPrint, cPrint);
+
+    int status = 0;
+    {
+        CBotProgram program;
+        CBotStringArray functions;
+        if (!program.Compile(source.c_str(), functions))
+        {
+            int code, start, end;
+            program.GetError(code, start, end);
+            printf("compilation error %d at %d-%d\n", code, start, end);
+            CBotProgram::Free();
+            return 1;
+        }
+
+        Result tree  = RunProgram(program, function, false, false);
+        Result bytes = RunProgram(program, function, true, false);
+        Result saved = RunProgram(program, function, true, true);
+
+        printf("%-16s %10s %8s %6s\n", "mode", "time (ms)", "Run()", "error");
+        printf("%-16s %10.1f %8d %6d\n", "tree",          tree.time,  tree.runs,  tree.error);
+        printf("%-16s %10.1f %8d %6d\n", "bytecode",      bytes.time, bytes.runs, bytes.error);
+        printf("%-16s %10.1f %8d %6d\n", "bytecode+save", saved.time, saved.runs, saved.error);
+        printf("speedup: %.2fx\n", tree.time / bytes.time);
+
+        if (bytes.output != tree.output || bytes.error != tree.error ||
+            saved.output != tree.output || saved.error != tree.error)
+        {
+            printf("results differ\n");
+            status = 1;
+        }
+    }
+
+    CBotProgram::Free();
+    return status;
+}
@@ -0,0 +1,383 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file groundspot_bench.cpp
+ * \brief Benchmark of the textures of the ground spots while the ground mark moves
+ *
+ * Usage: groundspot_bench [frames]
+ *
+ * A scene with round ground spots gets a ground mark which grows and moves
+ * over the terrain, as when a building is placed. For each frame, the
+ * textures are made as CEngine::UpdateGroundSpotTextures() did before,
+ * drawing again all the spots of each texture touched with CImage::SetPixel(),
+ * then with CGroundSpotRenderer, drawing only the rectangles of the mark.
+ * The pixels "uploaded" are kept in a copy of each texture, which must be
+ * the same at the end.
+ */
+
+#include "common/image.h"
+#include "common/logger.h"
+
+#include "graphics/engine/engine.h"
+#include "graphics/engine/groundspot.h"
+
+#include "math/func.h"
+
+#include <SDL.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+
+namespace {
+
+const int TEXTURE_COUNT = Gfx::CGroundSpotRenderer::TEXTURE_COUNT;
+const int TEXTURE_SIZE = Gfx::CGroundSpotRenderer::TEXTURE_SIZE;
+
+//! Copy of the textures in the memory of the device
+struct BenchTextures
+{
+    std::vector<unsigned int> pixels[TEXTURE_COUNT];
+    long uploaded;
+
+    BenchTextures()
+    {
+        for (int s = 0; s < TEXTURE_COUNT; s++)
+            pixels[s].assign(TEXTURE_SIZE * TEXTURE_SIZE, 0);
+
+        uploaded = 0;
+    }
+
+    void Upload(int s, int x, int y, CImage* image)
+    {
+        SDL_Surface* surface = image->GetData()->surface;
+        for (int iy = 0; iy < surface->h; iy++)
+        {
+            memcpy(&pixels[s][(y + iy) * TEXTURE_SIZE + x],
+                   static_cast<char*>(surface->pixels) + iy * surface->pitch,
+                   surface->w * 4);
+        }
+        uploaded += surface->w * surface->h;
+    }
+};
+
+//! Textures as made by CEngine::UpdateGroundSpotTextures() before CGroundSpotRenderer
+void UpdateAll(const std::vector<Gfx::EngineGroundSpot>& spots, Gfx::EngineGroundMark& mark,
+               bool first, BenchTextures& textures)
+{
+    for (int s = 0; s < TEXTURE_COUNT; s++)
+    {
+        Math::Point min, max;
+        min.x = (s%4) * 254.0f - 1.0f;  // 1 pixel cover
+        min.y = (s/4) * 254.0f - 1.0f;
+        max.x = min.x + 254.0f + 2.0f;
+        max.y = min.y + 254.0f + 2.0f;
+
+        bool clear = false;
+        bool set   = false;
+
+        int dot = static_cast<int>(mark.drawRadius/2.0f);
+
+        float tu = (mark.drawPos.x+1600.0f)/3200.0f;
+        float tv = (mark.drawPos.z+1600.0f)/3200.0f;  // 0..1
+
+        float cx = (tu*254.0f*4.0f)-0.5f;
+        float cy = (tv*254.0f*4.0f)-0.5f;
+
+        if (dot == 0)
+        {
+            cx += 0.5f;
+            cy += 0.5f;
+        }
+
+        float px = cx-Math::Mod(cx, 1.0f);
+        float py = cy-Math::Mod(cy, 1.0f);  // multiple of 1
+
+        if (first ||
+            (mark.drawRadius != 0.0f    &&
+             px+dot >= min.x && py+dot >= min.y &&
+             px-dot <= max.x && py-dot <= max.y))
+        {
+            clear = true;
+        }
+
+        dot = static_cast<int>(mark.radius/2.0f);
+
+        tu = (mark.pos.x+1600.0f)/3200.0f;
+        tv = (mark.pos.z+1600.0f)/3200.0f;  // 0..1
+
+        cx = (tu*254.0f*4.0f)-0.5f;
+        cy = (tv*254.0f*4.0f)-0.5f;
+
+        if (dot == 0)
+        {
+            cx += 0.5f;
+            cy += 0.5f;
+        }
+
+        px = cx - Math::Mod(cx, 1.0f);
+        py = cy - Math::Mod(cy, 1.0f);  // multiple of 1
+
+        if (mark.draw &&
+            px+dot >= min.x && py+dot >= min.y &&
+            px-dot <= max.x && py-dot <= max.y)
+        {
+            set = true;
+        }
+
+        if (!clear && !set)
+            continue;
+
+        CImage shadowImg(Math::IntPoint(256, 256));
+        shadowImg.Fill(Gfx::IntColor(255, 255, 255, 255));
+
+        for (int i = 0; i < static_cast<int>( spots.size() ); i++)
+        {
+            dot = static_cast<int>(spots[i].radius/2.0f);
+
+            tu = (spots[i].pos.x+1600.0f)/3200.0f;
+            tv = (spots[i].pos.z+1600.0f)/3200.0f;  // 0..1
+
+            cx = (tu*254.0f*4.0f) - 0.5f;
+            cy = (tv*254.0f*4.0f) - 0.5f;
+
+            if (dot == 0)
+            {
+                cx += 0.5f;
+                cy += 0.5f;
+            }
+
+            px = cx-Math::Mod(cx, 1.0f);
+            py = cy-Math::Mod(cy, 1.0f);  // multiple of 1
+
+            if (px+dot < min.x || py+dot < min.y ||
+                px-dot > max.x || py-dot > max.y)
+                continue;
+
+            for (int iy = -dot; iy <= dot; iy++)
+            {
+                for (int ix = -dot; ix <= dot; ix++)
+                {
+                    float ppx = px+ix;
+                    float ppy = py+iy;
+
+                    if (ppx <  min.x || ppy <  min.y ||
+                        ppx >= max.x || ppy >= max.y)
+                        continue;
+
+                    float intensity;
+                    if (dot == 0)
+                        intensity = 0.0f;
+                    else
+                        intensity = Math::Point(ppx-cx, ppy-cy).Length()/dot;
+
+                    Gfx::Color color;
+                    color.r = Math::Norm(spots[i].color.r+intensity);
+                    color.g = Math::Norm(spots[i].color.g+intensity);
+                    color.b = Math::Norm(spots[i].color.b+intensity);
+
+                    ppx -= min.x;  // on the texture
+                    ppy -= min.y;
+
+                    shadowImg.SetPixel(Math::IntPoint(ppx, ppy), color);
+                }
+            }
+        }
+
+        if (set)
+        {
+            dot = static_cast<int>(mark.radius/2.0f);
+
+            tu = (mark.pos.x + 1600.0f) / 3200.0f;
+            tv = (mark.pos.z + 1600.0f) / 3200.0f;  // 0..1
+
+            cx = (tu*254.0f*4.0f)-0.5f;
+            cy = (tv*254.0f*4.0f)-0.5f;
+
+            if (dot == 0)
+            {
+                cx += 0.5f;
+                cy += 0.5f;
+            }
+
+            px = cx-Math::Mod(cx, 1.0f);
+            py = cy-Math::Mod(cy, 1.0f);  // multiple of 1
+
+            for (int iy = -dot; iy <= dot; iy++)
+            {
+                for (int ix = -dot; ix <= dot; ix++)
+                {
+                    float ppx = px+ix;
+                    float ppy = py+iy;
+
+                    if (ppx <  min.x || ppy <  min.y ||
+                        ppx >= max.x || ppy >= max.y)
+                        continue;
+
+                    ppx -= min.x;  // on the texture
+                    ppy -= min.y;
+
+                    float intensity = 1.0f - Math::Point(ix, iy).Length() / dot;
+                    if (intensity <= 0.0f)
+                        continue;
+
+                    intensity *= mark.intensity;
+
+                    int j = (ix+dot) + (iy+dot) * mark.dx;
+                    if (mark.table[j] == 1)  // green ?
+                    {
+                        Gfx::Color color;
+                        color.r = Math::Norm(1.0f-intensity);
+                        color.g = 1.0f;
+                        color.b = Math::Norm(1.0f-intensity);
+                        shadowImg.SetPixel(Math::IntPoint(ppx, ppy), color);
+                    }
+                    if (mark.table[j] == 2)  // red ?
+                    {
+                        Gfx::Color color;
+                        color.r = 1.0f;
+                        color.g = Math::Norm(1.0f-intensity);
+                        color.b = Math::Norm(1.0f-intensity);
+                        shadowImg.SetPixel(Math::IntPoint(ppx, ppy), color);
+                    }
+                }
+            }
+        }
+
+        textures.Upload(s, 0, 0, &shadowImg);
+    }
+}
+
+//! Textures as made by CEngine::UpdateGroundSpotTextures() with CGroundSpotRenderer
+void UpdateRects(Gfx::CGroundSpotRenderer& renderer, const std::vector<Gfx::EngineGroundSpot>& spots,
+                 Gfx::EngineGroundMark& mark, bool first, BenchTextures& textures)
+{
+    if (first)
+        renderer.DrawSpots(spots, nullptr);
+
+    for (int s = 0; s < TEXTURE_COUNT; s++)
+    {
+        Gfx::GroundSpotRect rect;
+        if (first)
+        {
+            rect = Gfx::GroundSpotRect(0, 0, TEXTURE_SIZE, TEXTURE_SIZE);
+        }
+        else
+        {
+            if (mark.drawRadius != 0.0f)
+                rect.Add(Gfx::CGroundSpotRenderer::GetRect(s, mark.drawPos, mark.drawRadius));
+
+            if (mark.draw)
+                rect.Add(Gfx::CGroundSpotRenderer::GetRect(s, mark.pos, mark.radius));
+        }
+
+        if (rect.IsEmpty())
+            continue;
+
+        CImage shadowImg(Math::IntPoint(rect.x2 - rect.x1, rect.y2 - rect.y1));
+        renderer.Render(s, rect, mark, mark.draw, &shadowImg);
+        textures.Upload(s, rect.x1, rect.y1, &shadowImg);
+    }
+}
+
+//! Moves the mark for frame \a n, over a path crossing several textures
+void MoveMark(Gfx::EngineGroundMark& mark, int n)
+{
+    mark.drawPos = mark.pos;
+    mark.drawRadius = mark.radius;
+    mark.drawIntensity = mark.intensity;
+
+    mark.draw = true;
+    mark.pos = Math::Vector(((n*7) % 2800) - 1400.0f, 0.0f, ((n*3) % 2800) - 1400.0f);
+    mark.radius = static_cast<float>(10 + n % 30);
+    mark.intensity = Math::Norm(0.5f + (n % 10) / 20.0f);
+}
+
+double Run(bool rects, int frames, const std::vector<Gfx::EngineGroundSpot>& spots,
+           std::vector<char>& table, BenchTextures& textures)
+{
+    Gfx::CGroundSpotRenderer renderer;
+
+    Gfx::EngineGroundMark mark;
+    mark.dx = mark.dy = 41;
+    mark.table = &table[0];
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        if (i > 0)
+            MoveMark(mark, i);
+
+        if (rects)
+            UpdateRects(renderer, spots, mark, i == 0, textures);
+        else
+            UpdateAll(spots, mark, i == 0, textures);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::micro>(end-start).count() / frames;
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char* argv[])
+{
+    int frames = 200;
+    if (argc > 1) frames = atoi(argv[1]);
+
+    CLogger logger;
+    logger.SetLogLevel(LOG_ERROR);
+
+    srand(0);
+    std::vector<Gfx::EngineGroundSpot> spots;
+    for (int i = 0; i < 200; i++)
+    {
+        Gfx::EngineGroundSpot spot;
+        spot.used = true;
+        spot.color = Gfx::Color(0.1f * (i % 5), 0.1f * (i % 7), 0.1f * (i % 3));
+        spot.pos = Math::Vector(rand() % 3200 - 1600.0f, 0.0f, rand() % 3200 - 1600.0f);
+        spot.radius = static_cast<float>(4 + rand() % 40);
+        spots.push_back(spot);
+    }
+
+    std::vector<char> table(41 * 41);
+    for (int i = 0; i < static_cast<int>( table.size() ); i++)
+        table[i] = static_cast<char>(rand() % 3);
+
+    BenchTextures all, rects;
+    double allTime = Run(false, frames, spots, table, all);
+    double rectsTime = Run(true, frames, spots, table, rects);
+
+    printf("%-10s %15s %16s\n", "textures", "time/frame (us)", "pixels/frame");
+    printf("%-10s %15.1f %16ld\n", "full",  allTime,   all.uploaded / frames);
+    printf("%-10s %15.1f %16ld\n", "rects", rectsTime, rects.uploaded / frames);
+    printf("speedup: %.2fx\n", allTime / rectsTime);
+
+    for (int s = 0; s < TEXTURE_COUNT; s++)
+    {
+        if (all.pixels[s] != rects.pixels[s])
+        {
+            printf("pixels differ in texture %d\n", s);
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,314 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file lightman_bench.cpp
+ * \brief Benchmark of the selection of the dynamic lights of the drawn objects
+ *
+ * Usage: lightman_bench [lights [objects [frames]]]
+ *
+ * A scene has the lights of the level and the flashes of explosions (64
+ * lights by default) around objects of a few types (400 by default), each
+ * drawn in 3 parts. Every frame (100 by default), the flashes change their
+ * intensity and the vehicles move. For each frame:
+ * - "type" selects the lights as CLightManager::UpdateDeviceLights() did
+ *   before, sorting a copy of all the lights each time the type changes,
+ *   with the parts sorted by type in CRenderQueue;
+ * - "object" uses CLightManager with the position of each object, with
+ *   the parts sorted by set of lights, as CEngine::DrawQueue() does.
+ * The time, the lights set in the device and the share of the lights
+ * nearest to each object it is lit by are printed.
+ */
+
+#include "graphics/core/nulldevice.h"
+#include "graphics/engine/engine.h"
+#include "graphics/engine/lightman.h"
+#include "graphics/engine/renderqueue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+
+namespace {
+
+const int PARTS = 3;
+const float FRAME_TIME = 1.0f/30.0f;
+//! Distance moved by the vehicles each frame
+const float VEHICLE_STEP = 0.5f;
+
+//! Device counting the lights set
+class CBenchDevice : public Gfx::CNullDevice
+{
+public:
+    CBenchDevice() : m_setLights(0) {}
+
+    void SetLight(int index, const Gfx::Light &light) override
+    {
+        Gfx::CNullDevice::SetLight(index, light);
+        m_setLights++;
+    }
+
+    long m_setLights;
+};
+
+struct BenchObject
+{
+    Gfx::EngineObjectType   type;
+    Math::Vector            pos;
+    //! Ranks of the lights nearest to the object, found by brute force
+    std::vector<int>        nearest;
+};
+
+float Random(float min, float max)
+{
+    return min + (max - min) * rand() / RAND_MAX;
+}
+
+bool IsIncluded(const Gfx::DynamicLight& light, Gfx::EngineObjectType type)
+{
+    bool enabled = true;
+    if (light.includeType != Gfx::ENG_OBJTYPE_NULL)
+        enabled = (light.includeType == type);
+    if (light.excludeType != Gfx::ENG_OBJTYPE_NULL)
+        enabled = (light.excludeType != type);
+    return enabled;
+}
+
+//! Lights as selected by CLightManager::UpdateDeviceLights() before, for one object type
+void SelectByType(const std::vector<Gfx::DynamicLight>& lights, Gfx::EngineObjectType type,
+                  const Math::Vector& eye, std::vector<int>& lightMap, CBenchDevice& device)
+{
+    std::vector<Gfx::DynamicLight> sortedLights = lights;
+    std::sort(sortedLights.begin(), sortedLights.end(), [&](const Gfx::DynamicLight& a, const Gfx::DynamicLight& b)
+    {
+        float wa = IsIncluded(a, type) ? (a.light.position - eye).Length() * a.priority : 10000.0f;
+        float wb = IsIncluded(b, type) ? (b.light.position - eye).Length() * b.priority : 10000.0f;
+        return wa < wb;
+    });
+
+    int index = 0;
+    for (const Gfx::DynamicLight& light : sortedLights)
+    {
+        if (index >= static_cast<int>( lightMap.size() ))
+            break;
+        if (IsIncluded(light, type))
+            lightMap[index++] = light.rank;
+    }
+    for (; index < static_cast<int>( lightMap.size() ); index++)
+        lightMap[index] = -1;
+
+    for (int i = 0; i < static_cast<int>( lightMap.size() ); i++)
+    {
+        if (lightMap[i] != -1)
+        {
+            device.SetLight(i, lights[lightMap[i]].light);
+            device.SetLightEnabled(i, true);
+        }
+        else
+        {
+            device.SetLightEnabled(i, false);
+        }
+    }
+}
+
+//! Counts the lights of the device among the nearest to the object
+int CountNearest(const BenchObject& obj, const std::vector<Gfx::DynamicLight>& lights, CBenchDevice& device)
+{
+    int found = 0;
+    for (int i = 0; i < device.GetMaxLightCount(); i++)
+    {
+        if (! device.GetLightEnabled(i))
+            continue;
+
+        for (int rank : obj.nearest)
+        {
+            if (Math::VectorsEqual(device.GetLight(i).position, lights[rank].light.position))
+            {
+                found++;
+                break;
+            }
+        }
+    }
+    return found;
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char* argv[])
+{
+    int lightCount  = (argc > 1) ? atoi(argv[1]) : 64;
+    int objectCount = (argc > 2) ? atoi(argv[2]) : 400;
+    int frames      = (argc > 3) ? atoi(argv[3]) : 100;
+
+    Gfx::CEngine engine(nullptr);
+    CBenchDevice typeDevice, objectDevice;
+    typeDevice.Create();
+    objectDevice.Create();
+    Gfx::CLightManager lightManager(&engine);
+    lightManager.SetDevice(&objectDevice);
+    int slots = objectDevice.GetMaxLightCount();
+
+    srand(1);
+
+    // Lights of the level, then flashes around a few explosions, some only for the terrain
+    std::vector<Gfx::DynamicLight> lights;
+    for (int i = 0; i < lightCount; i++)
+    {
+        Gfx::DynamicLight light;
+        light.rank = i;
+        light.used = light.enabled = true;
+        light.priority = (i < 3) ? Gfx::LIGHT_PRI_HIGH : Gfx::LIGHT_PRI_LOW;
+        light.light.type = (i < 3) ? Gfx::LIGHT_SPOT : Gfx::LIGHT_POINT;
+        light.includeType = (i % 4 == 3) ? Gfx::ENG_OBJTYPE_TERRAIN : Gfx::ENG_OBJTYPE_NULL;
+
+        float cx = -800.0f + 400.0f * (i % 5);
+        float cz = -800.0f + 400.0f * (i / 5 % 5);
+        light.light.position = (i < 3) ? Math::Vector(Random(-800.0f, 800.0f), 400.0f, Random(-800.0f, 800.0f))
+                                       : Math::Vector(cx + Random(-60.0f, 60.0f), Random(0.0f, 20.0f), cz + Random(-60.0f, 60.0f));
+
+        int rank = lightManager.CreateLight(light.priority);
+        lightManager.SetLight(rank, light.light);
+        lightManager.SetLightIncludeType(rank, light.includeType);
+        lights.push_back(light);
+    }
+
+    const Gfx::EngineObjectType types[] = { Gfx::ENG_OBJTYPE_TERRAIN, Gfx::ENG_OBJTYPE_FIX,
+                                            Gfx::ENG_OBJTYPE_VEHICLE, Gfx::ENG_OBJTYPE_DESCENDANT };
+    std::vector<BenchObject> objects(objectCount);
+    for (BenchObject& obj : objects)
+    {
+        obj.type = types[rand() % 4];
+        obj.pos = Math::Vector(Random(-1000.0f, 1000.0f), 0.0f, Random(-1000.0f, 1000.0f));
+
+        std::vector<std::pair<float, int>> weights;
+        for (const Gfx::DynamicLight& light : lights)
+        {
+            if (IsIncluded(light, obj.type))
+                weights.push_back(std::make_pair((light.light.position - obj.pos).Length() * light.priority, light.rank));
+        }
+        std::sort(weights.begin(), weights.end());
+        for (int i = 0; i < slots && i < static_cast<int>( weights.size() ); i++)
+            obj.nearest.push_back(weights[i].second);
+    }
+
+    // Tier 2 and 4 of the parts, one texture per part
+    std::vector<Gfx::EngineBaseObjTexTier> textures(PARTS);
+    for (int part = 0; part < PARTS; part++)
+        textures[part].tex1.id = part + 1;
+    Gfx::EngineBaseObjDataTier data;
+
+    std::vector<Math::Vector> startPos;
+    for (const BenchObject& obj : objects)
+        startPos.push_back(obj.pos);
+
+    Math::Vector eye(0.0f, 50.0f, -900.0f);
+    std::vector<int> lightMap(slots, -1);
+    long typeFound = 0, objectFound = 0, wanted = 0;
+    Gfx::CRenderQueue queue;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int f = 0; f < frames; f++)
+    {
+        for (Gfx::DynamicLight& light : lights)
+        {
+            if (light.rank % 8 == 4)
+                light.light.diffuse = Gfx::Color(0.5f, 0.5f, 0.5f) * (0.75f + 0.25f * sinf(f + light.rank));
+        }
+
+        // The parts were sorted by type
+        queue.Clear();
+        for (int i = 0; i < objectCount; i++)
+        {
+            for (int part = 0; part < PARTS; part++)
+                queue.Add(i, objects[i].type, objects[i].type, &textures[part], &data, false);
+        }
+        queue.Sort();
+
+        int lastType = -1;
+        for (const Gfx::RenderItem& item : queue.GetItems())
+        {
+            const BenchObject& obj = objects[item.objRank];
+            if (obj.type != lastType)
+            {
+                SelectByType(lights, obj.type, eye, lightMap, typeDevice);
+                lastType = obj.type;
+            }
+            if (f == 0 && item.tex == &textures[0])
+                typeFound += CountNearest(obj, lights, typeDevice);
+        }
+    }
+
+    auto middle = std::chrono::high_resolution_clock::now();
+    for (int f = 0; f < frames; f++)
+    {
+        for (const Gfx::DynamicLight& light : lights)
+        {
+            if (light.rank % 8 == 4)
+                lightManager.SetLightIntensity(light.rank, 0.75f + 0.25f * sinf(f + light.rank));
+        }
+        lightManager.UpdateProgression(FRAME_TIME);
+        lightManager.UpdateLights();
+
+        // As CEngine::QueueObjects() and CEngine::DrawQueue()
+        queue.Clear();
+        for (int i = 0; i < objectCount; i++)
+        {
+            BenchObject& obj = objects[i];
+            if (obj.type == Gfx::ENG_OBJTYPE_VEHICLE)
+                obj.pos = startPos[i] + Math::Vector(f * VEHICLE_STEP, 0.0f, 0.0f);
+
+            unsigned int lightSet = lightManager.GetLightSet(obj.type, obj.pos, i);
+            for (int part = 0; part < PARTS; part++)
+                queue.Add(i, obj.type, lightSet, &textures[part], &data, false);
+        }
+        queue.Sort();
+
+        int lastObj = -1;
+        for (const Gfx::RenderItem& item : queue.GetItems())
+        {
+            const BenchObject& obj = objects[item.objRank];
+            if (item.objRank != lastObj)
+            {
+                lightManager.UpdateDeviceLights(obj.type, obj.pos, item.objRank);
+                lastObj = item.objRank;
+            }
+            if (f == 0 && item.tex == &textures[0])
+            {
+                objectFound += CountNearest(obj, lights, objectDevice);
+                wanted += obj.nearest.size();
+            }
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    double typeTime   = std::chrono::duration<double, std::micro>(middle-start).count() / frames;
+    double objectTime = std::chrono::duration<double, std::micro>(end-middle).count() / frames;
+
+    printf("%d lights, %d objects in %d parts, %d device lights, %d frames\n",
+           lightCount, objectCount, PARTS, slots, frames);
+    printf("%-8s %15s %16s %10s\n", "select", "time/frame (us)", "SetLight/frame", "nearest");
+    printf("%-8s %15.1f %16ld %9.1f%%\n", "type",   typeTime,   typeDevice.m_setLights / frames,
+           100.0 * typeFound / wanted);
+    printf("%-8s %15.1f %16ld %9.1f%%\n", "object", objectTime, objectDevice.m_setLights / frames,
+           100.0 * objectFound / wanted);
+
+    return (objectFound == wanted) ? 0 : 1;
+}
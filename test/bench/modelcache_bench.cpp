@@ -0,0 +1,252 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file modelcache_bench.cpp
+ * \brief Benchmark of the loading of models: model files vs. precompiled models
+ *
+ * Usage: modelcache_bench [-n passes] model_file...
+ *
+ * For example, with the models of the game:
+ *   modelcache_bench data/models/\*.mod
+ *
+ * Each model is written as a precompiled model (.cmod) in the working
+ * directory, then all the models are loaded several times (10 by default):
+ * - "mod" reads the model file and adds the triangles one by one to a
+ *   base object, as CModelManager did;
+ * - "cache" maps the precompiled model and adds each group of triangles
+ *   with one call, as CModelManager does when the .cmod file is there.
+ * Only the part of CEngine used to load models is linked
+ * (stubs/engine_stub.cpp). Both must give the same base objects.
+ */
+
+#include "common/logger.h"
+
+#include "graphics/core/nulldevice.h"
+#include "graphics/engine/engine.h"
+#include "graphics/engine/modelcache.h"
+#include "graphics/engine/modelfile.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+class CBenchEngine : public Gfx::CEngine
+{
+public:
+    CBenchEngine() : Gfx::CEngine(nullptr) {}
+
+    //! Returns true if both base objects have the same tiers and vertices
+    bool IsSameBaseObject(int baseObjRank1, int baseObjRank2)
+    {
+        const Gfx::EngineBaseObject& a = m_baseObjects[baseObjRank1];
+        const Gfx::EngineBaseObject& b = m_baseObjects[baseObjRank2];
+        if (a.next.size() != b.next.size() || a.totalTriangles != b.totalTriangles)
+            return false;
+
+        for (int l2 = 0; l2 < static_cast<int>( a.next.size() ); l2++)
+        {
+            const Gfx::EngineBaseObjTexTier& a2 = a.next[l2];
+            const Gfx::EngineBaseObjTexTier& b2 = b.next[l2];
+            if (a2.tex1Name != b2.tex1Name || a2.tex2Name != b2.tex2Name || a2.next.size() != b2.next.size())
+                return false;
+
+            for (int l3 = 0; l3 < static_cast<int>( a2.next.size() ); l3++)
+            {
+                const Gfx::EngineBaseObjLODTier& a3 = a2.next[l3];
+                const Gfx::EngineBaseObjLODTier& b3 = b2.next[l3];
+                if (a3.lodLevel != b3.lodLevel || a3.next.size() != b3.next.size())
+                    return false;
+
+                for (int l4 = 0; l4 < static_cast<int>( a3.next.size() ); l4++)
+                {
+                    const Gfx::EngineBaseObjDataTier& a4 = a3.next[l4];
+                    const Gfx::EngineBaseObjDataTier& b4 = b3.next[l4];
+                    if (a4.state != b4.state || a4.material != b4.material ||
+                        a4.vertices.size() != b4.vertices.size())
+                        return false;
+
+                    for (int i = 0; i < static_cast<int>( a4.vertices.size() ); i++)
+                    {
+                        if (memcmp(&a4.vertices[i], &b4.vertices[i], sizeof(Gfx::VertexTex2)) != 0)
+                            return false;
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+};
+
+//! Loads a model file, as CModelManager::LoadModelFile()
+int LoadModelFile(CBenchEngine& engine, const std::string& fileName)
+{
+    Gfx::CModelFile modelFile;
+    if (!modelFile.ReadModel(fileName))
+        return -1;
+
+    int baseObjRank = engine.CreateBaseObject();
+    const std::vector<Gfx::ModelTriangle>& triangles = modelFile.GetTriangles();
+
+    std::vector<Gfx::VertexTex2> vs(3, Gfx::VertexTex2());
+    for (const Gfx::ModelTriangle& t : triangles)
+    {
+        std::string tex2Name = t.variableTex2 ? "dirty00.png" : t.tex2Name;
+
+        vs[0] = t.p1;
+        vs[1] = t.p2;
+        vs[2] = t.p3;
+
+        engine.AddBaseObjTriangles(baseObjRank, vs, Gfx::ENG_TRIANGLE_TYPE_TRIANGLES,
+                                   t.material, t.state, t.tex1Name, tex2Name, t.lodLevel, false);
+    }
+
+    return baseObjRank;
+}
+
+//! Loads a precompiled model, as CModelManager::LoadCachedModel()
+int LoadCachedModel(CBenchEngine& engine, const std::string& modelFileName, const std::string& fileName)
+{
+    Gfx::ModelCacheSource source;
+    if (!Gfx::CModelCache::GetSource(modelFileName, source))
+        return -1;
+
+    Gfx::CModelCache cache;
+    if (!cache.Open(fileName, source))
+        return -1;
+
+    int baseObjRank = engine.CreateBaseObject();
+
+    for (int i = 0; i < cache.GetGroupCount(); i++)
+    {
+        const Gfx::ModelCacheGroup& group = cache.GetGroup(i);
+        std::string tex2Name = group.variableTex2 ? "dirty00.png" : group.tex2Name;
+
+        engine.AddBaseObjTriangles(baseObjRank, cache.GetVertices(group), group.vertexCount,
+                                   Gfx::ENG_TRIANGLE_TYPE_TRIANGLES, group.material, group.state,
+                                   group.tex1Name, tex2Name, static_cast<Gfx::LODLevel>(group.lodLevel), false);
+    }
+
+    return baseObjRank;
+}
+
+//! Loads all the models, \a passes times, and returns the time of one pass in ms
+double Run(CBenchEngine& engine, const std::vector<std::string>& modelFiles,
+           const std::vector<std::string>& cacheFiles, bool cached, int passes)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int pass = 0; pass < passes; pass++)
+    {
+        for (int i = 0; i < static_cast<int>( modelFiles.size() ); i++)
+        {
+            int baseObjRank = cached ? LoadCachedModel(engine, modelFiles[i], cacheFiles[i])
+                                     : LoadModelFile(engine, modelFiles[i]);
+            if (baseObjRank != -1)
+                engine.DeleteBaseObject(baseObjRank);
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end-start).count() / passes;
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char* argv[])
+{
+    int passes = 10;
+    std::vector<std::string> modelFiles;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i+1 < argc)
+            passes = atoi(argv[++i]);
+        else
+            modelFiles.push_back(argv[i]);
+    }
+
+    if (modelFiles.empty())
+    {
+        printf("Usage: %s [-n passes] model_file...\n", argv[0]);
+        return 1;
+    }
+
+    CLogger logger;
+    logger.SetLogLevel(LOG_ERROR);
+
+    Gfx::CNullDevice device;
+    CBenchEngine engine;
+    engine.SetDevice(&device);
+
+    std::vector<std::string> cacheFiles;
+    long triangles = 0;
+    for (int i = 0; i < static_cast<int>( modelFiles.size() ); i++)
+    {
+        Gfx::CModelFile modelFile;
+        if (!modelFile.ReadModel(modelFiles[i]))
+        {
+            printf("cannot read %s\n", modelFiles[i].c_str());
+            return 1;
+        }
+
+        char name[40];
+        sprintf(name, "modelcache_bench_%d.cmod", i);
+        Gfx::ModelCacheSource source;
+        if (!Gfx::CModelCache::GetSource(modelFiles[i], source) ||
+            !Gfx::CModelCache::Write(modelFile.GetTriangles(), source, name))
+        {
+            printf("cannot write %s\n", name);
+            return 1;
+        }
+
+        cacheFiles.push_back(name);
+        triangles += modelFile.GetTriangleCount();
+    }
+
+    int status = 0;
+    for (int i = 0; i < static_cast<int>( modelFiles.size() ); i++)
+    {
+        int model = LoadModelFile(engine, modelFiles[i]);
+        int cached = LoadCachedModel(engine, modelFiles[i], cacheFiles[i]);
+        if (!engine.IsSameBaseObject(model, cached))
+        {
+            printf("base objects differ for %s\n", modelFiles[i].c_str());
+            status = 1;
+        }
+        engine.DeleteBaseObject(model);
+        engine.DeleteBaseObject(cached);
+    }
+
+    double modTime   = Run(engine, modelFiles, cacheFiles, false, passes);
+    double cacheTime = Run(engine, modelFiles, cacheFiles, true, passes);
+
+    printf("%d models, %ld triangles\n", static_cast<int>( modelFiles.size() ), triangles);
+    printf("%-8s %16s\n", "loading", "time/pass (ms)");
+    printf("%-8s %16.2f\n", "mod",   modTime);
+    printf("%-8s %16.2f\n", "cache", cacheTime);
+    printf("speedup: %.2fx\n", modTime / cacheTime);
+
+    for (const std::string& cacheFile : cacheFiles)
+        remove(cacheFile.c_str());
+
+    return status;
+}
@@ -0,0 +1,269 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file navgrid_bench.cpp
+ * \brief Benchmark of path finding: per-robot terrain bitmaps vs. CNavGrid, and CNavPlanner
+ *
+ * Usage: navgrid_bench [relief.png [factor]]...
+ *
+ * Every relief image (for instance those of the shipped levels, found in
+ * the textures directory of the data) is loaded as CTerrain::LoadRelief()
+ * does; without arguments a synthetic maze is used. Then a group of robots
+ * looks for paths across the terrain at the same time:
+ * - "sampling" is the time spent sampling the terrain slopes, once for each
+ *   robot as CTaskGoto did before, and once for all with the shared grid;
+ * - "planning" is the time of the A* searches, with the number of frames
+ *   needed at the budget of CTaskGoto.
+ */
+
+#include "object/navgrid.h"
+#include "object/navplanner.h"
+
+#include "common/image.h"
+
+#include "math/const.h"
+#include "math/geometry.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+
+namespace {
+
+const int   ROBOTS = 20;
+const int   BUDGET = 2000;      // cells explored per frame, as CTaskGoto
+const float SLOPE  = 20.0f*Math::PI/180.0f;  // limit for wheels
+
+struct Relief
+{
+    int                size;    // number of points along one axis
+    float              brick;   // distance between two points
+    std::vector<float> height;
+};
+
+float GetHeight(Relief& relief, int x, int y)
+{
+    if (x < 0 || x >= relief.size || y < 0 || y >= relief.size) return 0.0f;
+    return relief.height[x+y*relief.size];
+}
+
+Math::Vector GetVector(Relief& relief, int x, int y)
+{
+    return Math::Vector(x*relief.brick-1600.0f, GetHeight(relief, x, y), y*relief.brick-1600.0f);
+}
+
+//! Same computation as CTerrain::GetFineSlope()
+float GetSlope(Relief& relief, const Math::Vector &p)
+{
+    int x = static_cast<int>((p.x+1600.0f)/relief.brick);
+    int y = static_cast<int>((p.z+1600.0f)/relief.brick);
+
+    Math::Vector p1 = GetVector(relief, x+0, y+0);
+    Math::Vector p2 = GetVector(relief, x+1, y+0);
+    Math::Vector p3 = GetVector(relief, x+0, y+1);
+    Math::Vector p4 = GetVector(relief, x+1, y+1);
+
+    Math::Vector n;
+    if ( fabs(p.z - p2.z) < fabs(p.x - p2.x) )
+        n = Math::NormalToPlane(p1,p2,p3);
+    else
+        n = Math::NormalToPlane(p2,p4,p3);
+
+    return fabs(Math::RotateAngle(Math::Point(n.x, n.z).Length(), n.y) - Math::PI/2.0f);
+}
+
+bool Sampler(NavClass cls, const Math::Vector &pos, void* user)
+{
+    return GetSlope(*static_cast<Relief*>(user), pos) <= SLOPE;
+}
+
+bool LoadRelief(Relief& relief, const char* fileName, float factor)
+{
+    CImage img;
+    if (! img.Load(fileName)) return false;
+
+    relief.size  = img.GetSize().x;
+    relief.brick = 3200.0f/(relief.size-1);
+    relief.height.resize(relief.size*relief.size);
+    for (int y = 0; y < relief.size; y++)
+    {
+        for (int x = 0; x < relief.size; x++)
+        {
+            Gfx::IntColor color = img.GetPixelInt(Math::IntPoint(x, relief.size - y - 1));
+            float avg = (color.r + color.g + color.b) / 3.0f;
+            relief.height[x+y*relief.size] = (255.0f - avg) * factor;
+        }
+    }
+    return true;
+}
+
+//! Rolling hills crossed by long walls with a few gaps
+void MakeMaze(Relief& relief)
+{
+    relief.size  = 161;
+    relief.brick = 20.0f;
+    relief.height.resize(relief.size*relief.size);
+    for (int y = 0; y < relief.size; y++)
+    {
+        for (int x = 0; x < relief.size; x++)
+        {
+            float h = 5.0f*sinf(x*0.2f)*cosf(y*0.15f);
+            if (x % 20 == 10 && (y/12) % 4 != x/20 % 4) h += 60.0f;
+            if (y % 20 == 10 && (x/12) % 5 != y/20 % 5) h += 60.0f;
+            relief.height[x+y*relief.size] = h;
+        }
+    }
+}
+
+struct Trip
+{
+    Math::IntPoint start, goal;
+};
+
+int Rect(Trip& trip, int& x0, int& y0, int& x1, int& y1)
+{
+    // As CTaskGoto::BeamStart(): the rectangle around start and goal
+    x0 = std::max(std::min(trip.start.x, trip.goal.x)-10, 0);
+    y0 = std::max(std::min(trip.start.y, trip.goal.y)-10, 0);
+    x1 = std::min(std::max(trip.start.x, trip.goal.x)+10, NAV_SIZE-1);
+    y1 = std::min(std::max(trip.start.y, trip.goal.y)+10, NAV_SIZE-1);
+    return (x1-x0+1)*(y1-y0+1);
+}
+
+bool Blocked(int x, int y, void* user)
+{
+    return static_cast<CNavGrid*>(user)->IsBlocked(NAV_WHEELS, x, y);
+}
+
+void Run(Relief& relief, const char* name)
+{
+    CNavGrid grid;
+    grid.SetSampler(Sampler, &relief);
+
+    std::vector<Trip> trips;
+    srand(1);
+    while (static_cast<int>(trips.size()) < ROBOTS)
+    {
+        Trip trip;
+        trip.start = Math::IntPoint(40+rand()%(NAV_SIZE-80), 40+rand()%(NAV_SIZE-80));
+        trip.goal  = Math::IntPoint(40+rand()%(NAV_SIZE-80), 40+rand()%(NAV_SIZE-80));
+        if (grid.IsBlocked(NAV_WHEELS, trip.start.x, trip.start.y)) continue;
+        if (grid.IsBlocked(NAV_WHEELS, trip.goal.x, trip.goal.y)) continue;
+        trips.push_back(trip);
+    }
+
+    // Sampling: every robot on its own
+    auto start = std::chrono::high_resolution_clock::now();
+    int blocked = 0;
+    for (int i = 0; i < ROBOTS; i++)
+    {
+        int x0, y0, x1, y1;
+        Rect(trips[i], x0, y0, x1, y1);
+        for (int y = y0; y <= y1; y++)
+        {
+            for (int x = x0; x <= x1; x++)
+            {
+                Math::Vector p(x*NAV_CELL-1600.0f, 0.0f, y*NAV_CELL-1600.0f);
+                if (! Sampler(NAV_WHEELS, p, &relief)) blocked++;
+            }
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double own = std::chrono::duration<double, std::milli>(end-start).count();
+
+    // Sampling: shared grid
+    grid.Flush();
+    start = std::chrono::high_resolution_clock::now();
+    int sharedBlocked = 0;
+    for (int i = 0; i < ROBOTS; i++)
+    {
+        int x0, y0, x1, y1;
+        Rect(trips[i], x0, y0, x1, y1);
+        for (int y = y0; y <= y1; y++)
+        {
+            for (int x = x0; x <= x1; x++)
+            {
+                if (grid.IsBlocked(NAV_WHEELS, x, y)) sharedBlocked++;
+            }
+        }
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double shared = std::chrono::duration<double, std::milli>(end-start).count();
+
+    // Planning
+    CNavPlanner planner;
+    int found = 0, frames = 0, maxFrames = 0, expanded = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < ROBOTS; i++)
+    {
+        planner.Start(NAV_SIZE, trips[i].start, trips[i].goal, 0.0f, Blocked, &grid);
+        Error err = ERR_CONTINUE;
+        int n = 0;
+        while (err == ERR_CONTINUE)
+        {
+            err = planner.Step(BUDGET);
+            n++;
+        }
+        if (err == ERR_OK) found++;
+        frames += n;
+        maxFrames = std::max(maxFrames, n);
+        expanded += planner.GetExpandedCount();
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double planning = std::chrono::duration<double, std::milli>(end-start).count();
+
+    printf("%s\n", name);
+    printf("  sampling  per robot %9.2f ms   shared %9.2f ms  (%.1fx)%s\n",
+           own, shared, own/shared, blocked == sharedBlocked ? "" : "  MISMATCH");
+    printf("  planning  %d/%d paths found, %9.2f ms, %d cells, %.1f frames avg, %d max\n",
+           found, ROBOTS, planning, expanded, static_cast<float>(frames)/ROBOTS, maxFrames);
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        Relief relief;
+        MakeMaze(relief);
+        Run(relief, "synthetic maze");
+        return 0;
+    }
+
+    for (int i = 1; i < argc; i++)
+    {
+        float factor = 1.0f;
+        const char* name = argv[i];
+        if (i+1 < argc && atof(argv[i+1]) > 0.0f)
+            factor = atof(argv[++i]);
+
+        Relief relief;
+        if (! LoadRelief(relief, name, factor))
+        {
+            printf("%s: could not load\n", name);
+            continue;
+        }
+        Run(relief, name);
+    }
+
+    return 0;
+}
+
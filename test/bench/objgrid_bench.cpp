@@ -0,0 +1,152 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file objgrid_bench.cpp
+ * \brief Benchmark of collision queries: linear scan vs. CObjectGrid
+ *
+ * Simulates one physics frame: every object moves and then looks for the
+ * objects it may collide with, as CPhysics::ObjectAdapt() does.
+ * Prints the time of one frame against the number of objects.
+ */
+
+#include "object/objgrid.h"
+
+#include "math/geometry.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+
+namespace {
+
+const float MAP_SIZE     = 3200.0f;  // typical terrain
+const float QUERY_RADIUS = 15.0f;    // radius used by ObjectAdapt()
+const int   FRAMES       = 50;
+
+struct BenchObject
+{
+    Math::Vector pos;
+    Math::Vector speed;
+    float        radius;
+};
+
+float Random(float min, float max)
+{
+    return min + (max-min)*static_cast<float>(rand())/RAND_MAX;
+}
+
+CObject* Handle(std::vector<BenchObject>& objects, int i)
+{
+    return reinterpret_cast<CObject*>(&objects[i]);
+}
+
+void MoveAll(std::vector<BenchObject>& objects)
+{
+    for (unsigned int i = 0; i < objects.size(); i++)
+    {
+        objects[i].pos += objects[i].speed;
+        if (objects[i].pos.x < -MAP_SIZE/2 || objects[i].pos.x > MAP_SIZE/2) objects[i].speed.x = -objects[i].speed.x;
+        if (objects[i].pos.z < -MAP_SIZE/2 || objects[i].pos.z > MAP_SIZE/2) objects[i].speed.z = -objects[i].speed.z;
+    }
+}
+
+double FrameLinear(std::vector<BenchObject>& objects, int& hits)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (int f = 0; f < FRAMES; f++)
+    {
+        MoveAll(objects);
+        for (unsigned int i = 0; i < objects.size(); i++)
+        {
+            for (unsigned int j = 0; j < objects.size(); j++)
+            {
+                if (i == j) continue;
+                float d = Math::DistanceProjected(objects[i].pos, objects[j].pos);
+                if (d < QUERY_RADIUS+objects[j].radius) hits++;
+            }
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end-start).count() / FRAMES;
+}
+
+double FrameGrid(std::vector<BenchObject>& objects, int& hits)
+{
+    CObjectGrid grid;
+    std::vector<CObject*> list;
+
+    for (unsigned int i = 0; i < objects.size(); i++)
+        grid.Move(Handle(objects, i), objects[i].pos, objects[i].radius);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (int f = 0; f < FRAMES; f++)
+    {
+        MoveAll(objects);
+        for (unsigned int i = 0; i < objects.size(); i++)
+            grid.Move(Handle(objects, i), objects[i].pos, objects[i].radius);
+
+        for (unsigned int i = 0; i < objects.size(); i++)
+        {
+            grid.SearchRadius(list, objects[i].pos, QUERY_RADIUS);
+            for (unsigned int j = 0; j < list.size(); j++)
+            {
+                if (list[j] == Handle(objects, i)) continue;
+                hits++;
+            }
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end-start).count() / FRAMES;
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char* argv[])
+{
+    printf("%8s %14s %14s %10s\n", "objects", "linear [ms]", "grid [ms]", "speedup");
+
+    for (int count = 100; count <= 3200; count *= 2)
+    {
+        srand(count);
+        std::vector<BenchObject> objects(count);
+        for (int i = 0; i < count; i++)
+        {
+            objects[i].pos    = Math::Vector(Random(-MAP_SIZE/2, MAP_SIZE/2), 0.0f, Random(-MAP_SIZE/2, MAP_SIZE/2));
+            objects[i].speed  = Math::Vector(Random(-1.0f, 1.0f), 0.0f, Random(-1.0f, 1.0f));
+            objects[i].radius = Random(1.0f, 8.0f);
+        }
+        std::vector<BenchObject> copy = objects;
+
+        int linearHits = 0, gridHits = 0;
+        double linear = FrameLinear(objects, linearHits);
+        double grid   = FrameGrid(copy, gridHits);
+
+        printf("%8d %14.3f %14.3f %9.1fx", count, linear, grid, linear/grid);
+        if (linearHits != gridHits)
+            printf("  (mismatch: %d vs %d)", linearHits, gridHits);
+        printf("\n");
+    }
+
+    return 0;
+}
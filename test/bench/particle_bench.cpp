@@ -0,0 +1,219 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file particle_bench.cpp
+ * \brief Benchmark of the draw calls of the particles of explosions
+ *
+ * Usage: particle_bench [explosions [seconds]]
+ *
+ * Vehicles with a power cell explode one after the other, every 0.5 s
+ * (3 by default). Each one creates the particles CPyro creates for
+ * PT_EXPLOT: the tracks, the sphere and the shock wave at once, then a
+ * PARTIEXPLOT every 0.05 s during the first second and a smoke every 0.1 s
+ * during the first two. At 30 frames per second (for 4 s by default),
+ * CParticle::FrameParticle() moves them and CParticle::DrawParticle() draws
+ * them. The draw calls of the device, the triangles drawn and the time of
+ * DrawParticle() are printed.
+ */
+
+#include "common/logger.h"
+
+#include "graphics/core/nulldevice.h"
+#include "graphics/engine/engine.h"
+#include "graphics/engine/particle.h"
+
+#include "math/func.h"
+
+#include "object/robotmain.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+
+namespace {
+
+const float FRAME_TIME = 1.0f/30.0f;
+const float EXPLOSION_DELAY = 0.5f;
+const float EXPLOSION_SIZE = 20.0f;
+
+//! Device counting the draw calls and the triangles
+class CBenchDevice : public Gfx::CNullDevice
+{
+public:
+    CBenchDevice() : m_drawCalls(0), m_triangles(0) {}
+
+    void DrawPrimitive(Gfx::PrimitiveType type, const Gfx::Vertex* vertices, int vertexCount,
+                       Gfx::Color color) override
+    {
+        Count(type, vertexCount);
+    }
+
+    void DrawPrimitive(Gfx::PrimitiveType type, const Gfx::VertexTex2* vertices, int vertexCount,
+                       Gfx::Color color) override
+    {
+        Count(type, vertexCount);
+    }
+
+    void DrawPrimitive(Gfx::PrimitiveType type, const Gfx::VertexCol* vertices, int vertexCount) override
+    {
+        Count(type, vertexCount);
+    }
+
+    void Count(Gfx::PrimitiveType type, int vertexCount)
+    {
+        m_drawCalls++;
+        if (type == Gfx::PRIMITIVE_TRIANGLES)
+            m_triangles += vertexCount / 3;
+        else if (type == Gfx::PRIMITIVE_TRIANGLE_STRIP)
+            m_triangles += vertexCount - 2;
+    }
+
+    long m_drawCalls;
+    long m_triangles;
+};
+
+//! Explosion as CPyro makes it for PT_EXPLOT
+struct Explosion
+{
+    Math::Vector    pos;
+    float           time;
+    float           lastParticle;
+    float           lastSmoke;
+};
+
+void StartExplosion(Gfx::CParticle& particle, Explosion& explo)
+{
+    explo.time = 0.0f;
+    explo.lastParticle = -1.0f;
+    explo.lastSmoke = -1.0f;
+
+    // CPyro::Create(), with a power cell
+    for (int i = 0; i < 10; i++)
+    {
+        Math::Vector speed;
+        speed.x = (Math::Rand()-0.5f)*30.0f;
+        speed.z = (Math::Rand()-0.5f)*30.0f;
+        speed.y = Math::Rand()*30.0f;
+        Math::Point dim(1.0f, 1.0f);
+        particle.CreateTrack(explo.pos, speed, dim, Gfx::PARTITRACK1,
+                             Math::Rand()*3.0f+2.0f, Math::Rand()*10.0f+15.0f, Math::Rand()+0.7f, 1.0f);
+    }
+
+    Math::Point dim(EXPLOSION_SIZE*0.4f, EXPLOSION_SIZE*0.4f);
+    particle.CreateParticle(explo.pos, Math::Vector(0.0f, 0.0f, 0.0f), dim, Gfx::PARTISPHERE0, 2.0f, 0.0f, 0.0f);
+
+    dim = Math::Point(EXPLOSION_SIZE, EXPLOSION_SIZE);
+    particle.CreateParticle(explo.pos, Math::Vector(0.0f, 0.0f, 0.0f), dim, Gfx::PARTICHOC, 2.0f);
+}
+
+void FrameExplosion(Gfx::CParticle& particle, Explosion& explo)
+{
+    // CPyro::EventProcess(), the effect lasts 20 s
+    float progress = explo.time/20.0f;
+
+    if (progress < 0.05f && explo.lastParticle+0.05f <= explo.time)
+    {
+        explo.lastParticle = explo.time;
+
+        Math::Vector speed;
+        speed.x = (Math::Rand()-0.5f)*EXPLOSION_SIZE*1.0f;
+        speed.z = (Math::Rand()-0.5f)*EXPLOSION_SIZE*1.0f;
+        speed.y = Math::Rand()*EXPLOSION_SIZE*0.50f;
+        Math::Point dim;
+        dim.x = Math::Rand()*EXPLOSION_SIZE/5.0f+EXPLOSION_SIZE/5.0f;
+        dim.y = dim.x;
+        particle.CreateParticle(explo.pos, speed, dim, Gfx::PARTIEXPLOT);
+    }
+
+    if (progress < 0.10f && explo.lastSmoke+0.10f <= explo.time)
+    {
+        explo.lastSmoke = explo.time;
+
+        Math::Point dim;
+        dim.x = Math::Rand()*EXPLOSION_SIZE/3.0f+EXPLOSION_SIZE/3.0f;
+        dim.y = dim.x;
+        Math::Vector pos = explo.pos;
+        pos.x += (Math::Rand()-0.5f)*EXPLOSION_SIZE*0.5f;
+        pos.z += (Math::Rand()-0.5f)*EXPLOSION_SIZE*0.5f;
+        pos.y += dim.x/2.0f;
+        Math::Vector speed(0.0f, -dim.x/2.0f/4.0f, 0.0f);
+        particle.CreateParticle(pos, speed, dim, (rand()%2 == 0) ? Gfx::PARTISMOKE1 : Gfx::PARTISMOKE2, 6.0f);
+    }
+
+    explo.time += FRAME_TIME;
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char* argv[])
+{
+    int   explosions = (argc > 1) ? atoi(argv[1]) : 3;
+    float seconds    = (argc > 2) ? atof(argv[2]) : 4.0f;
+
+    CLogger logger;
+    Gfx::CEngine engine(nullptr);
+    CBenchDevice device;
+    engine.SetDevice(&device);
+    CRobotMain* main = new CRobotMain(nullptr, false);
+
+    Gfx::CParticle particle(&engine);
+    particle.SetDevice(&device);
+
+    srand(1);
+
+    std::vector<Explosion> explos(explosions);
+    for (int i = 0; i < explosions; i++)
+        explos[i].pos = Math::Vector(30.0f*i, 0.0f, 100.0f);
+
+    int frames = static_cast<int>(seconds/FRAME_TIME);
+    long maxDrawCalls = 0;
+    double drawTime = 0.0;
+
+    for (int f = 0; f < frames; f++)
+    {
+        float time = f*FRAME_TIME;
+        for (int i = 0; i < explosions; i++)
+        {
+            float start = i*EXPLOSION_DELAY;
+            if (time < start)  continue;
+            if (time-start < FRAME_TIME)  StartExplosion(particle, explos[i]);
+            FrameExplosion(particle, explos[i]);
+        }
+
+        particle.FrameParticle(FRAME_TIME);
+
+        long drawCalls = device.m_drawCalls;
+        auto start = std::chrono::high_resolution_clock::now();
+        particle.DrawParticle(Gfx::SH_WORLD);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        drawTime += std::chrono::duration<double, std::micro>(end-start).count();
+        maxDrawCalls = std::max(maxDrawCalls, device.m_drawCalls - drawCalls);
+    }
+
+    printf("%d explosions, %d frames\n", explosions, frames);
+    printf("%-14s %12s %12s %18s\n", "draw calls", "max/frame", "triangles", "draw time (us)");
+    printf("%-14.1f %12ld %12.1f %18.1f\n", static_cast<double>(device.m_drawCalls)/frames, maxDrawCalls,
+           static_cast<double>(device.m_triangles)/frames, drawTime/frames);
+
+    delete main;
+    return 0;
+}
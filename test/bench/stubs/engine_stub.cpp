@@ -0,0 +1,409 @@
+#include "app/gamedata.h"
+
+#include "graphics/core/device.h"
+#include "graphics/engine/engine.h"
+#include "graphics/engine/water.h"
+
+#include "math/func.h"
+
+#include <cassert>
+
+
+// Only the part of CEngine used by CTerrain, CLightManager, CParticle and by
+// the loading of models, keeping the base objects and their static buffers
+// as CEngine does
+
+template<> Gfx::CEngine* CSingleton<Gfx::CEngine>::m_instance = nullptr;
+template<> CGameData* CSingleton<CGameData>::m_instance = nullptr;
+
+std::string CGameData::GetFilePath(DataDir dir, const std::string &subpath)
+{
+    return subpath;
+}
+
+namespace Gfx {
+
+CEngine::CEngine(CApplication* app) :
+    m_app(app)
+{
+    m_device = nullptr;
+    m_water = nullptr;
+    m_updateGeometry = false;
+    m_updateStaticBuffers = false;
+    m_groundSpotVisible = true;
+    m_terrainVision = 1000.0f;
+    m_secondTexNum = 0;
+    m_statisticTriangle = 0;
+    m_statisticDrawCall = 0;
+}
+
+CEngine::~CEngine()
+{
+}
+
+void CEngine::SetDevice(CDevice* device)
+{
+    m_device = device;
+}
+
+bool CEngine::GetPause()
+{
+    return false;
+}
+
+Math::Vector CEngine::GetEyePt()
+{
+    return m_eyePt;
+}
+
+Math::Vector CEngine::GetLookatPt()
+{
+    return m_lookatPt;
+}
+
+CWater* CEngine::GetWater()
+{
+    return m_water;
+}
+
+bool CEngine::GetFog()
+{
+    return false;
+}
+
+int CEngine::GetRankView()
+{
+    return 0;
+}
+
+float CEngine::GetParticleDensity()
+{
+    return 1.0f;
+}
+
+float CEngine::ParticleAdapt(float factor)
+{
+    return factor;
+}
+
+void CEngine::AddStatisticTriangle(int count)
+{
+    m_statisticTriangle += count;
+    m_statisticDrawCall++;
+}
+
+int CEngine::GetStatisticTriangle()
+{
+    return m_statisticTriangle;
+}
+
+int CEngine::GetStatisticDrawCall()
+{
+    return m_statisticDrawCall;
+}
+
+// The states, materials and textures are not given to the device
+
+void CEngine::SetState(int state, const Color& color)
+{
+}
+
+void CEngine::SetMaterial(const Material& mat)
+{
+}
+
+bool CEngine::SetTexture(const std::string& name, int stage)
+{
+    return true;
+}
+
+bool CEngine::GetGroundSpot()
+{
+    return m_groundSpotVisible;
+}
+
+int CEngine::GetSecondTexture()
+{
+    return m_secondTexNum;
+}
+
+void CEngine::SetTerrainVision(float vision)
+{
+    m_terrainVision = vision;
+}
+
+void CEngine::CreateGroundMark(Math::Vector pos, float radius,
+                               float delay1, float delay2, float delay3,
+                               int dx, int dy, char* table)
+{
+}
+
+int CEngine::CreateBaseObject()
+{
+    int baseObjRank = 0;
+    for ( ; baseObjRank < static_cast<int>( m_baseObjects.size() ); baseObjRank++)
+    {
+        if (! m_baseObjects[baseObjRank].used)
+            break;
+    }
+
+    if (baseObjRank == static_cast<int>( m_baseObjects.size() ))
+        m_baseObjects.push_back(EngineBaseObject());
+    else
+        m_baseObjects[baseObjRank].LoadDefault();
+
+    m_baseObjects[baseObjRank].used = true;
+    return baseObjRank;
+}
+
+void CEngine::DeleteBaseObject(int baseObjRank)
+{
+    EngineBaseObject& p1 = m_baseObjects[baseObjRank];
+    for (EngineBaseObjTexTier& p2 : p1.next)
+    {
+        for (EngineBaseObjLODTier& p3 : p2.next)
+        {
+            for (EngineBaseObjDataTier& p4 : p3.next)
+                m_device->DestroyStaticBuffer(p4.staticBufferId);
+        }
+    }
+
+    p1.next.clear();
+    p1.used = false;
+}
+
+void CEngine::AddBaseObjTriangles(int baseObjRank, const std::vector<VertexTex2>& vertices,
+                                  EngineTriangleType triangleType,
+                                  const Material& material, int state,
+                                  std::string tex1Name, std::string tex2Name,
+                                  LODLevel lodLevel, bool globalUpdate)
+{
+    AddBaseObjTriangles(baseObjRank, vertices.data(), vertices.size(), triangleType,
+                        material, state, tex1Name, tex2Name, lodLevel, globalUpdate);
+}
+
+void CEngine::AddBaseObjTriangles(int baseObjRank, const VertexTex2* vertices, int vertexCount,
+                                  EngineTriangleType triangleType,
+                                  const Material& material, int state,
+                                  std::string tex1Name, std::string tex2Name,
+                                  LODLevel lodLevel, bool globalUpdate)
+{
+    EngineBaseObject&      p1 = m_baseObjects[baseObjRank];
+    EngineBaseObjTexTier&  p2 = AddLevel2(p1, tex1Name, tex2Name);
+    EngineBaseObjLODTier&  p3 = AddLevel3(p2, lodLevel);
+    EngineBaseObjDataTier& p4 = AddLevel4(p3, triangleType, material, state);
+
+    p4.vertices.insert(p4.vertices.end(), vertices, vertices + vertexCount);
+
+    p4.updateStaticBuffer = true;
+    m_updateStaticBuffers = true;
+
+    assert(!globalUpdate);
+    for (int i = 0; i < vertexCount; i++)
+    {
+        p1.bboxMin.x = Math::Min(vertices[i].coord.x, p1.bboxMin.x);
+        p1.bboxMin.y = Math::Min(vertices[i].coord.y, p1.bboxMin.y);
+        p1.bboxMin.z = Math::Min(vertices[i].coord.z, p1.bboxMin.z);
+        p1.bboxMax.x = Math::Max(vertices[i].coord.x, p1.bboxMax.x);
+        p1.bboxMax.y = Math::Max(vertices[i].coord.y, p1.bboxMax.y);
+        p1.bboxMax.z = Math::Max(vertices[i].coord.z, p1.bboxMax.z);
+    }
+
+    p1.radius = Math::Max(p1.bboxMin.Length(), p1.bboxMax.Length());
+
+    if (triangleType == ENG_TRIANGLE_TYPE_TRIANGLES)
+        p1.totalTriangles += vertexCount / 3;
+    else
+        p1.totalTriangles += vertexCount - 2;
+}
+
+void CEngine::AddBaseObjQuick(int baseObjRank, const EngineBaseObjDataTier& buffer,
+                              std::string tex1Name, std::string tex2Name,
+                              LODLevel lodLevel, bool globalUpdate)
+{
+    EngineBaseObject&      p1 = m_baseObjects[baseObjRank];
+    EngineBaseObjTexTier&  p2 = AddLevel2(p1, tex1Name, tex2Name);
+    EngineBaseObjLODTier&  p3 = AddLevel3(p2, lodLevel);
+
+    p3.next.push_back(buffer);
+
+    EngineBaseObjDataTier& p4 = p3.next.back();
+    UpdateStaticBuffer(p4);
+
+    assert(globalUpdate);
+    m_updateGeometry = true;
+}
+
+bool CEngine::UpdateBaseObjQuick(int baseObjRank, int index, const std::vector<VertexTex2>& vertices,
+                                 const std::string& tex1Name, const std::string& tex2Name,
+                                 LODLevel lodLevel)
+{
+    EngineBaseObject& p1 = m_baseObjects[baseObjRank];
+    for (EngineBaseObjTexTier& p2 : p1.next)
+    {
+        if (p2.tex1Name != tex1Name || p2.tex2Name != tex2Name)
+            continue;
+
+        for (EngineBaseObjLODTier& p3 : p2.next)
+        {
+            if (p3.lodLevel != lodLevel)
+                continue;
+
+            if (index >= static_cast<int>( p3.next.size() ))
+                return false;
+
+            EngineBaseObjDataTier& p4 = p3.next[index];
+            if (p4.vertices.size() != vertices.size())
+                return false;
+
+            p4.vertices = vertices;
+            UpdateStaticBuffer(p4);
+
+            for (const VertexTex2& vertex : vertices)
+            {
+                p1.bboxMin.x = Math::Min(vertex.coord.x, p1.bboxMin.x);
+                p1.bboxMin.y = Math::Min(vertex.coord.y, p1.bboxMin.y);
+                p1.bboxMin.z = Math::Min(vertex.coord.z, p1.bboxMin.z);
+                p1.bboxMax.x = Math::Max(vertex.coord.x, p1.bboxMax.x);
+                p1.bboxMax.y = Math::Max(vertex.coord.y, p1.bboxMax.y);
+                p1.bboxMax.z = Math::Max(vertex.coord.z, p1.bboxMax.z);
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
+EngineBaseObjTexTier& CEngine::AddLevel2(EngineBaseObject& p1, const std::string& tex1Name, const std::string& tex2Name)
+{
+    for (EngineBaseObjTexTier& p2 : p1.next)
+    {
+        if (p2.tex1Name == tex1Name && p2.tex2Name == tex2Name)
+            return p2;
+    }
+
+    p1.next.push_back(EngineBaseObjTexTier(tex1Name, tex2Name));
+    return p1.next.back();
+}
+
+EngineBaseObjLODTier& CEngine::AddLevel3(EngineBaseObjTexTier& p2, LODLevel lodLevel)
+{
+    for (EngineBaseObjLODTier& p3 : p2.next)
+    {
+        if (p3.lodLevel == lodLevel)
+            return p3;
+    }
+
+    p2.next.push_back(EngineBaseObjLODTier(lodLevel));
+    return p2.next.back();
+}
+
+EngineBaseObjDataTier& CEngine::AddLevel4(EngineBaseObjLODTier& p3, EngineTriangleType type,
+                                          const Material& material, int state)
+{
+    for (EngineBaseObjDataTier& p4 : p3.next)
+    {
+        if (p4.type == type && p4.material == material && p4.state == state)
+            return p4;
+    }
+
+    p3.next.push_back(EngineBaseObjDataTier(type, material, state));
+    return p3.next.back();
+}
+
+void CEngine::UpdateStaticBuffer(EngineBaseObjDataTier& p4)
+{
+    if (p4.staticBufferId == 0)
+        p4.staticBufferId = m_device->CreateStaticBuffer(PRIMITIVE_TRIANGLE_STRIP, &p4.vertices[0], p4.vertices.size());
+    else
+        m_device->UpdateStaticBuffer(p4.staticBufferId, PRIMITIVE_TRIANGLE_STRIP, &p4.vertices[0], p4.vertices.size());
+}
+
+int CEngine::CreateObject()
+{
+    int objRank = 0;
+    for ( ; objRank < static_cast<int>( m_objects.size() ); objRank++)
+    {
+        if (! m_objects[objRank].used)
+        {
+            m_objects[objRank].LoadDefault();
+            break;
+        }
+    }
+
+    if (objRank == static_cast<int>( m_objects.size() ))
+        m_objects.push_back(EngineObject());
+
+    m_objects[objRank].used = true;
+    return objRank;
+}
+
+void CEngine::DeleteObject(int objRank)
+{
+    m_objects[objRank].used = false;
+}
+
+void CEngine::SetObjectBaseRank(int objRank, int baseObjRank)
+{
+    m_objects[objRank].baseObjRank = baseObjRank;
+}
+
+int CEngine::GetObjectBaseRank(int objRank)
+{
+    return m_objects[objRank].baseObjRank;
+}
+
+void CEngine::SetObjectType(int objRank, EngineObjectType type)
+{
+    m_objects[objRank].type = type;
+}
+
+void CEngine::SetObjectTransform(int objRank, const Math::Matrix& transform)
+{
+    m_objects[objRank].transform = transform;
+}
+
+//! Recalculates the boxes of all base objects after AddBaseObjQuick(), as UpdateGeometry()
+void CEngine::Update()
+{
+    if (! m_updateGeometry)
+        return;
+
+    for (EngineBaseObject& p1 : m_baseObjects)
+    {
+        if (! p1.used)
+            continue;
+
+        p1.bboxMin.LoadZero();
+        p1.bboxMax.LoadZero();
+        for (EngineBaseObjTexTier& p2 : p1.next)
+        {
+            for (EngineBaseObjLODTier& p3 : p2.next)
+            {
+                for (EngineBaseObjDataTier& p4 : p3.next)
+                {
+                    for (const VertexTex2& vertex : p4.vertices)
+                    {
+                        p1.bboxMin.x = Math::Min(vertex.coord.x, p1.bboxMin.x);
+                        p1.bboxMin.y = Math::Min(vertex.coord.y, p1.bboxMin.y);
+                        p1.bboxMin.z = Math::Min(vertex.coord.z, p1.bboxMin.z);
+                        p1.bboxMax.x = Math::Max(vertex.coord.x, p1.bboxMax.x);
+                        p1.bboxMax.y = Math::Max(vertex.coord.y, p1.bboxMax.y);
+                        p1.bboxMax.z = Math::Max(vertex.coord.z, p1.bboxMax.z);
+                    }
+                }
+            }
+        }
+    }
+
+    m_updateGeometry = false;
+}
+
+
+float CWater::GetLevel()
+{
+    return 0.0f;
+}
+
+} // namespace Gfx
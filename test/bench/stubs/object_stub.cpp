@@ -0,0 +1,49 @@
+#include "app/app.h"
+
+#include "object/object.h"
+#include "object/objman.h"
+
+
+// Only the part of the game used by CParticle, without any object or sound
+
+template<> CApplication* CSingleton<CApplication>::m_instance = nullptr;
+template<> CObjectManager* CSingleton<CObjectManager>::m_instance = nullptr;
+
+CSoundInterface* CApplication::GetSound()
+{
+    return nullptr;
+}
+
+void CObjectManager::SearchRadius(std::vector<CObject*> &list, const Math::Vector &center, float radius)
+{
+}
+
+bool CObject::ExploObject(ExploType type, float force, float decay)
+{
+    return false;
+}
+
+ObjectType CObject::GetType()
+{
+    return OBJECT_NULL;
+}
+
+bool CObject::GetCrashSphere(int rank, Math::Vector &pos, float &radius)
+{
+    return false;
+}
+
+float CObject::GetShieldRadius()
+{
+    return 0.0f;
+}
+
+Math::Vector CObject::GetPosition(int part)
+{
+    return Math::Vector(0.0f, 0.0f, 0.0f);
+}
+
+bool CObject::GetActif()
+{
+    return false;
+}
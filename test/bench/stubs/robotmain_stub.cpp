@@ -0,0 +1,38 @@
+#include "object/robotmain.h"
+
+#include "graphics/engine/terrain.h"
+
+
+// Only the part of CRobotMain used by CParticle, with an empty terrain
+
+template<> CRobotMain* CSingleton<CRobotMain>::m_instance = nullptr;
+
+CRobotMain::CRobotMain(CApplication* app, bool loadProfile)
+{
+    m_terrain = new Gfx::CTerrain();
+}
+
+CRobotMain::~CRobotMain()
+{
+    delete m_terrain;
+}
+
+Gfx::CTerrain* CRobotMain::GetTerrain()
+{
+    return m_terrain;
+}
+
+bool CRobotMain::GetMovieLock()
+{
+    return false;
+}
+
+bool CRobotMain::GetInfoLock()
+{
+    return false;
+}
+
+bool CRobotMain::GetHimselfDamage()
+{
+    return false;
+}
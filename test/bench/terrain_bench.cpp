@@ -0,0 +1,280 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file terrain_bench.cpp
+ * \brief Benchmark of CTerrain::Terraform(): recreated vs. updated mosaics
+ *
+ * Usage: terrain_bench [calls]
+ *
+ * A random terrain of the default size of scenes (20x20 mosaics of 8x8
+ * bricks of 20 m, 2 resolutions) is terraformed on 40x40 m areas spread over
+ * the ground, raising and lowering them in turn (200 calls by default):
+ * - "recreate" adjusts the whole relief, then deletes and creates again
+ *   each mosaic near the area with its static buffers, as Terraform() did;
+ * - "update" adjusts the relief around the area only, and updates the
+ *   vertices of these mosaics in their static buffers.
+ * Only the part of CEngine used by CTerrain is linked (stubs/engine_stub.cpp);
+ * the device keeps a copy of the vertices of each static buffer, as a driver
+ * does with an upload. Both must give the same vertices.
+ */
+
+#include "common/logger.h"
+
+#include "graphics/core/nulldevice.h"
+#include "graphics/engine/engine.h"
+#include "graphics/engine/terrain.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+
+namespace {
+
+//! Device keeping the vertices of static buffers
+class CBenchDevice : public Gfx::CNullDevice
+{
+public:
+    virtual unsigned int CreateStaticBuffer(Gfx::PrimitiveType primitiveType, const Gfx::VertexTex2* vertices, int vertexCount)
+    {
+        unsigned int id = Gfx::CNullDevice::CreateStaticBuffer(primitiveType, vertices, vertexCount);
+        m_buffers[id].assign(vertices, vertices + vertexCount);
+        m_uploaded += vertexCount;
+        return id;
+    }
+
+    virtual void UpdateStaticBuffer(unsigned int bufferId, Gfx::PrimitiveType primitiveType, const Gfx::VertexTex2* vertices, int vertexCount)
+    {
+        m_buffers[bufferId].assign(vertices, vertices + vertexCount);
+        m_uploaded += vertexCount;
+    }
+
+    virtual void DestroyStaticBuffer(unsigned int bufferId)
+    {
+        m_buffers.erase(bufferId);
+    }
+
+    const std::vector<Gfx::VertexTex2>& GetBuffer(unsigned int bufferId)
+    {
+        return m_buffers[bufferId];
+    }
+
+    long m_uploaded = 0;
+
+private:
+    std::map<unsigned int, std::vector<Gfx::VertexTex2>> m_buffers;
+};
+
+class CBenchEngine : public Gfx::CEngine
+{
+public:
+    CBenchEngine() : Gfx::CEngine(nullptr) {}
+
+    //! Returns the vertices of all the static buffers of an object, as the device has them
+    std::vector<Gfx::VertexTex2> GetVertices(CBenchDevice& device, int objRank)
+    {
+        std::vector<Gfx::VertexTex2> vertices;
+        Gfx::EngineBaseObject& p1 = m_baseObjects[m_objects[objRank].baseObjRank];
+        for (Gfx::EngineBaseObjTexTier& p2 : p1.next)
+        {
+            for (Gfx::EngineBaseObjLODTier& p3 : p2.next)
+            {
+                for (Gfx::EngineBaseObjDataTier& p4 : p3.next)
+                {
+                    const std::vector<Gfx::VertexTex2>& buffer = device.GetBuffer(p4.staticBufferId);
+                    vertices.insert(vertices.end(), buffer.begin(), buffer.end());
+                }
+            }
+        }
+        return vertices;
+    }
+};
+
+class CBenchTerrain : public Gfx::CTerrain
+{
+public:
+    //! Terraform() recreating the mosaics, as it was before the updates in place
+    void TerraformRecreate(const Math::Vector &p1, const Math::Vector &p2, float height)
+    {
+        float dim = (m_mosaicCount*m_brickCount*m_brickSize)/2.0f;
+
+        Math::IntPoint tp1, tp2;
+        tp1.x = static_cast<int>((p1.x+dim+m_brickSize/2.0f)/m_brickSize);
+        tp1.y = static_cast<int>((p1.z+dim+m_brickSize/2.0f)/m_brickSize);
+        tp2.x = static_cast<int>((p2.x+dim+m_brickSize/2.0f)/m_brickSize);
+        tp2.y = static_cast<int>((p2.z+dim+m_brickSize/2.0f)/m_brickSize);
+
+        int size = (m_mosaicCount*m_brickCount)+1;
+
+        float avg = 0.0f;
+        int nb = 0;
+        for (int y = tp1.y; y <= tp2.y; y++)
+        {
+            for (int x = tp1.x; x <= tp2.x; x++)
+            {
+                avg += m_relief[x+y*size];
+                nb ++;
+            }
+        }
+        avg /= static_cast<float>(nb);
+
+        for (int y = tp1.y; y <= tp2.y; y++)
+        {
+            for (int x = tp1.x; x <= tp2.x; x++)
+            {
+                m_relief[x+y*size] = avg+height;
+
+                if (x % m_brickCount == 0 && y % m_depth != 0)
+                {
+                    m_relief[(x+0)+(y-1)*size] = avg+height;
+                    m_relief[(x+0)+(y+1)*size] = avg+height;
+                }
+
+                if (y % m_brickCount == 0 && x % m_depth != 0)
+                {
+                    m_relief[(x-1)+(y+0)*size] = avg+height;
+                    m_relief[(x+1)+(y+0)*size] = avg+height;
+                }
+            }
+        }
+        AdjustRelief();
+
+        // Mosaics updated by Terraform(), a bit more than before
+        int b = 1 << (m_depth-1);
+        Math::IntPoint pp1, pp2;
+        pp1.x = std::max(0, (tp1.x-1-2*b-1)/m_brickCount);
+        pp1.y = std::max(0, (tp1.y-1-2*b-1)/m_brickCount);
+        pp2.x = std::min(m_mosaicCount-1, (tp2.x+1+2*b)/m_brickCount);
+        pp2.y = std::min(m_mosaicCount-1, (tp2.y+1+2*b)/m_brickCount);
+
+        for (int y = pp1.y; y <= pp2.y; y++)
+        {
+            for (int x = pp1.x; x <= pp2.x; x++)
+            {
+                int objRank = m_objRanks[x+y*m_mosaicCount];
+                m_engine->DeleteBaseObject(m_engine->GetObjectBaseRank(objRank));
+                m_engine->DeleteObject(objRank);
+                CreateSquare(x, y);
+            }
+        }
+        m_engine->Update();
+    }
+
+    int GetSquareObject(int x, int y)
+    {
+        return m_objRanks[x+y*m_mosaicCount];
+    }
+};
+
+void CreateTerrain(CBenchTerrain& terrain, CBenchEngine& engine)
+{
+    int table[] = { 1, 2, 3, 4 };
+
+    terrain.Generate(20, 3, 20.0f, 500.0f, 2, 0.5f);
+    terrain.InitTextures("bench.png", table, 2, 2);
+    srand(0);
+    terrain.RandomizeRelief();
+    terrain.CreateObjects();
+    engine.Update();
+}
+
+//! Center of the area of the n-th call, spread over the ground
+Math::Vector GetArea(int n)
+{
+    return Math::Vector(((n*37) % 140 - 70) * 20.0f, 0.0f, ((n*53) % 140 - 70) * 20.0f);
+}
+
+double Run(CBenchTerrain& terrain, bool update, int calls)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < calls; i++)
+    {
+        Math::Vector center = GetArea(i);
+        Math::Vector p1 = center - Math::Vector(20.0f, 0.0f, 20.0f);
+        Math::Vector p2 = center + Math::Vector(20.0f, 0.0f, 20.0f);
+        float height = (i % 2 == 0) ? 5.0f : -5.0f;
+
+        if (update)
+            terrain.Terraform(p1, p2, height);
+        else
+            terrain.TerraformRecreate(p1, p2, height);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::micro>(end-start).count() / calls;
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char* argv[])
+{
+    int calls = 200;
+    if (argc > 1) calls = atoi(argv[1]);
+
+    CLogger logger;
+    logger.SetLogLevel(LOG_ERROR);
+
+    CBenchDevice device;
+    CBenchEngine engine;
+    engine.SetDevice(&device);
+
+    CBenchTerrain recreated, updated;
+    CreateTerrain(recreated, engine);
+    CreateTerrain(updated, engine);
+
+    device.m_uploaded = 0;
+    double recreateTime = Run(recreated, false, calls);
+    long recreateUploaded = device.m_uploaded;
+
+    device.m_uploaded = 0;
+    double updateTime = Run(updated, true, calls);
+    long updateUploaded = device.m_uploaded;
+
+    printf("%-10s %14s %18s\n", "mosaics", "time/call (us)", "vertices/call");
+    printf("%-10s %14.1f %18ld\n", "recreate", recreateTime, recreateUploaded / calls);
+    printf("%-10s %14.1f %18ld\n", "update",   updateTime,   updateUploaded / calls);
+    printf("speedup: %.2fx\n", recreateTime / updateTime);
+
+    int status = 0;
+    for (int y = 0; y < 20 && status == 0; y++)
+    {
+        for (int x = 0; x < 20; x++)
+        {
+            std::vector<Gfx::VertexTex2> v1 = engine.GetVertices(device, recreated.GetSquareObject(x, y));
+            std::vector<Gfx::VertexTex2> v2 = engine.GetVertices(device, updated.GetSquareObject(x, y));
+            bool same = v1.size() == v2.size();
+            for (size_t i = 0; same && i < v1.size(); i++)
+            {
+                same = Math::VectorsEqual(v1[i].coord, v2[i].coord) &&
+                       Math::VectorsEqual(v1[i].normal, v2[i].normal) &&
+                       Math::PointsEqual(v1[i].texCoord, v2[i].texCoord) &&
+                       Math::PointsEqual(v1[i].texCoord2, v2[i].texCoord2);
+            }
+            if (!same)
+            {
+                printf("vertices differ in mosaic %d,%d\n", x, y);
+                status = 1;
+                break;
+            }
+        }
+    }
+
+    return status;
+}
@@ -0,0 +1,381 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file text_bench.cpp
+ * \brief Benchmark of text drawing: one texture per glyph vs. CGlyphAtlas
+ *
+ * Usage: text_bench font.ttf [size]
+ *
+ * A page of the code editor (40 lines of a CBot program, in the monospace
+ * font of the data, fonts/dvu_sans_mono.ttf, at 16 points by default) is
+ * drawn in a window, 200 times:
+ * - "glyph textures" creates one texture for each glyph and draws each
+ *   character with its own texture and draw call, as CText did;
+ * - "atlas" packs the glyphs in a CGlyphAtlas, keeps the quads of each line
+ *   from the first frame and draws a line with one call, as CText does now.
+ * The time of a frame waits for the end of the drawing (glFinish()).
+ */
+
+#include "common/image.h"
+#include "common/logger.h"
+
+#include "graphics/engine/glyphatlas.h"
+#include "graphics/opengl/gldevice.h"
+
+#include "math/func.h"
+#include "math/geometry.h"
+
+#include <GL/glew.h>
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+const int FRAMES = 200;
+const int LINES  = 40;
+const Math::IntPoint WINDOW_SIZE(1024, 768);
+
+const char* const PROGRAM[] =
+{
+    "extern void object::Patrol()",
+    "{",
+    "    object  item;",
+    "    float   dist, angle;",
+    "    int     i = 0;",
+    "",
+    "    while ( true )",
+    "    {",
+    "        item = radar(AlienAnt, 0, 360, 0, 40);",
+    "        if ( item == null )",
+    "        {",
+    "            goto(space(position, 10, 30, 2));",
+    "            i = i + 1;",
+    "            continue;",
+    "        }",
+    "        dist = distance(position, item.position);",
+    "        angle = direction(item.position);",
+    "        turn(angle);",
+    "        if ( dist < 20 )  fire(0.5);",
+    "        else  move(dist - 15);",
+    "    }",
+    "}",
+};
+
+struct Clock
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    double Ms()
+    {
+        auto now = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(now - start).count();
+    }
+};
+
+//! Text of the page, the program repeated until the page is full
+std::vector<std::string> Page()
+{
+    std::vector<std::string> page;
+    int count = sizeof(PROGRAM) / sizeof(PROGRAM[0]);
+    for (int i = 0; i < LINES; i++)
+        page.push_back(PROGRAM[i % count]);
+    return page;
+}
+
+Math::Point ToInterface(int x, int y)
+{
+    return Math::Point(static_cast<float>(x) / WINDOW_SIZE.x, static_cast<float>(y) / WINDOW_SIZE.y);
+}
+
+//! Texture of a glyph as created by CText before the atlas
+struct GlyphTexture
+{
+    unsigned int id;
+    Math::Point  texSize;
+    Math::Point  charSize;
+};
+
+class CGlyphTextures
+{
+public:
+    CGlyphTextures(Gfx::CDevice* device, TTF_Font* font) : m_device(device), m_font(font) {}
+
+    GlyphTexture& Get(char ch)
+    {
+        auto it = m_glyphs.find(ch);
+        if (it != m_glyphs.end())
+            return (*it).second;
+
+        SDL_Color white = {255, 255, 255, 0};
+        char str[] = { ch, '\0' };
+        SDL_Surface* textSurface = TTF_RenderUTF8_Blended(m_font, str, white);
+
+        int w = Math::NextPowerOfTwo(textSurface->w);
+        int h = Math::NextPowerOfTwo(textSurface->h);
+
+        textSurface->flags = textSurface->flags & (~SDL_SRCALPHA);
+        SDL_Surface* textureSurface = SDL_CreateRGBSurface(0, w, h, 32, 0x00ff0000, 0x0000ff00,
+                                                           0x000000ff, 0xff000000);
+        SDL_BlitSurface(textSurface, NULL, textureSurface, NULL);
+
+        ImageData data;
+        data.surface = textureSurface;
+
+        Gfx::TextureCreateParams createParams;
+        createParams.format = Gfx::TEX_IMG_RGBA;
+        createParams.minFilter = Gfx::TEX_MIN_FILTER_NEAREST;
+        createParams.magFilter = Gfx::TEX_MAG_FILTER_NEAREST;
+        createParams.mipmap = false;
+
+        GlyphTexture glyph;
+        glyph.id = m_device->CreateTexture(&data, createParams).id;
+        glyph.texSize = ToInterface(textureSurface->w, textureSurface->h);
+        glyph.charSize = ToInterface(textSurface->w, textSurface->h);
+
+        SDL_FreeSurface(textSurface);
+        SDL_FreeSurface(textureSurface);
+
+        return m_glyphs[ch] = glyph;
+    }
+
+    //! Draws a line as CText::DrawCharAndAdjustPos() did, returns the number of draw calls
+    int Draw(const std::string& line, Math::Point pos, Gfx::Color color)
+    {
+        Math::Vector n(0.0f, 0.0f, -1.0f);
+        for (char ch : line)
+        {
+            GlyphTexture& tex = Get(ch);
+
+            Math::Point p1(pos.x, pos.y + tex.charSize.y - tex.texSize.y);
+            Math::Point p2(pos.x + tex.texSize.x, pos.y + tex.charSize.y);
+
+            Gfx::Vertex quad[4] =
+            {
+                Gfx::Vertex(Math::Vector(p1.x, p1.y, 0.0f), n, Math::Point(0.0f, 1.0f)),
+                Gfx::Vertex(Math::Vector(p1.x, p2.y, 0.0f), n, Math::Point(0.0f, 0.0f)),
+                Gfx::Vertex(Math::Vector(p2.x, p1.y, 0.0f), n, Math::Point(1.0f, 1.0f)),
+                Gfx::Vertex(Math::Vector(p2.x, p2.y, 0.0f), n, Math::Point(1.0f, 0.0f))
+            };
+
+            m_device->SetTexture(0, tex.id);
+            m_device->DrawPrimitive(Gfx::PRIMITIVE_TRIANGLE_STRIP, quad, 4, color);
+
+            pos.x += tex.charSize.x;
+        }
+        return line.size();
+    }
+
+private:
+    Gfx::CDevice* m_device;
+    TTF_Font*     m_font;
+    std::map<char, GlyphTexture> m_glyphs;
+};
+
+class CAtlasText
+{
+public:
+    CAtlasText(Gfx::CDevice* device, TTF_Font* font) : m_device(device), m_font(font), m_atlas(device) {}
+
+    Gfx::Glyph& Get(char ch)
+    {
+        auto it = m_glyphs.find(ch);
+        if (it != m_glyphs.end())
+            return (*it).second;
+
+        SDL_Color white = {255, 255, 255, 0};
+        char str[] = { ch, '\0' };
+        SDL_Surface* textSurface = TTF_RenderUTF8_Blended(m_font, str, white);
+
+        Gfx::Glyph glyph;
+        m_atlas.AddGlyph(textSurface, glyph);
+        SDL_FreeSurface(textSurface);
+
+        return m_glyphs[ch] = glyph;
+    }
+
+    //! Draws a line as CText::DrawLayout(), returns the number of draw calls
+    int Draw(const std::string& line, Math::Point pos, Gfx::Color color)
+    {
+        if (line.empty())
+            return 0;
+
+        std::vector<Gfx::Vertex>& layout = m_layouts[line];
+        if (layout.empty())
+            Layout(line, layout);
+
+        m_quads = layout;
+        for (Gfx::Vertex &v : m_quads)
+        {
+            v.coord.x += pos.x;
+            v.coord.y += pos.y;
+        }
+
+        m_device->SetTexture(0, m_atlas.GetTexture(0));
+        m_device->DrawPrimitive(Gfx::PRIMITIVE_TRIANGLES, &m_quads[0], m_quads.size(), color);
+        return 1;
+    }
+
+private:
+    void Layout(const std::string& line, std::vector<Gfx::Vertex>& layout)
+    {
+        Math::Vector n(0.0f, 0.0f, -1.0f);
+        Math::Point pos(0.0f, 0.0f);
+        for (char ch : line)
+        {
+            Gfx::Glyph& glyph = Get(ch);
+            Math::Point size = ToInterface(glyph.size.x, glyph.size.y);
+
+            Math::Point p1 = pos;
+            Math::Point p2(pos.x + size.x, pos.y + size.y);
+
+            Gfx::Vertex quad[4] =
+            {
+                Gfx::Vertex(Math::Vector(p1.x, p1.y, 0.0f), n, Math::Point(glyph.texCoord1.x, glyph.texCoord2.y)),
+                Gfx::Vertex(Math::Vector(p1.x, p2.y, 0.0f), n, Math::Point(glyph.texCoord1.x, glyph.texCoord1.y)),
+                Gfx::Vertex(Math::Vector(p2.x, p1.y, 0.0f), n, Math::Point(glyph.texCoord2.x, glyph.texCoord2.y)),
+                Gfx::Vertex(Math::Vector(p2.x, p2.y, 0.0f), n, Math::Point(glyph.texCoord2.x, glyph.texCoord1.y))
+            };
+            for (int i : {0, 1, 2, 2, 1, 3})
+                layout.push_back(quad[i]);
+
+            pos.x += size.x;
+        }
+    }
+
+    Gfx::CDevice*     m_device;
+    TTF_Font*         m_font;
+    Gfx::CGlyphAtlas  m_atlas;
+    std::map<char, Gfx::Glyph> m_glyphs;
+    std::map<std::string, std::vector<Gfx::Vertex>> m_layouts;
+    std::vector<Gfx::Vertex> m_quads;
+};
+
+void SetStates(Gfx::CDevice* device)
+{
+    Math::Matrix proj, identity;
+    Math::LoadOrthoProjectionMatrix(proj, 0.0f, 1.0f, 0.0f, 1.0f);
+    identity.LoadIdentity();
+    device->SetTransform(Gfx::TRANSFORM_PROJECTION, proj);
+    device->SetTransform(Gfx::TRANSFORM_VIEW, identity);
+    device->SetTransform(Gfx::TRANSFORM_WORLD, identity);
+
+    device->SetRenderState(Gfx::RENDER_STATE_LIGHTING, false);
+    device->SetRenderState(Gfx::RENDER_STATE_DEPTH_TEST, false);
+    device->SetRenderState(Gfx::RENDER_STATE_BLENDING, true);
+    device->SetBlendFunc(Gfx::BLEND_SRC_ALPHA, Gfx::BLEND_INV_SRC_ALPHA);
+    device->SetTextureEnabled(0, true);
+}
+
+template<typename Text>
+void Run(const char* name, Gfx::CDevice* device, Text& text, float lineHeight)
+{
+    std::vector<std::string> page = Page();
+    Gfx::Color color(0.0f, 0.0f, 0.0f, 1.0f);
+
+    double first = 0.0, total = 0.0;
+    int calls = 0;
+    for (int frame = 0; frame < FRAMES; frame++)
+    {
+        Clock clock;
+        device->BeginScene();
+        SetStates(device);
+
+        calls = 0;
+        Math::Point pos(0.02f, 1.0f - lineHeight);
+        for (const std::string& line : page)
+        {
+            calls += text.Draw(line, pos, color);
+            pos.y -= lineHeight;
+        }
+
+        device->EndScene();
+        glFinish();
+        double ms = clock.Ms();
+
+        if (frame == 0) first = ms;
+        else            total += ms;
+
+        SDL_GL_SwapBuffers();
+    }
+
+    printf("%-16s first frame %8.2f ms, then %6.3f ms per frame, %5d draw calls\n",
+           name, first, total / (FRAMES - 1), calls);
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s font.ttf [size]\n", argv[0]);
+        return 1;
+    }
+    int size = argc > 2 ? atoi(argv[2]) : 16;
+
+    CLogger logger;
+
+    SDL_Init(SDL_INIT_VIDEO);
+    TTF_Init();
+
+    SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+    SDL_Surface* surface = SDL_SetVideoMode(WINDOW_SIZE.x, WINDOW_SIZE.y, 32, SDL_OPENGL | SDL_GL_DOUBLEBUFFER);
+    if (surface == nullptr)
+    {
+        printf("Cannot open a window: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    TTF_Font* font = TTF_OpenFont(argv[1], size);
+    if (font == nullptr)
+    {
+        printf("Cannot open %s: %s\n", argv[1], TTF_GetError());
+        return 1;
+    }
+    float lineHeight = static_cast<float>(TTF_FontHeight(font)) / WINDOW_SIZE.y;
+
+    Gfx::CGLDevice* device = new Gfx::CGLDevice(Gfx::GLDeviceConfig());
+    device->Create();
+
+    printf("%d lines of code at %d points, %d frames\n", LINES, size, FRAMES);
+    {
+        CGlyphTextures textures(device, font);
+        Run("glyph textures", device, textures, lineHeight);
+
+        CAtlasText atlas(device, font);
+        Run("atlas", device, atlas, lineHeight);
+    }
+
+    device->Destroy();
+    delete device;
+
+    TTF_CloseFont(font);
+    TTF_Quit();
+    SDL_Quit();
+
+    return 0;
+}
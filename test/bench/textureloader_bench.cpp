@@ -0,0 +1,119 @@
+// * This file is part of the COLOBOT source code
+// * Copyright (C) 2001-2008, Daniel ROUX & EPSITEC SA, www.epsitec.ch
+// *
+// * This program is free software: you can redistribute it and/or modify
+// * it under the terms of the GNU General Public License as published by
+// * the Free Software Foundation, either version 3 of the License, or
+// * (at your option) any later version.
+// *
+// * This program is distributed in the hope that it will be useful,
+// * but WITHOUT ANY WARRANTY; without even the implied warranty of
+// * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// * GNU General Public License for more details.
+// *
+// * You should have received a copy of the GNU General Public License
+// * along with this program. If not, see  http://www.gnu.org/licenses/.
+
+/**
+ * \file textureloader_bench.cpp
+ * \brief Benchmark of the decoding of textures against the number of threads
+ *
+ * Usage: textureloader_bench [-t max_threads] image_file...
+ *
+ * For example, with the textures of the game:
+ *   textureloader_bench data/textures/\*.png
+ *
+ * All the images are decoded by CTextureLoader with 1, 2, 4, ... threads up
+ * to the number of cores (or max_threads), as LoadAllTextures() does when
+ * a scene is loaded. The wall time of each run is printed with the speedup
+ * against one thread.
+ */
+
+#include "common/logger.h"
+
+#include "graphics/engine/textureloader.h"
+
+#include <SDL.h>
+#include <SDL_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+//! Decodes all the images on \a threads threads, returns the wall time in ms
+double Run(const std::vector<std::string>& fileNames, int threads, int& loaded)
+{
+    Gfx::CTextureLoader loader(threads);
+    for (const std::string& fileName : fileNames)
+        loader.Add(fileName, fileName);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    loader.Decode();
+    auto end = std::chrono::high_resolution_clock::now();
+
+    loaded = 0;
+    for (const std::string& fileName : fileNames)
+    {
+        if (loader.GetImage(fileName) != nullptr)
+            loaded++;
+    }
+
+    return std::chrono::duration<double, std::milli>(end-start).count();
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char* argv[])
+{
+    int maxThreads = static_cast<int>(std::thread::hardware_concurrency());
+    std::vector<std::string> fileNames;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-t") == 0 && i+1 < argc)
+            maxThreads = atoi(argv[++i]);
+        else
+            fileNames.push_back(argv[i]);
+    }
+
+    if (fileNames.empty())
+    {
+        printf("Usage: %s [-t max_threads] image_file...\n", argv[0]);
+        return 1;
+    }
+
+    CLogger logger;
+    logger.SetLogLevel(LOG_ERROR);
+
+    IMG_Init(IMG_INIT_PNG);
+
+    // Once to have the files in the cache of the system
+    int loaded = 0;
+    Run(fileNames, maxThreads, loaded);
+    printf("%d images, %d decoded\n", static_cast<int>( fileNames.size() ), loaded);
+
+    printf("%8s %14s %8s\n", "threads", "wall time (ms)", "speedup");
+    double single = 0.0;
+    for (int threads = 1; threads <= std::max(maxThreads, 1); threads *= 2)
+    {
+        double time = Run(fileNames, threads, loaded);
+        if (threads == 1)
+            single = time;
+
+        printf("%8d %14.1f %7.2fx\n", threads, time, single / time);
+
+        if (threads < maxThreads && threads * 2 > maxThreads)
+            threads = maxThreads / 2;  // the number of cores last
+    }
+
+    IMG_Quit();
+    return 0;
+}
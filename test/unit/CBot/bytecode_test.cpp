@@ -0,0 +1,232 @@
+#include "CBot/CBotDll.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+
+
+namespace {
+
+std::string g_output;
+
+bool rPrint(CBotVar* pVar, CBotVar* pResult, int& Exception, void* pUser)
+{
+    for (; pVar != nullptr; pVar = pVar->GetNext())
+    {
+        g_output += pVar->GetValString();
+        g_output += " ";
+    }
+    g_output += "\n";
+    return true;
+}
+
+CBotTypResult cPrint(CBotVar* &pVar, void* pUser)
+{
+    return CBotTypResult(0);
+}
+
+} // anonymous namespace
+
+
+class CBotByteCodeUT : public testing::Test
+{
+protected:
+    static void SetUpTestCase()
+    {
+        CBotProgram::Init();
+        CBotProgram::AddFunction("print", rPrint, cPrint);
+        CBotProgram::DefineNum("ROBOT", 5);
+    }
+
+    static void TearDownTestCase()
+    {
+        CBotProgram::SetByteCode(false);
+        CBotProgram::Free();
+    }
+
+    //! Result of a run: text printed, error and its position
+    struct Result
+    {
+        std::string output;
+        int code, start, end;
+    };
+
+    //! Runs the function to the end in slices of \a steps, saving and restoring the program every \a saveEvery slices
+    Result Run(const char* function, bool byteCode, int steps, int saveEvery = 0)
+    {
+        CBotProgram::SetByteCode(byteCode);
+        g_output.clear();
+
+        m_program.Start(function);
+        int runs = 0;
+        while (!m_program.Run(nullptr, steps))
+        {
+            runs++;
+            if (saveEvery > 0 && runs % saveEvery == 0)
+            {
+                FILE* file = tmpfile();
+                m_program.SaveState(file);
+                rewind(file);
+                m_program.RestoreState(file);
+                fclose(file);
+            }
+        }
+
+        Result result;
+        result.output = g_output;
+        m_program.GetError(result.code, result.start, result.end);
+        return result;
+    }
+
+    //! Checks that the bytecode gives the same results as the tree, whatever the slices
+    void ExpectSame(const char* function, int saveEvery = 0)
+    {
+        for (int steps : {1, 7, 1000})
+        {
+            Result tree = Run(function, false, steps);
+            Result bytes = Run(function, true, steps, saveEvery);
+            EXPECT_EQ(tree.output, bytes.output) << function << " in slices of " << steps;
+            EXPECT_EQ(tree.code, bytes.code) << function;
+            EXPECT_EQ(tree.start, bytes.start) << function;
+            EXPECT_EQ(tree.end, bytes.end) << function;
+        }
+    }
+
+    void Compile(const char* source)
+    {
+        CBotStringArray functions;
+        ASSERT_TRUE(m_program.Compile(source, functions));
+    }
+
+    CBotProgram m_program;
+};
+
+TEST_F(CBotByteCodeUT, Operations)
+{
+    Compile(
+        "extern public void t()\n"
+        "{\n"
+        "    int a = 5; float f = 2.5; string s = \"x\"; boolean b = true;\n"
+        "    print(a / 2, a % 3, f / 2, f % 2, 7 >> 1, ~a, !b, -f);\n"
+        "    print(s + a + f + b, s < \"y\", s == \"x\", a < f, 3 == 3.0);\n"
+        "    int n = nan; print(n == nan, n != nan, a == nan, n);\n"
+        "    a += 3; a *= 2; a -= 1; a /= 2; a %= 4; a <<= 3; a >>= 1; a |= 5; a &= 12; a ^= 3;\n"
+        "    f += 1; f /= 3; f *= a; s += \"yz\"; s += a;\n"
+        "    print(a, f, s, a++, ++a, a--, --a, f++, ++f);\n"
+        "    int r = ROBOT; print(r, r + 1, -r); r++; print(r);\n"
+        "    n += 1; print(n);\n"
+        "    print(a > 2 ? \"big\" : \"small\", true && false || true, b && a > 100);\n"
+        "}\n");
+    ExpectSame("t");
+}
+
+TEST_F(CBotByteCodeUT, Loops)
+{
+    Compile(
+        "extern public void t()\n"
+        "{\n"
+        "    int total = 0;\n"
+        "    outer: for (int i = 0; i < 5; i++) { for (int j = 0; j < 5; j++) { if (j == i) continue outer; total += j; } }\n"
+        "    int c = 0;\n"
+        "    lbl: while (c < 100) { c++; int d = 0; do { d++; if (d == 5) continue; if (c == 10) break lbl; } while (d < 8); }\n"
+        "    float x = 1; for (;;) { x *= 1.5; if (x > 100) break; }\n"
+        "    print(total, c, x);\n"
+        "}\n");
+    ExpectSame("t");
+}
+
+TEST_F(CBotByteCodeUT, Errors)
+{
+    Compile(
+        "extern public void divide() { int a = 0; print(1); int b = 5 / a; print(2); }\n"
+        "extern public void modulo() { int a = 7; a %= 0; }\n"
+        "extern public void undefined() { int a; if (1 > 2) a = 1; print(a); }\n"
+        "extern public void compound() { int a; if (1 > 2) a = 1; a += 1; }\n"
+        "extern public void increment() { int a = nan; a++; }\n"
+        "extern public void compare() { float a = nan; print(a < 1); }\n");
+    ExpectSame("divide");
+    ExpectSame("modulo");
+    ExpectSame("undefined");
+    ExpectSame("compound");
+    ExpectSame("increment");
+    ExpectSame("compare");
+}
+
+TEST_F(CBotByteCodeUT, Calls)
+{
+    Compile(
+        "extern public int Fibo(int n, boolean b)\n"
+        "{\n"
+        "    if (n < 2) return n;\n"
+        "    int a = Fibo(n-1, b) + Fibo(n-2, false);\n"
+        "    if (b) print(n + \"=\" + a);\n"
+        "    return a;\n"
+        "}\n"
+        "float half(float a, int b) { return a / b; }\n"
+        "string repeat(string s, int n) { string r = \"\"; for (int i = 0; i < n; i++) r += s; return r; }\n"
+        "int first(int n) { int t[]; t[0] = n; return t[0]; }\n"
+        "extern public void t()\n"
+        "{\n"
+        "    Fibo(12, true);\n"
+        "    print(half(3, 2), repeat(\"ab\", 3), first(4));\n"
+        "}\n");
+    ExpectSame("t");
+}
+
+TEST_F(CBotByteCodeUT, SaveState)
+{
+    // Integers are saved on 16 bits, the values stay small
+    Compile(
+        "extern public void t()\n"
+        "{\n"
+        "    float sum = 0;\n"
+        "    for (int i = 0; i < 300; i++) { sum += sq(i % 50) / 10; if (i % 60 == 0) print(i, sum); }\n"
+        "    print(sum);\n"
+        "}\n"
+        "int sq(int n) { int r = 0; for (int i = 0; i < n; i++) r += n; return r; }\n");
+    ExpectSame("t", 3);
+}
+
+TEST_F(CBotByteCodeUT, LocalVariables)
+{
+    // Same names in sibling blocks, recursion and methods, found by their slots in the tree
+    Compile(
+        "public class Counter\n"
+        "{\n"
+        "    int count = 0;\n"
+        "    void Add(int n) { int step = n; for (int i = 0; i < 3; i++) { int count2 = count; count = count2 + step; } }\n"
+        "}\n"
+        "int depth(int n) { int local = n * 10; if (n > 0) local += depth(n - 1); return local; }\n"
+        "extern public void t()\n"
+        "{\n"
+        "    for (int i = 0; i < 3; i++) { int x = i * 2; print(x); }\n"
+        "    for (int i = 5; i < 7; i++) { float x = i / 2.0; print(x); }\n"
+        "    { int y = 1; { int z = y + 1; y = z * 3; } print(y); }\n"
+        "    { string y = \"s\"; print(y); }\n"
+        "    print(depth(6));\n"
+        "}\n"
+        "extern public void methods()\n"
+        "{\n"
+        "    Counter c(); c.Add(2); c.Add(5); print(c.count);\n"
+        "}\n");
+    ExpectSame("t", 2);
+    ExpectSame("methods");
+}
+
+TEST_F(CBotByteCodeUT, Arrays)
+{
+    Compile(
+        "extern public void t()\n"
+        "{\n"
+        "    int a[]; for (int i = 0; i < 300; i++) a[i] = i * 3;\n"
+        "    int sum = 0; for (int i = 0; i < sizeof(a); i++) sum += a[i];\n"
+        "    print(sizeof(a), sum, a[299]);\n"
+        "    float b[5]; b[4] = 1.5; print(sizeof(b), b[4]);\n"
+        "    int c[] = (1, 2, 3); int d[]; d = c; d[3] = 4; print(c[3], sizeof(c));\n"
+        "    int s[][]; s[2][1] = 7; print(sizeof(s), sizeof(s[2]), s[2][1]);\n"
+        "    int e[]; e = c; c = null; print(sizeof(e), sizeof(c), e[3]);\n"
+        "}\n");
+    EXPECT_EQ("300 134550 897 \n5 1.50 \n4 4 \n3 2 7 \n4 0 4 \n", Run("t", false, 1000).output);
+    ExpectSame("t");
+}
@@ -0,0 +1,247 @@
+#include "CBot/CBotDll.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+//! Text printed by a program, given as pUser to Run()
+struct Output
+{
+    std::string text;
+    int calls = 0;
+};
+
+bool rPrint(CBotVar* pVar, CBotVar* pResult, int& Exception, void* pUser)
+{
+    Output* output = static_cast<Output*>(pUser);
+    for (; pVar != nullptr; pVar = pVar->GetNext())
+    {
+        output->text += pVar->GetValString();
+        output->text += " ";
+    }
+    output->text += "\n";
+    output->calls++;
+    return true;
+}
+
+CBotTypResult cPrint(CBotVar* &pVar, void* pUser)
+{
+    return CBotTypResult(0);
+}
+
+bool rHalf(CBotVar* pVar, CBotVar* pResult, int& Exception, void* pUser)
+{
+    pResult->SetValFloat(pVar->GetValFloat() / 2.0f);
+    return true;
+}
+
+CBotTypResult cHalf(CBotVar* &pVar, void* pUser)
+{
+    return CBotTypResult(CBotTypFloat);
+}
+
+//! Program computing with the external half(), printing with print()
+std::string Program(int n)
+{
+    return
+        "extern void t()\n"
+        "{\n"
+        "    int n = " + std::to_string(n) + ";\n"
+        "    float sum = 0;\n"
+        "    for (int i = 0; i < 400; i++)\n"
+        "    {\n"
+        "        sum += half(i % n);\n"
+        "        if (i % 50 == 0) print(n, i, sum);\n"
+        "    }\n"
+        "    print(sum);\n"
+        "}\n";
+}
+
+//! Class whose instance the programs share through a static field
+const char* SHARED_CLASS =
+    "public class Shared\n"
+    "{\n"
+    "    static Shared s = null;\n"
+    "    int count = 0;\n"
+    "    int[] log;\n"
+    "}\n"
+    "extern void check()\n"
+    "{\n"
+    "    Shared any = new Shared();\n"
+    "    int sum = 0;\n"
+    "    for (int i = 0; i < any.s.count; i++) sum += any.s.log[i];\n"
+    "    print(any.s.count, sum);\n"
+    "}\n";
+
+//! Program adding to the instance of the static field, through a local pointer
+std::string SharedProgram(int n)
+{
+    return
+        "extern void t()\n"
+        "{\n"
+        "    Shared any = new Shared();\n"
+        "    if (any.s == null) any.s = new Shared();\n"
+        "    Shared p = any.s;\n"
+        "    for (int i = 0; i < 300; i++)\n"
+        "    {\n"
+        "        p.log[p.count] = " + std::to_string(n) + ";\n"
+        "        p.count = p.count + 1;\n"
+        "    }\n"
+        "}\n";
+}
+
+} // anonymous namespace
+
+
+class CBotComputeUT : public testing::Test
+{
+protected:
+    static void SetUpTestCase()
+    {
+        CBotProgram::Init();
+        CBotProgram::AddFunction("print", rPrint, cPrint);
+        CBotProgram::AddFunction("half", rHalf, cHalf, true);
+    }
+
+    static void TearDownTestCase()
+    {
+        CBotProgram::Free();
+    }
+
+    void SetUp() override
+    {
+        for (int i = 0; i < PROGRAMS; i++)
+        {
+            CBotStringArray functions;
+            ASSERT_TRUE(m_programs[i].Compile(Program(i + 3).c_str(), functions));
+            m_programs[i].Start("t");
+        }
+    }
+
+    //! Runs the programs to the end, one after the other, as without threads
+    static void RunSerial(CBotProgram programs[], Output outputs[], int runs[])
+    {
+        for (int i = 0; i < PROGRAMS; i++)
+        {
+            runs[i] = 1;
+            while (!programs[i].Run(&outputs[i], STEPS)) runs[i]++;
+        }
+    }
+
+    //! Runs the programs to the end, each slice on its own thread, then on this thread if it waits for the application
+    static void RunThreads(CBotProgram programs[], Output outputs[], int runs[])
+    {
+        bool ended[PROGRAMS] = {};
+        for (int i = 0; i < PROGRAMS; i++) runs[i] = 0;
+
+        while (true)
+        {
+            std::vector<std::thread> threads;
+            for (int i = 0; i < PROGRAMS; i++)
+            {
+                if (ended[i]) continue;
+                runs[i]++;
+                threads.push_back(std::thread([programs, i, &ended]()
+                {
+                    ended[i] = programs[i].RunCompute(nullptr, STEPS);
+                }));
+            }
+            if (threads.empty()) break;
+            for (auto& thread : threads) thread.join();
+
+            for (int i = 0; i < PROGRAMS; i++)
+            {
+                if (!ended[i] && programs[i].IsWaiting())
+                    ended[i] = programs[i].Run(&outputs[i], STEPS);
+            }
+        }
+    }
+
+    //! Runs the programs sharing an instance, serially or on threads, returns what check() prints then
+    static std::string RunShared(bool bThreads)
+    {
+        // the class is compiled first, and freed last
+        CBotProgram library;
+        CBotStringArray functions;
+        EXPECT_TRUE(library.Compile(SHARED_CLASS, functions));
+
+        Output outputs[PROGRAMS];
+        int runs[PROGRAMS];
+        {
+            CBotProgram programs[PROGRAMS];
+            for (int i = 0; i < PROGRAMS; i++)
+            {
+                EXPECT_TRUE(programs[i].Compile(SharedProgram(i + 1).c_str(), functions));
+                programs[i].Start("t");
+            }
+
+            if (bThreads) RunThreads(programs, outputs, runs);
+            else          RunSerial(programs, outputs, runs);
+
+            for (int i = 0; i < PROGRAMS; i++)
+                EXPECT_EQ(0, programs[i].GetError()) << "program " << i;
+        }
+
+        Output output;
+        library.Start("check");
+        while (!library.Run(&output)) ;
+        EXPECT_EQ(0, library.GetError());
+        return output.text;
+    }
+
+    static const int PROGRAMS = 4;
+    static const int STEPS = 100;
+    CBotProgram m_programs[PROGRAMS];
+};
+
+TEST_F(CBotComputeUT, SameAsSerial)
+{
+    Output serial[PROGRAMS], threads[PROGRAMS];
+    int serialRuns[PROGRAMS], threadRuns[PROGRAMS];
+
+    // the first Run() takes the steps of the previous one
+    CBotProgram::SetTimer(STEPS);
+    RunSerial(m_programs, serial, serialRuns);
+    SetUp();
+    RunThreads(m_programs, threads, threadRuns);
+
+    for (int i = 0; i < PROGRAMS; i++)
+    {
+        EXPECT_EQ(9, serial[i].calls);
+        EXPECT_EQ(serial[i].text, threads[i].text) << "program " << i;
+        EXPECT_EQ(serialRuns[i], threadRuns[i]) << "program " << i;
+        EXPECT_EQ(0, m_programs[i].GetError());
+    }
+}
+
+TEST_F(CBotComputeUT, WaitsBeforeApplication)
+{
+    Output output;
+    CBotProgram& program = m_programs[0];
+
+    // the program computes until the first print()
+    EXPECT_FALSE(program.RunCompute(&output, 30));
+    EXPECT_TRUE(program.IsWaiting());
+    EXPECT_EQ(0, output.calls);
+
+    // which is called by Run(), then the steps left are used
+    EXPECT_FALSE(program.Run(&output, 30));
+    EXPECT_FALSE(program.IsWaiting());
+    EXPECT_EQ(1, output.calls);
+}
+
+TEST_F(CBotComputeUT, SharedThroughStaticField)
+{
+    CBotProgram::SetTimer(STEPS);
+    std::string serial = RunShared(false);
+    EXPECT_EQ("1200 3000 \n", serial);
+
+    // the instance is only changed on this thread once a program read the static field
+    for (int i = 0; i < 10; i++)
+        EXPECT_EQ(serial, RunShared(true)) << "run " << i;
+}
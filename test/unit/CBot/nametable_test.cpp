@@ -0,0 +1,183 @@
+#include "CBot/CBotDll.h"
+#include "CBot/CBotToken.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+
+namespace {
+
+//! Slot of a name in a table of 64 entries, as CBotNameTable::Hash() gives it
+unsigned int Slot(const std::string& name)
+{
+    unsigned int hash = 2166136261u;
+    for (char c : name)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+    return hash & 63;
+}
+
+//! Returns \a count names falling in the same slot as \a name
+std::vector<std::string> Collisions(const std::string& name, int count)
+{
+    std::vector<std::string> names;
+    for (int i = 0; static_cast<int>(names.size()) < count; i++)
+    {
+        std::string other = "n" + std::to_string(i);
+        if (Slot(other) == Slot(name))
+            names.push_back(other);
+    }
+    return names;
+}
+
+struct Token
+{
+    std::string text;
+    int         type;
+    long        id;
+};
+
+std::vector<Token> Tokenize(const char* text)
+{
+    std::vector<Token> result;
+
+    int error = 0;
+    CBotToken* tokens = CBotToken::CompileTokens(text, error);
+
+    // Between the empty first token and the terminator
+    for (CBotToken* p = tokens->GetNext(); p != nullptr && p->GetNext() != nullptr; p = p->GetNext())
+    {
+        Token token;
+        token.text = p->GetString();
+        token.type = p->GetType();
+        token.id   = p->GetIdKey();
+        result.push_back(token);
+    }
+    CBotToken::Delete(tokens);
+    return result;
+}
+
+} // anonymous namespace
+
+
+TEST(CBotNameTableUT, FindsAddedNames)
+{
+    CBotNameTable table;
+    long val = 0;
+    EXPECT_FALSE(table.Find("a", val));
+
+    EXPECT_TRUE(table.Add("a", 1));
+    EXPECT_TRUE(table.Add("b", 2));
+    EXPECT_FALSE(table.Add("a", 3));  // already there, keeps its value
+    EXPECT_EQ(2, table.GetSize());
+
+    EXPECT_TRUE(table.Find("a", val));
+    EXPECT_EQ(1, val);
+    EXPECT_TRUE(table.Find("b", val));
+    EXPECT_EQ(2, val);
+
+    val = -1;
+    EXPECT_FALSE(table.Find("c", val));
+    EXPECT_FALSE(table.Find("", val));
+    EXPECT_FALSE(table.Find("aa", val));
+    EXPECT_EQ(-1, val);
+
+    table.Empty();
+    EXPECT_EQ(0, table.GetSize());
+    EXPECT_FALSE(table.Find("a", val));
+}
+
+TEST(CBotNameTableUT, FindsCollidingNames)
+{
+    // All in the slot of "a", added after it
+    std::vector<std::string> names = Collisions("a", 6);
+
+    CBotNameTable table;
+    EXPECT_TRUE(table.Add("a", 100));
+    for (int i = 0; i < 5; i++)
+        EXPECT_TRUE(table.Add(names[i].c_str(), i));
+
+    long val = 0;
+    EXPECT_TRUE(table.Find("a", val));
+    EXPECT_EQ(100, val);
+    for (int i = 0; i < 5; i++)
+    {
+        EXPECT_TRUE(table.Find(names[i].c_str(), val)) << names[i];
+        EXPECT_EQ(i, val);
+    }
+    EXPECT_FALSE(table.Add(names[4].c_str(), 4));
+
+    // Searched through all the colliding entries
+    EXPECT_FALSE(table.Find(names[5].c_str(), val));
+}
+
+TEST(CBotNameTableUT, GrowsWithoutLosingNames)
+{
+    CBotNameTable table;
+    for (int i = 0; i < 1000; i++)
+        EXPECT_TRUE(table.Add(("name" + std::to_string(i)).c_str(), i));
+    EXPECT_EQ(1000, table.GetSize());
+
+    long val = 0;
+    for (int i = 0; i < 1000; i++)
+    {
+        ASSERT_TRUE(table.Find(("name" + std::to_string(i)).c_str(), val));
+        EXPECT_EQ(i, val);
+    }
+    EXPECT_FALSE(table.Find("name1000", val));
+}
+
+
+class CBotNameTableTokenUT : public testing::Test
+{
+protected:
+    static void SetUpTestCase()
+    {
+        CBotProgram::Init();
+        CBotProgram::DefineNum("whi", 7);
+        CBotProgram::DefineNum("Whilex", 8);
+    }
+
+    static void TearDownTestCase()
+    {
+        CBotProgram::Free();
+    }
+};
+
+TEST_F(CBotNameTableTokenUT, TellsKeywordsFromTheirPrefixes)
+{
+    std::vector<Token> tokens = Tokenize("whi while Whilex whil");
+    ASSERT_EQ(4u, tokens.size());
+
+    // A name given by DefineNum which is the beginning of a keyword
+    EXPECT_EQ(TokenTypDef, tokens[0].type);
+    EXPECT_EQ(7, tokens[0].id);
+
+    // The type of a keyword is its code
+    EXPECT_EQ(ID_WHILE, tokens[1].type);
+
+    EXPECT_EQ(TokenTypDef, tokens[2].type);
+    EXPECT_EQ(8, tokens[2].id);
+
+    // Neither a keyword nor a name
+    EXPECT_EQ(TokenTypVar, tokens[3].type);
+
+    EXPECT_FALSE(CBotProgram::DefineNum("whi", 9));
+}
+
+TEST_F(CBotNameTableTokenUT, GrowsOperatorsToTheLongest)
+{
+    std::vector<Token> tokens = Tokenize("a<b<<c<<=d");
+    ASSERT_EQ(7u, tokens.size());
+
+    EXPECT_EQ("<", tokens[1].text);
+    EXPECT_EQ(ID_LO, tokens[1].type);
+    EXPECT_EQ("<<", tokens[3].text);
+    EXPECT_EQ(ID_SL, tokens[3].type);
+    EXPECT_EQ("<<=", tokens[5].text);
+    EXPECT_EQ(ID_ASSSL, tokens[5].type);
+}
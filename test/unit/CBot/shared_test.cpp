@@ -0,0 +1,232 @@
+#include "CBot/CBotDll.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+//! Text printed by a program, the user pointer of its instance
+struct Output
+{
+    std::string text;
+};
+
+bool rPrint(CBotVar* pVar, CBotVar* pResult, int& Exception, void* pUser)
+{
+    Output* output = static_cast<Output*>(pUser);
+    for (; pVar != nullptr; pVar = pVar->GetNext())
+    {
+        output->text += pVar->GetValString();
+        output->text += " ";
+    }
+    return true;
+}
+
+CBotTypResult cPrint(CBotVar* &pVar, void* pUser)
+{
+    return CBotTypResult(0);
+}
+
+const char* PROGRAM =
+    "extern void bot::t()\n"
+    "{\n"
+    "    int sum = 0;\n"
+    "    for (int i = 0; i < 10; i++) sum += twice(i);\n"
+    "    print(id, sum);\n"
+    "}\n"
+    "int twice(int x)\n"
+    "{\n"
+    "    return 2 * x;\n"
+    "}\n";
+
+const char* OTHER =
+    "extern void c()\n"
+    "{\n"
+    "    print(42);\n"
+    "}\n";
+
+//! Public function called by CALLER, compiled in another program
+const char* LIBRARY =
+    "public int shared_test_triple(int x)\n"
+    "{\n"
+    "    return 3 * x;\n"
+    "}\n";
+
+const char* CALLER =
+    "extern void u()\n"
+    "{\n"
+    "    int sum = 0;\n"
+    "    for (int i = 0; i < 100; i++) sum += shared_test_triple(i);\n"
+    "    print(sum);\n"
+    "}\n";
+
+//! Runs function \a name of the program to its end, returns what it printed in \a output
+std::string RunToEnd(CBotProgram& program, const char* name, Output& output)
+{
+    output.text.clear();
+    EXPECT_TRUE(program.Start(name));
+    while (!program.Run(&output)) ;
+    EXPECT_EQ(0, program.GetError());
+    return output.text;
+}
+
+} // anonymous namespace
+
+
+class CBotSharedUT : public testing::Test
+{
+protected:
+    static void SetUpTestCase()
+    {
+        CBotProgram::Init();
+        CBotProgram::AddFunction("print", rPrint, cPrint);
+
+        CBotClass* bc = new CBotClass("bot", nullptr);
+        bc->AddItem("id", CBotTypResult(CBotTypInt), PR_READ);
+    }
+
+    static void TearDownTestCase()
+    {
+        CBotProgram::Free();
+    }
+
+    void SetUp() override
+    {
+        for (int i = 0; i < BOTS; i++)
+        {
+            m_bots[i] = CBotVar::Create("", CBotTypResult(CBotTypClass, "bot"));
+            m_bots[i]->GetItem("id")->SetValInt(i + 1);
+            m_bots[i]->SetUserPtr(&m_outputs[i]);
+        }
+    }
+
+    void TearDown() override
+    {
+        for (int i = 0; i < BOTS; i++)
+            delete m_bots[i];
+
+        EXPECT_EQ(0, CBotProgram::GetSharedCount());
+    }
+
+    static const int BOTS = 3;
+    CBotVar* m_bots[BOTS];
+    Output m_outputs[BOTS];
+};
+
+TEST_F(CBotSharedUT, SharesFunctionsOfSameText)
+{
+    std::unique_ptr<CBotProgram> programs[BOTS];
+    for (int i = 0; i < BOTS; i++)
+    {
+        programs[i].reset(new CBotProgram(m_bots[i]));
+
+        CBotStringArray functions;
+        ASSERT_TRUE(programs[i]->CompileShared(PROGRAM, functions, nullptr, 1));
+        ASSERT_EQ(1, functions.GetSize());
+        EXPECT_STREQ("t", functions[0]);
+    }
+
+    EXPECT_EQ(1, CBotProgram::GetSharedCount());
+    EXPECT_EQ(programs[0]->GetFunctions(), programs[1]->GetFunctions());
+    EXPECT_EQ(programs[0]->GetFunctions(), programs[2]->GetFunctions());
+
+    // Each program runs with its own instance
+    EXPECT_EQ("1 90 ", RunToEnd(*programs[0], "t", m_outputs[0]));
+    EXPECT_EQ("2 90 ", RunToEnd(*programs[1], "t", m_outputs[1]));
+    EXPECT_EQ("3 90 ", RunToEnd(*programs[2], "t", m_outputs[2]));
+}
+
+TEST_F(CBotSharedUT, CompilesOtherTextsAndContexts)
+{
+    CBotProgram program1(m_bots[0]), program2(m_bots[1]), program3(m_bots[2]), program4(m_bots[2]);
+    CBotStringArray functions;
+    ASSERT_TRUE(program1.CompileShared(PROGRAM, functions, nullptr, 1));
+    ASSERT_TRUE(program2.CompileShared(PROGRAM, functions, nullptr, 2));
+    ASSERT_TRUE(program3.CompileShared(OTHER, functions, nullptr, 1));
+    ASSERT_TRUE(program4.Compile(PROGRAM, functions));
+
+    EXPECT_EQ(3, CBotProgram::GetSharedCount());
+    EXPECT_NE(program1.GetFunctions(), program2.GetFunctions());
+    EXPECT_NE(program1.GetFunctions(), program4.GetFunctions());
+
+    // Compiling another text forgets the previous one
+    ASSERT_TRUE(program2.CompileShared(OTHER, functions, nullptr, 1));
+    EXPECT_EQ(2, CBotProgram::GetSharedCount());
+    EXPECT_EQ(program3.GetFunctions(), program2.GetFunctions());
+
+    // Texts with errors, classes or public functions are not shared
+    EXPECT_FALSE(program4.CompileShared("extern void e() { int; }", functions));
+    ASSERT_TRUE(program4.CompileShared("public class shared_test_class { int a; }\n"
+                                       "extern void f() { }\n", functions));
+    ASSERT_TRUE(program1.CompileShared("extern void g() { }\n"
+                                       "public void shared_test_public() { }\n", functions));
+    EXPECT_EQ(1, CBotProgram::GetSharedCount());
+}
+
+TEST_F(CBotSharedUT, KeepsFunctionsOfDeletedPrograms)
+{
+    std::unique_ptr<CBotProgram> first(new CBotProgram(m_bots[0]));
+    CBotProgram second(m_bots[1]), third(m_bots[2]);
+
+    CBotStringArray functions;
+    ASSERT_TRUE(first->CompileShared(PROGRAM, functions, nullptr, 1));
+    ASSERT_TRUE(second.CompileShared(PROGRAM, functions, nullptr, 1));
+
+    first.reset();
+    EXPECT_EQ(1, CBotProgram::GetSharedCount());
+    EXPECT_EQ("2 90 ", RunToEnd(second, "t", m_outputs[1]));
+
+    ASSERT_TRUE(third.CompileShared(PROGRAM, functions, nullptr, 1));
+    EXPECT_EQ(second.GetFunctions(), third.GetFunctions());
+    EXPECT_EQ("3 90 ", RunToEnd(third, "t", m_outputs[2]));
+
+    // The same text again for the second program
+    ASSERT_TRUE(second.CompileShared(PROGRAM, functions, nullptr, 1));
+    EXPECT_EQ(1, CBotProgram::GetSharedCount());
+    EXPECT_EQ(third.GetFunctions(), second.GetFunctions());
+    EXPECT_EQ("2 90 ", RunToEnd(second, "t", m_outputs[1]));
+}
+
+TEST_F(CBotSharedUT, FindsRecompiledFunctionOnThreads)
+{
+    CBotProgram library;
+    CBotStringArray functions;
+    ASSERT_TRUE(library.Compile(LIBRARY, functions));
+
+    std::unique_ptr<CBotProgram> programs[BOTS];
+    for (int i = 0; i < BOTS; i++)
+    {
+        programs[i].reset(new CBotProgram());
+        ASSERT_TRUE(programs[i]->CompileShared(CALLER, functions, nullptr, 1));
+    }
+
+    // The identifier of the public function kept by the shared call is now stale
+    ASSERT_TRUE(library.Compile(LIBRARY, functions));
+
+    for (int run = 0; run < 2; run++)
+    {
+        // The programs find the function again by name at the same time, up to print()
+        std::vector<std::thread> threads;
+        for (int i = 0; i < BOTS; i++)
+        {
+            ASSERT_TRUE(programs[i]->Start("u"));
+            CBotProgram* program = programs[i].get();
+            threads.push_back(std::thread([program]() { program->RunCompute(nullptr, 100000); }));
+        }
+        for (auto& thread : threads) thread.join();
+
+        for (int i = 0; i < BOTS; i++)
+        {
+            EXPECT_TRUE(programs[i]->IsWaiting());
+            m_outputs[i].text.clear();
+            while (!programs[i]->Run(&m_outputs[i])) ;
+            EXPECT_EQ(0, programs[i]->GetError());
+            EXPECT_EQ("14850 ", m_outputs[i].text) << "program " << i << ", run " << run;
+        }
+    }
+}
@@ -0,0 +1,152 @@
+#include "CBot/CBotDll.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+const char* PROGRAM =
+    "// a program\n"
+    "extern void object::Test()\n"
+    "{\n"
+    "    int    i = 0x1F, j;\n"
+    "    float  x = 1.5e-3;\n"
+    "    string s = \"a \\\"text\\\"\\n\";\n"
+    "    /* a comment\n"
+    "       on two lines */\n"
+    "    for ( i = 0 ; i < 10 ; i++ )\n"
+    "    {\n"
+    "        if ( i >= 5 && i != 7 ) j += i;\n"
+    "        x = x * 2 / (j-1);\n"
+    "    }\n"
+    "    return;\n"
+    "}\n";
+
+//! Cuts the whole text as CBotToken::CompileTokens()
+std::vector<CBotTokenSpan> Tokenize(const std::string& text)
+{
+    std::vector<CBotTokenSpan> spans;
+
+    int error = 0;
+    CBotToken* tokens = CBotToken::CompileTokens(text.c_str(), error);
+    for (CBotToken* p = tokens; p != nullptr && p->GetNext() != nullptr; p = p->GetNext())
+    {
+        CBotTokenSpan span;
+        span.start = p->GetStart();
+        span.end   = p->GetEnd();
+        span.next  = p->GetNext()->GetStart();
+        span.type  = p->GetType();
+        spans.push_back(span);
+    }
+    CBotToken::Delete(tokens);
+
+    if (!spans.empty()) spans.back().next = text.size();
+    return spans;
+}
+
+void ExpectTokens(CBotTokenList& list, const std::string& text)
+{
+    std::vector<CBotTokenSpan> expected = Tokenize(text);
+    ASSERT_EQ(static_cast<int>(expected.size()), list.GetSize()) << text;
+    for (int i = 0; i < list.GetSize(); i++)
+    {
+        EXPECT_EQ(expected[i].start, list.GetSpan(i).start) << i << " in " << text;
+        EXPECT_EQ(expected[i].end,   list.GetSpan(i).end)   << i << " in " << text;
+        EXPECT_EQ(expected[i].type,  list.GetSpan(i).type)  << i << " in " << text;
+        if (i+1 < list.GetSize())
+        {
+            EXPECT_EQ(list.GetSpan(i).next, list.GetSpan(i+1).start);
+        }
+    }
+}
+
+} // anonymous namespace
+
+
+class CBotTokenListUT : public testing::Test
+{
+protected:
+    static void SetUpTestCase()
+    {
+        CBotProgram::Init();
+    }
+
+    static void TearDownTestCase()
+    {
+        CBotProgram::Free();
+    }
+};
+
+TEST_F(CBotTokenListUT, CutsWholeText)
+{
+    CBotTokenList list;
+    int first, last;
+
+    list.Update(PROGRAM, first, last);
+    EXPECT_EQ(0, first);
+    EXPECT_EQ(list.GetSize(), last);
+    ExpectTokens(list, PROGRAM);
+
+    // Nothing to do for the same text
+    list.Update(PROGRAM, first, last);
+    EXPECT_EQ(first, last);
+
+    list.Update("", first, last);
+    EXPECT_EQ(0, list.GetSize());
+}
+
+TEST_F(CBotTokenListUT, CutsOnlyAroundChanges)
+{
+    CBotTokenList list;
+    int first, last;
+    std::string text = PROGRAM;
+    list.Update(text.c_str(), first, last);
+
+    // Typing a letter in a name changes its token and the one before only
+    size_t pos = text.find("j += i");
+    text.insert(pos + 1, "k");
+    list.Update(text.c_str(), first, last);
+    EXPECT_EQ(2, last - first);
+    EXPECT_EQ(static_cast<int>(pos), list.GetSpan(last-1).start);
+    EXPECT_EQ(static_cast<int>(pos) + 2, list.GetSpan(last-1).end);
+    ExpectTokens(list, text);
+
+    // Opening a comment changes all the tokens up to its end
+    pos = text.find("for");
+    text.insert(pos, "/*");
+    list.Update(text.c_str(), first, last);
+    EXPECT_EQ(list.GetSize(), last);
+    ExpectTokens(list, text);
+
+    text.erase(pos, 2);
+    list.Update(text.c_str(), first, last);
+    ExpectTokens(list, text);
+}
+
+TEST_F(CBotTokenListUT, FollowsRandomChanges)
+{
+    const char letters[] = "ab1 \n;=/*\"+.x(";
+    CBotTokenList list;
+    int first, last;
+    std::string text = PROGRAM;
+    list.Update(text.c_str(), first, last);
+
+    srand(1);
+    for (int n = 0; n < 500; n++)
+    {
+        int pos = rand() % (text.size() + 1);
+        if (rand() % 3 == 0 && pos < static_cast<int>(text.size()))
+            text.erase(pos, 1 + rand() % 3);
+        else
+            text.insert(pos, 1, letters[rand() % (sizeof(letters) - 1)]);
+
+        list.Update(text.c_str(), first, last);
+        ASSERT_LE(first, last);
+        ExpectTokens(list, text);
+        if (HasFailure()) break;
+    }
+}
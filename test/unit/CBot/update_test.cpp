@@ -0,0 +1,145 @@
+#include "CBot/CBotDll.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+
+namespace {
+
+//! Object of the application, as the class "thing" shows it
+struct Thing
+{
+    int id = 0;
+    float energy = 0.0f;
+    CBotVar* botVar = nullptr;
+};
+
+Thing g_thing;
+std::string g_output;
+int g_updates = 0;
+
+void uEnergy(CBotVar* pVar, void* user)
+{
+    g_updates++;
+    pVar->SetValFloat(static_cast<Thing*>(user)->energy);
+}
+
+void uId(CBotVar* pVar, void* user)
+{
+    g_updates++;
+    pVar->SetValInt(static_cast<Thing*>(user)->id);
+}
+
+bool rPrint(CBotVar* pVar, CBotVar* pResult, int& Exception, void* pUser)
+{
+    for (; pVar != nullptr; pVar = pVar->GetNext())
+    {
+        g_output += pVar->GetValString();
+        g_output += " ";
+    }
+    return true;
+}
+
+CBotTypResult cPrint(CBotVar* &pVar, void* pUser)
+{
+    return CBotTypResult(0);
+}
+
+bool rFind(CBotVar* pVar, CBotVar* pResult, int& Exception, void* pUser)
+{
+    pResult->SetPointer(g_thing.botVar);
+    return true;
+}
+
+CBotTypResult cFind(CBotVar* &pVar, void* pUser)
+{
+    return CBotTypResult(CBotTypPointer, "thing");
+}
+
+//! Reads the elements of its parameter as CScript::rCameraFocus() does
+bool rIdOf(CBotVar* pVar, CBotVar* pResult, int& Exception, void* pUser)
+{
+    CBotVar* classVars = pVar->GetItemList();  // "energy"
+    classVars = classVars->GetNext();  // "id"
+    pResult->SetValInt(classVars->GetValInt());
+    return true;
+}
+
+CBotTypResult cIdOf(CBotVar* &pVar, void* pUser)
+{
+    if (pVar == nullptr) return CBotTypResult(TX_LOWPARAM);
+    if (pVar->GetType() != CBotTypPointer) return CBotTypResult(TX_BADPARAM);
+    return CBotTypResult(CBotTypInt);
+}
+
+} // anonymous namespace
+
+
+class CBotUpdateUT : public testing::Test
+{
+protected:
+    static void SetUpTestCase()
+    {
+        CBotProgram::Init();
+        CBotProgram::AddFunction("print", rPrint, cPrint);
+        CBotProgram::AddFunction("find", rFind, cFind);
+        CBotProgram::AddFunction("idof", rIdOf, cIdOf);
+
+        CBotClass* bc = new CBotClass("thing", nullptr);
+        bc->AddItem("energy", CBotTypResult(CBotTypFloat), PR_READ);
+        bc->AddItem("id",     CBotTypResult(CBotTypInt), PR_READ);
+        bc->AddUpdateFunc("energy", uEnergy);
+        bc->AddUpdateFunc("id",     uId);
+
+        g_thing.botVar = CBotVar::Create("", CBotTypResult(CBotTypClass, "thing"));
+        g_thing.botVar->SetUserPtr(&g_thing);
+    }
+
+    static void TearDownTestCase()
+    {
+        delete g_thing.botVar;
+        g_thing.botVar = nullptr;
+        CBotProgram::Free();
+    }
+
+    void SetUp() override
+    {
+        g_thing.id = 42;
+        g_thing.energy = 0.5f;
+        g_output.clear();
+        g_updates = 0;
+    }
+
+    //! Runs function t() of the program to the end, returns what it prints
+    std::string Run(const char* text)
+    {
+        CBotProgram program;
+        CBotStringArray functions;
+        EXPECT_TRUE(program.Compile(text, functions));
+        program.Start("t");
+        while (!program.Run()) ;
+        EXPECT_EQ(0, program.GetError());
+        return g_output;
+    }
+};
+
+TEST_F(CBotUpdateUT, UpdatesReadElement)
+{
+    EXPECT_EQ("0.50 ", Run("extern void t() { thing p = find(); print(p.energy); }"));
+    EXPECT_EQ(1, g_updates);
+
+    g_thing.energy = 0.25f;
+    g_output.clear();
+    EXPECT_EQ("0.25 ", Run("extern void t() { thing p = find(); print(p.energy); }"));
+}
+
+TEST_F(CBotUpdateUT, UpdatesParameterOfRoutine)
+{
+    // the routine reads the element "id", which the program never did
+    EXPECT_EQ("42 ", Run("extern void t() { thing p = find(); print(idof(p)); }"));
+
+    g_thing.id = 7;
+    g_output.clear();
+    EXPECT_EQ("7 ", Run("extern void t() { print(idof(find())); }"));
+}
@@ -32,6 +32,11 @@ public:
     {
         return CApplication::CreateUpdateEvent();
     }
+
+    void SetFixedStep(long long step)
+    {
+        m_fixedStep = step;
+    }
 };
 
 class ApplicationUT : public testing::Test
@@ -315,3 +320,29 @@ TEST_F(ApplicationUT, UpdateEventTimeCalculation_SuspendingAndResumingSimulation
 
     TestCreateUpdateEvent(relTimeExact, absTimeExact, relTime, absTime, relTimeReal, absTimeReal);
 }
+
+TEST_F(ApplicationUT, UpdateEventTimeCalculation_FixedStep)
+{
+    EXPECT_CALL(*systemUtils, GetCurrentTimeStamp(_));
+    app->SetSimulationSpeed(2.0f);
+
+    long long step = 1000;
+    app->SetFixedStep(step);
+
+    EXPECT_CALL(*systemUtils, GetCurrentTimeStamp(_)).Times(0);
+    EXPECT_CALL(*systemUtils, TimeStampExactDiff(_, _)).Times(0);
+
+    for (int i = 1; i <= 3; i++)
+    {
+        // The real time elapsed does not matter
+        NextInstant(i*12345);
+
+        Event event = app->CreateUpdateEvent();
+        EXPECT_EQ(EVENT_FRAME, event.type);
+        EXPECT_FLOAT_EQ(step*2 / 1e9f, event.rTime);
+        EXPECT_EQ(step*2, app->GetExactRelTime());
+        EXPECT_EQ(step*2*i, app->GetExactAbsTime());
+        EXPECT_EQ(step, app->GetRealRelTime());
+        EXPECT_EQ(step*i, app->GetRealAbsTime());
+    }
+}
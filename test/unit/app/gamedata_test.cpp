@@ -0,0 +1,73 @@
+#include "app/gamedata.h"
+
+#include <gtest/gtest.h>
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+
+
+class GameDataUT : public testing::Test
+{
+protected:
+    GameDataUT()
+      : root("gamedata_test")
+    {
+        boost::filesystem::remove_all(root);
+        CreateFile("data/textures/a.png");
+        CreateFile("data/textures/b.png");
+        CreateFile("data/models/sub/c.mod");
+        CreateFile("data/other/d.txt");
+        CreateFile("mod/textures/a.png");
+
+        gameData.SetDataDir(root + "/data");
+        gameData.AddMod(root + "/mod");
+        gameData.Init();
+    }
+
+    ~GameDataUT()
+    {
+        boost::filesystem::remove_all(root);
+    }
+
+    void CreateFile(const std::string& path)
+    {
+        boost::filesystem::path fullPath(root + "/" + path);
+        boost::filesystem::create_directories(fullPath.parent_path());
+        std::ofstream stream(fullPath.string().c_str());
+    }
+
+    std::string root;
+    CGameData gameData;
+};
+
+TEST_F(GameDataUT, ResolvesFromIndex)
+{
+    EXPECT_EQ(3, gameData.GetIndexedFileCount());  // not other/d.txt
+
+    EXPECT_EQ(root + "/data/textures/b.png", gameData.GetFilePath(DIR_TEXTURE, "b.png"));
+    EXPECT_EQ(root + "/data/models/sub/c.mod", gameData.GetFilePath(DIR_MODEL, "sub/c.mod"));
+    EXPECT_EQ(root + "/data/models/sub/c.mod", gameData.GetFilePath(DIR_MODEL, "./sub\\c.mod"));
+    EXPECT_EQ(root + "/data/models/sub/c.mod", gameData.GetDataPath("models//sub/c.mod"));
+
+    // The mods replace the files of the data directory
+    EXPECT_EQ(root + "/mod/textures/a.png", gameData.GetFilePath(DIR_TEXTURE, "a.png"));
+}
+
+TEST_F(GameDataUT, ResolvesMissingFilesInDataDir)
+{
+    EXPECT_EQ(root + "/data/textures/none.png", gameData.GetFilePath(DIR_TEXTURE, "none.png"));
+    EXPECT_EQ(root + "/data/other/d.txt", gameData.GetDataPath("other/d.txt"));
+    EXPECT_EQ(root + "/data/models/../other/d.txt", gameData.GetFilePath(DIR_MODEL, "../other/d.txt"));
+    EXPECT_EQ("savegame/screen.png", gameData.GetFilePath(DIR_TEXTURE, "savegame/screen.png"));
+}
+
+TEST_F(GameDataUT, SeesNewFilesOnceInvalidated)
+{
+    CreateFile("mod/textures/b.png");
+    EXPECT_EQ(root + "/data/textures/b.png", gameData.GetFilePath(DIR_TEXTURE, "b.png"));
+
+    gameData.Invalidate();
+    EXPECT_EQ(root + "/mod/textures/b.png", gameData.GetFilePath(DIR_TEXTURE, "b.png"));
+    EXPECT_EQ(3, gameData.GetIndexedFileCount());
+}
@@ -0,0 +1,121 @@
+#include "common/profiler.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+
+class ProfilerUT : public testing::Test
+{
+protected:
+    ProfilerUT()
+      : profiler(4)
+    {
+        profiler.SetEnabled(true);
+    }
+
+    //! Exports the trace and returns it
+    std::string Export()
+    {
+        const char* filename = "profiler_test.json";
+        EXPECT_TRUE(profiler.ExportTrace(filename));
+
+        std::ifstream file(filename);
+        std::stringstream trace;
+        trace << file.rdbuf();
+        file.close();
+        remove(filename);
+        return trace.str();
+    }
+
+    CProfiler profiler;
+};
+
+TEST_F(ProfilerUT, RecordsNestedZones)
+{
+    profiler.BeginFrame();
+    {
+        CProfileZone outer("Outer");
+        CProfileZone inner("Inner", 42);
+    }
+
+    EXPECT_EQ(2, profiler.GetSampleCount());
+
+    std::string trace = Export();
+    EXPECT_NE(std::string::npos, trace.find("\"name\":\"Inner\",\"ph\":\"X\""));
+    EXPECT_NE(std::string::npos, trace.find("\"args\":{\"frame\":1,\"depth\":1,\"arg\":42}"));
+    EXPECT_NE(std::string::npos, trace.find("\"args\":{\"frame\":1,\"depth\":0}"));
+}
+
+TEST_F(ProfilerUT, KeepsLastSamples)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        profiler.BeginFrame();
+        CProfileZone zone("Zone");
+    }
+
+    EXPECT_EQ(4, profiler.GetSampleCount());
+
+    std::string trace = Export();
+    EXPECT_EQ(std::string::npos, trace.find("\"frame\":2,"));
+    EXPECT_NE(std::string::npos, trace.find("\"frame\":3,"));
+    EXPECT_NE(std::string::npos, trace.find("\"frame\":6,"));
+}
+
+TEST_F(ProfilerUT, SeparatesThreads)
+{
+    profiler.SetThreadName("Main");
+    {
+        CProfileZone zone("Main zone");
+    }
+
+    std::thread worker([this] {
+        profiler.SetThreadName("Worker");
+        CProfileZone zone("Worker zone");
+    });
+    worker.join();
+
+    EXPECT_EQ(2, profiler.GetSampleCount());
+
+    std::string trace = Export();
+    EXPECT_NE(std::string::npos, trace.find("\"tid\":1,\"args\":{\"name\":\"Main\"}"));
+    EXPECT_NE(std::string::npos, trace.find("\"tid\":2,\"args\":{\"name\":\"Worker\"}"));
+    EXPECT_NE(std::string::npos, trace.find("\"name\":\"Worker zone\",\"ph\":\"X\",\"pid\":1,\"tid\":2"));
+}
+
+TEST_F(ProfilerUT, ReusesDataOfExitedThreads)
+{
+    {
+        CProfileZone zone("Main zone");
+    }
+
+    // As the workers started for each scene
+    for (int i = 0; i < 3; i++)
+    {
+        std::thread worker([this] {
+            profiler.SetThreadName("Worker");
+            CProfileZone zone("Worker zone");
+        });
+        worker.join();
+    }
+
+    EXPECT_EQ(4, profiler.GetSampleCount());
+
+    std::string trace = Export();
+    EXPECT_NE(std::string::npos, trace.find("\"tid\":2,\"args\":{\"name\":\"Worker\"}"));
+    EXPECT_EQ(std::string::npos, trace.find("\"tid\":3"));
+}
+
+TEST_F(ProfilerUT, DisabledRecordsNothing)
+{
+    profiler.SetEnabled(false);
+    {
+        CProfileZone zone("Zone");
+    }
+
+    EXPECT_EQ(0, profiler.GetSampleCount());
+}
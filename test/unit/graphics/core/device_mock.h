@@ -37,6 +37,7 @@ public:
 
     MOCK_METHOD2(CreateTexture, Gfx::Texture(CImage *image, const Gfx::TextureCreateParams &params));
     MOCK_METHOD2(CreateTexture, Gfx::Texture(ImageData *data, const Gfx::TextureCreateParams &params));
+    MOCK_METHOD4(UpdateTexture, void(const Gfx::Texture &texture, Math::IntPoint offset, ImageData *data, Gfx::TexImgFormat format));
 
     MOCK_METHOD1(DestroyTexture, void(const Gfx::Texture &texture));
     MOCK_METHOD0(DestroyAllTextures, void());
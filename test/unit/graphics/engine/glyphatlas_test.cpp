@@ -0,0 +1,125 @@
+#include "graphics/engine/glyphatlas.h"
+
+#include "graphics/core/device_mock.h"
+
+#include <SDL.h>
+
+#include <gtest/gtest.h>
+
+using namespace Gfx;
+
+using testing::_;
+using testing::Return;
+
+
+class GlyphAtlasUT : public testing::Test
+{
+protected:
+    GlyphAtlasUT()
+      : atlas(&device, 64)
+    {}
+
+    ~GlyphAtlasUT()
+    {
+        for (SDL_Surface* surface : surfaces)
+            SDL_FreeSurface(surface);
+    }
+
+    //! Adds a glyph of the given size in pixels
+    Glyph Add(int width, int height)
+    {
+        SDL_Surface* surface = SDL_CreateRGBSurface(0, width, height, 32, 0x00ff0000, 0x0000ff00,
+                                                    0x000000ff, 0xff000000);
+        surfaces.push_back(surface);
+
+        Glyph glyph;
+        EXPECT_TRUE(atlas.AddGlyph(surface, glyph));
+        return glyph;
+    }
+
+    CDeviceMock device;
+    CGlyphAtlas atlas;
+    std::vector<SDL_Surface*> surfaces;
+};
+
+TEST_F(GlyphAtlasUT, PacksGlyphsInRows)
+{
+    Glyph a = Add(20, 10);
+    Glyph b = Add(20, 16);
+    Glyph c = Add(30, 8);  // does not fit in the first row
+
+    EXPECT_EQ(1, atlas.GetPageCount());
+    EXPECT_EQ(0, a.page);
+    EXPECT_EQ(0, c.page);
+
+    EXPECT_FLOAT_EQ(0.0f, a.texCoord1.x);
+    EXPECT_FLOAT_EQ(20.0f / 64.0f, a.texCoord2.x);
+    EXPECT_FLOAT_EQ(10.0f / 64.0f, a.texCoord2.y);
+
+    // one pixel between the glyphs
+    EXPECT_FLOAT_EQ(21.0f / 64.0f, b.texCoord1.x);
+    EXPECT_FLOAT_EQ(0.0f, b.texCoord1.y);
+
+    // below the highest glyph of the row
+    EXPECT_FLOAT_EQ(0.0f, c.texCoord1.x);
+    EXPECT_FLOAT_EQ(17.0f / 64.0f, c.texCoord1.y);
+    EXPECT_EQ(30, c.size.x);
+    EXPECT_EQ(8, c.size.y);
+}
+
+TEST_F(GlyphAtlasUT, AddsPages)
+{
+    for (int i = 0; i < 9; i++)
+        EXPECT_EQ(0, Add(20, 20).page);
+
+    EXPECT_EQ(1, Add(20, 20).page);
+
+    // a glyph larger than the pages gets its own
+    Glyph big = Add(100, 40);
+    EXPECT_EQ(2, big.page);
+    EXPECT_FLOAT_EQ(100.0f / 128.0f, big.texCoord2.x);
+    EXPECT_EQ(3, atlas.GetPageCount());
+}
+
+TEST_F(GlyphAtlasUT, UploadsOnlyChangedPages)
+{
+    Texture first, second;
+    first.id = 1;
+    second.id = 2;
+
+    Add(10, 10);
+
+    EXPECT_CALL(device, CreateTexture(testing::An<ImageData*>(), _))
+        .WillOnce(Return(first))
+        .WillOnce(Return(second));
+    EXPECT_CALL(device, DestroyTexture(_)).Times(2);
+
+    EXPECT_EQ(1u, atlas.GetTexture(0));
+    EXPECT_EQ(1u, atlas.GetTexture(0));
+
+    Add(10, 10);
+    EXPECT_EQ(2u, atlas.GetTexture(0));
+
+    atlas.Flush();
+    EXPECT_EQ(0, atlas.GetPageCount());
+}
+
+TEST_F(GlyphAtlasUT, DestroysTexturesWhenDeleted)
+{
+    Texture texture;
+    texture.id = 3;
+
+    CGlyphAtlas* other = new CGlyphAtlas(&device, 64);
+    SDL_Surface* surface = SDL_CreateRGBSurface(0, 10, 10, 32, 0x00ff0000, 0x0000ff00,
+                                                0x000000ff, 0xff000000);
+    surfaces.push_back(surface);
+    Glyph glyph;
+    ASSERT_TRUE(other->AddGlyph(surface, glyph));
+
+    EXPECT_CALL(device, CreateTexture(testing::An<ImageData*>(), _))
+        .WillOnce(Return(texture));
+    EXPECT_CALL(device, DestroyTexture(testing::Field(&Texture::id, 3u)));
+
+    EXPECT_EQ(3u, other->GetTexture(0));
+    delete other;
+}
@@ -0,0 +1,151 @@
+#include "graphics/engine/groundspot.h"
+
+#include "common/image.h"
+
+#include "graphics/engine/engine.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace Gfx;
+
+
+class GroundSpotRendererUT : public testing::Test
+{
+protected:
+    GroundSpotRendererUT()
+      : renderer(1)
+    {
+        EngineGroundSpot spot;
+        spot.used = true;
+        spot.color = Color(0.2f, 0.4f, 0.6f);
+        spot.pos = Math::Vector(-1300.0f, 0.0f, -1300.0f);
+        spot.radius = 40.0f;
+        spots.push_back(spot);
+
+        // A cross of green and red in the table of the mark
+        table.assign(21 * 21, 0);
+        for (int i = 0; i < 21; i++)
+        {
+            table[i + 10 * 21] = 1;
+            table[10 + i * 21] = 2;
+        }
+
+        mark.pos = Math::Vector(-900.0f, 0.0f, -900.0f);
+        mark.radius = 20.0f;
+        mark.intensity = 1.0f;
+        mark.dx = mark.dy = 21;
+        mark.table = &table[0];
+    }
+
+    CGroundSpotRenderer renderer;
+    std::vector<EngineGroundSpot> spots;
+    EngineGroundMark mark;
+    std::vector<char> table;
+};
+
+TEST(GroundSpotRectUT, AddsRectangles)
+{
+    GroundSpotRect rect;
+    EXPECT_TRUE(rect.IsEmpty());
+
+    rect.Add(GroundSpotRect(10, 20, 30, 40));
+    EXPECT_EQ(10, rect.x1);
+    EXPECT_EQ(40, rect.y2);
+
+    rect.Add(GroundSpotRect(5, 30, 20, 50));
+    EXPECT_EQ(5, rect.x1);
+    EXPECT_EQ(20, rect.y1);
+    EXPECT_EQ(30, rect.x2);
+    EXPECT_EQ(50, rect.y2);
+
+    rect.Add(GroundSpotRect(100, 100, 100, 120));
+    EXPECT_EQ(30, rect.x2);
+}
+
+TEST(GroundSpotRectUT, ClipsRectanglesToTextures)
+{
+    // Center of the terrain, between the textures 5, 6, 9 and 10
+    GroundSpotRect rect = CGroundSpotRenderer::GetRect(5, Math::Vector(0.0f, 0.0f, 0.0f), 20.0f);
+    EXPECT_FALSE(rect.IsEmpty());
+    EXPECT_EQ(CGroundSpotRenderer::TEXTURE_SIZE, rect.x2);
+    EXPECT_EQ(CGroundSpotRenderer::TEXTURE_SIZE, rect.y2);
+
+    rect = CGroundSpotRenderer::GetRect(10, Math::Vector(0.0f, 0.0f, 0.0f), 20.0f);
+    EXPECT_FALSE(rect.IsEmpty());
+    EXPECT_EQ(0, rect.x1);
+    EXPECT_EQ(0, rect.y1);
+
+    EXPECT_TRUE(CGroundSpotRenderer::GetRect(0, Math::Vector(0.0f, 0.0f, 0.0f), 20.0f).IsEmpty());
+    EXPECT_TRUE(CGroundSpotRenderer::GetRect(15, Math::Vector(0.0f, 0.0f, 0.0f), 20.0f).IsEmpty());
+}
+
+TEST_F(GroundSpotRendererUT, RendersRectanglesAsFullTextures)
+{
+    renderer.DrawSpots(spots, nullptr);
+
+    const int size = CGroundSpotRenderer::TEXTURE_SIZE;
+    CImage full(Math::IntPoint(size, size));
+    renderer.Render(0, GroundSpotRect(0, 0, size, size), mark, true, &full);
+
+    // The spot and the mark are both drawn
+    GroundSpotRect markRect = CGroundSpotRenderer::GetRect(0, mark.pos, mark.radius);
+    ASSERT_FALSE(markRect.IsEmpty());
+    int cx = (markRect.x1 + markRect.x2) / 2;
+    int cy = (markRect.y1 + markRect.y2) / 2;
+    EXPECT_EQ(255, full.GetPixelInt(Math::IntPoint(cx - 5, cy)).g);
+    EXPECT_NE(255, full.GetPixelInt(Math::IntPoint(cx - 5, cy)).r);
+    EXPECT_EQ(255, full.GetPixelInt(Math::IntPoint(cx, cy - 5)).r);
+
+    GroundSpotRect spotRect = CGroundSpotRenderer::GetRect(0, spots[0].pos, spots[0].radius);
+    ASSERT_FALSE(spotRect.IsEmpty());
+    IntColor center = full.GetPixelInt(Math::IntPoint((spotRect.x1 + spotRect.x2) / 2,
+                                                      (spotRect.y1 + spotRect.y2) / 2));
+    EXPECT_LT(center.r, center.g);
+    EXPECT_LT(center.g, center.b);
+    EXPECT_LT(center.b, 255);
+
+    // The pixels of a rectangle are the same as in the full texture
+    GroundSpotRect rect(markRect.x1 - 3, markRect.y1 + 4, markRect.x2 - 6, markRect.y2 + 2);
+    CImage part(Math::IntPoint(rect.x2 - rect.x1, rect.y2 - rect.y1));
+    renderer.Render(0, rect, mark, true, &part);
+
+    for (int y = rect.y1; y < rect.y2; y++)
+    {
+        for (int x = rect.x1; x < rect.x2; x++)
+        {
+            IntColor expected = full.GetPixelInt(Math::IntPoint(x, y));
+            IntColor actual = part.GetPixelInt(Math::IntPoint(x - rect.x1, y - rect.y1));
+            ASSERT_EQ(expected.r, actual.r);
+            ASSERT_EQ(expected.g, actual.g);
+            ASSERT_EQ(expected.b, actual.b);
+            ASSERT_EQ(expected.a, actual.a);
+        }
+    }
+}
+
+TEST_F(GroundSpotRendererUT, DrawsSpotsOnAnyNumberOfThreads)
+{
+    CGroundSpotRenderer threaded(4);
+    renderer.DrawSpots(spots, nullptr);
+    threaded.DrawSpots(spots, nullptr);
+
+    const int size = CGroundSpotRenderer::TEXTURE_SIZE;
+    for (int tex = 0; tex < CGroundSpotRenderer::TEXTURE_COUNT; tex++)
+    {
+        CImage image1(Math::IntPoint(size, size));
+        CImage image2(Math::IntPoint(size, size));
+        renderer.Render(tex, GroundSpotRect(0, 0, size, size), mark, false, &image1);
+        threaded.Render(tex, GroundSpotRect(0, 0, size, size), mark, false, &image2);
+
+        for (int y = 0; y < size; y += 7)
+        {
+            for (int x = 0; x < size; x += 7)
+            {
+                ASSERT_EQ(image1.GetPixelInt(Math::IntPoint(x, y)).r, image2.GetPixelInt(Math::IntPoint(x, y)).r);
+                ASSERT_EQ(image1.GetPixelInt(Math::IntPoint(x, y)).b, image2.GetPixelInt(Math::IntPoint(x, y)).b);
+            }
+        }
+    }
+}
@@ -7,6 +7,9 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cstdlib>
+
 using namespace Gfx;
 
 using testing::_;
@@ -26,6 +29,8 @@ protected:
     void CheckLight(int index, const Light& light);
     void AddLight(int type, LightPriority priority, bool used, bool enabled,
                   Math::Vector pos, EngineObjectType includeType, EngineObjectType excludeType);
+    void TrackDeviceLights();
+    std::vector<Math::Vector> GetDeviceLightPositions();
 
 
     CSystemUtilsMock systemUtils;
@@ -33,6 +38,10 @@ protected:
     CEngineMock engine;
     CDeviceMock device;
 
+    std::vector<Light> deviceLights;
+    std::vector<bool> deviceLightsEnabled;
+    int setLightCalls;
+
 private:
     std::vector<DynamicLight> dynamicLights;
     std::vector<int> expectedLightTypes;
@@ -90,6 +99,39 @@ void LightManagerUT::AddLight(int type, LightPriority priority, bool used, bool
         lightManager.DeleteLight(rank);
 }
 
+void LightManagerUT::TrackDeviceLights()
+{
+    deviceLights = std::vector<Light>(maxLightsCount);
+    deviceLightsEnabled = std::vector<bool>(maxLightsCount, false);
+    setLightCalls = 0;
+
+    EXPECT_CALL(device, SetLight(_, _)).WillRepeatedly(Invoke([this](int index, const Light& light)
+    {
+        deviceLights[index] = light;
+        setLightCalls++;
+    }));
+    EXPECT_CALL(device, SetLightEnabled(_, _)).WillRepeatedly(Invoke([this](int index, bool enabled)
+    {
+        deviceLightsEnabled[index] = enabled;
+    }));
+}
+
+std::vector<Math::Vector> LightManagerUT::GetDeviceLightPositions()
+{
+    std::vector<Math::Vector> positions;
+    for (int i = 0; i < maxLightsCount; ++i)
+    {
+        if (deviceLightsEnabled[i])
+            positions.push_back(deviceLights[i].position);
+    }
+
+    std::sort(positions.begin(), positions.end(), [](const Math::Vector& a, const Math::Vector& b)
+    {
+        return a.x < b.x || (a.x == b.x && a.z < b.z);
+    });
+    return positions;
+}
+
 TEST_F(LightManagerUT, LightSorting_UnusedOrDisabledAreSkipped)
 {
     const int lightCount = 10;
@@ -148,3 +190,155 @@ TEST_F(LightManagerUT, LightSorting_SortingAccordingToDistance)
     std::vector<int> expectedLights = { 2, 1, 3 };
     CheckLightSorting(ENG_OBJTYPE_TERRAIN, expectedLights);
 }
+
+TEST_F(LightManagerUT, LightSelection_NearestToEachObject)
+{
+    const int lightCount = 4;
+    const Math::Vector eyePos(0.0f, 0.0f, 0.0f);
+    PrepareLightTesting(lightCount, eyePos);
+
+    srand(1);
+    std::vector<Math::Vector> positions;
+    std::vector<LightPriority> priorities;
+    for (int i = 0; i < 60; ++i)
+    {
+        Math::Vector pos(rand() % 2000 - 1000.0f, rand() % 50, rand() % 2000 - 1000.0f);
+        LightPriority priority = (i % 3 == 0) ? LIGHT_PRI_HIGH : LIGHT_PRI_LOW;
+        AddLight(LIGHT_POINT, priority, true, true, pos, ENG_OBJTYPE_NULL, ENG_OBJTYPE_NULL);
+        positions.push_back(pos);
+        priorities.push_back(priority);
+    }
+
+    TrackDeviceLights();
+
+    for (int objRank = 0; objRank < 50; ++objRank)
+    {
+        Math::Vector objPos(rand() % 2400 - 1200.0f, 0.0f, rand() % 2400 - 1200.0f);
+        lightManager.UpdateDeviceLights(ENG_OBJTYPE_FIX, objPos, objRank);
+
+        // Same as sorting all the lights by weight
+        std::vector<std::pair<float, int>> weights;
+        for (int i = 0; i < static_cast<int>( positions.size() ); ++i)
+            weights.push_back(std::make_pair((positions[i] - objPos).Length() * priorities[i], i));
+        std::sort(weights.begin(), weights.end());
+
+        std::vector<Math::Vector> expected;
+        for (int i = 0; i < lightCount; ++i)
+            expected.push_back(positions[weights[i].second]);
+        std::sort(expected.begin(), expected.end(), [](const Math::Vector& a, const Math::Vector& b)
+        {
+            return a.x < b.x || (a.x == b.x && a.z < b.z);
+        });
+
+        std::vector<Math::Vector> actual = GetDeviceLightPositions();
+        ASSERT_EQ(expected.size(), actual.size());
+        for (int i = 0; i < lightCount; ++i)
+            EXPECT_TRUE(Math::VectorsEqual(expected[i], actual[i])) << "object " << objRank;
+    }
+}
+
+TEST_F(LightManagerUT, LightSelection_DeviceChangesOnlyForOtherLights)
+{
+    const int lightCount = 2;
+    const Math::Vector eyePos(0.0f, 0.0f, 0.0f);
+    PrepareLightTesting(lightCount, eyePos);
+
+    AddLight(LIGHT_POINT, LIGHT_PRI_LOW, true, true, Math::Vector(0.0f, 0.0f, 0.0f),   ENG_OBJTYPE_NULL, ENG_OBJTYPE_NULL);
+    AddLight(LIGHT_POINT, LIGHT_PRI_LOW, true, true, Math::Vector(10.0f, 0.0f, 0.0f),  ENG_OBJTYPE_NULL, ENG_OBJTYPE_NULL);
+    AddLight(LIGHT_POINT, LIGHT_PRI_LOW, true, true, Math::Vector(30.0f, 0.0f, 0.0f),  ENG_OBJTYPE_NULL, ENG_OBJTYPE_NULL);
+    AddLight(LIGHT_POINT, LIGHT_PRI_LOW, true, true, Math::Vector(500.0f, 0.0f, 0.0f), ENG_OBJTYPE_NULL, ENG_OBJTYPE_NULL);
+
+    TrackDeviceLights();
+
+    lightManager.UpdateDeviceLights(ENG_OBJTYPE_FIX, Math::Vector(1.0f, 0.0f, 0.0f), 0);
+    EXPECT_EQ(2, setLightCalls);
+
+    // Same object, then another object with the same lights
+    lightManager.UpdateDeviceLights(ENG_OBJTYPE_FIX, Math::Vector(1.0f, 0.0f, 0.0f), 0);
+    lightManager.UpdateDeviceLights(ENG_OBJTYPE_FIX, Math::Vector(2.0f, 0.0f, 0.0f), 1);
+    EXPECT_EQ(2, setLightCalls);
+
+    // One light kept in its slot
+    lightManager.UpdateDeviceLights(ENG_OBJTYPE_FIX, Math::Vector(25.0f, 0.0f, 0.0f), 2);
+    EXPECT_EQ(3, setLightCalls);
+    ASSERT_EQ(2u, GetDeviceLightPositions().size());
+    EXPECT_TRUE(Math::VectorsEqual(Math::Vector(10.0f, 0.0f, 0.0f), GetDeviceLightPositions()[0]));
+    EXPECT_TRUE(Math::VectorsEqual(Math::Vector(30.0f, 0.0f, 0.0f), GetDeviceLightPositions()[1]));
+
+    lightManager.UpdateDeviceLights(ENG_OBJTYPE_FIX, Math::Vector(1.0f, 0.0f, 0.0f), 0);
+    EXPECT_EQ(4, setLightCalls);
+
+    // A new frame keeps the lights of the device while they do not change
+    lightManager.UpdateLights();
+    lightManager.UpdateDeviceLights(ENG_OBJTYPE_FIX, Math::Vector(1.0f, 0.0f, 0.0f), 0);
+    EXPECT_EQ(4, setLightCalls);
+
+    // Only the light of a new color is set again
+    EXPECT_CALL(engine, GetPause()).WillRepeatedly(Return(false));
+    lightManager.SetLightColor(1, Color(1.0f, 0.0f, 0.0f));
+    lightManager.UpdateProgression(0.1f);
+    lightManager.UpdateLights();
+    lightManager.UpdateDeviceLights(ENG_OBJTYPE_FIX, Math::Vector(1.0f, 0.0f, 0.0f), 0);
+    EXPECT_EQ(5, setLightCalls);
+
+    lightManager.SetLightPos(0, Math::Vector(490.0f, 0.0f, 0.0f));
+    lightManager.UpdateDeviceLights(ENG_OBJTYPE_FIX, Math::Vector(495.0f, 0.0f, 0.0f), 0);
+    ASSERT_EQ(2u, GetDeviceLightPositions().size());
+    EXPECT_TRUE(Math::VectorsEqual(Math::Vector(490.0f, 0.0f, 0.0f), GetDeviceLightPositions()[0]));
+    EXPECT_TRUE(Math::VectorsEqual(Math::Vector(500.0f, 0.0f, 0.0f), GetDeviceLightPositions()[1]));
+}
+
+TEST_F(LightManagerUT, LightSelection_KeptWhileNothingMoves)
+{
+    const int lightCount = 2;
+    const Math::Vector eyePos(0.0f, 0.0f, 0.0f);
+    PrepareLightTesting(lightCount, eyePos);
+
+    AddLight(LIGHT_POINT, LIGHT_PRI_LOW, true, true, Math::Vector(0.0f, 0.0f, 0.0f),   ENG_OBJTYPE_NULL, ENG_OBJTYPE_NULL);
+    AddLight(LIGHT_POINT, LIGHT_PRI_LOW, true, true, Math::Vector(10.0f, 0.0f, 0.0f),  ENG_OBJTYPE_NULL, ENG_OBJTYPE_NULL);
+    AddLight(LIGHT_POINT, LIGHT_PRI_LOW, true, true, Math::Vector(30.0f, 0.0f, 0.0f),  ENG_OBJTYPE_NULL, ENG_OBJTYPE_NULL);
+    AddLight(LIGHT_POINT, LIGHT_PRI_LOW, true, true, Math::Vector(500.0f, 0.0f, 0.0f), ENG_OBJTYPE_NULL, ENG_OBJTYPE_NULL);
+
+    // Objects lit by the same lights have the same set
+    unsigned int set = lightManager.GetLightSet(ENG_OBJTYPE_FIX, Math::Vector(1.0f, 0.0f, 0.0f), 0);
+    EXPECT_EQ(set, lightManager.GetLightSet(ENG_OBJTYPE_FIX, Math::Vector(2.0f, 0.0f, 0.0f), 1));
+    EXPECT_NE(set, lightManager.GetLightSet(ENG_OBJTYPE_FIX, Math::Vector(25.0f, 0.0f, 0.0f), 2));
+
+    lightManager.UpdateLights();
+    lightManager.SetLightPos(1, Math::Vector(10.0f, 0.0f, 0.0f));
+    EXPECT_EQ(set, lightManager.GetLightSet(ENG_OBJTYPE_FIX, Math::Vector(1.0f, 0.0f, 0.0f), 0));
+
+    // Selected again when a light moves
+    lightManager.SetLightPos(3, Math::Vector(5.0f, 0.0f, 0.0f));
+    unsigned int movedSet = lightManager.GetLightSet(ENG_OBJTYPE_FIX, Math::Vector(1.0f, 0.0f, 0.0f), 0);
+    EXPECT_NE(set, movedSet);
+
+    // or when the object moves
+    EXPECT_NE(movedSet, lightManager.GetLightSet(ENG_OBJTYPE_FIX, Math::Vector(499.0f, 0.0f, 0.0f), 0));
+    EXPECT_EQ(lightManager.GetLightSet(ENG_OBJTYPE_FIX, Math::Vector(3.0f, 0.0f, 0.0f), 1),
+              lightManager.GetLightSet(ENG_OBJTYPE_FIX, Math::Vector(1.0f, 0.0f, 0.0f), 0));
+}
+
+TEST_F(LightManagerUT, LightSelection_DisabledLightsStayInDevice)
+{
+    const int lightCount = 2;
+    const Math::Vector eyePos(0.0f, 0.0f, 0.0f);
+    PrepareLightTesting(lightCount, eyePos);
+
+    AddLight(LIGHT_POINT, LIGHT_PRI_LOW, true, true, Math::Vector(0.0f, 0.0f, 0.0f),  ENG_OBJTYPE_NULL,    ENG_OBJTYPE_NULL);
+    AddLight(LIGHT_POINT, LIGHT_PRI_LOW, true, true, Math::Vector(10.0f, 0.0f, 0.0f), ENG_OBJTYPE_TERRAIN, ENG_OBJTYPE_NULL);
+
+    TrackDeviceLights();
+
+    lightManager.UpdateDeviceLights(ENG_OBJTYPE_TERRAIN, Math::Vector(1.0f, 0.0f, 0.0f), 0);
+    EXPECT_EQ(2, setLightCalls);
+    EXPECT_EQ(2u, GetDeviceLightPositions().size());
+
+    lightManager.UpdateDeviceLights(ENG_OBJTYPE_FIX, Math::Vector(1.0f, 0.0f, 0.0f), 1);
+    EXPECT_EQ(1u, GetDeviceLightPositions().size());
+
+    // Enabled again without being set
+    lightManager.UpdateDeviceLights(ENG_OBJTYPE_TERRAIN, Math::Vector(1.0f, 0.0f, 0.0f), 0);
+    EXPECT_EQ(2, setLightCalls);
+    EXPECT_EQ(2u, GetDeviceLightPositions().size());
+}
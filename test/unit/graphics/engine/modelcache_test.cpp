@@ -0,0 +1,146 @@
+#include "graphics/engine/modelcache.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using namespace Gfx;
+
+
+class ModelCacheUT : public testing::Test
+{
+protected:
+    ModelCacheUT()
+      : fileName("modelcache_test.cmod")
+      , modelFileName("modelcache_test.mod")
+    {
+        WriteModelFile("model");
+        CModelCache::GetSource(modelFileName, source);
+    }
+
+    ~ModelCacheUT()
+    {
+        remove(fileName.c_str());
+        remove(modelFileName.c_str());
+    }
+
+    //! Writes the model file the precompiled model is written from
+    void WriteModelFile(const std::string& data)
+    {
+        std::ofstream stream(modelFileName.c_str(), std::ios_base::out | std::ios_base::binary);
+        stream.write(data.c_str(), data.size());
+    }
+
+    //! Adds a triangle with the given texture, LOD level and state
+    void Add(const std::string& tex1Name, LODLevel lodLevel, int state, float x)
+    {
+        ModelTriangle t;
+        t.p1.coord = Math::Vector(x, 0.0f, 0.0f);
+        t.p2.coord = Math::Vector(x, 1.0f, 0.0f);
+        t.p3.coord = Math::Vector(x, 0.0f, 1.0f);
+        t.tex1Name = tex1Name;
+        t.variableTex2 = false;
+        t.lodLevel = lodLevel;
+        t.state = state;
+        triangles.push_back(t);
+    }
+
+    std::string fileName;
+    std::string modelFileName;
+    ModelCacheSource source;
+    std::vector<ModelTriangle> triangles;
+};
+
+TEST_F(ModelCacheUT, GetFileName)
+{
+    EXPECT_EQ("objects/ant1.cmod", CModelCache::GetFileName("objects/ant1.mod"));
+    EXPECT_EQ("ant1.txt.cmod", CModelCache::GetFileName("ant1.txt"));
+}
+
+TEST_F(ModelCacheUT, GroupsTriangles)
+{
+    Add("a.png", LOD_Constant, 0, 1.0f);
+    Add("b.png", LOD_Constant, 0, 2.0f);
+    Add("a.png", LOD_High,     0, 3.0f);
+    Add("a.png", LOD_Constant, 0, 4.0f);
+    Add("b.png", LOD_Constant, 1, 5.0f);
+
+    ASSERT_TRUE(CModelCache::Write(triangles, source, fileName));
+
+    CModelCache cache;
+    ASSERT_TRUE(cache.Open(fileName, source));
+    ASSERT_EQ(4, cache.GetGroupCount());
+
+    // In the order of their first triangle
+    const ModelCacheGroup& a = cache.GetGroup(0);
+    EXPECT_STREQ("a.png", a.tex1Name);
+    EXPECT_EQ(LOD_Constant, a.lodLevel);
+    ASSERT_EQ(6, a.vertexCount);
+
+    const VertexTex2* vertices = cache.GetVertices(a);
+    EXPECT_FLOAT_EQ(1.0f, vertices[0].coord.x);
+    EXPECT_FLOAT_EQ(1.0f, vertices[1].coord.y);
+    EXPECT_FLOAT_EQ(4.0f, vertices[3].coord.x);
+    EXPECT_FLOAT_EQ(1.0f, vertices[5].coord.z);
+
+    EXPECT_STREQ("b.png", cache.GetGroup(1).tex1Name);
+    EXPECT_EQ(LOD_High, cache.GetGroup(2).lodLevel);
+    EXPECT_EQ(1, cache.GetGroup(3).state);
+    EXPECT_FLOAT_EQ(5.0f, cache.GetVertices(cache.GetGroup(3))[0].coord.x);
+}
+
+TEST_F(ModelCacheUT, RefusesInvalidFiles)
+{
+    CModelCache cache;
+    EXPECT_FALSE(cache.Open("missing.cmod", source));
+
+    Add("a.png", LOD_Constant, 0, 1.0f);
+    ASSERT_TRUE(CModelCache::Write(triangles, source, fileName));
+
+    // Truncated vertices
+    std::string data;
+    {
+        std::ifstream stream(fileName.c_str(), std::ios_base::in | std::ios_base::binary);
+        data.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    }
+    {
+        std::ofstream stream(fileName.c_str(), std::ios_base::out | std::ios_base::binary);
+        stream.write(data.c_str(), data.size() - 4);
+    }
+    EXPECT_FALSE(cache.Open(fileName, source));
+
+    // Written by a build with another layout
+    data[12] = data[12] + 1;
+    {
+        std::ofstream stream(fileName.c_str(), std::ios_base::out | std::ios_base::binary);
+        stream.write(data.c_str(), data.size());
+    }
+    EXPECT_FALSE(cache.Open(fileName, source));
+}
+
+TEST_F(ModelCacheUT, RefusesChangedModelFile)
+{
+    Add("a.png", LOD_Constant, 0, 1.0f);
+    ASSERT_TRUE(CModelCache::Write(triangles, source, fileName));
+
+    CModelCache cache;
+    ASSERT_TRUE(cache.Open(fileName, source));
+    EXPECT_FALSE(cache.IsOutOfDate());
+
+    // Same size, other contents
+    WriteModelFile("modem");
+    ModelCacheSource edited;
+    ASSERT_TRUE(CModelCache::GetSource(modelFileName, edited));
+    EXPECT_FALSE(cache.Open(fileName, edited));
+    EXPECT_TRUE(cache.IsOutOfDate());
+
+    // Nothing to rewrite
+    EXPECT_FALSE(cache.Open("missing.cmod", edited));
+    EXPECT_FALSE(cache.IsOutOfDate());
+
+    ModelCacheSource missing;
+    EXPECT_FALSE(CModelCache::GetSource("missing.mod", missing));
+}
@@ -0,0 +1,152 @@
+#include "graphics/engine/renderqueue.h"
+
+#include "graphics/engine/engine.h"
+
+#include "math/geometry.h"
+
+#include <gtest/gtest.h>
+
+using namespace Gfx;
+
+
+class FrustumUT : public testing::Test
+{
+protected:
+    void SetUp()
+    {
+        // Camera at the origin looking along +z, 90 degrees, planes at 1 and 1000
+        Math::Matrix view, projection;
+        Math::LoadViewMatrix(view, Math::Vector(0.0f, 0.0f, 0.0f), Math::Vector(0.0f, 0.0f, 1.0f),
+                             Math::Vector(0.0f, 1.0f, 0.0f));
+        Math::LoadProjectionMatrix(projection);
+        frustum.Load(view, projection);
+    }
+
+    bool IsVisible(const Math::Vector& center, float radius)
+    {
+        unsigned char visible = 0;
+        frustum.CullSpheres(&center.x, &center.y, &center.z, &radius, 1, &visible);
+        return visible != 0;
+    }
+
+    Frustum frustum;
+};
+
+TEST_F(FrustumUT, CullsSpheresOutside)
+{
+    EXPECT_TRUE(IsVisible(Math::Vector(0.0f, 0.0f, 50.0f), 1.0f));
+    EXPECT_TRUE(IsVisible(Math::Vector(40.0f, -40.0f, 50.0f), 1.0f));
+
+    EXPECT_FALSE(IsVisible(Math::Vector(0.0f, 0.0f, -50.0f), 1.0f));   // behind
+    EXPECT_FALSE(IsVisible(Math::Vector(100.0f, 0.0f, 50.0f), 1.0f));  // right
+    EXPECT_FALSE(IsVisible(Math::Vector(-100.0f, 0.0f, 50.0f), 1.0f)); // left
+    EXPECT_FALSE(IsVisible(Math::Vector(0.0f, 100.0f, 50.0f), 1.0f));  // above
+    EXPECT_FALSE(IsVisible(Math::Vector(0.0f, -100.0f, 50.0f), 1.0f)); // below
+    EXPECT_FALSE(IsVisible(Math::Vector(0.0f, 0.0f, 1100.0f), 1.0f));  // too far
+}
+
+TEST_F(FrustumUT, KeepsSpheresAcrossPlanes)
+{
+    // Center outside, but the sphere reaches inside
+    EXPECT_FALSE(IsVisible(Math::Vector(60.0f, 0.0f, 50.0f), 5.0f));
+    EXPECT_TRUE(IsVisible(Math::Vector(60.0f, 0.0f, 50.0f), 10.0f));
+    EXPECT_TRUE(IsVisible(Math::Vector(0.0f, 0.0f, -5.0f), 10.0f));
+    EXPECT_TRUE(IsVisible(Math::Vector(0.0f, 0.0f, 1005.0f), 10.0f));
+}
+
+TEST_F(FrustumUT, CullsManySpheres)
+{
+    float x[] = { 0.0f,  0.0f,   200.0f, 0.0f   };
+    float y[] = { 0.0f,  0.0f,   0.0f,   0.0f   };
+    float z[] = { 10.0f, -10.0f, 100.0f, 500.0f };
+    float radius[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    unsigned char visible[4];
+
+    frustum.CullSpheres(x, y, z, radius, 4, visible);
+
+    EXPECT_EQ(1, visible[0]);
+    EXPECT_EQ(0, visible[1]);
+    EXPECT_EQ(0, visible[2]);
+    EXPECT_EQ(1, visible[3]);
+}
+
+
+class RenderQueueUT : public testing::Test
+{
+protected:
+    //! Adds an item with the given first texture and state
+    void Add(unsigned int tex1, int state)
+    {
+        textures.push_back(EngineBaseObjTexTier());
+        textures.back().tex1.id = tex1;
+        data.push_back(EngineBaseObjDataTier(ENG_TRIANGLE_TYPE_TRIANGLES, Material(), state));
+    }
+
+    //! Fills the queue with the items added
+    void Fill(const std::vector<bool>& transparent)
+    {
+        for (int i = 0; i < static_cast<int>( data.size() ); i++)
+            queue.Add(ranks[i], ENG_OBJTYPE_FIX, lightSets[i], &textures[i], &data[i], transparent[i]);
+    }
+
+    std::vector<int> Order()
+    {
+        std::vector<int> order;
+        for (const RenderItem& item : queue.GetItems())
+            order.push_back(item.objRank);
+        return order;
+    }
+
+    CRenderQueue queue;
+    std::vector<int> ranks;
+    std::vector<unsigned int> lightSets;
+    std::vector<EngineBaseObjTexTier> textures;
+    std::vector<EngineBaseObjDataTier> data;
+};
+
+TEST_F(RenderQueueUT, SortsOpaqueItemsByLightsAndTexture)
+{
+    ranks = { 0, 1, 2, 3, 4 };
+    lightSets = { 7, 9, 7, 7, 9 };
+    Add(2, ENG_RSTATE_NORMAL);
+    Add(1, ENG_RSTATE_NORMAL);
+    Add(1, ENG_RSTATE_NORMAL);
+    Add(2, ENG_RSTATE_2FACE);
+    Add(1, ENG_RSTATE_NORMAL);
+    Fill({ false, false, false, false, false });
+
+    queue.Sort();
+
+    std::vector<int> expected = { 2, 0, 3, 1, 4 };
+    EXPECT_EQ(expected, Order());
+}
+
+TEST_F(RenderQueueUT, KeepsOrderOfBlendedAndTransparentItems)
+{
+    ranks = { 0, 1, 2, 3, 4 };
+    lightSets = { 7, 7, 7, 7, 7 };
+    Add(2, ENG_RSTATE_NORMAL);                // transparent object
+    Add(2, ENG_RSTATE_TTEXTURE_BLACK);
+    Add(1, ENG_RSTATE_NORMAL);
+    Add(1, ENG_RSTATE_TTEXTURE_WHITE);
+    Add(1, ENG_RSTATE_NORMAL);                // transparent object
+    Fill({ true, false, false, false, true });
+
+    queue.Sort();
+
+    std::vector<int> expected = { 2, 1, 3, 0, 4 };
+    EXPECT_EQ(expected, Order());
+    EXPECT_TRUE(queue.GetItems()[3].transparent);
+}
+
+TEST_F(RenderQueueUT, Clears)
+{
+    ranks = { 0 };
+    lightSets = { 7 };
+    Add(1, ENG_RSTATE_NORMAL);
+    Fill({ false });
+
+    EXPECT_EQ(1u, queue.GetItems().size());
+    queue.Clear();
+    EXPECT_TRUE(queue.GetItems().empty());
+}
@@ -0,0 +1,154 @@
+#include "graphics/engine/textureloader.h"
+
+#include "common/image.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace Gfx;
+
+
+class TextureLoaderFileUT : public testing::Test
+{
+protected:
+    TextureLoaderFileUT()
+      : validFile("textureloader_test_valid.png")
+      , truncatedFile("textureloader_test_truncated.png")
+      , corruptFile("textureloader_test_corrupt.png")
+    {
+        // A red pixel and a blue one
+        CImage image(Math::IntPoint(2, 1));
+        image.SetPixel(Math::IntPoint(0, 0), Color(1.0f, 0.0f, 0.0f, 1.0f));
+        image.SetPixel(Math::IntPoint(1, 0), Color(0.0f, 0.0f, 1.0f, 1.0f));
+        EXPECT_TRUE(image.SavePNG(validFile));
+
+        std::string data;
+        {
+            std::ifstream stream(validFile.c_str(), std::ios_base::in | std::ios_base::binary);
+            data.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+        }
+        WriteFile(truncatedFile, data.substr(0, data.size() / 2));
+
+        // The PNG signature followed by garbage
+        WriteFile(corruptFile, data.substr(0, 8) + std::string(64, 'x'));
+    }
+
+    ~TextureLoaderFileUT()
+    {
+        remove(validFile.c_str());
+        remove(truncatedFile.c_str());
+        remove(corruptFile.c_str());
+    }
+
+    void WriteFile(const std::string& fileName, const std::string& data)
+    {
+        std::ofstream stream(fileName.c_str(), std::ios_base::out | std::ios_base::binary);
+        stream.write(data.c_str(), data.size());
+    }
+
+    std::string validFile;
+    std::string truncatedFile;
+    std::string corruptFile;
+};
+
+
+TEST(TextureLoaderUT, AddsTexturesOnce)
+{
+    CTextureLoader loader(2);
+    EXPECT_EQ(2, loader.GetThreadCount());
+
+    loader.Add("a.png", "textures/a.png");
+    loader.Add("b.png", "textures/b.png");
+    loader.Add("a.png", "other/a.png");
+    EXPECT_EQ(2, loader.GetCount());
+
+    loader.Clear();
+    EXPECT_EQ(0, loader.GetCount());
+    EXPECT_EQ(nullptr, loader.GetImage("a.png"));
+}
+
+TEST(TextureLoaderUT, ReportsProgressOfAllImages)
+{
+    for (int threads : { 1, 4 })
+    {
+        CTextureLoader loader(threads);
+        for (int i = 0; i < 10; i++)
+            loader.Add("missing" + std::to_string(i) + ".png", "textureloader_test_missing.png");
+
+        std::vector<int> done;
+        loader.Decode([&done](int d, int total)
+        {
+            EXPECT_EQ(10, total);
+            done.push_back(d);
+        });
+
+        ASSERT_FALSE(done.empty());
+        EXPECT_EQ(10, done.back());
+        for (int i = 1; i < static_cast<int>( done.size() ); i++)
+            EXPECT_LT(done[i-1], done[i]);
+
+        // Files that cannot be loaded give no image
+        EXPECT_EQ(nullptr, loader.GetImage("missing0.png"));
+        EXPECT_EQ(nullptr, loader.GetImage("unknown.png"));
+    }
+}
+
+TEST_F(TextureLoaderFileUT, DecodesValidImage)
+{
+    CTextureLoader loader(2);
+    loader.Add("valid.png", validFile);
+    loader.Decode();
+
+    CImage* image = loader.GetImage("valid.png");
+    ASSERT_NE(nullptr, image);
+    EXPECT_EQ(2, image->GetSize().x);
+    EXPECT_EQ(1, image->GetSize().y);
+
+    Color red = image->GetPixel(Math::IntPoint(0, 0));
+    EXPECT_FLOAT_EQ(1.0f, red.r);
+    EXPECT_FLOAT_EQ(0.0f, red.b);
+    Color blue = image->GetPixel(Math::IntPoint(1, 0));
+    EXPECT_FLOAT_EQ(0.0f, blue.r);
+    EXPECT_FLOAT_EQ(1.0f, blue.b);
+}
+
+TEST_F(TextureLoaderFileUT, RefusesTruncatedAndCorruptFiles)
+{
+    CTextureLoader loader(4);
+    loader.Add("truncated.png", truncatedFile);
+    loader.Add("valid.png", validFile);
+    loader.Add("corrupt.png", corruptFile);
+
+    int reported = 0;
+    loader.Decode([&reported](int done, int total) { reported = done; });
+    EXPECT_EQ(3, reported);
+
+    // The other images are still decoded
+    EXPECT_EQ(nullptr, loader.GetImage("truncated.png"));
+    EXPECT_EQ(nullptr, loader.GetImage("corrupt.png"));
+    EXPECT_NE(nullptr, loader.GetImage("valid.png"));
+}
+
+TEST_F(TextureLoaderFileUT, KeepsDecodedImages)
+{
+    CTextureLoader loader(2);
+    loader.Add("valid.png", validFile);
+    loader.Decode();
+
+    CImage* image = loader.GetImage("valid.png");
+    ASSERT_NE(nullptr, image);
+
+    // Added again under the same name, even from another file, it is not decoded again
+    loader.Add("valid.png", corruptFile);
+    loader.Add("other.png", validFile);
+    EXPECT_EQ(2, loader.GetCount());
+    loader.Decode();
+
+    EXPECT_EQ(image, loader.GetImage("valid.png"));
+    EXPECT_NE(nullptr, loader.GetImage("other.png"));
+    EXPECT_NE(image, loader.GetImage("other.png"));
+}
@@ -0,0 +1,182 @@
+#include "object/navgrid.h"
+#include "object/navplanner.h"
+
+#include <gtest/gtest.h>
+
+
+namespace {
+
+//! Terrain with a wall at x = 100 for wheels, counting the samples
+struct WallTerrain
+{
+    int samples;
+};
+
+bool WallSampler(NavClass cls, const Math::Vector &pos, void* user)
+{
+    static_cast<WallTerrain*>(user)->samples++;
+    if (cls != NAV_WHEELS) return true;
+    return pos.x < 100.0f || pos.x >= 110.0f;
+}
+
+//! Maze given as rows of characters, '#' being blocked
+struct Maze
+{
+    const char** rows;
+};
+
+bool MazeBlocked(int x, int y, void* user)
+{
+    Maze* maze = static_cast<Maze*>(user);
+    return maze->rows[y][x] == '#';
+}
+
+} // anonymous namespace
+
+
+TEST(NavGridTest, LazyChunks)
+{
+    WallTerrain terrain;
+    terrain.samples = 0;
+
+    CNavGrid grid;
+    grid.SetSampler(WallSampler, &terrain);
+    EXPECT_EQ(0, terrain.samples);
+
+    int x = CNavGrid::GetCell(105.0f);
+    int y = CNavGrid::GetCell(0.0f);
+    EXPECT_TRUE(grid.IsBlocked(NAV_WHEELS, x, y));
+    EXPECT_FALSE(grid.IsBlocked(NAV_TRACKS, x, y));
+    EXPECT_FALSE(grid.IsBlocked(NAV_WHEELS, x-3, y));
+    EXPECT_EQ(2*NAV_CHUNK*NAV_CHUNK, terrain.samples);
+
+    // Cached for all later requests
+    EXPECT_TRUE(grid.IsBlocked(NAV_WHEELS, x-1, y+1));
+    EXPECT_EQ(2*NAV_CHUNK*NAV_CHUNK, terrain.samples);
+
+    // Outside of the terrain
+    EXPECT_FALSE(grid.IsBlocked(NAV_WHEELS, -1, y));
+    EXPECT_FALSE(grid.IsBlocked(NAV_WHEELS, x, NAV_SIZE));
+}
+
+TEST(NavGridTest, Invalidate)
+{
+    WallTerrain terrain;
+    terrain.samples = 0;
+
+    CNavGrid grid;
+    grid.SetSampler(WallSampler, &terrain);
+
+    int x = CNavGrid::GetCell(105.0f);
+    int y = CNavGrid::GetCell(0.0f);
+    grid.IsBlocked(NAV_WHEELS, x, y);
+    grid.IsBlocked(NAV_WHEELS, x, y+10*NAV_CHUNK);
+    EXPECT_EQ(2, grid.GetComputedCount());
+
+    // Only the chunk around the change is sampled again
+    CNavGrid::TerrainChanged(Math::Vector(104.0f, 0.0f, -1.0f), Math::Vector(106.0f, 0.0f, 1.0f), &grid);
+    grid.IsBlocked(NAV_WHEELS, x, y+10*NAV_CHUNK);
+    EXPECT_EQ(2, grid.GetComputedCount());
+    grid.IsBlocked(NAV_WHEELS, x, y);
+    EXPECT_GE(grid.GetComputedCount(), 3);
+    EXPECT_LE(grid.GetComputedCount(), 6);
+
+    grid.Flush();
+    grid.IsBlocked(NAV_WHEELS, x, y+10*NAV_CHUNK);
+    EXPECT_GE(grid.GetComputedCount(), 4);
+}
+
+TEST(NavPlannerTest, FindsGap)
+{
+    const char* rows[] = {
+        "..........",
+        "..........",
+        "#########.",
+        "..........",
+        "..........",
+        "..........",
+        "..........",
+        "..........",
+        "..........",
+        "..........",
+    };
+    Maze maze;
+    maze.rows = rows;
+
+    CNavPlanner planner;
+    planner.Start(10, Math::IntPoint(0, 0), Math::IntPoint(0, 4), 0.0f, MazeBlocked, &maze);
+    EXPECT_EQ(ERR_OK, planner.Step(1000));
+
+    const std::vector<Math::IntPoint>& path = planner.GetPath();
+    ASSERT_LE(2u, path.size());
+    EXPECT_EQ(Math::IntPoint(0, 0), path.front());
+    EXPECT_EQ(Math::IntPoint(0, 4), path.back());
+    for (unsigned int i = 0; i < path.size(); i++)
+        EXPECT_FALSE(MazeBlocked(path[i].x, path[i].y, &maze));
+
+    // Never cuts the corner of the wall
+    for (unsigned int i = 1; i < path.size(); i++)
+    {
+        EXPECT_FALSE(MazeBlocked(path[i-1].x, path[i].y, &maze));
+        EXPECT_FALSE(MazeBlocked(path[i].x, path[i-1].y, &maze));
+    }
+}
+
+TEST(NavPlannerTest, TimeSliced)
+{
+    const char* rows[] = {
+        "....#.....",
+        "....#.....",
+        "....#.....",
+        "....#.....",
+        "....#.....",
+        "....#.....",
+        "....#.....",
+        "....#.....",
+        "....#.....",
+        "..........",
+    };
+    Maze maze;
+    maze.rows = rows;
+
+    CNavPlanner planner;
+    planner.Start(10, Math::IntPoint(0, 0), Math::IntPoint(9, 0), 0.0f, MazeBlocked, &maze);
+
+    int frames = 0;
+    Error err = ERR_CONTINUE;
+    while (err == ERR_CONTINUE && frames < 100)
+    {
+        err = planner.Step(2);
+        frames++;
+    }
+    EXPECT_EQ(ERR_OK, err);
+    EXPECT_LT(1, frames);
+    EXPECT_EQ(Math::IntPoint(9, 0), planner.GetPath().back());
+}
+
+TEST(NavPlannerTest, GoalRadiusAndFailure)
+{
+    const char* rows[] = {
+        "..........",
+        "......###.",
+        "......#.#.",
+        "......###.",
+        "..........",
+        "..........",
+        "..........",
+        "..........",
+        "..........",
+        "..........",
+    };
+    Maze maze;
+    maze.rows = rows;
+
+    CNavPlanner planner;
+    planner.Start(10, Math::IntPoint(0, 2), Math::IntPoint(7, 2), 0.0f, MazeBlocked, &maze);
+    EXPECT_EQ(ERR_GOTO_IMPOSSIBLE, planner.Step(1000));
+
+    // Enough to come near
+    planner.Start(10, Math::IntPoint(0, 2), Math::IntPoint(7, 2), 2.0f, MazeBlocked, &maze);
+    EXPECT_EQ(ERR_OK, planner.Step(1000));
+    EXPECT_EQ(Math::IntPoint(5, 2), planner.GetPath().back());
+}
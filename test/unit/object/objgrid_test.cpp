@@ -0,0 +1,158 @@
+#include "object/objgrid.h"
+
+#include "math/const.h"
+
+#include <gtest/gtest.h>
+
+
+class ObjectGridUT : public testing::Test
+{
+protected:
+    //! Objects are never dereferenced by the grid, so any distinct addresses will do
+    CObject* Obj(int i)
+    {
+        return reinterpret_cast<CObject*>(&m_dummy[i]);
+    }
+
+    CObjectGrid m_grid;
+    std::vector<CObject*> m_list;
+
+private:
+    char m_dummy[16];
+};
+
+bool AcceptOdd(CObject* obj, void* user)
+{
+    char* base = static_cast<char*>(user);
+    return (reinterpret_cast<char*>(obj) - base) % 2 == 1;
+}
+
+TEST_F(ObjectGridUT, SearchRadius)
+{
+    m_grid.Move(Obj(0), Math::Vector(  0.0f, 0.0f,   0.0f), 2.0f);
+    m_grid.Move(Obj(1), Math::Vector( 30.0f, 0.0f,   0.0f), 2.0f);
+    m_grid.Move(Obj(2), Math::Vector(-10.0f, 0.0f, -10.0f), 2.0f);
+    m_grid.Move(Obj(3), Math::Vector(500.0f, 0.0f, 500.0f), 2.0f);
+
+    m_grid.SearchRadius(m_list, Math::Vector(0.0f, 50.0f, 0.0f), 20.0f);
+    ASSERT_EQ(2u, m_list.size());
+    EXPECT_EQ(Obj(0), m_list[0]);
+    EXPECT_EQ(Obj(2), m_list[1]);
+
+    // Bounding radius of the object counts
+    m_grid.SearchRadius(m_list, Math::Vector(0.0f, 0.0f, 0.0f), 28.5f);
+    EXPECT_EQ(3u, m_list.size());
+
+    // Covering the whole table
+    m_grid.SearchRadius(m_list, Math::Vector(0.0f, 0.0f, 0.0f), 10000.0f);
+    EXPECT_EQ(4u, m_list.size());
+}
+
+TEST_F(ObjectGridUT, AliasedCells)
+{
+    // Cells one table apart share the same bucket
+    float far = OBJECT_GRID_CELL*OBJECT_GRID_SIZE;
+    m_grid.Move(Obj(0), Math::Vector(1.0f,     0.0f, 1.0f), 1.0f);
+    m_grid.Move(Obj(1), Math::Vector(1.0f+far, 0.0f, 1.0f), 1.0f);
+
+    m_grid.SearchRadius(m_list, Math::Vector(0.0f, 0.0f, 0.0f), 5.0f);
+    ASSERT_EQ(1u, m_list.size());
+    EXPECT_EQ(Obj(0), m_list[0]);
+}
+
+TEST_F(ObjectGridUT, LargeObject)
+{
+    m_grid.Move(Obj(0), Math::Vector(0.0f, 0.0f, 0.0f), 180.0f);
+
+    m_grid.SearchRadius(m_list, Math::Vector(150.0f, 0.0f, 0.0f), 5.0f);
+    EXPECT_EQ(1u, m_list.size());
+
+    m_grid.Move(Obj(0), Math::Vector(0.0f, 0.0f, 0.0f), 10.0f);
+    m_grid.SearchRadius(m_list, Math::Vector(150.0f, 0.0f, 0.0f), 5.0f);
+    EXPECT_EQ(0u, m_list.size());
+}
+
+TEST_F(ObjectGridUT, MoveAndRemove)
+{
+    m_grid.Add(Obj(0));
+    m_grid.Add(Obj(1));
+    m_grid.Move(Obj(1), Math::Vector(0.0f, 0.0f, 0.0f), 1.0f);
+    m_grid.Move(Obj(0), Math::Vector(0.0f, 0.0f, 0.0f), 1.0f);
+    EXPECT_EQ(2, m_grid.GetCount());
+
+    // Results are in order of registration
+    m_grid.SearchRadius(m_list, Math::Vector(0.0f, 0.0f, 0.0f), 1.0f);
+    ASSERT_EQ(2u, m_list.size());
+    EXPECT_EQ(Obj(0), m_list[0]);
+    EXPECT_EQ(Obj(1), m_list[1]);
+
+    m_grid.Move(Obj(0), Math::Vector(100.0f, 0.0f, 0.0f), 1.0f);
+    m_grid.SearchRadius(m_list, Math::Vector(0.0f, 0.0f, 0.0f), 1.0f);
+    ASSERT_EQ(1u, m_list.size());
+    EXPECT_EQ(Obj(1), m_list[0]);
+
+    m_grid.Remove(Obj(1));
+    m_grid.SearchRadius(m_list, Math::Vector(0.0f, 0.0f, 0.0f), 1.0f);
+    EXPECT_EQ(0u, m_list.size());
+    EXPECT_EQ(1, m_grid.GetCount());
+}
+
+TEST_F(ObjectGridUT, HideAndMoveAgain)
+{
+    m_grid.Move(Obj(0), Math::Vector(0.0f, 0.0f, 0.0f), 1.0f);
+    m_grid.Move(Obj(1), Math::Vector(0.0f, 0.0f, 0.0f), 1.0f);
+
+    m_grid.Hide(Obj(0));
+    m_grid.SearchRadius(m_list, Math::Vector(0.0f, 0.0f, 0.0f), 1.0f);
+    ASSERT_EQ(1u, m_list.size());
+    EXPECT_EQ(Obj(1), m_list[0]);
+    m_grid.SearchRadius(m_list, Math::Vector(0.0f, 0.0f, 0.0f), 10000.0f);
+    EXPECT_EQ(1u, m_list.size());
+    EXPECT_EQ(Obj(1), m_grid.SearchNearest(Math::Vector(0.0f, 0.0f, 0.0f), 100.0f, nullptr, nullptr));
+    EXPECT_EQ(2, m_grid.GetCount());
+
+    // Found again once moved, still in order of registration
+    m_grid.Move(Obj(0), Math::Vector(0.0f, 0.0f, 0.0f), 1.0f);
+    m_grid.SearchRadius(m_list, Math::Vector(0.0f, 0.0f, 0.0f), 1.0f);
+    ASSERT_EQ(2u, m_list.size());
+    EXPECT_EQ(Obj(0), m_list[0]);
+
+    m_grid.Hide(Obj(1));
+    m_grid.Remove(Obj(1));
+    m_grid.SearchRadius(m_list, Math::Vector(0.0f, 0.0f, 0.0f), 1.0f);
+    EXPECT_EQ(1u, m_list.size());
+}
+
+TEST_F(ObjectGridUT, SearchCone)
+{
+    m_grid.Move(Obj(0), Math::Vector( 20.0f, 0.0f,   0.0f), 1.0f);
+    m_grid.Move(Obj(1), Math::Vector(  0.0f, 0.0f,  20.0f), 1.0f);
+    m_grid.Move(Obj(2), Math::Vector(-20.0f, 0.0f,   0.0f), 1.0f);
+    m_grid.Move(Obj(3), Math::Vector(  2.0f, 0.0f,   0.0f), 1.0f);
+
+    m_grid.SearchCone(m_list, Math::Vector(0.0f, 0.0f, 0.0f), 0.0f, Math::PI*0.5f, 5.0f, 50.0f);
+    ASSERT_EQ(1u, m_list.size());
+    EXPECT_EQ(Obj(0), m_list[0]);
+
+    m_grid.SearchCone(m_list, Math::Vector(0.0f, 0.0f, 0.0f), 0.0f, Math::PI*2.0f, 0.0f, 50.0f);
+    EXPECT_EQ(4u, m_list.size());
+}
+
+TEST_F(ObjectGridUT, SearchNearest)
+{
+    EXPECT_EQ(nullptr, m_grid.SearchNearest(Math::Vector(0.0f, 0.0f, 0.0f), 1000.0f, nullptr, nullptr));
+
+    m_grid.Move(Obj(0), Math::Vector(300.0f, 0.0f,  0.0f), 1.0f);
+    m_grid.Move(Obj(1), Math::Vector(200.0f, 0.0f,  0.0f), 1.0f);
+    m_grid.Move(Obj(2), Math::Vector(  5.0f, 0.0f, 40.0f), 1.0f);
+    m_grid.Move(Obj(3), Math::Vector(-40.0f, 0.0f,  5.0f), 1.0f);
+
+    EXPECT_EQ(Obj(2), m_grid.SearchNearest(Math::Vector(0.0f, 0.0f, 0.0f), 1000.0f, nullptr, nullptr));
+    EXPECT_EQ(Obj(3), m_grid.SearchNearest(Math::Vector(0.0f, 0.0f, 0.0f), 1000.0f, AcceptOdd, Obj(0)));
+    EXPECT_EQ(Obj(0), m_grid.SearchNearest(Math::Vector(400.0f, 0.0f, 0.0f), 1000.0f, nullptr, nullptr));
+    EXPECT_EQ(nullptr, m_grid.SearchNearest(Math::Vector(0.0f, 0.0f, 0.0f), 10.0f, nullptr, nullptr));
+
+    // Ties are resolved in order of registration
+    m_grid.Move(Obj(3), Math::Vector(-5.0f, 0.0f, 40.0f), 1.0f);
+    EXPECT_EQ(Obj(2), m_grid.SearchNearest(Math::Vector(0.0f, 0.0f, 0.0f), 1000.0f, nullptr, nullptr));
+}
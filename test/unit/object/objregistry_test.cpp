@@ -0,0 +1,130 @@
+#include "object/objregistry.h"
+
+#include <gtest/gtest.h>
+
+
+class ObjectRegistryUT : public testing::Test
+{
+protected:
+    //! Objects are never dereferenced by the registry, so any distinct addresses will do
+    CObject* Obj(int i)
+    {
+        return reinterpret_cast<CObject*>(&m_dummy[i]);
+    }
+
+    CObjectRegistry m_registry;
+    std::vector<CObject*> m_list;
+
+private:
+    char m_dummy[16];
+};
+
+TEST_F(ObjectRegistryUT, FindById)
+{
+    m_registry.Add(Obj(0), 1, OBJECT_HUMAN);
+    m_registry.Add(Obj(1), 2, OBJECT_BASE);
+    EXPECT_FALSE(m_registry.Add(Obj(1), 3, OBJECT_BASE));
+    EXPECT_EQ(2, m_registry.GetCount());
+
+    EXPECT_EQ(Obj(0), m_registry.Find(1));
+    EXPECT_EQ(Obj(1), m_registry.Find(2));
+    EXPECT_EQ(nullptr, m_registry.Find(3));
+
+    // Identifiers are not limited
+    m_registry.SetID(Obj(1), 123456);
+    EXPECT_EQ(nullptr, m_registry.Find(2));
+    EXPECT_EQ(Obj(1), m_registry.Find(123456));
+
+    m_registry.Remove(Obj(0));
+    EXPECT_EQ(nullptr, m_registry.Find(1));
+    EXPECT_FALSE(m_registry.Exists(Obj(0)));
+    EXPECT_TRUE(m_registry.Exists(Obj(1)));
+}
+
+TEST_F(ObjectRegistryUT, TypeLists)
+{
+    m_registry.Add(Obj(0), 1, OBJECT_MOBILEwa);
+    m_registry.Add(Obj(1), 2, OBJECT_METAL);
+    m_registry.Add(Obj(2), 3, OBJECT_MOBILEwa);
+    m_registry.Add(Obj(3), 4, OBJECT_MOBILEwa);
+
+    m_registry.List(m_list, OBJECT_MOBILEwa);
+    ASSERT_EQ(3u, m_list.size());
+    EXPECT_EQ(Obj(0), m_list[0]);
+    EXPECT_EQ(Obj(2), m_list[1]);
+    EXPECT_EQ(Obj(3), m_list[2]);
+
+    // Removal from the middle, the head and the tail
+    m_registry.Remove(Obj(2));
+    m_registry.Remove(Obj(0));
+    m_list.clear();
+    m_registry.List(m_list, OBJECT_MOBILEwa);
+    ASSERT_EQ(1u, m_list.size());
+    EXPECT_EQ(Obj(3), m_list[0]);
+    m_registry.Remove(Obj(3));
+    EXPECT_EQ(nullptr, m_registry.GetFirst(OBJECT_MOBILEwa));
+
+    // Changing type moves the object to the other list
+    m_registry.Add(Obj(0), 5, OBJECT_FIX);
+    m_registry.SetType(Obj(0), OBJECT_METAL);
+    EXPECT_EQ(nullptr, m_registry.GetFirst(OBJECT_FIX));
+    m_list.clear();
+    m_registry.List(m_list, OBJECT_METAL);
+    ASSERT_EQ(2u, m_list.size());
+    EXPECT_EQ(Obj(1), m_list[0]);
+    EXPECT_EQ(Obj(0), m_list[1]);
+}
+
+TEST_F(ObjectRegistryUT, CreationOrder)
+{
+    m_registry.Add(Obj(0), 1, OBJECT_SCRAP2);
+    m_registry.Add(Obj(1), 2, OBJECT_SCRAP1);
+    m_registry.Add(Obj(2), 3, OBJECT_METAL);
+    m_registry.Add(Obj(3), 4, OBJECT_SCRAP1);
+
+    // The slot of Obj(1) is reused by a newer object
+    m_registry.Remove(Obj(1));
+    m_registry.Add(Obj(4), 5, OBJECT_SCRAP2);
+    m_registry.Add(Obj(1), 6, OBJECT_SCRAP1);
+
+    // An old object changing type is listed among the objects created around it
+    m_registry.SetType(Obj(2), OBJECT_SCRAP2);
+    m_registry.List(m_list, OBJECT_SCRAP2);
+    ASSERT_EQ(3u, m_list.size());
+    EXPECT_EQ(Obj(0), m_list[0]);
+    EXPECT_EQ(Obj(2), m_list[1]);
+    EXPECT_EQ(Obj(4), m_list[2]);
+
+    // Several types are merged
+    m_list.clear();
+    m_registry.List(m_list, { OBJECT_SCRAP1, OBJECT_SCRAP2 });
+    ASSERT_EQ(5u, m_list.size());
+    EXPECT_EQ(Obj(0), m_list[0]);
+    EXPECT_EQ(Obj(2), m_list[1]);
+    EXPECT_EQ(Obj(3), m_list[2]);
+    EXPECT_EQ(Obj(4), m_list[3]);
+    EXPECT_EQ(Obj(1), m_list[4]);
+    EXPECT_EQ(Obj(0), m_registry.GetFirst(OBJECT_SCRAP2));
+}
+
+TEST_F(ObjectRegistryUT, Handles)
+{
+    EXPECT_EQ(nullptr, m_registry.Resolve(ObjectHandle()));
+
+    m_registry.Add(Obj(0), 1, OBJECT_HUMAN);
+    ObjectHandle handle = m_registry.GetHandle(Obj(0));
+    EXPECT_EQ(Obj(0), m_registry.Resolve(handle));
+    EXPECT_EQ(-1, m_registry.GetHandle(Obj(1)).slot);
+
+    // The slot is reused, but the old handle stays dangling
+    m_registry.Remove(Obj(0));
+    m_registry.Add(Obj(0), 2, OBJECT_HUMAN);
+    EXPECT_EQ(handle.slot, m_registry.GetHandle(Obj(0)).slot);
+    EXPECT_EQ(nullptr, m_registry.Resolve(handle));
+
+    handle = m_registry.GetHandle(Obj(0));
+    m_registry.Flush();
+    EXPECT_EQ(0, m_registry.GetCount());
+    m_registry.Add(Obj(1), 3, OBJECT_HUMAN);
+    EXPECT_EQ(nullptr, m_registry.Resolve(handle));
+}
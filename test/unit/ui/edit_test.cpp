@@ -5,11 +5,51 @@
 
 #include "mocks/text_mock.h"
 
+#include <cstdlib>
 #include <fstream>
+#include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+//! CEdit with the keys pressed by calling its protected methods
+class CTestEdit : public Ui::CEdit
+{
+public:
+    CTestEdit()
+    {
+        m_bMulti = true;
+        m_lineVisible = 10;
+        m_lineFirst = 0;
+        m_dim = Math::Point(1.0f, 1.0f);
+    }
+
+    using CEdit::Insert;
+    using CEdit::Delete;
+    using CEdit::Shift;
+    using CEdit::MinMaj;
+
+    int GetLineTotal()
+    {
+        return m_lineTotal;
+    }
+
+    //! Expects the lines cut after the last changes to be those of the whole text
+    void ExpectSameLines()
+    {
+        Event event;
+        while (m_event->GetEvent(event)) ;
+
+        std::vector<int> offset = m_lineOffset;
+        std::vector<char> indent = m_lineIndent;
+        m_changeFrom = -1;
+        Justif();
+        EXPECT_EQ(m_lineOffset, offset);
+        EXPECT_EQ(m_lineIndent, indent);
+    }
+};
+
 class CEditTest : public testing::Test
 {
 public:
@@ -82,6 +122,120 @@ TEST_F(CEditTest, WriteTest)
     ASSERT_STREQ(expectedScript.c_str(), outputScript.c_str());
 }
 
+TEST_F(CEditTest, IncrementalJustifTest)
+{
+    CTextMock * text = dynamic_cast<CTextMock *>(m_engine->GetText());
+    EXPECT_CALL(*text, GetCharWidth(_, _, _, _)).WillRepeatedly(Return(0.02f));
+    EXPECT_CALL(*text, GetStringWidth(An<const std::string&>(), _, _, _)).WillRepeatedly(Return(1.0f));
+    EXPECT_CALL(*text, GetStringWidth(An<std::string>(), _, _)).WillRepeatedly(Return(1.0f));
+
+    const char letters[] = "ab {}\n\n\t\"/; ";
+    std::string inputScript = "extern void object::Test()\n{\n\tint i = 0; // a comment which is long enough to be cut\n"
+                              "\tstring s = \"{ a string which is long enough to be cut }\";\n"
+                              "\tif ( i == 0 )\n\t{\n\t\ti ++;\n\t}\n}\n";
+
+    srand(1);
+    for (int mode = 0; mode < 4; mode++)
+    {
+        CTestEdit edit;
+        edit.SetMaxChar(Ui::EDITSTUDIOMAX);
+        edit.SetAutoIndent(mode % 2 == 0);
+        edit.SetMultiFont(mode < 2);
+        edit.SetText(inputScript.c_str(), true);
+        edit.ExpectSameLines();
+
+        for (int i = 0; i < 300 && !HasFailure(); i++)
+        {
+            int cursor = rand() % (edit.GetTextLength() + 1);
+            int select = (rand() % 5 == 0) ? rand() % (edit.GetTextLength() + 1) : cursor;
+            edit.SetCursor(cursor, select);
+
+            switch (rand() % 8)
+            {
+                case 0:  edit.Delete(-1);       break;
+                case 1:  edit.Delete(1);        break;
+                case 2:  edit.MinMaj(true);     break;
+                case 3:  edit.Shift(false);     break;
+                default: edit.Insert(letters[rand() % (sizeof(letters) - 1)]);
+            }
+            edit.ExpectSameLines();
+        }
+    }
+}
+
+TEST_F(CEditTest, UndoTest)
+{
+    CTextMock * text = dynamic_cast<CTextMock *>(m_engine->GetText());
+    EXPECT_CALL(*text, GetCharWidth(_, _, _, _)).WillRepeatedly(Return(0.02f));
+    EXPECT_CALL(*text, GetStringWidth(An<const std::string&>(), _, _, _)).WillRepeatedly(Return(1.0f));
+
+    CTestEdit edit;
+    edit.SetMaxChar(Ui::EDITSTUDIOMAX);
+    edit.SetText("{\nline1\nline2\n}\n", true);
+
+    std::vector<std::string> states;
+    srand(2);
+    for (int i = 0; i < Ui::EDITUNDOMAX; i++)
+    {
+        states.push_back(edit.GetText());
+
+        int cursor = rand() % (edit.GetTextLength() + 1);
+        edit.SetCursor(cursor, cursor);  // a new state to undo
+        if (i % 3 == 2)
+        {
+            edit.Delete(-1);
+            edit.Delete(-1);
+        }
+        else
+        {
+            edit.Insert('a');
+            edit.Insert('\n');
+            edit.Insert('b');
+        }
+    }
+
+    for (int i = Ui::EDITUNDOMAX-1; i >= 0; i--)
+    {
+        ASSERT_TRUE(edit.Undo());
+        EXPECT_STREQ(states[i].c_str(), edit.GetText());
+        edit.ExpectSameLines();
+    }
+    EXPECT_FALSE(edit.Undo());
+
+    // The whole text given again can be undone too
+    edit.SetText("another text", false);
+    ASSERT_TRUE(edit.Undo());
+    EXPECT_STREQ(states[0].c_str(), edit.GetText());
+}
+
+TEST_F(CEditTest, LongTextTest)
+{
+    CTextMock * text = dynamic_cast<CTextMock *>(m_engine->GetText());
+    EXPECT_CALL(*text, GetCharWidth(_, _, _, _)).WillRepeatedly(Return(0.02f));
+    EXPECT_CALL(*text, GetStringWidth(An<const std::string&>(), _, _, _)).WillRepeatedly(Return(1.0f));
+
+    std::string inputScript;
+    for (int i = 0; i < 5000; i++)
+    {
+        inputScript += "\tmessage(\"line " + std::to_string(i) + "\");\n";
+    }
+
+    CTestEdit edit;
+    edit.SetMaxChar(Ui::EDITSTUDIOMAX);
+    edit.SetText(inputScript.c_str(), true);
+    EXPECT_EQ(static_cast<int>(inputScript.size()), edit.GetTextLength());
+    EXPECT_EQ(5001, edit.GetLineTotal());
+
+    edit.SetCursor(edit.GetTextLength(), edit.GetTextLength());
+    edit.Insert('x');
+    edit.Insert('\n');
+    EXPECT_EQ(5002, edit.GetLineTotal());
+    edit.ExpectSameLines();
+
+    ASSERT_TRUE(edit.Undo());
+    EXPECT_STREQ(inputScript.c_str(), edit.GetText());
+}
+
 int main(int argc, char *argv[])
 {
     ::testing::InitGoogleTest(&argc, argv);
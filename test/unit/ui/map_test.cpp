@@ -0,0 +1,254 @@
+#include "app/app.h"
+#include "app/gamedata.h"
+
+#include "common/image.h"
+#include "common/logger.h"
+
+#include "graphics/core/nulldevice.h"
+#include "graphics/engine/engine.h"
+#include "graphics/engine/terrain.h"
+#include "graphics/engine/water.h"
+
+#include "math/func.h"
+
+#include "object/robotmain.h"
+
+#include "ui/map.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+//! Device keeping the triangles drawn, the strips cut in triangles
+class CTriangleDevice : public Gfx::CNullDevice
+{
+public:
+    CTriangleDevice() : drawCalls(0) {}
+
+    void DrawPrimitive(Gfx::PrimitiveType type, const Gfx::Vertex* vertices, int vertexCount,
+                       Gfx::Color color) override
+    {
+        drawCalls++;
+        if (type == Gfx::PRIMITIVE_TRIANGLES)
+        {
+            triangles.insert(triangles.end(), vertices, vertices + vertexCount);
+        }
+        else if (type == Gfx::PRIMITIVE_TRIANGLE_STRIP)
+        {
+            // Every other triangle of a strip is turned to keep the winding
+            for (int i = 0; i+2 < vertexCount; i++)
+            {
+                triangles.push_back(vertices[i % 2 == 0 ? i : i+1]);
+                triangles.push_back(vertices[i % 2 == 0 ? i+1 : i]);
+                triangles.push_back(vertices[i+2]);
+            }
+        }
+    }
+
+    int drawCalls;
+    std::vector<Gfx::Vertex> triangles;
+};
+
+class CTestRobotMain : public CRobotMain
+{
+public:
+    CTestRobotMain(CApplication* app) : CRobotMain(app, false)
+    {
+        m_terrain = &terrain;
+    }
+
+    Gfx::CTerrain terrain;
+};
+
+class CTestEngine : public Gfx::CEngine
+{
+public:
+    CTestEngine() : CEngine(nullptr), water(this)
+    {
+        m_water = &water;
+        SetDevice(&device);
+    }
+
+    Gfx::CWater water;
+    CTriangleDevice device;
+};
+
+//! CMap with its drawing helpers
+class CTestMap : public Ui::CMap
+{
+public:
+    using CMap::SetBatch;
+    using CMap::AddIcon;
+    using CMap::DrawPenta;
+    using CMap::DrawBatches;
+    using CMap::RenderTerrain;
+    using CControl::DrawIcon;
+
+    //! Color of a pixel as CMap::UpdateTerrain() computed it before RenderTerrain()
+    Gfx::Color GetTerrainColor(int x, int y)
+    {
+        float scale = m_terrain->GetReliefScale();
+        float water = m_water->GetLevel();
+
+        Math::Vector pos;
+        pos.x =  (static_cast<float>(x) - 128.0f) * m_half / 128.0f;
+        pos.z = -(static_cast<float>(y) - 128.0f) * m_half / 128.0f;
+        pos.y = 0.0f;
+
+        float level;
+        if ( pos.x >= -m_half && pos.x <= m_half &&
+             pos.z >= -m_half && pos.z <= m_half )
+        {
+            level = m_terrain->GetFloorLevel(pos, true) / scale;
+        }
+        else
+        {
+            level = 1000.0f;
+        }
+
+        float intensity = level / 256.0f;
+        if (intensity < 0.0f) intensity = 0.0f;
+        if (intensity > 1.0f) intensity = 1.0f;
+
+        Gfx::Color base = (level >= water) ? m_floorColor : m_waterColor;
+        return Gfx::Color(Math::Norm(base.r + (intensity - 0.5f)),
+                          Math::Norm(base.g + (intensity - 0.5f)),
+                          Math::Norm(base.b + (intensity - 0.5f)), 0.0f);
+    }
+};
+
+class CMapTest : public testing::Test
+{
+protected:
+    CMapTest()
+     : m_robotMain(&m_app)
+    {
+        m_map = new CTestMap();
+    }
+
+    ~CMapTest()
+    {
+        delete m_map;
+    }
+
+    //! Expects the same triangles, vertex by vertex
+    void ExpectSameTriangles(const std::vector<Gfx::Vertex>& expected, const std::vector<Gfx::Vertex>& actual)
+    {
+        ASSERT_EQ(expected.size(), actual.size());
+        for (int i = 0; i < static_cast<int>( expected.size() ); i++)
+        {
+            EXPECT_TRUE(Math::VectorsEqual(expected[i].coord, actual[i].coord)) << "vertex " << i;
+            EXPECT_TRUE(Math::IsEqual(expected[i].texCoord.x, actual[i].texCoord.x)) << "vertex " << i;
+            EXPECT_TRUE(Math::IsEqual(expected[i].texCoord.y, actual[i].texCoord.y)) << "vertex " << i;
+        }
+    }
+
+    CLogger m_logger;
+    CApplication m_app;
+    CGameData m_gameData;
+    CTestRobotMain m_robotMain;
+    CTestEngine m_engine;
+    CTestMap* m_map;
+};
+
+TEST_F(CMapTest, BatchedIconsAreTheTrianglesDrawnOneByOne)
+{
+    Math::Point uv1(64.5f/256.0f, 240.5f/256.0f), uv2(79.0f/256.0f, 255.0f/256.0f);
+    Math::Point dim(0.02f, 0.03f);
+    std::vector<Math::Point> positions = { Math::Point(0.1f, 0.2f), Math::Point(0.5f, 0.4f),
+                                           Math::Point(0.8f, 0.7f) };
+
+    Math::Point p[5] = { Math::Point(0.3f, 0.3f), Math::Point(0.2f, 0.35f), Math::Point(0.25f, 0.4f),
+                         Math::Point(0.35f, 0.4f), Math::Point(0.4f, 0.35f) };
+
+    // Before: one draw call per icon
+    for (const Math::Point& pos : positions)
+        m_map->DrawIcon(pos, dim, uv1, uv2);
+
+    // and the strip of a pentagon, as CMap::DrawPenta() drew it
+    Math::Vector n(0.0f, 0.0f, -1.0f);
+    Gfx::Vertex penta[5];
+    penta[0] = Gfx::Vertex(Math::Vector(p[0].x, p[0].y, 0.0f), n, Math::Point(uv1.x, uv1.y));
+    penta[1] = Gfx::Vertex(Math::Vector(p[1].x, p[1].y, 0.0f), n, Math::Point(uv1.x, uv2.y));
+    penta[2] = Gfx::Vertex(Math::Vector(p[4].x, p[4].y, 0.0f), n, Math::Point(uv2.x, uv2.y));
+    penta[3] = Gfx::Vertex(Math::Vector(p[2].x, p[2].y, 0.0f), n, Math::Point(uv2.x, uv2.y));
+    penta[4] = Gfx::Vertex(Math::Vector(p[3].x, p[3].y, 0.0f), n, Math::Point(uv2.x, uv2.y));
+    m_engine.device.DrawPrimitive(Gfx::PRIMITIVE_TRIANGLE_STRIP, penta, 5, Gfx::Color());
+
+    EXPECT_EQ(4, m_engine.device.drawCalls);
+    std::vector<Gfx::Vertex> before = m_engine.device.triangles;
+
+    // Now: all in one batch
+    m_engine.device.triangles.clear();
+    m_engine.device.drawCalls = 0;
+    m_map->SetBatch("button2.png", Gfx::ENG_RSTATE_TTEXTURE_WHITE);
+    for (const Math::Point& pos : positions)
+        m_map->AddIcon(pos, dim, uv1, uv2);
+    m_map->DrawPenta(p[0], p[1], p[2], p[3], p[4], uv1, uv2);
+    m_map->DrawBatches();
+
+    EXPECT_EQ(1, m_engine.device.drawCalls);
+    ExpectSameTriangles(before, m_engine.device.triangles);
+
+    // The batches are emptied once drawn
+    m_map->DrawBatches();
+    EXPECT_EQ(1, m_engine.device.drawCalls);
+}
+
+TEST_F(CMapTest, BatchesByTextureAndState)
+{
+    Math::Point dim(0.02f, 0.02f);
+    Math::Point uv1(0.0f, 0.0f), uv2(0.5f, 0.5f);
+
+    m_map->SetBatch("button2.png", Gfx::ENG_RSTATE_TTEXTURE_WHITE);
+    m_map->AddIcon(Math::Point(0.1f, 0.1f), dim, uv1, uv2);
+    m_map->SetBatch("button3.png", Gfx::ENG_RSTATE_NORMAL);
+    m_map->AddIcon(Math::Point(0.2f, 0.1f), dim, uv1, uv2);
+    m_map->SetBatch("button2.png", Gfx::ENG_RSTATE_TTEXTURE_BLACK);
+    m_map->AddIcon(Math::Point(0.3f, 0.1f), dim, uv1, uv2);
+    m_map->SetBatch("button2.png", Gfx::ENG_RSTATE_TTEXTURE_WHITE);
+    m_map->AddIcon(Math::Point(0.4f, 0.1f), dim, uv1, uv2);
+    m_map->DrawBatches();
+
+    EXPECT_EQ(3, m_engine.device.drawCalls);
+    EXPECT_EQ(4u * 6, m_engine.device.triangles.size());
+}
+
+TEST_F(CMapTest, PartOfTheTerrainIsTheSameAsTheWholeMap)
+{
+    // Before: the whole map
+    CImage whole(Math::IntPoint(256, 256));
+    m_map->RenderTerrain(&whole, 0, 0);
+
+    // Now: only the pixels from (100, 40) to (140, 200) excluded
+    CImage part(Math::IntPoint(40, 160));
+    m_map->RenderTerrain(&part, 100, 40);
+
+    int water = 0;
+    for (int y = 0; y < 160; y++)
+    {
+        for (int x = 0; x < 40; x++)
+        {
+            Gfx::Color expected = m_map->GetTerrainColor(100 + x, 40 + y);
+            Gfx::Color wholeColor = whole.GetPixel(Math::IntPoint(100 + x, 40 + y));
+            Gfx::Color partColor = part.GetPixel(Math::IntPoint(x, y));
+
+            ASSERT_EQ(wholeColor, partColor) << x << ", " << y;
+            ASSERT_NEAR(expected.r, partColor.r, 1.0f / 255.0f) << x << ", " << y;
+            ASSERT_NEAR(expected.g, partColor.g, 1.0f / 255.0f) << x << ", " << y;
+            ASSERT_NEAR(expected.b, partColor.b, 1.0f / 255.0f) << x << ", " << y;
+
+            if (partColor.b > partColor.r) water++;
+        }
+    }
+
+    // Both the ground and the water are in the area
+    EXPECT_GT(water, 0);
+    EXPECT_LT(water, 40 * 160);
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
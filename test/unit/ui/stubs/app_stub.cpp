@@ -28,7 +28,8 @@ CSoundInterface* CApplication::GetSound()
 
 CEventQueue* CApplication::GetEventQueue()
 {
-    return nullptr;
+    static CEventQueue queue;
+    return &queue;
 }
 
 Event CApplication::CreateUpdateEvent()
@@ -1,4 +1,5 @@
 #include "graphics/engine/engine.h"
+#include "graphics/engine/glyphatlas.h"
 #include "graphics/engine/text.h"
 
 #include "mocks/text_mock.h"
@@ -64,11 +65,26 @@ CText* CEngine::GetText()
     return m_text;
 }
 
+void CEngine::SetDevice(CDevice* device)
+{
+    m_device = device;
+}
+
 CDevice* CEngine::GetDevice()
 {
     return m_device;
 }
 
+CWater* CEngine::GetWater()
+{
+    return m_water;
+}
+
+float CEngine::GetFocus()
+{
+    return 0.75f;
+}
+
 int CEngine::GetEditIndentValue()
 {
     return m_editIndentValue;
@@ -84,6 +100,17 @@ Texture CEngine::LoadTexture(const std::string& /* name */)
     return texture;
 }
 
+Texture CEngine::LoadTexture(const std::string& /* name */, CImage* /* image */)
+{
+    Texture texture;
+    return texture;
+}
+
+bool CEngine::UpdateTexture(const std::string& /* name */, Math::IntPoint /* offset */, CImage* /* image */)
+{
+    return true;
+}
+
 Math::Vector CEngine::GetEyePt()
 {
     return Math::Vector();
@@ -99,6 +126,44 @@ bool CEngine::GetPause()
     return false;
 }
 
+CGroundSpotRenderer::CGroundSpotRenderer(int /* threads */)
+{
+}
+
+CGroundSpotRenderer::~CGroundSpotRenderer()
+{
+}
+
+CTextureLoader::CTextureLoader(int /* threads */)
+{
+}
+
+CTextureLoader::~CTextureLoader()
+{
+}
+
+CGlyphAtlas::CGlyphAtlas(CDevice* device, int pageSize)
+{
+}
+
+CGlyphAtlas::~CGlyphAtlas()
+{
+}
+
+bool CGlyphAtlas::AddGlyph(SDL_Surface* /* surface */, Glyph& /* glyph */)
+{
+    return false;
+}
+
+unsigned int CGlyphAtlas::GetTexture(int /* page */)
+{
+    return 0;
+}
+
+void CGlyphAtlas::Flush()
+{
+}
+
 
 } /* Gfx */
 
@@ -0,0 +1,42 @@
+#include "object/object.h"
+
+
+ObjectType CObject::GetType()
+{
+    return OBJECT_NULL;
+}
+
+Math::Vector CObject::GetPosition(int /* part */)
+{
+    return Math::Vector();
+}
+
+float CObject::GetAngleY(int /* part */)
+{
+    return 0.0f;
+}
+
+CObject* CObject::GetTruck()
+{
+    return nullptr;
+}
+
+bool CObject::GetSelect(bool /* bReal */)
+{
+    return false;
+}
+
+bool CObject::GetSelectable()
+{
+    return false;
+}
+
+bool CObject::GetProxyActivate()
+{
+    return false;
+}
+
+bool CObject::GetActif()
+{
+    return false;
+}
@@ -11,6 +11,21 @@ CRobotMain::~CRobotMain()
 {
 }
 
+Gfx::CTerrain* CRobotMain::GetTerrain()
+{
+    return m_terrain;
+}
+
+bool CRobotMain::SelectObject(CObject* /* pObj */, bool /* displayError */)
+{
+    return false;
+}
+
+bool CRobotMain::GetRadar()
+{
+    return false;
+}
+
 bool CRobotMain::GetGlint()
 {
     return false;
@@ -0,0 +1,45 @@
+#include "graphics/engine/terrain.h"
+
+#include <cmath>
+
+
+// Graphics module namespace
+namespace Gfx {
+
+
+CTerrain::CTerrain()
+{
+}
+
+CTerrain::~CTerrain()
+{
+}
+
+// Hills and valleys, from -40 to 40
+float CTerrain::GetFloorLevel(const Math::Vector& pos, bool /* brut */, bool /* water */)
+{
+    return 25.0f * sinf(pos.x / 40.0f) + 15.0f * cosf(pos.z / 25.0f);
+}
+
+int CTerrain::GetMosaicCount()
+{
+    return 4;
+}
+
+int CTerrain::GetBrickCount()
+{
+    return 8;
+}
+
+float CTerrain::GetBrickSize()
+{
+    return 25.0f;
+}
+
+float CTerrain::GetReliefScale()
+{
+    return 0.25f;
+}
+
+
+} /* Gfx */
@@ -0,0 +1,22 @@
+#include "graphics/engine/water.h"
+
+
+// Graphics module namespace
+namespace Gfx {
+
+
+CWater::CWater(CEngine* /* engine */)
+{
+}
+
+CWater::~CWater()
+{
+}
+
+float CWater::GetLevel()
+{
+    return 20.0f;
+}
+
+
+} /* Gfx */